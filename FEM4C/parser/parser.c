@@ -4,6 +4,7 @@
 #include <errno.h>
 #include <math.h>      // INFINITY など
 #include <ctype.h>
+#include <stdint.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -88,7 +89,8 @@ typedef struct {
   int count;
 } EdgeRec;
 
-typedef struct { EdgeRec *data; size_t size, cap; } EdgeVec;
+// data は出現順、slots は (n1,n2) キーのオープンアドレス法ハッシュ（値は index+1、0 は空き）
+typedef struct { EdgeRec *data; size_t size, cap; int *slots; size_t nslots; } EdgeVec;
 
 typedef struct {
   int n1, n2;
@@ -172,18 +174,57 @@ static void surfelemvec_push(SurfElemVec *v, SurfElem e){
   v->data[v->size++] = e;
 }
 
-static void edgevec_init(EdgeVec *v){ v->data=NULL; v->size=0; v->cap=0; }
-static int edgevec_find(EdgeVec *v, int n1, int n2){
+static void edgevec_init(EdgeVec *v){ v->data=NULL; v->size=0; v->cap=0; v->slots=NULL; v->nslots=0; }
+static void edgevec_free(EdgeVec *v){ free(v->data); free(v->slots); edgevec_init(v); }
+
+// 2整数キーのハッシュ（splitmix64 の最終段）
+static size_t hash_int_pair(int a, int b){
+  uint64_t k = ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return (size_t)k;
+}
+
+static void edgevec_rehash(EdgeVec *v, size_t nslots){
+  int *slots = (int*)calloc(nslots, sizeof(int));
+  if(!slots){ perror("calloc"); exit(1); }
   for(size_t i=0;i<v->size;i++){
-    if(v->data[i].n1==n1 && v->data[i].n2==n2){
-      return (int)i;
+    size_t h = hash_int_pair(v->data[i].n1, v->data[i].n2) & (nslots-1);
+    while(slots[h]!=0){ h = (h+1) & (nslots-1); }
+    slots[h] = (int)i + 1;
+  }
+  free(v->slots);
+  v->slots = slots;
+  v->nslots = nslots;
+}
+
+// n1<n2 に正規化済みのキーを検索し、見つからなければ挿入位置（空きスロット）を *slot に返す
+static int edgevec_find(EdgeVec *v, int n1, int n2, size_t *slot){
+  if(v->nslots==0){
+    return -1;
+  }
+  size_t h = hash_int_pair(n1, n2) & (v->nslots-1);
+  while(v->slots[h]!=0){
+    const EdgeRec *e=&v->data[v->slots[h]-1];
+    if(e->n1==n1 && e->n2==n2){
+      return v->slots[h]-1;
     }
+    h = (h+1) & (v->nslots-1);
   }
+  if(slot){ *slot=h; }
   return -1;
 }
 static void edgevec_add(EdgeVec *v, int n1, int n2, int elem){
   if(n1>n2){ int tmp=n1; n1=n2; n2=tmp; }
-  int idx=edgevec_find(v,n1,n2);
+  // 充填率 1/2 を超えないように拡張
+  if((v->size+1)*2 > v->nslots){
+    edgevec_rehash(v, v->nslots ? v->nslots*2 : 1024);
+  }
+  size_t slot=0;
+  int idx=edgevec_find(v,n1,n2,&slot);
   if(idx>=0){
     EdgeRec *e=&v->data[idx];
     if(e->count==1){ e->e2=elem; }
@@ -198,6 +239,7 @@ static void edgevec_add(EdgeVec *v, int n1, int n2, int elem){
   EdgeRec rec;
   rec.n1=n1; rec.n2=n2; rec.e1=elem; rec.e2=-1; rec.count=1;
   v->data[v->size++] = rec;
+  v->slots[slot] = (int)v->size;
 }
 
 static void ridgevec_init(RidgeVec *v){ v->data=NULL; v->size=0; v->cap=0; }
@@ -928,11 +970,252 @@ static int is_degenerate_tria3_ids(int a, int b, int c){
   return 0;
 }
 
+// ------------------------------ 要素カード ------------------------------
+// CTRIA3（自由書式; カード名スキップ）
+static int parse_tria3_line(const char *line, Tria3 *e){
+  double vals[16];
+  int n=extract_numbers(after_head(line), vals, 16);
+  if(n<5){
+    return 0;
+  }
+  e->id =(int)vals[0];
+  e->pid=(int)vals[1];
+  e->n1 =(int)vals[2];
+  e->n2 =(int)vals[3];
+  e->n3 =(int)vals[4];
+  return 1;
+}
+
+// CTRIA6（自由書式; カード名スキップ）
+static int parse_tria6_line(const char *line, Tria6 *e){
+  double vals[32];
+  int n=extract_numbers(after_head(line), vals, 32);
+  if(n<8){
+    return 0;
+  }
+  e->id =(int)vals[0];
+  e->pid=(int)vals[1];
+  e->n1 =(int)vals[2];
+  e->n2 =(int)vals[3];
+  e->n3 =(int)vals[4];
+  e->n4 =(int)vals[5];
+  e->n5 =(int)vals[6];
+  e->n6 =(int)vals[7];
+  return 1;
+}
+
+// 要素の供給元：通常はメモリ上のベクタ、--stream 時は入力ファイルを毎回読み直す。
+// --stream は単一パスではない：要素を使う処理（退化チェック、CTRIA3 出力、CTRIA6 出力）
+// ごとに入力を読み直すので、入力は最大 4 回走査される。省けるのは Tria3Vec/Tria6Vec
+// だけで、NodeVec と表面要素・エッジ（SurfElemVec/EdgeVec）は従来どおりメモリに持つ。
+typedef struct {
+  FILE *fp;             // 非NULLならストリーミング
+  const Tria3Vec *t3s;
+  const Tria6Vec *t6s;
+  size_t pos;
+} ElemSource;
+
+static void elemsrc_rewind(ElemSource *src){
+  src->pos=0;
+  if(src->fp){
+    rewind(src->fp);
+  }
+}
+
+static int elemsrc_next_tria3(ElemSource *src, Tria3 *out){
+  if(!src->fp){
+    if(src->pos>=src->t3s->size){
+      return 0;
+    }
+    *out=src->t3s->data[src->pos++];
+    return 1;
+  }
+  char line[4096];
+  while(fgets(line, sizeof(line), src->fp)){
+    char head[32];
+    head_token(line, head);
+    if(strncmp(head, "CTRIA3", 6)==0 && parse_tria3_line(line, out)){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int elemsrc_next_tria6(ElemSource *src, Tria6 *out){
+  if(!src->fp){
+    if(src->pos>=src->t6s->size){
+      return 0;
+    }
+    *out=src->t6s->data[src->pos++];
+    return 1;
+  }
+  char line[4096];
+  while(fgets(line, sizeof(line), src->fp)){
+    char head[32];
+    head_token(line, head);
+    if(strncmp(head, "CTRIA6", 6)==0 && parse_tria6_line(line, out)){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// 表面要素の登録（法線計算＋エッジハッシュへの追加）。in[] は内部ノード番号（1始まり）
+static void add_surface_elem(SurfElemVec *se, EdgeVec *edges, const NodeVec *nodes,
+                             int is2d, int eid, const int in[3]){
+  SurfElem e;
+  e.eid = eid;
+  e.n[0] = in[0]-1;
+  e.n[1] = in[1]-1;
+  e.n[2] = in[2]-1;
+  if(is2d){
+    e.normal[0]=0.0; e.normal[1]=0.0; e.normal[2]=1.0;
+  }else{
+    const Node *A=&nodes->data[e.n[0]];
+    const Node *B=&nodes->data[e.n[1]];
+    const Node *C=&nodes->data[e.n[2]];
+    double ab[3]={B->x-A->x, B->y-A->y, B->z-A->z};
+    double ac[3]={C->x-A->x, C->y-A->y, C->z-A->z};
+    e.normal[0]=ab[1]*ac[2]-ab[2]*ac[1];
+    e.normal[1]=ab[2]*ac[0]-ab[0]*ac[2];
+    e.normal[2]=ab[0]*ac[1]-ab[1]*ac[0];
+    normalize_vec3(e.normal);
+  }
+  e.surface_id = 0;
+  surfelemvec_push(se, e);
+  edgevec_add(edges, e.n[0], e.n[1], (int)se->size-1);
+  edgevec_add(edges, e.n[1], e.n[2], (int)se->size-1);
+  edgevec_add(edges, e.n[2], e.n[0], (int)se->size-1);
+}
+
+// ------------------------------ 体積・質量・慣性 ------------------------------
+typedef struct {
+  double volume_mm3;
+  double mass_g;
+  double cx_mass, cy_mass;
+  double Ix_origin, Iy_origin, Iz_origin;
+} MassProps;
+
+// CTRIA3 1要素分を PID ごとの厚さ・材質で積算（原点まわり慣性）
+static void accumulate_tria3_mass(MassProps *mp, const Tria3 *t, const NodeVec *nodes,
+                                  const PShellVec *pshells, const Mat1 *mat, int mat_found){
+  int i1 = find_node_index_by_id(nodes, t->n1);
+  int i2 = find_node_index_by_id(nodes, t->n2);
+  int i3 = find_node_index_by_id(nodes, t->n3);
+  if(i1<0 || i2<0 || i3<0){
+    return;
+  }
+  const Node *A=&nodes->data[i1];
+  const Node *B=&nodes->data[i2];
+  const Node *C=&nodes->data[i3];
+
+  const PShell *ps = find_pshell(pshells, t->pid);
+  double T = (ps && ps->hasT && ps->T>0.0) ? ps->T : 1.0;                     // 板厚
+  double rho_gmm3 = (mat_found && mat->hasRho) ? (mat->rho * 1000.0) : 0.0;   // kg/mm^3 → g/mm^3
+
+  double area = fabs(tri_area_signed(A,B,C));
+  double vol  = area * T;
+  double mass = rho_gmm3 * vol;
+
+  mp->volume_mm3 += vol;
+  mp->mass_g     += mass;
+  double cx_tri = (A->x + B->x + C->x) / 3.0;
+  double cy_tri = (A->y + B->y + C->y) / 3.0;
+  mp->cx_mass    += mass * cx_tri;
+  mp->cy_mass    += mass * cy_tri;
+
+  // 多角形公式（三角形）
+  const Node poly[3]={*A, *B, *C};
+  double Ix_area = 0.0;
+  double Iy_area = 0.0;
+  double Iz_area = 0.0;
+  for(int k=0;k<3;k++){
+    const Node *P=&poly[k];
+    const Node *Q=&poly[(k+1)%3];
+    double cross = P->x * Q->y - Q->x * P->y;
+    Ix_area += cross * (P->y*P->y + P->y*Q->y + Q->y*Q->y);
+    Iy_area += cross * (P->x*P->x + P->x*Q->x + Q->x*Q->x);
+    Iz_area += cross * (P->x*P->x + P->x*Q->x + Q->x*Q->x
+                      + P->y*P->y + P->y*Q->y + Q->y*Q->y);
+  }
+  double factor = (1.0/12.0) * T * rho_gmm3; // g
+  mp->Ix_origin += factor * fabs(Ix_area);
+  mp->Iy_origin += factor * fabs(Iy_area);
+  mp->Iz_origin += factor * fabs(Iz_area);
+}
+
+// ------------------------------ 拘束行の重複判定 ------------------------------
+typedef struct {
+  int target_type; /* 1=node, 2=surface, 3=ridgeline */
+  int id;
+  char comp[8];
+  double d;
+} FixLine;
+
+// lines は出現順、slots は (target_type,id,comp) キーのハッシュ（値は index+1）
+typedef struct { FixLine *lines; size_t size, cap; int *slots; size_t nslots; } FixSet;
+
+static size_t fixline_hash(int target_type, int id, const char *comp){
+  size_t h = hash_int_pair(target_type, id);
+  for(const char *p=comp; *p; ++p){
+    h = (h ^ (unsigned char)*p) * 1099511628211ULL;
+  }
+  return h;
+}
+
+static void fixset_rehash(FixSet *fs, size_t nslots){
+  int *slots = (int*)calloc(nslots, sizeof(int));
+  if(!slots){ perror("calloc"); exit(1); }
+  for(size_t i=0;i<fs->size;i++){
+    const FixLine *f=&fs->lines[i];
+    size_t h = fixline_hash(f->target_type, f->id, f->comp) & (nslots-1);
+    while(slots[h]!=0){ h = (h+1) & (nslots-1); }
+    slots[h] = (int)i + 1;
+  }
+  free(fs->slots);
+  fs->slots = slots;
+  fs->nslots = nslots;
+}
+
+// 同一 (対象, ID, 成分, 強制変位) が既にあれば 0、新規なら追加して 1
+static int fixset_add(FixSet *fs, int target_type, int id, const char *comp, double d){
+  if((fs->size+1)*2 > fs->nslots){
+    fixset_rehash(fs, fs->nslots ? fs->nslots*2 : 64);
+  }
+  char key[8];
+  strncpy(key, comp, sizeof(key) - 1);
+  key[sizeof(key) - 1] = '\0';
+  size_t h = fixline_hash(target_type, id, key) & (fs->nslots-1);
+  while(fs->slots[h]!=0){
+    const FixLine *f=&fs->lines[fs->slots[h]-1];
+    if(f->target_type == target_type && f->id == id &&
+       strcmp(f->comp, comp) == 0 && fabs(f->d - d) < 1e-12){
+      return 0;
+    }
+    h = (h+1) & (fs->nslots-1);
+  }
+  if(fs->size == fs->cap){
+    fs->cap = fs->cap ? fs->cap*2 : 32;
+    fs->lines = (FixLine*)realloc(fs->lines, fs->cap*sizeof(FixLine));
+    if(!fs->lines){ perror("realloc"); exit(1); }
+  }
+  FixLine *f=&fs->lines[fs->size++];
+  f->target_type = target_type;
+  f->id = id;
+  memcpy(f->comp, key, sizeof(key));
+  f->d = d;
+  fs->slots[h] = (int)fs->size;
+  return 1;
+}
+
 // ------------------------------ main ------------------------------
 int main(int argc, char **argv){
   if(argc < 3){
     fprintf(stderr,
-      "Usage: %s <input_bdf> <out_root> [part_name] [--part=<name>] [--dofnames] [--dump] [--plane=xz|xy]\n",
+      "Usage: %s <input_bdf> <out_root> [part_name] [--part=<name>] [--dofnames] [--dump] [--plane=xz|xy] [--stream]\n"
+      "  --stream  do not hold CTRIA3/CTRIA6 cards; re-read them from the input for each\n"
+      "            element pass (up to 4 reads of the file in total). Nodes, surface\n"
+      "            elements and edges are still held in memory.\n",
       argv[0]);
     return 1;
   }
@@ -944,6 +1227,7 @@ int main(int argc, char **argv){
   int  opt_dump     = 0;
   int  opt_plane_xz = 0;
   int  opt_plane_xy = 0;
+  int  opt_stream   = 0;  // 要素を保持せず入力ファイルを再走査する（複数パス）
   char opt_part[256]={0};
 
   for(int ai=3; ai<argc; ++ai){
@@ -955,6 +1239,8 @@ int main(int argc, char **argv){
       opt_plane_xz = 1;
     }else if(strcmp(argv[ai], "--plane=xy")==0){
       opt_plane_xy = 1;
+    }else if(strcmp(argv[ai], "--stream")==0){
+      opt_stream = 1;
     }else if(strncmp(argv[ai], "--part=", 7)==0){
       snprintf(opt_part, sizeof(opt_part), "%s", argv[ai]+7);
     }
@@ -1034,6 +1320,13 @@ int main(int argc, char **argv){
 
   int z_nonzero_detected = 0;
 
+  // --stream 時は要素を数えるだけ（ID昇順なら並べ替え不要で再走査できる）
+  size_t n_t3 = 0;
+  size_t n_t6 = 0;
+  int last_t3_id = 0;
+  int last_t6_id = 0;
+  int elems_sorted = 1;
+
   // 行ごとに読み取り
   char line[4096];
   while(fgets(line, sizeof(line), fp)){
@@ -1183,34 +1476,29 @@ int main(int argc, char **argv){
 
     // -------- CTRIA3（自由書式; カード名スキップ） --------
     if(strncmp(head, "CTRIA3", 6)==0){
-      double vals[16];
-      int n=extract_numbers(after_head(line), vals, 16);
-      if(n>=5){
-        Tria3 e;
-        e.id =(int)vals[0];
-        e.pid=(int)vals[1];
-        e.n1 =(int)vals[2];
-        e.n2 =(int)vals[3];
-        e.n3 =(int)vals[4];
-        tria3vec_push(&t3s, e);
+      Tria3 e;
+      if(parse_tria3_line(line, &e)){
+        if(opt_stream){
+          if(n_t3>0 && e.id<last_t3_id){ elems_sorted=0; }
+          last_t3_id=e.id;
+          n_t3++;
+        }else{
+          tria3vec_push(&t3s, e);
+        }
       }
       continue;
     }
    // -------- CTRIA6（自由書式; カード名スキップ） --------
     if(strncmp(head, "CTRIA6", 6)==0){
-      double vals[32];
-      int n=extract_numbers(after_head(line), vals, 32);
-      if(n>=8){
-        Tria6 e;
-        e.id =(int)vals[0];
-        e.pid=(int)vals[1];
-        e.n1 =(int)vals[2];
-        e.n2 =(int)vals[3];
-        e.n3 =(int)vals[4];
-        e.n4 =(int)vals[5];
-        e.n5 =(int)vals[6];
-        e.n6 =(int)vals[7];
-        tria6vec_push(&t6s, e);
+      Tria6 e;
+      if(parse_tria6_line(line, &e)){
+        if(opt_stream){
+          if(n_t6>0 && e.id<last_t6_id){ elems_sorted=0; }
+          last_t6_id=e.id;
+          n_t6++;
+        }else{
+          tria6vec_push(&t6s, e);
+        }
       }
       continue;
     }
@@ -1250,16 +1538,36 @@ int main(int argc, char **argv){
       continue;
     }
   } // while fgets
-  fclose(fp);
 
+  ElemSource esrc = { NULL, &t3s, &t6s, 0 };
+  if(opt_stream && !elems_sorted){
+    // 並べ替えが必要なので通常モードに戻す
+    fprintf(stderr, "Warning: element IDs are not ascending; --stream falls back to buffered mode\n");
+    ElemSource scan = { fp, NULL, NULL, 0 };
+    Tria3 e3;
+    Tria6 e6;
+    elemsrc_rewind(&scan);
+    while(elemsrc_next_tria3(&scan, &e3)){ tria3vec_push(&t3s, e3); }
+    elemsrc_rewind(&scan);
+    while(elemsrc_next_tria6(&scan, &e6)){ tria6vec_push(&t6s, e6); }
+    opt_stream = 0;
+  }
+  if(opt_stream){
+    esrc.fp = fp;
+  }else{
+    fclose(fp);
+    fp = NULL;
+    n_t3 = t3s.size;
+    n_t6 = t6s.size;
+  }
 
   // ファイル読み取り完了
 
 
   // ID順に並べ替え（内部ノードID=1..N に対応）
   qsort(nodes.data, nodes.size, sizeof(Node),  cmp_node_id);
-  qsort(t3s.data,   t3s.size,   sizeof(Tria3), cmp_tria3_id);
-  qsort(t6s.data,   t6s.size,   sizeof(Tria6), cmp_tria6_id);
+  if(t3s.size){ qsort(t3s.data, t3s.size, sizeof(Tria3), cmp_tria3_id); }
+  if(t6s.size){ qsort(t6s.data, t6s.size, sizeof(Tria6), cmp_tria6_id); }
 
   // -------- mesh/mesh.dat --------
   char path_mesh[1024];
@@ -1270,11 +1578,11 @@ int main(int argc, char **argv){
     return 1;
   }
 
-  int has_tria3 = ((int)t3s.size > 0);
-  int has_tria6 = ((int)t6s.size > 0);
+  int has_tria3 = ((int)n_t3 > 0);
+  int has_tria6 = ((int)n_t6 > 0);
 
   fprintf(fmesh, "Total number of nodes [–]\n%zu\n", nodes.size);
-  fprintf(fmesh, "Total number of elements [–]\n%zu\n", t3s.size + t6s.size);
+  fprintf(fmesh, "Total number of elements [–]\n%zu\n", n_t3 + n_t6);
   fprintf(fmesh, "Element type\n");
   if(has_tria3 && !has_tria6){
     fprintf(fmesh, "CTRIA3\n");
@@ -1296,8 +1604,11 @@ int main(int argc, char **argv){
   int   *bad_eids        = NULL;
   size_t bad_cap         = 0;
 
-  for(size_t i=0;i<t3s.size;i++){
-    int ids[3] = {t3s.data[i].n1, t3s.data[i].n2, t3s.data[i].n3};
+  Tria3 t3;
+  Tria6 t6;
+  elemsrc_rewind(&esrc);
+  while(elemsrc_next_tria3(&esrc, &t3)){
+    int ids[3] = {t3.n1, t3.n2, t3.n3};
     int in[3];
     for(int k=0;k<3;k++){
       int idx=find_node_index_by_id(&nodes, ids[k]);
@@ -1312,7 +1623,7 @@ int main(int argc, char **argv){
           exit(1);
         }
       }
-      bad_eids[bad_tria3_count++] = t3s.data[i].id;
+      bad_eids[bad_tria3_count++] = t3.id;
     }
   }
 
@@ -1342,9 +1653,13 @@ int main(int argc, char **argv){
   EdgeVec edges; edgevec_init(&edges);
   int is2d = !z_nonzero_detected;
 
-  // CTRIA3（退化はスキップ）
-  for(size_t i=0;i<t3s.size;i++){
-    int ids[3] = {t3s.data[i].n1, t3s.data[i].n2, t3s.data[i].n3};
+  // CTRIA3（退化はスキップ）。体積・質量・慣性も同じ走査で積算する
+  MassProps mp = {0};
+  elemsrc_rewind(&esrc);
+  while(elemsrc_next_tria3(&esrc, &t3)){
+    accumulate_tria3_mass(&mp, &t3, &nodes, &pshells, &mat, mat_found);
+
+    int ids[3] = {t3.n1, t3.n2, t3.n3};
     int in[3];
     for(int k=0;k<3;k++){
       int idx=find_node_index_by_id(&nodes, ids[k]);
@@ -1354,7 +1669,7 @@ int main(int argc, char **argv){
       if(flog){
         fprintf(flog,
           "[CTRIA3] EID=%d PID=%d G=(%d,%d,%d) -> internal (%d,%d,%d) : DEGENERATE\n",
-          t3s.data[i].id, t3s.data[i].pid, ids[0], ids[1], ids[2], in[0], in[1], in[2]);
+          t3.id, t3.pid, ids[0], ids[1], ids[2], in[0], in[1], in[2]);
       }
       continue;
     }
@@ -1362,41 +1677,19 @@ int main(int argc, char **argv){
     if(flog){
       fprintf(flog,
         "[CTRIA3] EID=%d PID=%d G=(%d,%d,%d) -> internal (%d,%d,%d) : OK\n",
-        t3s.data[i].id, t3s.data[i].pid, ids[0], ids[1], ids[2], in[0], in[1], in[2]);
+        t3.id, t3.pid, ids[0], ids[1], ids[2], in[0], in[1], in[2]);
     }
     fprintf(fmesh, "%zu, %d, %d, %d\n", internal_eid, in[0], in[1], in[2]);
 
     if(in[0]>0 && in[1]>0 && in[2]>0){
-      SurfElem e;
-      e.eid = (int)internal_eid;
-      e.n[0] = in[0]-1;
-      e.n[1] = in[1]-1;
-      e.n[2] = in[2]-1;
-      if(is2d){
-        e.normal[0]=0.0; e.normal[1]=0.0; e.normal[2]=1.0;
-      }else{
-        const Node *A=&nodes.data[e.n[0]];
-        const Node *B=&nodes.data[e.n[1]];
-        const Node *C=&nodes.data[e.n[2]];
-        double ab[3]={B->x-A->x, B->y-A->y, B->z-A->z};
-        double ac[3]={C->x-A->x, C->y-A->y, C->z-A->z};
-        e.normal[0]=ab[1]*ac[2]-ab[2]*ac[1];
-        e.normal[1]=ab[2]*ac[0]-ab[0]*ac[2];
-        e.normal[2]=ab[0]*ac[1]-ab[1]*ac[0];
-        normalize_vec3(e.normal);
-      }
-      e.surface_id = 0;
-      surfelemvec_push(&se, e);
-      edgevec_add(&edges, e.n[0], e.n[1], (int)se.size-1);
-      edgevec_add(&edges, e.n[1], e.n[2], (int)se.size-1);
-      edgevec_add(&edges, e.n[2], e.n[0], (int)se.size-1);
+      add_surface_elem(&se, &edges, &nodes, is2d, (int)internal_eid, in);
     }
   }
 
   // CTRIA6（簡易：接続だけ出力。面積/慣性は将来拡張）
-  for(size_t i=0;i<t6s.size;i++){
-    int ids[6] = {t6s.data[i].n1, t6s.data[i].n2, t6s.data[i].n3,
-                  t6s.data[i].n4, t6s.data[i].n5, t6s.data[i].n6};
+  elemsrc_rewind(&esrc);
+  while(elemsrc_next_tria6(&esrc, &t6)){
+    int ids[6] = {t6.n1, t6.n2, t6.n3, t6.n4, t6.n5, t6.n6};
     int in[6];
     for(int k=0;k<6;k++){
       int idx=find_node_index_by_id(&nodes, ids[k]);
@@ -1407,29 +1700,7 @@ int main(int argc, char **argv){
             internal_eid, in[0], in[1], in[2], in[3], in[4], in[5]);
 
     if(in[0]>0 && in[1]>0 && in[2]>0){
-      SurfElem e;
-      e.eid = (int)internal_eid;
-      e.n[0] = in[0]-1;
-      e.n[1] = in[1]-1;
-      e.n[2] = in[2]-1;
-      if(is2d){
-        e.normal[0]=0.0; e.normal[1]=0.0; e.normal[2]=1.0;
-      }else{
-        const Node *A=&nodes.data[e.n[0]];
-        const Node *B=&nodes.data[e.n[1]];
-        const Node *C=&nodes.data[e.n[2]];
-        double ab[3]={B->x-A->x, B->y-A->y, B->z-A->z};
-        double ac[3]={C->x-A->x, C->y-A->y, C->z-A->z};
-        e.normal[0]=ab[1]*ac[2]-ab[2]*ac[1];
-        e.normal[1]=ab[2]*ac[0]-ab[0]*ac[2];
-        e.normal[2]=ab[0]*ac[1]-ab[1]*ac[0];
-        normalize_vec3(e.normal);
-      }
-      e.surface_id = 0;
-      surfelemvec_push(&se, e);
-      edgevec_add(&edges, e.n[0], e.n[1], (int)se.size-1);
-      edgevec_add(&edges, e.n[1], e.n[2], (int)se.size-1);
-      edgevec_add(&edges, e.n[2], e.n[0], (int)se.size-1);
+      add_surface_elem(&se, &edges, &nodes, is2d, (int)internal_eid, in);
     }
   }
   fclose(fmesh);
@@ -1614,41 +1885,9 @@ int main(int argc, char **argv){
   fprintf(fmat, "density [kg/mm^3]\n%.10g\n",   (mat_found && mat.hasRho)? mat.rho: 0.0);
   fclose(fmat);
 
-  // -------- material/Volume.dat（PIDごと厚さ・材質反映） --------
-  double total_volume_mm3 = 0.0;
-  double total_mass_g     = 0.0;
-  double cx_mass = 0.0;
-  double cy_mass = 0.0;
-
-  for(size_t i=0;i<t3s.size;i++){
-    int i1 = find_node_index_by_id(&nodes, t3s.data[i].n1);
-    int i2 = find_node_index_by_id(&nodes, t3s.data[i].n2);
-    int i3 = find_node_index_by_id(&nodes, t3s.data[i].n3);
-    if(i1<0 || i2<0 || i3<0){
-      continue;
-    }
-    const Node *A=&nodes.data[i1];
-    const Node *B=&nodes.data[i2];
-    const Node *C=&nodes.data[i3];
-
-    double area = fabs(tri_area_signed(A,B,C));
-
-    const PShell *ps = find_pshell(&pshells, t3s.data[i].pid);
-    double T = (ps && ps->hasT && ps->T>0.0) ? ps->T : 1.0;                     // 板厚
-    double rho_gmm3 = (mat_found && mat.hasRho) ? (mat.rho * 1000.0) : 0.0;     // kg/mm^3 → g/mm^3
-
-    double vol  = area * T;
-    double mass = rho_gmm3 * vol;
-
-    total_volume_mm3 += vol;
-    total_mass_g     += mass;
-
-    double cx_tri = (A->x + B->x + C->x) / 3.0;
-    double cy_tri = (A->y + B->y + C->y) / 3.0;
-
-    cx_mass += mass * cx_tri;
-    cy_mass += mass * cy_tri;
-  }
+  // -------- material/Volume.dat（PIDごと厚さ・材質反映; CTRIA3 走査時に積算済み） --------
+  double total_volume_mm3 = mp.volume_mm3;
+  double total_mass_g     = mp.mass_g;
 
   char path_vol[1024];
   snprintf(path_vol, sizeof(path_vol), "%s/%s/material/Volume.dat", outroot, part);
@@ -1662,58 +1901,14 @@ int main(int argc, char **argv){
   fclose(fvol);
 
   // -------- material/Inertia.dat（COMまわり慣性） --------
-  double Ix_origin = 0.0;
-  double Iy_origin = 0.0;
-  double Iz_origin = 0.0;
-
-  for(size_t i=0;i<t3s.size;i++){
-    int idx[3] = {
-      find_node_index_by_id(&nodes, t3s.data[i].n1),
-      find_node_index_by_id(&nodes, t3s.data[i].n2),
-      find_node_index_by_id(&nodes, t3s.data[i].n3)
-    };
-    if(idx[0]<0 || idx[1]<0 || idx[2]<0){
-      continue;
-    }
-    const Node *A=&nodes.data[idx[0]];
-    const Node *B=&nodes.data[idx[1]];
-    const Node *C=&nodes.data[idx[2]];
-    const Node poly[3]={*A, *B, *C};
-
-    // 多角形公式（三角形）
-    double area2 = 0.0;
-    double Ix_area = 0.0;
-    double Iy_area = 0.0;
-    double Iz_area = 0.0;
-    for(int k=0;k<3;k++){
-      const Node *P=&poly[k];
-      const Node *Q=&poly[(k+1)%3];
-      double cross = P->x * Q->y - Q->x * P->y;
-      area2 += cross;
-      Ix_area += cross * (P->y*P->y + P->y*Q->y + Q->y*Q->y);
-      Iy_area += cross * (P->x*P->x + P->x*Q->x + Q->x*Q->x);
-      Iz_area += cross * (P->x*P->x + P->x*Q->x + Q->x*Q->x
-                        + P->y*P->y + P->y*Q->y + Q->y*Q->y);
-    }
-
-    const PShell *ps = find_pshell(&pshells, t3s.data[i].pid);
-    double T = (ps && ps->hasT && ps->T>0.0) ? ps->T : 1.0;
-    double rho_gmm3 = (mat_found && mat.hasRho) ? (mat.rho * 1000.0) : 0.0;
-
-    double factor = (1.0/12.0) * T * rho_gmm3; // g
-    Ix_origin += factor * fabs(Ix_area);
-    Iy_origin += factor * fabs(Iy_area);
-    Iz_origin += factor * fabs(Iz_area);
-  }
-
   // COM（質量重み）
-  double cx = (total_mass_g>0.0) ? (cx_mass / total_mass_g) : 0.0;
-  double cy = (total_mass_g>0.0) ? (cy_mass / total_mass_g) : 0.0;
+  double cx = (total_mass_g>0.0) ? (mp.cx_mass / total_mass_g) : 0.0;
+  double cy = (total_mass_g>0.0) ? (mp.cy_mass / total_mass_g) : 0.0;
 
   // 並進軸の定理で COM へ移す
-  double Ix_com = Ix_origin - total_mass_g * (cy * cy);
-  double Iy_com = Iy_origin - total_mass_g * (cx * cx);
-  double Iz_com = Iz_origin - total_mass_g * (cx * cx + cy * cy);
+  double Ix_com = mp.Ix_origin - total_mass_g * (cy * cy);
+  double Iy_com = mp.Iy_origin - total_mass_g * (cx * cx);
+  double Iz_com = mp.Iz_origin - total_mass_g * (cx * cx + cy * cy);
 
   char path_iner[1024];
   snprintf(path_iner, sizeof(path_iner), "%s/%s/material/Inertia.dat", outroot, part);
@@ -1795,15 +1990,7 @@ int main(int argc, char **argv){
     }
   }
 
-  typedef struct {
-    int target_type; /* 1=node, 2=surface, 3=ridgeline */
-    int id;
-    char comp[8];
-    double d;
-  } FixLine;
-  FixLine *fix_lines = NULL;
-  size_t fix_lines_count = 0;
-  size_t fix_lines_cap = 0;
+  FixSet fixes = {0};
 
   for(size_t i=0;i<spcs.size;i++){
     const SPCEntry *s=&spcs.data[i];
@@ -1830,36 +2017,10 @@ int main(int argc, char **argv){
     }else if(strcmp(target, "ridgeline") == 0){
       target_type = 3;
     }
-    int duplicate = 0;
-    for(size_t j=0;j<fix_lines_count;j++){
-      if(fix_lines[j].target_type == target_type &&
-         fix_lines[j].id == tid &&
-         strcmp(fix_lines[j].comp, s->comp) == 0 &&
-         fabs(fix_lines[j].d - s->d) < 1e-12){
-        duplicate = 1;
-        break;
-      }
-    }
-    if(duplicate){
-      continue;
-    }
-    if(fix_lines_count == fix_lines_cap){
-      size_t new_cap = fix_lines_cap ? fix_lines_cap * 2 : 32;
-      FixLine *tmp = (FixLine*)realloc(fix_lines, new_cap * sizeof(FixLine));
-      if(!tmp){
-        perror("realloc");
-        exit(1);
-      }
-      fix_lines = tmp;
-      fix_lines_cap = new_cap;
-    }
-    fix_lines[fix_lines_count].target_type = target_type;
-    fix_lines[fix_lines_count].id = tid;
-    strncpy(fix_lines[fix_lines_count].comp, s->comp, sizeof(fix_lines[fix_lines_count].comp) - 1);
-    fix_lines[fix_lines_count].comp[sizeof(fix_lines[fix_lines_count].comp) - 1] = '\0';
-    fix_lines[fix_lines_count].d = s->d;
-    fix_lines_count++;
+    fixset_add(&fixes, target_type, tid, s->comp, s->d);
   }
+  const FixLine *fix_lines = fixes.lines;
+  size_t fix_lines_count = fixes.size;
   size_t total_bc = fix_lines_count;
   for(size_t i=0;i<forces.size;i++){
     if(forces.data[i].gid>0){
@@ -1937,7 +2098,8 @@ int main(int argc, char **argv){
     }
     fprintf(fbc, "%s %d 123456 %d %.6g\n", target, tid, axis, val);
   }
-  free(fix_lines);
+  free(fixes.lines);
+  free(fixes.slots);
   free(node_surface);
   free(node_ridge);
   if(node_ridges){
@@ -1990,6 +2152,11 @@ int main(int argc, char **argv){
     fclose(flog);
   }
 
+  edgevec_free(&edges);
+  if(fp){
+    fclose(fp);
+  }
+
   fprintf(stdout, "Done: %s\n", path_mesh);
   return 0;
 }
@@ -0,0 +1,242 @@
+/* FEM4C - Adaptive Analysis Implementation
+ * Zienkiewicz-Zhu error estimation with longest-edge refinement
+ */
+
+#include "adaptive.h"
+#include "static.h"
+#include "stress_recovery.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_memory.h"
+#include "../common/fem_thread.h"
+#include "../mesh/mesh_refine.h"
+#include "../solver/assembly.h"
+#include "../solver/mpc.h"
+#include "../solver/skyline_ooc.h"
+#include "../solver/sparse_cholesky.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+adaptive_options_t adaptive_default_options(void)
+{
+    adaptive_options_t options;
+
+    options.target_error = 0.05;
+    options.max_cycles = 8;
+    options.max_dof = 200000;
+    return options;
+}
+
+/* Main adaptive analysis function */
+fem_error_t adaptive_analysis(const char *input_filename, const char *output_filename,
+                              const adaptive_options_t *options)
+{
+    fem_error_t err;
+    clock_t start_time, end_time;
+
+    printf("FEM4C Adaptive Static Analysis\n");
+    printf("==============================\n\n");
+
+    start_time = clock();
+
+    err = static_analysis_initialize();
+    CHECK_ERROR(err);
+
+    err = static_analysis_preprocessing(input_filename);
+    CHECK_ERROR(err);
+
+    /* The mesh changes, so the VTK geometry is written with the results */
+    printf("Phase 3: Adaptive Solution\n");
+    printf("--------------------------\n");
+    err = adaptive_solve(options);
+    CHECK_ERROR(err);
+    printf("  Solution phase completed successfully\n\n");
+
+    err = static_analysis_postprocessing(output_filename);
+    CHECK_ERROR(err);
+
+    err = static_analysis_finalize();
+    CHECK_ERROR(err);
+
+    end_time = clock();
+    g_solver_info.elapsed_time = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
+
+    printf("\nAdaptive Analysis Complete\n");
+    printf("==========================\n");
+    printf("Total elapsed time: %.3f seconds\n", g_solver_info.elapsed_time);
+    fem_memory_report(stdout);
+
+    return FEM_SUCCESS;
+}
+
+/* CG starts from the displacements carried over to the refined mesh; the
+ * constrained rows hold their prescribed values already */
+static void adaptive_start_vector(void)
+{
+    for (int node = 0; node < g_num_nodes; node++) {
+        for (int k = 0; k < 2; k++) {
+            int dof = node * 2 + k;
+            if (dof < g_total_dof && !g_node_bc_flags[node][k]) {
+                g_global_displ[dof] = g_node_displ[node][k];
+            }
+        }
+    }
+}
+
+/* Direct solver of the last solve, NULL when an iterative one ran */
+static const char *adaptive_direct_solver(void)
+{
+    if (sparse_cholesky_active()) {
+        return "sparse Cholesky";
+    }
+    if (skyline_ooc_active()) {
+        return "out-of-core skyline";
+    }
+    return NULL;
+}
+
+/* Elements above the equidistributed error share */
+static int adaptive_flag_elements(const double *element_error, double error_sq,
+                                  double energy_sq, double target, unsigned char *flagged)
+{
+    double share = target * target * (energy_sq + error_sq) / g_num_elements;
+    int count = 0;
+
+    for (int e = 0; e < g_num_elements; e++) {
+        flagged[e] = element_error[e] > share;
+        count += flagged[e];
+    }
+    return count;
+}
+
+fem_error_t adaptive_solve(const adaptive_options_t *options)
+{
+    adaptive_options_t defaults = adaptive_default_options();
+    double *element_error = NULL;
+    unsigned char *flagged = NULL;
+    int total_iterations = 0, iterative_solves = 0;
+    fem_error_t err = FEM_SUCCESS;
+
+    if (!options) {
+        options = &defaults;
+    }
+    if (g_analysis.spatial_dimension != 2) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Adaptive analysis supports plane T3/T6 meshes only");
+    }
+    for (int e = 0; e < g_num_elements; e++) {
+        if (g_element_type[e] != g_element_type[0] ||
+            (g_element_type[e] != ELEMENT_T3 && g_element_type[e] != ELEMENT_T6)) {
+            return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                             "Adaptive analysis supports plane T3/T6 meshes only");
+        }
+    }
+    err = mpc_require_none("Adaptive");
+    CHECK_ERROR(err);
+    if (!(options->target_error > 0.0) || options->max_cycles <= 0) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Invalid adaptive solution options");
+    }
+
+    printf("  Target error: %.2f%%, at most %d cycles\n",
+           100.0 * options->target_error, options->max_cycles);
+
+    for (int cycle = 0; cycle < options->max_cycles; cycle++) {
+        double cycle_start = fem_wall_time();
+        double error_sq = 0.0, energy_sq = 0.0, eta;
+        mesh_refine_result_t refinement;
+        const char *direct;
+        char solver_note[64];
+        int marked;
+
+        err = static_assemble_system();
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        if (cycle > 0) {
+            adaptive_start_vector();
+        }
+        err = static_solve_equations();
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        direct = adaptive_direct_solver();
+        if (!direct) {
+            total_iterations += g_solver_info.iterations;
+            iterative_solves++;
+        }
+
+        err = stress_recovery_compute();
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        fem_free(element_error);
+        fem_free(flagged);
+        element_error = fem_malloc((size_t)g_num_elements * sizeof(double), FEM_MEMORY_VECTOR);
+        flagged = fem_malloc((size_t)g_num_elements, FEM_MEMORY_VECTOR);
+        if (!element_error || !flagged) {
+            err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate error indicators");
+            break;
+        }
+        err = stress_recovery_error_estimate(element_error, &error_sq, &energy_sq);
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        eta = energy_sq + error_sq > 0.0 ? sqrt(error_sq / (energy_sq + error_sq)) : 0.0;
+
+        if (direct) {
+            snprintf(solver_note, sizeof(solver_note), "%s", direct);
+        } else {
+            snprintf(solver_note, sizeof(solver_note), "%d CG iterations",
+                     g_solver_info.iterations);
+        }
+        printf("  Cycle %d: %d elements, %d DOF, %s, estimated error %.2f%% (%.3f s)\n",
+               cycle + 1, g_num_elements, g_total_dof, solver_note, 100.0 * eta,
+               fem_wall_time() - cycle_start);
+
+        if (eta <= options->target_error) {
+            printf("  Target error reached\n");
+            break;
+        }
+        if (cycle + 1 == options->max_cycles) {
+            printf("  Warning: target error not reached in %d cycles\n", options->max_cycles);
+            break;
+        }
+        if (g_total_dof >= options->max_dof) {
+            printf("  Warning: DOF limit %d reached, refinement stopped\n", options->max_dof);
+            break;
+        }
+        marked = adaptive_flag_elements(element_error, error_sq, energy_sq,
+                                        options->target_error, flagged);
+        if (marked == 0) {
+            printf("  No element above its error share, refinement stopped\n");
+            break;
+        }
+
+        err = mesh_refine_triangles(flagged, &refinement);
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        printf("    Refined %d flagged elements (%d split): +%d elements, +%d nodes\n",
+               marked, refinement.refined_elements, refinement.new_elements,
+               refinement.new_nodes);
+        err = assembly_grow_stiffness_profile(g_num_nodes * 2, refinement.node_map,
+                                              refinement.old_nodes,
+                                              refinement.changed_elements,
+                                              refinement.changed_count);
+        mesh_refine_result_free(&refinement);
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+    }
+
+    fem_free(element_error);
+    fem_free(flagged);
+    CHECK_ERROR(err);
+    if (iterative_solves > 0) {
+        printf("  Total CG iterations: %d\n", total_iterations);
+    }
+    return FEM_SUCCESS;
+}
@@ -0,0 +1,41 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Adaptive mesh refinement for linear statics
+ *
+ * Solve - estimate - refine cycles on a T3 or T6 mesh. After each solve
+ * the stresses are recovered by SPR and the Zienkiewicz-Zhu estimate
+ * (stress_recovery.h) gives the energy-norm error of every element. The
+ * relative error is eta = |e| / sqrt(|u|^2 + |e|^2); while it is above the
+ * target, the elements whose error exceeds the equidistributed share
+ * target * sqrt((|u|^2 + |e|^2) / elements) are bisected (mesh_refine.h)
+ * and the model is solved again.
+ *
+ * The refined mesh keeps the old node numbering, so the skyline column
+ * tops of the old DOFs are reused and only the changed elements are
+ * scanned for the new columns. CG starts from the previous solution
+ * interpolated onto the new nodes instead of from zero.
+ *
+ * Every cycle reports elements, DOFs, CG iterations and the estimated
+ * error; the result files hold the final mesh and solution.
+ */
+
+#include "../common/types.h"
+
+typedef struct {
+    double target_error;        /* relative energy-norm error to reach */
+    int max_cycles;             /* solves, including the first */
+    int max_dof;                /* no refinement beyond this many DOFs */
+} adaptive_options_t;
+
+adaptive_options_t adaptive_default_options(void);
+
+/* Complete analysis: read input_filename, adapt, write the results */
+fem_error_t adaptive_analysis(const char *input_filename, const char *output_filename,
+                              const adaptive_options_t *options);
+
+/* Adaptive cycles on a model that has been read and validated */
+fem_error_t adaptive_solve(const adaptive_options_t *options);
+
+#endif /* ADAPTIVE_H */
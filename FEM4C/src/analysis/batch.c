@@ -0,0 +1,459 @@
+/* FEM4C - Batch analysis runner implementation
+ * Workers pull jobs from a shared queue. A job runs the static analysis
+ * phases on the worker's context and joins its result writers, but does
+ * not finalize: the next job's globals_initialize() resets the model and
+ * keeps the allocations.
+ */
+
+/* fileno/dup/fdopen and sysconf */
+#define _POSIX_C_SOURCE 200112L
+
+#include "batch.h"
+#include "static.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_context.h"
+#include "../common/fem_memory.h"
+#include "../common/fem_thread.h"
+#include "../io/async_output.h"
+#include "../solver/skyline_ooc.h"
+#include "../solver/sparse_cholesky.h"
+#include "../solver/krylov_recycle.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define batch_fileno _fileno
+#define batch_dup _dup
+#define batch_close _close
+#define batch_dup2 _dup2
+#define batch_fdopen _fdopen
+#else
+#include <unistd.h>
+#define batch_fileno fileno
+#define batch_dup dup
+#define batch_close close
+#define batch_dup2 dup2
+#define batch_fdopen fdopen
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define BATCH_LINE_LEN (2 * MAX_FILENAME_LEN + 64)
+
+/* Guards the job queue and the console of the running batch */
+static fem_mutex_t g_batch_mutex = FEM_MUTEX_INITIALIZER;
+
+typedef struct {
+    char input[MAX_FILENAME_LEN];
+    char output[MAX_FILENAME_LEN];
+    int line_number;            /* Line in the job file */
+    int worker;
+    fem_error_t status;
+    char message[ERROR_MSG_LEN];
+    int num_nodes;
+    int num_elements;
+    int total_dof;
+    int iterations;
+    double residual;
+    double preprocessing_time;  /* Wall-clock seconds per phase */
+    double solution_time;
+    double postprocessing_time;
+    double total_time;
+} batch_job_t;
+
+typedef struct {
+    batch_job_t *jobs;
+    int num_jobs;
+    int next_job;
+    int completed;
+    int failed;
+    int count_width;            /* Digits of num_jobs */
+    FILE *console;              /* Progress lines (stdout goes to the log) */
+} batch_queue_t;
+
+typedef struct {
+    batch_queue_t *queue;
+    fem_context_t *context;
+    fem_thread_t thread;
+    int index;
+    int started;
+} batch_worker_t;
+
+static int batch_default_workers(void)
+{
+#ifdef _OPENMP
+    return omp_get_num_procs();
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+#else
+    return 1;
+#endif
+}
+
+/* <input stem>_results.dat next to the input */
+static void batch_default_output(char *dest, const char *input)
+{
+    char stem[MAX_FILENAME_LEN];
+    char *slash;
+    char *dot;
+    size_t length;
+
+    strncpy(stem, input, MAX_FILENAME_LEN - 1);
+    stem[MAX_FILENAME_LEN - 1] = '\0';
+    length = strlen(stem);
+    while (length > 1 && (stem[length - 1] == '/' || stem[length - 1] == '\\')) {
+        stem[--length] = '\0';
+    }
+    slash = strrchr(stem, '/');
+    if (strrchr(stem, '\\') > slash) {
+        slash = strrchr(stem, '\\');
+    }
+    dot = strrchr(stem, '.');
+    if (dot && (slash == NULL || dot > slash + 1)) {
+        *dot = '\0';
+    }
+    snprintf(dest, MAX_FILENAME_LEN, "%.*s_results.dat", MAX_FILENAME_LEN - 16, stem);
+}
+
+static fem_error_t batch_read_jobs(const char *job_list, batch_job_t **jobs_out, int *count_out)
+{
+    FILE *fp;
+    char line[BATCH_LINE_LEN];
+    char format[32];
+    batch_job_t *jobs = NULL;
+    int count = 0;
+    int capacity = 0;
+    int line_number = 0;
+
+    fp = fopen(job_list, "r");
+    CHECK_FILE(fp, job_list);
+
+    snprintf(format, sizeof(format), "%%%ds %%%ds", MAX_FILENAME_LEN - 1, MAX_FILENAME_LEN - 1);
+    while (fgets(line, sizeof(line), fp)) {
+        char input[MAX_FILENAME_LEN];
+        char output[MAX_FILENAME_LEN];
+        int fields;
+
+        line_number++;
+        fields = sscanf(line, format, input, output);
+        if (fields < 1 || input[0] == '#') {
+            continue;
+        }
+
+        if (count == capacity) {
+            int new_capacity = capacity > 0 ? 2 * capacity : 64;
+            batch_job_t *grown = (batch_job_t *)realloc(jobs, (size_t)new_capacity * sizeof(batch_job_t));
+            if (!grown) {
+                free(jobs);
+                fclose(fp);
+                return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate batch job list");
+            }
+            jobs = grown;
+            capacity = new_capacity;
+        }
+
+        batch_job_t *job = &jobs[count++];
+        memset(job, 0, sizeof(*job));
+        strcpy(job->input, input);
+        if (fields >= 2 && output[0] != '#') {
+            strcpy(job->output, output);
+        } else {
+            batch_default_output(job->output, input);
+        }
+        job->line_number = line_number;
+        job->worker = -1;
+    }
+    fclose(fp);
+
+    if (count == 0) {
+        free(jobs);
+        return error_set(FEM_ERROR_INVALID_INPUT, "No jobs in batch file: %s", job_list);
+    }
+
+    *jobs_out = jobs;
+    *count_out = count;
+    return FEM_SUCCESS;
+}
+
+/* Run one job on the calling thread's context */
+static void batch_run_job(batch_job_t *job)
+{
+    fem_error_t err;
+    fem_error_t output_err;
+    double start = fem_wall_time();
+    double phase_start;
+
+    error_clear();
+    printf("\n[batch] Job %s -> %s\n", job->input, job->output);
+
+    err = static_analysis_initialize();
+    if (err == FEM_SUCCESS) {
+        phase_start = fem_wall_time();
+        err = static_analysis_preprocessing(job->input);
+        job->preprocessing_time = fem_wall_time() - phase_start;
+        job->num_nodes = g_num_nodes;
+        job->num_elements = g_num_elements;
+        job->total_dof = g_total_dof;
+    }
+    if (err == FEM_SUCCESS) {
+        phase_start = fem_wall_time();
+        err = static_analysis_solve();
+        job->solution_time = fem_wall_time() - phase_start;
+        job->iterations = g_solver_info.iterations;
+        job->residual = g_solver_info.residual;
+    }
+    if (err == FEM_SUCCESS) {
+        phase_start = fem_wall_time();
+        err = static_analysis_postprocessing(job->output);
+    }
+
+    /* Writers read the model, so join them before the next job resets it */
+    if (err == FEM_SUCCESS) {
+        output_err = async_output_join();
+        job->postprocessing_time = fem_wall_time() - phase_start;
+        err = output_err;
+    } else {
+        async_output_cancel();
+    }
+    skyline_ooc_release();
+    sparse_cholesky_release();
+
+    job->total_time = fem_wall_time() - start;
+    job->status = err;
+    if (err != FEM_SUCCESS) {
+        const char *message = error_get_last() == err ? error_get_message() : error_get_string(err);
+        strncpy(job->message, message, ERROR_MSG_LEN - 1);
+        job->message[ERROR_MSG_LEN - 1] = '\0';
+    }
+}
+
+static void *batch_worker_run(void *arg)
+{
+    batch_worker_t *worker = (batch_worker_t *)arg;
+    batch_queue_t *queue = worker->queue;
+
+    fem_context_bind(worker->context);
+#ifdef _OPENMP
+    /* Jobs already run side by side; keep each one on its worker thread */
+    omp_set_num_threads(1);
+#endif
+
+    for (;;) {
+        batch_job_t *job;
+        int index;
+
+        fem_mutex_lock(&g_batch_mutex);
+        index = queue->next_job < queue->num_jobs ? queue->next_job++ : -1;
+        fem_mutex_unlock(&g_batch_mutex);
+        if (index < 0) {
+            break;
+        }
+
+        job = &queue->jobs[index];
+        job->worker = worker->index;
+        batch_run_job(job);
+
+        fem_mutex_lock(&g_batch_mutex);
+        queue->completed++;
+        if (job->status != FEM_SUCCESS) {
+            queue->failed++;
+        }
+        fprintf(queue->console, "  [%*d/%d] %-6s %9.3f s  %s\n",
+                queue->count_width, queue->completed, queue->num_jobs,
+                job->status == FEM_SUCCESS ? "ok" : "FAILED", job->total_time, job->input);
+        fflush(queue->console);
+        fem_mutex_unlock(&g_batch_mutex);
+    }
+
+    /* The recycle space is carried from job to job on this worker */
+    krylov_recycle_release();
+    fem_context_bind(NULL);
+    return NULL;
+}
+
+static fem_error_t batch_write_summary(const char *filename, const char *job_list,
+                                       const batch_queue_t *queue, int num_workers,
+                                       double wall_time)
+{
+    FILE *fp = fopen(filename, "w");
+    double busy_time = 0.0;
+
+    if (!fp) {
+        return error_set(FEM_ERROR_FILE_WRITE, "Cannot create batch summary: %s", filename);
+    }
+    for (int i = 0; i < queue->num_jobs; ++i) {
+        busy_time += queue->jobs[i].total_time;
+    }
+
+    fprintf(fp, "# FEM4C batch summary\n");
+    fprintf(fp, "# Job file: %s\n", job_list);
+    fprintf(fp, "# Jobs: %d  Failed: %d  Workers: %d\n", queue->num_jobs, queue->failed, num_workers);
+    fprintf(fp, "# Wall time: %.3f s  Sum of job times: %.3f s  Mean job time: %.6f s\n",
+            wall_time, busy_time, busy_time / queue->num_jobs);
+    fprintf(fp, "# Peak memory: %.3f MB (process-wide, all workers)\n",
+            (double)fem_memory_peak(FEM_MEMORY_CATEGORY_COUNT) / (1024.0 * 1024.0));
+    fprintf(fp, "# Phase times are wall-clock seconds; output includes joining the result writers\n");
+    fprintf(fp, "%6s %-6s %6s %9s %9s %9s %6s %12s %10s %10s %10s %10s  %s\n",
+            "job", "status", "worker", "nodes", "elements", "dof", "iter", "residual",
+            "read_s", "solve_s", "output_s", "total_s", "input -> output");
+    for (int i = 0; i < queue->num_jobs; ++i) {
+        const batch_job_t *job = &queue->jobs[i];
+        fprintf(fp, "%6d %-6s %6d %9d %9d %9d %6d %12.4e %10.6f %10.6f %10.6f %10.6f  %s -> %s\n",
+                i + 1, job->status == FEM_SUCCESS ? "ok" : "FAILED", job->worker,
+                job->num_nodes, job->num_elements, job->total_dof, job->iterations, job->residual,
+                job->preprocessing_time, job->solution_time, job->postprocessing_time,
+                job->total_time, job->input, job->output);
+    }
+
+    if (queue->failed > 0) {
+        fprintf(fp, "\n# Failures\n");
+        for (int i = 0; i < queue->num_jobs; ++i) {
+            const batch_job_t *job = &queue->jobs[i];
+            if (job->status != FEM_SUCCESS) {
+                fprintf(fp, "job %d (line %d): error %d: %s\n",
+                        i + 1, job->line_number, job->status, job->message);
+            }
+        }
+    }
+
+    if (fclose(fp) != 0) {
+        return error_set(FEM_ERROR_FILE_WRITE, "Failed to write batch summary: %s", filename);
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t batch_run(const char *job_list, int num_workers)
+{
+    fem_error_t err;
+    batch_queue_t queue;
+    batch_worker_t *workers;
+    char log_filename[MAX_FILENAME_LEN + 8];
+    char summary_filename[MAX_FILENAME_LEN + 8];
+    int console_fd;
+    int stderr_fd;
+    FILE *log;
+    double start_time;
+    double wall_time;
+
+    memset(&queue, 0, sizeof(queue));
+    err = batch_read_jobs(job_list, &queue.jobs, &queue.num_jobs);
+    CHECK_ERROR(err);
+
+    if (num_workers <= 0) {
+        num_workers = batch_default_workers();
+    }
+    if (num_workers > queue.num_jobs) {
+        num_workers = queue.num_jobs;
+    }
+
+    workers = (batch_worker_t *)calloc((size_t)num_workers, sizeof(batch_worker_t));
+    if (!workers) {
+        free(queue.jobs);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate batch workers");
+    }
+    for (int w = 0; w < num_workers; ++w) {
+        workers[w].queue = &queue;
+        workers[w].index = w;
+        workers[w].context = fem_context_create();
+        if (!workers[w].context) {
+            for (int i = 0; i < w; ++i) {
+                fem_context_destroy(workers[i].context);
+            }
+            free(workers);
+            free(queue.jobs);
+            return FEM_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+
+    snprintf(log_filename, sizeof(log_filename), "%s.log", job_list);
+    snprintf(summary_filename, sizeof(summary_filename), "%s.summary", job_list);
+    printf("Batch file:  %s (%d jobs, %d workers)\n", job_list, queue.num_jobs, num_workers);
+    printf("Analysis log: %s\n\n", log_filename);
+
+    /* Keep a console stream for progress lines and send everything the
+     * analyses print to stdout or stderr to the log */
+    fflush(stdout);
+    fflush(stderr);
+    log = fopen(log_filename, "w");
+    console_fd = batch_dup(batch_fileno(stdout));
+    stderr_fd = batch_dup(batch_fileno(stderr));
+    queue.console = console_fd >= 0 ? batch_fdopen(console_fd, "w") : NULL;
+    if (!log || !queue.console || stderr_fd < 0) {
+        if (log) {
+            fclose(log);
+        }
+        if (queue.console) {
+            fclose(queue.console);
+        } else if (console_fd >= 0) {
+            batch_close(console_fd);
+        }
+        if (stderr_fd >= 0) {
+            batch_close(stderr_fd);
+        }
+        for (int w = 0; w < num_workers; ++w) {
+            fem_context_destroy(workers[w].context);
+        }
+        free(workers);
+        free(queue.jobs);
+        return error_set(FEM_ERROR_FILE_WRITE, "Cannot redirect analysis output to %s", log_filename);
+    }
+    batch_dup2(batch_fileno(log), batch_fileno(stdout));
+    batch_dup2(batch_fileno(log), batch_fileno(stderr));
+    fclose(log);
+    queue.count_width = snprintf(NULL, 0, "%d", queue.num_jobs);
+
+    start_time = fem_wall_time();
+    for (int w = 0; w < num_workers; ++w) {
+        workers[w].started = fem_thread_create(&workers[w].thread, batch_worker_run, &workers[w]) == FEM_SUCCESS;
+        if (!workers[w].started) {
+            /* Remaining jobs go to the workers that did start */
+            fprintf(queue.console, "  Warning: batch worker %d could not be started\n", w);
+        }
+    }
+    for (int w = 0; w < num_workers; ++w) {
+        if (workers[w].started) {
+            fem_thread_join(&workers[w].thread, NULL);
+        }
+    }
+    if (queue.completed < queue.num_jobs) {
+        /* No worker thread could be started: run the rest here */
+        batch_worker_run(&workers[0]);
+    }
+    wall_time = fem_wall_time() - start_time;
+
+    /* Restore stdout and stderr */
+    fflush(stdout);
+    fflush(stderr);
+    fflush(queue.console);
+    batch_dup2(console_fd, batch_fileno(stdout));
+    batch_dup2(stderr_fd, batch_fileno(stderr));
+    batch_close(stderr_fd);
+    fclose(queue.console);
+
+    for (int w = 0; w < num_workers; ++w) {
+        fem_context_destroy(workers[w].context);
+    }
+    free(workers);
+
+    err = batch_write_summary(summary_filename, job_list, &queue, num_workers, wall_time);
+    if (err == FEM_SUCCESS) {
+        printf("\nBatch complete: %d jobs, %d failed, %.3f s wall time\n",
+               queue.num_jobs, queue.failed, wall_time);
+        printf("Summary: %s\n\n", summary_filename);
+        fem_memory_report(stdout);
+        if (queue.failed > 0) {
+            err = error_set(FEM_ERROR_INVALID_INPUT, "%d of %d batch jobs failed (see %s)",
+                            queue.failed, queue.num_jobs, summary_filename);
+        }
+    }
+
+    free(queue.jobs);
+    return err;
+}
@@ -0,0 +1,27 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Batch analysis runner
+ *
+ * Runs the static analyses listed in a job file on a fixed pool of worker
+ * threads. Each worker keeps one analysis context for the whole batch, so
+ * the mesh arrays and ID maps grown by one job are reused by the next.
+ *
+ * Job file: one job per line, "input [output]". Blank lines and lines
+ * starting with '#' are ignored. Without an output name, results go to
+ * <input stem>_results.dat. Paths are relative to the working directory.
+ *
+ * What the analyses print (stdout and stderr) is collected in
+ * <job file>.log; the console shows one progress line per job. A table
+ * of per-job timings and solver statistics is written to
+ * <job file>.summary.
+ */
+
+#include "../common/types.h"
+
+/* Run every job in job_list on num_workers threads (<= 0: one per CPU).
+ * Fails if the job file cannot be read or any job failed. */
+fem_error_t batch_run(const char *job_list, int num_workers);
+
+#endif /* BATCH_H */
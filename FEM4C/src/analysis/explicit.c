@@ -0,0 +1,585 @@
+/* FEM4C - Explicit Analysis Implementation
+ * Central difference time integration with lumped mass
+ */
+
+#include "explicit.h"
+#include "static.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_memory.h"
+#include "../common/fem_thread.h"
+#include "../io/async_output.h"
+#include "../io/time_history.h"
+#include "../solver/assembly.h"
+#include "../solver/mpc.h"
+#include "../elements/element_explicit.h"
+#include "../elements/element_mass.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Progress lines printed over a run */
+#define EXPLICIT_REPORT_LINES 10
+/* History frames written by default */
+#define EXPLICIT_DEFAULT_FRAMES 200
+/* Fraction of the critical time step used by default */
+#define EXPLICIT_DT_SCALE 0.9
+/* Smaller models step on one thread: a step is too short to share */
+#define EXPLICIT_PARALLEL_MIN_BATCHES 16
+/* Force slots of one batch */
+#define EXPLICIT_FORCE_SIZE (2 * ELEMENT_EXPLICIT_MAX_NODES * ELEMENT_EXPLICIT_BATCH)
+
+typedef struct {
+    int n;
+    int batches;
+    element_explicit_batch_t *batch;
+    double *force;              /* EXPLICIT_FORCE_SIZE per batch */
+    fem_index_t *slot_start;    /* node -> x slots in force (CSR) */
+    fem_index_t *slot;
+    double *node_mass, *inv_mass;
+    double *f_ext, *prescribed;
+    unsigned char *constrained;
+    double *u, *v;
+} explicit_work_t;
+
+explicit_options_t explicit_default_options(void)
+{
+    explicit_options_t options;
+
+    options.end_time = 0.0;
+    options.dt = 0.0;
+    options.hourglass = 0.05;
+    options.mass_damping = 0.0;
+    options.ramp_time = 0.0;
+    options.output_interval = 0;
+    return options;
+}
+
+/* Main explicit analysis function */
+fem_error_t explicit_analysis(const char *input_filename, const char *output_filename,
+                              const explicit_options_t *options)
+{
+    fem_error_t err;
+    clock_t start_time, end_time;
+    char vtk_filename[MAX_FILENAME_LEN];
+    char history_filename[MAX_FILENAME_LEN];
+
+    printf("FEM4C Explicit Dynamics\n");
+    printf("=======================\n\n");
+
+    start_time = clock();
+
+    err = static_analysis_initialize();
+    CHECK_ERROR(err);
+
+    err = static_analysis_preprocessing(input_filename);
+    CHECK_ERROR(err);
+
+    static_result_filename(vtk_filename, output_filename, ".vtk");
+    if (async_output_begin_geometry(vtk_filename) != FEM_SUCCESS) {
+        printf("  Warning: VTK geometry could not be started early\n");
+    }
+
+    printf("Phase 3: Time Integration\n");
+    printf("-------------------------\n");
+    static_result_filename(history_filename, output_filename, ".hist");
+    err = explicit_solve(options, history_filename);
+    CHECK_ERROR_CLEANUP(err, async_output_cancel());
+    printf("  Solution phase completed successfully\n\n");
+
+    /* Stresses and result files of the final state */
+    err = static_analysis_postprocessing(output_filename);
+    CHECK_ERROR_CLEANUP(err, async_output_cancel());
+
+    err = static_analysis_finalize();
+    CHECK_ERROR(err);
+
+    end_time = clock();
+    g_solver_info.elapsed_time = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
+
+    printf("\nExplicit Analysis Complete\n");
+    printf("==========================\n");
+    printf("Total elapsed time: %.3f seconds\n", g_solver_info.elapsed_time);
+    fem_memory_report(stdout);
+
+    return FEM_SUCCESS;
+}
+
+static void explicit_free_work(explicit_work_t *w)
+{
+    fem_free(w->batch);
+    fem_free(w->force);
+    fem_free(w->slot_start);
+    fem_free(w->slot);
+    fem_free(w->node_mass);
+    fem_free(w->inv_mass);
+    fem_free(w->f_ext);
+    fem_free(w->prescribed);
+    fem_free(w->constrained);
+    fem_free(w->u);
+    fem_free(w->v);
+    memset(w, 0, sizeof(*w));
+}
+
+/* Batches of one element type each, in element order within a type */
+static fem_error_t explicit_build_batches(explicit_work_t *w, double hourglass, double *dt_stable)
+{
+    static const int types[2] = {ELEMENT_T3, ELEMENT_Q4};
+    int *list;
+    int batches = 0;
+    fem_error_t err = FEM_SUCCESS;
+
+    for (int e = 0; e < g_num_elements; e++) {
+        if (g_element_type[e] != ELEMENT_T3 && g_element_type[e] != ELEMENT_Q4) {
+            return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                             "Explicit dynamics supports T3 and Q4 elements (element %d is type %d)",
+                             e + 1, g_element_type[e]);
+        }
+    }
+
+    list = fem_malloc((size_t)(g_num_elements > 0 ? g_num_elements : 1) * sizeof(int),
+                      FEM_MEMORY_MESH);
+    w->batch = fem_malloc((size_t)(g_num_elements / ELEMENT_EXPLICIT_BATCH + 2) *
+                          sizeof(element_explicit_batch_t), FEM_MEMORY_MESH);
+    if (!list || !w->batch) {
+        fem_free(list);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Explicit batch allocation failed");
+    }
+
+    *dt_stable = HUGE_VAL;
+    for (int t = 0; t < 2 && err == FEM_SUCCESS; t++) {
+        int count = 0;
+        for (int e = 0; e < g_num_elements; e++) {
+            if (g_element_type[e] == types[t]) {
+                list[count++] = e;
+            }
+        }
+        for (int first = 0; first < count; first += ELEMENT_EXPLICIT_BATCH) {
+            int size = count - first < ELEMENT_EXPLICIT_BATCH ? count - first
+                                                               : ELEMENT_EXPLICIT_BATCH;
+            double dt;
+
+            err = element_explicit_prepare(types[t], list + first, size, hourglass,
+                                           &w->batch[batches], &dt);
+            if (err != FEM_SUCCESS) {
+                break;
+            }
+            if (dt < *dt_stable) {
+                *dt_stable = dt;
+            }
+            batches++;
+        }
+    }
+    fem_free(list);
+    w->batches = batches;
+    return err;
+}
+
+/* Node -> force slot table. Every used (node, lane) pair of a batch owns
+ * its slot, so the kernels never write to the same place. */
+static fem_error_t explicit_build_slots(explicit_work_t *w)
+{
+    fem_index_t *fill;
+    int nn = g_num_nodes;
+
+    w->force = fem_calloc((size_t)(w->batches > 0 ? w->batches : 1) * EXPLICIT_FORCE_SIZE,
+                          sizeof(double), FEM_MEMORY_VECTOR);
+    w->slot_start = fem_calloc((size_t)nn + 1, sizeof(fem_index_t), FEM_MEMORY_MESH);
+    fill = fem_malloc((size_t)(nn > 0 ? nn : 1) * sizeof(fem_index_t), FEM_MEMORY_MESH);
+    if (!w->force || !w->slot_start || !fill) {
+        fem_free(fill);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Explicit force slot allocation failed");
+    }
+
+    for (int b = 0; b < w->batches; b++) {
+        const element_explicit_batch_t *batch = &w->batch[b];
+        int nodes = batch->element_type == ELEMENT_Q4 ? 4 : 3;
+        for (int a = 0; a < nodes; a++) {
+            for (int e = 0; e < batch->count; e++) {
+                w->slot_start[batch->node[a][e] + 1]++;
+            }
+        }
+    }
+    for (int node = 0; node < nn; node++) {
+        w->slot_start[node + 1] += w->slot_start[node];
+        fill[node] = w->slot_start[node];
+    }
+
+    w->slot = fem_malloc((size_t)(w->slot_start[nn] > 0 ? w->slot_start[nn] : 1) *
+                         sizeof(fem_index_t), FEM_MEMORY_MESH);
+    if (!w->slot) {
+        fem_free(fill);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Explicit force slot allocation failed");
+    }
+    for (int b = 0; b < w->batches; b++) {
+        const element_explicit_batch_t *batch = &w->batch[b];
+        int nodes = batch->element_type == ELEMENT_Q4 ? 4 : 3;
+        fem_index_t base = (fem_index_t)b * EXPLICIT_FORCE_SIZE;
+        for (int a = 0; a < nodes; a++) {
+            for (int e = 0; e < batch->count; e++) {
+                int node = batch->node[a][e];
+                w->slot[fill[node]++] = base + ELEMENT_EXPLICIT_FORCE_INDEX(a, 0, e);
+            }
+        }
+    }
+    fem_free(fill);
+    return FEM_SUCCESS;
+}
+
+/* Lumped mass per node; nodes without mass (unconnected) do not move */
+static fem_error_t explicit_lump_mass(explicit_work_t *w)
+{
+    double node_mass[ELEMENT_MASS_MAX_NODES];
+    int nodes;
+    fem_error_t err;
+
+    for (int e = 0; e < g_num_elements; e++) {
+        err = element_mass_lumped(e, node_mass, &nodes);
+        CHECK_ERROR(err);
+        for (int a = 0; a < nodes; a++) {
+            w->node_mass[g_element_nodes[e][a]] += node_mass[a];
+        }
+    }
+    for (int node = 0; node < g_num_nodes; node++) {
+        w->inv_mass[node] = w->node_mass[node] > 0.0 ? 1.0 / w->node_mass[node] : 0.0;
+    }
+    return FEM_SUCCESS;
+}
+
+static fem_error_t explicit_allocate_work(explicit_work_t *w)
+{
+    size_t n = (size_t)(g_total_dof > 0 ? g_total_dof : 1);
+    size_t nn = (size_t)(g_num_nodes > 0 ? g_num_nodes : 1);
+
+    w->n = g_total_dof;
+    w->node_mass = fem_calloc(nn, sizeof(double), FEM_MEMORY_VECTOR);
+    w->inv_mass = fem_malloc(nn * sizeof(double), FEM_MEMORY_VECTOR);
+    w->f_ext = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->prescribed = fem_calloc(n, sizeof(double), FEM_MEMORY_VECTOR);
+    w->constrained = fem_calloc(n, 1, FEM_MEMORY_VECTOR);
+    w->u = fem_calloc(n, sizeof(double), FEM_MEMORY_VECTOR);
+    w->v = fem_calloc(n, sizeof(double), FEM_MEMORY_VECTOR);
+
+    if (!w->node_mass || !w->inv_mass || !w->f_ext || !w->prescribed || !w->constrained ||
+        !w->u || !w->v) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Explicit work array allocation failed");
+    }
+    return FEM_SUCCESS;
+}
+
+static double explicit_load_factor(const explicit_options_t *options, double time)
+{
+    if (options->ramp_time > 0.0 && time < options->ramp_time) {
+        return time / options->ramp_time;
+    }
+    return 1.0;
+}
+
+/* Internal force at a node: sum of its slots in table order */
+static inline void explicit_gather(const explicit_work_t *w, int node, double *fx, double *fy)
+{
+    double sx = 0.0, sy = 0.0;
+
+    for (fem_index_t s = w->slot_start[node]; s < w->slot_start[node + 1]; s++) {
+        const double *f = w->force + w->slot[s];
+        sx += f[0];
+        sy += f[ELEMENT_EXPLICIT_BATCH];
+    }
+    *fx = sx;
+    *fy = sy;
+}
+
+/* Energies at the state of the last kernel pass; returns max |u| */
+static double explicit_energies(const explicit_work_t *w, double *kinetic, double *strain)
+{
+    double ek = 0.0, es = 0.0, max_u = 0.0;
+
+    for (int node = 0; node < g_num_nodes; node++) {
+        const double *u = w->u + 2 * node;
+        const double *v = w->v + 2 * node;
+        double fx, fy;
+
+        explicit_gather(w, node, &fx, &fy);
+        ek += w->node_mass[node] * (v[0] * v[0] + v[1] * v[1]);
+        es += u[0] * fx + u[1] * fy;
+        double m = sqrt(u[0] * u[0] + u[1] * u[1]);
+        if (m > max_u) max_u = m;
+    }
+    *kinetic = 0.5 * ek;
+    *strain = 0.5 * es;
+    return max_u;
+}
+
+static void explicit_store_results(const explicit_work_t *w, double g)
+{
+    double sum[2] = {0.0, 0.0};
+    int count = 0;
+
+    memcpy(g_global_displ, w->u, (size_t)w->n * sizeof(double));
+    memset(g_node_reaction, 0, (size_t)g_num_nodes * sizeof(*g_node_reaction));
+    for (int node = 0; node < g_num_nodes; node++) {
+        double f[2];
+
+        g_node_displ[node][0] = w->u[node * 2];
+        g_node_displ[node][1] = w->u[node * 2 + 1];
+
+        /* Constrained DOFs do not accelerate: R = f_int - f */
+        explicit_gather(w, node, &f[0], &f[1]);
+        for (int k = 0; k < 2; k++) {
+            int dof = node * 2 + k;
+            if (dof < w->n && w->constrained[dof]) {
+                double reaction = f[k] - g * w->f_ext[dof];
+                g_node_reaction[node][k] = reaction;
+                sum[k] += reaction;
+                count++;
+            }
+        }
+    }
+    g_reactions_current = 1;
+
+    printf("    Reaction sum at t end: RX = %e, RY = %e (%d constrained DOFs)\n",
+           sum[0], sum[1], count);
+}
+
+fem_error_t explicit_solve(const explicit_options_t *options, const char *history_filename)
+{
+    explicit_work_t w;
+    FILE *history = NULL;
+    fem_context_t *model = g_fem_context;
+    fem_error_t failure = FEM_SUCCESS;
+    char message[ERROR_MSG_LEN] = "";
+    double dt, dt_stable = HUGE_VAL, damping;
+    double time_setup, time_kernel = 0.0, time_update = 0.0, time_output = 0.0;
+    double start, run_start, stepping, mark = 0.0, g_end;
+    int steps, interval, report, frames = 0, stop = 0;
+    fem_error_t err;
+
+    if (!options || !(options->end_time > 0.0) || options->dt < 0.0 || options->hourglass < 0.0) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Explicit analysis needs end time > 0, dt >= 0 and hourglass >= 0");
+    }
+    if (g_analysis.spatial_dimension != 2) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Explicit analysis supports plane models (T3, Q4) only");
+    }
+    err = mpc_require_none("Explicit");
+    CHECK_ERROR(err);
+
+    memset(&w, 0, sizeof(w));
+    start = fem_wall_time();
+    /* Force and displacement vectors only: no stiffness profile */
+    err = globals_allocate_system_arrays(g_total_dof > 0 ? g_total_dof : g_num_nodes * 2);
+    CHECK_ERROR(err);
+    printf("  Setting up element batches and lumped mass...\n");
+    err = explicit_build_batches(&w, options->hourglass, &dt_stable);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+    err = explicit_build_slots(&w);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+    err = explicit_allocate_work(&w);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+    err = explicit_lump_mass(&w);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+    if (!g_node_reaction) {
+        g_node_reaction = fem_calloc((size_t)(g_num_nodes > 0 ? g_num_nodes : 1),
+                                     sizeof(*g_node_reaction), FEM_MEMORY_VECTOR);
+        if (!g_node_reaction) {
+            err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate reactions");
+            goto cleanup;
+        }
+    }
+
+    err = assembly_global_force_vector();
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+    memcpy(w.f_ext, g_global_force, (size_t)w.n * sizeof(double));
+    for (int node = 0; node < g_num_nodes; node++) {
+        for (int k = 0; k < 2; k++) {
+            int dof = node * 2 + k;
+            if (g_node_bc_flags[node][k] == 1 && dof < w.n) {
+                w.constrained[dof] = 1;
+                w.prescribed[dof] = g_node_displ[node][k];
+            }
+        }
+    }
+    time_setup = fem_wall_time() - start;
+
+    if (!(dt_stable < HUGE_VAL)) {
+        err = error_set(FEM_ERROR_INVALID_MATERIAL, "No element has a positive density");
+        goto cleanup;
+    }
+    dt = options->dt > 0.0 ? options->dt : EXPLICIT_DT_SCALE * dt_stable;
+    if (dt > dt_stable) {
+        printf("  Warning: dt = %e exceeds the critical estimate %e\n", dt, dt_stable);
+    }
+    steps = (int)ceil(options->end_time / dt - 1.0e-9);
+    if (steps < 1) steps = 1;
+    damping = options->mass_damping;
+    interval = options->output_interval > 0 ? options->output_interval
+                                            : (steps + EXPLICIT_DEFAULT_FRAMES - 1) /
+                                              EXPLICIT_DEFAULT_FRAMES;
+    report = steps > EXPLICIT_REPORT_LINES ? steps / EXPLICIT_REPORT_LINES : 1;
+
+    printf("  Central difference: dt = %e (critical estimate %e), %d steps to t = %e\n",
+           dt, dt_stable, steps, steps * dt);
+    printf("  %d element batches of up to %d, hourglass coefficient %g\n",
+           w.batches, ELEMENT_EXPLICIT_BATCH, options->hourglass);
+    if (damping != 0.0) {
+        printf("  Mass-proportional damping: C = %g M\n", damping);
+    }
+    if (history_filename) {
+        err = time_history_open(history_filename, 2, dt, interval, &history);
+        CHECK_ERROR_CLEANUP(err, goto cleanup);
+        printf("  Time history: %s (every %d steps)\n", history_filename, interval);
+    }
+    printf("    Step        Time       max |u|      Kinetic       Strain\n");
+
+    /* The model starts at rest with u = g(0) times the prescribed values */
+    g_end = explicit_load_factor(options, 0.0);
+    for (int i = 0; i < w.n; i++) {
+        if (w.constrained[i]) {
+            w.u[i] = g_end * w.prescribed[i];
+        }
+    }
+
+    run_start = fem_wall_time();
+#ifdef _OPENMP
+    #pragma omp parallel if (w.batches >= EXPLICIT_PARALLEL_MIN_BATCHES)
+#endif
+    {
+        fem_context_bind(model);
+
+        for (int step = 0; ; step++) {
+            double g = explicit_load_factor(options, step * dt);
+            double g_next = explicit_load_factor(options, (step + 1) * dt);
+            /* The first velocity is a half step from rest */
+            double h = step == 0 ? 0.5 * dt : dt;
+            double keep = 1.0 - 0.5 * damping * h;
+            double scale = 1.0 / (1.0 + 0.5 * damping * h);
+
+#ifdef _OPENMP
+            #pragma omp master
+#endif
+            mark = fem_wall_time();
+
+            /* Internal forces at u_n, batch by batch */
+#ifdef _OPENMP
+            #pragma omp for schedule(static)
+#endif
+            for (int b = 0; b < w.batches; b++) {
+                element_explicit_internal_force(&w.batch[b], w.u,
+                                                w.force + (size_t)b * EXPLICIT_FORCE_SIZE);
+            }
+
+#ifdef _OPENMP
+            #pragma omp master
+#endif
+            {
+                double now = fem_wall_time();
+                time_kernel += now - mark;
+                mark = now;
+            }
+
+            if (step == steps || step % report == 0 || (history && step % interval == 0)) {
+#ifdef _OPENMP
+                #pragma omp single
+#endif
+                {
+                    double kinetic, strain, max_u;
+                    double now = fem_wall_time();
+
+                    if (history && (step % interval == 0 || step == steps)) {
+                        fem_error_t e = time_history_write(history, step, step * dt, w.u, w.n);
+                        if (e != FEM_SUCCESS) {
+                            failure = e;
+                            strncpy(message, error_get_message(), sizeof(message) - 1);
+                            stop = 1;
+                        }
+                        frames++;
+                    }
+                    if (step % report == 0 || step == steps) {
+                        max_u = explicit_energies(&w, &kinetic, &strain);
+                        printf("    %6d  %e  %e  %e  %e\n", step, step * dt, max_u, kinetic, strain);
+                        if (!isfinite(max_u)) {
+                            failure = FEM_ERROR_CONVERGENCE_FAILED;
+                            snprintf(message, sizeof(message),
+                                     "Time integration diverged by step %d (dt too large?)", step);
+                            stop = 1;
+                        }
+                    }
+                    time_output += fem_wall_time() - now;
+                }
+#ifdef _OPENMP
+                #pragma omp master
+#endif
+                mark = fem_wall_time();
+            }
+            if (stop || step == steps) {
+                break;
+            }
+
+            /* Gather, accelerate and move every node */
+#ifdef _OPENMP
+            #pragma omp for schedule(static)
+#endif
+            for (int node = 0; node < g_num_nodes; node++) {
+                double f[2];
+
+                explicit_gather(&w, node, &f[0], &f[1]);
+                for (int k = 0; k < 2; k++) {
+                    int dof = node * 2 + k;
+                    if (w.constrained[dof]) {
+                        w.u[dof] = g_next * w.prescribed[dof];
+                        w.v[dof] = 0.0;
+                    } else {
+                        double a = (g * w.f_ext[dof] - f[k]) * w.inv_mass[node];
+                        w.v[dof] = (keep * w.v[dof] + h * a) * scale;
+                        w.u[dof] += dt * w.v[dof];
+                    }
+                }
+            }
+
+#ifdef _OPENMP
+            #pragma omp master
+#endif
+            time_update += fem_wall_time() - mark;
+        }
+    }
+    stepping = fem_wall_time() - run_start;
+
+    if (failure != FEM_SUCCESS) {
+        err = error_set(failure, "%s", message);
+        goto cleanup;
+    }
+
+    {
+        double updates = (double)g_num_elements * (steps + 1);
+        printf("  Timing:\n");
+        printf("    Setup (batches, mass):  %8.3f s\n", time_setup);
+        printf("    Element kernels:        %8.3f s (%.3e element updates/s)\n", time_kernel,
+               time_kernel > 0.0 ? updates / time_kernel : 0.0);
+        printf("    Nodal updates:          %8.3f s\n", time_update);
+        printf("    History and reports:    %8.3f s (%d frames)\n", time_output, frames);
+        printf("    Time stepping:          %8.3f s (%.0f steps/s, %.3e element updates/s)\n",
+               stepping, stepping > 0.0 ? steps / stepping : 0.0,
+               stepping > 0.0 ? updates / stepping : 0.0);
+    }
+
+    g_end = explicit_load_factor(options, steps * dt);
+    explicit_store_results(&w, g_end);
+
+    g_solver_info.iterations = steps;
+    g_solver_info.residual = 0.0;
+    g_solver_info.status = FEM_SUCCESS;
+    err = FEM_SUCCESS;
+
+cleanup:
+    if (history) {
+        fclose(history);
+    }
+    if (err != FEM_SUCCESS) {
+        g_solver_info.status = err;
+    }
+    explicit_free_work(&w);
+    return err;
+}
@@ -0,0 +1,46 @@
+#ifndef EXPLICIT_H
+#define EXPLICIT_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Explicit dynamics (central difference)
+ *
+ * Linear plane models of T3 and Q4 elements with a lumped (HRZ) mass, so
+ * every step is one pass of the element internal-force kernels plus a
+ * diagonal update per node; no global matrix is assembled. The element
+ * kernels run on structure-of-arrays batches (element_explicit.h), one
+ * batch per task, and write into their own force slots. The nodes then
+ * gather their slots and update acceleration, velocity and displacement
+ * in the same loop, which keeps the scatter free of conflicts and the
+ * sums in a fixed order.
+ *
+ * The time step defaults to 0.9 times the smallest element estimate.
+ * Loads and prescribed displacements follow the load factor of the
+ * implicit analysis (step load, or a linear ramp over ramp_time);
+ * mass_damping adds C = mass_damping M. The model starts at rest.
+ *
+ * Displacement history is streamed to <output stem>.hist (time_history.h);
+ * the result files of the static analysis hold the final state.
+ */
+
+#include "../common/types.h"
+
+typedef struct {
+    double end_time;
+    double dt;                  /* <= 0: from the critical time step */
+    double hourglass;           /* Q4 hourglass stiffness coefficient */
+    double mass_damping;
+    double ramp_time;           /* 0: step load */
+    int output_interval;        /* steps between history frames (<= 0: about 200 frames) */
+} explicit_options_t;
+
+explicit_options_t explicit_default_options(void);
+
+/* Complete analysis: read input_filename, integrate, write the results */
+fem_error_t explicit_analysis(const char *input_filename, const char *output_filename,
+                              const explicit_options_t *options);
+
+/* Time integration on a model that has been read and validated; history
+ * frames go to history_filename (NULL: none) */
+fem_error_t explicit_solve(const explicit_options_t *options, const char *history_filename);
+
+#endif /* EXPLICIT_H */
@@ -0,0 +1,504 @@
+/* FEM4C - Harmonic Analysis Implementation
+ * Frequency response by modal superposition
+ */
+
+#include "harmonic.h"
+#include "static.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_memory.h"
+#include "../common/fem_thread.h"
+#include "../solver/assembly.h"
+#include "../solver/mpc.h"
+#include "../solver/pipeline.h"
+#include "../solver/skyline_solver.h"
+#include "../solver/eigen_solver.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Relative margin above the highest mode for the Sturm sequence check */
+#define HARMONIC_STURM_MARGIN 1.0e-4
+/* Below this many frequency points the sweep runs on one thread */
+#define HARMONIC_PARALLEL_MIN_POINTS 4
+
+typedef struct {
+    int n;
+    int modes;
+    double *mass;
+    double *factor;             /* constrained K, then its LDL^T factor */
+    unsigned char *constrained;
+    double *eigenvalues;
+    double *phi;                /* mode shapes, n x modes row-major */
+    double *modal_load;
+    double *max_amplitude;      /* per frequency */
+    int *max_node;
+    double *node_values;        /* per frequency: |ux|, arg ux, |uy|, arg uy per output node */
+    int *output_index;
+} harmonic_work_t;
+
+harmonic_options_t harmonic_default_options(void)
+{
+    harmonic_options_t options;
+
+    options.modes = 10;
+    options.damping_ratio = 0.02;
+    options.frequencies = NULL;
+    options.frequency_count = 0;
+    options.output_nodes = NULL;
+    options.output_node_count = 0;
+    return options;
+}
+
+/* Main harmonic analysis function */
+fem_error_t harmonic_analysis(const char *input_filename, const char *output_filename,
+                              const harmonic_options_t *options)
+{
+    fem_error_t err;
+    clock_t start_time, end_time;
+    char frf_filename[MAX_FILENAME_LEN];
+
+    printf("FEM4C Harmonic Analysis\n");
+    printf("=======================\n\n");
+
+    start_time = clock();
+
+    err = static_analysis_initialize();
+    CHECK_ERROR(err);
+
+    err = static_analysis_preprocessing(input_filename);
+    CHECK_ERROR(err);
+
+    printf("Phase 3: Modes and Frequency Sweep\n");
+    printf("----------------------------------\n");
+    static_result_filename(frf_filename, output_filename, "_frf.csv");
+    err = harmonic_solve(options, frf_filename);
+    CHECK_ERROR(err);
+    printf("  Solution phase completed successfully\n\n");
+
+    err = static_analysis_finalize();
+    CHECK_ERROR(err);
+
+    end_time = clock();
+    g_solver_info.elapsed_time = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
+
+    printf("\nHarmonic Analysis Complete\n");
+    printf("==========================\n");
+    printf("Total elapsed time: %.3f seconds\n", g_solver_info.elapsed_time);
+    fem_memory_report(stdout);
+
+    return FEM_SUCCESS;
+}
+
+fem_error_t harmonic_parse_frequencies(const char *text, double **frequencies, int *count)
+{
+    double *values;
+    char *end;
+    int n = 1;
+
+    *frequencies = NULL;
+    *count = 0;
+
+    if (strchr(text, ':')) {
+        double first = strtod(text, &end);
+        double last;
+        long points;
+
+        if (end == text || *end != ':') goto invalid;
+        last = strtod(end + 1, &end);
+        if (*end != ':') goto invalid;
+        points = strtol(end + 1, &end, 10);
+        if (*end != '\0' || points < 1 || points > 10000000L ||
+            !(first >= 0.0) || !(last >= first) || !isfinite(last)) goto invalid;
+
+        values = fem_malloc((size_t)points * sizeof(double), FEM_MEMORY_VECTOR);
+        if (!values) {
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate frequency list");
+        }
+        for (long i = 0; i < points; i++) {
+            values[i] = points > 1 ? first + (last - first) * (double)i / (double)(points - 1)
+                                   : first;
+        }
+        *frequencies = values;
+        *count = (int)points;
+        return FEM_SUCCESS;
+    }
+
+    for (const char *c = text; *c; c++) {
+        if (*c == ',') n++;
+    }
+    values = fem_malloc((size_t)n * sizeof(double), FEM_MEMORY_VECTOR);
+    if (!values) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate frequency list");
+    }
+    for (int i = 0; i < n; i++) {
+        values[i] = strtod(text, &end);
+        if (end == text || !(values[i] >= 0.0) || !isfinite(values[i]) ||
+            (*end != ',' && *end != '\0')) {
+            fem_free(values);
+            goto invalid;
+        }
+        text = end + 1;
+    }
+    *frequencies = values;
+    *count = n;
+    return FEM_SUCCESS;
+
+invalid:
+    return error_set(FEM_ERROR_INVALID_INPUT,
+                     "Invalid frequency list (use f1,f2,... or start:end:count in Hz)");
+}
+
+fem_error_t harmonic_parse_nodes(const char *text, int **nodes, int *count)
+{
+    int *values;
+    char *end;
+    int n = 1;
+
+    for (const char *c = text; *c; c++) {
+        if (*c == ',') n++;
+    }
+    values = fem_malloc((size_t)n * sizeof(int), FEM_MEMORY_VECTOR);
+    if (!values) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate node list");
+    }
+    for (int i = 0; i < n; i++) {
+        long id = strtol(text, &end, 10);
+        if (end == text || id <= 0 || id > 2147483647L || (*end != ',' && *end != '\0')) {
+            fem_free(values);
+            return error_set(FEM_ERROR_INVALID_INPUT, "Invalid node list (use id1,id2,...)");
+        }
+        values[i] = (int)id;
+        text = end + 1;
+    }
+    *nodes = values;
+    *count = n;
+    return FEM_SUCCESS;
+}
+
+static void harmonic_free_work(harmonic_work_t *w)
+{
+    fem_free(w->mass);
+    fem_free(w->factor);
+    fem_free(w->constrained);
+    fem_free(w->eigenvalues);
+    fem_free(w->phi);
+    fem_free(w->modal_load);
+    fem_free(w->max_amplitude);
+    fem_free(w->max_node);
+    fem_free(w->node_values);
+    fem_free(w->output_index);
+    memset(w, 0, sizeof(*w));
+}
+
+static fem_error_t harmonic_allocate_work(harmonic_work_t *w, const harmonic_options_t *options)
+{
+    size_t n = (size_t)(g_total_dof > 0 ? g_total_dof : 1);
+    size_t values = (size_t)g_stiffness_value_count;
+    size_t m = (size_t)options->modes;
+    size_t points = (size_t)options->frequency_count;
+    size_t outputs = (size_t)(options->output_node_count > 0 ? options->output_node_count : 1);
+
+    w->n = g_total_dof;
+    w->modes = options->modes;
+    w->mass = fem_calloc(values, sizeof(double), FEM_MEMORY_MATRIX);
+    w->factor = fem_malloc(values * sizeof(double), FEM_MEMORY_MATRIX);
+    w->constrained = fem_calloc(n, 1, FEM_MEMORY_VECTOR);
+    w->eigenvalues = fem_malloc(m * sizeof(double), FEM_MEMORY_VECTOR);
+    w->phi = fem_malloc(n * m * sizeof(double), FEM_MEMORY_MATRIX);
+    w->modal_load = fem_malloc(m * sizeof(double), FEM_MEMORY_VECTOR);
+    w->max_amplitude = fem_malloc(points * sizeof(double), FEM_MEMORY_VECTOR);
+    w->max_node = fem_malloc(points * sizeof(int), FEM_MEMORY_VECTOR);
+    w->node_values = fem_malloc(points * outputs * 4 * sizeof(double), FEM_MEMORY_VECTOR);
+    w->output_index = fem_malloc(outputs * sizeof(int), FEM_MEMORY_VECTOR);
+
+    if (!w->mass || !w->factor || !w->constrained || !w->eigenvalues ||
+        !w->phi || !w->modal_load || !w->max_amplitude || !w->max_node || !w->node_values ||
+        !w->output_index) {
+        harmonic_free_work(w);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Harmonic work array allocation failed");
+    }
+    return FEM_SUCCESS;
+}
+
+/* Modes of K phi = w^2 M phi, with a Sturm count for missed modes */
+static fem_error_t harmonic_extract_modes(harmonic_work_t *w)
+{
+    eigen_options_t eigen = eigen_default_options(w->modes);
+    int negative = 0, below = 0, iterations = 0;
+    double shift;
+    fem_error_t err;
+
+    memcpy(w->factor, g_global_stiffness_values,
+           (size_t)g_stiffness_value_count * sizeof(double));
+    skyline_constrain(w->factor, w->constrained);
+    err = skyline_ldlt_factorize(w->factor, &negative);
+    CHECK_ERROR(err);
+    if (negative > 0) {
+        return error_set(FEM_ERROR_SINGULAR_MATRIX,
+                         "Stiffness matrix is not positive definite (%d negative pivots)",
+                         negative);
+    }
+
+    err = eigen_subspace(w->factor, w->mass, w->constrained, &eigen, w->eigenvalues,
+                         w->phi, &iterations);
+    CHECK_ERROR(err);
+    printf("  Subspace iteration: %d modes converged in %d iterations\n", w->modes, iterations);
+
+    /* The factor is not needed any more: use it as work space */
+    shift = w->eigenvalues[w->modes - 1] * (1.0 + HARMONIC_STURM_MARGIN);
+    err = eigen_sturm_count(g_global_stiffness_values, w->mass, w->constrained, shift,
+                            w->factor, &below);
+    if (err != FEM_SUCCESS) {
+        printf("  Warning: Sturm sequence check skipped (shift hit an eigenvalue)\n");
+    } else if (below != w->modes) {
+        printf("  Warning: Sturm sequence finds %d eigenvalues below %e, %d extracted\n",
+               below, shift, w->modes);
+    } else {
+        printf("  Sturm sequence check: no mode missed below %.6e Hz\n",
+               sqrt(shift) / (2.0 * PI));
+    }
+    return FEM_SUCCESS;
+}
+
+/* Response at every frequency; the points are independent */
+static void harmonic_sweep(harmonic_work_t *w, const harmonic_options_t *options)
+{
+    int points = options->frequency_count;
+    int outputs = options->output_node_count;
+    int m = w->modes;
+    int nodes = g_num_nodes;
+    double zeta = options->damping_ratio;
+
+#ifdef _OPENMP
+    #pragma omp parallel if (points >= HARMONIC_PARALLEL_MIN_POINTS)
+#endif
+    {
+        double *a_re = fem_malloc((size_t)m * 2 * sizeof(double), FEM_MEMORY_VECTOR);
+        double *a_im = a_re ? a_re + m : NULL;
+
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int f = 0; f < points; f++) {
+            double omega = 2.0 * PI * options->frequencies[f];
+            double best = 0.0;
+            int best_node = 0;
+
+            if (!a_re) {
+                /* Out of memory on this thread: mark the point as invalid */
+                w->max_amplitude[f] = NAN;
+                w->max_node[f] = -1;
+                continue;
+            }
+
+            /* Modal amplitudes p_r / (w_r^2 - w^2 + 2 i zeta w_r w) */
+            for (int r = 0; r < m; r++) {
+                double wr = sqrt(w->eigenvalues[r]);
+                double re = w->eigenvalues[r] - omega * omega;
+                double im = 2.0 * zeta * wr * omega;
+                double den = re * re + im * im;
+                a_re[r] = w->modal_load[r] * re / den;
+                a_im[r] = -w->modal_load[r] * im / den;
+            }
+
+            for (int node = 0; node < nodes; node++) {
+                const double *px = w->phi + (size_t)(2 * node) * m;
+                const double *py = px + m;
+                double xr = 0.0, xi = 0.0, yr = 0.0, yi = 0.0;
+                for (int r = 0; r < m; r++) {
+                    xr += px[r] * a_re[r];
+                    xi += px[r] * a_im[r];
+                    yr += py[r] * a_re[r];
+                    yi += py[r] * a_im[r];
+                }
+                double amplitude = xr * xr + xi * xi + yr * yr + yi * yi;
+                if (amplitude > best) {
+                    best = amplitude;
+                    best_node = node;
+                }
+                for (int k = 0; k < outputs; k++) {
+                    if (w->output_index[k] == node) {
+                        double *out = w->node_values + ((size_t)f * outputs + k) * 4;
+                        out[0] = sqrt(xr * xr + xi * xi);
+                        out[1] = atan2(xi, xr) * 180.0 / PI;
+                        out[2] = sqrt(yr * yr + yi * yi);
+                        out[3] = atan2(yi, yr) * 180.0 / PI;
+                    }
+                }
+            }
+            w->max_amplitude[f] = sqrt(best);
+            w->max_node[f] = best_node;
+        }
+        fem_free(a_re);
+    }
+}
+
+static fem_error_t harmonic_write_frf(const harmonic_work_t *w, const harmonic_options_t *options,
+                                      const char *filename)
+{
+    FILE *fp = fopen(filename, "w");
+    int outputs = options->output_node_count;
+
+    if (!fp) {
+        return error_set(FEM_ERROR_FILE_WRITE, "Cannot create frequency response file %s",
+                         filename);
+    }
+
+    fprintf(fp, "frequency_hz,max_amplitude,max_node");
+    for (int k = 0; k < outputs; k++) {
+        int id = options->output_nodes[k];
+        fprintf(fp, ",n%d_ux_amp,n%d_ux_phase_deg,n%d_uy_amp,n%d_uy_phase_deg", id, id, id, id);
+    }
+    fprintf(fp, "\n");
+
+    for (int f = 0; f < options->frequency_count; f++) {
+        int node = w->max_node[f];
+        fprintf(fp, "%.6e,%.6e,%d", options->frequencies[f], w->max_amplitude[f],
+                node < 0 ? 0 : (g_node_ids ? g_node_ids[node] : node + 1));
+        for (int k = 0; k < outputs; k++) {
+            const double *out = w->node_values + ((size_t)f * outputs + k) * 4;
+            fprintf(fp, ",%.6e,%.3f,%.6e,%.3f", out[0], out[1], out[2], out[3]);
+        }
+        fprintf(fp, "\n");
+    }
+
+    if (fclose(fp) != 0) {
+        return error_set(FEM_ERROR_FILE_WRITE, "Error writing frequency response file %s",
+                         filename);
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t harmonic_solve(const harmonic_options_t *options, const char *frf_filename)
+{
+    harmonic_work_t w;
+    double time_assembly, time_modes, time_sweep, time_output, start;
+    int prescribed = 0, peak = 0;
+    fem_error_t err;
+
+    if (!options || options->modes < 1 || options->frequency_count < 1 || !options->frequencies) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Harmonic analysis needs at least one mode and one frequency");
+    }
+    if (!(options->damping_ratio >= 0.0)) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Negative modal damping ratio %g",
+                         options->damping_ratio);
+    }
+    if (g_analysis.spatial_dimension != 2) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Harmonic analysis supports plane models (T3, Q4, T6) only");
+    }
+    err = mpc_require_none("Harmonic");
+    CHECK_ERROR(err);
+
+    /* K and M once */
+    start = fem_wall_time();
+    printf("  Assembling stiffness and mass matrices...\n");
+    if (pipeline_active()) {
+        err = pipeline_assemble_stiffness();
+    } else {
+#ifdef _OPENMP
+        err = assembly_parallel_stiffness_matrix();
+#else
+        err = assembly_global_stiffness_matrix();
+#endif
+    }
+    CHECK_ERROR(err);
+    err = assembly_global_force_vector();
+    CHECK_ERROR(err);
+
+    err = harmonic_allocate_work(&w, options);
+    CHECK_ERROR(err);
+    err = assembly_global_mass_matrix(w.mass);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+
+    for (int k = 0; k < options->output_node_count; k++) {
+        int index = id_map_lookup(&g_node_id_map, options->output_nodes[k]);
+        if (index < 0 || index >= g_num_nodes) {
+            err = error_set(FEM_ERROR_INVALID_NODE, "Output node %d does not exist",
+                            options->output_nodes[k]);
+            goto cleanup;
+        }
+        w.output_index[k] = index;
+    }
+    for (int node = 0; node < g_num_nodes; node++) {
+        for (int k = 0; k < 2; k++) {
+            int dof = node * 2 + k;
+            if (g_node_bc_flags[node][k] == 1 && dof < w.n) {
+                w.constrained[dof] = 1;
+                if (g_node_displ[node][k] != 0.0) prescribed++;
+            }
+        }
+    }
+    if (prescribed > 0) {
+        printf("  Warning: %d prescribed displacements are held at zero "
+               "(support excitation is not modelled)\n", prescribed);
+    }
+    time_assembly = fem_wall_time() - start;
+
+    start = fem_wall_time();
+    err = harmonic_extract_modes(&w);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+
+    /* Modal loads phi_r . f */
+    memset(w.modal_load, 0, (size_t)w.modes * sizeof(double));
+    for (int i = 0; i < w.n; i++) {
+        const double *phi = w.phi + (size_t)i * w.modes;
+        if (w.constrained[i] || g_global_force[i] == 0.0) continue;
+        for (int r = 0; r < w.modes; r++) {
+            w.modal_load[r] += phi[r] * g_global_force[i];
+        }
+    }
+    time_modes = fem_wall_time() - start;
+
+    printf("    Mode   Frequency [Hz]    Modal load\n");
+    for (int r = 0; r < w.modes; r++) {
+        printf("    %4d   %14.6e  %12.4e\n", r + 1,
+               sqrt(fabs(w.eigenvalues[r])) / (2.0 * PI), w.modal_load[r]);
+    }
+
+    start = fem_wall_time();
+    harmonic_sweep(&w, options);
+    time_sweep = fem_wall_time() - start;
+    for (int f = 0; f < options->frequency_count; f++) {
+        if (!isfinite(w.max_amplitude[f])) {
+            err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Frequency sweep work allocation failed");
+            goto cleanup;
+        }
+        if (w.max_amplitude[f] > w.max_amplitude[peak]) peak = f;
+    }
+
+    start = fem_wall_time();
+    err = harmonic_write_frf(&w, options, frf_filename);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+    time_output = fem_wall_time() - start;
+
+    printf("  Sweep: %d frequencies, %d modes, damping ratio %g\n",
+           options->frequency_count, w.modes, options->damping_ratio);
+    printf("  Peak response: %e at %.6e Hz (node %d)\n", w.max_amplitude[peak],
+           options->frequencies[peak],
+           g_node_ids ? g_node_ids[w.max_node[peak]] : w.max_node[peak] + 1);
+    printf("  Frequency response: %s\n", frf_filename);
+    printf("  Timing:\n");
+    printf("    Assembly (K, M):        %8.3f s\n", time_assembly);
+    printf("    Mode extraction:        %8.3f s\n", time_modes);
+    printf("    Frequency sweep:        %8.3f s (%.1f us per frequency)\n", time_sweep,
+           1.0e6 * time_sweep / options->frequency_count);
+    printf("    Output:                 %8.3f s\n", time_output);
+
+    g_solver_info.iterations = w.modes;
+    g_solver_info.residual = 0.0;
+    g_solver_info.status = FEM_SUCCESS;
+    err = FEM_SUCCESS;
+
+cleanup:
+    if (err != FEM_SUCCESS) {
+        g_solver_info.status = err;
+    }
+    harmonic_free_work(&w);
+    return err;
+}
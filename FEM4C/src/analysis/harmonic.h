@@ -0,0 +1,48 @@
+#ifndef HARMONIC_H
+#define HARMONIC_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Harmonic (frequency response) analysis by modal superposition
+ *
+ * Linear plane models (T3, Q4, T6) with consistent mass. The lowest
+ * modes are extracted once by subspace iteration on the skyline LDL^T
+ * factor of K (eigen_solver.h) and checked with a Sturm count. The loads
+ * of the input act as amplitudes of a harmonic excitation f e^{i w t};
+ * with mass-normalised modes phi_r and modal damping ratio zeta
+ *     u(w) = sum_r phi_r (phi_r . f) / (w_r^2 - w^2 + 2 i zeta w_r w)
+ * so each frequency costs O(modes x DOF) and the frequencies are
+ * evaluated in parallel.
+ *
+ * Results go to <output stem>_frf.csv, one row per frequency: the
+ * largest displacement amplitude of the model, its node, and amplitude
+ * and phase of both components at the selected nodes.
+ */
+
+#include "../common/types.h"
+
+typedef struct {
+    int modes;
+    double damping_ratio;           /* modal damping, fraction of critical */
+    const double *frequencies;      /* Hz */
+    int frequency_count;
+    const int *output_nodes;        /* node IDs of the input */
+    int output_node_count;
+} harmonic_options_t;
+
+harmonic_options_t harmonic_default_options(void);
+
+/* Complete analysis: read input_filename, extract modes, sweep, write the results */
+fem_error_t harmonic_analysis(const char *input_filename, const char *output_filename,
+                              const harmonic_options_t *options);
+
+/* Modes and sweep on a model that has been read and validated */
+fem_error_t harmonic_solve(const harmonic_options_t *options, const char *frf_filename);
+
+/* Frequency list "f1,f2,..." or a linear range "start:end:count";
+ * *frequencies is allocated with fem_malloc */
+fem_error_t harmonic_parse_frequencies(const char *text, double **frequencies, int *count);
+
+/* Node list "id1,id2,..."; *nodes is allocated with fem_malloc */
+fem_error_t harmonic_parse_nodes(const char *text, int **nodes, int *count);
+
+#endif /* HARMONIC_H */
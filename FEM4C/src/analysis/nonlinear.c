@@ -0,0 +1,591 @@
+/* FEM4C - Nonlinear Static Analysis Implementation
+ * Total Lagrangian modified Newton-Raphson with load stepping
+ */
+
+#include "nonlinear.h"
+#include "static.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_log.h"
+#include "../common/fem_memory.h"
+#include "../common/fem_thread.h"
+#include "../io/async_output.h"
+#include "../solver/assembly.h"
+#include "../solver/mpc.h"
+#include "../solver/pipeline.h"
+#include "../solver/skyline_solver.h"
+#include "../elements/element_nonlinear.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Elements evaluated in parallel before one serial scatter */
+#define NONLINEAR_CHUNK 4096
+/* Below this many elements a chunk runs on the calling thread */
+#define NONLINEAR_PARALLEL_MIN 256
+/* A line search step is accepted once |du . r(s)| drops below this
+ * fraction of |du . r(0)| */
+#define NONLINEAR_LINE_SEARCH_RATIO 0.8
+#define NONLINEAR_LINE_SEARCH_MIN 0.1
+#define NONLINEAR_LINE_SEARCH_MAX 2.0
+/* Load steps converging within this many iterations let the increment grow */
+#define NONLINEAR_EASY_ITERATIONS 3
+
+typedef struct {
+    int n;
+    double *f_ext;          /* external loads at load factor 1 */
+    double *prescribed;     /* prescribed displacements at load factor 1 */
+    unsigned char *constrained;
+    double *u, *u_start, *du;
+    double *f_int, *residual;
+    double *trial_u, *trial_f_int, *trial_residual;
+    double *factor;         /* LDL^T of the tangent with the BCs applied */
+    element_nonlinear_ref_t *refs;
+    double *fe_chunk, *ke_chunk;
+    int negative_pivots;
+    /* statistics of the whole run */
+    int force_evaluations, factorizations, solves;
+    double time_force, time_tangent, time_factor, time_solve;
+} nonlinear_work_t;
+
+nonlinear_options_t nonlinear_default_options(void)
+{
+    nonlinear_options_t options;
+
+    options.load_steps = 10;
+    options.max_iterations = 30;
+    options.tolerance = 1.0e-6;
+    options.stall_ratio = 0.6;
+    options.max_cutbacks = 6;
+    options.line_search = 4;
+    return options;
+}
+
+/* Main nonlinear analysis function */
+fem_error_t nonlinear_analysis(const char *input_filename, const char *output_filename,
+                               const nonlinear_options_t *options)
+{
+    fem_error_t err;
+    clock_t start_time, end_time;
+    char vtk_filename[MAX_FILENAME_LEN];
+
+    printf("FEM4C Nonlinear Static Analysis\n");
+    printf("===============================\n\n");
+
+    start_time = clock();
+
+    err = static_analysis_initialize();
+    CHECK_ERROR(err);
+
+    err = static_analysis_preprocessing(input_filename);
+    CHECK_ERROR(err);
+
+    static_result_filename(vtk_filename, output_filename, ".vtk");
+    if (async_output_begin_geometry(vtk_filename) != FEM_SUCCESS) {
+        printf("  Warning: VTK geometry could not be started early\n");
+    }
+
+    printf("Phase 3: Nonlinear Solution\n");
+    printf("---------------------------\n");
+    err = nonlinear_solve(options);
+    CHECK_ERROR_CLEANUP(err, async_output_cancel());
+    printf("  Solution phase completed successfully\n\n");
+
+    err = static_analysis_postprocessing(output_filename);
+    CHECK_ERROR_CLEANUP(err, async_output_cancel());
+
+    err = static_analysis_finalize();
+    CHECK_ERROR(err);
+
+    end_time = clock();
+    g_solver_info.elapsed_time = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
+
+    printf("\nNonlinear Analysis Complete\n");
+    printf("===========================\n");
+    printf("Total elapsed time: %.3f seconds\n", g_solver_info.elapsed_time);
+    fem_memory_report(stdout);
+
+    return FEM_SUCCESS;
+}
+
+static void nonlinear_free_work(nonlinear_work_t *w)
+{
+    fem_free(w->f_ext);
+    fem_free(w->prescribed);
+    fem_free(w->constrained);
+    fem_free(w->u);
+    fem_free(w->u_start);
+    fem_free(w->du);
+    fem_free(w->f_int);
+    fem_free(w->residual);
+    fem_free(w->trial_u);
+    fem_free(w->trial_f_int);
+    fem_free(w->trial_residual);
+    fem_free(w->factor);
+    fem_free(w->refs);
+    fem_free(w->fe_chunk);
+    fem_free(w->ke_chunk);
+    memset(w, 0, sizeof(*w));
+}
+
+static fem_error_t nonlinear_allocate_work(nonlinear_work_t *w)
+{
+    size_t n = (size_t)(g_total_dof > 0 ? g_total_dof : 1);
+    size_t chunk = (size_t)(g_num_elements < NONLINEAR_CHUNK ? g_num_elements : NONLINEAR_CHUNK);
+
+    if (chunk == 0) {
+        chunk = 1;
+    }
+    memset(w, 0, sizeof(*w));
+    w->n = g_total_dof;
+    w->f_ext = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->prescribed = fem_calloc(n, sizeof(double), FEM_MEMORY_VECTOR);
+    w->constrained = fem_calloc(n, 1, FEM_MEMORY_VECTOR);
+    w->u = fem_calloc(n, sizeof(double), FEM_MEMORY_VECTOR);
+    w->u_start = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->du = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->f_int = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->residual = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->trial_u = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->trial_f_int = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->trial_residual = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->factor = fem_malloc((size_t)g_stiffness_value_count * sizeof(double), FEM_MEMORY_MATRIX);
+    w->refs = fem_malloc((size_t)g_num_elements * sizeof(*w->refs), FEM_MEMORY_MESH);
+    w->fe_chunk = fem_malloc(chunk * ELEMENT_NONLINEAR_MAX_DOF * sizeof(double), FEM_MEMORY_VECTOR);
+    w->ke_chunk = fem_malloc(chunk * ELEMENT_NONLINEAR_PACKED_SIZE * sizeof(double), FEM_MEMORY_MATRIX);
+
+    if (!w->f_ext || !w->prescribed || !w->constrained || !w->u || !w->u_start || !w->du ||
+        !w->f_int || !w->residual || !w->trial_u || !w->trial_f_int || !w->trial_residual ||
+        !w->factor || !w->refs || !w->fe_chunk || !w->ke_chunk) {
+        nonlinear_free_work(w);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Nonlinear work array allocation failed");
+    }
+    return FEM_SUCCESS;
+}
+
+/* Reference data of every element, in parallel */
+static fem_error_t nonlinear_prepare_elements(nonlinear_work_t *w)
+{
+    fem_context_t *model = g_fem_context;
+    fem_error_t failure = FEM_SUCCESS;
+    char message[ERROR_MSG_LEN] = "";
+    int elements = g_num_elements;
+
+#ifdef _OPENMP
+    #pragma omp parallel if (elements >= NONLINEAR_PARALLEL_MIN)
+#endif
+    {
+        fem_context_bind(model);
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int e = 0; e < elements; e++) {
+            fem_error_t err = element_nonlinear_prepare(e, &w->refs[e]);
+            if (err != FEM_SUCCESS) {
+#ifdef _OPENMP
+                #pragma omp critical(nonlinear_prepare_error)
+#endif
+                if (failure == FEM_SUCCESS) {
+                    failure = err;
+                    strncpy(message, error_get_message(), sizeof(message) - 1);
+                }
+            }
+        }
+    }
+
+    if (failure != FEM_SUCCESS) {
+        return error_set(failure, "%s", message);
+    }
+    return FEM_SUCCESS;
+}
+
+/* Internal forces at u, and with tangent the tangent stiffness assembled
+ * into g_global_stiffness_values. Elements are evaluated chunk by chunk
+ * in parallel; the scatter into the global arrays is serial. */
+static fem_error_t nonlinear_element_pass(nonlinear_work_t *w, const double *u, double *f_int,
+                                          int tangent)
+{
+    fem_context_t *model = g_fem_context;
+    int elements = g_num_elements;
+    fem_error_t err;
+
+    memset(f_int, 0, (size_t)w->n * sizeof(double));
+    if (tangent) {
+        memset(g_global_stiffness_values, 0, (size_t)g_stiffness_value_count * sizeof(double));
+    }
+
+    for (int first = 0; first < elements; first += NONLINEAR_CHUNK) {
+        int count = elements - first < NONLINEAR_CHUNK ? elements - first : NONLINEAR_CHUNK;
+
+#ifdef _OPENMP
+        #pragma omp parallel if (count >= NONLINEAR_PARALLEL_MIN)
+#endif
+        {
+            fem_context_bind(model);
+#ifdef _OPENMP
+            #pragma omp for schedule(static)
+#endif
+            for (int k = 0; k < count; k++) {
+                const element_nonlinear_ref_t *ref = &w->refs[first + k];
+                const int *nodes = g_element_nodes[first + k];
+                double ue[ELEMENT_NONLINEAR_MAX_DOF];
+
+                for (int a = 0; a < ref->nodes; a++) {
+                    ue[2 * a] = u[2 * nodes[a]];
+                    ue[2 * a + 1] = u[2 * nodes[a] + 1];
+                }
+                element_nonlinear_response(ref, ue, w->fe_chunk + (size_t)k * ELEMENT_NONLINEAR_MAX_DOF,
+                                           tangent ? w->ke_chunk + (size_t)k * ELEMENT_NONLINEAR_PACKED_SIZE
+                                                   : NULL);
+            }
+        }
+
+        for (int k = 0; k < count; k++) {
+            int e = first + k;
+            const int *nodes = g_element_nodes[e];
+            const double *fe = w->fe_chunk + (size_t)k * ELEMENT_NONLINEAR_MAX_DOF;
+
+            for (int a = 0; a < w->refs[e].nodes; a++) {
+                f_int[2 * nodes[a]] += fe[2 * a];
+                f_int[2 * nodes[a] + 1] += fe[2 * a + 1];
+            }
+            if (tangent) {
+                err = assembly_add_element_stiffness_packed(
+                    e, w->ke_chunk + (size_t)k * ELEMENT_NONLINEAR_PACKED_SIZE);
+                CHECK_ERROR(err);
+            }
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+/* f_int and r = lambda f_ext - f_int (zero at constrained DOFs) at u;
+ * returns |r| and the force scale it is measured against */
+static fem_error_t nonlinear_evaluate(nonlinear_work_t *w, const double *u, double lambda,
+                                      double *f_int, double *residual,
+                                      double *norm, double *scale)
+{
+    double start = fem_wall_time();
+    double r2 = 0.0, f2 = 0.0, g2 = 0.0;
+    fem_error_t err;
+
+    err = nonlinear_element_pass(w, u, f_int, 0);
+    CHECK_ERROR(err);
+
+    for (int i = 0; i < w->n; i++) {
+        double load = lambda * w->f_ext[i];
+        g2 += f_int[i] * f_int[i];
+        if (w->constrained[i]) {
+            residual[i] = 0.0;
+            continue;
+        }
+        residual[i] = load - f_int[i];
+        r2 += residual[i] * residual[i];
+        f2 += load * load;
+    }
+    *norm = sqrt(r2);
+    *scale = sqrt(f2 > g2 ? f2 : g2);
+
+    w->force_evaluations++;
+    w->time_force += fem_wall_time() - start;
+    return FEM_SUCCESS;
+}
+
+/* Factorize the matrix in g_global_stiffness_values with the constrained
+ * rows and columns replaced by identity rows, leaving it untouched */
+static fem_error_t nonlinear_factorize(nonlinear_work_t *w)
+{
+    double start = fem_wall_time();
+    fem_error_t err;
+
+    memcpy(w->factor, g_global_stiffness_values, (size_t)g_stiffness_value_count * sizeof(double));
+    skyline_constrain(w->factor, w->constrained);
+
+    err = skyline_ldlt_factorize(w->factor, &w->negative_pivots);
+    w->factorizations++;
+    w->time_factor += fem_wall_time() - start;
+    return err;
+}
+
+/* Reassemble the tangent at u and factorize it */
+static fem_error_t nonlinear_refactorize(nonlinear_work_t *w, const double *u)
+{
+    double start = fem_wall_time();
+    fem_error_t err;
+
+    /* The internal forces of this pass are not needed */
+    err = nonlinear_element_pass(w, u, w->trial_f_int, 1);
+    w->time_tangent += fem_wall_time() - start;
+    CHECK_ERROR(err);
+
+    return nonlinear_factorize(w);
+}
+
+static double nonlinear_dot(const double *a, const double *b, int n)
+{
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static void nonlinear_swap(double **a, double **b)
+{
+    double *tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+/* Move u along du by the step s that makes du . r(u + s du) small, found
+ * by secant steps on that function starting from s = 1. f_int, residual
+ * and norm/scale are those of the accepted point on return. */
+static fem_error_t nonlinear_line_search(nonlinear_work_t *w, double lambda, int max_steps,
+                                         double *norm, double *scale)
+{
+    double g0 = nonlinear_dot(w->du, w->residual, w->n);
+    double s_prev = 0.0, g_prev = g0;
+    double s = 1.0, g;
+    fem_error_t err;
+
+    for (int step = 0;; step++) {
+        for (int i = 0; i < w->n; i++) {
+            w->trial_u[i] = w->u[i] + s * w->du[i];
+        }
+        err = nonlinear_evaluate(w, w->trial_u, lambda, w->trial_f_int, w->trial_residual,
+                                 norm, scale);
+        CHECK_ERROR(err);
+        g = nonlinear_dot(w->du, w->trial_residual, w->n);
+
+        /* Only a descent direction (g0 > 0) is searched along */
+        if (step >= max_steps || !(g0 > 0.0) ||
+            fabs(g) <= NONLINEAR_LINE_SEARCH_RATIO * g0 || g == g_prev) {
+            break;
+        }
+        double s_next = s - g * (s - s_prev) / (g - g_prev);
+        if (!isfinite(s_next)) {
+            break;
+        }
+        if (s_next < NONLINEAR_LINE_SEARCH_MIN) s_next = NONLINEAR_LINE_SEARCH_MIN;
+        if (s_next > NONLINEAR_LINE_SEARCH_MAX) s_next = NONLINEAR_LINE_SEARCH_MAX;
+        if (fabs(s_next - s) < 1.0e-3) {
+            break;
+        }
+        s_prev = s;
+        g_prev = g;
+        s = s_next;
+    }
+
+    nonlinear_swap(&w->u, &w->trial_u);
+    nonlinear_swap(&w->f_int, &w->trial_f_int);
+    nonlinear_swap(&w->residual, &w->trial_residual);
+    return FEM_SUCCESS;
+}
+
+static void nonlinear_store_results(const nonlinear_work_t *w)
+{
+    double sum[2] = {0.0, 0.0};
+    int count = 0;
+
+    memcpy(g_global_displ, w->u, (size_t)w->n * sizeof(double));
+    for (int node = 0; node < g_num_nodes; node++) {
+        g_node_displ[node][0] = w->u[node * 2];
+        g_node_displ[node][1] = w->u[node * 2 + 1];
+    }
+
+    /* Reactions balance the internal forces at the constrained DOFs */
+    memset(g_node_reaction, 0, (size_t)g_num_nodes * sizeof(*g_node_reaction));
+    for (int i = 0; i < w->n; i++) {
+        if (w->constrained[i]) {
+            double reaction = w->f_int[i] - w->f_ext[i];
+            g_node_reaction[i / 2][i % 2] = reaction;
+            sum[i % 2] += reaction;
+            count++;
+        }
+    }
+    g_reactions_current = 1;
+
+    printf("    Reaction sum: RX = %e, RY = %e (%d constrained DOFs)\n", sum[0], sum[1], count);
+}
+
+fem_error_t nonlinear_solve(const nonlinear_options_t *options)
+{
+    nonlinear_options_t defaults = nonlinear_default_options();
+    nonlinear_work_t w;
+    double lambda = 0.0, increment, max_increment;
+    double norm = 0.0, scale = 0.0;
+    double run_start;
+    int step = 0, total_iterations = 0, cutbacks = 0, refactor = 0;
+    fem_error_t err;
+
+    if (!options) {
+        options = &defaults;
+    }
+    if (g_analysis.spatial_dimension != 2) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Nonlinear analysis supports plane models (T3, Q4, T6) only");
+    }
+    err = mpc_require_none("Nonlinear");
+    CHECK_ERROR(err);
+    if (options->load_steps <= 0 || options->max_iterations <= 0 || !(options->tolerance > 0.0)) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Invalid nonlinear solution options");
+    }
+
+    /* The linear stiffness is the tangent at u = 0 and sets up the profile */
+    printf("  Assembling system matrices...\n");
+    if (pipeline_active()) {
+        err = pipeline_assemble_stiffness();
+    } else {
+#ifdef _OPENMP
+        err = assembly_parallel_stiffness_matrix();
+#else
+        err = assembly_global_stiffness_matrix();
+#endif
+    }
+    CHECK_ERROR(err);
+    err = assembly_global_force_vector();
+    CHECK_ERROR(err);
+
+    err = nonlinear_allocate_work(&w);
+    CHECK_ERROR(err);
+    if (!g_node_reaction) {
+        g_node_reaction = fem_calloc((size_t)(g_num_nodes > 0 ? g_num_nodes : 1),
+                                     sizeof(*g_node_reaction), FEM_MEMORY_VECTOR);
+        if (!g_node_reaction) {
+            nonlinear_free_work(&w);
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate reactions");
+        }
+    }
+
+    memcpy(w.f_ext, g_global_force, (size_t)w.n * sizeof(double));
+    for (int node = 0; node < g_num_nodes; node++) {
+        for (int k = 0; k < 2; k++) {
+            int dof = node * 2 + k;
+            if (g_node_bc_flags[node][k] == 1 && dof < w.n) {
+                w.constrained[dof] = 1;
+                w.prescribed[dof] = g_node_displ[node][k];
+            }
+        }
+    }
+
+    run_start = fem_wall_time();
+    err = nonlinear_prepare_elements(&w);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+    err = nonlinear_factorize(&w);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+
+    increment = max_increment = 1.0 / options->load_steps;
+    printf("  Load stepping: %d steps, tolerance %.1e, refactorize above residual ratio %.2f\n",
+           options->load_steps, options->tolerance, options->stall_ratio);
+    printf("    Step  Load factor  Iter  Refact  F_int  Residual      Time [s]\n");
+
+    while (lambda < 1.0) {
+        double target = lambda + increment;
+        double step_start = fem_wall_time();
+        int evaluations = w.force_evaluations;
+        int factorizations = w.factorizations;
+        double previous;
+        int iteration = 0, converged;
+
+        /* Finish in one increment rather than leave a sliver */
+        if (target > 1.0 - 0.25 * increment) {
+            target = 1.0;
+        }
+
+        memcpy(w.u_start, w.u, (size_t)w.n * sizeof(double));
+        for (int i = 0; i < w.n; i++) {
+            if (w.constrained[i]) {
+                w.u[i] = target * w.prescribed[i];
+            }
+        }
+
+        err = nonlinear_evaluate(&w, w.u, target, w.f_int, w.residual, &norm, &scale);
+        CHECK_ERROR_CLEANUP(err, goto cleanup);
+        converged = norm <= options->tolerance * scale;
+        previous = norm;
+
+        while (!converged && iteration < options->max_iterations && isfinite(norm)) {
+            double solve_start;
+
+            if (refactor) {
+                err = nonlinear_refactorize(&w, w.u);
+                CHECK_ERROR_CLEANUP(err, goto cleanup);
+                refactor = 0;
+            }
+
+            solve_start = fem_wall_time();
+            memcpy(w.du, w.residual, (size_t)w.n * sizeof(double));
+            skyline_ldlt_solve(w.factor, w.du);
+            w.solves++;
+            w.time_solve += fem_wall_time() - solve_start;
+
+            err = nonlinear_line_search(&w, target, options->line_search, &norm, &scale);
+            CHECK_ERROR_CLEANUP(err, goto cleanup);
+            iteration++;
+
+            converged = norm <= options->tolerance * scale;
+            if (!converged && norm > options->stall_ratio * previous) {
+                refactor = 1;
+            }
+            previous = norm;
+        }
+        total_iterations += iteration;
+
+        if (!converged) {
+            if (cutbacks >= options->max_cutbacks) {
+                err = error_set(FEM_ERROR_CONVERGENCE_FAILED,
+                                "Load step %d did not converge at load factor %.6f "
+                                "(relative residual %e)",
+                                step + 1, target, scale > 0.0 ? norm / scale : norm);
+                goto cleanup;
+            }
+            printf("    %4d  %11.6f  %4d  %6d  %5d  %e  cut back\n", step + 1, target,
+                   iteration, w.factorizations - factorizations,
+                   w.force_evaluations - evaluations, scale > 0.0 ? norm / scale : norm);
+            memcpy(w.u, w.u_start, (size_t)w.n * sizeof(double));
+            increment *= 0.5;
+            cutbacks++;
+            refactor = 1;
+            continue;
+        }
+
+        lambda = target;
+        step++;
+        printf("    %4d  %11.6f  %4d  %6d  %5d  %e  %.3f%s\n", step, lambda, iteration,
+               w.factorizations - factorizations, w.force_evaluations - evaluations,
+               scale > 0.0 ? norm / scale : 0.0, fem_wall_time() - step_start,
+               w.negative_pivots > 0 ? "  (indefinite tangent)" : "");
+
+        if (iteration <= NONLINEAR_EASY_ITERATIONS && increment < max_increment) {
+            increment = increment * 2.0 < max_increment ? increment * 2.0 : max_increment;
+        }
+        cutbacks = 0;
+    }
+
+    printf("  Converged in %d load steps, %d iterations\n", step, total_iterations);
+    printf("    Internal force evaluations: %4d  %8.3f s\n", w.force_evaluations, w.time_force);
+    printf("    Tangent assemblies:         %4d  %8.3f s\n", w.factorizations - 1, w.time_tangent);
+    printf("    Factorizations:             %4d  %8.3f s\n", w.factorizations, w.time_factor);
+    printf("    Solves:                     %4d  %8.3f s\n", w.solves, w.time_solve);
+    printf("    Total:                            %8.3f s\n", fem_wall_time() - run_start);
+
+    nonlinear_store_results(&w);
+
+    g_solver_info.iterations = total_iterations;
+    g_solver_info.residual = scale > 0.0 ? norm / scale : 0.0;
+    g_solver_info.status = FEM_SUCCESS;
+    err = FEM_SUCCESS;
+
+cleanup:
+    if (err != FEM_SUCCESS) {
+        g_solver_info.status = err;
+    }
+    nonlinear_free_work(&w);
+    return err;
+}
@@ -0,0 +1,42 @@
+#ifndef NONLINEAR_H
+#define NONLINEAR_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Geometrically nonlinear static analysis
+ *
+ * Total Lagrangian Newton-Raphson for plane models (T3, Q4, T6) with the
+ * loads and prescribed displacements applied in load steps. The tangent
+ * is kept as an LDL^T factor of the skyline matrix and reused across
+ * iterations and load steps (modified Newton); it is reassembled and
+ * refactorized only when the residual stops dropping fast enough, or after
+ * a step has been cut back. A secant line search along each correction
+ * keeps the old factor useful further from where it was formed.
+ *
+ * Every load step reports its iterations, refactorizations and internal
+ * force evaluations; the run ends with the time spent in internal forces,
+ * tangents, factorizations and solves. Results go to the same files as
+ * the linear analysis; stresses there are recovered from the final
+ * displacements with the small-strain element routines.
+ */
+
+#include "../common/types.h"
+
+typedef struct {
+    int load_steps;          /* initial number of equal load increments */
+    int max_iterations;      /* Newton iterations per load step */
+    double tolerance;        /* relative residual */
+    double stall_ratio;      /* refactorize when |r_k| / |r_k-1| exceeds this */
+    int max_cutbacks;        /* halvings of one load increment */
+    int line_search;         /* secant line search steps (0: off) */
+} nonlinear_options_t;
+
+nonlinear_options_t nonlinear_default_options(void);
+
+/* Complete analysis: read input_filename, solve, write the results */
+fem_error_t nonlinear_analysis(const char *input_filename, const char *output_filename,
+                               const nonlinear_options_t *options);
+
+/* Solution phase on a model that has been read and validated */
+fem_error_t nonlinear_solve(const nonlinear_options_t *options);
+
+#endif /* NONLINEAR_H */
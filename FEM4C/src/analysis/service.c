@@ -0,0 +1,691 @@
+/* FEM4C - Resident solver service implementation
+ * Requests are served one at a time on the main thread. A request on a
+ * model binds that model's analysis context for its duration, so the
+ * static analysis phases run unchanged on the cached state.
+ */
+
+/* UNIX-domain sockets, fdopen, dup, lstat, unlink */
+#define _POSIX_C_SOURCE 200112L
+
+#include "service.h"
+#include "static.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_context.h"
+#include "../common/fem_memory.h"
+#include "../common/fem_thread.h"
+#include "../io/async_output.h"
+#include "../solver/assembly.h"
+#include "../solver/pipeline.h"
+#include "../solver/skyline_ooc.h"
+#include "../solver/sparse_cholesky.h"
+#include "../solver/krylov_recycle.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#define SERVICE_LINE_LEN (2 * MAX_FILENAME_LEN + 128)
+#define SERVICE_MAX_ARGS 8
+
+typedef struct {
+    char path[MAX_FILENAME_LEN];
+    fem_context_t *context;
+    double *bc_force;           /* Right-hand side terms of the boundary conditions */
+    int stiffness_current;      /* Assembled stiffness matches the materials */
+    int loads_current;          /* Solution matches the nodal loads */
+    unsigned long last_used;
+    int solves;
+} service_model_t;
+
+typedef struct {
+    service_model_t *models;
+    int num_models;
+    int max_models;
+    unsigned long clock;        /* LRU stamp source */
+    int running;
+} service_t;
+
+static void service_json_string(FILE *out, const char *text)
+{
+    fputc('"', out);
+    for (const unsigned char *c = (const unsigned char *)text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(out, "\\u%04x", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static fem_error_t service_parse_int(const char *text, int *value)
+{
+    char *end;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || parsed < -2147483647L || parsed > 2147483647L) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Invalid integer: %s", text);
+    }
+    *value = (int)parsed;
+    return FEM_SUCCESS;
+}
+
+static fem_error_t service_parse_double(const char *text, double *value)
+{
+    char *end;
+    *value = strtod(text, &end);
+    if (end == text || *end != '\0' || !isfinite(*value)) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Invalid number: %s", text);
+    }
+    return FEM_SUCCESS;
+}
+
+/* Split line into whitespace separated words in place */
+static int service_split(char *line, char *argv[SERVICE_MAX_ARGS + 1])
+{
+    int argc = 0;
+    char *p = line;
+
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+            *p++ = '\0';
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (argc == SERVICE_MAX_ARGS + 1) {
+            return -1;
+        }
+        argv[argc++] = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+            p++;
+        }
+    }
+    return argc;
+}
+
+static int service_dof_constrained(int dof)
+{
+    return g_node_bc_flags[dof / g_dof_per_node][dof % g_dof_per_node] == 1;
+}
+
+static void service_release_model(service_model_t *model)
+{
+    /* A model parsed but never solved still holds its pipelined matrices */
+    fem_context_t *previous = fem_context_bind(model->context);
+    pipeline_cancel();
+    skyline_ooc_release();
+    sparse_cholesky_release();
+    krylov_recycle_release();
+    fem_context_bind(previous);
+
+    fem_context_destroy(model->context);
+    free(model->bc_force);
+    memset(model, 0, sizeof(*model));
+}
+
+static int service_find_model(const service_t *service, const char *path)
+{
+    for (int i = 0; i < service->num_models; ++i) {
+        if (strcmp(service->models[i].path, path) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Cached model for path; parses it (evicting the least recently used
+ * model if the cache is full) when it is not cached yet */
+static fem_error_t service_get_model(service_t *service, const char *path,
+                                     service_model_t **model_out, int *cached)
+{
+    fem_context_t *context;
+    fem_context_t *previous;
+    service_model_t *model;
+    fem_error_t err;
+    int index = service_find_model(service, path);
+
+    if (index >= 0) {
+        model = &service->models[index];
+        model->last_used = ++service->clock;
+        *model_out = model;
+        *cached = 1;
+        return FEM_SUCCESS;
+    }
+    if (strlen(path) >= MAX_FILENAME_LEN) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Model path too long");
+    }
+
+    if (service->num_models == service->max_models) {
+        int lru = 0;
+        for (int i = 1; i < service->num_models; ++i) {
+            if (service->models[i].last_used < service->models[lru].last_used) {
+                lru = i;
+            }
+        }
+        printf("  Evicting model %s\n", service->models[lru].path);
+        service_release_model(&service->models[lru]);
+        service->models[lru] = service->models[--service->num_models];
+    }
+
+    context = fem_context_create();
+    if (context == NULL) {
+        return FEM_ERROR_MEMORY_ALLOCATION;
+    }
+    previous = fem_context_bind(context);
+    err = static_analysis_initialize();
+    if (err == FEM_SUCCESS) {
+        err = static_analysis_preprocessing(path);
+    }
+    fem_context_bind(previous);
+    if (err != FEM_SUCCESS) {
+        fem_context_destroy(context);
+        return err;
+    }
+
+    model = &service->models[service->num_models++];
+    memset(model, 0, sizeof(*model));
+    strcpy(model->path, path);
+    model->context = context;
+    model->last_used = ++service->clock;
+    *model_out = model;
+    *cached = 0;
+    return FEM_SUCCESS;
+}
+
+/* After a full assembly, record what the boundary conditions did to the
+ * right-hand side: the lifting term on free DOFs and the prescribed value
+ * on constrained ones. Later load changes then only rebuild the force
+ * vector. */
+static fem_error_t service_capture_bc_force(service_model_t *model)
+{
+    size_t bytes = (size_t)g_total_dof * sizeof(double);
+    double *applied;
+    fem_error_t err;
+
+    free(model->bc_force);
+    model->bc_force = (double *)malloc(bytes);
+    applied = (double *)malloc(bytes);
+    if (!model->bc_force || !applied) {
+        free(applied);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate boundary condition terms");
+    }
+
+    memcpy(applied, g_global_force, bytes);
+    err = assembly_global_force_vector();
+    if (err == FEM_SUCCESS) {
+        for (int i = 0; i < g_total_dof; ++i) {
+            model->bc_force[i] = service_dof_constrained(i) ? applied[i] : applied[i] - g_global_force[i];
+        }
+    }
+    memcpy(g_global_force, applied, bytes);
+    free(applied);
+    return err;
+}
+
+static fem_error_t service_update_force(const service_model_t *model)
+{
+    fem_error_t err = assembly_global_force_vector();
+    CHECK_ERROR(err);
+    assembly_store_reaction_loads();
+
+    for (int i = 0; i < g_total_dof; ++i) {
+        if (service_dof_constrained(i)) {
+            g_global_force[i] = model->bc_force[i];
+        } else {
+            g_global_force[i] += model->bc_force[i];
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+/* The solver overwrites the prescribed displacements with the solution;
+ * put the exact values back before the boundary conditions are re-applied */
+static void service_restore_prescribed(const service_model_t *model)
+{
+    if (!model->bc_force) {
+        return;
+    }
+    for (int i = 0; i < g_total_dof; ++i) {
+        if (service_dof_constrained(i)) {
+            g_node_displ[i / g_dof_per_node][i % g_dof_per_node] = model->bc_force[i];
+        }
+    }
+}
+
+static fem_error_t service_solve_model(service_model_t *model, int *reassembled)
+{
+    fem_error_t err;
+
+    *reassembled = 0;
+    if (!model->stiffness_current) {
+        service_restore_prescribed(model);
+        err = static_analysis_solve();
+        CHECK_ERROR(err);
+        err = service_capture_bc_force(model);
+        CHECK_ERROR(err);
+        *reassembled = 1;
+    } else if (!model->loads_current) {
+        /* CG starts from the previous displacement; a direct factor is
+         * kept from the last assembly */
+        err = service_update_force(model);
+        CHECK_ERROR(err);
+        err = static_solve_equations();
+        CHECK_ERROR(err);
+    }
+    model->stiffness_current = 1;
+    model->loads_current = 1;
+    model->solves++;
+    return FEM_SUCCESS;
+}
+
+static fem_error_t service_cmd_load(service_model_t *model, int cached, double start_time, FILE *out)
+{
+    fprintf(out, "{\"ok\":true,\"model\":");
+    service_json_string(out, model->path);
+    fprintf(out, ",\"cached\":%s,\"nodes\":%d,\"elements\":%d,\"materials\":%d,\"dof\":%d,"
+                 "\"time_ms\":%.3f}\n",
+            cached ? "true" : "false", g_num_nodes, g_num_elements, g_num_materials,
+            g_num_nodes * g_dof_per_node, 1000.0 * (fem_wall_time() - start_time));
+    return FEM_SUCCESS;
+}
+
+static fem_error_t service_cmd_force(service_model_t *model, int argc, char **argv, FILE *out)
+{
+    int node_id = 0;
+    int node;
+    double force[3] = {0.0, 0.0, 0.0};
+    fem_error_t err;
+
+    if (argc != 5 && argc != 6) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Usage: force <model> <node_id> <fx> <fy> [fz]");
+    }
+    err = service_parse_int(argv[2], &node_id);
+    CHECK_ERROR(err);
+    err = service_parse_double(argv[3], &force[0]);
+    CHECK_ERROR(err);
+    err = service_parse_double(argv[4], &force[1]);
+    CHECK_ERROR(err);
+    if (argc == 6) {
+        err = service_parse_double(argv[5], &force[2]);
+        CHECK_ERROR(err);
+    }
+
+    node = id_map_lookup(&g_node_id_map, node_id);
+    if (node < 0) {
+        return error_set(FEM_ERROR_INVALID_NODE, "Unknown node ID %d", node_id);
+    }
+    g_node_force[node][0] = force[0];
+    g_node_force[node][1] = force[1];
+    if (g_dof_per_node == 3) {
+        g_node_force[node][2] = force[2];
+    }
+    model->loads_current = 0;
+
+    fprintf(out, "{\"ok\":true}\n");
+    return FEM_SUCCESS;
+}
+
+static fem_error_t service_cmd_material(service_model_t *model, int argc, char **argv, FILE *out)
+{
+    int material_id = 0;
+    int material;
+    double young = 0.0;
+    double poisson = 0.0;
+    fem_error_t err;
+
+    if (argc != 5) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Usage: material <model> <material_id> <E> <nu>");
+    }
+    err = service_parse_int(argv[2], &material_id);
+    CHECK_ERROR(err);
+    err = service_parse_double(argv[3], &young);
+    CHECK_ERROR(err);
+    err = service_parse_double(argv[4], &poisson);
+    CHECK_ERROR(err);
+
+    material = id_map_lookup(&g_material_id_map, material_id);
+    if (material < 0) {
+        return error_set(FEM_ERROR_INVALID_MATERIAL, "Unknown material ID %d", material_id);
+    }
+    if (young <= 0.0 || poisson >= 0.5 || poisson < -1.0) {
+        return error_set(FEM_ERROR_INVALID_MATERIAL, "Invalid properties for material %d", material_id);
+    }
+    g_material_props[material][0] = young;
+    g_material_props[material][1] = poisson;
+    model->stiffness_current = 0;
+
+    fprintf(out, "{\"ok\":true}\n");
+    return FEM_SUCCESS;
+}
+
+static fem_error_t service_cmd_solve(service_model_t *model, int argc, char **argv,
+                                     double start_time, FILE *out)
+{
+    int reassembled;
+    double max_displacement = 0.0;
+    fem_error_t err;
+
+    if (argc != 2 && argc != 3) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Usage: solve <model> [output]");
+    }
+    err = service_solve_model(model, &reassembled);
+    CHECK_ERROR(err);
+
+    if (argc == 3) {
+        err = static_analysis_postprocessing(argv[2]);
+        if (err == FEM_SUCCESS) {
+            err = async_output_join();
+        } else {
+            async_output_cancel();
+        }
+        CHECK_ERROR(err);
+    }
+
+    for (int node = 0; node < g_num_nodes; ++node) {
+        double magnitude = sqrt(g_node_displ[node][0] * g_node_displ[node][0] +
+                                g_node_displ[node][1] * g_node_displ[node][1] +
+                                g_node_displ[node][2] * g_node_displ[node][2]);
+        if (magnitude > max_displacement) {
+            max_displacement = magnitude;
+        }
+    }
+
+    fprintf(out, "{\"ok\":true,\"reassembled\":%s,\"iterations\":%d,\"residual\":%.6e,"
+                 "\"max_displacement\":%.17g,\"time_ms\":%.3f}\n",
+            reassembled ? "true" : "false", g_solver_info.iterations, g_solver_info.residual,
+            max_displacement, 1000.0 * (fem_wall_time() - start_time));
+    return FEM_SUCCESS;
+}
+
+static fem_error_t service_cmd_displacement(const service_model_t *model, int argc, char **argv, FILE *out)
+{
+    int node_id = 0;
+    int node;
+    fem_error_t err;
+
+    if (argc != 3) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Usage: displacement <model> <node_id>");
+    }
+    err = service_parse_int(argv[2], &node_id);
+    CHECK_ERROR(err);
+    node = id_map_lookup(&g_node_id_map, node_id);
+    if (node < 0) {
+        return error_set(FEM_ERROR_INVALID_NODE, "Unknown node ID %d", node_id);
+    }
+
+    fprintf(out, "{\"ok\":true,\"node\":%d,\"u\":%.17g,\"v\":%.17g,", node_id,
+            g_node_displ[node][0], g_node_displ[node][1]);
+    if (g_dof_per_node == 3) {
+        fprintf(out, "\"w\":%.17g,", g_node_displ[node][2]);
+    }
+    fprintf(out, "\"current\":%s}\n",
+            model->solves > 0 && model->stiffness_current && model->loads_current ? "true" : "false");
+    return FEM_SUCCESS;
+}
+
+static void service_cmd_status(const service_t *service, FILE *out)
+{
+    fprintf(out, "{\"ok\":true,\"capacity\":%d,\"memory_bytes\":%lu,\"peak_memory_bytes\":%lu,\"models\":[",
+            service->max_models, (unsigned long)fem_memory_current(FEM_MEMORY_CATEGORY_COUNT),
+            (unsigned long)fem_memory_peak(FEM_MEMORY_CATEGORY_COUNT));
+    for (int i = 0; i < service->num_models; ++i) {
+        const service_model_t *model = &service->models[i];
+        fprintf(out, "%s{\"model\":", i > 0 ? "," : "");
+        service_json_string(out, model->path);
+        fprintf(out, ",\"dof\":%d,\"solves\":%d,\"current\":%s}",
+                model->context->num_nodes * model->context->analysis.spatial_dimension, model->solves,
+                model->solves > 0 && model->stiffness_current && model->loads_current ? "true" : "false");
+    }
+    fprintf(out, "]}\n");
+}
+
+/* Commands that act on one model run with its context bound */
+static fem_error_t service_model_command(service_t *service, int argc, char **argv,
+                                         double start_time, FILE *out)
+{
+    service_model_t *model = NULL;
+    fem_context_t *previous;
+    int cached = 0;
+    fem_error_t err;
+
+    if (argc < 2) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Missing model path");
+    }
+    err = service_get_model(service, argv[1], &model, &cached);
+    CHECK_ERROR(err);
+
+    previous = fem_context_bind(model->context);
+    if (strcmp(argv[0], "load") == 0) {
+        err = service_cmd_load(model, cached, start_time, out);
+    } else if (strcmp(argv[0], "force") == 0) {
+        err = service_cmd_force(model, argc, argv, out);
+    } else if (strcmp(argv[0], "material") == 0) {
+        err = service_cmd_material(model, argc, argv, out);
+    } else if (strcmp(argv[0], "solve") == 0) {
+        err = service_cmd_solve(model, argc, argv, start_time, out);
+    } else {
+        err = service_cmd_displacement(model, argc, argv, out);
+    }
+    fem_context_bind(previous);
+    return err;
+}
+
+/* Execute one request line and write its response */
+static void service_handle_request(service_t *service, char *line, FILE *out)
+{
+    char *argv[SERVICE_MAX_ARGS + 1];
+    int argc = service_split(line, argv);
+    double start_time = fem_wall_time();
+    fem_error_t err = FEM_SUCCESS;
+
+    error_clear();
+    if (argc == 0) {
+        return;
+    }
+    if (argc < 0) {
+        err = error_set(FEM_ERROR_INVALID_INPUT, "Too many arguments");
+    } else if (strcmp(argv[0], "load") == 0 || strcmp(argv[0], "force") == 0 ||
+               strcmp(argv[0], "material") == 0 || strcmp(argv[0], "solve") == 0 ||
+               strcmp(argv[0], "displacement") == 0) {
+        err = service_model_command(service, argc, argv, start_time, out);
+    } else if (strcmp(argv[0], "unload") == 0 && argc == 2) {
+        int index = service_find_model(service, argv[1]);
+        if (index < 0) {
+            err = error_set(FEM_ERROR_INVALID_INPUT, "Model not loaded: %s", argv[1]);
+        } else {
+            service_release_model(&service->models[index]);
+            service->models[index] = service->models[--service->num_models];
+            fprintf(out, "{\"ok\":true}\n");
+        }
+    } else if (strcmp(argv[0], "status") == 0) {
+        service_cmd_status(service, out);
+    } else if (strcmp(argv[0], "shutdown") == 0) {
+        service->running = 0;
+        fprintf(out, "{\"ok\":true}\n");
+    } else {
+        err = error_set(FEM_ERROR_INVALID_INPUT, "Unknown request: %s", argv[0]);
+    }
+
+    if (err != FEM_SUCCESS) {
+        fprintf(out, "{\"ok\":false,\"error\":%d,\"message\":", err);
+        service_json_string(out, error_get_last() == err ? error_get_message() : error_get_string(err));
+        fprintf(out, "}\n");
+    }
+}
+
+#ifndef _WIN32
+
+/* Remove a stale socket left at socket_path by a service that exited
+ * without cleaning up. A socket that still accepts connections belongs to
+ * a running service, and any other file is the user's, so both are errors. */
+static fem_error_t service_remove_stale(const char *socket_path,
+                                        const struct sockaddr_un *address)
+{
+    struct stat info;
+    int fd;
+    int in_use;
+
+    if (lstat(socket_path, &info) != 0) {
+        if (errno == ENOENT) {
+            return FEM_SUCCESS;
+        }
+        return error_set(FEM_ERROR_FILE_WRITE, "Cannot check %s: %s", socket_path, strerror(errno));
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        return error_set(FEM_ERROR_FILE_WRITE, "%s exists and is not a socket; not replacing it",
+                         socket_path);
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return error_set(FEM_ERROR_UNKNOWN, "Cannot create socket: %s", strerror(errno));
+    }
+    in_use = connect(fd, (const struct sockaddr *)address, sizeof(*address)) == 0;
+    close(fd);
+    if (in_use) {
+        return error_set(FEM_ERROR_FILE_WRITE, "Socket %s is already in use by a running service",
+                         socket_path);
+    }
+    if (unlink(socket_path) != 0 && errno != ENOENT) {
+        return error_set(FEM_ERROR_FILE_WRITE, "Cannot remove stale socket %s: %s", socket_path,
+                         strerror(errno));
+    }
+    return FEM_SUCCESS;
+}
+
+static fem_error_t service_listen(const char *socket_path, int *listen_fd)
+{
+    struct sockaddr_un address;
+    fem_error_t err;
+    int fd;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Socket path too long: %s", socket_path);
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+
+    err = service_remove_stale(socket_path, &address);
+    CHECK_ERROR(err);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return error_set(FEM_ERROR_UNKNOWN, "Cannot create socket: %s", strerror(errno));
+    }
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 8) != 0) {
+        err = error_set(FEM_ERROR_FILE_WRITE, "Cannot listen on %s: %s",
+                        socket_path, strerror(errno));
+        close(fd);
+        return err;
+    }
+    *listen_fd = fd;
+    return FEM_SUCCESS;
+}
+
+/* Serve requests of one connection until it closes or shutdown is requested */
+static void service_serve_client(service_t *service, int client_fd)
+{
+    char line[SERVICE_LINE_LEN];
+    int out_fd = dup(client_fd);
+    FILE *in = fdopen(client_fd, "r");
+    FILE *out = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+
+    if (!in || !out) {
+        if (in) {
+            fclose(in);
+        } else {
+            close(client_fd);
+        }
+        if (out) {
+            fclose(out);
+        } else if (out_fd >= 0) {
+            close(out_fd);
+        }
+        return;
+    }
+
+    while (service->running && fgets(line, sizeof(line), in)) {
+        if (strchr(line, '\n') == NULL && !feof(in)) {
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n') {
+            }
+            fprintf(out, "{\"ok\":false,\"error\":%d,\"message\":\"Request too long\"}\n",
+                    FEM_ERROR_INVALID_INPUT);
+        } else {
+            service_handle_request(service, line, out);
+        }
+        fflush(out);
+        fflush(stdout);
+    }
+    fclose(in);
+    fclose(out);
+}
+
+#endif
+
+fem_error_t service_run(const char *socket_path, int max_models)
+{
+#ifdef _WIN32
+    (void)socket_path;
+    (void)max_models;
+    return error_set(FEM_ERROR_INVALID_INPUT, "Service mode requires UNIX-domain sockets");
+#else
+    service_t service;
+    int listen_fd = -1;
+    fem_error_t err;
+
+    memset(&service, 0, sizeof(service));
+    service.max_models = max_models > 0 ? max_models : SERVICE_DEFAULT_MODELS;
+    service.models = (service_model_t *)calloc((size_t)service.max_models, sizeof(service_model_t));
+    CHECK_NULL(service.models, "Failed to allocate model cache");
+
+    err = service_listen(socket_path, &listen_fd);
+    if (err != FEM_SUCCESS) {
+        free(service.models);
+        return err;
+    }
+
+    /* A client that disconnects early must not terminate the service */
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Service listening on %s (model cache: %d)\n", socket_path, service.max_models);
+    fflush(stdout);
+
+    service.running = 1;
+    while (service.running) {
+        int client_fd = accept(listen_fd, NULL, NULL);
+        if (client_fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            err = error_set(FEM_ERROR_UNKNOWN, "accept failed: %s", strerror(errno));
+            break;
+        }
+        service_serve_client(&service, client_fd);
+    }
+
+    close(listen_fd);
+    unlink(socket_path);
+    for (int i = 0; i < service.num_models; ++i) {
+        service_release_model(&service.models[i]);
+    }
+    free(service.models);
+
+    printf("Service stopped\n");
+    return err;
+#endif
+}
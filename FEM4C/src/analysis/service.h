@@ -0,0 +1,33 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Resident solver service
+ *
+ * A long-lived process that keeps parsed models warm and answers requests
+ * on a local UNIX-domain socket. Each cached model owns an analysis
+ * context holding its mesh, assembled skyline stiffness and last solution;
+ * the least recently used model is dropped when the cache is full.
+ *
+ * Protocol: one request per line, one JSON object per response line.
+ *   load <model>                            parse and validate (cold)
+ *   force <model> <node_id> <fx> <fy> [fz]  set a nodal load (fz: solids)
+ *   material <model> <material_id> <E> <nu> change a material
+ *   solve <model> [output]                  re-solve, optionally write results
+ *   displacement <model> <node_id>          read a nodal displacement
+ *   unload <model> | status | shutdown
+ * <model> is the input path; commands other than load/unload load it on
+ * first use. After load changes the assembled stiffness is reused and CG
+ * starts from the previous solution; material changes re-assemble into
+ * the existing skyline profile.
+ */
+
+#include "../common/types.h"
+
+#define SERVICE_DEFAULT_MODELS 8
+
+/* Serve requests on socket_path until a shutdown request arrives.
+ * max_models <= 0 selects SERVICE_DEFAULT_MODELS. */
+fem_error_t service_run(const char *socket_path, int max_models);
+
+#endif /* SERVICE_H */
@@ -6,25 +6,78 @@
 #include "../common/constants.h"
 #include "../common/globals.h"
 #include "../common/error.h"
+#include "../common/fem_log.h"
 #include "../io/input.h"
 #include "../io/output.h"
+#include "../io/async_output.h"
 #include "../solver/assembly.h"
 #include "../solver/cg_solver.h"
+#include "../solver/pipeline.h"
+#include "../solver/block_assembly.h"
+#include "../solver/block_pcg.h"
+#include "../solver/mpc.h"
+#include "../solver/skyline_ooc.h"
+#include "../solver/sparse_cholesky.h"
+#include "../solver/krylov_recycle.h"
+#include "stress_recovery.h"
 #include "../elements/t6/t6_stiffness.h"
 #include "../elements/t3/t3_element.h"
 #include "../elements/q4/q4_element.h"
+#include "../elements/solid3d/solid3d_element.h"
 #include "../elements/elements.h"
+#include "../mesh/mesh_quality.h"
 #include <time.h>
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
 #include <stdlib.h>
 
+/* Replace the extension of output_filename (or append one) */
+void static_result_filename(char *dest, const char *output_filename, const char *extension)
+{
+    strcpy(dest, output_filename);
+    char *dot = strrchr(dest, '.');
+    if (dot) {
+        strcpy(dot, extension);
+    } else {
+        strcat(dest, extension);
+    }
+}
+
+/* Linear solver of static analysis, chosen with FEM4C_SOLVER */
+typedef enum {
+    STATIC_SOLVER_CG,               /* conjugate gradients, block PCG for solids (default) */
+    STATIC_SOLVER_OUT_OF_CORE,      /* "ooc": file-backed skyline LDL^T (skyline_ooc.h) */
+    STATIC_SOLVER_CHOLESKY,         /* "cholesky": supernodal sparse Cholesky (sparse_cholesky.h) */
+    STATIC_SOLVER_RECYCLE           /* "recycle": PCG deflated across solves (krylov_recycle.h) */
+} static_solver_t;
+
+static static_solver_t static_selected_solver(void)
+{
+    const char *setting = getenv("FEM4C_SOLVER");
+
+    if (setting == NULL || setting[0] == '\0' || strcmp(setting, "cg") == 0) {
+        return STATIC_SOLVER_CG;
+    }
+    if (strcmp(setting, "ooc") == 0) {
+        return STATIC_SOLVER_OUT_OF_CORE;
+    }
+    if (strcmp(setting, "cholesky") == 0) {
+        return STATIC_SOLVER_CHOLESKY;
+    }
+    if (strcmp(setting, "recycle") == 0) {
+        return STATIC_SOLVER_RECYCLE;
+    }
+    FEM_LOG_WARN("  Warning: unknown FEM4C_SOLVER '%s'; using CG\n", setting);
+    return STATIC_SOLVER_CG;
+}
+
 /* Main static analysis function */
 fem_error_t static_analysis(const char* input_filename, const char* output_filename)
 {
     fem_error_t err;
     clock_t start_time, end_time;
+    char vtk_filename[MAX_FILENAME_LEN];
     
     printf("FEM4C Static Analysis\n");
     printf("====================\n\n");
@@ -39,13 +92,19 @@ fem_error_t static_analysis(const char* input_filename, const char* output_filen
     err = static_analysis_preprocessing(input_filename);
     CHECK_ERROR(err);
     
+    /* Stream VTK geometry while the system is assembled and solved */
+    static_result_filename(vtk_filename, output_filename, ".vtk");
+    if (async_output_begin_geometry(vtk_filename) != FEM_SUCCESS) {
+        printf("  Warning: VTK geometry could not be started early\n");
+    }
+    
     /* Solution phase */
     err = static_analysis_solve();
-    CHECK_ERROR(err);
+    CHECK_ERROR_CLEANUP(err, async_output_cancel());
     
-    /* Postprocessing phase */
+    /* Postprocessing phase (result writers keep running in the background) */
     err = static_analysis_postprocessing(output_filename);
-    CHECK_ERROR(err);
+    CHECK_ERROR_CLEANUP(err, async_output_cancel());
     
     /* Finalize analysis */
     err = static_analysis_finalize();
@@ -57,6 +116,7 @@ fem_error_t static_analysis(const char* input_filename, const char* output_filen
     printf("\nStatic Analysis Complete\n");
     printf("========================\n");
     printf("Total elapsed time: %.3f seconds\n", g_solver_info.elapsed_time);
+    fem_memory_report(stdout);
     
     return FEM_SUCCESS;
 }
@@ -93,14 +153,21 @@ fem_error_t static_analysis_preprocessing(const char* input_filename)
     printf("Phase 2: Preprocessing\n");
     printf("----------------------\n");
     
+    /* Element blocks go to the pipeline worker while the file is read */
+    err = pipeline_begin();
+    CHECK_ERROR(err);
+    
     /* Read input data */
     printf("  Reading input file: %s\n", input_filename);
     err = input_read_data(input_filename);
+    CHECK_ERROR_CLEANUP(err, pipeline_cancel());
+    
+    err = pipeline_wait();
     CHECK_ERROR(err);
     
     /* Validate input */
     err = static_validate_input();
-    CHECK_ERROR(err);
+    CHECK_ERROR_CLEANUP(err, pipeline_cancel());
     
     /* Print problem summary */
     printf("  Problem summary:\n");
@@ -163,11 +230,18 @@ fem_error_t static_analysis_postprocessing(const char* output_filename)
 fem_error_t static_analysis_finalize(void)
 {
     fem_error_t err;
+    fem_error_t output_err;
+    
+    /* Result writers read the model arrays until they are joined */
+    output_err = async_output_join();
+    skyline_ooc_release();
+    sparse_cholesky_release();
+    krylov_recycle_release();
     
     err = globals_finalize();
     CHECK_ERROR(err);
     
-    return FEM_SUCCESS;
+    return output_err;
 }
 
 /* Assemble system matrices */
@@ -177,12 +251,55 @@ fem_error_t static_assemble_system(void)
     
     printf("  Assembling system matrices...\n");
     
+    static_solver_t solver = static_selected_solver();
+    
+    /* A factor belongs to the matrix it was computed from; a recycle
+     * space outlives it but has its products with K formed again */
+    sparse_cholesky_release();
+    if (solver == STATIC_SOLVER_RECYCLE) {
+        err = krylov_recycle_prepare();
+        CHECK_ERROR(err);
+    } else {
+        krylov_recycle_release();
+    }
+    
+    /* Solids: 3x3 block storage, coloured parallel assembly */
+    if (g_analysis.spatial_dimension == 3) {
+        if (solver == STATIC_SOLVER_OUT_OF_CORE) {
+            FEM_LOG_WARN("  Warning: FEM4C_SOLVER=ooc applies to plane models; using block PCG\n");
+        }
+        err = block_assembly_stiffness_matrix();
+        CHECK_ERROR(err);
+        err = assembly_global_force_vector();
+        CHECK_ERROR(err);
+        err = block_assembly_apply_boundary_conditions();
+        CHECK_ERROR(err);
+        err = block_assembly_check_matrix_properties();
+        CHECK_ERROR(err);
+        if (solver == STATIC_SOLVER_CHOLESKY) {
+            return sparse_cholesky_analyze();
+        }
+        return FEM_SUCCESS;
+    }
+    
+    /* Panels assembled and constrained straight into the scratch file;
+     * pipelined element matrices would need the in-core profile */
+    if (solver == STATIC_SOLVER_OUT_OF_CORE) {
+        pipeline_cancel();
+        return skyline_ooc_assemble(NULL);
+    }
+    skyline_ooc_release();
+    
     /* Assemble global stiffness matrix */
+    if (pipeline_active()) {
+        err = pipeline_assemble_stiffness();
+    } else {
 #ifdef _OPENMP
-    err = assembly_parallel_stiffness_matrix();
+        err = assembly_parallel_stiffness_matrix();
 #else
-    err = assembly_global_stiffness_matrix();
+        err = assembly_global_stiffness_matrix();
 #endif
+    }
     CHECK_ERROR(err);
     
     /* Assemble global force vector */
@@ -197,6 +314,12 @@ fem_error_t static_assemble_system(void)
     err = assembly_check_matrix_properties();
     CHECK_ERROR(err);
     
+    /* Ordering and symbolic factorization; the values are factored at the
+     * first solve */
+    if (solver == STATIC_SOLVER_CHOLESKY) {
+        return sparse_cholesky_analyze();
+    }
+    
     return FEM_SUCCESS;
 }
 
@@ -207,8 +330,20 @@ fem_error_t static_solve_equations(void)
     
     printf("  Solving system of equations...\n");
     
-    /* Solve using conjugate gradient method */
-    err = cg_solve_system();
+    /* The sparse or out-of-core factor if the system was assembled for
+     * one; otherwise block PCG for solids and conjugate gradients for
+     * plane models, Jacobi PCG when recycling */
+    if (sparse_cholesky_active()) {
+        err = sparse_cholesky_solve_system();
+    } else if (g_analysis.spatial_dimension == 3) {
+        err = block_pcg_solve_system();
+    } else if (skyline_ooc_active()) {
+        err = skyline_ooc_solve_system();
+    } else if (krylov_recycle_active()) {
+        err = pcg_solve_system();
+    } else {
+        err = cg_solve_system();
+    }
     CHECK_ERROR(err);
     
     /* Check equilibrium */
@@ -217,6 +352,42 @@ fem_error_t static_solve_equations(void)
         printf("  Warning: Equilibrium check failed\n");
     }
     
+    /* Dependent DOFs of multipoint constraints from their masters */
+    if (mpc_active()) {
+        mpc_recover_displacements(g_global_displ);
+    }
+    
+    /* Reactions from the constrained rows kept before the BCs */
+    err = static_calculate_reactions();
+    if (err != FEM_SUCCESS) {
+        printf("  Warning: Reaction calculation failed: %s\n", error_get_message());
+    }
+    
+    return FEM_SUCCESS;
+}
+
+/* Calculate reaction forces and report their sums */
+fem_error_t static_calculate_reactions(void)
+{
+    fem_error_t err;
+    double sum[3] = {0.0, 0.0, 0.0};
+    int dofs = g_dof_per_node;
+    
+    err = assembly_compute_reactions();
+    CHECK_ERROR(err);
+    
+    for (int r = 0; r < g_reaction_dof_count; r++) {
+        int dof = g_reaction_dofs[r];
+        sum[dof % dofs] += g_node_reaction[dof / dofs][dof % dofs];
+    }
+    if (dofs == 3) {
+        printf("    Reaction sum: RX = %e, RY = %e, RZ = %e (%d constrained DOFs)\n",
+               sum[0], sum[1], sum[2], g_reaction_dof_count);
+    } else {
+        printf("    Reaction sum: RX = %e, RY = %e (%d constrained DOFs)\n",
+               sum[0], sum[1], g_reaction_dof_count);
+    }
+    
     return FEM_SUCCESS;
 }
 
@@ -225,97 +396,57 @@ fem_error_t static_calculate_stresses(void)
 {
     fem_error_t err;
     int element_id;
-    double stress[T6_STRESS_COMPONENTS];
     
     printf("  Calculating element stresses...\n");
     
-    /* Calculate stresses for all elements */
-    for (element_id = 0; element_id < g_num_elements; element_id++) {
-        if (g_element_type[element_id] == ELEMENT_T6) {
-            err = t6_calculate_element_stress(element_id, stress);
-            if (err != FEM_SUCCESS) {
-                printf("  Warning: Stress calculation failed for element %d\n", element_id + 1);
-                continue;
-            }
-
-            /* Store stresses (placeholder - would need global stress storage) */
-            /* For now, just validate the calculation worked */
-        } else if (g_element_type[element_id] == ELEMENT_T3) {
-            err = t3_element_stress(element_id, stress);
-            if (err != FEM_SUCCESS) {
-                printf("  Warning: Stress calculation failed for T3 element %d\n", element_id + 1);
-                continue;
-            }
-        } else if (g_element_type[element_id] == ELEMENT_Q4) {
-            err = q4_element_stress(element_id, stress);
-            if (err != FEM_SUCCESS) {
-                printf("  Warning: Stress calculation failed for Q4 element %d\n", element_id + 1);
-                continue;
-            }
+    /* Centroid, Gauss-point and nodal stresses of all elements in one
+     * parallel pass; the result writers read them from the model */
+    err = stress_recovery_compute();
+    CHECK_ERROR(err);
+    
+    for (element_id = 0; element_id < g_stress_element_count; element_id++) {
+        int type = g_element_type[element_id];
+        if (!g_element_stress_valid[element_id] &&
+            (type == ELEMENT_T3 || type == ELEMENT_Q4 || type == ELEMENT_T6 ||
+             solid3d_is_solid_type(type))) {
+            printf("  Warning: Stress calculation failed for element %d\n", element_id + 1);
         }
     }
     
     return FEM_SUCCESS;
 }
 
-/* Write analysis results */
+/* Write analysis results. The writers run on background threads; they are
+ * joined in static_analysis_finalize(). */
 fem_error_t static_write_results(const char* output_filename)
 {
     fem_error_t err;
     char vtk_filename[MAX_FILENAME_LEN];
     char csv_filename[MAX_FILENAME_LEN];
+    char f06_filename[MAX_FILENAME_LEN];
     
     printf("  Writing results to: %s\n", output_filename);
 
     /* Write CSV export (nodal displacements & element stresses) */
-    strcpy(csv_filename, output_filename);
-    char *dot_csv = strrchr(csv_filename, '.');
-    if (dot_csv) {
-        strcpy(dot_csv, ".csv");
-    } else {
-        strcat(csv_filename, ".csv");
-    }
-    err = output_export_csv(csv_filename);
-    if (err != FEM_SUCCESS) {
-        printf("  Warning: CSV export failed (%s)\n", error_get_string(err));
-    }
+    static_result_filename(csv_filename, output_filename, ".csv");
+    err = async_output_submit(ASYNC_OUTPUT_CSV, csv_filename);
+    CHECK_ERROR(err);
     
     /* Write standard results */
-    err = output_write_results(output_filename);
+    err = async_output_submit(ASYNC_OUTPUT_DAT, output_filename);
     CHECK_ERROR(err);
     
-    /* Create VTK filename */
-    strcpy(vtk_filename, output_filename);
-    char* dot = strrchr(vtk_filename, '.');
-    if (dot) {
-        strcpy(dot, ".vtk");
-    } else {
-        strcat(vtk_filename, ".vtk");
-    }
-    
-    /* Write VTK results */
+    /* Write VTK results (appends to the geometry streamed during the solve) */
+    static_result_filename(vtk_filename, output_filename, ".vtk");
     printf("  Writing VTK results to: %s\n", vtk_filename);
-    err = output_write_vtk_file(vtk_filename);
-    if (err != FEM_SUCCESS) {
-        printf("  Warning: VTK output failed, continuing...\n");
-    }
-
-    /* Create F06 filename for Nastran-compatible output */
-    char f06_filename[MAX_FILENAME_LEN];
-    strcpy(f06_filename, output_filename);
-    dot = strrchr(f06_filename, '.');
-    if (dot) {
-        strcpy(dot, ".f06");
-    } else {
-        strcat(f06_filename, ".f06");
-    }
+    err = async_output_submit(ASYNC_OUTPUT_VTK, vtk_filename);
+    CHECK_ERROR(err);
 
-    /* Write F06 results */
+    /* Write F06 results for Nastran-compatible output */
+    static_result_filename(f06_filename, output_filename, ".f06");
     printf("  Writing Nastran F06 results to: %s\n", f06_filename);
-    err = output_write_nastran_f06_file(f06_filename);
-    if (err != FEM_SUCCESS) {
-        printf("  Warning: F06 output failed, continuing...\n");
-    }
+    err = async_output_submit(ASYNC_OUTPUT_F06, f06_filename);
+    CHECK_ERROR(err);
 
     return FEM_SUCCESS;
 }
@@ -333,8 +464,20 @@ fem_error_t static_validate_input(void)
         return error_set(FEM_ERROR_INVALID_INPUT, "Invalid problem size");
     }
     
-    /* Validate all elements */
+    /* Validate all elements in one pass; the kernels reuse its results.
+     * The pipelined reader has already done this if it covered the mesh. */
+    if (pipeline_active() && g_element_quality_count == g_num_elements) {
+        mesh_quality_report();
+    } else {
+        err = mesh_validate_elements();
+        CHECK_ERROR(err);
+    }
+
+    /* Report the first element the pass rejected */
     for (element_id = 0; element_id < g_num_elements; element_id++) {
+        if (mesh_validated_element(element_id)) {
+            continue;
+        }
         if (g_element_type[element_id] == ELEMENT_T6) {
             err = t6_validate_element(element_id);
             if (err != FEM_SUCCESS) {
@@ -356,6 +499,13 @@ fem_error_t static_validate_input(void)
                 return error_set(FEM_ERROR_INVALID_INPUT,
                                "Element validation failed for element %d", element_id + 1);
             }
+        } else if (solid3d_is_solid_type(g_element_type[element_id])) {
+            err = solid3d_validate_element(element_id);
+            if (err != FEM_SUCCESS) {
+                fprintf(stderr, "[validate] solid3d_validate_element error: %s\n", error_get_message());
+                return error_set(FEM_ERROR_INVALID_INPUT,
+                               "Element validation failed for element %d", element_id + 1);
+            }
         } else {
             return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
                            "Unsupported element type %d in element %d",
@@ -389,12 +539,20 @@ fem_error_t static_check_equilibrium(void)
         return FEM_SUCCESS;
     }
 
-    double *ku = malloc((size_t)g_total_dof * sizeof(double));
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    double *ku = fem_arena_alloc(&g_scratch_arena, (size_t)g_total_dof * sizeof(double));
     CHECK_NULL(ku, "Residual workspace allocation failed");
 
-    fem_error_t err = cg_matrix_vector_multiply(NULL, g_global_displ, ku, g_total_dof);
+    fem_error_t err;
+    if (g_analysis.spatial_dimension == 3) {
+        err = block_pcg_multiply(g_global_displ, ku);
+    } else if (skyline_ooc_active()) {
+        err = skyline_ooc_multiply(g_global_displ, ku);
+    } else {
+        err = cg_matrix_vector_multiply(NULL, g_global_displ, ku, g_total_dof);
+    }
     if (err != FEM_SUCCESS) {
-        free(ku);
+        fem_arena_rewind(&g_scratch_arena, scratch);
         return err;
     }
 
@@ -406,7 +564,7 @@ fem_error_t static_check_equilibrium(void)
         }
     }
 
-    free(ku);
+    fem_arena_rewind(&g_scratch_arena, scratch);
 
     printf("    Maximum residual: %e\n", max_residual);
 
@@ -21,8 +21,12 @@ fem_error_t static_analysis_finalize(void);
 fem_error_t static_assemble_system(void);
 fem_error_t static_solve_equations(void);
 fem_error_t static_calculate_stresses(void);
+fem_error_t static_calculate_reactions(void);
 fem_error_t static_write_results(const char* output_filename);
 
+/* Result file name: output_filename with its extension replaced (or appended) */
+void static_result_filename(char *dest, const char *output_filename, const char *extension);
+
 /* Validation and verification */
 fem_error_t static_validate_input(void);
 fem_error_t static_check_equilibrium(void);
@@ -0,0 +1,877 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Stress recovery implementation
+ */
+
+#include "stress_recovery.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_log.h"
+#include "../common/fem_memory.h"
+#include "../elements/element_base.h"
+#include "../elements/t3/t3_element.h"
+#include "../elements/q4/q4_element.h"
+#include "../elements/t6/t6_element.h"
+#include "../elements/t6/t6_stiffness.h"
+#include "../elements/solid3d/solid3d_element.h"
+#include "../mesh/mesh_quality.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Below this many elements (nodes) a pass runs on the calling thread only */
+#define STRESS_RECOVERY_PARALLEL_MIN 256
+
+/* Largest SPR polynomial: 1, x, y, xy, x^2, y^2 */
+#define SPR_MAX_TERMS 6
+
+/* Natural coordinates of the element nodes, in connectivity order */
+static const double g_q4_node_natural[Q4_NODES_PER_ELEMENT][2] = {
+    {-1.0, -1.0}, {1.0, -1.0}, {1.0, 1.0}, {-1.0, 1.0}
+};
+static const double g_t6_node_natural[T6_NODES_PER_ELEMENT][2] = {
+    {0.0, 0.0}, {1.0, 0.0}, {0.0, 1.0}, {0.5, 0.0}, {0.5, 0.5}, {0.0, 0.5}
+};
+
+/* Per-element workspace of one recovery pass */
+typedef struct {
+    int *slot_offsets;         /* Element-nodal values of element e start here */
+    double (*element_nodal)[3]; /* Gauss-point stresses extrapolated to the nodes */
+    int *node_patch_offsets;   /* Elements around node n: [offsets[n], offsets[n + 1]) */
+    int *node_patch_slots;     /* Element-nodal slot of the node in that element */
+    int *node_patch_elements;
+} stress_recovery_work_t;
+
+double stress_von_mises(const double stress[3])
+{
+    double sx = stress[0];
+    double sy = stress[1];
+    double txy = stress[2];
+
+    return sqrt(sx * sx + sy * sy - sx * sy + 3.0 * txy * txy);
+}
+
+void stress_principal(const double stress[3], double *sigma_max, double *sigma_min)
+{
+    double avg = 0.5 * (stress[0] + stress[1]);
+    double diff = 0.5 * (stress[0] - stress[1]);
+    double radius = sqrt(diff * diff + stress[2] * stress[2]);
+
+    *sigma_max = avg + radius;
+    *sigma_min = avg - radius;
+}
+
+int stress_recovery_available(void)
+{
+    return (g_element_stress != NULL || g_solid_stress != NULL) && g_num_elements > 0 &&
+           g_stress_element_count == g_num_elements;
+}
+
+int stress_recovery_failed_count(void)
+{
+    int failed = 0;
+
+    for (int e = 0; e < g_stress_element_count; ++e) {
+        if (!g_element_stress_valid[e]) {
+            failed++;
+        }
+    }
+    return failed;
+}
+
+static int stress_recovery_node_count(int type)
+{
+    switch (type) {
+        case ELEMENT_T3: return T3_NODES_PER_ELEMENT;
+        case ELEMENT_Q4: return Q4_NODES_PER_ELEMENT;
+        case ELEMENT_T6: return T6_NODES_PER_ELEMENT;
+        default:         return 0;
+    }
+}
+
+static int stress_recovery_point_count(int type)
+{
+    switch (type) {
+        case ELEMENT_T3: return T3_GAUSS_POINTS;
+        case ELEMENT_Q4: return Q4_GAUSS_POINTS;
+        case ELEMENT_T6: return T6_GAUSS_POINTS;
+        default:         return 0;
+    }
+}
+
+/* sigma = D * B * u with the loop order of the element stress kernels, so
+ * centroid results match them bit for bit */
+static void stress_recovery_apply(const double *B, int dof, const double D[3][3],
+                                  const double *displ, double stress[3])
+{
+    double strain[3] = {0.0, 0.0, 0.0};
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < dof; j++) {
+            strain[i] += B[i * dof + j] * displ[j];
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        stress[i] = 0.0;
+        for (int j = 0; j < 3; j++) {
+            stress[i] += D[i][j] * strain[j];
+        }
+    }
+}
+
+static fem_error_t stress_recovery_point(int element_id, int type, double xi, double eta,
+                                         const double D[3][3], const double *displ,
+                                         double stress[3])
+{
+    fem_error_t err;
+
+    switch (type) {
+        case ELEMENT_T3: {
+            double B[T3_STRAIN_COMPONENTS][T3_TOTAL_DOF];
+            err = t3_strain_displacement_matrix(element_id, xi, eta, B);
+            CHECK_ERROR(err);
+            stress_recovery_apply(&B[0][0], T3_TOTAL_DOF, D, displ, stress);
+            break;
+        }
+        case ELEMENT_Q4: {
+            double B[Q4_STRAIN_COMPONENTS][Q4_TOTAL_DOF];
+            err = q4_strain_displacement_matrix(element_id, xi, eta, B);
+            CHECK_ERROR(err);
+            stress_recovery_apply(&B[0][0], Q4_TOTAL_DOF, D, displ, stress);
+            break;
+        }
+        case ELEMENT_T6: {
+            double B[T6_STRAIN_COMPONENTS][T6_TOTAL_DOF];
+            err = t6_strain_displacement_matrix(element_id, xi, eta, B);
+            CHECK_ERROR(err);
+            stress_recovery_apply(&B[0][0], T6_TOTAL_DOF, D, displ, stress);
+            break;
+        }
+        default:
+            return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                             "Unsupported element type %d for stress recovery", type);
+    }
+    return FEM_SUCCESS;
+}
+
+/* Displacements and material matrix, obtained the way the element stress
+ * kernels do */
+static fem_error_t stress_recovery_element_state(int element_id, int type,
+                                                 double D[3][3], double *displ)
+{
+    int material_id = g_element_material[element_id];
+    fem_error_t err;
+
+    if (material_id < 0 || material_id >= g_num_materials) {
+        return error_set(FEM_ERROR_INVALID_MATERIAL,
+                         "Invalid material for element %d", element_id + 1);
+    }
+
+    switch (type) {
+        case ELEMENT_T3:
+            err = t3_get_element_displacements(element_id, displ);
+            CHECK_ERROR(err);
+            return element_2d_material_matrix_plane_stress(material_id, D);
+        case ELEMENT_Q4:
+            err = q4_get_element_displacements(element_id, displ);
+            CHECK_ERROR(err);
+            return q4_material_matrix(material_id, D);
+        case ELEMENT_T6:
+            if (!mesh_validated_element(element_id)) {
+                err = t6_validate_element(element_id);
+                CHECK_ERROR(err);
+            }
+            if (g_material_type[material_id] == MATERIAL_PLANE_STRESS) {
+                err = t6_material_matrix_plane_stress(g_material_props[material_id][0],
+                                                      g_material_props[material_id][1], D);
+            } else {
+                err = t6_material_matrix_plane_strain(g_material_props[material_id][0],
+                                                      g_material_props[material_id][1], D);
+            }
+            CHECK_ERROR(err);
+            return t6_get_element_displacements(element_id, displ);
+        default:
+            return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                             "Unsupported element type %d for stress recovery", type);
+    }
+}
+
+/* Centroid and Gauss-point stresses of one element, the physical Gauss
+ * point coordinates and the Gauss-point field extrapolated to the nodes */
+static fem_error_t stress_recovery_element(int element_id, double centroid[3],
+                                           double (*gauss_stress)[3],
+                                           double (*gauss_coords)[2],
+                                           double (*nodal)[3])
+{
+    int type = g_element_type[element_id];
+    int nodes = stress_recovery_node_count(type);
+    double D[3][3];
+    double displ[MAX_DOF_PER_NODE * MAX_NODES_PER_ELEMENT];
+    double N[MAX_NODES_PER_ELEMENT];
+    fem_error_t err;
+
+    err = stress_recovery_element_state(element_id, type, D, displ);
+    CHECK_ERROR(err);
+
+    switch (type) {
+        case ELEMENT_T3:
+            /* Constant strain: the single Gauss point is the centroid */
+            err = stress_recovery_point(element_id, type, 1.0/3.0, 1.0/3.0, D, displ, centroid);
+            CHECK_ERROR(err);
+            memcpy(gauss_stress[0], centroid, sizeof(double) * 3);
+            for (int k = 0; k < nodes; ++k) {
+                memcpy(nodal[k], centroid, sizeof(double) * 3);
+            }
+            break;
+
+        case ELEMENT_Q4:
+            err = stress_recovery_point(element_id, type, 0.0, 0.0, D, displ, centroid);
+            CHECK_ERROR(err);
+            for (int gp = 0; gp < Q4_GAUSS_POINTS; ++gp) {
+                err = stress_recovery_point(element_id, type, g_q4_gauss_points[gp][0],
+                                            g_q4_gauss_points[gp][1], D, displ, gauss_stress[gp]);
+                CHECK_ERROR(err);
+            }
+            /* Bilinear field through the 2x2 Gauss points; in coordinates
+             * scaled by 1/g (g = 1/sqrt(3)) the points sit at the corners */
+            for (int k = 0; k < nodes; ++k) {
+                double Ng[Q4_GAUSS_POINTS];
+                double g = fabs(g_q4_gauss_points[0][0]);
+                q4_shape_functions(g_q4_node_natural[k][0] / g, g_q4_node_natural[k][1] / g, Ng);
+                for (int c = 0; c < 3; ++c) {
+                    nodal[k][c] = 0.0;
+                    for (int gp = 0; gp < Q4_GAUSS_POINTS; ++gp) {
+                        nodal[k][c] += Ng[gp] * gauss_stress[gp][c];
+                    }
+                }
+            }
+            break;
+
+        case ELEMENT_T6:
+            err = stress_recovery_point(element_id, type, THIRD, THIRD, D, displ, centroid);
+            CHECK_ERROR(err);
+            for (int gp = 0; gp < T6_GAUSS_POINTS; ++gp) {
+                err = stress_recovery_point(element_id, type, g_t6_gauss_points[gp][0],
+                                            g_t6_gauss_points[gp][1], D, displ, gauss_stress[gp]);
+                CHECK_ERROR(err);
+            }
+            /* Linear field through the three Gauss points: they form a
+             * triangle with corner (1/6, 1/6) and legs of length 1/2 */
+            for (int k = 0; k < nodes; ++k) {
+                double Ng[T3_NODES_PER_ELEMENT];
+                double r = (g_t6_node_natural[k][0] - g_t6_gauss_points[0][0]) /
+                           (g_t6_gauss_points[1][0] - g_t6_gauss_points[0][0]);
+                double s = (g_t6_node_natural[k][1] - g_t6_gauss_points[0][1]) /
+                           (g_t6_gauss_points[2][1] - g_t6_gauss_points[0][1]);
+                t3_shape_functions(r, s, Ng);
+                for (int c = 0; c < 3; ++c) {
+                    nodal[k][c] = Ng[0] * gauss_stress[0][c] + Ng[1] * gauss_stress[1][c] +
+                                  Ng[2] * gauss_stress[2][c];
+                }
+            }
+            break;
+
+        default:
+            return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                             "Unsupported element type %d for stress recovery", type);
+    }
+
+    /* Physical coordinates of the Gauss points, for the SPR patches */
+    for (int gp = 0; gp < stress_recovery_point_count(type); ++gp) {
+        double xi = 1.0/3.0, eta = 1.0/3.0;
+
+        if (type == ELEMENT_Q4) {
+            xi = g_q4_gauss_points[gp][0];
+            eta = g_q4_gauss_points[gp][1];
+            q4_shape_functions(xi, eta, N);
+        } else if (type == ELEMENT_T6) {
+            xi = g_t6_gauss_points[gp][0];
+            eta = g_t6_gauss_points[gp][1];
+            t6_shape_functions(xi, eta, N);
+        } else {
+            t3_shape_functions(xi, eta, N);
+        }
+        gauss_coords[gp][0] = 0.0;
+        gauss_coords[gp][1] = 0.0;
+        for (int k = 0; k < nodes; ++k) {
+            int node = g_element_nodes[element_id][k];
+            gauss_coords[gp][0] += N[k] * g_node_coords[node][0];
+            gauss_coords[gp][1] += N[k] * g_node_coords[node][1];
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+/* Solve the SPR normal equations A a = b for three right-hand sides by
+ * Gaussian elimination with partial pivoting. Returns 0 if A is (nearly)
+ * singular. */
+static int stress_recovery_solve(double A[SPR_MAX_TERMS][SPR_MAX_TERMS],
+                                 double b[SPR_MAX_TERMS][3], int n)
+{
+    double scale = 0.0;
+
+    for (int i = 0; i < n; ++i) {
+        if (fabs(A[i][i]) > scale) {
+            scale = fabs(A[i][i]);
+        }
+    }
+    if (scale <= 0.0) {
+        return 0;
+    }
+
+    for (int col = 0; col < n; ++col) {
+        int pivot = col;
+        for (int row = col + 1; row < n; ++row) {
+            if (fabs(A[row][col]) > fabs(A[pivot][col])) {
+                pivot = row;
+            }
+        }
+        if (fabs(A[pivot][col]) < 1.0e-10 * scale) {
+            return 0;
+        }
+        if (pivot != col) {
+            for (int j = 0; j < n; ++j) {
+                double t = A[col][j]; A[col][j] = A[pivot][j]; A[pivot][j] = t;
+            }
+            for (int c = 0; c < 3; ++c) {
+                double t = b[col][c]; b[col][c] = b[pivot][c]; b[pivot][c] = t;
+            }
+        }
+        for (int row = col + 1; row < n; ++row) {
+            double f = A[row][col] / A[col][col];
+            for (int j = col; j < n; ++j) {
+                A[row][j] -= f * A[col][j];
+            }
+            for (int c = 0; c < 3; ++c) {
+                b[row][c] -= f * b[col][c];
+            }
+        }
+    }
+    for (int row = n - 1; row >= 0; --row) {
+        for (int c = 0; c < 3; ++c) {
+            double sum = b[row][c];
+            for (int j = row + 1; j < n; ++j) {
+                sum -= A[row][j] * b[j][c];
+            }
+            b[row][c] = sum / A[row][row];
+        }
+    }
+    return 1;
+}
+
+/* Fit a polynomial with the given number of terms to the Gauss-point
+ * stresses of the patch around node, in coordinates centred on the node
+ * and scaled to the patch size. The constant term is the nodal value. */
+static int stress_recovery_spr_fit(int node, const int *elements, int count, int terms,
+                                   double value[3])
+{
+    double A[SPR_MAX_TERMS][SPR_MAX_TERMS] = {{0.0}};
+    double b[SPR_MAX_TERMS][3] = {{0.0}};
+    double xn = g_node_coords[node][0];
+    double yn = g_node_coords[node][1];
+    double h = 0.0;
+    int samples = 0;
+
+    for (int i = 0; i < count; ++i) {
+        int e = elements[i];
+        for (fem_index_t p = g_gauss_stress_offsets[e]; p < g_gauss_stress_offsets[e + 1]; ++p) {
+            double dx = fabs(g_gauss_point_coords[p][0] - xn);
+            double dy = fabs(g_gauss_point_coords[p][1] - yn);
+            if (dx > h) h = dx;
+            if (dy > h) h = dy;
+            samples++;
+        }
+    }
+    /* A quadratic through exactly six points swings far off when they lie
+     * close to a conic (two T6 elements around a midside node) */
+    if (samples < terms || (terms == SPR_MAX_TERMS && samples == terms) || h <= 0.0) {
+        return 0;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        int e = elements[i];
+        for (fem_index_t p = g_gauss_stress_offsets[e]; p < g_gauss_stress_offsets[e + 1]; ++p) {
+            double x = (g_gauss_point_coords[p][0] - xn) / h;
+            double y = (g_gauss_point_coords[p][1] - yn) / h;
+            double P[SPR_MAX_TERMS] = {1.0, x, y, x * y, x * x, y * y};
+            for (int r = 0; r < terms; ++r) {
+                for (int c = 0; c < terms; ++c) {
+                    A[r][c] += P[r] * P[c];
+                }
+                for (int c = 0; c < 3; ++c) {
+                    b[r][c] += P[r] * g_gauss_stress[p][c];
+                }
+            }
+        }
+    }
+    if (!stress_recovery_solve(A, b, terms)) {
+        return 0;
+    }
+    value[0] = b[0][0];
+    value[1] = b[0][1];
+    value[2] = b[0][2];
+    return 1;
+}
+
+/* Averaged and SPR values of one node */
+static void stress_recovery_node(int node, const stress_recovery_work_t *work)
+{
+    int first = work->node_patch_offsets[node];
+    int count = work->node_patch_offsets[node + 1] - first;
+    const int *elements = work->node_patch_elements + first;
+    int all_q4 = count > 0;
+    int all_t6 = count > 0;
+    int terms;
+
+    for (int c = 0; c < 3; ++c) {
+        g_nodal_stress[node][c] = 0.0;
+    }
+    for (int i = 0; i < count; ++i) {
+        const double *value = work->element_nodal[work->node_patch_slots[first + i]];
+        for (int c = 0; c < 3; ++c) {
+            g_nodal_stress[node][c] += value[c];
+        }
+        all_q4 = all_q4 && g_element_type[elements[i]] == ELEMENT_Q4;
+        all_t6 = all_t6 && g_element_type[elements[i]] == ELEMENT_T6;
+    }
+    if (count > 0) {
+        for (int c = 0; c < 3; ++c) {
+            g_nodal_stress[node][c] /= count;
+        }
+    }
+
+    /* Linear for T3 patches, bilinear for Q4, quadratic for T6; lower
+     * orders are tried when the patch cannot support the full one */
+    terms = all_t6 ? 6 : (all_q4 ? 4 : 3);
+    for (; terms >= 3; terms = terms == 6 ? 3 : terms - 1) {
+        if (stress_recovery_spr_fit(node, elements, count, terms, g_nodal_stress_spr[node])) {
+            return;
+        }
+    }
+    memcpy(g_nodal_stress_spr[node], g_nodal_stress[node], sizeof(double) * 3);
+}
+
+static fem_error_t stress_recovery_allocate(fem_index_t points)
+{
+    size_t elements = (size_t)g_num_elements;
+    size_t nodes = (size_t)(g_num_nodes > 0 ? g_num_nodes : 1);
+
+    globals_free_stress_results();
+    g_element_stress = fem_malloc(elements * sizeof(*g_element_stress), FEM_MEMORY_VECTOR);
+    g_element_stress_valid = fem_calloc(elements, sizeof(*g_element_stress_valid), FEM_MEMORY_VECTOR);
+    g_gauss_stress_offsets = fem_malloc((elements + 1) * sizeof(*g_gauss_stress_offsets),
+                                        FEM_MEMORY_VECTOR);
+    g_gauss_stress = fem_malloc((size_t)(points > 0 ? points : 1) * sizeof(*g_gauss_stress),
+                                FEM_MEMORY_VECTOR);
+    g_gauss_point_coords = fem_malloc((size_t)(points > 0 ? points : 1) *
+                                      sizeof(*g_gauss_point_coords), FEM_MEMORY_VECTOR);
+    g_nodal_stress = fem_malloc(nodes * sizeof(*g_nodal_stress), FEM_MEMORY_VECTOR);
+    g_nodal_stress_spr = fem_malloc(nodes * sizeof(*g_nodal_stress_spr), FEM_MEMORY_VECTOR);
+
+    if (!g_element_stress || !g_element_stress_valid || !g_gauss_stress_offsets ||
+        !g_gauss_stress || !g_gauss_point_coords || !g_nodal_stress || !g_nodal_stress_spr) {
+        globals_free_stress_results();
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Failed to allocate stress results (%d elements)", g_num_elements);
+    }
+    return FEM_SUCCESS;
+}
+
+/* Slots of the element-nodal values and room for the node-to-element
+ * patches, in the scratch arena */
+static fem_error_t stress_recovery_build_patches(stress_recovery_work_t *work)
+{
+    size_t slots = 0;
+
+    work->slot_offsets = fem_arena_alloc(&g_scratch_arena,
+                                         (size_t)(g_num_elements + 1) * sizeof(int));
+    work->node_patch_offsets = fem_arena_alloc(&g_scratch_arena,
+                                               (size_t)(g_num_nodes + 1) * sizeof(int));
+    if (!work->slot_offsets || !work->node_patch_offsets) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate stress patches");
+    }
+    for (int e = 0; e < g_num_elements; ++e) {
+        work->slot_offsets[e] = (int)slots;
+        slots += (size_t)stress_recovery_node_count(g_element_type[e]);
+    }
+    work->slot_offsets[g_num_elements] = (int)slots;
+    if (slots == 0) {
+        slots = 1;
+    }
+
+    work->element_nodal = fem_arena_alloc(&g_scratch_arena, slots * sizeof(double[3]));
+    work->node_patch_slots = fem_arena_alloc(&g_scratch_arena, slots * sizeof(int));
+    work->node_patch_elements = fem_arena_alloc(&g_scratch_arena, slots * sizeof(int));
+    if (!work->element_nodal || !work->node_patch_slots || !work->node_patch_elements) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate stress patches");
+    }
+    return FEM_SUCCESS;
+}
+
+/* Node-to-element patches over the valid elements. Patches list their
+ * elements in ascending order, so the nodal sums are reproducible. */
+static void stress_recovery_fill_patches(stress_recovery_work_t *work)
+{
+    for (int n = 0; n <= g_num_nodes; ++n) {
+        work->node_patch_offsets[n] = 0;
+    }
+    for (int e = 0; e < g_num_elements; ++e) {
+        int nodes = stress_recovery_node_count(g_element_type[e]);
+        if (!g_element_stress_valid[e]) {
+            continue;
+        }
+        for (int k = 0; k < nodes; ++k) {
+            int node = g_element_nodes[e][k];
+            if (node >= 0 && node < g_num_nodes) {
+                work->node_patch_offsets[node + 1]++;
+            }
+        }
+    }
+    for (int n = 0; n < g_num_nodes; ++n) {
+        work->node_patch_offsets[n + 1] += work->node_patch_offsets[n];
+    }
+    for (int e = 0; e < g_num_elements; ++e) {
+        int nodes = stress_recovery_node_count(g_element_type[e]);
+        if (!g_element_stress_valid[e]) {
+            continue;
+        }
+        for (int k = 0; k < nodes; ++k) {
+            int node = g_element_nodes[e][k];
+            if (node >= 0 && node < g_num_nodes) {
+                int at = work->node_patch_offsets[node]++;
+                work->node_patch_slots[at] = work->slot_offsets[e] + k;
+                work->node_patch_elements[at] = e;
+            }
+        }
+    }
+    /* The fill advanced every offset to the next node's start */
+    for (int n = g_num_nodes; n > 0; --n) {
+        work->node_patch_offsets[n] = work->node_patch_offsets[n - 1];
+    }
+    work->node_patch_offsets[0] = 0;
+}
+
+/* Solids: the six stress components at the centroid of every element and
+ * at its nodes, the nodal values averaged over the elements of each node */
+static fem_error_t stress_recovery_compute_solid(void)
+{
+    fem_context_t *model = g_fem_context;
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    size_t elements = (size_t)g_num_elements;
+    size_t nodes = (size_t)(g_num_nodes > 0 ? g_num_nodes : 1);
+    double (*element_nodal)[SOLID3D_STRESS_COMPONENTS];
+    int *node_count;
+
+    globals_free_stress_results();
+    g_solid_stress = fem_malloc(elements * sizeof(*g_solid_stress), FEM_MEMORY_VECTOR);
+    g_element_stress_valid = fem_calloc(elements, sizeof(*g_element_stress_valid), FEM_MEMORY_VECTOR);
+    g_solid_nodal_stress = fem_calloc(nodes, sizeof(*g_solid_nodal_stress), FEM_MEMORY_VECTOR);
+    element_nodal = fem_arena_alloc(&g_scratch_arena,
+                                    elements * SOLID3D_MAX_NODES * sizeof(*element_nodal));
+    node_count = fem_arena_alloc(&g_scratch_arena, nodes * sizeof(int));
+    if (!g_solid_stress || !g_element_stress_valid || !g_solid_nodal_stress ||
+        !element_nodal || !node_count) {
+        globals_free_stress_results();
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Failed to allocate stress results (%d elements)", g_num_elements);
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel if (g_num_elements >= STRESS_RECOVERY_PARALLEL_MIN)
+#endif
+    {
+        fem_context_bind(model);
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int e = 0; e < g_num_elements; ++e) {
+            int type = g_element_type[e];
+            fem_error_t element_err = solid3d_element_stress(e, g_solid_stress[e]);
+
+            for (int a = 0; a < solid3d_node_count(type) && element_err == FEM_SUCCESS; ++a) {
+                double xi[3];
+                solid3d_node_natural_coords(type, a, xi);
+                element_err = solid3d_stress_at(e, xi, element_nodal[(size_t)e * SOLID3D_MAX_NODES + a]);
+            }
+            g_element_stress_valid[e] = element_err == FEM_SUCCESS;
+            if (element_err != FEM_SUCCESS) {
+                FEM_LOG_TRACE("    Element %d stress: %s\n", e + 1, error_get_message());
+                memset(g_solid_stress[e], 0, sizeof(g_solid_stress[e]));
+            }
+        }
+    }
+
+    memset(node_count, 0, nodes * sizeof(int));
+    for (int e = 0; e < g_num_elements; ++e) {
+        if (!g_element_stress_valid[e]) {
+            continue;
+        }
+        for (int a = 0; a < solid3d_node_count(g_element_type[e]); ++a) {
+            int node = g_element_nodes[e][a];
+            const double *value = element_nodal[(size_t)e * SOLID3D_MAX_NODES + a];
+            for (int k = 0; k < SOLID3D_STRESS_COMPONENTS; ++k) {
+                g_solid_nodal_stress[node][k] += value[k];
+            }
+            node_count[node]++;
+        }
+    }
+    for (int n = 0; n < g_num_nodes; ++n) {
+        if (node_count[n] > 1) {
+            for (int k = 0; k < SOLID3D_STRESS_COMPONENTS; ++k) {
+                g_solid_nodal_stress[n][k] /= node_count[n];
+            }
+        }
+    }
+
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    g_stress_element_count = g_num_elements;
+    return FEM_SUCCESS;
+}
+
+fem_error_t stress_recovery_compute(void)
+{
+    fem_context_t *model = g_fem_context;
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    stress_recovery_work_t work;
+    fem_index_t points = 0;
+    int nodes = g_num_nodes;
+    int elements = g_num_elements;
+    fem_error_t err;
+
+    if (elements <= 0 || g_node_displ == NULL) {
+        globals_free_stress_results();
+        return FEM_SUCCESS;
+    }
+    if (g_analysis.spatial_dimension == 3) {
+        return stress_recovery_compute_solid();
+    }
+
+    for (int e = 0; e < elements; ++e) {
+        points += stress_recovery_point_count(g_element_type[e]);
+    }
+    err = stress_recovery_allocate(points);
+    CHECK_ERROR(err);
+    points = 0;
+    for (int e = 0; e < elements; ++e) {
+        g_gauss_stress_offsets[e] = points;
+        points += stress_recovery_point_count(g_element_type[e]);
+    }
+    g_gauss_stress_offsets[elements] = points;
+
+    memset(&work, 0, sizeof(work));
+    err = stress_recovery_build_patches(&work);
+    CHECK_ERROR_CLEANUP(err, fem_arena_rewind(&g_scratch_arena, scratch));
+
+#ifdef _OPENMP
+    #pragma omp parallel if (elements >= STRESS_RECOVERY_PARALLEL_MIN)
+#endif
+    {
+        /* The element routines read the model of the bound context */
+        fem_context_bind(model);
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int e = 0; e < elements; ++e) {
+            fem_index_t first = g_gauss_stress_offsets[e];
+            fem_error_t element_err;
+
+            if (stress_recovery_point_count(g_element_type[e]) == 0) {
+                g_element_stress[e][0] = g_element_stress[e][1] = g_element_stress[e][2] = 0.0;
+                continue;
+            }
+            element_err = stress_recovery_element(e, g_element_stress[e], &g_gauss_stress[first],
+                                                  &g_gauss_point_coords[first],
+                                                  &work.element_nodal[work.slot_offsets[e]]);
+            g_element_stress_valid[e] = element_err == FEM_SUCCESS;
+            if (element_err != FEM_SUCCESS) {
+                FEM_LOG_TRACE("    Element %d stress: %s\n", e + 1, error_get_message());
+                g_element_stress[e][0] = g_element_stress[e][1] = g_element_stress[e][2] = 0.0;
+            }
+        }
+    }
+
+    stress_recovery_fill_patches(&work);
+
+#ifdef _OPENMP
+    #pragma omp parallel if (nodes >= STRESS_RECOVERY_PARALLEL_MIN)
+#endif
+    {
+        fem_context_bind(model);
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int n = 0; n < nodes; ++n) {
+            stress_recovery_node(n, &work);
+        }
+    }
+
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    g_stress_element_count = elements;
+    return FEM_SUCCESS;
+}
+
+/* Compliance C = D^-1 of a plane material matrix */
+static int stress_recovery_compliance(const double D[3][3], double C[3][3])
+{
+    double det = D[0][0] * (D[1][1] * D[2][2] - D[1][2] * D[2][1]) -
+                 D[0][1] * (D[1][0] * D[2][2] - D[1][2] * D[2][0]) +
+                 D[0][2] * (D[1][0] * D[2][1] - D[1][1] * D[2][0]);
+
+    if (fabs(det) <= 0.0) {
+        return 0;
+    }
+    C[0][0] = (D[1][1] * D[2][2] - D[1][2] * D[2][1]) / det;
+    C[0][1] = (D[0][2] * D[2][1] - D[0][1] * D[2][2]) / det;
+    C[0][2] = (D[0][1] * D[1][2] - D[0][2] * D[1][1]) / det;
+    C[1][0] = (D[1][2] * D[2][0] - D[1][0] * D[2][2]) / det;
+    C[1][1] = (D[0][0] * D[2][2] - D[0][2] * D[2][0]) / det;
+    C[1][2] = (D[0][2] * D[1][0] - D[0][0] * D[1][2]) / det;
+    C[2][0] = (D[1][0] * D[2][1] - D[1][1] * D[2][0]) / det;
+    C[2][1] = (D[0][1] * D[2][0] - D[0][0] * D[2][1]) / det;
+    C[2][2] = (D[0][0] * D[1][1] - D[0][1] * D[1][0]) / det;
+    return 1;
+}
+
+static double stress_recovery_energy_density(const double C[3][3], const double stress[3])
+{
+    double sum = 0.0;
+
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            sum += stress[i] * C[i][j] * stress[j];
+        }
+    }
+    return sum;
+}
+
+/* Squared energy norms of sigma* - sigma_h and of sigma_h over one
+ * element. Triangles are integrated at the three interior points of the
+ * T6 rule, where sigma_h is known (constant for T3), Q4 at its 2x2 points. */
+static fem_error_t stress_recovery_element_error(int element_id, double *error_sq,
+                                                 double *energy_sq)
+{
+    int type = g_element_type[element_id];
+    int nodes = stress_recovery_node_count(type);
+    int points = type == ELEMENT_Q4 ? Q4_GAUSS_POINTS : T6_GAUSS_POINTS;
+    fem_index_t first = g_gauss_stress_offsets[element_id];
+    int material_id = g_element_material[element_id];
+    double D[3][3], C[3][3];
+    double displ[MAX_DOF_PER_NODE * MAX_NODES_PER_ELEMENT];
+    double thickness;
+    fem_error_t err;
+
+    *error_sq = 0.0;
+    *energy_sq = 0.0;
+    err = stress_recovery_element_state(element_id, type, D, displ);
+    CHECK_ERROR(err);
+    if (!stress_recovery_compliance(D, C)) {
+        return error_set(FEM_ERROR_INVALID_MATERIAL,
+                         "Singular material matrix in element %d", element_id + 1);
+    }
+    thickness = g_material_props[material_id][2];
+    if (thickness <= 0.0) {
+        thickness = 1.0;
+    }
+
+    for (int p = 0; p < points; ++p) {
+        double N[MAX_NODES_PER_ELEMENT];
+        double J[2][2];
+        double det_j = 0.0;
+        double xi, eta, weight;
+        double diff[3];
+        const double *sigma_h;
+
+        if (type == ELEMENT_Q4) {
+            xi = g_q4_gauss_points[p][0];
+            eta = g_q4_gauss_points[p][1];
+            weight = g_q4_gauss_weights[p];
+            q4_shape_functions(xi, eta, N);
+            err = q4_jacobian_matrix(element_id, xi, eta, J, &det_j);
+            sigma_h = g_gauss_stress[first + p];
+        } else if (type == ELEMENT_T6) {
+            xi = g_t6_gauss_points[p][0];
+            eta = g_t6_gauss_points[p][1];
+            weight = g_t6_gauss_weights[p];
+            t6_shape_functions(xi, eta, N);
+            err = t6_jacobian_matrix(element_id, xi, eta, J, &det_j);
+            sigma_h = g_gauss_stress[first + p];
+        } else {
+            xi = g_t6_gauss_points[p][0];
+            eta = g_t6_gauss_points[p][1];
+            weight = g_t6_gauss_weights[p];
+            t3_shape_functions(xi, eta, N);
+            err = t3_jacobian_matrix(element_id, xi, eta, J, &det_j);
+            sigma_h = g_gauss_stress[first];
+        }
+        CHECK_ERROR(err);
+
+        for (int c = 0; c < 3; ++c) {
+            double sigma_star = 0.0;
+            for (int k = 0; k < nodes; ++k) {
+                sigma_star += N[k] * g_nodal_stress_spr[g_element_nodes[element_id][k]][c];
+            }
+            diff[c] = sigma_star - sigma_h[c];
+        }
+        *error_sq += weight * fabs(det_j) * thickness * stress_recovery_energy_density(C, diff);
+        *energy_sq += weight * fabs(det_j) * thickness * stress_recovery_energy_density(C, sigma_h);
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t stress_recovery_error_estimate(double *element_error, double *error_sq,
+                                           double *energy_sq)
+{
+    fem_context_t *model = g_fem_context;
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    int elements = g_num_elements;
+    double *element_energy;
+    double error_sum = 0.0;
+    double energy_sum = 0.0;
+
+    if (g_analysis.spatial_dimension != 2 || !stress_recovery_available() ||
+        g_nodal_stress_spr == NULL) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Error estimate needs the recovered stresses of a plane model");
+    }
+    element_energy = fem_arena_alloc(&g_scratch_arena,
+                                     (size_t)(elements > 0 ? elements : 1) * sizeof(double));
+    CHECK_NULL(element_energy, "Error estimate workspace allocation failed");
+
+#ifdef _OPENMP
+    #pragma omp parallel if (elements >= STRESS_RECOVERY_PARALLEL_MIN)
+#endif
+    {
+        fem_context_bind(model);
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int e = 0; e < elements; ++e) {
+            fem_error_t element_err = FEM_SUCCESS;
+
+            element_error[e] = 0.0;
+            element_energy[e] = 0.0;
+            if (g_element_stress_valid[e] && stress_recovery_point_count(g_element_type[e]) > 0) {
+                element_err = stress_recovery_element_error(e, &element_error[e], &element_energy[e]);
+            }
+            if (element_err != FEM_SUCCESS) {
+                FEM_LOG_TRACE("    Element %d error estimate: %s\n", e + 1, error_get_message());
+                element_error[e] = 0.0;
+                element_energy[e] = 0.0;
+            }
+        }
+    }
+
+    /* Summed in element order, so the estimate is reproducible */
+    for (int e = 0; e < elements; ++e) {
+        error_sum += element_error[e];
+        energy_sum += element_energy[e];
+    }
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    *error_sq = error_sum;
+    *energy_sq = energy_sum;
+    return FEM_SUCCESS;
+}
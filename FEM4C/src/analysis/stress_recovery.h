@@ -0,0 +1,53 @@
+#ifndef STRESS_RECOVERY_H
+#define STRESS_RECOVERY_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Stress recovery
+ *
+ * One parallel pass over the elements evaluates the stress (sx, sy, txy)
+ * at the centroid and at every stiffness Gauss point, sharing the element
+ * displacements and material matrix between the points. Two nodal fields
+ * are derived from the Gauss-point stresses:
+ *   - g_nodal_stress: element stresses extrapolated from the Gauss points
+ *     to the element nodes and averaged over the elements of each node
+ *   - g_nodal_stress_spr: superconvergent patch recovery (Zienkiewicz-Zhu),
+ *     a least-squares polynomial fitted to the Gauss-point stresses of the
+ *     elements around each node and evaluated at the node. Patches with too
+ *     few sampling points fall back to the averaged value.
+ * The centroid values are bit-identical to the per-element stress kernels.
+ * The difference between the SPR field and the Gauss-point stresses gives
+ * the element error indicators of adaptive refinement.
+ * Solid models get the six components (xx, yy, zz, xy, yz, zx) at the
+ * element centroids in g_solid_stress and, evaluated at the element nodes
+ * and averaged, in g_solid_nodal_stress.
+ * The result writers read these arrays instead of recomputing stresses;
+ * they are released together with the system arrays.
+ */
+
+#include "../common/types.h"
+
+/* Recover element, Gauss-point and nodal stresses of the solved model.
+ * Elements whose stress cannot be evaluated are marked invalid in
+ * g_element_stress_valid and left out of the nodal fields. */
+fem_error_t stress_recovery_compute(void);
+
+/* Nonzero if the arrays hold stresses for every element of the model */
+int stress_recovery_available(void);
+
+/* Number of elements marked invalid by the last recovery */
+int stress_recovery_failed_count(void);
+
+/* Zienkiewicz-Zhu error estimate of the last plane recovery: the energy
+ * norm of sigma* - sigma_h over each element, sigma* interpolating the SPR
+ * nodal stresses with the element shape functions. element_error[e]
+ * receives the squared norm (0 for elements without valid stresses);
+ * error_sq and energy_sq the squared norms of the error and of the finite
+ * element stress field over the model. */
+fem_error_t stress_recovery_error_estimate(double *element_error, double *error_sq,
+                                           double *energy_sq);
+
+/* Von Mises equivalent and principal stresses of a plane stress state */
+double stress_von_mises(const double stress[3]);
+void stress_principal(const double stress[3], double *sigma_max, double *sigma_min);
+
+#endif /* STRESS_RECOVERY_H */
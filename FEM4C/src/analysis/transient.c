@@ -0,0 +1,464 @@
+/* FEM4C - Transient Analysis Implementation
+ * Newmark / HHT-alpha time integration with one factorization
+ */
+
+#include "transient.h"
+#include "static.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_memory.h"
+#include "../common/fem_thread.h"
+#include "../io/async_output.h"
+#include "../io/time_history.h"
+#include "../solver/assembly.h"
+#include "../solver/mpc.h"
+#include "../solver/pipeline.h"
+#include "../solver/skyline_solver.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Progress lines printed over a run */
+#define TRANSIENT_REPORT_LINES 10
+/* History frames written by default */
+#define TRANSIENT_DEFAULT_FRAMES 200
+
+typedef struct {
+    int n;
+    double *mass;           /* M on the stiffness profile */
+    double *factor;         /* K_eff, then its LDL^T factor */
+    double *f_ext, *prescribed;
+    unsigned char *constrained;
+    int has_prescribed;
+    double *u, *v, *a;
+    double *rhs, *kvec, *mvec, *work;
+} transient_work_t;
+
+transient_options_t transient_default_options(void)
+{
+    transient_options_t options;
+
+    options.dt = 0.0;
+    options.steps = 0;
+    options.alpha = 0.0;
+    options.rayleigh_mass = 0.0;
+    options.rayleigh_stiffness = 0.0;
+    options.ramp_time = 0.0;
+    options.output_interval = 0;
+    return options;
+}
+
+/* Main transient analysis function */
+fem_error_t transient_analysis(const char *input_filename, const char *output_filename,
+                               const transient_options_t *options)
+{
+    fem_error_t err;
+    clock_t start_time, end_time;
+    char vtk_filename[MAX_FILENAME_LEN];
+    char history_filename[MAX_FILENAME_LEN];
+
+    printf("FEM4C Transient Analysis\n");
+    printf("========================\n\n");
+
+    start_time = clock();
+
+    err = static_analysis_initialize();
+    CHECK_ERROR(err);
+
+    err = static_analysis_preprocessing(input_filename);
+    CHECK_ERROR(err);
+
+    static_result_filename(vtk_filename, output_filename, ".vtk");
+    if (async_output_begin_geometry(vtk_filename) != FEM_SUCCESS) {
+        printf("  Warning: VTK geometry could not be started early\n");
+    }
+
+    printf("Phase 3: Time Integration\n");
+    printf("-------------------------\n");
+    static_result_filename(history_filename, output_filename, ".hist");
+    err = transient_solve(options, history_filename);
+    CHECK_ERROR_CLEANUP(err, async_output_cancel());
+    printf("  Solution phase completed successfully\n\n");
+
+    /* Stresses and result files of the final state */
+    err = static_analysis_postprocessing(output_filename);
+    CHECK_ERROR_CLEANUP(err, async_output_cancel());
+
+    err = static_analysis_finalize();
+    CHECK_ERROR(err);
+
+    end_time = clock();
+    g_solver_info.elapsed_time = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
+
+    printf("\nTransient Analysis Complete\n");
+    printf("===========================\n");
+    printf("Total elapsed time: %.3f seconds\n", g_solver_info.elapsed_time);
+    fem_memory_report(stdout);
+
+    return FEM_SUCCESS;
+}
+
+static void transient_free_work(transient_work_t *w)
+{
+    fem_free(w->mass);
+    fem_free(w->factor);
+    fem_free(w->f_ext);
+    fem_free(w->prescribed);
+    fem_free(w->constrained);
+    fem_free(w->u);
+    fem_free(w->v);
+    fem_free(w->a);
+    fem_free(w->rhs);
+    fem_free(w->kvec);
+    fem_free(w->mvec);
+    fem_free(w->work);
+    memset(w, 0, sizeof(*w));
+}
+
+static fem_error_t transient_allocate_work(transient_work_t *w)
+{
+    size_t n = (size_t)(g_total_dof > 0 ? g_total_dof : 1);
+    size_t values = (size_t)g_stiffness_value_count;
+
+    memset(w, 0, sizeof(*w));
+    w->n = g_total_dof;
+    w->mass = fem_calloc(values, sizeof(double), FEM_MEMORY_MATRIX);
+    w->factor = fem_malloc(values * sizeof(double), FEM_MEMORY_MATRIX);
+    w->f_ext = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->prescribed = fem_calloc(n, sizeof(double), FEM_MEMORY_VECTOR);
+    w->constrained = fem_calloc(n, 1, FEM_MEMORY_VECTOR);
+    w->u = fem_calloc(n, sizeof(double), FEM_MEMORY_VECTOR);
+    w->v = fem_calloc(n, sizeof(double), FEM_MEMORY_VECTOR);
+    w->a = fem_calloc(n, sizeof(double), FEM_MEMORY_VECTOR);
+    w->rhs = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->kvec = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->mvec = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+    w->work = fem_malloc(n * sizeof(double), FEM_MEMORY_VECTOR);
+
+    if (!w->mass || !w->factor || !w->f_ext || !w->prescribed || !w->constrained ||
+        !w->u || !w->v || !w->a || !w->rhs || !w->kvec || !w->mvec || !w->work) {
+        transient_free_work(w);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Transient work array allocation failed");
+    }
+    return FEM_SUCCESS;
+}
+
+static double transient_load_factor(const transient_options_t *options, double time)
+{
+    if (options->ramp_time > 0.0 && time < options->ramp_time) {
+        return time / options->ramp_time;
+    }
+    return 1.0;
+}
+
+/* Start at rest with the loads of t = 0 applied: M a0 = f(0) - K u0 */
+static fem_error_t transient_initial_state(transient_work_t *w, double g0)
+{
+    double norm = 0.0;
+    int n = w->n;
+    fem_error_t err;
+
+    for (int i = 0; i < n; i++) {
+        if (w->constrained[i]) {
+            w->u[i] = g0 * w->prescribed[i];
+        }
+        w->rhs[i] = g0 * w->f_ext[i];
+    }
+    memset(w->work, 0, (size_t)n * sizeof(double));
+    skyline_multiply_add(g_global_stiffness_values, w->u, w->work);
+    for (int i = 0; i < n; i++) {
+        w->rhs[i] = w->constrained[i] ? 0.0 : w->rhs[i] - w->work[i];
+        norm += w->rhs[i] * w->rhs[i];
+    }
+    if (norm == 0.0) {
+        return FEM_SUCCESS;
+    }
+
+    /* The effective matrix is factorized later into the same array */
+    memcpy(w->factor, w->mass, (size_t)g_stiffness_value_count * sizeof(double));
+    skyline_constrain(w->factor, w->constrained);
+    err = skyline_ldlt_factorize(w->factor, NULL);
+    CHECK_ERROR(err);
+    memcpy(w->a, w->rhs, (size_t)n * sizeof(double));
+    skyline_ldlt_solve(w->factor, w->a);
+    return FEM_SUCCESS;
+}
+
+static void transient_energies(transient_work_t *w, double *kinetic, double *strain)
+{
+    int n = w->n;
+    double ek = 0.0, es = 0.0;
+
+    memset(w->work, 0, (size_t)n * sizeof(double));
+    skyline_multiply_add(w->mass, w->v, w->work);
+    for (int i = 0; i < n; i++) {
+        ek += w->v[i] * w->work[i];
+    }
+    memset(w->work, 0, (size_t)n * sizeof(double));
+    skyline_multiply_add(g_global_stiffness_values, w->u, w->work);
+    for (int i = 0; i < n; i++) {
+        es += w->u[i] * w->work[i];
+    }
+    *kinetic = 0.5 * ek;
+    *strain = 0.5 * es;
+}
+
+static void transient_store_results(transient_work_t *w, const transient_options_t *options,
+                                    double g)
+{
+    int n = w->n;
+    double sum[2] = {0.0, 0.0};
+    int count = 0;
+
+    memcpy(g_global_displ, w->u, (size_t)n * sizeof(double));
+    for (int node = 0; node < g_num_nodes; node++) {
+        g_node_displ[node][0] = w->u[node * 2];
+        g_node_displ[node][1] = w->u[node * 2 + 1];
+    }
+
+    /* R = K u + C v + M a - f at the constrained DOFs */
+    for (int i = 0; i < n; i++) {
+        w->kvec[i] = w->u[i] + options->rayleigh_stiffness * w->v[i];
+        w->mvec[i] = w->a[i] + options->rayleigh_mass * w->v[i];
+    }
+    memset(w->work, 0, (size_t)n * sizeof(double));
+    skyline_multiply_add(g_global_stiffness_values, w->kvec, w->work);
+    skyline_multiply_add(w->mass, w->mvec, w->work);
+    memset(g_node_reaction, 0, (size_t)g_num_nodes * sizeof(*g_node_reaction));
+    for (int i = 0; i < n; i++) {
+        if (w->constrained[i]) {
+            double reaction = w->work[i] - g * w->f_ext[i];
+            g_node_reaction[i / 2][i % 2] = reaction;
+            sum[i % 2] += reaction;
+            count++;
+        }
+    }
+    g_reactions_current = 1;
+
+    printf("    Reaction sum at t end: RX = %e, RY = %e (%d constrained DOFs)\n",
+           sum[0], sum[1], count);
+}
+
+fem_error_t transient_solve(const transient_options_t *options, const char *history_filename)
+{
+    transient_work_t w;
+    FILE *history = NULL;
+    double alpha, newmark_beta, newmark_gamma, dt;
+    double a0, a1, a2, a3, a4, a5, coef_m, coef_k;
+    double time_assembly, time_factor, time_rhs = 0.0, time_solve = 0.0, time_output = 0.0;
+    double start, run_start, g_prev, g_next = 1.0;
+    int interval, report, frames = 0;
+    fem_error_t err;
+
+    if (!options || !(options->dt > 0.0) || options->steps <= 0) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Transient analysis needs dt > 0 and steps > 0");
+    }
+    if (options->alpha < -1.0 / 3.0 - 1.0e-12 || options->alpha > 0.0) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "HHT alpha %g outside [-1/3, 0]", options->alpha);
+    }
+    if (g_analysis.spatial_dimension != 2) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Transient analysis supports plane models (T3, Q4, T6) only");
+    }
+    err = mpc_require_none("Transient");
+    CHECK_ERROR(err);
+
+    dt = options->dt;
+    alpha = options->alpha;
+    newmark_gamma = 0.5 - alpha;
+    newmark_beta = 0.25 * (1.0 - alpha) * (1.0 - alpha);
+    a0 = 1.0 / (newmark_beta * dt * dt);
+    a1 = newmark_gamma / (newmark_beta * dt);
+    a2 = 1.0 / (newmark_beta * dt);
+    a3 = 0.5 / newmark_beta - 1.0;
+    a4 = newmark_gamma / newmark_beta - 1.0;
+    a5 = dt * (0.5 * newmark_gamma / newmark_beta - 1.0);
+    /* K_eff = coef_m M + coef_k K */
+    coef_m = a0 + (1.0 + alpha) * a1 * options->rayleigh_mass;
+    coef_k = (1.0 + alpha) * (1.0 + a1 * options->rayleigh_stiffness);
+
+    interval = options->output_interval > 0 ? options->output_interval
+                                            : (options->steps + TRANSIENT_DEFAULT_FRAMES - 1) /
+                                              TRANSIENT_DEFAULT_FRAMES;
+    report = options->steps > TRANSIENT_REPORT_LINES ? options->steps / TRANSIENT_REPORT_LINES : 1;
+
+    /* K and M once */
+    start = fem_wall_time();
+    printf("  Assembling stiffness and mass matrices...\n");
+    if (pipeline_active()) {
+        err = pipeline_assemble_stiffness();
+    } else {
+#ifdef _OPENMP
+        err = assembly_parallel_stiffness_matrix();
+#else
+        err = assembly_global_stiffness_matrix();
+#endif
+    }
+    CHECK_ERROR(err);
+    err = assembly_global_force_vector();
+    CHECK_ERROR(err);
+
+    err = transient_allocate_work(&w);
+    CHECK_ERROR(err);
+    if (!g_node_reaction) {
+        g_node_reaction = fem_calloc((size_t)(g_num_nodes > 0 ? g_num_nodes : 1),
+                                     sizeof(*g_node_reaction), FEM_MEMORY_VECTOR);
+        if (!g_node_reaction) {
+            transient_free_work(&w);
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate reactions");
+        }
+    }
+    err = assembly_global_mass_matrix(w.mass);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+    time_assembly = fem_wall_time() - start;
+
+    memcpy(w.f_ext, g_global_force, (size_t)w.n * sizeof(double));
+    for (int node = 0; node < g_num_nodes; node++) {
+        for (int k = 0; k < 2; k++) {
+            int dof = node * 2 + k;
+            if (g_node_bc_flags[node][k] == 1 && dof < w.n) {
+                w.constrained[dof] = 1;
+                w.prescribed[dof] = g_node_displ[node][k];
+                if (w.prescribed[dof] != 0.0) {
+                    w.has_prescribed = 1;
+                }
+            }
+        }
+    }
+
+    start = fem_wall_time();
+    g_prev = transient_load_factor(options, 0.0);
+    err = transient_initial_state(&w, g_prev);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+
+    /* The one factorization of the run */
+    for (fem_index_t k = 0; k < g_stiffness_value_count; k++) {
+        w.factor[k] = coef_m * w.mass[k] + coef_k * g_global_stiffness_values[k];
+    }
+    skyline_constrain(w.factor, w.constrained);
+    err = skyline_ldlt_factorize(w.factor, NULL);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+    time_factor = fem_wall_time() - start;
+
+    printf("  %s: dt = %e, %d steps, alpha = %g (beta = %.4f, gamma = %.4f)\n",
+           alpha == 0.0 ? "Newmark" : "HHT-alpha", dt, options->steps, alpha,
+           newmark_beta, newmark_gamma);
+    if (options->rayleigh_mass != 0.0 || options->rayleigh_stiffness != 0.0) {
+        printf("  Rayleigh damping: C = %g M + %g K\n",
+               options->rayleigh_mass, options->rayleigh_stiffness);
+    }
+    if (history_filename) {
+        err = time_history_open(history_filename, 2, dt, interval, &history);
+        CHECK_ERROR_CLEANUP(err, goto cleanup);
+        err = time_history_write(history, 0, 0.0, w.u, w.n);
+        CHECK_ERROR_CLEANUP(err, goto cleanup);
+        frames++;
+        printf("  Time history: %s (every %d steps)\n", history_filename, interval);
+    }
+    printf("    Step        Time       max |u|      Kinetic       Strain\n");
+
+    run_start = fem_wall_time();
+    for (int step = 1; step <= options->steps; step++) {
+        int n = w.n;
+        double t_next = step * dt;
+        double load;
+
+        start = fem_wall_time();
+        g_next = transient_load_factor(options, t_next);
+        load = (1.0 + alpha) * g_next - alpha * g_prev;
+
+        /* rhs = F - K u + M (a2 v + a3 a) + C ((1 + alpha)(a4 v + a5 a) + alpha v) */
+        for (int i = 0; i < n; i++) {
+            double c = (1.0 + alpha) * (a4 * w.v[i] + a5 * w.a[i]) + alpha * w.v[i];
+            w.kvec[i] = -w.u[i] + options->rayleigh_stiffness * c;
+            w.mvec[i] = a2 * w.v[i] + a3 * w.a[i] + options->rayleigh_mass * c;
+            w.rhs[i] = load * w.f_ext[i];
+        }
+        skyline_multiply_add(g_global_stiffness_values, w.kvec, w.rhs);
+        skyline_multiply_add(w.mass, w.mvec, w.rhs);
+
+        /* Prescribed increments move to the right-hand side of the free rows */
+        if (w.has_prescribed && g_next != g_prev) {
+            for (int i = 0; i < n; i++) {
+                w.work[i] = w.constrained[i] ? g_next * w.prescribed[i] - w.u[i] : 0.0;
+                w.kvec[i] = -coef_k * w.work[i];
+                w.mvec[i] = -coef_m * w.work[i];
+            }
+            skyline_multiply_add(g_global_stiffness_values, w.kvec, w.rhs);
+            skyline_multiply_add(w.mass, w.mvec, w.rhs);
+        }
+        for (int i = 0; i < n; i++) {
+            if (w.constrained[i]) {
+                w.rhs[i] = g_next * w.prescribed[i] - w.u[i];
+            }
+        }
+        time_rhs += fem_wall_time() - start;
+
+        start = fem_wall_time();
+        skyline_ldlt_solve(w.factor, w.rhs);
+        time_solve += fem_wall_time() - start;
+
+        /* Newmark updates from the increment */
+        for (int i = 0; i < n; i++) {
+            double du = w.rhs[i];
+            double a_next = a0 * du - a2 * w.v[i] - a3 * w.a[i];
+            w.v[i] = a1 * du - a4 * w.v[i] - a5 * w.a[i];
+            w.a[i] = a_next;
+            w.u[i] += du;
+        }
+        g_prev = g_next;
+
+        start = fem_wall_time();
+        if (history && (step % interval == 0 || step == options->steps)) {
+            err = time_history_write(history, step, t_next, w.u, n);
+            CHECK_ERROR_CLEANUP(err, goto cleanup);
+            frames++;
+        }
+        if (step % report == 0 || step == options->steps) {
+            double kinetic, strain, max_u = 0.0;
+            for (int node = 0; node < g_num_nodes; node++) {
+                double m = sqrt(w.u[2 * node] * w.u[2 * node] + w.u[2 * node + 1] * w.u[2 * node + 1]);
+                if (m > max_u) max_u = m;
+            }
+            transient_energies(&w, &kinetic, &strain);
+            printf("    %6d  %e  %e  %e  %e\n", step, t_next, max_u, kinetic, strain);
+            if (!isfinite(max_u)) {
+                err = error_set(FEM_ERROR_CONVERGENCE_FAILED,
+                                "Time integration diverged by step %d", step);
+                goto cleanup;
+            }
+        }
+        time_output += fem_wall_time() - start;
+    }
+
+    {
+        double stepping = fem_wall_time() - run_start;
+        printf("  Timing:\n");
+        printf("    Assembly (K, M):        %8.3f s\n", time_assembly);
+        printf("    Factorization:          %8.3f s\n", time_factor);
+        printf("    Right-hand sides:       %8.3f s\n", time_rhs);
+        printf("    Substitutions:          %8.3f s\n", time_solve);
+        printf("    History and reports:    %8.3f s (%d frames)\n", time_output, frames);
+        printf("    Time stepping:          %8.3f s (%.0f steps/s)\n", stepping,
+               stepping > 0.0 ? options->steps / stepping : 0.0);
+    }
+
+    transient_store_results(&w, options, g_next);
+
+    g_solver_info.iterations = options->steps;
+    g_solver_info.residual = 0.0;
+    g_solver_info.status = FEM_SUCCESS;
+    err = FEM_SUCCESS;
+
+cleanup:
+    if (history) {
+        fclose(history);
+    }
+    if (err != FEM_SUCCESS) {
+        g_solver_info.status = err;
+    }
+    transient_free_work(&w);
+    return err;
+}
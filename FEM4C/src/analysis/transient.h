@@ -0,0 +1,49 @@
+#ifndef TRANSIENT_H
+#define TRANSIENT_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Implicit transient dynamics (Newmark / HHT-alpha)
+ *
+ * Linear plane models (T3, Q4, T6) with consistent mass and Rayleigh
+ * damping C = rayleigh_mass M + rayleigh_stiffness K. For a fixed time
+ * step the effective matrix
+ *     K_eff = a0 M + (1 + alpha) (a1 C + K)
+ * does not change, so K and M are assembled once, K_eff is factorized
+ * once (skyline LDL^T) and every step costs two matrix-vector products
+ * for the right-hand side and one forward/back substitution.
+ *
+ * alpha = 0 is the trapezoidal Newmark rule (beta = 1/4, gamma = 1/2);
+ * alpha in [-1/3, 0) adds HHT numerical damping of the high modes with
+ * gamma = (1 - 2 alpha) / 2 and beta = (1 - alpha)^2 / 4.
+ *
+ * The loads and prescribed displacements of the input are scaled by a
+ * load factor: 1 from t = 0 (step load), or growing linearly to 1 over
+ * ramp_time. The model starts at rest.
+ *
+ * Displacement history is streamed to <output stem>.hist (time_history.h);
+ * the result files of the static analysis hold the final state.
+ */
+
+#include "../common/types.h"
+
+typedef struct {
+    double dt;
+    int steps;
+    double alpha;               /* HHT alpha, -1/3 .. 0 */
+    double rayleigh_mass;
+    double rayleigh_stiffness;
+    double ramp_time;           /* 0: step load */
+    int output_interval;        /* steps between history frames (<= 0: about 200 frames) */
+} transient_options_t;
+
+transient_options_t transient_default_options(void);
+
+/* Complete analysis: read input_filename, integrate, write the results */
+fem_error_t transient_analysis(const char *input_filename, const char *output_filename,
+                               const transient_options_t *options);
+
+/* Time integration on a model that has been read and validated; history
+ * frames go to history_filename (NULL: none) */
+fem_error_t transient_solve(const transient_options_t *options, const char *history_filename);
+
+#endif /* TRANSIENT_H */
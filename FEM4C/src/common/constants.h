@@ -15,6 +15,10 @@
 #define ELEMENT_ID_BLOCK_SIZE        4096
 #define MATERIAL_ID_BLOCK_SIZE       128
 
+/* ID maps stay dense while (max ID) <= ratio * (entry count) + block size;
+ * sparser ID ranges switch to a hashed map */
+#define ID_MAP_MAX_SPAN_RATIO        4
+
 #define MAX_FILENAME_LEN    256
 #define MAX_TITLE_LEN       80
 
@@ -45,6 +49,7 @@
 #define MAX_GAUSS_POINTS        27  /* Maximum Gauss points (3x3x3) */
 #define MAX_SURFACE_NODES       3
 #define MAX_TRACTION_SURFACES   20000
+#define MAX_NASTRAN_PROPERTIES  512
 
 /* T6 element specific constants */
 #define T6_NODES_PER_ELEMENT    6
@@ -6,9 +6,9 @@
 #include <stdarg.h>
 #include <string.h>
 
-/* Global error state */
-fem_error_t g_last_error = FEM_SUCCESS;
-char g_error_message[ERROR_MSG_LEN] = {0};
+/* Error state (per thread) */
+FEM_THREAD_LOCAL fem_error_t g_last_error = FEM_SUCCESS;
+FEM_THREAD_LOCAL char g_error_message[ERROR_MSG_LEN] = {0};
 
 /* Set error with formatted message */
 fem_error_t error_set(fem_error_t error_code, const char* format, ...)
@@ -6,14 +6,15 @@
  */
 
 #include "types.h"
+#include "fem_thread.h"
 #include <stdio.h>
 
 /* Error message buffer size */
 #define ERROR_MSG_LEN 256
 
-/* Global error state */
-extern fem_error_t g_last_error;
-extern char g_error_message[ERROR_MSG_LEN];
+/* Error state (per thread, so concurrent analyses do not clobber it) */
+extern FEM_THREAD_LOCAL fem_error_t g_last_error;
+extern FEM_THREAD_LOCAL char g_error_message[ERROR_MSG_LEN];
 
 /* Error handling functions */
 fem_error_t error_set(fem_error_t error_code, const char* format, ...);
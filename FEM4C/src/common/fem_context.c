@@ -0,0 +1,75 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Analysis context implementation
+ */
+
+#include "fem_context.h"
+#include "globals.h"
+#include "error.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Context used by threads that never bound one (the classic single-analysis
+ * program) */
+static fem_context_t g_fem_default_context = {
+    .node_id_map = { ID_MAP_DENSE, 0, NODE_ID_BLOCK_SIZE, NULL, 0, NULL, NULL, 0 },
+    .element_id_map = { ID_MAP_DENSE, 0, ELEMENT_ID_BLOCK_SIZE, NULL, 0, NULL, NULL, 0 },
+    .material_id_map = { ID_MAP_DENSE, 0, MATERIAL_ID_BLOCK_SIZE, NULL, 0, NULL, NULL, 0 },
+    .scratch_arena = { NULL, 0, FEM_MEMORY_VECTOR },
+    .num_threads = 1
+};
+
+FEM_THREAD_LOCAL fem_context_t *g_fem_context = &g_fem_default_context;
+
+void fem_context_init(fem_context_t *context)
+{
+    memset(context, 0, sizeof(*context));
+    id_map_init(&context->node_id_map, NODE_ID_BLOCK_SIZE);
+    id_map_init(&context->element_id_map, ELEMENT_ID_BLOCK_SIZE);
+    id_map_init(&context->material_id_map, MATERIAL_ID_BLOCK_SIZE);
+    fem_arena_init(&context->scratch_arena, 0, FEM_MEMORY_VECTOR);
+    context->num_threads = 1;
+}
+
+fem_context_t *fem_context_create(void)
+{
+    fem_context_t *context = (fem_context_t *)malloc(sizeof(fem_context_t));
+    if (context == NULL) {
+        error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate analysis context");
+        return NULL;
+    }
+    fem_context_init(context);
+    return context;
+}
+
+/* Release everything the context owns. Result writers must have been
+ * joined (static_analysis_finalize) before this is called. */
+void fem_context_destroy(fem_context_t *context)
+{
+    fem_context_t *previous;
+
+    if (context == NULL) {
+        return;
+    }
+
+    previous = fem_context_bind(context);
+    globals_finalize();
+    fem_context_bind(previous == context ? NULL : previous);
+
+    free(context->async_output);
+    context->async_output = NULL;
+    if (context != &g_fem_default_context) {
+        free(context);
+    }
+}
+
+fem_context_t *fem_context_default(void)
+{
+    return &g_fem_default_context;
+}
+
+fem_context_t *fem_context_bind(fem_context_t *context)
+{
+    fem_context_t *previous = g_fem_context;
+    g_fem_context = context ? context : &g_fem_default_context;
+    return previous;
+}
@@ -0,0 +1,171 @@
+#ifndef FEM_CONTEXT_H
+#define FEM_CONTEXT_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Analysis context
+ *
+ * A fem_context_t owns every piece of model, system and solver state of
+ * one analysis. Each thread works on the context bound to it (the process
+ * default context unless fem_context_bind() was called), so independent
+ * analyses can run side by side in one process. The g_* names in
+ * globals.h resolve to fields of the bound context.
+ */
+
+#include "constants.h"
+#include "types.h"
+#include "id_map.h"
+#include "fem_thread.h"
+#include "fem_memory.h"
+
+struct async_output_state;
+struct pipeline_state;
+struct skyline_ooc_store;
+struct sparse_cholesky_factor;
+struct krylov_recycle_space;
+
+/* PSHELL card recorded while reading Nastran bulk data */
+typedef struct {
+    int pid;
+    int mid;
+    double thickness;
+    int material_index;
+} nastran_pshell_t;
+
+typedef struct fem_context {
+    /* Mesh arrays - dynamically sized */
+    double (*node_coords)[3];
+    double (*node_displ)[3];
+    double (*node_force)[3];
+    int (*node_bc_flags)[3];
+    int *node_ids;
+    id_map_t node_id_map;
+
+    int (*element_nodes)[MAX_NODES_PER_ELEMENT];
+    int *element_type;
+    int *element_material;
+    int *element_ids;
+    id_map_t element_id_map;
+    element_quality_t *element_quality;   /* mesh_validate_elements() cache */
+    int element_quality_count;
+    int element_quality_capacity;
+
+    double (*material_props)[6];
+    int *material_type;
+    int *material_ids;
+    id_map_t material_id_map;
+
+    int node_capacity;
+    int element_capacity;
+    int material_capacity;
+
+    /* System vectors and skyline stiffness storage */
+    double *global_force;
+    double *global_displ;
+    double *global_stiffness_values;
+    int *stiffness_profile;
+    fem_index_t *stiffness_offsets;
+    fem_index_t stiffness_value_count;
+    int stiffness_bandwidth;
+
+    /* Solid models: 3x3 block sparse matrix, full pattern (block_assembly.c) */
+    fem_index_t *block_row_offsets;       /* Blocks of node row i: [offsets[i], offsets[i + 1]) */
+    int *block_columns;                   /* Sorted node columns */
+    double (*block_values)[9];            /* Row-major 3x3 blocks */
+    fem_index_t *block_diagonal;          /* Position of block (i, i) */
+    fem_index_t block_count;
+    int *color_offsets;                   /* Elements of colour c: [offsets[c], offsets[c + 1]) */
+    int *color_elements;
+    int color_count;
+
+    /* Constrained rows of K and their loads, kept by the boundary
+     * condition routine for reaction recovery (assembly.c) */
+    int reaction_dof_count;
+    int *reaction_dofs;                   /* Constrained global DOFs */
+    fem_index_t *reaction_row_offsets;    /* Entries of row r: [offsets[r], offsets[r + 1]) */
+    int *reaction_columns;
+    double *reaction_values;
+    double *reaction_loads;               /* Loads at the constrained DOFs before the BCs */
+    double (*node_reaction)[3];           /* R = K_c u - f_c */
+    int reactions_current;                /* node_reaction matches the solution */
+
+    /* Multipoint constraints (mpc.c): each dependent DOF is a combination
+     * of independent master DOFs, u_d = sum c_k u_{m_k} */
+    int *mpc_dof_row;                     /* Row of each global DOF, -1 if independent */
+    int mpc_row_count;
+    int *mpc_dependent_dofs;              /* Dependent DOF of row r */
+    int *mpc_row_offsets;                 /* Terms of row r: [offsets[r], offsets[r + 1]) */
+    int *mpc_masters;
+    double *mpc_coefficients;
+    int mpc_max_terms;                    /* Longest row */
+
+    /* Temporaries of one phase (solver work vectors, residual checks) */
+    fem_arena_t scratch_arena;
+
+    /* Distributed loads */
+    double body_force[3];
+    double pressure_value;
+    int has_body_force;
+    int has_pressure;
+    int num_tractions;
+    int traction_surfaces[MAX_TRACTION_SURFACES][MAX_SURFACE_NODES];
+    double traction_values[MAX_TRACTION_SURFACES][3];
+    int num_pressure_surfaces;
+    int pressure_surfaces[MAX_TRACTION_SURFACES][MAX_SURFACE_NODES];
+
+    /* Analysis control and problem size */
+    analysis_control_t analysis;
+    solver_info_t solver_info;
+    int num_nodes;
+    int num_elements;
+    int num_materials;
+    int total_dof;
+
+    char input_filename[MAX_FILENAME_LEN];
+    char output_filename[MAX_FILENAME_LEN];
+    int num_threads;
+
+    /* Nastran property bookkeeping (input.c) */
+    nastran_pshell_t nastran_pshells[MAX_NASTRAN_PROPERTIES];
+    int nastran_pshell_count;
+    int *nastran_element_property;
+    int nastran_element_property_capacity;
+
+    /* Background result writers (async_output.c) */
+    struct async_output_state *async_output;
+
+    /* Pipelined preprocessing (pipeline.c), between reading and assembly */
+    struct pipeline_state *pipeline;
+
+    /* File-backed stiffness and factor of an out-of-core solve (skyline_ooc.c) */
+    struct skyline_ooc_store *skyline_ooc;
+
+    /* Supernodal factor of a direct static solve (sparse_cholesky.c) */
+    struct sparse_cholesky_factor *sparse_cholesky;
+
+    /* Deflation space kept between PCG solves (krylov_recycle.c) */
+    struct krylov_recycle_space *krylov_recycle;
+
+    /* Recovered stresses (stress_recovery.c), sx, sy, txy per entry */
+    double (*element_stress)[3];          /* Element centroid */
+    unsigned char *element_stress_valid;
+    fem_index_t *gauss_stress_offsets;    /* Points of element e: [offsets[e], offsets[e + 1]) */
+    double (*gauss_stress)[3];
+    double (*gauss_point_coords)[2];
+    double (*nodal_stress)[3];            /* Extrapolated and averaged */
+    double (*nodal_stress_spr)[3];        /* Superconvergent patch recovery */
+    int stress_element_count;             /* Elements covered, 0 = none */
+    double (*solid_stress)[6];            /* Solids: xx yy zz xy yz zx at the centroid */
+    double (*solid_nodal_stress)[6];      /* Solids: averaged at the nodes */
+} fem_context_t;
+
+/* Context bound to the calling thread */
+extern FEM_THREAD_LOCAL fem_context_t *g_fem_context;
+
+void fem_context_init(fem_context_t *context);
+fem_context_t *fem_context_create(void);
+void fem_context_destroy(fem_context_t *context);
+fem_context_t *fem_context_default(void);
+/* Bind context to the calling thread (NULL = default); returns the previous one */
+fem_context_t *fem_context_bind(fem_context_t *context);
+
+#endif /* FEM_CONTEXT_H */
@@ -0,0 +1,74 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Leveled logging implementation
+ */
+
+#include "fem_log.h"
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Set once at startup, read by every thread */
+static int g_fem_log_level = FEM_LOG_LEVEL_INFO;
+
+static const char *const k_fem_log_level_names[] = {
+    "error", "warn", "info", "debug", "trace"
+};
+
+int fem_log_level(void)
+{
+    return g_fem_log_level;
+}
+
+void fem_log_set_level(int level)
+{
+    if (level < FEM_LOG_LEVEL_ERROR) {
+        level = FEM_LOG_LEVEL_ERROR;
+    } else if (level > FEM_LOG_LEVEL_TRACE) {
+        level = FEM_LOG_LEVEL_TRACE;
+    }
+    g_fem_log_level = level;
+}
+
+void fem_log_init_from_env(void)
+{
+    const char *value = getenv("FEM4C_LOG_LEVEL");
+    char name[8];
+    size_t length;
+
+    if (value == NULL || *value == '\0') {
+        return;
+    }
+    if (isdigit((unsigned char)value[0])) {
+        fem_log_set_level(atoi(value));
+        return;
+    }
+
+    length = strlen(value);
+    if (length >= sizeof(name)) {
+        length = sizeof(name) - 1;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        name[i] = (char)tolower((unsigned char)value[i]);
+    }
+    name[length] = '\0';
+
+    for (int level = FEM_LOG_LEVEL_ERROR; level <= FEM_LOG_LEVEL_TRACE; ++level) {
+        if (strcmp(name, k_fem_log_level_names[level]) == 0) {
+            fem_log_set_level(level);
+            return;
+        }
+    }
+    fprintf(stderr, "Warning: unknown FEM4C_LOG_LEVEL '%s' ignored\n", value);
+}
+
+void fem_log_write(int level, const char *format, ...)
+{
+    va_list args;
+
+    (void)level;
+    va_start(args, format);
+    vfprintf(stdout, format, args);
+    va_end(args);
+}
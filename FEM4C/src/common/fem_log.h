@@ -0,0 +1,91 @@
+#ifndef FEM_LOG_H
+#define FEM_LOG_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Leveled logging
+ *
+ * Messages go to stdout, in line with the rest of the program output.
+ * Two thresholds apply:
+ *   - FEM4C_LOG_MAX_LEVEL (compile time, make LOG_LEVEL=n): calls above it
+ *     generate no code and do not evaluate their arguments. Defaults to
+ *     DEBUG, or TRACE in DEBUG builds.
+ *   - the runtime level (fem_log_set_level, or the FEM4C_LOG_LEVEL
+ *     environment variable read by fem_log_init_from_env): defaults to
+ *     INFO, which prints the usual progress output.
+ * TRACE is for per-element and per-Gauss-point detail.
+ */
+
+#define FEM_LOG_LEVEL_ERROR 0
+#define FEM_LOG_LEVEL_WARN  1
+#define FEM_LOG_LEVEL_INFO  2
+#define FEM_LOG_LEVEL_DEBUG 3
+#define FEM_LOG_LEVEL_TRACE 4
+
+#ifndef FEM4C_LOG_MAX_LEVEL
+#ifdef DEBUG
+#define FEM4C_LOG_MAX_LEVEL FEM_LOG_LEVEL_TRACE
+#else
+#define FEM4C_LOG_MAX_LEVEL FEM_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+int fem_log_level(void);
+void fem_log_set_level(int level);
+/* Apply FEM4C_LOG_LEVEL (error|warn|info|debug|trace or 0-4) if set */
+void fem_log_init_from_env(void);
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((format(printf, 2, 3)))
+#endif
+void fem_log_write(int level, const char *format, ...);
+
+/* True if messages of this level are compiled in and enabled; use it to
+ * guard multi-line dumps */
+#define FEM_LOG_ENABLED(level) \
+    ((level) <= FEM4C_LOG_MAX_LEVEL && (level) <= fem_log_level())
+
+#define FEM_LOG_AT(level, ...) \
+    do { \
+        if (FEM_LOG_ENABLED(level)) { \
+            fem_log_write((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+/* Compiled-out calls still type-check their arguments but generate no code */
+#define FEM_LOG_DISABLED(level, ...) \
+    do { \
+        if (0) { \
+            fem_log_write((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#if FEM4C_LOG_MAX_LEVEL >= FEM_LOG_LEVEL_ERROR
+#define FEM_LOG_ERROR(...) FEM_LOG_AT(FEM_LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define FEM_LOG_ERROR(...) FEM_LOG_DISABLED(FEM_LOG_LEVEL_ERROR, __VA_ARGS__)
+#endif
+
+#if FEM4C_LOG_MAX_LEVEL >= FEM_LOG_LEVEL_WARN
+#define FEM_LOG_WARN(...) FEM_LOG_AT(FEM_LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define FEM_LOG_WARN(...) FEM_LOG_DISABLED(FEM_LOG_LEVEL_WARN, __VA_ARGS__)
+#endif
+
+#if FEM4C_LOG_MAX_LEVEL >= FEM_LOG_LEVEL_INFO
+#define FEM_LOG_INFO(...) FEM_LOG_AT(FEM_LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define FEM_LOG_INFO(...) FEM_LOG_DISABLED(FEM_LOG_LEVEL_INFO, __VA_ARGS__)
+#endif
+
+#if FEM4C_LOG_MAX_LEVEL >= FEM_LOG_LEVEL_DEBUG
+#define FEM_LOG_DEBUG(...) FEM_LOG_AT(FEM_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define FEM_LOG_DEBUG(...) FEM_LOG_DISABLED(FEM_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#endif
+
+#if FEM4C_LOG_MAX_LEVEL >= FEM_LOG_LEVEL_TRACE
+#define FEM_LOG_TRACE(...) FEM_LOG_AT(FEM_LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+#define FEM_LOG_TRACE(...) FEM_LOG_DISABLED(FEM_LOG_LEVEL_TRACE, __VA_ARGS__)
+#endif
+
+#endif /* FEM_LOG_H */
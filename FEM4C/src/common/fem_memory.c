@@ -0,0 +1,278 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Memory allocator with accounting
+ *
+ * Each block is carved from a malloc'd region with room for a small header
+ * and the alignment slack; the header sits right below the aligned address
+ * and records where the region starts, the requested size and the
+ * category.
+ */
+
+#include "fem_memory.h"
+#include "fem_thread.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    void *region;
+    size_t size;
+    int category;
+} fem_memory_header_t;
+
+struct fem_arena_block {
+    fem_arena_block_t *prev;
+    size_t size;
+    size_t used;
+};
+
+#define FEM_MEMORY_OVERHEAD (sizeof(fem_memory_header_t) + FEM_MEMORY_ALIGNMENT - 1)
+#define FEM_ARENA_DEFAULT_BLOCK ((size_t)1 << 20)
+
+static fem_mutex_t g_memory_mutex = FEM_MUTEX_INITIALIZER;
+static size_t g_memory_current[FEM_MEMORY_CATEGORY_COUNT];
+static size_t g_memory_peak[FEM_MEMORY_CATEGORY_COUNT];
+static size_t g_memory_total_current;
+static size_t g_memory_total_peak;
+
+static const char *const k_memory_category_names[FEM_MEMORY_CATEGORY_COUNT] = {
+    "mesh", "matrix", "vectors", "I/O buffers"
+};
+
+static size_t fem_memory_align_up(size_t value)
+{
+    return (value + FEM_MEMORY_ALIGNMENT - 1) & ~(size_t)(FEM_MEMORY_ALIGNMENT - 1);
+}
+
+static fem_memory_header_t *fem_memory_header(void *ptr)
+{
+    return (fem_memory_header_t *)((char *)ptr - sizeof(fem_memory_header_t));
+}
+
+/* Aligned user address inside a region */
+static char *fem_memory_place(void *region)
+{
+    uintptr_t base = (uintptr_t)region + sizeof(fem_memory_header_t);
+    return (char *)region + (fem_memory_align_up((size_t)base) - (uintptr_t)region);
+}
+
+static void fem_memory_account(int category, size_t released, size_t acquired)
+{
+    fem_mutex_lock(&g_memory_mutex);
+    g_memory_current[category] = g_memory_current[category] - released + acquired;
+    g_memory_total_current = g_memory_total_current - released + acquired;
+    if (g_memory_current[category] > g_memory_peak[category]) {
+        g_memory_peak[category] = g_memory_current[category];
+    }
+    if (g_memory_total_current > g_memory_total_peak) {
+        g_memory_total_peak = g_memory_total_current;
+    }
+    fem_mutex_unlock(&g_memory_mutex);
+}
+
+void *fem_malloc(size_t size, fem_memory_category_t category)
+{
+    void *region;
+    char *ptr;
+    fem_memory_header_t *header;
+
+    if (size > SIZE_MAX - FEM_MEMORY_OVERHEAD) {
+        return NULL;
+    }
+    region = malloc(size + FEM_MEMORY_OVERHEAD);
+    if (region == NULL) {
+        return NULL;
+    }
+
+    ptr = fem_memory_place(region);
+    header = fem_memory_header(ptr);
+    header->region = region;
+    header->size = size;
+    header->category = (int)category;
+    fem_memory_account((int)category, 0, size);
+    return ptr;
+}
+
+void *fem_calloc(size_t count, size_t size, fem_memory_category_t category)
+{
+    void *ptr;
+
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    ptr = fem_malloc(count * size, category);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void *fem_realloc(void *ptr, size_t size, fem_memory_category_t category)
+{
+    fem_memory_header_t *header;
+    size_t old_size;
+    size_t old_offset;
+    int old_category;
+    void *region;
+    char *moved;
+
+    if (ptr == NULL) {
+        return fem_malloc(size, category);
+    }
+    if (size > SIZE_MAX - FEM_MEMORY_OVERHEAD) {
+        return NULL;
+    }
+
+    header = fem_memory_header(ptr);
+    old_size = header->size;
+    old_category = header->category;
+    old_offset = (size_t)((char *)ptr - (char *)header->region);
+
+    region = realloc(header->region, size + FEM_MEMORY_OVERHEAD);
+    if (region == NULL) {
+        return NULL;
+    }
+
+    /* The new region may sit at a different alignment phase: shift the
+     * payload to the aligned address of the new region */
+    moved = fem_memory_place(region);
+    if ((size_t)(moved - (char *)region) != old_offset) {
+        memmove(moved, (char *)region + old_offset, old_size < size ? old_size : size);
+    }
+
+    header = fem_memory_header(moved);
+    header->region = region;
+    header->size = size;
+    header->category = old_category;
+    fem_memory_account(old_category, old_size, size);
+    return moved;
+}
+
+void fem_free(void *ptr)
+{
+    fem_memory_header_t *header;
+
+    if (ptr == NULL) {
+        return;
+    }
+    header = fem_memory_header(ptr);
+    fem_memory_account(header->category, header->size, 0);
+    free(header->region);
+}
+
+size_t fem_memory_current(fem_memory_category_t category)
+{
+    size_t value;
+
+    fem_mutex_lock(&g_memory_mutex);
+    value = category < FEM_MEMORY_CATEGORY_COUNT ? g_memory_current[category]
+                                                 : g_memory_total_current;
+    fem_mutex_unlock(&g_memory_mutex);
+    return value;
+}
+
+size_t fem_memory_peak(fem_memory_category_t category)
+{
+    size_t value;
+
+    fem_mutex_lock(&g_memory_mutex);
+    value = category < FEM_MEMORY_CATEGORY_COUNT ? g_memory_peak[category]
+                                                 : g_memory_total_peak;
+    fem_mutex_unlock(&g_memory_mutex);
+    return value;
+}
+
+const char *fem_memory_category_name(fem_memory_category_t category)
+{
+    return category < FEM_MEMORY_CATEGORY_COUNT ? k_memory_category_names[category] : "total";
+}
+
+void fem_memory_report(FILE *fp)
+{
+    const double mb = 1024.0 * 1024.0;
+
+    fprintf(fp, "Memory usage (MB):      current         peak\n");
+    for (int c = 0; c <= FEM_MEMORY_CATEGORY_COUNT; ++c) {
+        fem_memory_category_t category = (fem_memory_category_t)c;
+        fprintf(fp, "  %-16s %12.3f %12.3f\n", fem_memory_category_name(category),
+                (double)fem_memory_current(category) / mb,
+                (double)fem_memory_peak(category) / mb);
+    }
+}
+
+void fem_arena_init(fem_arena_t *arena, size_t block_size, fem_memory_category_t category)
+{
+    arena->head = NULL;
+    arena->block_size = block_size > 0 ? block_size : FEM_ARENA_DEFAULT_BLOCK;
+    arena->category = category;
+}
+
+void *fem_arena_alloc(fem_arena_t *arena, size_t size)
+{
+    const size_t data_offset = fem_memory_align_up(sizeof(fem_arena_block_t));
+    fem_arena_block_t *block = arena->head;
+    size_t aligned = fem_memory_align_up(size);
+
+    if (aligned < size) {
+        return NULL;
+    }
+    if (block == NULL || block->size - block->used < aligned) {
+        size_t block_size = arena->block_size > 0 ? arena->block_size : FEM_ARENA_DEFAULT_BLOCK;
+        size_t capacity = aligned > block_size ? aligned : block_size;
+        if (capacity > SIZE_MAX - data_offset) {
+            return NULL;
+        }
+        block = (fem_arena_block_t *)fem_malloc(data_offset + capacity, arena->category);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->prev = arena->head;
+        block->size = capacity;
+        block->used = 0;
+        arena->head = block;
+    }
+
+    block->used += aligned;
+    return (char *)block + data_offset + (block->used - aligned);
+}
+
+fem_arena_mark_t fem_arena_mark(const fem_arena_t *arena)
+{
+    fem_arena_mark_t mark;
+    mark.block = arena->head;
+    mark.used = arena->head ? arena->head->used : 0;
+    return mark;
+}
+
+/* Drop everything allocated after mark. Blocks chained on top of the mark
+ * are freed; when the arena empties and the phase needed more than one
+ * block, the block size grows so the next phase fits in a single block. */
+void fem_arena_rewind(fem_arena_t *arena, fem_arena_mark_t mark)
+{
+    size_t spilled = 0;
+
+    while (arena->head != NULL && arena->head != mark.block) {
+        fem_arena_block_t *block = arena->head;
+        if (block->prev == NULL && mark.block == NULL && spilled == 0) {
+            break;  /* keep the only block for the next phase */
+        }
+        spilled += block->size;
+        arena->head = block->prev;
+        fem_free(block);
+    }
+
+    if (arena->head != NULL) {
+        arena->head->used = arena->head == mark.block ? mark.used : 0;
+    }
+    if (mark.block == NULL && spilled > arena->block_size) {
+        arena->block_size = spilled;
+    }
+}
+
+void fem_arena_free(fem_arena_t *arena)
+{
+    while (arena->head != NULL) {
+        fem_arena_block_t *block = arena->head;
+        arena->head = block->prev;
+        fem_free(block);
+    }
+}
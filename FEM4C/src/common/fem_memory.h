@@ -0,0 +1,67 @@
+#ifndef FEM_MEMORY_H
+#define FEM_MEMORY_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Memory allocator with accounting
+ *
+ * Model, system and output storage is allocated through fem_malloc and
+ * friends. Every block is FEM_MEMORY_ALIGNMENT-byte aligned and counted
+ * against one category, so a run can report its current and peak
+ * footprint per category. The counters are process-wide: with several
+ * analyses in one process (batch, service) they add up.
+ *
+ * Blocks from fem_malloc/fem_calloc/fem_realloc must be released with
+ * fem_free, never with free().
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define FEM_MEMORY_ALIGNMENT 64
+
+typedef enum {
+    FEM_MEMORY_MESH = 0,    /* nodes, elements, materials, ID maps */
+    FEM_MEMORY_MATRIX,      /* skyline profile and stiffness values */
+    FEM_MEMORY_VECTOR,      /* load, displacement and solver vectors */
+    FEM_MEMORY_IO,          /* result formatting buffers */
+    FEM_MEMORY_CATEGORY_COUNT
+} fem_memory_category_t;
+
+void *fem_malloc(size_t size, fem_memory_category_t category);
+void *fem_calloc(size_t count, size_t size, fem_memory_category_t category);
+/* Like realloc(); a NULL ptr allocates, the block keeps its category on
+ * resize. On failure ptr is left untouched. */
+void *fem_realloc(void *ptr, size_t size, fem_memory_category_t category);
+void fem_free(void *ptr);
+
+/* Bytes currently allocated and the high-water mark, for one category or
+ * for all of them (category = FEM_MEMORY_CATEGORY_COUNT) */
+size_t fem_memory_current(fem_memory_category_t category);
+size_t fem_memory_peak(fem_memory_category_t category);
+const char *fem_memory_category_name(fem_memory_category_t category);
+void fem_memory_report(FILE *fp);
+
+/* Bump allocator for temporaries of one analysis phase. Allocations are
+ * released together by rewinding to a mark taken before them; the blocks
+ * stay with the arena, so repeated phases (re-solves, batch jobs) reuse
+ * them instead of going back to the allocator. */
+typedef struct fem_arena_block fem_arena_block_t;
+
+typedef struct {
+    fem_arena_block_t *head;
+    size_t block_size;
+    fem_memory_category_t category;
+} fem_arena_t;
+
+typedef struct {
+    fem_arena_block_t *block;
+    size_t used;
+} fem_arena_mark_t;
+
+void fem_arena_init(fem_arena_t *arena, size_t block_size, fem_memory_category_t category);
+void *fem_arena_alloc(fem_arena_t *arena, size_t size);
+fem_arena_mark_t fem_arena_mark(const fem_arena_t *arena);
+void fem_arena_rewind(fem_arena_t *arena, fem_arena_mark_t mark);
+void fem_arena_free(fem_arena_t *arena);
+
+#endif /* FEM_MEMORY_H */
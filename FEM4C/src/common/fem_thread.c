@@ -0,0 +1,179 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Minimal thread wrapper implementation
+ */
+
+/* clock_gettime */
+#define _POSIX_C_SOURCE 200112L
+
+#include "fem_thread.h"
+#include "fem_context.h"
+#include "error.h"
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+double fem_wall_time(void)
+{
+#ifdef _OPENMP
+    return omp_get_wtime();
+#elif defined(_WIN32)
+    /* clock() measures wall time on Windows */
+    return (double)clock() / CLOCKS_PER_SEC;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + 1.0e-9 * (double)now.tv_nsec;
+#endif
+}
+
+#if FEM_THREADS_AVAILABLE
+
+typedef struct {
+    fem_thread_func_t func;
+    void *arg;
+    fem_context_t *context;
+} fem_thread_start_t;
+
+/* Bind the creator's analysis context, then run the thread function */
+static void *fem_thread_start(void *arg)
+{
+    fem_thread_start_t start = *(fem_thread_start_t *)arg;
+    free(arg);
+    fem_context_bind(start.context);
+    return start.func(start.arg);
+}
+
+fem_error_t fem_thread_create(fem_thread_t *thread, fem_thread_func_t func, void *arg)
+{
+    fem_thread_start_t *start = (fem_thread_start_t *)malloc(sizeof(fem_thread_start_t));
+    if (start == NULL) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate thread start block");
+    }
+    start->func = func;
+    start->arg = arg;
+    start->context = g_fem_context;
+
+    if (pthread_create(thread, NULL, fem_thread_start, start) != 0) {
+        free(start);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to create worker thread");
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t fem_thread_join(fem_thread_t *thread, void **result)
+{
+    if (pthread_join(*thread, result) != 0) {
+        return error_set(FEM_ERROR_UNKNOWN, "Failed to join worker thread");
+    }
+    return FEM_SUCCESS;
+}
+
+void fem_mutex_lock(fem_mutex_t *mutex)
+{
+    pthread_mutex_lock(mutex);
+}
+
+void fem_mutex_unlock(fem_mutex_t *mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+fem_error_t fem_mutex_init(fem_mutex_t *mutex)
+{
+    if (pthread_mutex_init(mutex, NULL) != 0) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to initialize mutex");
+    }
+    return FEM_SUCCESS;
+}
+
+void fem_mutex_destroy(fem_mutex_t *mutex)
+{
+    pthread_mutex_destroy(mutex);
+}
+
+fem_error_t fem_cond_init(fem_cond_t *cond)
+{
+    if (pthread_cond_init(cond, NULL) != 0) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to initialize condition variable");
+    }
+    return FEM_SUCCESS;
+}
+
+void fem_cond_destroy(fem_cond_t *cond)
+{
+    pthread_cond_destroy(cond);
+}
+
+void fem_cond_wait(fem_cond_t *cond, fem_mutex_t *mutex)
+{
+    pthread_cond_wait(cond, mutex);
+}
+
+void fem_cond_broadcast(fem_cond_t *cond)
+{
+    pthread_cond_broadcast(cond);
+}
+
+#else
+
+fem_error_t fem_thread_create(fem_thread_t *thread, fem_thread_func_t func, void *arg)
+{
+    thread->result = func(arg);
+    return FEM_SUCCESS;
+}
+
+fem_error_t fem_thread_join(fem_thread_t *thread, void **result)
+{
+    if (result) {
+        *result = thread->result;
+    }
+    return FEM_SUCCESS;
+}
+
+void fem_mutex_lock(fem_mutex_t *mutex)
+{
+    (void)mutex;
+}
+
+void fem_mutex_unlock(fem_mutex_t *mutex)
+{
+    (void)mutex;
+}
+
+fem_error_t fem_mutex_init(fem_mutex_t *mutex)
+{
+    *mutex = 0;
+    return FEM_SUCCESS;
+}
+
+void fem_mutex_destroy(fem_mutex_t *mutex)
+{
+    (void)mutex;
+}
+
+fem_error_t fem_cond_init(fem_cond_t *cond)
+{
+    *cond = 0;
+    return FEM_SUCCESS;
+}
+
+void fem_cond_destroy(fem_cond_t *cond)
+{
+    (void)cond;
+}
+
+void fem_cond_wait(fem_cond_t *cond, fem_mutex_t *mutex)
+{
+    (void)cond;
+    (void)mutex;
+}
+
+void fem_cond_broadcast(fem_cond_t *cond)
+{
+    (void)cond;
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef FEM_THREAD_H
+#define FEM_THREAD_H
+
+/* FEM4C - Minimal thread wrapper
+ * POSIX threads where available. Builds without threads (Windows without
+ * pthreads, or -DFEM4C_NO_THREADS) run the thread function inline at
+ * creation time, so callers need no separate code path. New threads start
+ * bound to the analysis context of the thread that created them. Condition
+ * waits do not block in such builds; code that hands work between threads
+ * checks FEM_THREADS_AVAILABLE first.
+ */
+
+#include "types.h"
+
+typedef void *(*fem_thread_func_t)(void *arg);
+
+/* Thread-local storage qualifier (C99 has none of its own) */
+#if defined(_MSC_VER)
+#define FEM_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define FEM_THREAD_LOCAL __thread
+#else
+#define FEM_THREAD_LOCAL
+#endif
+
+#if defined(FEM4C_NO_THREADS) || (defined(_WIN32) && !defined(__MINGW32__))
+#define FEM_THREADS_AVAILABLE 0
+typedef struct {
+    void *result;
+} fem_thread_t;
+typedef int fem_mutex_t;
+typedef int fem_cond_t;
+#define FEM_MUTEX_INITIALIZER 0
+#else
+#include <pthread.h>
+#define FEM_THREADS_AVAILABLE 1
+typedef pthread_t fem_thread_t;
+typedef pthread_mutex_t fem_mutex_t;
+typedef pthread_cond_t fem_cond_t;
+#define FEM_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#endif
+
+fem_error_t fem_thread_create(fem_thread_t *thread, fem_thread_func_t func, void *arg);
+fem_error_t fem_thread_join(fem_thread_t *thread, void **result);
+void fem_mutex_lock(fem_mutex_t *mutex);
+void fem_mutex_unlock(fem_mutex_t *mutex);
+
+/* Mutexes and condition variables that live in allocated objects */
+fem_error_t fem_mutex_init(fem_mutex_t *mutex);
+void fem_mutex_destroy(fem_mutex_t *mutex);
+fem_error_t fem_cond_init(fem_cond_t *cond);
+void fem_cond_destroy(fem_cond_t *cond);
+void fem_cond_wait(fem_cond_t *cond, fem_mutex_t *mutex);
+void fem_cond_broadcast(fem_cond_t *cond);
+
+/* Wall-clock seconds from an arbitrary origin (clock() counts the CPU time
+ * of all threads) */
+double fem_wall_time(void);
+
+#endif /* FEM_THREAD_H */
@@ -1,5 +1,5 @@
 /* FEM4C - High Performance Finite Element Method in C
- * Global variable definitions
+ * Global state management (storage lives in the bound fem_context_t)
  */
 
 #include "globals.h"
@@ -12,37 +12,8 @@
 static fem_error_t globals_resize_nodes(int new_capacity);
 static fem_error_t globals_resize_elements(int new_capacity);
 static fem_error_t globals_resize_materials(int new_capacity);
-static fem_error_t globals_resize_node_id_map(int new_capacity);
-static fem_error_t globals_resize_element_id_map(int new_capacity);
-static fem_error_t globals_resize_material_id_map(int new_capacity);
 static void globals_free_mesh_arrays(void);
 
-/* Global arrays - actual storage (dynamically sized) */
-double (*g_node_coords)[3] = NULL;
-double (*g_node_displ)[3] = NULL;
-double (*g_node_force)[3] = NULL;
-int (*g_node_bc_flags)[3] = NULL;
-int *g_node_ids = NULL;
-int *g_node_id_to_index = NULL;
-
-int (*g_element_nodes)[MAX_NODES_PER_ELEMENT] = NULL;
-int *g_element_type = NULL;
-int *g_element_material = NULL;
-int *g_element_ids = NULL;
-int *g_element_id_to_index = NULL;
-
-double (*g_material_props)[6] = NULL;
-int *g_material_type = NULL;
-int *g_material_ids = NULL;
-int *g_material_id_to_index = NULL;
-
-int g_node_capacity = 0;
-int g_element_capacity = 0;
-int g_material_capacity = 0;
-int g_node_id_capacity = 0;
-int g_element_id_capacity = 0;
-int g_material_id_capacity = 0;
-
 static fem_error_t globals_resize_nodes(int new_capacity)
 {
     if (new_capacity <= g_node_capacity) {
@@ -52,35 +23,35 @@ static fem_error_t globals_resize_nodes(int new_capacity)
         return FEM_SUCCESS;
     }
 
-    double (*coords)[3] = realloc(g_node_coords, (size_t)new_capacity * sizeof(*g_node_coords));
+    double (*coords)[3] = fem_realloc(g_node_coords, (size_t)new_capacity * sizeof(*g_node_coords), FEM_MEMORY_MESH);
     if (!coords) {
         globals_free_mesh_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize node coordinates");
     }
     g_node_coords = coords;
 
-    double (*displ)[3] = realloc(g_node_displ, (size_t)new_capacity * sizeof(*g_node_displ));
+    double (*displ)[3] = fem_realloc(g_node_displ, (size_t)new_capacity * sizeof(*g_node_displ), FEM_MEMORY_MESH);
     if (!displ) {
         globals_free_mesh_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize node displacements");
     }
     g_node_displ = displ;
 
-    double (*force)[3] = realloc(g_node_force, (size_t)new_capacity * sizeof(*g_node_force));
+    double (*force)[3] = fem_realloc(g_node_force, (size_t)new_capacity * sizeof(*g_node_force), FEM_MEMORY_MESH);
     if (!force) {
         globals_free_mesh_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize node force array");
     }
     g_node_force = force;
 
-    int (*flags)[3] = realloc(g_node_bc_flags, (size_t)new_capacity * sizeof(*g_node_bc_flags));
+    int (*flags)[3] = fem_realloc(g_node_bc_flags, (size_t)new_capacity * sizeof(*g_node_bc_flags), FEM_MEMORY_MESH);
     if (!flags) {
         globals_free_mesh_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize node boundary flag array");
     }
     g_node_bc_flags = flags;
 
-    int *ids = realloc(g_node_ids, (size_t)new_capacity * sizeof(*g_node_ids));
+    int *ids = fem_realloc(g_node_ids, (size_t)new_capacity * sizeof(*g_node_ids), FEM_MEMORY_MESH);
     if (!ids) {
         globals_free_mesh_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize node ID array");
@@ -105,28 +76,28 @@ static fem_error_t globals_resize_elements(int new_capacity)
     }
 
     int (*nodes)[MAX_NODES_PER_ELEMENT] =
-        realloc(g_element_nodes, (size_t)new_capacity * sizeof(*g_element_nodes));
+        fem_realloc(g_element_nodes, (size_t)new_capacity * sizeof(*g_element_nodes), FEM_MEMORY_MESH);
     if (!nodes) {
         globals_free_mesh_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize element connectivity array");
     }
     g_element_nodes = nodes;
 
-    int *types = realloc(g_element_type, (size_t)new_capacity * sizeof(*g_element_type));
+    int *types = fem_realloc(g_element_type, (size_t)new_capacity * sizeof(*g_element_type), FEM_MEMORY_MESH);
     if (!types) {
         globals_free_mesh_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize element type array");
     }
     g_element_type = types;
 
-    int *materials = realloc(g_element_material, (size_t)new_capacity * sizeof(*g_element_material));
+    int *materials = fem_realloc(g_element_material, (size_t)new_capacity * sizeof(*g_element_material), FEM_MEMORY_MESH);
     if (!materials) {
         globals_free_mesh_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize element material array");
     }
     g_element_material = materials;
 
-    int *ids = realloc(g_element_ids, (size_t)new_capacity * sizeof(*g_element_ids));
+    int *ids = fem_realloc(g_element_ids, (size_t)new_capacity * sizeof(*g_element_ids), FEM_MEMORY_MESH);
     if (!ids) {
         globals_free_mesh_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize element ID array");
@@ -150,21 +121,21 @@ static fem_error_t globals_resize_materials(int new_capacity)
         return FEM_SUCCESS;
     }
 
-    double (*props)[6] = realloc(g_material_props, (size_t)new_capacity * sizeof(*g_material_props));
+    double (*props)[6] = fem_realloc(g_material_props, (size_t)new_capacity * sizeof(*g_material_props), FEM_MEMORY_MESH);
     if (!props) {
         globals_free_mesh_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize material property array");
     }
     g_material_props = props;
 
-    int *types = realloc(g_material_type, (size_t)new_capacity * sizeof(*g_material_type));
+    int *types = fem_realloc(g_material_type, (size_t)new_capacity * sizeof(*g_material_type), FEM_MEMORY_MESH);
     if (!types) {
         globals_free_mesh_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize material type array");
     }
     g_material_type = types;
 
-    int *ids = realloc(g_material_ids, (size_t)new_capacity * sizeof(*g_material_ids));
+    int *ids = fem_realloc(g_material_ids, (size_t)new_capacity * sizeof(*g_material_ids), FEM_MEMORY_MESH);
     if (!ids) {
         globals_free_mesh_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize material ID array");
@@ -179,113 +150,54 @@ static fem_error_t globals_resize_materials(int new_capacity)
     return FEM_SUCCESS;
 }
 
-static fem_error_t globals_resize_node_id_map(int new_capacity)
-{
-    if (new_capacity <= g_node_id_capacity) {
-        return FEM_SUCCESS;
-    }
-    if (new_capacity <= 0) {
-        return FEM_SUCCESS;
-    }
-
-    int *map = realloc(g_node_id_to_index, (size_t)new_capacity * sizeof(*g_node_id_to_index));
-    if (!map) {
-        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize node ID map");
-    }
-    for (int i = g_node_id_capacity; i < new_capacity; ++i) {
-        map[i] = -1;
-    }
-    g_node_id_to_index = map;
-    g_node_id_capacity = new_capacity;
-    return FEM_SUCCESS;
-}
-
-static fem_error_t globals_resize_element_id_map(int new_capacity)
-{
-    if (new_capacity <= g_element_id_capacity) {
-        return FEM_SUCCESS;
-    }
-    if (new_capacity <= 0) {
-        return FEM_SUCCESS;
-    }
-
-    int *map = realloc(g_element_id_to_index, (size_t)new_capacity * sizeof(*g_element_id_to_index));
-    if (!map) {
-        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize element ID map");
-    }
-    for (int i = g_element_id_capacity; i < new_capacity; ++i) {
-        map[i] = -1;
-    }
-    g_element_id_to_index = map;
-    g_element_id_capacity = new_capacity;
-    return FEM_SUCCESS;
-}
-
-static fem_error_t globals_resize_material_id_map(int new_capacity)
-{
-    if (new_capacity <= g_material_id_capacity) {
-        return FEM_SUCCESS;
-    }
-    if (new_capacity <= 0) {
-        return FEM_SUCCESS;
-    }
-
-    int *map = realloc(g_material_id_to_index, (size_t)new_capacity * sizeof(*g_material_id_to_index));
-    if (!map) {
-        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize material ID map");
-    }
-    for (int i = g_material_id_capacity; i < new_capacity; ++i) {
-        map[i] = -1;
-    }
-    g_material_id_to_index = map;
-    g_material_id_capacity = new_capacity;
-    return FEM_SUCCESS;
-}
-
 static void globals_free_mesh_arrays(void)
 {
-    free(g_node_coords);
-    free(g_node_displ);
-    free(g_node_force);
-    free(g_node_bc_flags);
-    free(g_node_ids);
-    free(g_node_id_to_index);
-
-    free(g_element_nodes);
-    free(g_element_type);
-    free(g_element_material);
-    free(g_element_ids);
-    free(g_element_id_to_index);
-
-    free(g_material_props);
-    free(g_material_type);
-    free(g_material_ids);
-    free(g_material_id_to_index);
+    fem_free(g_node_coords);
+    fem_free(g_node_displ);
+    fem_free(g_node_force);
+    fem_free(g_node_bc_flags);
+    fem_free(g_node_ids);
+    id_map_free(&g_node_id_map);
+
+    fem_free(g_element_nodes);
+    fem_free(g_element_type);
+    fem_free(g_element_material);
+    fem_free(g_element_ids);
+    id_map_free(&g_element_id_map);
+    fem_free(g_element_quality);
+    g_element_quality = NULL;
+    g_element_quality_count = 0;
+    g_element_quality_capacity = 0;
+
+    fem_free(g_material_props);
+    fem_free(g_material_type);
+    fem_free(g_material_ids);
+    id_map_free(&g_material_id_map);
+
+    fem_free(g_nastran_element_property);
+    g_nastran_element_property = NULL;
+    g_nastran_element_property_capacity = 0;
+
+    globals_free_mpc_data();
 
     g_node_coords = NULL;
     g_node_displ = NULL;
     g_node_force = NULL;
     g_node_bc_flags = NULL;
     g_node_ids = NULL;
-    g_node_id_to_index = NULL;
 
     g_element_nodes = NULL;
     g_element_type = NULL;
     g_element_material = NULL;
     g_element_ids = NULL;
-    g_element_id_to_index = NULL;
 
     g_material_props = NULL;
     g_material_type = NULL;
     g_material_ids = NULL;
-    g_material_id_to_index = NULL;
 
     g_node_capacity = 0;
     g_element_capacity = 0;
     g_material_capacity = 0;
-    g_node_id_capacity = 0;
-    g_element_id_capacity = 0;
-    g_material_id_capacity = 0;
 }
 
 static int globals_next_capacity(int current, int required, int initial, int block_size)
@@ -345,14 +257,27 @@ fem_error_t globals_reserve_materials(int required)
     return globals_resize_materials(new_capacity);
 }
 
+/* Size the mesh arrays to exact final counts (no growth headroom) when a
+ * reader knows them up front */
+fem_error_t globals_reserve_model(int nodes, int elements, int materials)
+{
+    fem_error_t err;
+
+    err = globals_resize_nodes(nodes);
+    CHECK_ERROR(err);
+    err = globals_resize_elements(elements);
+    CHECK_ERROR(err);
+    err = globals_resize_materials(materials);
+    CHECK_ERROR(err);
+    return FEM_SUCCESS;
+}
+
 fem_error_t globals_reserve_node_ids(int max_id_plus_one)
 {
     if (max_id_plus_one <= 0) {
         return FEM_SUCCESS;
     }
-    int new_capacity = globals_next_capacity(g_node_id_capacity, max_id_plus_one,
-                                             NODE_ID_BLOCK_SIZE, NODE_ID_BLOCK_SIZE);
-    return globals_resize_node_id_map(new_capacity);
+    return id_map_reserve(&g_node_id_map, max_id_plus_one, g_node_capacity);
 }
 
 fem_error_t globals_reserve_element_ids(int max_id_plus_one)
@@ -360,9 +285,7 @@ fem_error_t globals_reserve_element_ids(int max_id_plus_one)
     if (max_id_plus_one <= 0) {
         return FEM_SUCCESS;
     }
-    int new_capacity = globals_next_capacity(g_element_id_capacity, max_id_plus_one,
-                                             ELEMENT_ID_BLOCK_SIZE, ELEMENT_ID_BLOCK_SIZE);
-    return globals_resize_element_id_map(new_capacity);
+    return id_map_reserve(&g_element_id_map, max_id_plus_one, g_element_capacity);
 }
 
 fem_error_t globals_reserve_material_ids(int max_id_plus_one)
@@ -370,9 +293,7 @@ fem_error_t globals_reserve_material_ids(int max_id_plus_one)
     if (max_id_plus_one <= 0) {
         return FEM_SUCCESS;
     }
-    int new_capacity = globals_next_capacity(g_material_id_capacity, max_id_plus_one,
-                                             MATERIAL_ID_BLOCK_SIZE, MATERIAL_ID_BLOCK_SIZE);
-    return globals_resize_material_id_map(new_capacity);
+    return id_map_reserve(&g_material_id_map, max_id_plus_one, g_material_capacity);
 }
 
 void globals_initialize_node_entry(int node_index)
@@ -434,45 +355,6 @@ void globals_initialize_material_entry(int material_index)
     }
 }
 
-/* Global system arrays (allocated dynamically based on DOF count) */
-double *g_global_force = NULL;
-double *g_global_displ = NULL;
-
-/* Skyline stiffness storage */
-double *g_global_stiffness_values = NULL;
-int *g_stiffness_profile = NULL;
-int *g_stiffness_offsets = NULL;
-int g_stiffness_value_count = 0;
-int g_stiffness_bandwidth = 0;
-
-/* Distributed load data */
-double g_body_force[3];
-double g_pressure_value = 0.0;
-int g_has_body_force = 0;
-int g_has_pressure = 0;
-int g_num_tractions = 0;
-int g_traction_surfaces[MAX_TRACTION_SURFACES][MAX_SURFACE_NODES];
-double g_traction_values[MAX_TRACTION_SURFACES][3];
-int g_num_pressure_surfaces = 0;
-int g_pressure_surfaces[MAX_TRACTION_SURFACES][MAX_SURFACE_NODES];
-
-/* Analysis control variables */
-analysis_control_t g_analysis;
-solver_info_t g_solver_info;
-
-/* Problem size variables */
-int g_num_nodes = 0;
-int g_num_elements = 0;
-int g_num_materials = 0;
-int g_total_dof = 0;
-
-/* File names */
-char g_input_filename[MAX_FILENAME_LEN];
-char g_output_filename[MAX_FILENAME_LEN];
-
-/* OpenMP control */
-int g_num_threads = 1;
-
 /* Initialize global variables */
 fem_error_t globals_initialize(void)
 {
@@ -521,52 +403,27 @@ fem_error_t globals_finalize(void)
 {
     globals_free_system_arrays();
     globals_free_mesh_arrays();
+    fem_arena_free(&g_scratch_arena);
     return FEM_SUCCESS;
 }
 
 /* Reset all global arrays to zero */
 void globals_reset(void)
 {
-    if (g_node_ids && g_node_id_to_index) {
-        for (int i = 0; i < g_num_nodes; ++i) {
-            int id = g_node_ids[i];
-            if (id >= 0 && id < g_node_id_capacity) {
-                g_node_id_to_index[id] = -1;
-            }
-            globals_initialize_node_entry(i);
-        }
-    } else if (g_node_capacity > 0) {
-        for (int i = 0; i < g_node_capacity; ++i) {
-            globals_initialize_node_entry(i);
-        }
+    id_map_clear(&g_node_id_map);
+    for (int i = 0; i < g_num_nodes; ++i) {
+        globals_initialize_node_entry(i);
     }
 
-    if (g_element_ids && g_element_id_to_index) {
-        for (int i = 0; i < g_num_elements; ++i) {
-            int id = g_element_ids[i];
-            if (id >= 0 && id < g_element_id_capacity) {
-                g_element_id_to_index[id] = -1;
-            }
-            globals_initialize_element_entry(i);
-        }
-    } else if (g_element_capacity > 0) {
-        for (int i = 0; i < g_element_capacity; ++i) {
-            globals_initialize_element_entry(i);
-        }
+    id_map_clear(&g_element_id_map);
+    g_element_quality_count = 0;
+    for (int i = 0; i < g_num_elements; ++i) {
+        globals_initialize_element_entry(i);
     }
 
-    if (g_material_ids && g_material_id_to_index) {
-        for (int i = 0; i < g_num_materials; ++i) {
-            int id = g_material_ids[i];
-            if (id >= 0 && id < g_material_id_capacity) {
-                g_material_id_to_index[id] = -1;
-            }
-            globals_initialize_material_entry(i);
-        }
-    } else if (g_material_capacity > 0) {
-        for (int i = 0; i < g_material_capacity; ++i) {
-            globals_initialize_material_entry(i);
-        }
+    id_map_clear(&g_material_id_map);
+    for (int i = 0; i < g_num_materials; ++i) {
+        globals_initialize_material_entry(i);
     }
 
     /* Reset load data */
@@ -594,6 +451,7 @@ void globals_reset(void)
     g_num_elements = 0;
     g_num_materials = 0;
     g_total_dof = 0;
+    g_analysis.spatial_dimension = 2;
 }
 
 /* Allocate system arrays based on total DOF */
@@ -605,8 +463,8 @@ fem_error_t globals_allocate_system_arrays(int total_dof)
 
     globals_free_system_arrays();
 
-    g_global_force = (double *)calloc((size_t)total_dof, sizeof(double));
-    g_global_displ = (double *)calloc((size_t)total_dof, sizeof(double));
+    g_global_force = (double *)fem_calloc((size_t)total_dof, sizeof(double), FEM_MEMORY_VECTOR);
+    g_global_displ = (double *)fem_calloc((size_t)total_dof, sizeof(double), FEM_MEMORY_VECTOR);
 
     if (!g_global_force || !g_global_displ) {
         globals_free_system_arrays();
@@ -621,26 +479,105 @@ fem_error_t globals_allocate_system_arrays(int total_dof)
 void globals_free_system_arrays(void)
 {
     if (g_global_force) {
-        free(g_global_force);
+        fem_free(g_global_force);
         g_global_force = NULL;
     }
     if (g_global_displ) {
-        free(g_global_displ);
+        fem_free(g_global_displ);
         g_global_displ = NULL;
     }
     if (g_global_stiffness_values) {
-        free(g_global_stiffness_values);
+        fem_free(g_global_stiffness_values);
         g_global_stiffness_values = NULL;
     }
     if (g_stiffness_profile) {
-        free(g_stiffness_profile);
+        fem_free(g_stiffness_profile);
         g_stiffness_profile = NULL;
     }
     if (g_stiffness_offsets) {
-        free(g_stiffness_offsets);
+        fem_free(g_stiffness_offsets);
         g_stiffness_offsets = NULL;
     }
     g_stiffness_value_count = 0;
     g_stiffness_bandwidth = 0;
+
+    fem_free(g_block_row_offsets);
+    fem_free(g_block_columns);
+    fem_free(g_block_values);
+    fem_free(g_block_diagonal);
+    fem_free(g_color_offsets);
+    fem_free(g_color_elements);
+    g_block_row_offsets = NULL;
+    g_block_columns = NULL;
+    g_block_values = NULL;
+    g_block_diagonal = NULL;
+    g_color_offsets = NULL;
+    g_color_elements = NULL;
+    g_block_count = 0;
+    g_color_count = 0;
     g_total_dof = 0;
+
+    /* Recovered stresses and reactions belong to the solution being released */
+    globals_free_reaction_data();
+    globals_free_stress_results();
+}
+
+/* Free the stored constrained rows and the reactions */
+void globals_free_reaction_data(void)
+{
+    fem_free(g_reaction_dofs);
+    fem_free(g_reaction_row_offsets);
+    fem_free(g_reaction_columns);
+    fem_free(g_reaction_values);
+    fem_free(g_reaction_loads);
+    fem_free(g_node_reaction);
+    g_reaction_dofs = NULL;
+    g_reaction_row_offsets = NULL;
+    g_reaction_columns = NULL;
+    g_reaction_values = NULL;
+    g_reaction_loads = NULL;
+    g_node_reaction = NULL;
+    g_reaction_dof_count = 0;
+    g_reactions_current = 0;
+}
+
+/* Free the multipoint constraint map */
+void globals_free_mpc_data(void)
+{
+    fem_free(g_mpc_dof_row);
+    fem_free(g_mpc_dependent_dofs);
+    fem_free(g_mpc_row_offsets);
+    fem_free(g_mpc_masters);
+    fem_free(g_mpc_coefficients);
+    g_mpc_dof_row = NULL;
+    g_mpc_dependent_dofs = NULL;
+    g_mpc_row_offsets = NULL;
+    g_mpc_masters = NULL;
+    g_mpc_coefficients = NULL;
+    g_mpc_row_count = 0;
+    g_mpc_max_terms = 0;
+}
+
+/* Free the stress recovery results */
+void globals_free_stress_results(void)
+{
+    fem_free(g_element_stress);
+    fem_free(g_element_stress_valid);
+    fem_free(g_gauss_stress_offsets);
+    fem_free(g_gauss_stress);
+    fem_free(g_gauss_point_coords);
+    fem_free(g_nodal_stress);
+    fem_free(g_nodal_stress_spr);
+    fem_free(g_solid_stress);
+    fem_free(g_solid_nodal_stress);
+    g_element_stress = NULL;
+    g_element_stress_valid = NULL;
+    g_gauss_stress_offsets = NULL;
+    g_gauss_stress = NULL;
+    g_gauss_point_coords = NULL;
+    g_nodal_stress = NULL;
+    g_nodal_stress_spr = NULL;
+    g_solid_stress = NULL;
+    g_solid_nodal_stress = NULL;
+    g_stress_element_count = 0;
 }
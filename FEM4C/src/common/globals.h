@@ -6,23 +6,31 @@
  */
 
 #include "constants.h"
-#include "types.h"
+#include "types.h"
+#include "id_map.h"
+#include "fem_context.h"
+
+/* Compatibility layer: the historical global names refer to the fields of
+ * the analysis context bound to the calling thread (see fem_context.h). */
 
 /* Global arrays - dynamically sized */
-extern double (*g_node_coords)[3];           /* Node coordinates */
-extern double (*g_node_displ)[3];            /* Node displacements */
-extern double (*g_node_force)[3];            /* Node external forces */
-extern int (*g_node_bc_flags)[3];            /* Boundary condition flags */
-extern int *g_node_ids;                      /* Original node identifiers */
-extern int *g_node_id_to_index;              /* Mapping from original ID to internal index */
+#define g_node_coords               (g_fem_context->node_coords)       /* Node coordinates */
+#define g_node_displ                (g_fem_context->node_displ)        /* Node displacements */
+#define g_node_force                (g_fem_context->node_force)        /* Node external forces */
+#define g_node_bc_flags             (g_fem_context->node_bc_flags)     /* Boundary condition flags */
+#define g_node_ids                  (g_fem_context->node_ids)          /* Original node identifiers */
+#define g_node_id_map               (g_fem_context->node_id_map)       /* Original ID to internal index */
 
-extern int (*g_element_nodes)[MAX_NODES_PER_ELEMENT]; /* Element connectivity */
-extern int *g_element_type;                   /* Element types */
-extern int *g_element_material;               /* Element material IDs */
-extern int *g_element_ids;                    /* Original element identifiers */
-extern int *g_element_id_to_index;            /* Mapping from original ID to internal index */
+#define g_element_nodes             (g_fem_context->element_nodes)     /* Element connectivity */
+#define g_element_type              (g_fem_context->element_type)      /* Element types */
+#define g_element_material          (g_fem_context->element_material)  /* Element material IDs */
+#define g_element_ids               (g_fem_context->element_ids)       /* Original element identifiers */
+#define g_element_id_map            (g_fem_context->element_id_map)    /* Original ID to internal index */
+#define g_element_quality           (g_fem_context->element_quality)   /* Validation / geometry cache */
+#define g_element_quality_count     (g_fem_context->element_quality_count)
+#define g_element_quality_capacity  (g_fem_context->element_quality_capacity)
 
-extern double (*g_material_props)[6];         /* Material properties */
+#define g_material_props            (g_fem_context->material_props)    /* Material properties */
                                               /* [0]: Young's modulus */
                                               /* [1]: Poisson's ratio */
                                               /* [2]: thickness */
@@ -30,55 +38,99 @@ extern double (*g_material_props)[6];         /* Material properties */
                                               /* [4]: reserved */
                                               /* [5]: reserved */
 
-extern int *g_material_type;                 /* Material types */
-extern int *g_material_ids;                  /* Original material identifiers */
-extern int *g_material_id_to_index;          /* Mapping from material ID to index */
+#define g_material_type             (g_fem_context->material_type)     /* Material types */
+#define g_material_ids              (g_fem_context->material_ids)      /* Original material identifiers */
+#define g_material_id_map           (g_fem_context->material_id_map)   /* Material ID to index */
 
-extern int g_node_capacity;
-extern int g_element_capacity;
-extern int g_material_capacity;
-extern int g_node_id_capacity;
-extern int g_element_id_capacity;
-extern int g_material_id_capacity;
+#define g_node_capacity             (g_fem_context->node_capacity)
+#define g_element_capacity          (g_fem_context->element_capacity)
+#define g_material_capacity         (g_fem_context->material_capacity)
 
 /* Global system arrays */
-extern double *g_global_force;
-extern double *g_global_displ;
+#define g_global_force              (g_fem_context->global_force)
+#define g_global_displ              (g_fem_context->global_displ)
 
 /* Skyline global stiffness storage */
-extern double *g_global_stiffness_values;
-extern int *g_stiffness_profile;
-extern int *g_stiffness_offsets;
-extern int g_stiffness_value_count;
-extern int g_stiffness_bandwidth;
+#define g_global_stiffness_values   (g_fem_context->global_stiffness_values)
+#define g_stiffness_profile         (g_fem_context->stiffness_profile)
+#define g_stiffness_offsets         (g_fem_context->stiffness_offsets)
+#define g_stiffness_value_count     (g_fem_context->stiffness_value_count)
+#define g_stiffness_bandwidth       (g_fem_context->stiffness_bandwidth)
+#define g_block_row_offsets         (g_fem_context->block_row_offsets)
+#define g_block_columns             (g_fem_context->block_columns)
+#define g_block_values              (g_fem_context->block_values)
+#define g_block_diagonal            (g_fem_context->block_diagonal)
+#define g_block_count               (g_fem_context->block_count)
+#define g_color_offsets             (g_fem_context->color_offsets)
+#define g_color_elements            (g_fem_context->color_elements)
+#define g_color_count               (g_fem_context->color_count)
+
+/* Reaction recovery */
+#define g_reaction_dof_count        (g_fem_context->reaction_dof_count)
+#define g_reaction_dofs             (g_fem_context->reaction_dofs)
+#define g_reaction_row_offsets      (g_fem_context->reaction_row_offsets)
+#define g_reaction_columns          (g_fem_context->reaction_columns)
+#define g_reaction_values           (g_fem_context->reaction_values)
+#define g_reaction_loads            (g_fem_context->reaction_loads)
+#define g_node_reaction             (g_fem_context->node_reaction)
+#define g_reactions_current         (g_fem_context->reactions_current)
+#define g_scratch_arena             (g_fem_context->scratch_arena)
+
+/* Multipoint constraints */
+#define g_mpc_dof_row               (g_fem_context->mpc_dof_row)
+#define g_mpc_row_count             (g_fem_context->mpc_row_count)
+#define g_mpc_dependent_dofs        (g_fem_context->mpc_dependent_dofs)
+#define g_mpc_row_offsets           (g_fem_context->mpc_row_offsets)
+#define g_mpc_masters               (g_fem_context->mpc_masters)
+#define g_mpc_coefficients          (g_fem_context->mpc_coefficients)
+#define g_mpc_max_terms             (g_fem_context->mpc_max_terms)
+
+/* Recovered stresses (stress_recovery.c) */
+#define g_element_stress            (g_fem_context->element_stress)
+#define g_element_stress_valid      (g_fem_context->element_stress_valid)
+#define g_gauss_stress_offsets      (g_fem_context->gauss_stress_offsets)
+#define g_gauss_stress              (g_fem_context->gauss_stress)
+#define g_gauss_point_coords        (g_fem_context->gauss_point_coords)
+#define g_nodal_stress              (g_fem_context->nodal_stress)
+#define g_nodal_stress_spr          (g_fem_context->nodal_stress_spr)
+#define g_stress_element_count      (g_fem_context->stress_element_count)
+#define g_solid_stress              (g_fem_context->solid_stress)
+#define g_solid_nodal_stress        (g_fem_context->solid_nodal_stress)
 
 /* Distributed load control */
-extern double g_body_force[3];                       /* Uniform body force per unit volume */
-extern double g_pressure_value;                      /* Uniform pressure value (if applicable) */
-extern int g_has_body_force;
-extern int g_has_pressure;
-extern int g_num_tractions;
-extern int g_traction_surfaces[MAX_TRACTION_SURFACES][MAX_SURFACE_NODES];
-extern double g_traction_values[MAX_TRACTION_SURFACES][3];
-extern int g_num_pressure_surfaces;
-extern int g_pressure_surfaces[MAX_TRACTION_SURFACES][MAX_SURFACE_NODES];
+#define g_body_force                (g_fem_context->body_force)        /* Uniform body force per unit volume */
+#define g_pressure_value            (g_fem_context->pressure_value)    /* Uniform pressure value (if applicable) */
+#define g_has_body_force            (g_fem_context->has_body_force)
+#define g_has_pressure              (g_fem_context->has_pressure)
+#define g_num_tractions             (g_fem_context->num_tractions)
+#define g_traction_surfaces         (g_fem_context->traction_surfaces)
+#define g_traction_values           (g_fem_context->traction_values)
+#define g_num_pressure_surfaces     (g_fem_context->num_pressure_surfaces)
+#define g_pressure_surfaces         (g_fem_context->pressure_surfaces)
 
 /* Analysis control variables */
-extern analysis_control_t g_analysis;
-extern solver_info_t g_solver_info;
+#define g_analysis                  (g_fem_context->analysis)
+#define g_solver_info               (g_fem_context->solver_info)
 
 /* Problem size variables */
-extern int g_num_nodes;
-extern int g_num_elements;
-extern int g_num_materials;
-extern int g_total_dof;
+#define g_num_nodes                 (g_fem_context->num_nodes)
+#define g_num_elements              (g_fem_context->num_elements)
+#define g_num_materials             (g_fem_context->num_materials)
+#define g_total_dof                 (g_fem_context->total_dof)
+#define g_dof_per_node              (g_analysis.spatial_dimension)  /* 2 for plane models, 3 for solids */
 
 /* File handles */
-extern char g_input_filename[MAX_FILENAME_LEN];
-extern char g_output_filename[MAX_FILENAME_LEN];
+#define g_input_filename            (g_fem_context->input_filename)
+#define g_output_filename           (g_fem_context->output_filename)
 
 /* OpenMP control */
-extern int g_num_threads;
+#define g_num_threads               (g_fem_context->num_threads)
+
+/* Nastran property bookkeeping */
+#define g_nastran_pshells           (g_fem_context->nastran_pshells)
+#define g_nastran_pshell_count      (g_fem_context->nastran_pshell_count)
+#define g_nastran_element_property  (g_fem_context->nastran_element_property)
+#define g_nastran_element_property_capacity (g_fem_context->nastran_element_property_capacity)
 
 /* Functions to initialize global variables */
 fem_error_t globals_initialize(void);
@@ -86,9 +138,13 @@ fem_error_t globals_finalize(void);
 void globals_reset(void);
 fem_error_t globals_allocate_system_arrays(int total_dof);
 void globals_free_system_arrays(void);
+void globals_free_stress_results(void);
+void globals_free_reaction_data(void);
+void globals_free_mpc_data(void);
 fem_error_t globals_reserve_nodes(int required);
 fem_error_t globals_reserve_elements(int required);
 fem_error_t globals_reserve_materials(int required);
+fem_error_t globals_reserve_model(int nodes, int elements, int materials);
 fem_error_t globals_reserve_node_ids(int max_id_plus_one);
 fem_error_t globals_reserve_element_ids(int max_id_plus_one);
 fem_error_t globals_reserve_material_ids(int max_id_plus_one);
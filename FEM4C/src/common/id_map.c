@@ -0,0 +1,244 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Original-ID to internal-index maps (dense array or open-addressing hash)
+ */
+
+#include "id_map.h"
+#include "constants.h"
+#include "error.h"
+#include "fem_memory.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+static unsigned int id_map_hash(int id)
+{
+    unsigned int x = (unsigned int)id;
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+/* Dense storage is kept while the ID span is at most ID_MAP_MAX_SPAN_RATIO
+ * times the number of entries (plus one growth block). */
+static int id_map_dense_allowed(const id_map_t *map, int max_id_plus_one, int expected_count)
+{
+    long long entries = expected_count > map->count ? expected_count : map->count + 1;
+    long long limit = entries * ID_MAP_MAX_SPAN_RATIO + map->block_size;
+    return (long long)max_id_plus_one <= limit;
+}
+
+static fem_error_t id_map_resize_hash(id_map_t *map, int min_entries)
+{
+    int capacity = map->hash_capacity > 0 ? map->hash_capacity : 64;
+    while (capacity < min_entries * 2) {
+        if (capacity > INT_MAX / 2) {
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                             "ID map cannot hold %d entries", min_entries);
+        }
+        capacity *= 2;
+    }
+    if (capacity == map->hash_capacity) {
+        return FEM_SUCCESS;
+    }
+
+    int *keys = (int *)fem_calloc((size_t)capacity, sizeof(int), FEM_MEMORY_MESH);
+    int *values = (int *)fem_malloc((size_t)capacity * sizeof(int), FEM_MEMORY_MESH);
+    if (!keys || !values) {
+        fem_free(keys);
+        fem_free(values);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize ID hash map");
+    }
+
+    unsigned int mask = (unsigned int)capacity - 1U;
+    for (int i = 0; i < map->hash_capacity; ++i) {
+        if (map->keys[i] == 0) {
+            continue;
+        }
+        unsigned int h = id_map_hash(map->keys[i]) & mask;
+        while (keys[h] != 0) {
+            h = (h + 1U) & mask;
+        }
+        keys[h] = map->keys[i];
+        values[h] = map->values[i];
+    }
+
+    fem_free(map->keys);
+    fem_free(map->values);
+    map->keys = keys;
+    map->values = values;
+    map->hash_capacity = capacity;
+    return FEM_SUCCESS;
+}
+
+static void id_map_hash_put(id_map_t *map, int id, int index)
+{
+    unsigned int mask = (unsigned int)map->hash_capacity - 1U;
+    unsigned int h = id_map_hash(id) & mask;
+    while (map->keys[h] != 0) {
+        if (map->keys[h] == id) {
+            map->values[h] = index;
+            return;
+        }
+        h = (h + 1U) & mask;
+    }
+    map->keys[h] = id;
+    map->values[h] = index;
+    map->count++;
+}
+
+/* Move every dense entry into a freshly sized hash table */
+static fem_error_t id_map_convert_to_hash(id_map_t *map, int expected_count)
+{
+    int entries = expected_count > map->count ? expected_count : map->count;
+    fem_error_t err = id_map_resize_hash(map, entries + 1);
+    CHECK_ERROR(err);
+
+    int *dense = map->dense;
+    int dense_capacity = map->dense_capacity;
+    map->mode = ID_MAP_HASH;
+    map->count = 0;
+    for (int id = 1; id < dense_capacity; ++id) {
+        if (dense[id] >= 0) {
+            id_map_hash_put(map, id, dense[id]);
+        }
+    }
+    fem_free(dense);
+    map->dense = NULL;
+    map->dense_capacity = 0;
+    return FEM_SUCCESS;
+}
+
+static fem_error_t id_map_resize_dense(id_map_t *map, int required)
+{
+    long long new_capacity = map->dense_capacity > 0 ? map->dense_capacity : map->block_size;
+    while (new_capacity < required) {
+        new_capacity += map->block_size;
+    }
+    if (new_capacity > INT_MAX) {
+        new_capacity = required;
+    }
+
+    int *dense = (int *)fem_realloc(map->dense, (size_t)new_capacity * sizeof(int), FEM_MEMORY_MESH);
+    if (!dense) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to resize dense ID map");
+    }
+    for (long long i = map->dense_capacity; i < new_capacity; ++i) {
+        dense[i] = -1;
+    }
+    map->dense = dense;
+    map->dense_capacity = (int)new_capacity;
+    return FEM_SUCCESS;
+}
+
+void id_map_init(id_map_t *map, int block_size)
+{
+    memset(map, 0, sizeof(*map));
+    map->mode = ID_MAP_DENSE;
+    map->block_size = block_size > 0 ? block_size : 1;
+}
+
+void id_map_free(id_map_t *map)
+{
+    int block_size = map->block_size;
+    fem_free(map->dense);
+    fem_free(map->keys);
+    fem_free(map->values);
+    id_map_init(map, block_size);
+}
+
+/* Remove all entries; a hashed map drops back to dense mode so the next
+ * model gets its own density decision. */
+void id_map_clear(id_map_t *map)
+{
+    if (map->mode == ID_MAP_HASH) {
+        fem_free(map->keys);
+        fem_free(map->values);
+        map->keys = NULL;
+        map->values = NULL;
+        map->hash_capacity = 0;
+        map->mode = ID_MAP_DENSE;
+    } else if (map->dense) {
+        for (int i = 0; i < map->dense_capacity; ++i) {
+            map->dense[i] = -1;
+        }
+    }
+    map->count = 0;
+}
+
+/* Make room for IDs below max_id_plus_one, switching to hashed storage when
+ * a dense array would be too sparse for expected_count entries. */
+fem_error_t id_map_reserve(id_map_t *map, int max_id_plus_one, int expected_count)
+{
+    if (map->mode == ID_MAP_HASH) {
+        int entries = expected_count > map->count ? expected_count : map->count;
+        return id_map_resize_hash(map, entries + 1);
+    }
+    if (max_id_plus_one <= map->dense_capacity) {
+        return FEM_SUCCESS;
+    }
+    if (id_map_dense_allowed(map, max_id_plus_one, expected_count)) {
+        return id_map_resize_dense(map, max_id_plus_one);
+    }
+    return id_map_convert_to_hash(map, expected_count);
+}
+
+fem_error_t id_map_insert(id_map_t *map, int id, int index, int expected_count)
+{
+    fem_error_t err;
+
+    if (id <= 0) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "ID %d cannot be mapped (must be > 0)", id);
+    }
+
+    if (map->mode == ID_MAP_DENSE && id >= map->dense_capacity) {
+        err = id_map_reserve(map, id + 1, expected_count);
+        CHECK_ERROR(err);
+    }
+
+    if (map->mode == ID_MAP_DENSE) {
+        if (map->dense[id] < 0) {
+            map->count++;
+        }
+        map->dense[id] = index;
+        return FEM_SUCCESS;
+    }
+
+    if ((map->count + 1) * 2 > map->hash_capacity) {
+        err = id_map_resize_hash(map, map->count + 1);
+        CHECK_ERROR(err);
+    }
+    id_map_hash_put(map, id, index);
+    return FEM_SUCCESS;
+}
+
+int id_map_lookup(const id_map_t *map, int id)
+{
+    if (id <= 0) {
+        return -1;
+    }
+    if (map->mode == ID_MAP_DENSE) {
+        return id < map->dense_capacity ? map->dense[id] : -1;
+    }
+    if (map->hash_capacity == 0) {
+        return -1;
+    }
+
+    unsigned int mask = (unsigned int)map->hash_capacity - 1U;
+    unsigned int h = id_map_hash(id) & mask;
+    while (map->keys[h] != 0) {
+        if (map->keys[h] == id) {
+            return map->values[h];
+        }
+        h = (h + 1U) & mask;
+    }
+    return -1;
+}
+
+size_t id_map_memory_bytes(const id_map_t *map)
+{
+    return (size_t)map->dense_capacity * sizeof(int) +
+           (size_t)map->hash_capacity * 2 * sizeof(int);
+}
@@ -0,0 +1,41 @@
+#ifndef ID_MAP_H
+#define ID_MAP_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Original-ID to internal-index maps
+ *
+ * Compact ID ranges use a dense array indexed by ID. When the ID span is
+ * much larger than the number of entries (e.g. Nastran decks offset by
+ * 10,000,000 per part) the map switches to an open-addressing hash so
+ * memory stays proportional to the entry count. Both modes give O(1)
+ * lookups.
+ */
+
+#include "types.h"
+#include <stddef.h>
+
+#define ID_MAP_DENSE 0
+#define ID_MAP_HASH  1
+
+typedef struct {
+    int mode;               /* ID_MAP_DENSE or ID_MAP_HASH */
+    int count;              /* Number of stored IDs */
+    int block_size;         /* Dense growth step */
+
+    int *dense;             /* dense[id] = index or -1 */
+    int dense_capacity;     /* Valid IDs are 0 .. dense_capacity-1 */
+
+    int *keys;              /* Hash keys (0 = empty slot) */
+    int *values;            /* Hash values */
+    int hash_capacity;      /* Power of two */
+} id_map_t;
+
+void id_map_init(id_map_t *map, int block_size);
+void id_map_free(id_map_t *map);
+void id_map_clear(id_map_t *map);
+fem_error_t id_map_reserve(id_map_t *map, int max_id_plus_one, int expected_count);
+fem_error_t id_map_insert(id_map_t *map, int id, int index, int expected_count);
+int id_map_lookup(const id_map_t *map, int id);
+size_t id_map_memory_bytes(const id_map_t *map);
+
+#endif /* ID_MAP_H */
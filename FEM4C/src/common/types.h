@@ -6,6 +6,18 @@
  */
 
 #include "constants.h"
+#include <limits.h>
+
+/* Offsets and entry counts of sparse matrix storage. 32-bit by default;
+ * build with -DFEM4C_INDEX64 (make INDEX64=1) for matrices with more than
+ * 2^31 - 1 stored entries. DOF and node numbers stay int. */
+#ifdef FEM4C_INDEX64
+typedef long long fem_index_t;
+#define FEM_INDEX_MAX LLONG_MAX
+#else
+typedef int fem_index_t;
+#define FEM_INDEX_MAX INT_MAX
+#endif
 
 /* Basic data types */
 typedef struct {
@@ -56,12 +68,24 @@ typedef struct {
 /* Matrix storage structure (for sparse matrices) */
 typedef struct {
     int size;                /* Matrix size */
-    int nnz;                 /* Number of non-zero entries */
+    fem_index_t nnz;         /* Number of non-zero entries */
     double *values;          /* Non-zero values */
-    int *row_ptr;            /* Row pointer array */
+    fem_index_t *row_ptr;    /* Row pointer array */
     int *col_ind;            /* Column index array */
 } sparse_matrix_t;
 
+/* Per-element geometry cache filled by the mesh validation pass */
+#define ELEMENT_QUALITY_MAX_POINTS 4
+typedef struct {
+    double area;             /* Corner polygon area (signed, CCW positive); solids: volume */
+    double det_j[ELEMENT_QUALITY_MAX_POINTS]; /* Jacobian det. at stiffness Gauss points */
+    double min_det_j;        /* Smallest of det_j */
+    double aspect_ratio;     /* Longest / shortest corner edge */
+    double quality;          /* Shape quality, 1 = equilateral / square, 0 = degenerate */
+    unsigned char validated; /* Passed the element-type validity check */
+    unsigned char has_det_j; /* det_j covers every stiffness Gauss point */
+} element_quality_t;
+
 /* Error codes enumeration */
 typedef enum {
     FEM_SUCCESS = 0,
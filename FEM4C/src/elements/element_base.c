@@ -322,21 +322,91 @@ fem_error_t element_get_gauss_points_2d_quad(int order, gauss_integration_t *gau
     return FEM_SUCCESS;
 }
 
-/* Placeholder for 3D functions - to be implemented later */
+/* Get Gauss points for tetrahedral elements (volume coordinates xi, eta,
+ * zeta of nodes 2-4; the reference volume is 1/6) */
 fem_error_t element_get_gauss_points_3d_tetrahedron(int order, gauss_integration_t *gauss)
 {
-    (void)order;
-    (void)gauss;
-    error_set(FEM_ERROR_INVALID_INPUT, "element_get_gauss_points_3d_tetrahedron",
-                 "3D elements not implemented yet");
-    return FEM_ERROR_INVALID_INPUT;
+    if (!gauss) {
+        error_set(FEM_ERROR_INVALID_INPUT, "element_get_gauss_points_3d_tetrahedron",
+                     "Gauss integration pointer is NULL");
+        return FEM_ERROR_INVALID_INPUT;
+    }
+
+    if (order == 1) {
+        /* 1-point rule at the centroid (T4) */
+        gauss->num_points = 1;
+        gauss->points[0].xi = 0.25;
+        gauss->points[0].eta = 0.25;
+        gauss->points[0].zeta = 0.25;
+        gauss->points[0].weight = SIXTH;
+    } else if (order == 2) {
+        /* 4-point rule, exact for quadratic integrands (T10) */
+        const double a = 0.58541019662496845;
+        const double b = 0.13819660112501052;
+        const double coords[4][3] = {
+            {b, b, b}, {a, b, b}, {b, a, b}, {b, b, a}
+        };
+
+        gauss->num_points = 4;
+        for (int i = 0; i < 4; i++) {
+            gauss->points[i].xi = coords[i][0];
+            gauss->points[i].eta = coords[i][1];
+            gauss->points[i].zeta = coords[i][2];
+            gauss->points[i].weight = 1.0 / 24.0;
+        }
+    } else {
+        error_set(FEM_ERROR_INVALID_INPUT, "element_get_gauss_points_3d_tetrahedron",
+                     "Unsupported Gauss integration order");
+        return FEM_ERROR_INVALID_INPUT;
+    }
+
+    return FEM_SUCCESS;
 }
 
+/* Get Gauss points for hexahedral elements (xi fastest, then eta, zeta) */
 fem_error_t element_get_gauss_points_3d_hexahedron(int order, gauss_integration_t *gauss)
 {
-    (void)order;
-    (void)gauss;
-    error_set(FEM_ERROR_INVALID_INPUT, "element_get_gauss_points_3d_hexahedron",
-                 "3D elements not implemented yet");
-    return FEM_ERROR_INVALID_INPUT;
+    double coords[3];
+    double weights[3];
+
+    if (!gauss) {
+        error_set(FEM_ERROR_INVALID_INPUT, "element_get_gauss_points_3d_hexahedron",
+                     "Gauss integration pointer is NULL");
+        return FEM_ERROR_INVALID_INPUT;
+    }
+
+    if (order == 2) {
+        /* 2x2x2 Gauss integration */
+        coords[0] = -1.0/sqrt(3.0);
+        coords[1] = 1.0/sqrt(3.0);
+        weights[0] = weights[1] = 1.0;
+    } else if (order == 3) {
+        /* 3x3x3 Gauss integration */
+        coords[0] = -sqrt(0.6);
+        coords[1] = 0.0;
+        coords[2] = sqrt(0.6);
+        weights[0] = 5.0/9.0;
+        weights[1] = 8.0/9.0;
+        weights[2] = 5.0/9.0;
+    } else {
+        error_set(FEM_ERROR_INVALID_INPUT, "element_get_gauss_points_3d_hexahedron",
+                     "Unsupported Gauss integration order");
+        return FEM_ERROR_INVALID_INPUT;
+    }
+
+    int point = 0;
+    for (int k = 0; k < order; k++) {
+        for (int j = 0; j < order; j++) {
+            for (int i = 0; i < order; i++) {
+                gauss->points[point].xi = coords[i];
+                gauss->points[point].eta = coords[j];
+                gauss->points[point].zeta = coords[k];
+                gauss->points[point].weight = weights[i] * weights[j] * weights[k];
+                point++;
+            }
+        }
+    }
+    gauss->num_points = point;
+
+    return FEM_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,206 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Internal force kernels for explicit dynamics
+ */
+
+#include "element_explicit.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include <math.h>
+#include <string.h>
+
+/* Centroid derivatives and area of one element; false for det J <= 0 */
+static int element_explicit_geometry(int element_type, const int *nodes,
+                                     double bx[ELEMENT_EXPLICIT_MAX_NODES],
+                                     double by[ELEMENT_EXPLICIT_MAX_NODES], double *area)
+{
+    if (element_type == ELEMENT_T3) {
+        const double *p1 = g_node_coords[nodes[0]];
+        const double *p2 = g_node_coords[nodes[1]];
+        const double *p3 = g_node_coords[nodes[2]];
+        double two_a = (p2[0] - p1[0]) * (p3[1] - p1[1]) - (p3[0] - p1[0]) * (p2[1] - p1[1]);
+
+        if (!(two_a > 0.0)) {
+            return 0;
+        }
+        bx[0] = (p2[1] - p3[1]) / two_a;
+        bx[1] = (p3[1] - p1[1]) / two_a;
+        bx[2] = (p1[1] - p2[1]) / two_a;
+        by[0] = (p3[0] - p2[0]) / two_a;
+        by[1] = (p1[0] - p3[0]) / two_a;
+        by[2] = (p2[0] - p1[0]) / two_a;
+        bx[3] = by[3] = 0.0;
+        *area = 0.5 * two_a;
+        return 1;
+    }
+
+    /* Q4 at xi = eta = 0 */
+    static const double dxi[4] = {-0.25, 0.25, 0.25, -0.25};
+    static const double deta[4] = {-0.25, -0.25, 0.25, 0.25};
+    double j11 = 0.0, j12 = 0.0, j21 = 0.0, j22 = 0.0;
+
+    for (int a = 0; a < 4; a++) {
+        const double *p = g_node_coords[nodes[a]];
+        j11 += dxi[a] * p[0];
+        j12 += dxi[a] * p[1];
+        j21 += deta[a] * p[0];
+        j22 += deta[a] * p[1];
+    }
+    double det = j11 * j22 - j12 * j21;
+    if (!(det > 0.0)) {
+        return 0;
+    }
+    for (int a = 0; a < 4; a++) {
+        bx[a] = (j22 * dxi[a] - j12 * deta[a]) / det;
+        by[a] = (-j21 * dxi[a] + j11 * deta[a]) / det;
+    }
+    /* det J is linear in xi, eta: the one-point rule gives the exact area */
+    *area = 4.0 * det;
+    return 1;
+}
+
+fem_error_t element_explicit_prepare(int element_type, const int *elements, int count,
+                                     double hourglass, element_explicit_batch_t *batch,
+                                     double *dt_stable)
+{
+    static const double h[4] = {1.0, -1.0, 1.0, -1.0};
+    int nodes_per_element;
+    double dt_min = HUGE_VAL;
+
+    if (element_type == ELEMENT_T3) {
+        nodes_per_element = 3;
+    } else if (element_type == ELEMENT_Q4) {
+        nodes_per_element = 4;
+    } else {
+        return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                         "Explicit dynamics supports T3 and Q4 elements (type %d)", element_type);
+    }
+    if (count <= 0 || count > ELEMENT_EXPLICIT_BATCH) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Invalid explicit batch size %d", count);
+    }
+
+    memset(batch, 0, sizeof(*batch));
+    batch->element_type = element_type;
+    batch->count = count;
+
+    for (int e = 0; e < count; e++) {
+        int element_id = elements[e];
+        int material_id = g_element_material[element_id];
+        const int *nodes = g_element_nodes[element_id];
+        double bx[ELEMENT_EXPLICIT_MAX_NODES], by[ELEMENT_EXPLICIT_MAX_NODES];
+        double area, b2 = 0.0;
+
+        CHECK_BOUNDS(material_id, g_num_materials, "Material ID");
+        if (!element_explicit_geometry(element_type, nodes, bx, by, &area)) {
+            return error_set(FEM_ERROR_INVALID_INPUT,
+                             "Element %d has a non-positive Jacobian", element_id + 1);
+        }
+
+        double E = g_material_props[material_id][0];
+        double nu = g_material_props[material_id][1];
+        double thickness = g_material_props[material_id][2];
+        double density = g_material_props[material_id][3];
+        double d11 = E / (1.0 - nu * nu);
+
+        for (int a = 0; a < ELEMENT_EXPLICIT_MAX_NODES; a++) {
+            /* Lanes of a triangle repeat its first node with zero weights */
+            batch->node[a][e] = nodes[a < nodes_per_element ? a : 0];
+            batch->bx[a][e] = bx[a];
+            batch->by[a][e] = by[a];
+            b2 += bx[a] * bx[a] + by[a] * by[a];
+        }
+        batch->volume[e] = area * thickness;
+        batch->d11[e] = d11;
+        batch->d12[e] = nu * d11;
+        batch->d33[e] = 0.5 * E / (1.0 + nu);
+
+        if (element_type == ELEMENT_Q4) {
+            double hx = 0.0, hy = 0.0;
+            for (int a = 0; a < 4; a++) {
+                hx += h[a] * g_node_coords[nodes[a]][0];
+                hy += h[a] * g_node_coords[nodes[a]][1];
+            }
+            for (int a = 0; a < 4; a++) {
+                batch->gamma[a][e] = 0.25 * (h[a] - hx * bx[a] - hy * by[a]);
+            }
+            batch->k_hg[e] = hourglass * d11 * batch->volume[e] * b2;
+        }
+
+        if (density > 0.0) {
+            double c = sqrt(d11 * (1.0 + hourglass) / density);
+            double dt = 1.0 / (c * sqrt(2.0 * b2));
+            if (dt < dt_min) {
+                dt_min = dt;
+            }
+        }
+    }
+
+    *dt_stable = dt_min;
+    return FEM_SUCCESS;
+}
+
+void element_explicit_internal_force(const element_explicit_batch_t *batch, const double *u,
+                                     double *fe)
+{
+    int count = batch->count;
+    int nodes = batch->element_type == ELEMENT_Q4 ? 4 : 3;
+    double ux[ELEMENT_EXPLICIT_MAX_NODES][ELEMENT_EXPLICIT_BATCH];
+    double uy[ELEMENT_EXPLICIT_MAX_NODES][ELEMENT_EXPLICIT_BATCH];
+    double sxx[ELEMENT_EXPLICIT_BATCH], syy[ELEMENT_EXPLICIT_BATCH], sxy[ELEMENT_EXPLICIT_BATCH];
+    double q[2][ELEMENT_EXPLICIT_BATCH];
+
+    /* Gather */
+    for (int a = 0; a < nodes; a++) {
+        for (int e = 0; e < count; e++) {
+            int n = batch->node[a][e];
+            ux[a][e] = u[2 * n];
+            uy[a][e] = u[2 * n + 1];
+        }
+    }
+
+    /* Centroid strain and stress times volume */
+    for (int e = 0; e < count; e++) {
+        double exx = 0.0, eyy = 0.0, gxy = 0.0;
+        for (int a = 0; a < nodes; a++) {
+            exx += batch->bx[a][e] * ux[a][e];
+            eyy += batch->by[a][e] * uy[a][e];
+            gxy += batch->by[a][e] * ux[a][e] + batch->bx[a][e] * uy[a][e];
+        }
+        double v = batch->volume[e];
+        sxx[e] = v * (batch->d11[e] * exx + batch->d12[e] * eyy);
+        syy[e] = v * (batch->d12[e] * exx + batch->d11[e] * eyy);
+        sxy[e] = v * batch->d33[e] * gxy;
+    }
+
+    for (int a = 0; a < nodes; a++) {
+        double *fx = fe + ELEMENT_EXPLICIT_FORCE_INDEX(a, 0, 0);
+        double *fy = fe + ELEMENT_EXPLICIT_FORCE_INDEX(a, 1, 0);
+        for (int e = 0; e < count; e++) {
+            fx[e] = batch->bx[a][e] * sxx[e] + batch->by[a][e] * sxy[e];
+            fy[e] = batch->by[a][e] * syy[e] + batch->bx[a][e] * sxy[e];
+        }
+    }
+
+    if (batch->element_type != ELEMENT_Q4) {
+        return;
+    }
+
+    /* Hourglass resistance on the mode amplitudes gamma . u */
+    for (int e = 0; e < count; e++) {
+        double qx = 0.0, qy = 0.0;
+        for (int a = 0; a < 4; a++) {
+            qx += batch->gamma[a][e] * ux[a][e];
+            qy += batch->gamma[a][e] * uy[a][e];
+        }
+        q[0][e] = batch->k_hg[e] * qx;
+        q[1][e] = batch->k_hg[e] * qy;
+    }
+    for (int a = 0; a < 4; a++) {
+        double *fx = fe + ELEMENT_EXPLICIT_FORCE_INDEX(a, 0, 0);
+        double *fy = fe + ELEMENT_EXPLICIT_FORCE_INDEX(a, 1, 0);
+        for (int e = 0; e < count; e++) {
+            fx[e] += batch->gamma[a][e] * q[0][e];
+            fy[e] += batch->gamma[a][e] * q[1][e];
+        }
+    }
+}
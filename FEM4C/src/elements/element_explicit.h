@@ -0,0 +1,57 @@
+#ifndef ELEMENT_EXPLICIT_H
+#define ELEMENT_EXPLICIT_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Internal force kernels for explicit dynamics
+ *
+ * Batches of ELEMENT_EXPLICIT_BATCH elements of one type (T3, or Q4 with
+ * one-point integration) stored as structure of arrays: entry [a][e] is
+ * node a of element e of the batch, so the loops over e run on contiguous
+ * memory and vectorize. Everything that does not depend on the
+ * displacements (centroid derivatives, area times thickness, plane-stress
+ * moduli, hourglass vectors) is set up once.
+ *
+ * Q4 uses the centroid strain plus Flanagan-Belytschko hourglass control:
+ * gamma is the hourglass vector made orthogonal to linear fields, and the
+ * stabilising force k_hg * gamma (gamma . u) acts on the mode alone. The
+ * stiffness k_hg is hourglass times the element stiffness scale
+ * d11 * V * sum(b . b).
+ */
+
+#include "../common/types.h"
+
+#define ELEMENT_EXPLICIT_BATCH      64
+#define ELEMENT_EXPLICIT_MAX_NODES  4
+
+typedef struct {
+    int element_type;
+    int count;                                                  /* used lanes */
+    int node[ELEMENT_EXPLICIT_MAX_NODES][ELEMENT_EXPLICIT_BATCH];
+    double bx[ELEMENT_EXPLICIT_MAX_NODES][ELEMENT_EXPLICIT_BATCH];  /* dN/dx at the centroid */
+    double by[ELEMENT_EXPLICIT_MAX_NODES][ELEMENT_EXPLICIT_BATCH];
+    double gamma[ELEMENT_EXPLICIT_MAX_NODES][ELEMENT_EXPLICIT_BATCH];
+    double volume[ELEMENT_EXPLICIT_BATCH];                      /* area * thickness */
+    double d11[ELEMENT_EXPLICIT_BATCH];
+    double d12[ELEMENT_EXPLICIT_BATCH];
+    double d33[ELEMENT_EXPLICIT_BATCH];
+    double k_hg[ELEMENT_EXPLICIT_BATCH];
+} element_explicit_batch_t;
+
+/* Set up a batch of count (<= ELEMENT_EXPLICIT_BATCH) elements of one
+ * type. dt_stable receives the smallest element time step estimate,
+ * 1 / (c sqrt(2 sum(b . b))) with the dilatational wave speed c. */
+fem_error_t element_explicit_prepare(int element_type, const int *elements, int count,
+                                     double hourglass, element_explicit_batch_t *batch,
+                                     double *dt_stable);
+
+/* Internal forces for the nodal displacements u (two per node). Output
+ * is structure of arrays as well: fe[(2 * a + k) * ELEMENT_EXPLICIT_BATCH + e]
+ * is component k at node a of element e. */
+void element_explicit_internal_force(const element_explicit_batch_t *batch, const double *u,
+                                     double *fe);
+
+/* Position of component k of node a of lane e in the fe array */
+#define ELEMENT_EXPLICIT_FORCE_INDEX(a, k, e) \
+    ((2 * (a) + (k)) * ELEMENT_EXPLICIT_BATCH + (e))
+
+#endif /* ELEMENT_EXPLICIT_H */
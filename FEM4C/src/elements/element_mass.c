@@ -0,0 +1,151 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Mass matrices of the plane elements
+ */
+
+#include "element_mass.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "t3/t3_element.h"
+#include "q4/q4_element.h"
+#include "t6/t6_element.h"
+#include <string.h>
+
+/* Degree 2 rule on the reference triangle (weights include the area 1/2) */
+static const double element_mass_t3_points[3][2] = {
+    {1.0 / 6.0, 1.0 / 6.0}, {2.0 / 3.0, 1.0 / 6.0}, {1.0 / 6.0, 2.0 / 3.0}
+};
+static const double element_mass_t3_weights[3] = {1.0 / 6.0, 1.0 / 6.0, 1.0 / 6.0};
+
+/* Degree 4 rule (Dunavant, 6 points) */
+static const double element_mass_t6_points[6][2] = {
+    {0.445948490915965, 0.445948490915965},
+    {0.108103018168070, 0.445948490915965},
+    {0.445948490915965, 0.108103018168070},
+    {0.091576213509771, 0.091576213509771},
+    {0.816847572980459, 0.091576213509771},
+    {0.091576213509771, 0.816847572980459}
+};
+static const double element_mass_t6_weights[6] = {
+    0.5 * 0.223381589678011, 0.5 * 0.223381589678011, 0.5 * 0.223381589678011,
+    0.5 * 0.109951743655322, 0.5 * 0.109951743655322, 0.5 * 0.109951743655322
+};
+
+/* Scalar mass matrix m[a][b] = integral of rho t N_a N_b */
+static fem_error_t element_mass_scalar(int element_id,
+                                       double m[ELEMENT_MASS_MAX_NODES][ELEMENT_MASS_MAX_NODES],
+                                       int *nodes)
+{
+    int type = g_element_type[element_id];
+    int material_id = g_element_material[element_id];
+    const double (*points)[2];
+    const double *weights;
+    int count;
+    double thickness, density;
+    fem_error_t err;
+
+    CHECK_BOUNDS(material_id, g_num_materials, "Material ID");
+    thickness = g_material_props[material_id][2];
+    density = g_material_props[material_id][3];
+
+    switch (type) {
+        case ELEMENT_T3:
+            *nodes = T3_NODES_PER_ELEMENT;
+            points = element_mass_t3_points;
+            weights = element_mass_t3_weights;
+            count = 3;
+            break;
+        case ELEMENT_Q4:
+            *nodes = Q4_NODES_PER_ELEMENT;
+            points = (const double (*)[2])g_q4_gauss_points;
+            weights = g_q4_gauss_weights;
+            count = Q4_GAUSS_POINTS;
+            break;
+        case ELEMENT_T6:
+            *nodes = T6_NODES_PER_ELEMENT;
+            points = element_mass_t6_points;
+            weights = element_mass_t6_weights;
+            count = 6;
+            if (thickness <= ZERO) thickness = ONE;
+            break;
+        default:
+            return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                             "Element %d (type %d) has no mass matrix", element_id + 1, type);
+    }
+
+    memset(m, 0, sizeof(double) * ELEMENT_MASS_MAX_NODES * ELEMENT_MASS_MAX_NODES);
+    for (int p = 0; p < count; p++) {
+        double xi = points[p][0];
+        double eta = points[p][1];
+        double N[ELEMENT_MASS_MAX_NODES];
+        double J[2][2], det_J;
+
+        if (type == ELEMENT_T3) {
+            err = t3_shape_functions(xi, eta, N);
+            if (err == FEM_SUCCESS) err = t3_jacobian_matrix(element_id, xi, eta, J, &det_J);
+        } else if (type == ELEMENT_Q4) {
+            err = q4_shape_functions(xi, eta, N);
+            if (err == FEM_SUCCESS) err = q4_jacobian_matrix(element_id, xi, eta, J, &det_J);
+        } else {
+            err = t6_shape_functions(xi, eta, N);
+            if (err == FEM_SUCCESS) err = t6_jacobian_matrix(element_id, xi, eta, J, &det_J);
+        }
+        CHECK_ERROR(err);
+
+        double factor = weights[p] * det_J * thickness * density;
+        for (int a = 0; a < *nodes; a++) {
+            for (int b = a; b < *nodes; b++) {
+                m[a][b] += factor * N[a] * N[b];
+            }
+        }
+    }
+    for (int a = 0; a < *nodes; a++) {
+        for (int b = 0; b < a; b++) {
+            m[a][b] = m[b][a];
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t element_mass_packed(int element_id, double *me_upper)
+{
+    double m[ELEMENT_MASS_MAX_NODES][ELEMENT_MASS_MAX_NODES];
+    int nodes = 0;
+    fem_error_t err;
+
+    err = element_mass_scalar(element_id, m, &nodes);
+    CHECK_ERROR(err);
+
+    for (int r = 0; r < 2 * nodes; r++) {
+        for (int c = r; c < 2 * nodes; c++) {
+            *me_upper++ = (r & 1) == (c & 1) ? m[r / 2][c / 2] : 0.0;
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t element_mass_lumped(int element_id, double node_mass[ELEMENT_MASS_MAX_NODES],
+                                int *nodes)
+{
+    double m[ELEMENT_MASS_MAX_NODES][ELEMENT_MASS_MAX_NODES];
+    double total = 0.0, diagonal = 0.0;
+    fem_error_t err;
+
+    err = element_mass_scalar(element_id, m, nodes);
+    CHECK_ERROR(err);
+
+    for (int a = 0; a < *nodes; a++) {
+        diagonal += m[a][a];
+        for (int b = 0; b < *nodes; b++) {
+            total += m[a][b];
+        }
+    }
+    if (!(diagonal > 0.0)) {
+        return error_set(FEM_ERROR_INVALID_MATERIAL,
+                         "Element %d has no positive mass (check density)", element_id + 1);
+    }
+    for (int a = 0; a < *nodes; a++) {
+        node_mass[a] = m[a][a] * total / diagonal;
+    }
+    return FEM_SUCCESS;
+}
@@ -0,0 +1,30 @@
+#ifndef ELEMENT_MASS_H
+#define ELEMENT_MASS_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Mass matrices of the plane elements
+ *
+ * M_e = integral of rho * t * N^T N over the element for T3, Q4 and T6,
+ * with rho = g_material_props[m][3] and the thickness the stiffness kernel
+ * of the type uses. The rules integrate N^T N exactly on straight-sided
+ * elements (3 points for T3, 2x2 for Q4, 6 points for T6). Both DOFs of a
+ * node carry the same mass, so the element matrix is a nodes x nodes
+ * scalar matrix expanded over the two directions.
+ */
+
+#include "../common/types.h"
+
+#define ELEMENT_MASS_MAX_NODES  6
+#define ELEMENT_MASS_MAX_DOF    (2 * ELEMENT_MASS_MAX_NODES)
+
+/* Consistent mass as a packed upper triangle, row by row over the
+ * node-major element DOFs (assembly_add_element_matrix_packed) */
+fem_error_t element_mass_packed(int element_id, double *me_upper);
+
+/* Lumped (HRZ) mass of every element node: the diagonal of the consistent
+ * matrix scaled to the element mass, which keeps the T6 corner masses
+ * positive where row sums would not. Returns the node count in nodes. */
+fem_error_t element_mass_lumped(int element_id, double node_mass[ELEMENT_MASS_MAX_NODES],
+                                int *nodes);
+
+#endif /* ELEMENT_MASS_H */
@@ -0,0 +1,174 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Total Lagrangian plane elements
+ */
+
+#include "element_nonlinear.h"
+#include "element_base.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "t3/t3_element.h"
+#include "q4/q4_element.h"
+#include "t6/t6_element.h"
+#include "t6/t6_stiffness.h"
+#include <string.h>
+
+/* Integration rule, material matrix and thickness of the linear stiffness
+ * kernel of each type, so that the tangent at u = 0 matches it */
+fem_error_t element_nonlinear_prepare(int element_id, element_nonlinear_ref_t *ref)
+{
+    int type = g_element_type[element_id];
+    int material_id = g_element_material[element_id];
+    const double (*points)[2];
+    const double *weights;
+    static const double t3_point[1][2] = {{1.0 / 3.0, 1.0 / 3.0}};
+    static const double t3_weight[1] = {0.5};
+    double thickness;
+    fem_error_t err;
+
+    CHECK_BOUNDS(material_id, g_num_materials, "Material ID");
+    memset(ref, 0, sizeof(*ref));
+    thickness = g_material_props[material_id][2];
+
+    switch (type) {
+        case ELEMENT_T3:
+            ref->nodes = T3_NODES_PER_ELEMENT;
+            ref->points = T3_GAUSS_POINTS;
+            points = t3_point;
+            weights = t3_weight;
+            err = element_2d_material_matrix_plane_stress(material_id, ref->D);
+            break;
+        case ELEMENT_Q4:
+            ref->nodes = Q4_NODES_PER_ELEMENT;
+            ref->points = Q4_GAUSS_POINTS;
+            points = (const double (*)[2])g_q4_gauss_points;
+            weights = g_q4_gauss_weights;
+            err = q4_material_matrix(material_id, ref->D);
+            break;
+        case ELEMENT_T6: {
+            double E = g_material_props[material_id][0];
+            double nu = g_material_props[material_id][1];
+            ref->nodes = T6_NODES_PER_ELEMENT;
+            ref->points = T6_GAUSS_POINTS;
+            points = (const double (*)[2])g_t6_gauss_points;
+            weights = g_t6_gauss_weights;
+            if (thickness <= ZERO) thickness = ONE;
+            if (g_material_type[material_id] == MATERIAL_PLANE_STRESS) {
+                err = t6_material_matrix_plane_stress(E, nu, ref->D);
+            } else {
+                err = t6_material_matrix_plane_strain(E, nu, ref->D);
+            }
+            break;
+        }
+        default:
+            return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                             "Element %d (type %d) has no large-displacement formulation",
+                             element_id + 1, type);
+    }
+    CHECK_ERROR(err);
+
+    for (int p = 0; p < ref->points; p++) {
+        double xi = points[p][0];
+        double eta = points[p][1];
+        double dN_dx[ELEMENT_NONLINEAR_MAX_NODES];
+        double dN_dy[ELEMENT_NONLINEAR_MAX_NODES];
+        double J[2][2], det_J;
+
+        if (type == ELEMENT_T3) {
+            err = t3_jacobian_matrix(element_id, xi, eta, J, &det_J);
+            if (err == FEM_SUCCESS) err = t3_shape_derivatives_global(element_id, xi, eta, dN_dx, dN_dy);
+        } else if (type == ELEMENT_Q4) {
+            err = q4_jacobian_matrix(element_id, xi, eta, J, &det_J);
+            if (err == FEM_SUCCESS) err = q4_shape_derivatives_global(element_id, xi, eta, dN_dx, dN_dy);
+        } else {
+            err = t6_jacobian_matrix(element_id, xi, eta, J, &det_J);
+            if (err == FEM_SUCCESS) err = t6_shape_derivatives_global(element_id, xi, eta, dN_dx, dN_dy);
+        }
+        CHECK_ERROR(err);
+
+        for (int a = 0; a < ref->nodes; a++) {
+            ref->dN[p][a][0] = dN_dx[a];
+            ref->dN[p][a][1] = dN_dy[a];
+        }
+        ref->volume[p] = weights[p] * det_J * thickness;
+    }
+
+    return FEM_SUCCESS;
+}
+
+void element_nonlinear_response(const element_nonlinear_ref_t *ref, const double *ue,
+                                double *fe, double *ke_upper)
+{
+    int nodes = ref->nodes;
+    int dof = 2 * nodes;
+
+    memset(fe, 0, (size_t)dof * sizeof(double));
+    if (ke_upper) {
+        memset(ke_upper, 0, (size_t)(dof * (dof + 1) / 2) * sizeof(double));
+    }
+
+    for (int p = 0; p < ref->points; p++) {
+        const double (*dN)[2] = ref->dN[p];
+        double dV = ref->volume[p];
+        double H[2][2] = {{0.0, 0.0}, {0.0, 0.0}};   /* du_i / dX_J */
+        double F[2][2];
+        double E[3], S[3];
+        double B[3][ELEMENT_NONLINEAR_MAX_DOF];
+
+        for (int a = 0; a < nodes; a++) {
+            for (int i = 0; i < 2; i++) {
+                H[i][0] += ue[2 * a + i] * dN[a][0];
+                H[i][1] += ue[2 * a + i] * dN[a][1];
+            }
+        }
+        F[0][0] = 1.0 + H[0][0];
+        F[0][1] = H[0][1];
+        F[1][0] = H[1][0];
+        F[1][1] = 1.0 + H[1][1];
+
+        /* Green-Lagrange strain (engineering shear) and 2nd PK stress */
+        E[0] = H[0][0] + 0.5 * (H[0][0] * H[0][0] + H[1][0] * H[1][0]);
+        E[1] = H[1][1] + 0.5 * (H[0][1] * H[0][1] + H[1][1] * H[1][1]);
+        E[2] = H[0][1] + H[1][0] + H[0][0] * H[0][1] + H[1][0] * H[1][1];
+        for (int k = 0; k < 3; k++) {
+            S[k] = ref->D[k][0] * E[0] + ref->D[k][1] * E[1] + ref->D[k][2] * E[2];
+        }
+
+        /* Variation of E: dE = B du, B depends on the current F */
+        for (int a = 0; a < nodes; a++) {
+            for (int i = 0; i < 2; i++) {
+                int c = 2 * a + i;
+                B[0][c] = F[i][0] * dN[a][0];
+                B[1][c] = F[i][1] * dN[a][1];
+                B[2][c] = F[i][0] * dN[a][1] + F[i][1] * dN[a][0];
+                fe[c] += dV * (B[0][c] * S[0] + B[1][c] * S[1] + B[2][c] * S[2]);
+            }
+        }
+
+        if (!ke_upper) {
+            continue;
+        }
+
+        /* Material part B^T D B plus the initial stress part, which couples
+         * equal components of two nodes through dN_a^T S dN_b */
+        double DB[3][ELEMENT_NONLINEAR_MAX_DOF];
+        for (int k = 0; k < 3; k++) {
+            for (int c = 0; c < dof; c++) {
+                DB[k][c] = ref->D[k][0] * B[0][c] + ref->D[k][1] * B[1][c] + ref->D[k][2] * B[2][c];
+            }
+        }
+        double *out = ke_upper;
+        for (int r = 0; r < dof; r++) {
+            int a = r / 2;
+            for (int c = r; c < dof; c++) {
+                double value = B[0][r] * DB[0][c] + B[1][r] * DB[1][c] + B[2][r] * DB[2][c];
+                if ((c & 1) == (r & 1)) {
+                    int b = c / 2;
+                    value += dN[a][0] * (S[0] * dN[b][0] + S[2] * dN[b][1]) +
+                             dN[a][1] * (S[2] * dN[b][0] + S[1] * dN[b][1]);
+                }
+                *out++ += dV * value;
+            }
+        }
+    }
+}
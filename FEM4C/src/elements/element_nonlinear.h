@@ -0,0 +1,45 @@
+#ifndef ELEMENT_NONLINEAR_H
+#define ELEMENT_NONLINEAR_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Total Lagrangian plane elements
+ *
+ * Internal force and tangent stiffness of the plane elements (T3, Q4, T6)
+ * for large displacements: Green-Lagrange strain E = (F^T F - I) / 2,
+ * second Piola-Kirchhoff stress S = D E (St. Venant-Kirchhoff with the
+ * element's linear material matrix), everything integrated over the
+ * reference configuration with the element's linear stiffness rule.
+ *
+ * The reference shape function derivatives, integration weights and the
+ * material matrix do not change during an analysis; they are evaluated
+ * once per element into element_nonlinear_ref_t, after which the response
+ * is plain arithmetic on the element displacements. At zero displacement
+ * the tangent equals the linear element stiffness.
+ */
+
+#include "../common/types.h"
+
+#define ELEMENT_NONLINEAR_MAX_NODES   6    /* T6 */
+#define ELEMENT_NONLINEAR_MAX_POINTS  4    /* Q4 */
+#define ELEMENT_NONLINEAR_MAX_DOF     (2 * ELEMENT_NONLINEAR_MAX_NODES)
+#define ELEMENT_NONLINEAR_PACKED_SIZE \
+    (ELEMENT_NONLINEAR_MAX_DOF * (ELEMENT_NONLINEAR_MAX_DOF + 1) / 2)
+
+typedef struct {
+    int nodes;
+    int points;
+    double dN[ELEMENT_NONLINEAR_MAX_POINTS][ELEMENT_NONLINEAR_MAX_NODES][2]; /* dN/dX, dN/dY */
+    double volume[ELEMENT_NONLINEAR_MAX_POINTS];  /* weight * det J * thickness */
+    double D[3][3];
+} element_nonlinear_ref_t;
+
+/* Reference data of a T3, Q4 or T6 element */
+fem_error_t element_nonlinear_prepare(int element_id, element_nonlinear_ref_t *ref);
+
+/* Internal force fe (2 * nodes entries, node-major like the global DOFs)
+ * for element displacements ue; with ke_upper the tangent stiffness as a
+ * packed upper triangle, row by row (assembly_add_element_stiffness_packed) */
+void element_nonlinear_response(const element_nonlinear_ref_t *ref, const double *ue,
+                                double *fe, double *ke_upper);
+
+#endif /* ELEMENT_NONLINEAR_H */
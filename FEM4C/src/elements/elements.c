@@ -5,23 +5,33 @@
 #include "elements.h"
 #include "../common/error.h"
 #include "../common/globals.h"
+#include "../common/fem_thread.h"
 #include <stdio.h>
 #include <math.h>
 
+static fem_mutex_t g_elements_init_mutex = FEM_MUTEX_INITIALIZER;
+static int g_elements_initialized = 0;
+
 /* Initialize element management system */
 fem_error_t elements_initialize(void)
 {
-    fem_error_t error;
+    fem_error_t error = FEM_SUCCESS;
 
-    /* Initialize element base system */
-    error = element_base_initialize();
-    if (error != FEM_SUCCESS) return error;
+    /* The registry is shared by all analysis contexts; fill it once */
+    fem_mutex_lock(&g_elements_init_mutex);
+    if (!g_elements_initialized) {
+        /* Initialize element base system */
+        error = element_base_initialize();
 
-    /* Register all supported element types */
-    error = elements_register_all_types();
-    if (error != FEM_SUCCESS) return error;
+        /* Register all supported element types */
+        if (error == FEM_SUCCESS) {
+            error = elements_register_all_types();
+        }
+        g_elements_initialized = (error == FEM_SUCCESS);
+    }
+    fem_mutex_unlock(&g_elements_init_mutex);
 
-    return FEM_SUCCESS;
+    return error;
 }
 
 /* Finalize element management system */
@@ -60,6 +70,13 @@ fem_error_t elements_register_all_types(void)
         return error;
     }
 
+    /* Register T4, T10 and H8 solid elements */
+    error = solid3d_register();
+    if (error != FEM_SUCCESS) {
+        error_set(error, "elements_register_all_types", "Failed to register solid elements");
+        return error;
+    }
+
     return FEM_SUCCESS;
 }
 
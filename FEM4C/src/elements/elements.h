@@ -44,5 +44,6 @@ fem_error_t q4_register(void);
 fem_error_t t6_register(void);
 fem_error_t q8_register(void);
 fem_error_t q9_register(void);
+fem_error_t solid3d_register(void);
 
 #endif /* ELEMENTS_H */
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "q4_element.h"
 #include "../../common/globals.h"
 #include "../../common/error.h"
+#include "../../mesh/mesh_quality.h"
 #include <math.h>
 #include <string.h>
 
@@ -44,6 +45,7 @@ fem_error_t q4_integrate_stiffness(int element_id, double ke[Q4_TOTAL_DOF][Q4_TO
     }
 
     double thickness = g_material_props[material_id][2];
+    const element_quality_t *cached = mesh_validated_element(element_id);
 
     /* Integrate over Gauss points */
     for (int igp = 0; igp < Q4_GAUSS_POINTS; igp++) {
@@ -56,10 +58,14 @@ fem_error_t q4_integrate_stiffness(int element_id, double ke[Q4_TOTAL_DOF][Q4_TO
         fem_error_t error = q4_stiffness_integrand(element_id, xi, eta, integrand);
         if (error != FEM_SUCCESS) return error;
 
-        /* Calculate Jacobian determinant */
+        /* Jacobian determinant, cached by the mesh validation pass */
         double J[2][2], det_J;
-        error = q4_jacobian_matrix(element_id, xi, eta, J, &det_J);
-        if (error != FEM_SUCCESS) return error;
+        if (cached && cached->has_det_j) {
+            det_J = cached->det_j[igp];
+        } else {
+            error = q4_jacobian_matrix(element_id, xi, eta, J, &det_J);
+            if (error != FEM_SUCCESS) return error;
+        }
 
         /* Add contribution to stiffness matrix */
         double factor = weight * det_J * thickness;
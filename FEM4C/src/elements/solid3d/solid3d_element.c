@@ -0,0 +1,562 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Solid element (T4, T10, H8) implementation
+ */
+
+#include "solid3d_element.h"
+#include "../element_base.h"
+#include "../../common/globals.h"
+#include "../../common/error.h"
+#include <math.h>
+#include <string.h>
+
+/* Natural coordinates of the hexahedron corners */
+static const double h8_node_coords[8][3] = {
+    {-1.0, -1.0, -1.0}, { 1.0, -1.0, -1.0}, { 1.0,  1.0, -1.0}, {-1.0,  1.0, -1.0},
+    {-1.0, -1.0,  1.0}, { 1.0, -1.0,  1.0}, { 1.0,  1.0,  1.0}, {-1.0,  1.0,  1.0}
+};
+
+/* Corner pairs of the T10 edge nodes 5-10 */
+static const int t10_edge_nodes[6][2] = {
+    {0, 1}, {1, 2}, {2, 0}, {0, 3}, {1, 3}, {2, 3}
+};
+
+/* Tabulated rules, filled once by solid3d_initialize() */
+static solid3d_rule_t g_solid3d_rules[3];
+static int g_solid3d_rules_ready = 0;
+
+static int solid3d_rule_index(int element_type)
+{
+    switch (element_type) {
+        case ELEMENT_T4:  return 0;
+        case ELEMENT_T10: return 1;
+        case ELEMENT_H8:  return 2;
+        default:          return -1;
+    }
+}
+
+int solid3d_is_solid_type(int element_type)
+{
+    return solid3d_rule_index(element_type) >= 0;
+}
+
+int solid3d_node_count(int element_type)
+{
+    switch (element_type) {
+        case ELEMENT_T4:  return 4;
+        case ELEMENT_T10: return 10;
+        case ELEMENT_H8:  return 8;
+        default:          return 0;
+    }
+}
+
+fem_error_t solid3d_shape_functions(int element_type, const double xi[3],
+                                    double N[SOLID3D_MAX_NODES],
+                                    double dN[3][SOLID3D_MAX_NODES])
+{
+    switch (element_type) {
+        case ELEMENT_T4: {
+            N[0] = 1.0 - xi[0] - xi[1] - xi[2];
+            N[1] = xi[0];
+            N[2] = xi[1];
+            N[3] = xi[2];
+            for (int k = 0; k < 3; k++) {
+                dN[k][0] = -1.0;
+                for (int a = 1; a < 4; a++) {
+                    dN[k][a] = (a == k + 1) ? 1.0 : 0.0;
+                }
+            }
+            return FEM_SUCCESS;
+        }
+        case ELEMENT_T10: {
+            /* Volume coordinates L0..L3 and their natural derivatives */
+            double L[4] = {1.0 - xi[0] - xi[1] - xi[2], xi[0], xi[1], xi[2]};
+            double dL[3][4];
+            for (int k = 0; k < 3; k++) {
+                dL[k][0] = -1.0;
+                for (int c = 1; c < 4; c++) {
+                    dL[k][c] = (c == k + 1) ? 1.0 : 0.0;
+                }
+            }
+            for (int c = 0; c < 4; c++) {
+                N[c] = L[c] * (2.0 * L[c] - 1.0);
+                for (int k = 0; k < 3; k++) {
+                    dN[k][c] = (4.0 * L[c] - 1.0) * dL[k][c];
+                }
+            }
+            for (int m = 0; m < 6; m++) {
+                int p = t10_edge_nodes[m][0];
+                int q = t10_edge_nodes[m][1];
+                N[4 + m] = 4.0 * L[p] * L[q];
+                for (int k = 0; k < 3; k++) {
+                    dN[k][4 + m] = 4.0 * (dL[k][p] * L[q] + L[p] * dL[k][q]);
+                }
+            }
+            return FEM_SUCCESS;
+        }
+        case ELEMENT_H8:
+            for (int a = 0; a < 8; a++) {
+                double fx = 1.0 + h8_node_coords[a][0] * xi[0];
+                double fy = 1.0 + h8_node_coords[a][1] * xi[1];
+                double fz = 1.0 + h8_node_coords[a][2] * xi[2];
+                N[a] = 0.125 * fx * fy * fz;
+                dN[0][a] = 0.125 * h8_node_coords[a][0] * fy * fz;
+                dN[1][a] = 0.125 * fx * h8_node_coords[a][1] * fz;
+                dN[2][a] = 0.125 * fx * fy * h8_node_coords[a][2];
+            }
+            return FEM_SUCCESS;
+        default:
+            return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                             "Element type %d is not a solid element", element_type);
+    }
+}
+
+void solid3d_node_natural_coords(int element_type, int node, double xi[3])
+{
+    static const double tet_corners[4][3] = {
+        {0.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}
+    };
+
+    if (element_type == ELEMENT_H8) {
+        memcpy(xi, h8_node_coords[node], 3 * sizeof(double));
+    } else if (node < 4) {
+        memcpy(xi, tet_corners[node], 3 * sizeof(double));
+    } else {
+        const int *edge = t10_edge_nodes[node - 4];
+        for (int k = 0; k < 3; k++) {
+            xi[k] = 0.5 * (tet_corners[edge[0]][k] + tet_corners[edge[1]][k]);
+        }
+    }
+}
+
+static fem_error_t solid3d_build_rule(int element_type, int order, solid3d_rule_t *rule)
+{
+    gauss_integration_t gauss;
+    fem_error_t err;
+
+    if (element_type == ELEMENT_H8) {
+        err = element_get_gauss_points_3d_hexahedron(order, &gauss);
+    } else {
+        err = element_get_gauss_points_3d_tetrahedron(order, &gauss);
+    }
+    CHECK_ERROR(err);
+
+    memset(rule, 0, sizeof(*rule));
+    rule->element_type = element_type;
+    rule->nodes = solid3d_node_count(element_type);
+    rule->gauss_points = gauss.num_points;
+    for (int gp = 0; gp < gauss.num_points; gp++) {
+        rule->xi[gp][0] = gauss.points[gp].xi;
+        rule->xi[gp][1] = gauss.points[gp].eta;
+        rule->xi[gp][2] = gauss.points[gp].zeta;
+        rule->weight[gp] = gauss.points[gp].weight;
+        err = solid3d_shape_functions(element_type, rule->xi[gp], rule->N[gp], rule->dN[gp]);
+        CHECK_ERROR(err);
+    }
+    return FEM_SUCCESS;
+}
+
+/* Tabulate the rules: T4 1 point, T10 4 points, H8 2x2x2 */
+fem_error_t solid3d_initialize(void)
+{
+    fem_error_t err;
+
+    if (g_solid3d_rules_ready) {
+        return FEM_SUCCESS;
+    }
+    err = solid3d_build_rule(ELEMENT_T4, 1, &g_solid3d_rules[0]);
+    CHECK_ERROR(err);
+    err = solid3d_build_rule(ELEMENT_T10, 2, &g_solid3d_rules[1]);
+    CHECK_ERROR(err);
+    err = solid3d_build_rule(ELEMENT_H8, 2, &g_solid3d_rules[2]);
+    CHECK_ERROR(err);
+    g_solid3d_rules_ready = 1;
+    return FEM_SUCCESS;
+}
+
+const solid3d_rule_t *solid3d_rule(int element_type)
+{
+    int index = solid3d_rule_index(element_type);
+
+    if (index < 0 || !g_solid3d_rules_ready) {
+        return NULL;
+    }
+    return &g_solid3d_rules[index];
+}
+
+/* Register T4, T10 and H8 with the element base system */
+fem_error_t solid3d_register(void)
+{
+    static const struct {
+        int type;
+        int nodes;
+        int gauss_points;
+        const char *name;
+    } types[3] = {
+        {ELEMENT_T4, 4, 1, "T4"},
+        {ELEMENT_T10, 10, 4, "T10"},
+        {ELEMENT_H8, 8, 8, "H8"}
+    };
+    fem_error_t err;
+
+    err = solid3d_initialize();
+    CHECK_ERROR(err);
+
+    for (int i = 0; i < 3; i++) {
+        element_properties_t props = {
+            .element_type = types[i].type,
+            .nodes_per_element = types[i].nodes,
+            .dof_per_node = SOLID3D_DOF_PER_NODE,
+            .total_dof = types[i].nodes * SOLID3D_DOF_PER_NODE,
+            .gauss_points = types[i].gauss_points,
+            .spatial_dimension = 3,
+            .strain_components = SOLID3D_STRAIN_COMPONENTS,
+            .stress_components = SOLID3D_STRESS_COMPONENTS,
+            .init = solid3d_initialize,
+            .shape_functions = NULL,  /* Type-generic signature, handled directly */
+            .jacobian = NULL,
+            .stiffness = solid3d_element_stiffness,
+            .stress = solid3d_element_stress,
+            .validate = solid3d_validate_element
+        };
+        strcpy(props.name, types[i].name);
+        err = element_register_type(&props);
+        CHECK_ERROR(err);
+    }
+    return FEM_SUCCESS;
+}
+
+/* Inverse-transpose of the Jacobian J[i][k] = dx_k / dxi_i applied to the
+ * natural derivatives */
+fem_error_t solid3d_cartesian_derivatives(int nodes, const double coords[][3],
+                                          const double dN[3][SOLID3D_MAX_NODES],
+                                          double dN_dx[SOLID3D_MAX_NODES][3], double *det_J)
+{
+    double J[3][3] = {{0.0}};
+    double inv[3][3];
+    double det;
+
+    for (int a = 0; a < nodes; a++) {
+        for (int i = 0; i < 3; i++) {
+            for (int k = 0; k < 3; k++) {
+                J[i][k] += dN[i][a] * coords[a][k];
+            }
+        }
+    }
+
+    inv[0][0] = J[1][1] * J[2][2] - J[1][2] * J[2][1];
+    inv[0][1] = J[0][2] * J[2][1] - J[0][1] * J[2][2];
+    inv[0][2] = J[0][1] * J[1][2] - J[0][2] * J[1][1];
+    inv[1][0] = J[1][2] * J[2][0] - J[1][0] * J[2][2];
+    inv[1][1] = J[0][0] * J[2][2] - J[0][2] * J[2][0];
+    inv[1][2] = J[0][2] * J[1][0] - J[0][0] * J[1][2];
+    inv[2][0] = J[1][0] * J[2][1] - J[1][1] * J[2][0];
+    inv[2][1] = J[0][1] * J[2][0] - J[0][0] * J[2][1];
+    inv[2][2] = J[0][0] * J[1][1] - J[0][1] * J[1][0];
+    det = J[0][0] * inv[0][0] + J[0][1] * inv[1][0] + J[0][2] * inv[2][0];
+
+    *det_J = det;
+    if (!(det > 0.0)) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Non-positive Jacobian determinant %e", det);
+    }
+
+    /* dN/dx_k = sum_i (J^-1)[k][i] dN/dxi_i */
+    for (int a = 0; a < nodes; a++) {
+        for (int k = 0; k < 3; k++) {
+            dN_dx[a][k] = (inv[k][0] * dN[0][a] + inv[k][1] * dN[1][a] +
+                           inv[k][2] * dN[2][a]) / det;
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t solid3d_lame_constants(int material_id, double *lambda, double *mu)
+{
+    if (material_id < 0 || material_id >= g_num_materials) {
+        return error_set(FEM_ERROR_INVALID_MATERIAL, "Invalid material index %d", material_id);
+    }
+
+    double E = g_material_props[material_id][0];
+    double nu = g_material_props[material_id][1];
+    if (E <= 0.0 || nu <= -1.0 || nu >= 0.5) {
+        return error_set(FEM_ERROR_INVALID_MATERIAL,
+                         "Material %d (E = %g, nu = %g) is not valid for solids",
+                         material_id + 1, E, nu);
+    }
+
+    *lambda = E * nu / ((1.0 + nu) * (1.0 - 2.0 * nu));
+    *mu = E / (2.0 * (1.0 + nu));
+    return FEM_SUCCESS;
+}
+
+static fem_error_t solid3d_gather_coords(int element_id, int nodes, double coords[][3])
+{
+    for (int a = 0; a < nodes; a++) {
+        int node = g_element_nodes[element_id][a];
+        if (node < 0 || node >= g_num_nodes) {
+            return error_set(FEM_ERROR_INVALID_NODE,
+                             "Element %d references invalid node %d", element_id + 1, node);
+        }
+        coords[a][0] = g_node_coords[node][0];
+        coords[a][1] = g_node_coords[node][1];
+        coords[a][2] = g_node_coords[node][2];
+    }
+    return FEM_SUCCESS;
+}
+
+/* With isotropic D the (a, b) block of B^T D B reduces to
+ *   lambda g h^T + mu h g^T + mu (g . h) I,  g = grad N_a, h = grad N_b
+ * which the kernel accumulates directly for the upper block triangle */
+fem_error_t solid3d_stiffness_batch(int element_type, const int *elements, int count,
+                                    double *ke)
+{
+    const solid3d_rule_t *rule = solid3d_rule(element_type);
+    fem_error_t err;
+
+    if (rule == NULL) {
+        return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                         "Element type %d is not a solid element", element_type);
+    }
+
+    const int nodes = rule->nodes;
+    const size_t element_size = (size_t)nodes * nodes * 9;
+
+    for (int e = 0; e < count; e++) {
+        int element_id = elements[e];
+        double *k = ke + (size_t)e * element_size;
+        double coords[SOLID3D_MAX_NODES][3];
+        double lambda, mu;
+
+        err = solid3d_gather_coords(element_id, nodes, coords);
+        CHECK_ERROR(err);
+        err = solid3d_lame_constants(g_element_material[element_id], &lambda, &mu);
+        CHECK_ERROR(err);
+
+        memset(k, 0, element_size * sizeof(double));
+        for (int gp = 0; gp < rule->gauss_points; gp++) {
+            double dN_dx[SOLID3D_MAX_NODES][3];
+            double det_J;
+
+            err = solid3d_cartesian_derivatives(nodes, (const double (*)[3])coords,
+                                                (const double (*)[SOLID3D_MAX_NODES])rule->dN[gp],
+                                                dN_dx, &det_J);
+            if (err != FEM_SUCCESS) {
+                return error_set(err, "Element %d: non-positive Jacobian (%e) at Gauss point %d",
+                                 element_id + 1, det_J, gp + 1);
+            }
+
+            double w = rule->weight[gp] * det_J;
+            double wl = w * lambda;
+            double wm = w * mu;
+            for (int a = 0; a < nodes; a++) {
+                const double *g = dN_dx[a];
+                for (int b = a; b < nodes; b++) {
+                    const double *h = dN_dx[b];
+                    double *block = k + ((size_t)a * nodes + b) * 9;
+                    double diag = wm * (g[0] * h[0] + g[1] * h[1] + g[2] * h[2]);
+                    for (int i = 0; i < 3; i++) {
+                        for (int j = 0; j < 3; j++) {
+                            block[i * 3 + j] += wl * g[i] * h[j] + wm * g[j] * h[i];
+                        }
+                        block[i * 3 + i] += diag;
+                    }
+                }
+            }
+        }
+
+        /* Lower block triangle by symmetry: K_ba = K_ab^T */
+        for (int a = 0; a < nodes; a++) {
+            for (int b = 0; b < a; b++) {
+                const double *upper = k + ((size_t)b * nodes + a) * 9;
+                double *lower = k + ((size_t)a * nodes + b) * 9;
+                for (int i = 0; i < 3; i++) {
+                    for (int j = 0; j < 3; j++) {
+                        lower[i * 3 + j] = upper[j * 3 + i];
+                    }
+                }
+            }
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t solid3d_element_stiffness(int element_id,
+                                      double ke[][MAX_DOF_PER_NODE * MAX_NODES_PER_ELEMENT])
+{
+    double blocks[SOLID3D_MAX_BLOCKS * 9];
+    int type;
+    int nodes;
+    fem_error_t err;
+
+    if (element_id < 0 || element_id >= g_num_elements) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Invalid element ID %d", element_id);
+    }
+    type = g_element_type[element_id];
+    nodes = solid3d_node_count(type);
+
+    err = solid3d_stiffness_batch(type, &element_id, 1, blocks);
+    CHECK_ERROR(err);
+
+    for (int a = 0; a < nodes; a++) {
+        for (int b = 0; b < nodes; b++) {
+            const double *block = blocks + ((size_t)a * nodes + b) * 9;
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    ke[3 * a + i][3 * b + j] = block[i * 3 + j];
+                }
+            }
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t solid3d_stress_at(int element_id, const double xi[3],
+                              double stress[SOLID3D_STRESS_COMPONENTS])
+{
+    int type = g_element_type[element_id];
+    int nodes = solid3d_node_count(type);
+    double coords[SOLID3D_MAX_NODES][3];
+    double N[SOLID3D_MAX_NODES];
+    double dN[3][SOLID3D_MAX_NODES];
+    double dN_dx[SOLID3D_MAX_NODES][3];
+    double grad[3][3] = {{0.0}};
+    double lambda, mu, det_J;
+    fem_error_t err;
+
+    err = solid3d_shape_functions(type, xi, N, dN);
+    CHECK_ERROR(err);
+    err = solid3d_gather_coords(element_id, nodes, coords);
+    CHECK_ERROR(err);
+    err = solid3d_lame_constants(g_element_material[element_id], &lambda, &mu);
+    CHECK_ERROR(err);
+    err = solid3d_cartesian_derivatives(nodes, (const double (*)[3])coords,
+                                        (const double (*)[SOLID3D_MAX_NODES])dN, dN_dx, &det_J);
+    CHECK_ERROR(err);
+
+    /* grad[k][m] = du_k / dx_m */
+    for (int a = 0; a < nodes; a++) {
+        const double *u = g_node_displ[g_element_nodes[element_id][a]];
+        for (int k = 0; k < 3; k++) {
+            for (int m = 0; m < 3; m++) {
+                grad[k][m] += u[k] * dN_dx[a][m];
+            }
+        }
+    }
+
+    double volumetric = lambda * (grad[0][0] + grad[1][1] + grad[2][2]);
+    stress[0] = volumetric + 2.0 * mu * grad[0][0];
+    stress[1] = volumetric + 2.0 * mu * grad[1][1];
+    stress[2] = volumetric + 2.0 * mu * grad[2][2];
+    stress[3] = mu * (grad[0][1] + grad[1][0]);
+    stress[4] = mu * (grad[1][2] + grad[2][1]);
+    stress[5] = mu * (grad[2][0] + grad[0][2]);
+    return FEM_SUCCESS;
+}
+
+fem_error_t solid3d_element_stress(int element_id, double stress[])
+{
+    double centroid[3];
+
+    if (element_id < 0 || element_id >= g_num_elements) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Invalid element ID %d", element_id);
+    }
+    if (g_element_type[element_id] == ELEMENT_H8) {
+        centroid[0] = centroid[1] = centroid[2] = 0.0;
+    } else {
+        centroid[0] = centroid[1] = centroid[2] = 0.25;
+    }
+    return solid3d_stress_at(element_id, centroid, stress);
+}
+
+fem_error_t solid3d_body_force(int element_id, const double body_force[3],
+                               double fe[SOLID3D_MAX_NODES * SOLID3D_DOF_PER_NODE])
+{
+    int type = g_element_type[element_id];
+    const solid3d_rule_t *rule = solid3d_rule(type);
+    double coords[SOLID3D_MAX_NODES][3];
+    fem_error_t err;
+
+    if (rule == NULL) {
+        return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                         "Element type %d is not a solid element", type);
+    }
+    err = solid3d_gather_coords(element_id, rule->nodes, coords);
+    CHECK_ERROR(err);
+
+    memset(fe, 0, (size_t)rule->nodes * SOLID3D_DOF_PER_NODE * sizeof(double));
+    for (int gp = 0; gp < rule->gauss_points; gp++) {
+        double dN_dx[SOLID3D_MAX_NODES][3];
+        double det_J;
+
+        err = solid3d_cartesian_derivatives(rule->nodes, (const double (*)[3])coords,
+                                            (const double (*)[SOLID3D_MAX_NODES])rule->dN[gp],
+                                            dN_dx, &det_J);
+        CHECK_ERROR(err);
+        double w = rule->weight[gp] * det_J;
+        for (int a = 0; a < rule->nodes; a++) {
+            for (int k = 0; k < 3; k++) {
+                fe[3 * a + k] += w * rule->N[gp][a] * body_force[k];
+            }
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t solid3d_measure_element(int element_id, double *volume, double *min_det_J,
+                                    double det_J[SOLID3D_MAX_GAUSS_POINTS])
+{
+    int type = g_element_type[element_id];
+    const solid3d_rule_t *rule = solid3d_rule(type);
+    double coords[SOLID3D_MAX_NODES][3];
+    fem_error_t err;
+
+    if (rule == NULL) {
+        return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                         "Element type %d is not a solid element", type);
+    }
+    err = solid3d_gather_coords(element_id, rule->nodes, coords);
+    CHECK_ERROR(err);
+
+    *volume = 0.0;
+    *min_det_J = 0.0;
+    for (int gp = 0; gp < rule->gauss_points; gp++) {
+        double dN_dx[SOLID3D_MAX_NODES][3];
+        double det;
+
+        err = solid3d_cartesian_derivatives(rule->nodes, (const double (*)[3])coords,
+                                            (const double (*)[SOLID3D_MAX_NODES])rule->dN[gp],
+                                            dN_dx, &det);
+        if (gp == 0 || det < *min_det_J) {
+            *min_det_J = det;
+        }
+        if (det_J) {
+            det_J[gp] = det;
+        }
+        if (err != FEM_SUCCESS) {
+            return error_set(err, "Element %d: non-positive Jacobian (%e) at Gauss point %d",
+                             element_id + 1, det, gp + 1);
+        }
+        *volume += rule->weight[gp] * det;
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t solid3d_validate_element(int element_id)
+{
+    double volume, min_det_J;
+
+    if (element_id < 0 || element_id >= g_num_elements) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Invalid element ID %d", element_id);
+    }
+    return solid3d_measure_element(element_id, &volume, &min_det_J, NULL);
+}
+
+double solid3d_von_mises(const double stress[SOLID3D_STRESS_COMPONENTS])
+{
+    double dxy = stress[0] - stress[1];
+    double dyz = stress[1] - stress[2];
+    double dzx = stress[2] - stress[0];
+    double shear = stress[3] * stress[3] + stress[4] * stress[4] + stress[5] * stress[5];
+
+    return sqrt(0.5 * (dxy * dxy + dyz * dyz + dzx * dzx) + 3.0 * shear);
+}
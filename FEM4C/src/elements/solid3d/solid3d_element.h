@@ -0,0 +1,101 @@
+#ifndef SOLID3D_ELEMENT_H
+#define SOLID3D_ELEMENT_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Solid elements: T4 and T10 tetrahedra, H8 hexahedron
+ *
+ * Isoparametric displacement elements with three DOF per node, after the
+ * t4disp, t10disp and h8disp programs of the book. Node numbering follows
+ * Nastran CTETRA/CHEXA (and VTK): tetrahedron corners 1-4, then the edge
+ * midpoints 1-2, 2-3, 3-1, 1-4, 2-4, 3-4; hexahedron bottom face 1-4 and
+ * top face 5-8. Strains and stresses are ordered xx, yy, zz, xy, yz, zx
+ * with engineering shear strains.
+ *
+ * The shape function derivatives at the Gauss points of each type are
+ * tabulated once; the stiffness kernel works on batches of elements of
+ * one type and writes the element matrices as 3x3 node blocks, the layout
+ * of the block sparse global matrix (block_assembly.h).
+ */
+
+#include "../../common/constants.h"
+#include "../../common/types.h"
+
+#define SOLID3D_DOF_PER_NODE        3
+#define SOLID3D_STRAIN_COMPONENTS   6
+#define SOLID3D_STRESS_COMPONENTS   6
+#define SOLID3D_MAX_NODES           10
+#define SOLID3D_MAX_GAUSS_POINTS    8
+#define SOLID3D_MAX_BLOCKS          (SOLID3D_MAX_NODES * SOLID3D_MAX_NODES)
+
+/* Elements per stiffness kernel call */
+#define SOLID3D_BATCH_SIZE          32
+
+/* Integration rule of one element type with the shape functions and
+ * their natural derivatives tabulated at its points */
+typedef struct {
+    int element_type;
+    int nodes;
+    int gauss_points;
+    double xi[SOLID3D_MAX_GAUSS_POINTS][3];
+    double weight[SOLID3D_MAX_GAUSS_POINTS];
+    double N[SOLID3D_MAX_GAUSS_POINTS][SOLID3D_MAX_NODES];
+    double dN[SOLID3D_MAX_GAUSS_POINTS][3][SOLID3D_MAX_NODES];
+} solid3d_rule_t;
+
+/* Module setup */
+fem_error_t solid3d_initialize(void);
+fem_error_t solid3d_register(void);
+
+/* Element type queries */
+int solid3d_is_solid_type(int element_type);
+int solid3d_node_count(int element_type);
+const solid3d_rule_t *solid3d_rule(int element_type);
+
+/* Shape functions and natural derivatives at (xi, eta, zeta) */
+fem_error_t solid3d_shape_functions(int element_type, const double xi[3],
+                                    double N[SOLID3D_MAX_NODES],
+                                    double dN[3][SOLID3D_MAX_NODES]);
+
+/* Cartesian derivatives from natural ones; fails for det J <= 0 */
+fem_error_t solid3d_cartesian_derivatives(int nodes, const double coords[][3],
+                                          const double dN[3][SOLID3D_MAX_NODES],
+                                          double dN_dx[SOLID3D_MAX_NODES][3], double *det_J);
+
+/* Lame constants of an isotropic material */
+fem_error_t solid3d_lame_constants(int material_id, double *lambda, double *mu);
+
+/* Stiffness of count elements of one type. Element e of the batch gets
+ * nodes * nodes blocks at ke + e * nodes * nodes * 9; block (a, b) couples
+ * node a to node b and is stored row-major at (a * nodes + b) * 9. */
+fem_error_t solid3d_stiffness_batch(int element_type, const int *elements, int count,
+                                    double *ke);
+
+/* Dense element stiffness for the element registry (DOF order u1 v1 w1 u2 ...) */
+fem_error_t solid3d_element_stiffness(int element_id,
+                                      double ke[][MAX_DOF_PER_NODE * MAX_NODES_PER_ELEMENT]);
+
+/* Stress at natural coordinates xi, and at the element centroid */
+fem_error_t solid3d_stress_at(int element_id, const double xi[3],
+                              double stress[SOLID3D_STRESS_COMPONENTS]);
+fem_error_t solid3d_element_stress(int element_id, double stress[]);
+
+/* Natural coordinates of the element nodes */
+void solid3d_node_natural_coords(int element_type, int node, double xi[3]);
+
+/* Body force b (per unit volume) lumped consistently to the nodes:
+ * fe[3 * a + k] = integral of N_a b_k */
+fem_error_t solid3d_body_force(int element_id, const double body_force[3],
+                               double fe[SOLID3D_MAX_NODES * SOLID3D_DOF_PER_NODE]);
+
+/* Positive Jacobian at every stiffness Gauss point */
+fem_error_t solid3d_validate_element(int element_id);
+
+/* Volume, smallest Jacobian determinant and the determinant at each
+ * stiffness Gauss point (det_J may be NULL) */
+fem_error_t solid3d_measure_element(int element_id, double *volume, double *min_det_J,
+                                    double det_J[SOLID3D_MAX_GAUSS_POINTS]);
+
+/* Von Mises equivalent of a 3D stress state */
+double solid3d_von_mises(const double stress[SOLID3D_STRESS_COMPONENTS]);
+
+#endif /* SOLID3D_ELEMENT_H */
@@ -6,6 +6,7 @@
 #include "../element_base.h"
 #include "../../common/globals.h"
 #include "../../common/error.h"
+#include "../../mesh/mesh_quality.h"
 #include <math.h>
 #include <string.h>
 
@@ -220,10 +221,15 @@ fem_error_t t3_element_stiffness(int element_id, double ke[T3_TOTAL_DOF][T3_TOTA
     error = t3_strain_displacement_matrix(element_id, xi, eta, B);
     if (error != FEM_SUCCESS) return error;
 
-    /* Calculate Jacobian determinant */
+    /* Jacobian determinant, cached by the mesh validation pass */
     double J[2][2], det_J;
-    error = t3_jacobian_matrix(element_id, xi, eta, J, &det_J);
-    if (error != FEM_SUCCESS) return error;
+    const element_quality_t *cached = mesh_validated_element(element_id);
+    if (cached && cached->has_det_j) {
+        det_J = cached->det_j[0];
+    } else {
+        error = t3_jacobian_matrix(element_id, xi, eta, J, &det_J);
+        if (error != FEM_SUCCESS) return error;
+    }
 
     /* Calculate stiffness matrix: K = B^T * D * B * det_J * thickness */
     double factor = det_J * thickness * 0.5;  /* 0.5 is the weight for triangle integration */
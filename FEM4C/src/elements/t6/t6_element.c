@@ -8,6 +8,7 @@
 #include "../element_base.h"
 #include "../../common/globals.h"
 #include "../../common/error.h"
+#include "../../common/fem_log.h"
 #include <math.h>
 #include <string.h>
 
@@ -121,8 +122,7 @@ fem_error_t t6_jacobian_matrix(int element_id, double xi, double eta,
     J[0][0] = J[0][1] = J[1][0] = J[1][1] = ZERO;
     
     /* Calculate Jacobian matrix components */
-    static int jacobian_calc_debug = 0;
-    if (!jacobian_calc_debug) {
+    if (FEM_LOG_ENABLED(FEM_LOG_LEVEL_TRACE)) {
         printf("    Jacobian calculation debug:\n");
         printf("      Node coordinates: ");
         for (i = 0; i < T6_NODES_PER_ELEMENT; i++) {
@@ -133,7 +133,6 @@ fem_error_t t6_jacobian_matrix(int element_id, double xi, double eta,
             printf("dN%d/dxi=%g,dN%d/deta=%g ", i+1, dN_dxi[i], i+1, dN_deta[i]);
         }
         printf("\n");
-        jacobian_calc_debug = 1;
     }
 
     for (i = 0; i < T6_NODES_PER_ELEMENT; i++) {
@@ -176,15 +175,13 @@ fem_error_t t6_shape_derivatives_global(int element_id, double xi, double eta,
     inv_J[1][1] =  J[0][0] / det_J;
 
     /* Debug output for Jacobian */
-    static int jacobian_debug = 0;
-    if (!jacobian_debug) {
+    if (FEM_LOG_ENABLED(FEM_LOG_LEVEL_TRACE)) {
         printf("    Jacobian matrix at (%.3f, %.3f):\n", xi, eta);
         printf("      J = [%.3f  %.3f]\n", J[0][0], J[0][1]);
         printf("          [%.3f  %.3f]\n", J[1][0], J[1][1]);
         printf("      det(J) = %.3f\n", det_J);
         printf("      inv_J = [%.3f  %.3f]\n", inv_J[0][0], inv_J[0][1]);
         printf("              [%.3f  %.3f]\n", inv_J[1][0], inv_J[1][1]);
-        jacobian_debug = 1;
     }
     
     /* Get natural derivatives */
@@ -197,15 +194,12 @@ fem_error_t t6_shape_derivatives_global(int element_id, double xi, double eta,
         dN_dy[i] = inv_J[1][0] * dN_dxi[i] + inv_J[1][1] * dN_deta[i];
     }
 
-    /* Debug output for first call */
-    static int debug_printed = 0;
-    if (!debug_printed) {
+    if (FEM_LOG_ENABLED(FEM_LOG_LEVEL_TRACE)) {
         printf("    Natural derivatives at (%.3f, %.3f):\n", xi, eta);
         for (i = 0; i < T6_NODES_PER_ELEMENT; i++) {
             printf("      dN%d: dxi=%.3f, deta=%.3f -> dx=%.3f, dy=%.3f\n",
                    i+1, dN_dxi[i], dN_deta[i], dN_dx[i], dN_dy[i]);
         }
-        debug_printed = 1;
     }
     
     return FEM_SUCCESS;
@@ -296,8 +290,8 @@ fem_error_t t6_validate_element(int element_id)
     
     /* Check if element type is T6 */
     if (g_element_type[element_id] != ELEMENT_T6) {
-        fprintf(stderr, "[t6_validate] element %d unexpected type %d\n",
-                element_id, g_element_type[element_id]);
+        FEM_LOG_DEBUG("[t6_validate] element %d unexpected type %d\n",
+                      element_id, g_element_type[element_id]);
         return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE, 
                         "Element %d is not a T6 element", element_id + 1);
     }
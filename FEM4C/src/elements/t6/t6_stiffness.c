@@ -5,6 +5,8 @@
 #include "t6_stiffness.h"
 #include "../../common/globals.h"
 #include "../../common/error.h"
+#include "../../common/fem_log.h"
+#include "../../mesh/mesh_quality.h"
 #include <string.h>
 
 /* Calculate material matrix for plane stress */
@@ -82,9 +84,11 @@ fem_error_t t6_element_stiffness_matrix(int element_id,
     double E, nu;
     fem_error_t err;
     
-    /* Validate element */
-    err = t6_validate_element(element_id);
-    CHECK_ERROR(err);
+    /* Validate element unless the mesh validation pass already did */
+    if (!mesh_validated_element(element_id)) {
+        err = t6_validate_element(element_id);
+        CHECK_ERROR(err);
+    }
     
     /* Get material properties */
     material_id = g_element_material[element_id];
@@ -119,7 +123,7 @@ fem_error_t t6_integrate_stiffness(int element_id,
     double thickness;
     int material_id;
     int gp, i, j, k;
-    static int gauss_debug_printed = 0;
+    const element_quality_t *cached = mesh_validated_element(element_id);
     fem_error_t err;
     
     /* Initialize stiffness matrix */
@@ -145,17 +149,21 @@ fem_error_t t6_integrate_stiffness(int element_id,
         err = t6_strain_displacement_matrix(element_id, xi, eta, B);
         CHECK_ERROR(err);
 
-        /* Calculate Jacobian determinant */
-        err = t6_jacobian_matrix(element_id, xi, eta, J, &det_J);
-        CHECK_ERROR(err);
+        /* Jacobian determinant, cached by the mesh validation pass */
+        if (cached && cached->has_det_j) {
+            det_J = cached->det_j[gp];
+        } else {
+            err = t6_jacobian_matrix(element_id, xi, eta, J, &det_J);
+            CHECK_ERROR(err);
+        }
 
-        /* Print one representative Gauss-point log only once per process. */
-        if (gp == 0 && !gauss_debug_printed) {
-            printf("  Debug: Gauss point 1 (xi=%.3f, eta=%.3f):\n", xi, eta);
-            printf("    Jacobian det = %.6e\n", det_J);
-            printf("    B-matrix sample: B[0][0]=%.6e, B[1][1]=%.6e, B[2][0]=%.6e\n",
-                   B[0][0], B[1][1], B[2][0]);
-            gauss_debug_printed = 1;
+        /* Representative Gauss-point log, first point of each element */
+        if (gp == 0) {
+            FEM_LOG_TRACE("  Debug: element %d Gauss point 1 (xi=%.3f, eta=%.3f):\n",
+                          element_id, xi, eta);
+            FEM_LOG_TRACE("    Jacobian det = %.6e\n", det_J);
+            FEM_LOG_TRACE("    B-matrix sample: B[0][0]=%.6e, B[1][1]=%.6e, B[2][0]=%.6e\n",
+                          B[0][0], B[1][1], B[2][0]);
         }
         
         /* Calculate B^T * D */
@@ -197,9 +205,11 @@ fem_error_t t6_calculate_element_stress(int element_id,
     int i, j;
     fem_error_t err;
     
-    /* Validate element */
-    err = t6_validate_element(element_id);
-    CHECK_ERROR(err);
+    /* Validate element unless the mesh validation pass already did */
+    if (!mesh_validated_element(element_id)) {
+        err = t6_validate_element(element_id);
+        CHECK_ERROR(err);
+    }
     
     /* Get material properties */
     material_id = g_element_material[element_id];
@@ -26,7 +26,16 @@
 #include "common/types.h"
 #include "common/globals.h"
 #include "common/error.h"
+#include "common/fem_log.h"
+#include "common/fem_memory.h"
 #include "analysis/static.h"
+#include "analysis/batch.h"
+#include "analysis/service.h"
+#include "analysis/nonlinear.h"
+#include "analysis/adaptive.h"
+#include "analysis/transient.h"
+#include "analysis/explicit.h"
+#include "analysis/harmonic.h"
 
 static int path_is_file(const char *path)
 {
@@ -58,6 +67,27 @@ static int looks_like_nastran_input(const char *path)
     return 0;
 }
 
+/* The parser package carries no constraint equations, so bulk data with
+ * RBE2/RBE3/MPC cards is read directly */
+static int nastran_has_constraint_cards(const char *path)
+{
+    char line[256];
+    int found = 0;
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        return 0;
+    }
+    while (!found && fgets(line, sizeof(line), file) != NULL) {
+        if (strncmp(line, "RBE2", 4) == 0 || strncmp(line, "RBE3", 4) == 0 ||
+            (strncmp(line, "MPC", 3) == 0 && strncmp(line, "MPCADD", 6) != 0)) {
+            found = 1;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
 static int run_parser(const char *input_path, const char *outroot, const char *part)
 {
 #ifdef _WIN32
@@ -69,7 +99,7 @@ static int run_parser(const char *input_path, const char *outroot, const char *p
              "cmd /c \"\"%s\" \"%s\" \"%s\" \"%s\"\"",
              parser_path, input_path, outroot, part);
 
-    fprintf(stderr, "[DEBUG] run_parser cmd: %s\n", cmd);
+    FEM_LOG_DEBUG("[DEBUG] run_parser cmd: %s\n", cmd);
 
     int rc = system(cmd);
     if (rc != 0) {
@@ -135,11 +165,144 @@ int main(int argc, char *argv[])
     fem_error_t err;
     int needs_parser = 0;
     
+    fem_log_init_from_env();
+    
     printf("FEM4C - High Performance Finite Element Method in C\n");
     printf("Based on \"Finite Element Method\"\n");
     printf("Version 1.0\n");
     printf("=====================================\n\n");
     
+    /* Batch mode: fem4c --batch <job file> [workers] */
+    if (argc > 2 && strcmp(argv[1], "--batch") == 0) {
+        err = batch_run(argv[2], argc > 3 ? atoi(argv[3]) : 0);
+        if (err != FEM_SUCCESS) {
+            error_print(err);
+            printf("\nBatch failed with error code: %d\n", err);
+            return EXIT_FAILURE;
+        }
+        printf("Program completed successfully.\n");
+        return EXIT_SUCCESS;
+    }
+    
+    /* Resident service: fem4c --serve <socket path> [cached models] */
+    if (argc > 2 && strcmp(argv[1], "--serve") == 0) {
+        err = service_run(argv[2], argc > 3 ? atoi(argv[3]) : 0);
+        if (err != FEM_SUCCESS) {
+            error_print(err);
+            printf("\nService failed with error code: %d\n", err);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    
+    /* Large-displacement statics: fem4c --nonlinear <input> [output] [load steps] */
+    if (argc > 2 && strcmp(argv[1], "--nonlinear") == 0) {
+        nonlinear_options_t options = nonlinear_default_options();
+        if (argc > 4 && atoi(argv[4]) > 0) {
+            options.load_steps = atoi(argv[4]);
+        }
+        err = nonlinear_analysis(argv[2], argc > 3 ? argv[3] : "output.dat", &options);
+        if (err != FEM_SUCCESS) {
+            error_print(err);
+            printf("\nAnalysis failed with error code: %d\n", err);
+            return EXIT_FAILURE;
+        }
+        printf("Program completed successfully.\n");
+        return EXIT_SUCCESS;
+    }
+    
+    /* Adaptive refinement: fem4c --adaptive <input> <output> [target error %] [max cycles] */
+    if (argc > 3 && strcmp(argv[1], "--adaptive") == 0) {
+        adaptive_options_t options = adaptive_default_options();
+        if (argc > 4 && atof(argv[4]) > 0.0) {
+            options.target_error = atof(argv[4]) / 100.0;
+        }
+        if (argc > 5 && atoi(argv[5]) > 0) {
+            options.max_cycles = atoi(argv[5]);
+        }
+        err = adaptive_analysis(argv[2], argv[3], &options);
+        if (err != FEM_SUCCESS) {
+            error_print(err);
+            printf("\nAnalysis failed with error code: %d\n", err);
+            return EXIT_FAILURE;
+        }
+        printf("Program completed successfully.\n");
+        return EXIT_SUCCESS;
+    }
+    
+    /* Implicit dynamics: fem4c --transient <input> <output> <dt> <steps> [alpha] [ramp time] */
+    if (argc > 5 && strcmp(argv[1], "--transient") == 0) {
+        transient_options_t options = transient_default_options();
+        options.dt = atof(argv[4]);
+        options.steps = atoi(argv[5]);
+        if (argc > 6) {
+            options.alpha = atof(argv[6]);
+        }
+        if (argc > 7) {
+            options.ramp_time = atof(argv[7]);
+        }
+        err = transient_analysis(argv[2], argv[3], &options);
+        if (err != FEM_SUCCESS) {
+            error_print(err);
+            printf("\nAnalysis failed with error code: %d\n", err);
+            return EXIT_FAILURE;
+        }
+        printf("Program completed successfully.\n");
+        return EXIT_SUCCESS;
+    }
+    
+    /* Explicit dynamics: fem4c --explicit <input> <output> <end time> [dt] [hourglass] [ramp time] */
+    if (argc > 4 && strcmp(argv[1], "--explicit") == 0) {
+        explicit_options_t options = explicit_default_options();
+        options.end_time = atof(argv[4]);
+        if (argc > 5) {
+            options.dt = atof(argv[5]);
+        }
+        if (argc > 6) {
+            options.hourglass = atof(argv[6]);
+        }
+        if (argc > 7) {
+            options.ramp_time = atof(argv[7]);
+        }
+        err = explicit_analysis(argv[2], argv[3], &options);
+        if (err != FEM_SUCCESS) {
+            error_print(err);
+            printf("\nAnalysis failed with error code: %d\n", err);
+            return EXIT_FAILURE;
+        }
+        printf("Program completed successfully.\n");
+        return EXIT_SUCCESS;
+    }
+    
+    /* Frequency response: fem4c --harmonic <input> <output> <modes> <frequencies> [damping] [nodes] */
+    if (argc > 5 && strcmp(argv[1], "--harmonic") == 0) {
+        harmonic_options_t options = harmonic_default_options();
+        double *frequencies = NULL;
+        int *nodes = NULL;
+        options.modes = atoi(argv[4]);
+        err = harmonic_parse_frequencies(argv[5], &frequencies, &options.frequency_count);
+        if (err == FEM_SUCCESS && argc > 7) {
+            err = harmonic_parse_nodes(argv[7], &nodes, &options.output_node_count);
+        }
+        if (err == FEM_SUCCESS) {
+            if (argc > 6) {
+                options.damping_ratio = atof(argv[6]);
+            }
+            options.frequencies = frequencies;
+            options.output_nodes = nodes;
+            err = harmonic_analysis(argv[2], argv[3], &options);
+        }
+        fem_free(frequencies);
+        fem_free(nodes);
+        if (err != FEM_SUCCESS) {
+            error_print(err);
+            printf("\nAnalysis failed with error code: %d\n", err);
+            return EXIT_FAILURE;
+        }
+        printf("Program completed successfully.\n");
+        return EXIT_SUCCESS;
+    }
+    
     /* Parse command line arguments */
     if (argc > 1) {
         strncpy(g_input_filename, argv[1], MAX_FILENAME_LEN - 1);
@@ -159,7 +322,8 @@ int main(int argc, char *argv[])
         const char *force_parser = getenv("FEM4C_FORCE_PARSER");
         if ((force_parser && strcmp(force_parser, "1") == 0) ||
             argc >= 4 ||
-            looks_like_nastran_input(g_input_filename)) {
+            (looks_like_nastran_input(g_input_filename) &&
+             !nastran_has_constraint_cards(g_input_filename))) {
             needs_parser = 1;
         }
     }
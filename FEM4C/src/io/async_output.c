@@ -0,0 +1,269 @@
+/* FEM4C - Asynchronous result output implementation
+ * One background thread per output file plus an optional VTK geometry
+ * thread started ahead of the solve. The bookkeeping lives in the bound
+ * analysis context; writer threads inherit that context.
+ */
+
+#include "async_output.h"
+#include "output.h"
+#include "../common/constants.h"
+#include "../common/error.h"
+#include "../common/fem_context.h"
+#include "../common/fem_thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct async_output_state;
+
+typedef struct {
+    struct async_output_state *state;
+    async_output_kind_t kind;
+    char filename[MAX_FILENAME_LEN];
+    fem_thread_t thread;
+    int pending;                /* Submitted, status not yet collected */
+    int threaded;               /* Runs on its own thread (needs a join) */
+    fem_error_t status;
+} async_output_job_t;
+
+typedef struct {
+    char filename[MAX_FILENAME_LEN];
+    FILE *file;
+    fem_thread_t thread;
+    int running;
+    int claimed;                /* Joined by the VTK result job */
+    fem_error_t status;
+} async_output_geometry_t;
+
+/* Writer bookkeeping of one analysis context (fem_context_t.async_output) */
+struct async_output_state {
+    async_output_job_t jobs[ASYNC_OUTPUT_KIND_COUNT];
+    async_output_geometry_t geometry;
+};
+
+/* State of the bound context, created on first use */
+static struct async_output_state *async_output_state(void)
+{
+    if (g_fem_context->async_output == NULL) {
+        g_fem_context->async_output =
+            (struct async_output_state *)calloc(1, sizeof(struct async_output_state));
+    }
+    return g_fem_context->async_output;
+}
+
+static void *async_output_geometry_run(void *arg)
+{
+    async_output_geometry_t *geometry = (async_output_geometry_t *)arg;
+
+    geometry->file = fopen(geometry->filename, "w");
+    if (geometry->file == NULL) {
+        geometry->status = FEM_ERROR_FILE_WRITE;
+        return NULL;
+    }
+    geometry->status = output_write_vtk_geometry(geometry->file);
+    return NULL;
+}
+
+/* Append the result fields to the file the geometry thread started */
+static fem_error_t async_output_finish_vtk(async_output_geometry_t *geometry)
+{
+    fem_error_t err;
+
+    err = fem_thread_join(&geometry->thread, NULL);
+    geometry->running = 0;
+    if (err == FEM_SUCCESS) {
+        err = geometry->status;
+    }
+    if (err == FEM_SUCCESS) {
+        err = output_write_vtk_results(geometry->file);
+    }
+    if (geometry->file) {
+        fclose(geometry->file);
+        geometry->file = NULL;
+    }
+    return err;
+}
+
+static void *async_output_run(void *arg)
+{
+    async_output_job_t *job = (async_output_job_t *)arg;
+    async_output_geometry_t *geometry = &job->state->geometry;
+
+    switch (job->kind) {
+    case ASYNC_OUTPUT_DAT:
+        job->status = output_write_results(job->filename);
+        break;
+    case ASYNC_OUTPUT_CSV:
+        job->status = output_export_csv(job->filename);
+        break;
+    case ASYNC_OUTPUT_VTK:
+        if (geometry->claimed && strcmp(geometry->filename, job->filename) == 0) {
+            job->status = async_output_finish_vtk(geometry);
+        } else {
+            job->status = output_write_vtk_file(job->filename);
+        }
+        break;
+    case ASYNC_OUTPUT_F06:
+        job->status = output_write_nastran_f06_file(job->filename);
+        break;
+    default:
+        job->status = FEM_ERROR_INVALID_INPUT;
+        break;
+    }
+    return NULL;
+}
+
+/* Wait for a submitted job; returns 1 if it had a status to collect */
+static int async_output_wait(async_output_job_t *job)
+{
+    if (!job->pending) {
+        return 0;
+    }
+    if (job->threaded) {
+        fem_thread_join(&job->thread, NULL);
+        job->threaded = 0;
+    }
+    job->pending = 0;
+    return 1;
+}
+
+/* Join a geometry thread nobody claimed and drop its partial file */
+static void async_output_release_geometry(async_output_geometry_t *geometry)
+{
+    if (geometry->running && !geometry->claimed) {
+        fem_thread_join(&geometry->thread, NULL);
+    }
+    if (!geometry->claimed && geometry->file) {
+        fclose(geometry->file);
+    }
+    memset(geometry, 0, sizeof(*geometry));
+}
+
+static void async_output_report(const async_output_job_t *job)
+{
+    switch (job->kind) {
+    case ASYNC_OUTPUT_CSV:
+        printf("  Warning: CSV export failed (%s)\n", error_get_string(job->status));
+        break;
+    case ASYNC_OUTPUT_VTK:
+        printf("  Warning: VTK output failed, continuing...\n");
+        break;
+    case ASYNC_OUTPUT_F06:
+        printf("  Warning: F06 output failed, continuing...\n");
+        break;
+    default:
+        break;
+    }
+}
+
+fem_error_t async_output_begin_geometry(const char *vtk_filename)
+{
+    struct async_output_state *state = async_output_state();
+    async_output_geometry_t *geometry;
+    fem_error_t err;
+
+    if (vtk_filename == NULL) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Null VTK filename");
+    }
+    if (state == NULL) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate output writer state");
+    }
+    geometry = &state->geometry;
+
+    /* A VTK job may still be appending to the previous geometry file */
+    async_output_wait(&state->jobs[ASYNC_OUTPUT_VTK]);
+    async_output_release_geometry(geometry);
+
+    strncpy(geometry->filename, vtk_filename, MAX_FILENAME_LEN - 1);
+    geometry->filename[MAX_FILENAME_LEN - 1] = '\0';
+    err = fem_thread_create(&geometry->thread, async_output_geometry_run, geometry);
+    CHECK_ERROR(err);
+    geometry->running = 1;
+    return FEM_SUCCESS;
+}
+
+fem_error_t async_output_submit(async_output_kind_t kind, const char *filename)
+{
+    struct async_output_state *state;
+    async_output_job_t *job;
+
+    if ((int)kind < 0 || kind >= ASYNC_OUTPUT_KIND_COUNT || filename == NULL) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Invalid asynchronous output request");
+    }
+    state = async_output_state();
+    if (state == NULL) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate output writer state");
+    }
+
+    job = &state->jobs[kind];
+    async_output_wait(job);
+
+    job->state = state;
+    job->kind = kind;
+    job->status = FEM_SUCCESS;
+    strncpy(job->filename, filename, MAX_FILENAME_LEN - 1);
+    job->filename[MAX_FILENAME_LEN - 1] = '\0';
+
+    if (kind == ASYNC_OUTPUT_VTK && state->geometry.running &&
+        strcmp(state->geometry.filename, job->filename) == 0) {
+        state->geometry.claimed = 1;
+    }
+
+    job->pending = 1;
+    job->threaded = fem_thread_create(&job->thread, async_output_run, job) == FEM_SUCCESS;
+    if (!job->threaded) {
+        /* No thread available: write synchronously */
+        async_output_run(job);
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t async_output_join(void)
+{
+    struct async_output_state *state = g_fem_context->async_output;
+    fem_error_t result = FEM_SUCCESS;
+    char failed_file[MAX_FILENAME_LEN];
+
+    if (state == NULL) {
+        return FEM_SUCCESS;
+    }
+
+    for (int kind = 0; kind < ASYNC_OUTPUT_KIND_COUNT; ++kind) {
+        async_output_job_t *job = &state->jobs[kind];
+        if (!async_output_wait(job)) {
+            continue;
+        }
+        if (job->status == FEM_SUCCESS) {
+            continue;
+        }
+        if (job->kind == ASYNC_OUTPUT_DAT) {
+            result = job->status;
+            strcpy(failed_file, job->filename);
+        } else {
+            async_output_report(job);
+        }
+    }
+    async_output_release_geometry(&state->geometry);
+    free(state);
+    g_fem_context->async_output = NULL;
+
+    if (result != FEM_SUCCESS) {
+        return error_set(result, "Failed to write results: %s", failed_file);
+    }
+    return FEM_SUCCESS;
+}
+
+void async_output_cancel(void)
+{
+    struct async_output_state *state = g_fem_context->async_output;
+
+    if (state == NULL) {
+        return;
+    }
+    for (int kind = 0; kind < ASYNC_OUTPUT_KIND_COUNT; ++kind) {
+        async_output_wait(&state->jobs[kind]);
+    }
+    async_output_release_geometry(&state->geometry);
+    free(state);
+    g_fem_context->async_output = NULL;
+}
@@ -0,0 +1,38 @@
+#ifndef ASYNC_OUTPUT_H
+#define ASYNC_OUTPUT_H
+
+/* FEM4C - Asynchronous result output
+ * Runs the .dat, .csv, .vtk and .f06 writers on background threads so file
+ * I/O overlaps with the rest of the analysis. The VTK geometry can be
+ * started before the solve; the VTK result job appends to that file.
+ *
+ * Writers read the model and result arrays directly. Those arrays are not
+ * modified after the solve, and async_output_join() must be called before
+ * anything frees or rewrites them (static_analysis_finalize does so).
+ */
+
+#include "../common/types.h"
+
+typedef enum {
+    ASYNC_OUTPUT_DAT = 0,       /* Native results (output_write_results) */
+    ASYNC_OUTPUT_CSV,           /* output_export_csv */
+    ASYNC_OUTPUT_VTK,           /* output_write_vtk_file / geometry + results */
+    ASYNC_OUTPUT_F06,           /* output_write_nastran_f06_file */
+    ASYNC_OUTPUT_KIND_COUNT
+} async_output_kind_t;
+
+/* Start writing VTK header, points and cells; only mesh data is read */
+fem_error_t async_output_begin_geometry(const char *vtk_filename);
+
+/* Launch the writer for one output file. A VTK job whose filename matches
+ * the started geometry appends the result fields to that file. */
+fem_error_t async_output_submit(async_output_kind_t kind, const char *filename);
+
+/* Wait for every writer. Failures of the optional formats are reported as
+ * warnings; the return value is the .dat writer's status. */
+fem_error_t async_output_join(void);
+
+/* Wait for every writer and discard their status (error paths) */
+void async_output_cancel(void);
+
+#endif /* ASYNC_OUTPUT_H */
@@ -6,25 +6,25 @@
 #include "../common/constants.h"
 #include "../common/globals.h"
 #include "../common/error.h"
+#include "../solver/pipeline.h"
+#include "../solver/mpc.h"
+#include "../elements/solid3d/solid3d_element.h"
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <limits.h>
 #include <sys/stat.h>
 
-#define MAX_NASTRAN_PROPERTIES 512
-
+/* Bulk card counts and ID ranges gathered before the model is allocated */
 typedef struct {
-    int pid;
-    int mid;
-    double thickness;
-    int material_index;
-} nastran_pshell_t;
-
-static nastran_pshell_t g_nastran_pshells[MAX_NASTRAN_PROPERTIES];
-static int g_nastran_pshell_count = 0;
-static int *g_nastran_element_property = NULL;
-static int g_nastran_element_property_capacity = 0;
+    int grids;
+    int elements;
+    int materials;
+    int properties;
+    int max_grid_id;
+    int max_element_id;
+    int max_material_id;
+} nastran_card_counts_t;
 
 static void input_nastran_normalize_line(char *line);
 static void input_nastran_trim(char *text);
@@ -34,6 +34,8 @@ static fem_error_t input_parse_nastran_grid_short(input_control_t *input, const
 static fem_error_t input_nastran_finalize_properties(void);
 static fem_error_t input_nastran_find_pshell_material(int pid, int *material_index);
 static fem_error_t input_ensure_nastran_element_capacity(int required);
+static fem_error_t input_nastran_prescan(input_control_t *input, nastran_card_counts_t *counts);
+static fem_error_t input_nastran_reserve_model(const nastran_card_counts_t *counts);
 static int input_parser_is_directory(const char *path);
 static int input_parser_has_mesh_root(const char *path);
 static fem_error_t input_read_parser_mesh(const char *mesh_path);
@@ -42,6 +44,19 @@ static fem_error_t input_read_parser_boundary(const char *boundary_path);
 static void input_parser_trim(char *text);
 static int input_parser_is_label(const char *line, const char *label);
 static int input_parser_split_tokens(const char *line, char tokens[][64], int max_tokens);
+static char *input_next_token(char **cursor);
+static fem_error_t input_set_problem_dimension(void);
+static fem_error_t input_parse_nastran_solid(input_control_t *input, const char *line,
+                                             const char *card);
+static int input_nastran_next_continuation(input_control_t *input, char *cont_line, int size);
+static fem_error_t input_nastran_read_card(input_control_t *input, const char *line,
+                                           char (**fields)[9], int *field_count);
+static fem_error_t input_parse_nastran_rbe2(input_control_t *input, const char *line,
+                                            mpc_equations_t *equations);
+static fem_error_t input_parse_nastran_rbe3(input_control_t *input, const char *line,
+                                            mpc_equations_t *equations);
+static fem_error_t input_parse_nastran_mpc(input_control_t *input, const char *line,
+                                           mpc_equations_t *equations);
 
 /* Utility helpers */
 static int input_is_blank_or_comment(const char *line)
@@ -103,12 +118,14 @@ static fem_error_t input_validate_map_node(int node_id, int node_index)
                          node_index, g_node_capacity);
     }
 
-    if (g_node_id_to_index[node_id] != -1 && g_node_id_to_index[node_id] != node_index) {
+    int existing = id_map_lookup(&g_node_id_map, node_id);
+    if (existing != -1 && existing != node_index) {
         return error_set(FEM_ERROR_INVALID_NODE,
                          "Duplicate definition for node ID %d", node_id);
     }
 
-    g_node_id_to_index[node_id] = node_index;
+    err = id_map_insert(&g_node_id_map, node_id, node_index, g_node_capacity);
+    CHECK_ERROR(err);
     if (g_node_ids) {
         g_node_ids[node_index] = node_id;
     }
@@ -121,11 +138,12 @@ static fem_error_t input_get_node_index(int node_id, int *node_index)
         return error_set(FEM_ERROR_INVALID_NODE,
                          "Node ID %d referenced outside supported range", node_id);
     }
-    if (node_id >= g_node_id_capacity || g_node_id_to_index[node_id] < 0) {
+    int index = id_map_lookup(&g_node_id_map, node_id);
+    if (index < 0) {
         return error_set(FEM_ERROR_INVALID_NODE,
                          "Node ID %d referenced before definition", node_id);
     }
-    *node_index = g_node_id_to_index[node_id];
+    *node_index = index;
     return FEM_SUCCESS;
 }
 
@@ -151,13 +169,14 @@ static fem_error_t input_validate_map_element(int element_id, int element_index)
                          element_index, g_element_capacity);
     }
 
-    if (g_element_id_to_index[element_id] != -1 &&
-        g_element_id_to_index[element_id] != element_index) {
+    int existing = id_map_lookup(&g_element_id_map, element_id);
+    if (existing != -1 && existing != element_index) {
         return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
                          "Duplicate definition for element ID %d", element_id);
     }
 
-    g_element_id_to_index[element_id] = element_index;
+    err = id_map_insert(&g_element_id_map, element_id, element_index, g_element_capacity);
+    CHECK_ERROR(err);
     if (g_element_ids) {
         g_element_ids[element_index] = element_id;
     }
@@ -186,13 +205,14 @@ static fem_error_t input_validate_map_material(int material_id, int material_ind
                          material_index, g_material_capacity);
     }
 
-    if (g_material_id_to_index[material_id] != -1 &&
-        g_material_id_to_index[material_id] != material_index) {
+    int existing = id_map_lookup(&g_material_id_map, material_id);
+    if (existing != -1 && existing != material_index) {
         return error_set(FEM_ERROR_INVALID_MATERIAL,
                          "Duplicate definition for material ID %d", material_id);
     }
 
-    g_material_id_to_index[material_id] = material_index;
+    err = id_map_insert(&g_material_id_map, material_id, material_index, g_material_capacity);
+    CHECK_ERROR(err);
     if (g_material_ids) {
         g_material_ids[material_index] = material_id;
     }
@@ -218,7 +238,8 @@ static fem_error_t input_ensure_nastran_element_capacity(int required)
         new_capacity = required;
     }
 
-    int *tmp = realloc(g_nastran_element_property, (size_t)new_capacity * sizeof(int));
+    int *tmp = fem_realloc(g_nastran_element_property, (size_t)new_capacity * sizeof(int),
+                           FEM_MEMORY_MESH);
     if (!tmp) {
         return error_set(FEM_ERROR_MEMORY_ALLOCATION,
                          "Failed to resize Nastran element property array");
@@ -285,7 +306,124 @@ static int input_nastran_line_has_continuation(const char *line)
     return 0;
 }
 
-/* Main data reading function */
+/* ID in the first data field (columns 9..8+width); 0 if absent */
+static int input_nastran_card_id(const char *line, int width)
+{
+    char field[17];
+    int value = 0;
+    size_t len = strlen(line);
+
+    if (len <= 8) return 0;
+    size_t n = (len - 8 < (size_t)width) ? len - 8 : (size_t)width;
+    memcpy(field, line + 8, n);
+    field[n] = '\0';
+    input_nastran_trim(field);
+    if (input_nastran_get_integer(field, &value) != FEM_SUCCESS) {
+        return 0;
+    }
+    return value;
+}
+
+/* Count bulk cards and ID ranges from the current position up to ENDDATA,
+ * then rewind so the real parse starts at the same place. */
+static fem_error_t input_nastran_prescan(input_control_t *input, nastran_card_counts_t *counts)
+{
+    char line[256];
+    long start = ftell(input->file_ptr);
+
+    memset(counts, 0, sizeof(*counts));
+    if (start < 0) {
+        return error_set(FEM_ERROR_FILE_READ, "Cannot determine position in %s", input->filename);
+    }
+
+    while (fgets(line, sizeof(line), input->file_ptr)) {
+        input_nastran_normalize_line(line);
+
+        if (line[0] == '$' || line[0] == '\0') {
+            continue;
+        }
+        if (strncmp(line, "ENDDATA", 7) == 0) {
+            break;
+        }
+
+        if (strncmp(line, "GRID", 4) == 0) {
+            int id = input_nastran_card_id(line, strncmp(line, "GRID*", 5) == 0 ? 16 : 8);
+            counts->grids++;
+            if (id > counts->max_grid_id) counts->max_grid_id = id;
+        } else if (strncmp(line, "CTRIA3", 6) == 0 ||
+                   strncmp(line, "CQUAD4", 6) == 0 ||
+                   strncmp(line, "CTRIA6", 6) == 0 ||
+                   strncmp(line, "CTETRA", 6) == 0 ||
+                   strncmp(line, "CHEXA", 5) == 0) {
+            int id = input_nastran_card_id(line, 8);
+            counts->elements++;
+            if (id > counts->max_element_id) counts->max_element_id = id;
+        } else if (strncmp(line, "MAT1", 4) == 0) {
+            int id = input_nastran_card_id(line, 8);
+            counts->materials++;
+            if (id > counts->max_material_id) counts->max_material_id = id;
+        } else if (strncmp(line, "PSHELL", 6) == 0 ||
+                   strncmp(line, "PSOLID", 6) == 0) {
+            counts->properties++;
+        }
+    }
+
+    if (fseek(input->file_ptr, start, SEEK_SET) != 0) {
+        return error_set(FEM_ERROR_FILE_READ, "Cannot rewind %s after pre-scan", input->filename);
+    }
+    return FEM_SUCCESS;
+}
+
+/* Size every model array once from the pre-scan counts. Each PSHELL can
+ * add a derived material entry in input_nastran_finalize_properties. */
+static fem_error_t input_nastran_reserve_model(const nastran_card_counts_t *counts)
+{
+    fem_error_t err;
+
+    err = globals_reserve_model(counts->grids, counts->elements,
+                                counts->materials + counts->properties);
+    CHECK_ERROR(err);
+    err = input_ensure_nastran_element_capacity(counts->elements);
+    CHECK_ERROR(err);
+
+    err = globals_reserve_node_ids(counts->max_grid_id + 1);
+    CHECK_ERROR(err);
+    err = globals_reserve_element_ids(counts->max_element_id + 1);
+    CHECK_ERROR(err);
+    err = globals_reserve_material_ids(counts->max_material_id + 1);
+    CHECK_ERROR(err);
+    return FEM_SUCCESS;
+}
+
+/* Spatial dimension and DOF count from the element types: plane models
+ * carry two DOF per node, solids three. Plane and solid elements cannot
+ * be mixed. */
+static fem_error_t input_set_problem_dimension(void)
+{
+    int solids = 0;
+
+    for (int e = 0; e < g_num_elements; e++) {
+        if (solid3d_is_solid_type(g_element_type[e])) {
+            solids++;
+        }
+    }
+    if (solids > 0 && solids < g_num_elements) {
+        return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                         "Model mixes %d solid and %d plane elements",
+                         solids, g_num_elements - solids);
+    }
+
+    g_analysis.spatial_dimension = (g_num_elements > 0 && solids == g_num_elements) ? 3 : 2;
+    if (g_analysis.spatial_dimension == 3) {
+        for (int m = 0; m < g_num_materials; m++) {
+            g_material_type[m] = MATERIAL_ISOTROPIC;
+        }
+    }
+    g_total_dof = g_num_nodes * g_dof_per_node;
+    return FEM_SUCCESS;
+}
+
+/* Main data reading function */
 fem_error_t input_read_data(const char *filename)
 {
     input_control_t input;
@@ -358,7 +496,8 @@ fem_error_t input_read_data(const char *filename)
     g_analysis.num_nodes = g_num_nodes;
     g_analysis.num_elements = g_num_elements;
     g_analysis.num_materials = g_num_materials;
-    g_total_dof = g_num_nodes * 2; /* 2D analysis for T6 */
+    err = input_set_problem_dimension();
+    CHECK_ERROR(err);
     
     return FEM_SUCCESS;
 }
@@ -413,6 +552,8 @@ fem_error_t input_detect_format(input_control_t *input)
             strncmp(line, "CTRIA3", 6) == 0 ||
             strncmp(line, "CQUAD4", 6) == 0 ||
             strncmp(line, "CTRIA6", 6) == 0 ||
+            strncmp(line, "CTETRA", 6) == 0 ||
+            strncmp(line, "CHEXA", 5) == 0 ||
             strncmp(line, "SOL", 3) == 0 ||
             strncmp(line, "ID", 2) == 0 ||
             strncmp(line, "MAT1", 4) == 0) {
@@ -456,17 +597,23 @@ fem_error_t input_read_header(input_control_t *input)
     err = input_read_line(input);
     CHECK_ERROR(err);
     
-    if (sscanf(input->current_line, "%d %d", &g_num_nodes, &g_num_elements) != 2) {
+    /* nnode nelem [ndim]; ndim 3 selects solid elements */
+    int dimension = 2;
+    if (sscanf(input->current_line, "%d %d %d", &g_num_nodes, &g_num_elements, &dimension) < 2) {
         return error_set(FEM_ERROR_FILE_READ, 
                         "Error reading problem size at line %d", input->line_number);
     }
+    if (dimension != 2 && dimension != 3) {
+        return error_set(FEM_ERROR_FILE_READ,
+                         "Unsupported spatial dimension %d at line %d",
+                         dimension, input->line_number);
+    }
+    g_analysis.spatial_dimension = dimension;
     
     CHECK_POSITIVE(g_num_nodes, "Number of nodes");
     CHECK_POSITIVE(g_num_elements, "Number of elements");
 
-    err = globals_reserve_nodes(g_num_nodes);
-    CHECK_ERROR(err);
-    err = globals_reserve_elements(g_num_elements);
+    err = globals_reserve_model(g_num_nodes, g_num_elements, 1);
     CHECK_ERROR(err);
     err = globals_reserve_node_ids(g_num_nodes + 1);
     CHECK_ERROR(err);
@@ -493,8 +640,9 @@ fem_error_t input_read_nodes(input_control_t *input)
         err = input_read_line(input);
         CHECK_ERROR(err);
 
-        double x, y;
-        if (sscanf(input->current_line, "%d %lf %lf", &node_id, &x, &y) != 3) {
+        double x, y, z = 0.0;
+        int expected = g_analysis.spatial_dimension + 1;
+        if (sscanf(input->current_line, "%d %lf %lf %lf", &node_id, &x, &y, &z) < expected) {
             return error_set(FEM_ERROR_FILE_READ,
                              "Error reading node %d at line %d", i + 1, input->line_number);
         }
@@ -502,7 +650,7 @@ fem_error_t input_read_nodes(input_control_t *input)
         globals_initialize_node_entry(i);
         g_node_coords[i][0] = x;
         g_node_coords[i][1] = y;
-        g_node_coords[i][2] = 0.0; /* 2D */
+        g_node_coords[i][2] = (expected == 4) ? z : 0.0; /* 0 for 2D */
 
         err = input_validate_map_node(node_id, i);
         CHECK_ERROR(err);
@@ -511,6 +659,24 @@ fem_error_t input_read_nodes(input_control_t *input)
     return FEM_SUCCESS;
 }
 
+/* Re-entrant strtok(" \t"): return the next token at *cursor and advance it */
+static char *input_next_token(char **cursor)
+{
+    char *token = *cursor + strspn(*cursor, " \t");
+    char *end;
+
+    if (*token == '\0') {
+        *cursor = token;
+        return NULL;
+    }
+    end = token + strcspn(token, " \t");
+    if (*end != '\0') {
+        *end++ = '\0';
+    }
+    *cursor = end;
+    return token;
+}
+
 /* Read element connectivity */
 fem_error_t input_read_elements(input_control_t *input)
 {
@@ -532,12 +698,13 @@ fem_error_t input_read_elements(input_control_t *input)
         char *token;
         char line_copy[1024];
         strcpy(line_copy, input->current_line);
+        char *cursor = line_copy;
 
         /* Count tokens to determine element type */
         int token_count = 0;
         int nodes[MAX_NODES_PER_ELEMENT];
 
-        token = strtok(line_copy, " \t");
+        token = input_next_token(&cursor);
         if (token == NULL) {
             return error_set(FEM_ERROR_FILE_READ,
                              "Missing element identifier at line %d", input->line_number);
@@ -549,7 +716,7 @@ fem_error_t input_read_elements(input_control_t *input)
         CHECK_ERROR(err);
 
         /* Read node IDs */
-        while ((token = strtok(NULL, " \t")) && token_count < MAX_NODES_PER_ELEMENT) {
+        while ((token = input_next_token(&cursor)) && token_count < MAX_NODES_PER_ELEMENT) {
             nodes[token_count] = atoi(token);
             token_count++;
         }
@@ -557,27 +724,47 @@ fem_error_t input_read_elements(input_control_t *input)
         /* Determine element type based on node count */
         int element_type;
         int nodes_per_element;
-        switch (token_count) {
-            case 3:
-                element_type = ELEMENT_T3;
-                nodes_per_element = 3;
-                break;
-            case 4:
-                element_type = ELEMENT_Q4;
-                nodes_per_element = 4;
-                break;
-            case 6:
-                element_type = ELEMENT_T6;
-                nodes_per_element = 6;
-                break;
-            case 9:
-                element_type = ELEMENT_Q9;
-                nodes_per_element = 9;
-                break;
-            default:
-                return error_set(FEM_ERROR_FILE_READ,
-                                "Unsupported element type with %d nodes at line %d",
-                                token_count, input->line_number);
+        if (g_analysis.spatial_dimension == 3) {
+            /* Solids: 4-node and 10-node tetrahedra, 8-node hexahedra */
+            switch (token_count) {
+                case 4:
+                    element_type = ELEMENT_T4;
+                    break;
+                case 8:
+                    element_type = ELEMENT_H8;
+                    break;
+                case 10:
+                    element_type = ELEMENT_T10;
+                    break;
+                default:
+                    return error_set(FEM_ERROR_FILE_READ,
+                                     "Unsupported solid element with %d nodes at line %d",
+                                     token_count, input->line_number);
+            }
+            nodes_per_element = token_count;
+        } else {
+            switch (token_count) {
+                case 3:
+                    element_type = ELEMENT_T3;
+                    nodes_per_element = 3;
+                    break;
+                case 4:
+                    element_type = ELEMENT_Q4;
+                    nodes_per_element = 4;
+                    break;
+                case 6:
+                    element_type = ELEMENT_T6;
+                    nodes_per_element = 6;
+                    break;
+                case 9:
+                    element_type = ELEMENT_Q9;
+                    nodes_per_element = 9;
+                    break;
+                default:
+                    return error_set(FEM_ERROR_FILE_READ,
+                                    "Unsupported element type with %d nodes at line %d",
+                                    token_count, input->line_number);
+            }
         }
 
         /* Store element data */
@@ -596,7 +783,12 @@ fem_error_t input_read_elements(input_control_t *input)
         for (int j = nodes_per_element; j < MAX_NODES_PER_ELEMENT; j++) {
             g_element_nodes[i][j] = -1;
         }
+
+        if ((i + 1) % PIPELINE_BLOCK_ELEMENTS == 0) {
+            pipeline_publish_elements(i + 1);
+        }
     }
+    pipeline_publish_elements(g_num_elements);
     
     return FEM_SUCCESS;
 }
@@ -616,29 +808,32 @@ fem_error_t input_read_materials(input_control_t *input)
     err = input_skip_blank_lines(input);
     CHECK_ERROR(err);
 
-    /* Read material properties (E, nu) */
+    /* Read material properties (E, nu [, density]) */
     err = input_read_line(input);
     CHECK_ERROR(err);
 
-    if (sscanf(input->current_line, "%lf %lf",
-               &g_material_props[0][0], &g_material_props[0][1]) != 2) {
+    double density = 1.0;
+    if (sscanf(input->current_line, "%lf %lf %lf",
+               &g_material_props[0][0], &g_material_props[0][1], &density) < 2) {
         return error_set(FEM_ERROR_FILE_READ,
                         "Error reading material properties at line %d", input->line_number);
     }
 
     /* Set default values */
     g_material_props[0][2] = 1.0;    /* thickness */
-    g_material_props[0][3] = 1.0;    /* density */
+    g_material_props[0][3] = density;
     g_material_type[0] = MATERIAL_PLANE_STRESS;
     g_num_materials = 1;
     err = input_validate_map_material(1, 0); /* Native format: assign default material ID = 1 */
     CHECK_ERROR(err);
 
     CHECK_POSITIVE(g_material_props[0][0], "Young's modulus");
+    CHECK_POSITIVE(g_material_props[0][3], "Density");
     if (g_material_props[0][1] >= 0.5) {
         return error_set(FEM_ERROR_INVALID_MATERIAL, "Poisson's ratio must be < 0.5");
     }
 
+    pipeline_publish_materials();
     return FEM_SUCCESS;
 }
 
@@ -681,6 +876,10 @@ fem_error_t input_read_boundary_conditions(input_control_t *input)
             g_node_bc_flags[node_index][1] = bc_flags[1];
             if (bc_flags[0]) g_node_displ[node_index][0] = prescribed_values[0];
             if (bc_flags[1]) g_node_displ[node_index][1] = prescribed_values[1];
+            if (g_analysis.spatial_dimension == 3) {
+                g_node_bc_flags[node_index][2] = bc_flags[2];
+                if (bc_flags[2]) g_node_displ[node_index][2] = prescribed_values[2];
+            }
         }
     }
     
@@ -970,6 +1169,13 @@ fem_error_t input_read_nastran_bulk(input_control_t *input)
         return error_set(FEM_ERROR_FILE_READ, "BEGIN BULK not found in Nastran file");
     }
 
+    /* Pre-scan so the model is allocated once at its final size */
+    nastran_card_counts_t counts;
+    err = input_nastran_prescan(input, &counts);
+    CHECK_ERROR(err);
+    printf("  Pre-scan: %d GRID, %d elements, %d MAT1, %d PSHELL/PSOLID\n",
+           counts.grids, counts.elements, counts.materials, counts.properties);
+
     /* Initialize counters */
     g_num_nodes = 0;
     g_num_elements = 0;
@@ -977,11 +1183,15 @@ fem_error_t input_read_nastran_bulk(input_control_t *input)
     g_nastran_pshell_count = 0;
     err = input_ensure_nastran_element_capacity(INITIAL_ELEMENT_CAPACITY);
     CHECK_ERROR(err);
+    err = input_nastran_reserve_model(&counts);
+    CHECK_ERROR(err);
     for (int i = 0; i < g_nastran_element_property_capacity; ++i) {
         g_nastran_element_property[i] = -1;
     }
 
-    /* Parse bulk data */
+    /* Parse bulk data; constraint equations are resolved once the grids are known */
+    mpc_equations_t equations;
+    mpc_equations_init(&equations);
     while (fgets(line, sizeof(line), input->file_ptr)) {
         input->line_number++;
         input_nastran_normalize_line(line);
@@ -1000,36 +1210,59 @@ fem_error_t input_read_nastran_bulk(input_control_t *input)
         /* Parse different card types */
         if (strncmp(line, "GRID", 4) == 0) {
             err = input_parse_nastran_grid(input, line);
-            CHECK_ERROR(err);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
         } else if (strncmp(line, "CTRIA3", 6) == 0) {
             err = input_parse_nastran_ctria3(input, line);
-            CHECK_ERROR(err);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
         } else if (strncmp(line, "CQUAD4", 6) == 0) {
             err = input_parse_nastran_cquad4(input, line);
-            CHECK_ERROR(err);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
         } else if (strncmp(line, "CTRIA6", 6) == 0) {
             err = input_parse_nastran_ctria6(input, line);
-            CHECK_ERROR(err);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
+        } else if (strncmp(line, "CTETRA", 6) == 0) {
+            err = input_parse_nastran_ctetra(input, line);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
+        } else if (strncmp(line, "CHEXA", 5) == 0) {
+            err = input_parse_nastran_chexa(input, line);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
         } else if (strncmp(line, "MAT1", 4) == 0) {
             err = input_parse_nastran_mat1(input, line);
-            CHECK_ERROR(err);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
         } else if (strncmp(line, "PSHELL", 6) == 0) {
             err = input_parse_nastran_pshell(input, line);
-            CHECK_ERROR(err);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
+        } else if (strncmp(line, "PSOLID", 6) == 0) {
+            err = input_parse_nastran_psolid(input, line);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
         } else if (strncmp(line, "SPC", 3) == 0) {
             err = input_parse_nastran_spc(input, line);
-            CHECK_ERROR(err);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
         } else if (strncmp(line, "FORCE", 5) == 0) {
             err = input_parse_nastran_force(input, line);
-            CHECK_ERROR(err);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
+        } else if (strncmp(line, "RBE2", 4) == 0) {
+            err = input_parse_nastran_rbe2(input, line, &equations);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
+        } else if (strncmp(line, "RBE3", 4) == 0) {
+            err = input_parse_nastran_rbe3(input, line, &equations);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
+        } else if (strncmp(line, "MPC", 3) == 0 && strncmp(line, "MPCADD", 6) != 0) {
+            err = input_parse_nastran_mpc(input, line, &equations);
+            CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
         }
     }
 
     err = input_nastran_finalize_properties();
-    CHECK_ERROR(err);
+    CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
 
     /* Set total DOF */
-    g_total_dof = g_num_nodes * 2; /* 2D analysis */
+    err = input_set_problem_dimension();
+    CHECK_ERROR_CLEANUP(err, mpc_equations_free(&equations));
+
+    err = mpc_build(&equations);
+    mpc_equations_free(&equations);
+    CHECK_ERROR(err);
 
     printf("  Nastran bulk data parsing complete:\n");
     printf("    Nodes: %d\n", g_num_nodes);
@@ -1144,12 +1377,10 @@ static fem_error_t input_read_parser_mesh(const char *mesh_path)
         return error_set(FEM_ERROR_INVALID_INPUT, "Invalid node count in %s", mesh_path);
     }
 
-    err = globals_reserve_nodes(declared_nodes);
+    err = globals_reserve_model(declared_nodes, declared_elements > 0 ? declared_elements : 1, 1);
     CHECK_ERROR_CLEANUP(err, fclose(fp));
     err = globals_reserve_node_ids(declared_nodes + 1);
     CHECK_ERROR_CLEANUP(err, fclose(fp));
-    err = globals_reserve_elements(declared_elements > 0 ? declared_elements : 1);
-    CHECK_ERROR_CLEANUP(err, fclose(fp));
     err = globals_reserve_element_ids(declared_elements + 1);
     CHECK_ERROR_CLEANUP(err, fclose(fp));
 
@@ -1221,6 +1452,11 @@ static fem_error_t input_read_parser_mesh(const char *mesh_path)
                              "Unsupported element node count %d in %s", node_count, mesh_path);
         }
 
+        /* More elements than declared: the arrays move, so stop the
+         * pipeline (its worker reads them) and read on sequentially */
+        if (g_num_elements >= g_element_capacity) {
+            pipeline_cancel();
+        }
         err = globals_reserve_elements(g_num_elements + 1);
         CHECK_ERROR_CLEANUP(err, fclose(fp));
         globals_initialize_element_entry(g_num_elements);
@@ -1240,7 +1476,12 @@ static fem_error_t input_read_parser_mesh(const char *mesh_path)
         g_element_type[g_num_elements] = element_type;
         g_element_material[g_num_elements] = 0;
         g_num_elements++;
+
+        if (g_num_elements % PIPELINE_BLOCK_ELEMENTS == 0) {
+            pipeline_publish_elements(g_num_elements);
+        }
     }
+    pipeline_publish_elements(g_num_elements);
 
     fclose(fp);
     return FEM_SUCCESS;
@@ -1411,17 +1652,27 @@ fem_error_t input_read_parser_package(const char *directory)
         return error_set(FEM_ERROR_FILE_NOT_FOUND, "mesh/mesh.dat not found under %s", directory);
     }
 
-    err = input_read_parser_mesh(mesh_path);
-    CHECK_ERROR(err);
-    err = input_read_parser_material(material_path);
-    CHECK_ERROR(err);
+    if (pipeline_active()) {
+        /* Material first, so element matrices overlap the mesh parsing */
+        err = input_read_parser_material(material_path);
+        CHECK_ERROR(err);
+        pipeline_publish_materials();
+        err = input_read_parser_mesh(mesh_path);
+        CHECK_ERROR(err);
+    } else {
+        err = input_read_parser_mesh(mesh_path);
+        CHECK_ERROR(err);
+        err = input_read_parser_material(material_path);
+        CHECK_ERROR(err);
+    }
     err = input_read_parser_boundary(boundary_path);
     CHECK_ERROR(err);
 
     g_analysis.num_nodes = g_num_nodes;
     g_analysis.num_elements = g_num_elements;
     g_analysis.num_materials = g_num_materials;
-    g_total_dof = g_num_nodes * 2;
+    err = input_set_problem_dimension();
+    CHECK_ERROR(err);
     snprintf(g_analysis.title, sizeof(g_analysis.title), "Parser package: %s", directory);
     return FEM_SUCCESS;
 }
@@ -1780,6 +2031,171 @@ fem_error_t input_parse_nastran_ctria6(input_control_t *input, const char *line)
     return FEM_SUCCESS;
 }
 
+/* Read the next line if it continues the current card (marked by '+' or
+ * '*' or a blank first field); otherwise leave the file where it was */
+static int input_nastran_next_continuation(input_control_t *input, char *cont_line, int size)
+{
+    long pos = ftell(input->file_ptr);
+
+    if (!fgets(cont_line, size, input->file_ptr)) {
+        return 0;
+    }
+    input_nastran_normalize_line(cont_line);
+    if (!(cont_line[0] == '+' || cont_line[0] == '*' ||
+          (cont_line[0] == ' ' && strspn(cont_line, " ") >= 8 && cont_line[8] != '\0'))) {
+        fseek(input->file_ptr, pos, SEEK_SET);
+        return 0;
+    }
+    input->line_number++;
+    return 1;
+}
+
+/* Solid element card: G1-G6 on the first line, the rest on continuation
+ * lines (marked by '+' or '*' or a blank first field). The grid count
+ * selects the type: CTETRA 4 (T4) or 10 (T10), CHEXA 8 (H8). */
+static fem_error_t input_parse_nastran_solid(input_control_t *input, const char *line,
+                                             const char *card)
+{
+    char fields[10][9];
+    char cont_line[256];
+    int nodes[MAX_NODES_PER_ELEMENT];
+    int eid = 0;
+    int pid = 0;
+    int count = 0;
+    int element_type;
+    fem_error_t err;
+
+    memset(fields, 0, sizeof(fields));
+    err = input_nastran_parse_fixed_format(line, fields, 10);
+    CHECK_ERROR(err);
+
+    err = input_nastran_get_integer(fields[1], &eid);
+    CHECK_ERROR(err);
+    err = input_nastran_get_integer(fields[2], &pid);
+    if (err != FEM_SUCCESS) pid = 0;
+
+    for (int f = 3; f <= 8 && count < MAX_NODES_PER_ELEMENT; f++) {
+        input_nastran_trim(fields[f]);
+        if (fields[f][0] == '\0') {
+            continue;
+        }
+        err = input_nastran_get_integer(fields[f], &nodes[count]);
+        if (err != FEM_SUCCESS) {
+            return error_set(FEM_ERROR_FILE_READ, "Invalid grid ID '%s' in %s %d at line %d",
+                             fields[f], card, eid, input->line_number);
+        }
+        count++;
+    }
+
+    while (input_nastran_next_continuation(input, cont_line, sizeof(cont_line))) {
+        /* Short continuation lines leave the trailing fields untouched */
+        memset(fields, 0, sizeof(fields));
+        err = input_nastran_parse_fixed_format(cont_line, fields, 10);
+        CHECK_ERROR(err);
+        for (int f = 1; f <= 8; f++) {
+            input_nastran_trim(fields[f]);
+            if (fields[f][0] == '\0') {
+                continue;
+            }
+            if (count >= MAX_NODES_PER_ELEMENT) {
+                return error_set(FEM_ERROR_FILE_READ, "%s %d has more than %d grids at line %d",
+                                 card, eid, MAX_NODES_PER_ELEMENT, input->line_number);
+            }
+            err = input_nastran_get_integer(fields[f], &nodes[count]);
+            if (err != FEM_SUCCESS) {
+                return error_set(FEM_ERROR_FILE_READ, "Invalid grid ID '%s' in %s %d at line %d",
+                                 fields[f], card, eid, input->line_number);
+            }
+            count++;
+        }
+    }
+
+    if (strcmp(card, "CHEXA") == 0) {
+        element_type = (count == 8) ? ELEMENT_H8 : -1;
+    } else {
+        element_type = (count == 4) ? ELEMENT_T4 : (count == 10) ? ELEMENT_T10 : -1;
+    }
+    if (element_type < 0) {
+        return error_set(FEM_ERROR_FILE_READ,
+                         "%s %d has %d grids; CTETRA takes 4 or 10, CHEXA 8 (line %d)",
+                         card, eid, count, input->line_number);
+    }
+
+    err = globals_reserve_elements(g_num_elements + 1);
+    CHECK_ERROR(err);
+    err = input_ensure_nastran_element_capacity(g_num_elements + 1);
+    CHECK_ERROR(err);
+
+    int elem_index = g_num_elements;
+    globals_initialize_element_entry(elem_index);
+    err = input_validate_map_element(eid, elem_index);
+    CHECK_ERROR(err);
+
+    for (int i = 0; i < count; i++) {
+        err = input_get_node_index(nodes[i], &g_element_nodes[elem_index][i]);
+        CHECK_ERROR(err);
+    }
+    for (int i = count; i < MAX_NODES_PER_ELEMENT; i++) {
+        g_element_nodes[elem_index][i] = -1;
+    }
+
+    g_element_type[elem_index] = element_type;
+    g_element_material[elem_index] = -1;
+    g_nastran_element_property[elem_index] = (pid > 0) ? pid : -1;
+
+    g_num_elements++;
+
+    return FEM_SUCCESS;
+}
+
+/* Parse Nastran CTETRA card (4 or 10 grids) */
+fem_error_t input_parse_nastran_ctetra(input_control_t *input, const char *line)
+{
+    return input_parse_nastran_solid(input, line, "CTETRA");
+}
+
+/* Parse Nastran CHEXA card (8 grids) */
+fem_error_t input_parse_nastran_chexa(input_control_t *input, const char *line)
+{
+    return input_parse_nastran_solid(input, line, "CHEXA");
+}
+
+/* Parse Nastran PSOLID card; kept with the PSHELL properties (no thickness) */
+fem_error_t input_parse_nastran_psolid(input_control_t *input, const char *line)
+{
+    (void)input;
+    char fields[10][9];
+    fem_error_t err;
+    int pid;
+    int mid = 0;
+
+    err = input_nastran_parse_fixed_format(line, fields, 10);
+    CHECK_ERROR(err);
+
+    err = input_nastran_get_integer(fields[1], &pid);
+    CHECK_ERROR(err);
+
+    if (fields[2][0] != '\0') {
+        input_nastran_trim(fields[2]);
+        err = input_nastran_get_integer(fields[2], &mid);
+        if (err != FEM_SUCCESS) mid = 0;
+    }
+
+    if (g_nastran_pshell_count >= MAX_NASTRAN_PROPERTIES) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Exceeded maximum supported PSHELL/PSOLID cards (%d)",
+                         MAX_NASTRAN_PROPERTIES);
+    }
+
+    g_nastran_pshells[g_nastran_pshell_count].pid = pid;
+    g_nastran_pshells[g_nastran_pshell_count].mid = mid;
+    g_nastran_pshells[g_nastran_pshell_count].thickness = 0.0;
+    g_nastran_pshells[g_nastran_pshell_count].material_index = -1;
+    g_nastran_pshell_count++;
+
+    return FEM_SUCCESS;
+}
+
 fem_error_t input_parse_nastran_pshell(input_control_t *input, const char *line)
 {
     (void)input;
@@ -1966,6 +2382,295 @@ fem_error_t input_parse_nastran_force(input_control_t *input, const char *line)
     return FEM_SUCCESS;
 }
 
+/* Data fields 1-8 of a card and all its continuation lines, 8 per line
+ * (field f of line l at l * 8 + f - 1), trimmed; blank fields are empty.
+ * *fields is fem_malloc'd. */
+static fem_error_t input_nastran_read_card(input_control_t *input, const char *line,
+                                           char (**fields)[9], int *field_count)
+{
+    char line_fields[10][9];
+    char cont_line[256];
+    char (*all)[9] = NULL;
+    const char *current = line;
+    int lines = 0;
+    int capacity = 0;
+    fem_error_t err;
+
+    do {
+        if (lines == capacity) {
+            int grown = capacity > 0 ? 2 * capacity : 4;
+            char (*tmp)[9] = fem_realloc(all, (size_t)grown * 8 * sizeof(*all), FEM_MEMORY_MESH);
+            if (!tmp) {
+                fem_free(all);
+                return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                                 "Failed to buffer card at line %d", input->line_number);
+            }
+            all = tmp;
+            capacity = grown;
+        }
+        memset(line_fields, 0, sizeof(line_fields));
+        err = input_nastran_parse_fixed_format(current, line_fields, 10);
+        CHECK_ERROR_CLEANUP(err, fem_free(all));
+        for (int f = 1; f <= 8; f++) {
+            input_nastran_trim(line_fields[f]);
+            memcpy(all[lines * 8 + f - 1], line_fields[f], sizeof(line_fields[f]));
+        }
+        lines++;
+        current = cont_line;
+    } while (input_nastran_next_continuation(input, cont_line, sizeof(cont_line)));
+
+    *fields = all;
+    *field_count = lines * 8;
+    return FEM_SUCCESS;
+}
+
+/* Component string "123456": bit k set for translation k + 1. Rotations
+ * (4-6) and scalar points (0) have no DOF here and are counted in
+ * *ignored. */
+static int input_nastran_translations(const char *field, int *ignored)
+{
+    int mask = 0;
+
+    for (const char *c = field; *c; c++) {
+        if (*c >= '1' && *c <= '3') {
+            mask |= 1 << (*c - '1');
+        } else if (*c == '0' || (*c >= '4' && *c <= '6')) {
+            (*ignored)++;
+        }
+    }
+    return mask;
+}
+
+static int input_nastran_is_real(const char *field)
+{
+    return strchr(field, '.') != NULL;
+}
+
+/* RBE2: EID GN CM GM1 GM2 ... ["THRU" ranges, optional trailing ALPHA].
+ * Each dependent grid GMi follows the independent grid GN in the
+ * translations listed in CM: u(GMi) - u(GN) = 0. */
+static fem_error_t input_parse_nastran_rbe2(input_control_t *input, const char *line,
+                                            mpc_equations_t *equations)
+{
+    char (*fields)[9];
+    int field_count = 0;
+    int eid = 0;
+    int gn = 0;
+    int previous = 0;
+    int mask;
+    fem_error_t err;
+
+    err = input_nastran_read_card(input, line, &fields, &field_count);
+    CHECK_ERROR(err);
+
+    if (input_nastran_get_integer(fields[0], &eid) != FEM_SUCCESS ||
+        input_nastran_get_integer(fields[1], &gn) != FEM_SUCCESS) {
+        fem_free(fields);
+        return error_set(FEM_ERROR_FILE_READ, "Invalid RBE2 card at line %d", input->line_number);
+    }
+    mask = input_nastran_translations(fields[2], &equations->ignored_components);
+
+    for (int f = 3; f < field_count; f++) {
+        int first;
+        int last;
+
+        if (fields[f][0] == '\0') {
+            continue;
+        }
+        if (input_nastran_is_real(fields[f])) {
+            break;                      /* ALPHA */
+        }
+        if (strcmp(fields[f], "THRU") == 0) {
+            int f_next = f + 1;
+            while (f_next < field_count && fields[f_next][0] == '\0') {
+                f_next++;
+            }
+            if (previous <= 0 || f_next >= field_count ||
+                input_nastran_get_integer(fields[f_next], &last) != FEM_SUCCESS || last < previous) {
+                fem_free(fields);
+                return error_set(FEM_ERROR_FILE_READ, "Invalid THRU range in RBE2 %d", eid);
+            }
+            first = previous + 1;
+            f = f_next;
+        } else if (input_nastran_get_integer(fields[f], &first) == FEM_SUCCESS) {
+            last = first;
+        } else {
+            fem_free(fields);
+            return error_set(FEM_ERROR_FILE_READ, "Invalid grid '%s' in RBE2 %d", fields[f], eid);
+        }
+
+        for (int gm = first; gm <= last; gm++) {
+            for (int k = 0; k < 3; k++) {
+                if (!(mask & (1 << k))) {
+                    continue;
+                }
+                err = mpc_equations_begin(equations, gm, k, 1.0);
+                if (err == FEM_SUCCESS) {
+                    err = mpc_equations_add_term(equations, gn, k, -1.0);
+                }
+                CHECK_ERROR_CLEANUP(err, fem_free(fields));
+            }
+        }
+        previous = last;
+    }
+
+    fem_free(fields);
+    return FEM_SUCCESS;
+}
+
+/* RBE3: EID blank REFGRID REFC, then groups WTi Ci Gi,1 Gi,2 ... The
+ * reference grid follows the weighted average of the group grids in each
+ * translation of REFC: u(REF) - sum w u(G) / sum w = 0, over the grids
+ * whose Ci contains the component. This is the rigid-body fit of RBE3
+ * when the reference point lies at the weighted centroid, the usual bolt
+ * or load spider; UM (user-selected dependent DOFs) is not supported. */
+static fem_error_t input_parse_nastran_rbe3(input_control_t *input, const char *line,
+                                            mpc_equations_t *equations)
+{
+    char (*fields)[9];
+    int field_count = 0;
+    int eid = 0;
+    int ref = 0;
+    int ref_mask;
+    int grid_count = 0;
+    int *grids;
+    int *masks;
+    double *weights;
+    double weight = 0.0;
+    double total[3] = {0.0, 0.0, 0.0};
+    int mask = 0;
+    int expect_component = 0;
+    fem_error_t err = FEM_SUCCESS;
+
+    err = input_nastran_read_card(input, line, &fields, &field_count);
+    CHECK_ERROR(err);
+
+    if (input_nastran_get_integer(fields[0], &eid) != FEM_SUCCESS ||
+        input_nastran_get_integer(fields[2], &ref) != FEM_SUCCESS) {
+        fem_free(fields);
+        return error_set(FEM_ERROR_FILE_READ, "Invalid RBE3 card at line %d", input->line_number);
+    }
+    ref_mask = input_nastran_translations(fields[3], &equations->ignored_components);
+
+    grids = fem_malloc((size_t)field_count * sizeof(int), FEM_MEMORY_MESH);
+    masks = fem_malloc((size_t)field_count * sizeof(int), FEM_MEMORY_MESH);
+    weights = fem_malloc((size_t)field_count * sizeof(double), FEM_MEMORY_MESH);
+    if (!grids || !masks || !weights) {
+        err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to buffer RBE3 %d", eid);
+    }
+
+    /* Weight groups: a real weight, a component string, then grids */
+    for (int f = 4; f < field_count && err == FEM_SUCCESS; f++) {
+        if (fields[f][0] == '\0') {
+            continue;
+        }
+        if (strcmp(fields[f], "UM") == 0) {
+            err = error_set(FEM_ERROR_INVALID_INPUT,
+                            "RBE3 %d: UM dependent DOFs are not supported", eid);
+        } else if (strcmp(fields[f], "ALPHA") == 0 || strcmp(fields[f], "TREF") == 0) {
+            break;
+        } else if (input_nastran_is_real(fields[f])) {
+            if (input_nastran_get_double(fields[f], &weight) != FEM_SUCCESS || weight < 0.0) {
+                err = error_set(FEM_ERROR_FILE_READ, "Invalid weight '%s' in RBE3 %d",
+                                fields[f], eid);
+            }
+            expect_component = 1;
+        } else if (expect_component) {
+            mask = input_nastran_translations(fields[f], &equations->ignored_components);
+            expect_component = 0;
+        } else if (input_nastran_get_integer(fields[f], &grids[grid_count]) == FEM_SUCCESS) {
+            masks[grid_count] = mask;
+            weights[grid_count] = weight;
+            for (int k = 0; k < 3; k++) {
+                if (mask & (1 << k)) {
+                    total[k] += weight;
+                }
+            }
+            grid_count++;
+        } else {
+            err = error_set(FEM_ERROR_FILE_READ, "Invalid field '%s' in RBE3 %d", fields[f], eid);
+        }
+    }
+
+    for (int k = 0; k < 3 && err == FEM_SUCCESS; k++) {
+        if (!(ref_mask & (1 << k))) {
+            continue;
+        }
+        if (total[k] <= 0.0) {
+            err = error_set(FEM_ERROR_INVALID_INPUT,
+                            "RBE3 %d has no weighted grid in component %d", eid, k + 1);
+            break;
+        }
+        err = mpc_equations_begin(equations, ref, k, 1.0);
+        for (int g = 0; g < grid_count && err == FEM_SUCCESS; g++) {
+            if ((masks[g] & (1 << k)) && weights[g] > 0.0) {
+                err = mpc_equations_add_term(equations, grids[g], k, -weights[g] / total[k]);
+            }
+        }
+    }
+
+    fem_free(grids);
+    fem_free(masks);
+    fem_free(weights);
+    fem_free(fields);
+    return err;
+}
+
+/* MPC: SID G1 C1 A1 G2 C2 A2, continuation fields 2-7 hold further
+ * G C A triples. sum Ai u(Gi, Ci) = 0 with the first term dependent. */
+static fem_error_t input_parse_nastran_mpc(input_control_t *input, const char *line,
+                                           mpc_equations_t *equations)
+{
+    char (*fields)[9];
+    int field_count = 0;
+    int sid = 0;
+    int terms = 0;
+    fem_error_t err = FEM_SUCCESS;
+
+    err = input_nastran_read_card(input, line, &fields, &field_count);
+    CHECK_ERROR(err);
+    input_nastran_get_integer(fields[0], &sid);
+
+    for (int l = 0; l < field_count / 8 && err == FEM_SUCCESS; l++) {
+        for (int t = 0; t < 2; t++) {
+            char (*triple)[9] = fields + l * 8 + 1 + 3 * t;
+            int grid;
+            int component;
+            double a;
+
+            if (triple[0][0] == '\0') {
+                continue;
+            }
+            if (input_nastran_get_integer(triple[0], &grid) != FEM_SUCCESS ||
+                input_nastran_get_integer(triple[1], &component) != FEM_SUCCESS ||
+                input_nastran_get_double(triple[2], &a) != FEM_SUCCESS ||
+                component < 0 || component > 6) {
+                fem_free(fields);
+                return error_set(FEM_ERROR_FILE_READ, "Invalid term in MPC %d at line %d",
+                                 sid, input->line_number);
+            }
+            if (component < 1 || component > 3) {
+                /* No rotational DOFs: a rotational dependent DOF drops the equation */
+                equations->ignored_components++;
+                if (terms == 0) {
+                    fem_free(fields);
+                    return FEM_SUCCESS;
+                }
+                continue;
+            }
+            err = terms == 0 ? mpc_equations_begin(equations, grid, component - 1, a)
+                             : mpc_equations_add_term(equations, grid, component - 1, a);
+            if (err != FEM_SUCCESS) {
+                break;
+            }
+            terms++;
+        }
+    }
+
+    fem_free(fields);
+    return err;
+}
+
 static fem_error_t input_nastran_find_pshell_material(int pid, int *material_index)
 {
     if (material_index == NULL) {
@@ -1997,12 +2702,12 @@ static fem_error_t input_nastran_finalize_properties(void)
 
         int base_index = 0;
         if (prop->mid > 0) {
-            if (prop->mid >= g_material_id_capacity || g_material_id_to_index[prop->mid] < 0) {
+            base_index = id_map_lookup(&g_material_id_map, prop->mid);
+            if (base_index < 0) {
                 return error_set(FEM_ERROR_INVALID_MATERIAL,
                                  "MAT1 %d referenced by PSHELL %d not found",
                                  prop->mid, prop->pid);
             }
-            base_index = g_material_id_to_index[prop->mid];
         } else if (g_num_materials > 0) {
             base_index = 0;
         } else {
@@ -2027,9 +2732,9 @@ static fem_error_t input_nastran_finalize_properties(void)
         }
         g_material_props[new_index][3] = g_material_props[base_index][3];
         g_material_type[new_index] = g_material_type[base_index];
-        if (prop->pid >= 0 && prop->pid < g_material_id_capacity &&
-            g_material_id_to_index[prop->pid] < 0) {
-            g_material_id_to_index[prop->pid] = new_index;
+        if (prop->pid > 0 && id_map_lookup(&g_material_id_map, prop->pid) < 0) {
+            err = id_map_insert(&g_material_id_map, prop->pid, new_index, g_material_capacity);
+            CHECK_ERROR(err);
         }
         if (g_material_ids) {
             g_material_ids[new_index] = prop->pid;
@@ -2045,8 +2750,9 @@ static fem_error_t input_nastran_finalize_properties(void)
                 g_element_material[elem] = mat_index;
             } else {
                 int pid = g_nastran_element_property[elem];
-                if (pid > 0 && pid < g_material_id_capacity && g_material_id_to_index[pid] >= 0) {
-                    g_element_material[elem] = g_material_id_to_index[pid];
+                int pid_index = id_map_lookup(&g_material_id_map, pid);
+                if (pid_index >= 0) {
+                    g_element_material[elem] = pid_index;
                 } else {
                     return err;
                 }
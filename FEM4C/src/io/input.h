@@ -51,10 +51,13 @@ fem_error_t input_parse_nastran_grid(input_control_t *input, const char *line);
 fem_error_t input_parse_nastran_ctria3(input_control_t *input, const char *line);
 fem_error_t input_parse_nastran_cquad4(input_control_t *input, const char *line);
 fem_error_t input_parse_nastran_ctria6(input_control_t *input, const char *line);
+fem_error_t input_parse_nastran_ctetra(input_control_t *input, const char *line);
+fem_error_t input_parse_nastran_chexa(input_control_t *input, const char *line);
 fem_error_t input_parse_nastran_mat1(input_control_t *input, const char *line);
 fem_error_t input_parse_nastran_spc(input_control_t *input, const char *line);
 fem_error_t input_parse_nastran_force(input_control_t *input, const char *line);
 fem_error_t input_parse_nastran_pshell(input_control_t *input, const char *line);
+fem_error_t input_parse_nastran_psolid(input_control_t *input, const char *line);
 fem_error_t input_read_parser_package(const char *directory);
 
 /* Nastran utility functions */
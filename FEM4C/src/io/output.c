@@ -3,18 +3,53 @@
  */
 
 #include "output.h"
+#include "output_buffer.h"
+#include "../common/fem_thread.h"
 #include "../common/constants.h"
 #include "../common/globals.h"
 #include "../common/error.h"
-#include "../elements/t6/t6_stiffness.h"
-#include "../elements/t3/t3_element.h"
-#include "../elements/q4/q4_element.h"
-#include "../solver/cg_solver.h"
+#include "../solver/assembly.h"
+#include "../analysis/stress_recovery.h"
+#include "../elements/solid3d/solid3d_element.h"
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
 
+/* localtime() and ctime() share static storage; writers running on
+ * background threads take this lock around them */
+static fem_mutex_t g_output_time_mutex = FEM_MUTEX_INITIALIZER;
+
+/* Serialises stress and reaction recovery requested by writers
+ * themselves; the static analysis recovers both before it submits the
+ * writers */
+static fem_mutex_t g_output_results_mutex = FEM_MUTEX_INITIALIZER;
+
+/* Recovered centroid stress of an element, NULL if it has none */
+static const double *output_element_stress(int elem)
+{
+    if (g_element_stress == NULL || elem >= g_stress_element_count ||
+        !g_element_stress_valid[elem]) {
+        return NULL;
+    }
+    return g_element_stress[elem];
+}
+
+/* Six-component centroid stress of a solid element, NULL if it has none */
+static const double *output_solid_stress(int elem)
+{
+    if (g_solid_stress == NULL || elem >= g_stress_element_count ||
+        !g_element_stress_valid[elem]) {
+        return NULL;
+    }
+    return g_solid_stress[elem];
+}
+
+static int output_is_solid_model(void)
+{
+    return g_analysis.spatial_dimension == 3;
+}
+
 /* Main result writing function */
 fem_error_t output_write_results(const char *filename)
 {
@@ -62,99 +97,202 @@ fem_error_t output_write_results(const char *filename)
     return FEM_SUCCESS;
 }
 
-fem_error_t output_export_csv(const char *filename)
+static void output_csv_node_row(output_buffer_t *buf, int i, void *context)
 {
-    FILE *csv = fopen(filename, "w");
-    if (!csv) {
-        return error_set(FEM_ERROR_FILE_WRITE, "Cannot create CSV file: %s", filename);
+    double ux = g_node_displ[i][0];
+    double uy = g_node_displ[i][1];
+    double uz = g_node_displ[i][2];
+    double mag = sqrt(ux * ux + uy * uy + uz * uz);
+
+    (void)context;
+    output_buffer_puts(buf, "NODE,");
+    output_buffer_int(buf, g_node_ids ? g_node_ids[i] : (i + 1), 0);
+    for (int k = 0; k < 3; ++k) {
+        output_buffer_char(buf, ',');
+        output_buffer_fixed(buf, g_node_coords[i][k], 10);
     }
+    output_buffer_char(buf, ',');
+    output_buffer_exp(buf, ux, 0, 6, 0);
+    output_buffer_char(buf, ',');
+    output_buffer_exp(buf, uy, 0, 6, 0);
+    output_buffer_char(buf, ',');
+    output_buffer_exp(buf, uz, 0, 6, 0);
+    output_buffer_char(buf, ',');
+    output_buffer_exp(buf, mag, 0, 6, 0);
+    output_buffer_puts(buf, ",,,,,,");
+    if (g_stress_element_count > 0) {
+        /* Patch-recovered nodal stresses */
+        const double *stress = g_nodal_stress_spr[i];
+        double values[6];
+        values[0] = stress[0];
+        values[1] = stress[1];
+        values[2] = stress[2];
+        values[3] = stress_von_mises(stress);
+        stress_principal(stress, &values[4], &values[5]);
+        for (int k = 0; k < 6; ++k) {
+            output_buffer_char(buf, ',');
+            output_buffer_exp(buf, values[k], 0, 6, 0);
+        }
+        output_buffer_char(buf, '\n');
+    } else {
+        output_buffer_puts(buf, ",,,,,,\n");
+    }
+}
 
-    fprintf(csv, "type,id,x,y,z,ux,uy,uz,disp_mag,n1,n2,n3,n4,n5,n6,sigma_x,sigma_y,tau_xy,von_mises,sigma_max,sigma_min\n");
+static void output_csv_element_row(output_buffer_t *buf, int elem, void *context)
+{
+    const double *stress;
+    double sx = NAN;
+    double sy = NAN;
+    double txy = NAN;
+    double von_mises = NAN;
+    double sigma_max = NAN;
+    double sigma_min = NAN;
 
-    /* Write nodal displacement results */
-    for (int i = 0; i < g_num_nodes; ++i) {
-        double ux = g_node_displ[i][0];
-        double uy = g_node_displ[i][1];
-        double uz = g_node_displ[i][2];
-        double mag = sqrt(ux * ux + uy * uy + uz * uz);
-        fprintf(csv, "NODE,%d,%.10f,%.10f,%.10f,%.6e,%.6e,%.6e,%.6e,,,,,,,,,,,,\n",
-                g_node_ids ? g_node_ids[i] : (i + 1),
-                g_node_coords[i][0],
-                g_node_coords[i][1],
-                g_node_coords[i][2],
-                ux, uy, uz, mag);
+    (void)context;
+    if (g_element_type[elem] != ELEMENT_T6 && g_element_type[elem] != ELEMENT_T3 &&
+        g_element_type[elem] != ELEMENT_Q4) {
+        return;
     }
 
-    /* Write element stress results */
-    for (int elem = 0; elem < g_num_elements; ++elem) {
-        double stress[T6_STRESS_COMPONENTS] = {0.0, 0.0, 0.0};
-        fem_error_t err = FEM_SUCCESS;
+    stress = output_element_stress(elem);
+    if (stress != NULL) {
+        sx = stress[0];
+        sy = stress[1];
+        txy = stress[2];
+        von_mises = stress_von_mises(stress);
+        stress_principal(stress, &sigma_max, &sigma_min);
+    }
 
-        if (g_element_type[elem] == ELEMENT_T6) {
-            err = t6_calculate_element_stress(elem, stress);
-        } else if (g_element_type[elem] == ELEMENT_T3) {
-            err = t3_element_stress(elem, stress);
-        } else if (g_element_type[elem] == ELEMENT_Q4) {
-            err = q4_element_stress(elem, stress);
-        } else {
-            continue;
-        }
+    int nodes_in_row = 0;
+    if (g_element_type[elem] == ELEMENT_T6) {
+        nodes_in_row = 6;
+    } else if (g_element_type[elem] == ELEMENT_T3) {
+        nodes_in_row = 3;
+    } else if (g_element_type[elem] == ELEMENT_Q4) {
+        nodes_in_row = 4;
+    }
 
-        if (err != FEM_SUCCESS) {
-            stress[0] = stress[1] = stress[2] = NAN;
+    output_buffer_puts(buf, "ELEMENT,");
+    output_buffer_int(buf, g_element_ids ? g_element_ids[elem] : (elem + 1), 0);
+    output_buffer_puts(buf, ",,,,,,,");
+    for (int j = 0; j < 6; ++j) {
+        int node = j < nodes_in_row ? g_element_nodes[elem][j] : -1;
+        int node_id = 0;
+        if (node >= 0) {
+            node_id = g_node_ids ? g_node_ids[node] : (node + 1);
         }
+        output_buffer_char(buf, ',');
+        output_buffer_int(buf, node_id, 0);
+    }
 
-        double sx = stress[0];
-        double sy = stress[1];
-        double txy = stress[2];
-        double von_mises = NAN;
-        double sigma_max = NAN;
-        double sigma_min = NAN;
+    double values[6] = {sx, sy, txy, von_mises, sigma_max, sigma_min};
+    for (int k = 0; k < 6; ++k) {
+        output_buffer_char(buf, ',');
+        output_buffer_exp(buf, values[k], 0, 6, 0);
+    }
+    output_buffer_char(buf, '\n');
+}
 
-        if (!isnan(sx) && !isnan(sy) && !isnan(txy)) {
-            von_mises = sqrt(sx * sx + sy * sy - sx * sy + 3.0 * txy * txy);
-            double avg = 0.5 * (sx + sy);
-            double diff = 0.5 * (sx - sy);
-            double radius = sqrt(diff * diff + txy * txy);
-            sigma_max = avg + radius;
-            sigma_min = avg - radius;
-        }
+/* Solid CSV rows carry up to ten element nodes and the six stress
+ * components with the von Mises stress */
+static void output_csv_solid_node_row(output_buffer_t *buf, int i, void *context)
+{
+    double mag = sqrt(g_node_displ[i][0] * g_node_displ[i][0] +
+                      g_node_displ[i][1] * g_node_displ[i][1] +
+                      g_node_displ[i][2] * g_node_displ[i][2]);
 
-        int n1 = -1, n2 = -1, n3 = -1, n4 = -1, n5 = -1, n6 = -1;
-        if (g_element_type[elem] == ELEMENT_T6) {
-            n1 = g_element_nodes[elem][0];
-            n2 = g_element_nodes[elem][1];
-            n3 = g_element_nodes[elem][2];
-            n4 = g_element_nodes[elem][3];
-            n5 = g_element_nodes[elem][4];
-            n6 = g_element_nodes[elem][5];
-        } else if (g_element_type[elem] == ELEMENT_T3) {
-            n1 = g_element_nodes[elem][0];
-            n2 = g_element_nodes[elem][1];
-            n3 = g_element_nodes[elem][2];
-        } else if (g_element_type[elem] == ELEMENT_Q4) {
-            n1 = g_element_nodes[elem][0];
-            n2 = g_element_nodes[elem][1];
-            n3 = g_element_nodes[elem][2];
-            n4 = g_element_nodes[elem][3];
+    (void)context;
+    output_buffer_puts(buf, "NODE,");
+    output_buffer_int(buf, g_node_ids ? g_node_ids[i] : (i + 1), 0);
+    for (int k = 0; k < 3; ++k) {
+        output_buffer_char(buf, ',');
+        output_buffer_fixed(buf, g_node_coords[i][k], 10);
+    }
+    for (int k = 0; k < 3; ++k) {
+        output_buffer_char(buf, ',');
+        output_buffer_exp(buf, g_node_displ[i][k], 0, 6, 0);
+    }
+    output_buffer_char(buf, ',');
+    output_buffer_exp(buf, mag, 0, 6, 0);
+    output_buffer_puts(buf, ",,,,,,,,,,");
+    if (g_solid_nodal_stress != NULL && g_stress_element_count > 0) {
+        const double *stress = g_solid_nodal_stress[i];
+        for (int k = 0; k < SOLID3D_STRESS_COMPONENTS; ++k) {
+            output_buffer_char(buf, ',');
+            output_buffer_exp(buf, stress[k], 0, 6, 0);
         }
+        output_buffer_char(buf, ',');
+        output_buffer_exp(buf, solid3d_von_mises(stress), 0, 6, 0);
+        output_buffer_char(buf, '\n');
+    } else {
+        output_buffer_puts(buf, ",,,,,,,\n");
+    }
+}
 
-        int node_ids[6] = {n1, n2, n3, n4, n5, n6};
-        for (int j = 0; j < 6; ++j) {
-            if (node_ids[j] >= 0) {
-                node_ids[j] = g_node_ids ? g_node_ids[node_ids[j]] : (node_ids[j] + 1);
-            } else {
-                node_ids[j] = 0;
-            }
+static void output_csv_solid_element_row(output_buffer_t *buf, int elem, void *context)
+{
+    const double *stress = output_solid_stress(elem);
+    int nodes_in_row = solid3d_node_count(g_element_type[elem]);
+
+    (void)context;
+    if (!solid3d_is_solid_type(g_element_type[elem])) {
+        return;
+    }
+
+    output_buffer_puts(buf, "ELEMENT,");
+    output_buffer_int(buf, g_element_ids ? g_element_ids[elem] : (elem + 1), 0);
+    output_buffer_puts(buf, ",,,,,,,");
+    for (int j = 0; j < SOLID3D_MAX_NODES; ++j) {
+        int node = j < nodes_in_row ? g_element_nodes[elem][j] : -1;
+        int node_id = 0;
+        if (node >= 0) {
+            node_id = g_node_ids ? g_node_ids[node] : (node + 1);
         }
+        output_buffer_char(buf, ',');
+        output_buffer_int(buf, node_id, 0);
+    }
+    for (int k = 0; k < SOLID3D_STRESS_COMPONENTS; ++k) {
+        output_buffer_char(buf, ',');
+        output_buffer_exp(buf, stress ? stress[k] : NAN, 0, 6, 0);
+    }
+    output_buffer_char(buf, ',');
+    output_buffer_exp(buf, stress ? solid3d_von_mises(stress) : NAN, 0, 6, 0);
+    output_buffer_char(buf, '\n');
+}
 
-        fprintf(csv, "ELEMENT,%d,,,,,,,,%d,%d,%d,%d,%d,%d,%.6e,%.6e,%.6e,%.6e,%.6e,%.6e\n",
-                g_element_ids ? g_element_ids[elem] : (elem + 1),
-                node_ids[0], node_ids[1], node_ids[2],
-                node_ids[3], node_ids[4], node_ids[5],
-                sx, sy, txy, von_mises, sigma_max, sigma_min);
+fem_error_t output_export_csv(const char *filename)
+{
+    fem_error_t err;
+    FILE *csv = fopen(filename, "w");
+    if (!csv) {
+        return error_set(FEM_ERROR_FILE_WRITE, "Cannot create CSV file: %s", filename);
+    }
+
+    err = output_calculate_element_stresses();
+    CHECK_ERROR_CLEANUP(err, fclose(csv));
+
+    if (output_is_solid_model()) {
+        fprintf(csv, "type,id,x,y,z,ux,uy,uz,disp_mag,n1,n2,n3,n4,n5,n6,n7,n8,n9,n10,"
+                     "sigma_x,sigma_y,sigma_z,tau_xy,tau_yz,tau_zx,von_mises\n");
+        err = output_buffer_write_rows(csv, g_num_nodes, output_csv_solid_node_row, NULL);
+        CHECK_ERROR_CLEANUP(err, fclose(csv));
+        err = output_buffer_write_rows(csv, g_num_elements, output_csv_solid_element_row, NULL);
+        CHECK_ERROR_CLEANUP(err, fclose(csv));
+        fclose(csv);
+        return FEM_SUCCESS;
     }
 
+    fprintf(csv, "type,id,x,y,z,ux,uy,uz,disp_mag,n1,n2,n3,n4,n5,n6,sigma_x,sigma_y,tau_xy,von_mises,sigma_max,sigma_min\n");
+
+    /* Write nodal displacement results */
+    err = output_buffer_write_rows(csv, g_num_nodes, output_csv_node_row, NULL);
+    CHECK_ERROR_CLEANUP(err, fclose(csv));
+
+    /* Write element stress results */
+    err = output_buffer_write_rows(csv, g_num_elements, output_csv_element_row, NULL);
+    CHECK_ERROR_CLEANUP(err, fclose(csv));
+
     fclose(csv);
     return FEM_SUCCESS;
 }
@@ -195,7 +333,9 @@ fem_error_t output_write_header(output_control_t *output)
     char time_str[64];
     
     current_time = time(NULL);
+    fem_mutex_lock(&g_output_time_mutex);
     strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&current_time));
+    fem_mutex_unlock(&g_output_time_mutex);
     
     fprintf(output->file_ptr, "FEM4C - High Performance Finite Element Method in C\n");
     fprintf(output->file_ptr, "Analysis Results\n");
@@ -235,21 +375,76 @@ fem_error_t output_write_displacements(output_control_t *output)
     return FEM_SUCCESS;
 }
 
+/* Solid element stresses: centroid values and the element-averaged nodal
+ * values, six components each */
+static fem_error_t output_write_solid_stresses(output_control_t *output)
+{
+    fprintf(output->file_ptr, "Element Stresses:\n");
+    fprintf(output->file_ptr, "=================\n");
+    fprintf(output->file_ptr, "Elem     SigmaX       SigmaY       SigmaZ       TauXY        TauYZ        TauZX      VonMises\n");
+    fprintf(output->file_ptr, "----  -----------  -----------  -----------  -----------  -----------  -----------  -----------\n");
+    for (int i = 0; i < g_num_elements; i++) {
+        static const double zero[SOLID3D_STRESS_COMPONENTS] = {0.0};
+        const double *stress = output_solid_stress(i);
+        if (stress == NULL) {
+            stress = zero;
+        }
+        fprintf(output->file_ptr, "%4d  %11.4e  %11.4e  %11.4e  %11.4e  %11.4e  %11.4e  %11.4e\n",
+                i+1, stress[0], stress[1], stress[2], stress[3], stress[4], stress[5],
+                solid3d_von_mises(stress));
+    }
+    fprintf(output->file_ptr, "\n");
+
+    if (g_solid_nodal_stress != NULL && g_stress_element_count > 0) {
+        fprintf(output->file_ptr, "Nodal Stresses (element average):\n");
+        fprintf(output->file_ptr, "=================================\n");
+        fprintf(output->file_ptr, "Node     SigmaX       SigmaY       SigmaZ       TauXY        TauYZ        TauZX      VonMises\n");
+        fprintf(output->file_ptr, "----  -----------  -----------  -----------  -----------  -----------  -----------  -----------\n");
+        for (int i = 0; i < g_num_nodes; i++) {
+            const double *stress = g_solid_nodal_stress[i];
+            fprintf(output->file_ptr, "%4d  %11.4e  %11.4e  %11.4e  %11.4e  %11.4e  %11.4e  %11.4e\n",
+                    i+1, stress[0], stress[1], stress[2], stress[3], stress[4], stress[5],
+                    solid3d_von_mises(stress));
+        }
+        fprintf(output->file_ptr, "\n");
+    }
+    return FEM_SUCCESS;
+}
+
 /* Write element stresses */
 fem_error_t output_write_stresses(output_control_t *output)
 {
+    if (output_is_solid_model()) {
+        return output_write_solid_stresses(output);
+    }
+
     fprintf(output->file_ptr, "Element Stresses:\n");
     fprintf(output->file_ptr, "=================\n");
     fprintf(output->file_ptr, "Elem     SigmaX       SigmaY       TauXY\n");
     fprintf(output->file_ptr, "----  -----------  -----------  -----------\n");
     
-    /* Note: Stress calculation will be implemented with T6 element */
+    /* Centroid stresses; elements without a valid stress print zeros */
     for (int i = 0; i < g_num_elements; i++) {
+        const double *stress = output_element_stress(i);
         fprintf(output->file_ptr, "%4d  %11.4e  %11.4e  %11.4e\n", 
-                i+1, 0.0, 0.0, 0.0);
+                i+1, stress ? stress[0] : 0.0, stress ? stress[1] : 0.0,
+                stress ? stress[2] : 0.0);
     }
     
     fprintf(output->file_ptr, "\n");
+
+    if (g_nodal_stress_spr != NULL && g_stress_element_count > 0) {
+        fprintf(output->file_ptr, "Nodal Stresses (patch recovery):\n");
+        fprintf(output->file_ptr, "================================\n");
+        fprintf(output->file_ptr, "Node     SigmaX       SigmaY       TauXY\n");
+        fprintf(output->file_ptr, "----  -----------  -----------  -----------\n");
+        for (int i = 0; i < g_num_nodes; i++) {
+            fprintf(output->file_ptr, "%4d  %11.4e  %11.4e  %11.4e\n",
+                    i+1, g_nodal_stress_spr[i][0], g_nodal_stress_spr[i][1],
+                    g_nodal_stress_spr[i][2]);
+        }
+        fprintf(output->file_ptr, "\n");
+    }
     return FEM_SUCCESS;
 }
 
@@ -257,6 +452,7 @@ fem_error_t output_write_stresses(output_control_t *output)
 fem_error_t output_write_reactions(output_control_t *output)
 {
     int i;
+    double sum[3] = {0.0, 0.0, 0.0};
     
     fprintf(output->file_ptr, "Reaction Forces:\n");
     fprintf(output->file_ptr, "================\n");
@@ -266,10 +462,18 @@ fem_error_t output_write_reactions(output_control_t *output)
     for (i = 0; i < g_num_nodes; i++) {
         /* Only print reactions for constrained nodes */
         if (g_node_bc_flags[i][0] || g_node_bc_flags[i][1] || g_node_bc_flags[i][2]) {
+            const double *reaction = g_node_reaction ? g_node_reaction[i] : NULL;
+            double r[3] = {0.0, 0.0, 0.0};
+            for (int k = 0; reaction && k < 3; k++) {
+                r[k] = reaction[k];
+                sum[k] += r[k];
+            }
             fprintf(output->file_ptr, "%4d  %11.4e  %11.4e  %11.4e\n", 
-                    i+1, 0.0, 0.0, 0.0); /* Will be calculated by solver */
+                    i+1, r[0], r[1], r[2]);
         }
     }
+    fprintf(output->file_ptr, "----  -----------  -----------  -----------\n");
+    fprintf(output->file_ptr, " Sum  %11.4e  %11.4e  %11.4e\n", sum[0], sum[1], sum[2]);
     
     fprintf(output->file_ptr, "\n");
     return FEM_SUCCESS;
@@ -300,18 +504,32 @@ fem_error_t output_write_summary(output_control_t *output)
     return FEM_SUCCESS;
 }
 
-/* Calculate element stresses (placeholder) */
+/* Make sure the recovered stresses cover the model; normally the static
+ * analysis has recovered them before the writers run */
 fem_error_t output_calculate_element_stresses(void)
 {
-    /* Will be implemented with T6 element stress calculation */
-    return FEM_SUCCESS;
+    fem_error_t err = FEM_SUCCESS;
+
+    fem_mutex_lock(&g_output_results_mutex);
+    if (!stress_recovery_available()) {
+        err = stress_recovery_compute();
+    }
+    fem_mutex_unlock(&g_output_results_mutex);
+    return err;
 }
 
-/* Calculate reaction forces (placeholder) */
+/* Make sure the reactions match the solution; normally the solve phase
+ * has computed them from the constrained rows kept before the BCs */
 fem_error_t output_calculate_reactions(void)
 {
-    /* Will be implemented with solver */
-    return FEM_SUCCESS;
+    fem_error_t err = FEM_SUCCESS;
+
+    fem_mutex_lock(&g_output_results_mutex);
+    if (!g_reactions_current) {
+        err = assembly_compute_reactions();
+    }
+    fem_mutex_unlock(&g_output_results_mutex);
+    return err;
 }
 
 /* Console output functions */
@@ -352,7 +570,6 @@ void output_print_timing_info(void)
 fem_error_t output_write_vtk_file(const char *filename)
 {
     FILE *vtk_file;
-    int i, j;
     fem_error_t err;
     
     /* Open VTK file */
@@ -361,6 +578,60 @@ fem_error_t output_write_vtk_file(const char *filename)
         return error_set(FEM_ERROR_FILE_WRITE, "Cannot create VTK file: %s", filename);
     }
     
+    err = output_write_vtk_geometry(vtk_file);
+    CHECK_ERROR_CLEANUP(err, fclose(vtk_file));
+    
+    err = output_write_vtk_results(vtk_file);
+    CHECK_ERROR_CLEANUP(err, fclose(vtk_file));
+    
+    fclose(vtk_file);
+    return FEM_SUCCESS;
+}
+
+/* VTK cell type of a solid element; the T10 mid-node and H8 corner
+ * orderings already match VTK */
+static int output_vtk_solid_cell_type(int element_type)
+{
+    switch (element_type) {
+        case ELEMENT_T4:      return 10;  /* VTK_TETRA */
+        case ELEMENT_T10:     return 24;  /* VTK_QUADRATIC_TETRA */
+        case ELEMENT_H8:      return 12;  /* VTK_HEXAHEDRON */
+        default:              return 0;
+    }
+}
+
+static fem_error_t output_write_vtk_solid_cells(FILE *vtk_file)
+{
+    int size = 0;
+
+    for (int i = 0; i < g_num_elements; i++) {
+        size += solid3d_node_count(g_element_type[i]) + 1;
+    }
+    fprintf(vtk_file, "CELLS %d %d\n", g_num_elements, size);
+    for (int i = 0; i < g_num_elements; i++) {
+        int nodes = solid3d_node_count(g_element_type[i]);
+        fprintf(vtk_file, "%d", nodes);
+        for (int j = 0; j < nodes; j++) {
+            fprintf(vtk_file, " %d", g_element_nodes[i][j]);
+        }
+        fprintf(vtk_file, "\n");
+    }
+    fprintf(vtk_file, "\n");
+
+    fprintf(vtk_file, "CELL_TYPES %d\n", g_num_elements);
+    for (int i = 0; i < g_num_elements; i++) {
+        fprintf(vtk_file, "%d\n", output_vtk_solid_cell_type(g_element_type[i]));
+    }
+    fprintf(vtk_file, "\n");
+    return FEM_SUCCESS;
+}
+
+/* Write VTK header and mesh geometry (points, cells, cell types). Only mesh
+ * data is read, so this may run while the system is being solved. */
+fem_error_t output_write_vtk_geometry(FILE *vtk_file)
+{
+    int i, j;
+    
     /* Write VTK header */
     fprintf(vtk_file, "# vtk DataFile Version 3.0\n");
     fprintf(vtk_file, "FEM4C Analysis Results: %s\n", g_analysis.title);
@@ -375,6 +646,10 @@ fem_error_t output_write_vtk_file(const char *filename)
     }
     fprintf(vtk_file, "\n");
     
+    if (output_is_solid_model()) {
+        return output_write_vtk_solid_cells(vtk_file);
+    }
+
     /* Write cells (elements) */
     fprintf(vtk_file, "CELLS %d %d\n", g_num_elements, g_num_elements * 7); /* 6 nodes + count */
     for (i = 0; i < g_num_elements; i++) {
@@ -397,6 +672,67 @@ fem_error_t output_write_vtk_file(const char *filename)
     }
     fprintf(vtk_file, "\n");
     
+    return FEM_SUCCESS;
+}
+
+/* Solid stresses as six-component field arrays (xx, yy, zz, xy, yz, zx)
+ * with the von Mises stress; closes the point data and writes the cells */
+static fem_error_t output_write_vtk_solid_stresses(FILE *vtk_file, int have_stress)
+{
+    int i;
+
+    if (have_stress && g_solid_nodal_stress != NULL && g_stress_element_count > 0) {
+        fprintf(vtk_file, "FIELD Nodal_Stresses 1\n");
+        fprintf(vtk_file, "Nodal_Stress %d %d float\n", SOLID3D_STRESS_COMPONENTS, g_num_nodes);
+        for (i = 0; i < g_num_nodes; i++) {
+            const double *stress = g_solid_nodal_stress[i];
+            fprintf(vtk_file, "%.6e %.6e %.6e %.6e %.6e %.6e\n",
+                    stress[0], stress[1], stress[2], stress[3], stress[4], stress[5]);
+        }
+        fprintf(vtk_file, "\n");
+
+        fprintf(vtk_file, "SCALARS Nodal_Von_Mises float\n");
+        fprintf(vtk_file, "LOOKUP_TABLE default\n");
+        for (i = 0; i < g_num_nodes; i++) {
+            fprintf(vtk_file, "%.6e\n", solid3d_von_mises(g_solid_nodal_stress[i]));
+        }
+        fprintf(vtk_file, "\n");
+    }
+
+    fprintf(vtk_file, "CELL_DATA %d\n", g_num_elements);
+    fprintf(vtk_file, "SCALARS Von_Mises_Stress float\n");
+    fprintf(vtk_file, "LOOKUP_TABLE default\n");
+    for (i = 0; i < g_num_elements; i++) {
+        const double *stress = output_solid_stress(i);
+        fprintf(vtk_file, "%.6e\n", stress ? solid3d_von_mises(stress) : 0.0);
+    }
+    fprintf(vtk_file, "\n");
+
+    fprintf(vtk_file, "FIELD Element_Stresses 1\n");
+    fprintf(vtk_file, "Stress %d %d float\n", SOLID3D_STRESS_COMPONENTS, g_num_elements);
+    for (i = 0; i < g_num_elements; i++) {
+        const double *stress = output_solid_stress(i);
+        for (int k = 0; k < SOLID3D_STRESS_COMPONENTS; k++) {
+            fprintf(vtk_file, k ? " %.6e" : "%.6e", stress ? stress[k] : 0.0);
+        }
+        fprintf(vtk_file, "\n");
+    }
+    fprintf(vtk_file, "\n");
+
+    fprintf(vtk_file, "SCALARS Material_ID int\n");
+    fprintf(vtk_file, "LOOKUP_TABLE default\n");
+    for (i = 0; i < g_num_elements; i++) {
+        fprintf(vtk_file, "%d\n", g_element_material[i] + 1);
+    }
+    return FEM_SUCCESS;
+}
+
+/* Write VTK point and cell data for the solved system */
+fem_error_t output_write_vtk_results(FILE *vtk_file)
+{
+    int i;
+    fem_error_t err;
+    
     /* Write point data (nodal results) */
     fprintf(vtk_file, "POINT_DATA %d\n", g_num_nodes);
     
@@ -427,25 +763,55 @@ fem_error_t output_write_vtk_file(const char *filename)
     }
     fprintf(vtk_file, "\n");
     
+    err = output_calculate_element_stresses();
+    if (output_is_solid_model()) {
+        return output_write_vtk_solid_stresses(vtk_file, err == FEM_SUCCESS);
+    }
+
+    /* Write recovered nodal stresses (sx, sy, txy) */
+    if (err == FEM_SUCCESS && g_stress_element_count > 0) {
+        fprintf(vtk_file, "SCALARS Nodal_Stress float 3\n");
+        fprintf(vtk_file, "LOOKUP_TABLE default\n");
+        for (i = 0; i < g_num_nodes; i++) {
+            fprintf(vtk_file, "%.6e %.6e %.6e\n",
+                    g_nodal_stress[i][0], g_nodal_stress[i][1], g_nodal_stress[i][2]);
+        }
+        fprintf(vtk_file, "\n");
+        
+        fprintf(vtk_file, "SCALARS Nodal_Stress_SPR float 3\n");
+        fprintf(vtk_file, "LOOKUP_TABLE default\n");
+        for (i = 0; i < g_num_nodes; i++) {
+            fprintf(vtk_file, "%.6e %.6e %.6e\n",
+                    g_nodal_stress_spr[i][0], g_nodal_stress_spr[i][1], g_nodal_stress_spr[i][2]);
+        }
+        fprintf(vtk_file, "\n");
+        
+        fprintf(vtk_file, "SCALARS Nodal_Von_Mises_SPR float\n");
+        fprintf(vtk_file, "LOOKUP_TABLE default\n");
+        for (i = 0; i < g_num_nodes; i++) {
+            fprintf(vtk_file, "%.6e\n", stress_von_mises(g_nodal_stress_spr[i]));
+        }
+        fprintf(vtk_file, "\n");
+    }
+    
     /* Write cell data (element results) */
     fprintf(vtk_file, "CELL_DATA %d\n", g_num_elements);
     
-    /* Write element stresses (placeholder - would calculate actual stresses) */
+    /* Write element centroid stresses */
     fprintf(vtk_file, "SCALARS Von_Mises_Stress float\n");
     fprintf(vtk_file, "LOOKUP_TABLE default\n");
     for (i = 0; i < g_num_elements; i++) {
-        double stress[T6_STRESS_COMPONENTS];
-        double von_mises = 0.0;
-        
-        if (g_element_type[i] == ELEMENT_T6) {
-            err = t6_calculate_element_stress(i, stress);
-            if (err == FEM_SUCCESS) {
-                /* Calculate von Mises stress: sqrt(sx^2 + sy^2 - sx*sy + 3*txy^2) */
-                von_mises = sqrt(stress[0]*stress[0] + stress[1]*stress[1] 
-                               - stress[0]*stress[1] + 3.0*stress[2]*stress[2]);
-            }
-        }
-        fprintf(vtk_file, "%.6e\n", von_mises);
+        const double *stress = output_element_stress(i);
+        fprintf(vtk_file, "%.6e\n", stress ? stress_von_mises(stress) : 0.0);
+    }
+    fprintf(vtk_file, "\n");
+    
+    fprintf(vtk_file, "SCALARS Stress float 3\n");
+    fprintf(vtk_file, "LOOKUP_TABLE default\n");
+    for (i = 0; i < g_num_elements; i++) {
+        const double *stress = output_element_stress(i);
+        fprintf(vtk_file, "%.6e %.6e %.6e\n", stress ? stress[0] : 0.0,
+                stress ? stress[1] : 0.0, stress ? stress[2] : 0.0);
     }
     fprintf(vtk_file, "\n");
     
@@ -456,7 +822,6 @@ fem_error_t output_write_vtk_file(const char *filename)
         fprintf(vtk_file, "%d\n", g_element_material[i] + 1);  /* 1-based for visualization */
     }
     
-    fclose(vtk_file);
     return FEM_SUCCESS;
 }
 
@@ -523,7 +888,9 @@ fem_error_t output_write_nastran_f06_header(output_control_t *output)
     char time_str[26];
 
     time(&current_time);
+    fem_mutex_lock(&g_output_time_mutex);
     strcpy(time_str, ctime(&current_time));
+    fem_mutex_unlock(&g_output_time_mutex);
     time_str[24] = '\0'; /* Remove newline */
 
     fprintf(output->file_ptr,
@@ -549,10 +916,33 @@ fem_error_t output_write_nastran_f06_header(output_control_t *output)
     return FEM_SUCCESS;
 }
 
+/* Append one F06 point row: "%14d      G      " followed by six %13.6E
+ * values (rotations are always zero in 2D) */
+static void output_f06_point_row(output_buffer_t *buf, int id, double t1, double t2, double t3)
+{
+    output_buffer_int(buf, id, 14);
+    output_buffer_puts(buf, "      G      ");
+    output_buffer_exp(buf, t1, 13, 6, 1);
+    output_buffer_puts(buf, "  ");
+    output_buffer_exp(buf, t2, 13, 6, 1);
+    output_buffer_puts(buf, "  ");
+    output_buffer_exp(buf, t3, 13, 6, 1);
+    output_buffer_puts(buf, "   0.000000E+00   0.000000E+00   0.000000E+00\n");
+}
+
+static void output_f06_displacement_row(output_buffer_t *buf, int i, void *context)
+{
+    (void)context;
+    output_f06_point_row(buf, i + 1,   /* Node ID (1-based) */
+                         g_node_displ[i][0],
+                         g_node_displ[i][1],
+                         g_node_displ[i][2]);
+}
+
 /* Write Nastran F06 displacement results */
 fem_error_t output_write_nastran_f06_displacements(output_control_t *output)
 {
-    int i;
+    fem_error_t err;
 
     fprintf(output->file_ptr,
         "1                                                                          D I S P L A C E M E N T   V E C T O R\n"
@@ -560,29 +950,74 @@ fem_error_t output_write_nastran_f06_displacements(output_control_t *output)
         "0\n"
         "      POINT ID.   TYPE          T1             T2             T3             R1             R2             R3\n");
 
-    for (i = 0; i < g_num_nodes; i++) {
-        fprintf(output->file_ptr,
-            "%14d      G      %13.6E  %13.6E  %13.6E  %13.6E  %13.6E  %13.6E\n",
-            i + 1,                     /* Node ID (1-based) */
-            g_node_displ[i][0],        /* T1 (X displacement) */
-            g_node_displ[i][1],        /* T2 (Y displacement) */
-            g_node_displ[i][2],        /* T3 (Z displacement) */
-            0.0,                       /* R1 (X rotation) */
-            0.0,                       /* R2 (Y rotation) */
-            0.0);                      /* R3 (Z rotation) */
-    }
+    err = output_buffer_write_rows(output->file_ptr, g_num_nodes, output_f06_displacement_row, NULL);
+    CHECK_ERROR(err);
 
     fprintf(output->file_ptr, "\n");
     return FEM_SUCCESS;
 }
 
+static void output_f06_stress_row(output_buffer_t *buf, int i, void *context)
+{
+    static const double zero[3] = {0.0, 0.0, 0.0};
+    const double *stress = zero;
+
+    (void)context;
+    /* Recovered centroid stress; elements without one are skipped */
+    if (g_element_type[i] == ELEMENT_T3 || g_element_type[i] == ELEMENT_Q4 ||
+        g_element_type[i] == ELEMENT_T6) {
+        stress = output_element_stress(i);
+    }
+
+    if (stress != NULL) {
+        /* "%8d  Z1 = %8.3E    %13.6E  %13.6E  %13.6E" with fiber distance 0.5 */
+        output_buffer_int(buf, i + 1, 8);
+        output_buffer_puts(buf, "  Z1 = 5.000E-01    ");
+        output_buffer_exp(buf, stress[0], 13, 6, 1);
+        output_buffer_puts(buf, "  ");
+        output_buffer_exp(buf, stress[1], 13, 6, 1);
+        output_buffer_puts(buf, "  ");
+        output_buffer_exp(buf, stress[2], 13, 6, 1);
+        output_buffer_char(buf, '\n');
+    }
+}
+
+/* Solid rows: "%8d  " followed by the six components and von Mises */
+static void output_f06_solid_stress_row(output_buffer_t *buf, int i, void *context)
+{
+    const double *stress = output_solid_stress(i);
+
+    (void)context;
+    if (stress == NULL) {
+        return;
+    }
+    output_buffer_int(buf, i + 1, 8);
+    output_buffer_puts(buf, "  ");
+    for (int k = 0; k < SOLID3D_STRESS_COMPONENTS; k++) {
+        output_buffer_exp(buf, stress[k], 13, 6, 1);
+        output_buffer_puts(buf, "  ");
+    }
+    output_buffer_exp(buf, solid3d_von_mises(stress), 13, 6, 1);
+    output_buffer_char(buf, '\n');
+}
+
 /* Write Nastran F06 stress results */
 fem_error_t output_write_nastran_f06_stresses(output_control_t *output)
 {
-    int i;
-    double stress[3];
     fem_error_t err;
 
+    if (output_is_solid_model()) {
+        fprintf(output->file_ptr,
+            "1                                                            S T R E S S E S   I N   S O L I D   E L E M E N T S\n"
+            "                                                                                                                                                          PAGE    3\n"
+            "0\n"
+            "  ELEMENT       NORMAL-X       NORMAL-Y       NORMAL-Z       SHEAR-XY       SHEAR-YZ       SHEAR-ZX      VON MISES\n");
+        err = output_buffer_write_rows(output->file_ptr, g_num_elements, output_f06_solid_stress_row, NULL);
+        CHECK_ERROR(err);
+        fprintf(output->file_ptr, "\n");
+        return FEM_SUCCESS;
+    }
+
     fprintf(output->file_ptr,
         "1                                                            S T R E S S E S   I N   T R I A N G U L A R   E L E M E N T S    ( T R I A 3 )\n"
         "                                                                                                                                                          PAGE    3\n"
@@ -590,38 +1025,39 @@ fem_error_t output_write_nastran_f06_stresses(output_control_t *output)
         "  ELEMENT      FIBER               STRESSES IN ELEMENT COORD SYSTEM\n"
         "    ID.        DISTANCE           NORMAL-X       NORMAL-Y      SHEAR-XY\n");
 
-    for (i = 0; i < g_num_elements; i++) {
-        /* Calculate element stress (simplified) */
-        if (g_element_type[i] == ELEMENT_T3) {
-            err = t3_element_stress(i, stress);
-        } else if (g_element_type[i] == ELEMENT_Q4) {
-            err = q4_element_stress(i, stress);
-        } else if (g_element_type[i] == ELEMENT_T6) {
-            err = t6_calculate_element_stress(i, stress);
-        } else {
-            stress[0] = stress[1] = stress[2] = 0.0;
-            err = FEM_SUCCESS;
-        }
-
-        if (err == FEM_SUCCESS) {
-            fprintf(output->file_ptr,
-                "%8d  Z1 = %8.3E    %13.6E  %13.6E  %13.6E\n",
-                i + 1,                     /* Element ID (1-based) */
-                0.5,                       /* Fiber distance */
-                stress[0],                 /* Normal-X stress */
-                stress[1],                 /* Normal-Y stress */
-                stress[2]);                /* Shear-XY stress */
-        }
-    }
+    err = output_buffer_write_rows(output->file_ptr, g_num_elements, output_f06_stress_row, NULL);
+    CHECK_ERROR(err);
 
     fprintf(output->file_ptr, "\n");
     return FEM_SUCCESS;
 }
 
+static void output_f06_force_row(output_buffer_t *buf, int i, void *context)
+{
+    (void)context;
+    if (g_node_bc_flags[i][0] || g_node_bc_flags[i][1] || g_node_bc_flags[i][2]) {
+        double rx = 0.0, ry = 0.0, rz = 0.0;
+
+        if (g_node_reaction != NULL) {
+            if (g_node_bc_flags[i][0]) {
+                rx = g_node_reaction[i][0];
+            }
+            if (g_node_bc_flags[i][1]) {
+                ry = g_node_reaction[i][1];
+            }
+            if (g_node_bc_flags[i][2]) {
+                rz = g_node_reaction[i][2];
+            }
+        }
+
+        output_f06_point_row(buf, i + 1, rx, ry, rz);
+    }
+}
+
 /* Write Nastran F06 force results */
 fem_error_t output_write_nastran_f06_forces(output_control_t *output)
-{
-    int i;
+{
+    fem_error_t err;
 
     fprintf(output->file_ptr,
         "1                                                            F O R C E S   A N D   M O M E N T S   I N   S P C   F O R C E S\n"
@@ -629,49 +1065,11 @@ fem_error_t output_write_nastran_f06_forces(output_control_t *output)
         "0\n"
         "      POINT ID.   TYPE          T1             T2             T3             R1             R2             R3\n");
 
-    double *ku = NULL;
-    if (g_total_dof > 0) {
-        ku = malloc((size_t)g_total_dof * sizeof(double));
-        if (ku == NULL) {
-            return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate reaction workspace");
-        }
-
-        fem_error_t err = cg_matrix_vector_multiply(NULL, g_global_displ, ku, g_total_dof);
-        if (err != FEM_SUCCESS) {
-            free(ku);
-            return err;
-        }
-    }
+    /* Reactions recovered from the constrained rows of K kept before the
+     * boundary conditions were applied */
+    err = output_buffer_write_rows(output->file_ptr, g_num_nodes, output_f06_force_row, NULL);
+    CHECK_ERROR(err);
 
-    for (i = 0; i < g_num_nodes; i++) {
-        if (g_node_bc_flags[i][0] || g_node_bc_flags[i][1] || g_node_bc_flags[i][2]) {
-            double rx = 0.0, ry = 0.0, rz = 0.0;
-
-            if (ku != NULL) {
-                if (g_node_bc_flags[i][0]) {
-                    rx = ku[i * 2] - g_global_force[i * 2];
-                }
-                if (g_node_bc_flags[i][1]) {
-                    ry = ku[i * 2 + 1] - g_global_force[i * 2 + 1];
-                }
-            }
-
-            fprintf(output->file_ptr,
-                "%14d      G      %13.6E  %13.6E  %13.6E  %13.6E  %13.6E  %13.6E\n",
-                i + 1,
-                rx,
-                ry,
-                rz,
-                0.0,
-                0.0,
-                0.0);
-        }
-    }
-
-    if (ku) {
-        free(ku);
-    }
-
     fprintf(output->file_ptr, "\n1                                         * * * E N D   O F   J O B * * *\n");
     return FEM_SUCCESS;
 }
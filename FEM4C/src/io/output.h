@@ -47,6 +47,8 @@ fem_error_t output_write_vtk_header(output_control_t *output);
 fem_error_t output_write_vtk_nodes(output_control_t *output);
 fem_error_t output_write_vtk_elements(output_control_t *output);
 fem_error_t output_write_vtk_displacement_field(output_control_t *output);
+fem_error_t output_write_vtk_geometry(FILE *vtk_file);
+fem_error_t output_write_vtk_results(FILE *vtk_file);
 
 /* Nastran F06 format writers */
 fem_error_t output_write_nastran_f06(output_control_t *output);
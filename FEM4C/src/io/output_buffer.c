@@ -0,0 +1,352 @@
+/* FEM4C - Buffered result output implementation
+ *
+ * The number formatters produce exactly the text printf would. The fast
+ * paths scale by an exactly representable power of ten (one rounding) and
+ * only round the integer mantissa themselves when the scaled value is not
+ * within its rounding error of a half-way point; anything else (ties, very
+ * large or small magnitudes, NaN/Inf) is handed to snprintf.
+ */
+
+#include "output_buffer.h"
+#include "../common/error.h"
+#include "../common/fem_context.h"
+#include "../common/fem_memory.h"
+#include <float.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define OUTPUT_BUFFER_INITIAL_CAPACITY 65536
+#define OUTPUT_FAST_MAX_PRECISION 15
+
+static const double k_pow10[23] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int output_buffer_reserve(output_buffer_t *buf, size_t extra)
+{
+    if (buf->failed) {
+        return 0;
+    }
+    if (buf->length + extra <= buf->capacity) {
+        return 1;
+    }
+
+    size_t capacity = buf->capacity > 0 ? buf->capacity : OUTPUT_BUFFER_INITIAL_CAPACITY;
+    while (capacity < buf->length + extra) {
+        capacity *= 2;
+    }
+    char *data = (char *)fem_realloc(buf->data, capacity, FEM_MEMORY_IO);
+    if (!data) {
+        buf->failed = 1;
+        return 0;
+    }
+    buf->data = data;
+    buf->capacity = capacity;
+    return 1;
+}
+
+static void output_buffer_printf(output_buffer_t *buf, const char *format, ...)
+{
+    va_list args;
+    char small[64];
+    int n;
+
+    va_start(args, format);
+    n = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (n < 0) {
+        buf->failed = 1;
+        return;
+    }
+    if ((size_t)n < sizeof(small)) {
+        output_buffer_append(buf, small, (size_t)n);
+        return;
+    }
+
+    if (!output_buffer_reserve(buf, (size_t)n + 1)) {
+        return;
+    }
+    va_start(args, format);
+    vsnprintf(buf->data + buf->length, (size_t)n + 1, format, args);
+    va_end(args);
+    buf->length += (size_t)n;
+}
+
+static void output_buffer_padded(output_buffer_t *buf, const char *text, size_t length, int width)
+{
+    size_t pad = width > 0 && (size_t)width > length ? (size_t)width - length : 0;
+    if (!output_buffer_reserve(buf, pad + length)) {
+        return;
+    }
+    memset(buf->data + buf->length, ' ', pad);
+    memcpy(buf->data + buf->length + pad, text, length);
+    buf->length += pad + length;
+}
+
+/* Round scaled (>= 0, computed with one rounding) to the nearest integer.
+ * Returns 0 when the scaled value is too close to a tie to decide. */
+static int output_round_scaled(double scaled, unsigned long long *result)
+{
+    double whole = floor(scaled);
+    double frac = scaled - whole;
+    if (fabs(frac - 0.5) <= scaled * 4.0 * DBL_EPSILON) {
+        return 0;
+    }
+    *result = (unsigned long long)whole + (frac > 0.5 ? 1ULL : 0ULL);
+    return 1;
+}
+
+/* Write the decimal digits of value right-aligned into end[-count..-1] */
+static void output_put_digits(char *end, unsigned long long value, int count)
+{
+    for (int i = 1; i <= count; ++i) {
+        end[-i] = (char)('0' + (int)(value % 10ULL));
+        value /= 10ULL;
+    }
+}
+
+void output_buffer_init(output_buffer_t *buf)
+{
+    buf->data = NULL;
+    buf->length = 0;
+    buf->capacity = 0;
+    buf->failed = 0;
+}
+
+void output_buffer_free(output_buffer_t *buf)
+{
+    fem_free(buf->data);
+    output_buffer_init(buf);
+}
+
+void output_buffer_reset(output_buffer_t *buf)
+{
+    buf->length = 0;
+}
+
+void output_buffer_append(output_buffer_t *buf, const char *text, size_t length)
+{
+    if (!output_buffer_reserve(buf, length)) {
+        return;
+    }
+    memcpy(buf->data + buf->length, text, length);
+    buf->length += length;
+}
+
+void output_buffer_puts(output_buffer_t *buf, const char *text)
+{
+    output_buffer_append(buf, text, strlen(text));
+}
+
+void output_buffer_char(output_buffer_t *buf, char c)
+{
+    if (!output_buffer_reserve(buf, 1)) {
+        return;
+    }
+    buf->data[buf->length++] = c;
+}
+
+void output_buffer_int(output_buffer_t *buf, int value, int width)
+{
+    char text[16];
+    int pos = (int)sizeof(text);
+    unsigned int magnitude = value < 0 ? 0U - (unsigned int)value : (unsigned int)value;
+
+    do {
+        text[--pos] = (char)('0' + (int)(magnitude % 10U));
+        magnitude /= 10U;
+    } while (magnitude != 0U);
+    if (value < 0) {
+        text[--pos] = '-';
+    }
+    output_buffer_padded(buf, text + pos, sizeof(text) - (size_t)pos, width);
+}
+
+void output_buffer_fixed(output_buffer_t *buf, double value, int precision)
+{
+    double magnitude = fabs(value);
+    unsigned long long scaled_int;
+
+    if (!isfinite(value) || precision < 0 || precision > OUTPUT_FAST_MAX_PRECISION ||
+        magnitude * k_pow10[precision] >= 1e15 ||
+        !output_round_scaled(magnitude * k_pow10[precision], &scaled_int)) {
+        output_buffer_printf(buf, "%.*f", precision, value);
+        return;
+    }
+
+    /* sign + 16 integer digits + '.' + fraction */
+    char text[40];
+    char *end = text + sizeof(text);
+    unsigned long long unit = (unsigned long long)k_pow10[precision];
+    unsigned long long integer_part = scaled_int / unit;
+    char *p = end;
+
+    if (precision > 0) {
+        output_put_digits(p, scaled_int % unit, precision);
+        p -= precision;
+        *--p = '.';
+    }
+    do {
+        *--p = (char)('0' + (int)(integer_part % 10ULL));
+        integer_part /= 10ULL;
+    } while (integer_part != 0ULL);
+    if (signbit(value)) {
+        *--p = '-';
+    }
+    output_buffer_append(buf, p, (size_t)(end - p));
+}
+
+/* Split magnitude (> 0) into precision+1 rounded significant digits and a
+ * decimal exponent. Returns 0 if the fast path cannot guarantee printf's
+ * rounding. */
+static int output_exp_digits(double magnitude, int precision,
+                             unsigned long long *digits, int *exponent)
+{
+    int e = (int)floor(log10(magnitude));
+
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        int shift = precision - e;
+        double scaled;
+        unsigned long long rounded;
+
+        if (shift > 22 || shift < -22) {
+            return 0;
+        }
+        scaled = shift >= 0 ? magnitude * k_pow10[shift] : magnitude / k_pow10[-shift];
+        if (scaled < k_pow10[precision]) {
+            e--;
+            continue;
+        }
+        if (scaled >= k_pow10[precision + 1]) {
+            e++;
+            continue;
+        }
+        if (!output_round_scaled(scaled, &rounded)) {
+            return 0;
+        }
+        if (rounded >= (unsigned long long)k_pow10[precision + 1]) {
+            rounded /= 10ULL;
+            e++;
+        }
+        *digits = rounded;
+        *exponent = e;
+        return 1;
+    }
+    return 0;
+}
+
+void output_buffer_exp(output_buffer_t *buf, double value, int width, int precision, int upper)
+{
+    unsigned long long digits = 0;
+    int exponent = 0;
+
+    if (!isfinite(value) || precision < 0 || precision > OUTPUT_FAST_MAX_PRECISION ||
+        (value != 0.0 && !output_exp_digits(fabs(value), precision, &digits, &exponent))) {
+        output_buffer_printf(buf, upper ? "%*.*E" : "%*.*e", width, precision, value);
+        return;
+    }
+
+    /* sign + d + '.' + 15 digits + e+NNN */
+    char text[32];
+    char *p = text;
+    unsigned int exp_abs = (unsigned int)(exponent < 0 ? -exponent : exponent);
+
+    if (signbit(value)) {
+        *p++ = '-';
+    }
+    output_put_digits(p + 1 + (precision > 0 ? 1 + precision : 0), digits % (unsigned long long)k_pow10[precision], precision);
+    *p++ = (char)('0' + (int)(digits / (unsigned long long)k_pow10[precision]));
+    if (precision > 0) {
+        *p++ = '.';
+        p += precision;
+    }
+    *p++ = upper ? 'E' : 'e';
+    *p++ = exponent < 0 ? '-' : '+';
+    if (exp_abs >= 100U) {
+        *p++ = (char)('0' + exp_abs / 100U);
+        exp_abs %= 100U;
+    }
+    *p++ = (char)('0' + exp_abs / 10U);
+    *p++ = (char)('0' + exp_abs % 10U);
+    output_buffer_padded(buf, text, (size_t)(p - text), width);
+}
+
+fem_error_t output_buffer_flush(output_buffer_t *buf, FILE *fp)
+{
+    if (buf->failed) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to grow output buffer");
+    }
+    if (buf->length > 0 && fwrite(buf->data, 1, buf->length, fp) != buf->length) {
+        return error_set(FEM_ERROR_FILE_WRITE, "Failed to write %lu bytes of output",
+                         (unsigned long)buf->length);
+    }
+    buf->length = 0;
+    return FEM_SUCCESS;
+}
+
+/* Format rows 0..rows-1 with writer and write them in row order. Each batch
+ * gives every thread one chunk of OUTPUT_BUFFER_ROWS_PER_CHUNK rows; the
+ * chunk buffers are then written sequentially, so memory stays bounded and
+ * the file content does not depend on the thread count. */
+fem_error_t output_buffer_write_rows(FILE *fp, int rows, output_row_writer_t writer, void *context)
+{
+    int nbuffers = 1;
+    output_buffer_t *buffers;
+    fem_error_t err = FEM_SUCCESS;
+    const long long chunk = OUTPUT_BUFFER_ROWS_PER_CHUNK;
+    fem_context_t *model = g_fem_context;
+
+#ifdef _OPENMP
+    nbuffers = omp_get_max_threads();
+    if (nbuffers < 1) {
+        nbuffers = 1;
+    }
+#endif
+
+    buffers = (output_buffer_t *)fem_malloc((size_t)nbuffers * sizeof(output_buffer_t),
+                                             FEM_MEMORY_IO);
+    if (!buffers) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate output buffers");
+    }
+    for (int b = 0; b < nbuffers; ++b) {
+        output_buffer_init(&buffers[b]);
+    }
+
+    for (long long start = 0; start < rows && err == FEM_SUCCESS; start += chunk * nbuffers) {
+        int b;
+#ifdef _OPENMP
+        #pragma omp parallel if (rows - start > chunk)
+#endif
+        {
+            /* Row writers read the model of the calling thread's context */
+            fem_context_bind(model);
+#ifdef _OPENMP
+            #pragma omp for schedule(static, 1)
+#endif
+            for (b = 0; b < nbuffers; ++b) {
+                long long first = start + b * chunk;
+                long long last = first + chunk < rows ? first + chunk : rows;
+                output_buffer_reset(&buffers[b]);
+                for (long long row = first; row < last; ++row) {
+                    writer(&buffers[b], (int)row, context);
+                }
+            }
+        }
+        for (b = 0; b < nbuffers && err == FEM_SUCCESS; ++b) {
+            err = output_buffer_flush(&buffers[b], fp);
+        }
+    }
+
+    for (int b = 0; b < nbuffers; ++b) {
+        output_buffer_free(&buffers[b]);
+    }
+    fem_free(buffers);
+    return err;
+}
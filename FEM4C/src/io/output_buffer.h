@@ -0,0 +1,45 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+/* FEM4C - Buffered result output
+ * Growable text buffers with printf-compatible number formatting, and a
+ * row writer that formats blocks of rows in parallel and writes them in
+ * order with large fwrite calls.
+ */
+
+#include "../common/types.h"
+#include <stddef.h>
+#include <stdio.h>
+
+/* Rows formatted per chunk (one chunk per thread per batch) */
+#define OUTPUT_BUFFER_ROWS_PER_CHUNK 4096
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    int failed;             /* Set when an allocation failed */
+} output_buffer_t;
+
+/* Formats one row into buf; may append nothing */
+typedef void (*output_row_writer_t)(output_buffer_t *buf, int row, void *context);
+
+void output_buffer_init(output_buffer_t *buf);
+void output_buffer_free(output_buffer_t *buf);
+void output_buffer_reset(output_buffer_t *buf);
+
+void output_buffer_append(output_buffer_t *buf, const char *text, size_t length);
+void output_buffer_puts(output_buffer_t *buf, const char *text);
+void output_buffer_char(output_buffer_t *buf, char c);
+
+/* Same text as printf("%*d", width, value) */
+void output_buffer_int(output_buffer_t *buf, int value, int width);
+/* Same text as printf("%.*f", precision, value) */
+void output_buffer_fixed(output_buffer_t *buf, double value, int precision);
+/* Same text as printf("%*.*e", ...) or "%*.*E" when upper is nonzero */
+void output_buffer_exp(output_buffer_t *buf, double value, int width, int precision, int upper);
+
+fem_error_t output_buffer_flush(output_buffer_t *buf, FILE *fp);
+fem_error_t output_buffer_write_rows(FILE *fp, int rows, output_row_writer_t writer, void *context);
+
+#endif /* OUTPUT_BUFFER_H */
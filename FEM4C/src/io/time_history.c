@@ -0,0 +1,46 @@
+/* FEM4C - Time history output
+ */
+
+#include "time_history.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include <stdint.h>
+
+fem_error_t time_history_open(const char *filename, int dofs_per_node, double dt,
+                              int interval, FILE **fp)
+{
+    static const char magic[8] = {'F', 'E', 'M', '4', 'C', 'T', 'H', '1'};
+    int32_t nodes = (int32_t)g_num_nodes;
+    int32_t dofs = (int32_t)dofs_per_node;
+    int32_t every = (int32_t)interval;
+    FILE *file = fopen(filename, "wb");
+
+    *fp = NULL;
+    if (!file) {
+        return error_set(FEM_ERROR_FILE_WRITE, "Cannot create time history file %s", filename);
+    }
+    if (fwrite(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+        fwrite(&nodes, sizeof(nodes), 1, file) != 1 ||
+        fwrite(&dofs, sizeof(dofs), 1, file) != 1 ||
+        fwrite(&dt, sizeof(dt), 1, file) != 1 ||
+        fwrite(&every, sizeof(every), 1, file) != 1) {
+        fclose(file);
+        return error_set(FEM_ERROR_FILE_WRITE, "Failed to write time history header to %s",
+                         filename);
+    }
+    *fp = file;
+    return FEM_SUCCESS;
+}
+
+fem_error_t time_history_write(FILE *fp, int step, double time, const double *u, int n)
+{
+    int32_t step32 = (int32_t)step;
+
+    if (fwrite(&step32, sizeof(step32), 1, fp) != 1 ||
+        fwrite(&time, sizeof(time), 1, fp) != 1 ||
+        fwrite(u, sizeof(double), (size_t)n, fp) != (size_t)n ||
+        fflush(fp) != 0) {
+        return error_set(FEM_ERROR_FILE_WRITE, "Failed to write time history frame %d", step);
+    }
+    return FEM_SUCCESS;
+}
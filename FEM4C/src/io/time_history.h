@@ -0,0 +1,24 @@
+#ifndef TIME_HISTORY_H
+#define TIME_HISTORY_H
+
+/* FEM4C - Time history output
+ * Binary displacement history of the dynamic analyses, one frame per
+ * output step, flushed after every frame so the file can be read while
+ * the run continues:
+ *     header  char[8] "FEM4CTH1", int32 nodes, int32 DOFs per node,
+ *             double dt, int32 steps between frames
+ *     frame   int32 step, double time, double u[nodes * DOFs per node]
+ * Native byte order, no padding.
+ */
+
+#include <stdio.h>
+#include "../common/types.h"
+
+/* Create filename and write the header */
+fem_error_t time_history_open(const char *filename, int dofs_per_node, double dt,
+                              int interval, FILE **fp);
+
+/* Append one frame of g_num_nodes * dofs_per_node values */
+fem_error_t time_history_write(FILE *fp, int step, double time, const double *u, int n);
+
+#endif /* TIME_HISTORY_H */
@@ -0,0 +1,350 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Mesh validation and element quality implementation
+ */
+
+#include "mesh_quality.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_log.h"
+#include "../elements/t3/t3_element.h"
+#include "../elements/q4/q4_element.h"
+#include "../elements/t6/t6_element.h"
+#include "../elements/solid3d/solid3d_element.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Below this many elements the pass runs on the calling thread only */
+#define MESH_QUALITY_PARALLEL_MIN 256
+
+/* Area, aspect ratio and shape quality from the corner nodes. Triangles
+ * use 4*sqrt(3)*A / sum(l^2), quadrilaterals 4*A / sum(l^2); both are 1
+ * for the regular shape and fall to 0 as the element degenerates. */
+static void mesh_measure_corners(int element_id, int corners, element_quality_t *quality)
+{
+    double x[4], y[4];
+    double area = 0.0;
+    double sum_l2 = 0.0;
+    double min_l2 = DBL_MAX;
+    double max_l2 = 0.0;
+
+    for (int i = 0; i < corners; ++i) {
+        int node = g_element_nodes[element_id][i];
+        x[i] = g_node_coords[node][0];
+        y[i] = g_node_coords[node][1];
+    }
+    for (int i = 0; i < corners; ++i) {
+        int j = (i + 1) % corners;
+        double dx = x[j] - x[i];
+        double dy = y[j] - y[i];
+        double l2 = dx * dx + dy * dy;
+        area += x[i] * y[j] - x[j] * y[i];
+        sum_l2 += l2;
+        if (l2 < min_l2) {
+            min_l2 = l2;
+        }
+        if (l2 > max_l2) {
+            max_l2 = l2;
+        }
+    }
+    area *= 0.5;
+
+    quality->area = area;
+    quality->aspect_ratio = min_l2 > 0.0 ? sqrt(max_l2 / min_l2) : DBL_MAX;
+    if (area > 0.0 && sum_l2 > 0.0) {
+        double q = (corners == 3 ? 4.0 * sqrt(3.0) : 4.0) * area / sum_l2;
+        quality->quality = q < 1.0 ? q : 1.0;
+    } else {
+        quality->quality = 0.0;
+    }
+}
+
+/* Jacobian determinants at the Gauss points the stiffness kernels use,
+ * computed with the kernels' own Jacobian routines */
+static void mesh_measure_jacobians(int element_id, int type, element_quality_t *quality)
+{
+    double J[2][2];
+    int points = 0;
+    fem_error_t err = FEM_SUCCESS;
+
+    switch (type) {
+        case ELEMENT_T3:
+            points = 1;
+            err = t3_jacobian_matrix(element_id, 1.0/3.0, 1.0/3.0, J, &quality->det_j[0]);
+            break;
+        case ELEMENT_Q4:
+            points = Q4_GAUSS_POINTS;
+            for (int gp = 0; gp < points && err == FEM_SUCCESS; ++gp) {
+                err = q4_jacobian_matrix(element_id, g_q4_gauss_points[gp][0],
+                                         g_q4_gauss_points[gp][1], J, &quality->det_j[gp]);
+            }
+            break;
+        case ELEMENT_T6:
+            points = T6_GAUSS_POINTS;
+            for (int gp = 0; gp < points && err == FEM_SUCCESS; ++gp) {
+                err = t6_jacobian_matrix(element_id, g_t6_gauss_points[gp][0],
+                                         g_t6_gauss_points[gp][1], J, &quality->det_j[gp]);
+            }
+            break;
+        default:
+            return;
+    }
+
+    if (err != FEM_SUCCESS) {
+        return;
+    }
+    quality->has_det_j = 1;
+    quality->min_det_j = quality->det_j[0];
+    for (int gp = 1; gp < points; ++gp) {
+        if (quality->det_j[gp] < quality->min_det_j) {
+            quality->min_det_j = quality->det_j[gp];
+        }
+    }
+}
+
+/* Solids: volume and Jacobians from the stiffness rule, aspect ratio from
+ * the corner edges. Tetrahedra use 6*sqrt(2)*V / l_rms^3, hexahedra
+ * V / l_rms^3, again 1 for the regular shape. */
+static void mesh_measure_solid(int element_id, int type, element_quality_t *quality)
+{
+    static const int tet_edges[6][2] = {
+        {0, 1}, {1, 2}, {2, 0}, {0, 3}, {1, 3}, {2, 3}
+    };
+    static const int hex_edges[12][2] = {
+        {0, 1}, {1, 2}, {2, 3}, {3, 0}, {4, 5}, {5, 6},
+        {6, 7}, {7, 4}, {0, 4}, {1, 5}, {2, 6}, {3, 7}
+    };
+    const int (*edges)[2] = type == ELEMENT_H8 ? hex_edges : tet_edges;
+    int edge_count = type == ELEMENT_H8 ? 12 : 6;
+    double det_j[SOLID3D_MAX_GAUSS_POINTS];
+    double volume, min_det_j;
+    double sum_l2 = 0.0;
+    double min_l2 = DBL_MAX;
+    double max_l2 = 0.0;
+
+    if (solid3d_measure_element(element_id, &volume, &min_det_j, det_j) != FEM_SUCCESS) {
+        return;
+    }
+    quality->validated = 1;
+
+    for (int k = 0; k < edge_count; ++k) {
+        const double *a = g_node_coords[g_element_nodes[element_id][edges[k][0]]];
+        const double *b = g_node_coords[g_element_nodes[element_id][edges[k][1]]];
+        double dx = b[0] - a[0];
+        double dy = b[1] - a[1];
+        double dz = b[2] - a[2];
+        double l2 = dx * dx + dy * dy + dz * dz;
+        sum_l2 += l2;
+        if (l2 < min_l2) {
+            min_l2 = l2;
+        }
+        if (l2 > max_l2) {
+            max_l2 = l2;
+        }
+    }
+
+    quality->area = volume;
+    quality->min_det_j = min_det_j;
+    quality->aspect_ratio = min_l2 > 0.0 ? sqrt(max_l2 / min_l2) : DBL_MAX;
+    if (sum_l2 > 0.0) {
+        double l_rms = sqrt(sum_l2 / edge_count);
+        double q = (type == ELEMENT_H8 ? 1.0 : 6.0 * sqrt(2.0)) * volume / (l_rms * l_rms * l_rms);
+        quality->quality = q < 1.0 ? q : 1.0;
+    }
+
+    /* The cache holds up to ELEMENT_QUALITY_MAX_POINTS determinants */
+    const solid3d_rule_t *rule = solid3d_rule(type);
+    if (rule->gauss_points <= ELEMENT_QUALITY_MAX_POINTS) {
+        memcpy(quality->det_j, det_j, (size_t)rule->gauss_points * sizeof(double));
+        quality->has_det_j = 1;
+    }
+}
+
+static void mesh_measure_element(int element_id, element_quality_t *quality)
+{
+    int type = g_element_type[element_id];
+    fem_error_t err;
+
+    memset(quality, 0, sizeof(*quality));
+    switch (type) {
+        case ELEMENT_T3:
+            err = t3_validate_element(element_id);
+            break;
+        case ELEMENT_Q4:
+            err = q4_validate_element(element_id);
+            break;
+        case ELEMENT_T6:
+            err = t6_validate_element(element_id);
+            break;
+        case ELEMENT_T4:
+        case ELEMENT_T10:
+        case ELEMENT_H8:
+            mesh_measure_solid(element_id, type, quality);
+            return;
+        default:
+            return;
+    }
+    if (err != FEM_SUCCESS) {
+        return;
+    }
+
+    quality->validated = 1;
+    mesh_measure_corners(element_id, type == ELEMENT_Q4 ? 4 : 3, quality);
+    mesh_measure_jacobians(element_id, type, quality);
+}
+
+static void mesh_report_quality(const element_quality_t *quality, int count)
+{
+    int bins[MESH_QUALITY_BINS] = {0};
+    int validated = 0;
+    int worst = -1;
+    double sum = 0.0;
+    double max_aspect = 0.0;
+
+    for (int e = 0; e < count; ++e) {
+        int bin;
+        if (!quality[e].validated) {
+            continue;
+        }
+        validated++;
+        sum += quality[e].quality;
+        if (worst < 0 || quality[e].quality < quality[worst].quality) {
+            worst = e;
+        }
+        if (quality[e].aspect_ratio > max_aspect) {
+            max_aspect = quality[e].aspect_ratio;
+        }
+        bin = quality[e].quality > 0.0 ? (int)(quality[e].quality * MESH_QUALITY_BINS) : 0;
+        bins[bin < MESH_QUALITY_BINS ? bin : MESH_QUALITY_BINS - 1]++;
+    }
+    if (validated == 0) {
+        return;
+    }
+
+    FEM_LOG_INFO("    Element quality: min %.4f (element %d), mean %.4f, max aspect ratio %.3f\n",
+                 quality[worst].quality, g_element_ids ? g_element_ids[worst] : worst + 1,
+                 sum / validated, max_aspect);
+    for (int b = 0; b < MESH_QUALITY_BINS; ++b) {
+        FEM_LOG_INFO("      %.1f-%.1f: %d\n", (double)b / MESH_QUALITY_BINS,
+                     (double)(b + 1) / MESH_QUALITY_BINS, bins[b]);
+    }
+    if (validated < count) {
+        FEM_LOG_INFO("      rejected: %d\n", count - validated);
+    }
+}
+
+fem_error_t mesh_quality_reserve(int count)
+{
+    element_quality_t *quality;
+
+    if (count <= g_element_quality_capacity) {
+        return FEM_SUCCESS;
+    }
+    quality = (element_quality_t *)fem_realloc(g_element_quality,
+                                               (size_t)count * sizeof(element_quality_t),
+                                               FEM_MEMORY_MESH);
+    if (quality == NULL) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Failed to allocate element quality cache (%d elements)", count);
+    }
+    g_element_quality = quality;
+    g_element_quality_capacity = count;
+    return FEM_SUCCESS;
+}
+
+fem_error_t mesh_validate_range(int first, int last)
+{
+    element_quality_t *quality;
+    fem_context_t *model = g_fem_context;
+    fem_error_t err;
+
+    if (first != g_element_quality_count) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Element quality range starts at %d, cache holds %d elements",
+                         first, g_element_quality_count);
+    }
+    if (last <= first) {
+        return FEM_SUCCESS;
+    }
+    err = mesh_quality_reserve(last);
+    CHECK_ERROR(err);
+    quality = g_element_quality;
+
+#ifdef _OPENMP
+    #pragma omp parallel if (last - first >= MESH_QUALITY_PARALLEL_MIN)
+#endif
+    {
+        /* The element routines read the model of the bound context */
+        fem_context_bind(model);
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int e = first; e < last; ++e) {
+            mesh_measure_element(e, &quality[e]);
+        }
+    }
+
+    g_element_quality_count = last;
+    return FEM_SUCCESS;
+}
+
+fem_error_t mesh_quality_update(const int *elements, int count)
+{
+    element_quality_t *quality;
+    fem_context_t *model = g_fem_context;
+    fem_error_t err;
+
+    err = mesh_quality_reserve(g_num_elements);
+    CHECK_ERROR(err);
+    quality = g_element_quality;
+
+#ifdef _OPENMP
+    #pragma omp parallel if (count >= MESH_QUALITY_PARALLEL_MIN)
+#endif
+    {
+        fem_context_bind(model);
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int i = 0; i < count; ++i) {
+            mesh_measure_element(elements[i], &quality[elements[i]]);
+        }
+    }
+
+    g_element_quality_count = g_num_elements;
+    return FEM_SUCCESS;
+}
+
+void mesh_quality_report(void)
+{
+    mesh_report_quality(g_element_quality, g_element_quality_count);
+}
+
+fem_error_t mesh_validate_elements(void)
+{
+    fem_error_t err;
+
+    g_element_quality_count = 0;
+    if (g_num_elements <= 0) {
+        return FEM_SUCCESS;
+    }
+    err = mesh_validate_range(0, g_num_elements);
+    CHECK_ERROR(err);
+
+    mesh_quality_report();
+    return FEM_SUCCESS;
+}
+
+const element_quality_t *mesh_validated_element(int element_id)
+{
+    if (element_id < 0 || element_id >= g_element_quality_count ||
+        !g_element_quality[element_id].validated) {
+        return NULL;
+    }
+    return &g_element_quality[element_id];
+}
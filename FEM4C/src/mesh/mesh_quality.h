@@ -0,0 +1,41 @@
+#ifndef MESH_QUALITY_H
+#define MESH_QUALITY_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Mesh validation and element quality
+ *
+ * One pass over all elements (OpenMP-parallel when available) runs the
+ * element-type validity check and records the corner area, the Jacobian
+ * determinant at the stiffness Gauss points, the edge aspect ratio and a
+ * shape quality in g_element_quality. Stiffness and stress kernels use
+ * the cache to skip their own validation and Jacobian evaluations. The
+ * cache is dropped when the mesh is reset or freed. Pipelined
+ * preprocessing fills it block by block with mesh_validate_range while the
+ * input is still being read.
+ */
+
+#include "../common/types.h"
+
+#define MESH_QUALITY_BINS 10
+
+/* Validate every element and fill the geometry cache. Invalid elements
+ * are only marked (validated = 0); callers report them. Prints the
+ * quality histogram. */
+fem_error_t mesh_validate_elements(void);
+
+/* Extend the cache from first (= g_element_quality_count) to last */
+fem_error_t mesh_quality_reserve(int count);
+fem_error_t mesh_validate_range(int first, int last);
+
+/* Re-measure the listed elements after the mesh has been edited in place
+ * (mesh_refine.h). The list must cover every element past the cached
+ * count; afterwards the cache holds all g_num_elements entries. */
+fem_error_t mesh_quality_update(const int *elements, int count);
+
+/* Quality histogram of the cached elements */
+void mesh_quality_report(void);
+
+/* Cached entry of a validated element, NULL if it has none */
+const element_quality_t *mesh_validated_element(int element_id);
+
+#endif /* MESH_QUALITY_H */
@@ -0,0 +1,625 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Mesh refinement implementation
+ */
+
+#include "mesh_refine.h"
+#include "mesh_quality.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_log.h"
+#include "../common/fem_memory.h"
+#include "../elements/t3/t3_element.h"
+#include "../elements/t6/t6_element.h"
+#include <string.h>
+
+#define REFINE_CORNERS 3
+#define REFINE_MAX_CHILDREN 4
+/* Upper bound of the nodes one T6 parent adds: a midside node on each
+ * edge of four children */
+#define REFINE_T6_NODES_PER_PARENT 12
+
+/* Open-addressing map from an unordered node pair to an index */
+typedef struct {
+    int capacity;               /* power of two, at least twice the entries */
+    int (*keys)[2];             /* smaller node, larger node; -1: empty slot */
+    int *values;
+} refine_pair_map_t;
+
+/* A point of the parent element: natural coordinates, the node there and
+ * the parent edges through it (bit k: edge k, joining corners k and k + 1) */
+typedef struct {
+    double xi, eta;
+    int node;
+    int edges;
+} refine_point_t;
+
+typedef struct {
+    int type;                   /* ELEMENT_T3 or ELEMENT_T6 */
+    int element_nodes;          /* nodes per element */
+    int element_count;          /* elements before refinement */
+    refine_pair_map_t edges;    /* corner pair -> edge */
+    int edge_count;
+    int (*edge_elements)[2];    /* adjacent elements; [1] = -1 on the boundary */
+    unsigned char *edge_marked;
+    int (*element_edges)[REFINE_CORNERS];
+    unsigned char *longest;     /* local index of the longest edge */
+    refine_pair_map_t midpoints; /* node pair -> node created between them */
+    int node_count;             /* nodes before refinement */
+    int *node_anchor;           /* lowest parent node of each new node */
+    int next_node_id;
+    int next_element_id;
+} refine_state_t;
+
+static const refine_point_t g_refine_corners[REFINE_CORNERS] = {
+    {0.0, 0.0, -1, 0x5}, {1.0, 0.0, -1, 0x3}, {0.0, 1.0, -1, 0x6}
+};
+
+static fem_error_t refine_map_init(refine_pair_map_t *map, int entries)
+{
+    int capacity = 16;
+
+    while (capacity < 2 * entries) {
+        capacity *= 2;
+    }
+    map->capacity = capacity;
+    map->keys = fem_arena_alloc(&g_scratch_arena, (size_t)capacity * sizeof(*map->keys));
+    map->values = fem_arena_alloc(&g_scratch_arena, (size_t)capacity * sizeof(int));
+    if (!map->keys || !map->values) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Failed to allocate refinement map (%d entries)", entries);
+    }
+    for (int i = 0; i < capacity; ++i) {
+        map->keys[i][0] = -1;
+    }
+    return FEM_SUCCESS;
+}
+
+/* Slot of the pair (a, b); with insert, an absent pair gets a new slot
+ * holding -1, otherwise NULL is returned for it */
+static int *refine_map_slot(refine_pair_map_t *map, int a, int b, int insert)
+{
+    unsigned int mask = (unsigned int)map->capacity - 1u;
+    unsigned int i;
+
+    if (a > b) {
+        int t = a; a = b; b = t;
+    }
+    i = ((unsigned int)a * 2654435761u) ^ ((unsigned int)b * 2246822519u);
+    for (i ^= i >> 15; ; i++) {
+        i &= mask;
+        if (map->keys[i][0] < 0) {
+            if (!insert) {
+                return NULL;
+            }
+            map->keys[i][0] = a;
+            map->keys[i][1] = b;
+            map->values[i] = -1;
+            return &map->values[i];
+        }
+        if (map->keys[i][0] == a && map->keys[i][1] == b) {
+            return &map->values[i];
+        }
+    }
+}
+
+static int refine_edge_marked(refine_state_t *state, int a, int b)
+{
+    int *edge = refine_map_slot(&state->edges, a, b, 0);
+    return edge != NULL && state->edge_marked[*edge];
+}
+
+/* Edges, their adjacent elements and the longest edge of every element */
+static fem_error_t refine_build_edges(refine_state_t *state)
+{
+    int elements = state->element_count;
+    size_t max_edges = (size_t)elements * REFINE_CORNERS;
+    fem_error_t err;
+
+    err = refine_map_init(&state->edges, (int)max_edges);
+    CHECK_ERROR(err);
+    state->edge_elements = fem_arena_alloc(&g_scratch_arena, max_edges * sizeof(*state->edge_elements));
+    state->edge_marked = fem_arena_alloc(&g_scratch_arena, max_edges);
+    state->element_edges = fem_arena_alloc(&g_scratch_arena,
+                                           (size_t)elements * sizeof(*state->element_edges));
+    state->longest = fem_arena_alloc(&g_scratch_arena, (size_t)elements);
+    if (!state->edge_elements || !state->edge_marked || !state->element_edges || !state->longest) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate refinement edges");
+    }
+    memset(state->edge_marked, 0, max_edges);
+
+    state->edge_count = 0;
+    for (int e = 0; e < elements; ++e) {
+        double longest = -1.0;
+
+        for (int k = 0; k < REFINE_CORNERS; ++k) {
+            int a = g_element_nodes[e][k];
+            int b = g_element_nodes[e][(k + 1) % REFINE_CORNERS];
+            double dx = g_node_coords[b][0] - g_node_coords[a][0];
+            double dy = g_node_coords[b][1] - g_node_coords[a][1];
+            int *edge = refine_map_slot(&state->edges, a, b, 1);
+
+            if (*edge < 0) {
+                *edge = state->edge_count++;
+                state->edge_elements[*edge][0] = e;
+                state->edge_elements[*edge][1] = -1;
+            } else {
+                state->edge_elements[*edge][1] = e;
+            }
+            state->element_edges[e][k] = *edge;
+            if (dx * dx + dy * dy > longest) {
+                longest = dx * dx + dy * dy;
+                state->longest[e] = (unsigned char)k;
+            }
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+/* Mark the edges of the flagged elements, then the longest edge of every
+ * element with a marked edge, until the marking is closed. Returns the
+ * number of elements that will be split. */
+static fem_error_t refine_mark_edges(refine_state_t *state, const unsigned char *flagged,
+                                     int *refined)
+{
+    int elements = state->element_count;
+    int *stack = fem_arena_alloc(&g_scratch_arena,
+                                 (size_t)(2 * state->edge_count + 1) * sizeof(int));
+    int top = 0;
+
+    if (!stack) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate refinement stack");
+    }
+
+    /* Each edge is marked once and pushes its (at most two) elements */
+    for (int e = 0; e < elements; ++e) {
+        if (!flagged[e]) {
+            continue;
+        }
+        for (int k = 0; k < REFINE_CORNERS; ++k) {
+            int edge = state->element_edges[e][k];
+            if (!state->edge_marked[edge]) {
+                state->edge_marked[edge] = 1;
+                for (int s = 0; s < 2; ++s) {
+                    if (state->edge_elements[edge][s] >= 0) {
+                        stack[top++] = state->edge_elements[edge][s];
+                    }
+                }
+            }
+        }
+    }
+    while (top > 0) {
+        int e = stack[--top];
+        int edge = state->element_edges[e][state->longest[e]];
+
+        if (state->edge_marked[edge]) {
+            continue;
+        }
+        state->edge_marked[edge] = 1;
+        for (int s = 0; s < 2; ++s) {
+            if (state->edge_elements[edge][s] >= 0) {
+                stack[top++] = state->edge_elements[edge][s];
+            }
+        }
+    }
+
+    *refined = 0;
+    for (int e = 0; e < elements; ++e) {
+        if (state->edge_marked[state->element_edges[e][state->longest[e]]]) {
+            (*refined)++;
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+/* New node at a point of the parent, from its isoparametric map */
+static fem_error_t refine_create_node(refine_state_t *state, int parent, const int *parent_nodes,
+                                      const refine_point_t *point, int *node_out)
+{
+    int node = g_num_nodes;
+    double N[T6_NODES_PER_ELEMENT];
+    fem_error_t err;
+
+    if (state->type == ELEMENT_T6) {
+        t6_shape_functions(point->xi, point->eta, N);
+    } else {
+        t3_shape_functions(point->xi, point->eta, N);
+    }
+
+    globals_initialize_node_entry(node);
+    for (int k = 0; k < state->element_nodes; ++k) {
+        int source = parent_nodes[k];
+        for (int c = 0; c < 3; ++c) {
+            g_node_coords[node][c] += N[k] * g_node_coords[source][c];
+            g_node_displ[node][c] += N[k] * g_node_displ[source][c];
+        }
+    }
+
+    /* Constraints shared by the corners of a boundary edge */
+    for (int k = 0; k < REFINE_CORNERS; ++k) {
+        int edge = state->element_edges[parent][k];
+        int a = parent_nodes[k];
+        int b = parent_nodes[(k + 1) % REFINE_CORNERS];
+
+        if (!(point->edges & (1 << k)) || state->edge_elements[edge][1] >= 0) {
+            continue;
+        }
+        for (int c = 0; c < 3; ++c) {
+            if (g_node_bc_flags[a][c] && g_node_bc_flags[b][c]) {
+                g_node_bc_flags[node][c] = 1;
+            }
+        }
+    }
+
+    state->node_anchor[node - state->node_count] = parent_nodes[0];
+    for (int k = 1; k < state->element_nodes; ++k) {
+        if (parent_nodes[k] < state->node_anchor[node - state->node_count]) {
+            state->node_anchor[node - state->node_count] = parent_nodes[k];
+        }
+    }
+
+    g_node_ids[node] = state->next_node_id++;
+    err = id_map_insert(&g_node_id_map, g_node_ids[node], node, g_node_capacity);
+    CHECK_ERROR(err);
+    g_num_nodes++;
+    *node_out = node;
+    return FEM_SUCCESS;
+}
+
+/* Midpoint of the segment p-q inside the parent and the node there: the
+ * existing midside node of a whole T6 edge, otherwise the node created for
+ * the pair (p, q), shared with the neighbour across the edge */
+static fem_error_t refine_midpoint(refine_state_t *state, int parent, const int *parent_nodes,
+                                   const refine_point_t *p, const refine_point_t *q,
+                                   refine_point_t *mid)
+{
+    int *slot;
+    fem_error_t err;
+
+    mid->xi = 0.5 * (p->xi + q->xi);
+    mid->eta = 0.5 * (p->eta + q->eta);
+    mid->edges = p->edges & q->edges;
+
+    /* Corners lie on two parent edges */
+    if (state->type == ELEMENT_T6 && mid->edges != 0 &&
+        (p->edges & (p->edges - 1)) != 0 && (q->edges & (q->edges - 1)) != 0) {
+        for (int k = 0; k < REFINE_CORNERS; ++k) {
+            if (mid->edges == (1 << k)) {
+                mid->node = parent_nodes[REFINE_CORNERS + k];
+                return FEM_SUCCESS;
+            }
+        }
+    }
+
+    slot = refine_map_slot(&state->midpoints, p->node, q->node, 1);
+    if (*slot < 0) {
+        err = refine_create_node(state, parent, parent_nodes, mid, slot);
+        CHECK_ERROR(err);
+    }
+    mid->node = *slot;
+    return FEM_SUCCESS;
+}
+
+/* Split one parent; the children are written to its slot and appended */
+static fem_error_t refine_split_element(refine_state_t *state, int parent, int *changed,
+                                        int *changed_count)
+{
+    int parent_nodes[MAX_NODES_PER_ELEMENT];
+    refine_point_t corner[REFINE_CORNERS];
+    refine_point_t v0, v1, v2, m, p, q;
+    refine_point_t children[REFINE_MAX_CHILDREN][REFINE_CORNERS];
+    int child_count = 0;
+    int k = state->longest[parent];
+    int type = g_element_type[parent];
+    int material = g_element_material[parent];
+    fem_error_t err;
+
+    memcpy(parent_nodes, g_element_nodes[parent], sizeof(parent_nodes));
+    for (int c = 0; c < REFINE_CORNERS; ++c) {
+        corner[c] = g_refine_corners[c];
+        corner[c].node = parent_nodes[c];
+    }
+
+    /* v1-v2 is the longest edge, v0 the corner opposite; same orientation */
+    v0 = corner[(k + 2) % REFINE_CORNERS];
+    v1 = corner[k];
+    v2 = corner[(k + 1) % REFINE_CORNERS];
+    err = refine_midpoint(state, parent, parent_nodes, &v1, &v2, &m);
+    CHECK_ERROR(err);
+
+    if (state->edge_marked[state->element_edges[parent][(k + 2) % REFINE_CORNERS]]) {
+        err = refine_midpoint(state, parent, parent_nodes, &v0, &v1, &p);
+        CHECK_ERROR(err);
+        children[child_count][0] = m; children[child_count][1] = v0; children[child_count++][2] = p;
+        children[child_count][0] = m; children[child_count][1] = p; children[child_count++][2] = v1;
+    } else {
+        children[child_count][0] = m; children[child_count][1] = v0; children[child_count++][2] = v1;
+    }
+    if (state->edge_marked[state->element_edges[parent][(k + 1) % REFINE_CORNERS]]) {
+        err = refine_midpoint(state, parent, parent_nodes, &v2, &v0, &q);
+        CHECK_ERROR(err);
+        children[child_count][0] = m; children[child_count][1] = v2; children[child_count++][2] = q;
+        children[child_count][0] = m; children[child_count][1] = q; children[child_count++][2] = v0;
+    } else {
+        children[child_count][0] = m; children[child_count][1] = v2; children[child_count++][2] = v0;
+    }
+
+    for (int c = 0; c < child_count; ++c) {
+        int nodes[MAX_NODES_PER_ELEMENT];
+        int element = c == 0 ? parent : g_num_elements;
+
+        for (int i = 0; i < REFINE_CORNERS; ++i) {
+            nodes[i] = children[c][i].node;
+        }
+        if (state->type == ELEMENT_T6) {
+            for (int i = 0; i < REFINE_CORNERS; ++i) {
+                refine_point_t mid;
+                err = refine_midpoint(state, parent, parent_nodes, &children[c][i],
+                                      &children[c][(i + 1) % REFINE_CORNERS], &mid);
+                CHECK_ERROR(err);
+                nodes[REFINE_CORNERS + i] = mid.node;
+            }
+        }
+
+        if (c > 0) {
+            globals_initialize_element_entry(element);
+            g_element_ids[element] = state->next_element_id++;
+            err = id_map_insert(&g_element_id_map, g_element_ids[element], element,
+                                g_element_capacity);
+            CHECK_ERROR(err);
+            g_element_type[element] = type;
+            g_element_material[element] = material;
+            g_num_elements++;
+        }
+        for (int i = 0; i < state->element_nodes; ++i) {
+            g_element_nodes[element][i] = nodes[i];
+        }
+        changed[(*changed_count)++] = element;
+    }
+    return FEM_SUCCESS;
+}
+
+/* Edge loads whose edge is split: T6 loads become two, over the halves.
+ * With check set, only verify that they can be split. */
+static fem_error_t refine_split_surfaces(refine_state_t *state,
+                                         int (*surfaces)[MAX_SURFACE_NODES],
+                                         double (*values)[3], int *count, int check,
+                                         const char *kind)
+{
+    int split = 0;
+    int original = *count;
+
+    for (int i = 0; i < original; ++i) {
+        int a = surfaces[i][0];
+        int mid = surfaces[i][1];
+        int b = surfaces[i][2];
+        int *first, *second;
+
+        if (!refine_edge_marked(state, a, b)) {
+            continue;
+        }
+        if (check) {
+            if (state->type != ELEMENT_T6) {
+                return error_set(FEM_ERROR_INVALID_INPUT,
+                                 "Refinement of a T3 edge carrying %s load %d is not supported",
+                                 kind, i + 1);
+            }
+            split++;
+            continue;
+        }
+        first = refine_map_slot(&state->midpoints, a, mid, 0);
+        second = refine_map_slot(&state->midpoints, mid, b, 0);
+        if (!first || !second) {
+            return error_set(FEM_ERROR_INVALID_INPUT,
+                             "The nodes of %s load %d do not follow a refined element edge",
+                             kind, i + 1);
+        }
+        surfaces[*count][0] = mid;
+        surfaces[*count][1] = *second;
+        surfaces[*count][2] = b;
+        if (values) {
+            memcpy(values[*count], values[i], sizeof(values[i]));
+        }
+        (*count)++;
+        surfaces[i][1] = *first;
+        surfaces[i][2] = mid;
+    }
+    if (check && original + split > MAX_TRACTION_SURFACES) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Refinement exceeds the maximum of %d %s surfaces",
+                         MAX_TRACTION_SURFACES, kind);
+    }
+    return FEM_SUCCESS;
+}
+
+/* Move every new node behind its anchor. Appended at the end, a node near
+ * the first nodes would stretch its skyline column over the whole matrix;
+ * behind its anchor the envelope stays as narrow as the input numbering.
+ * The old nodes keep their order, so node_map (old index -> new index) is
+ * increasing. */
+static fem_error_t refine_renumber_nodes(refine_state_t *state, int *node_map)
+{
+    int old_count = state->node_count;
+    int new_count = g_num_nodes - old_count;
+    int *order = fem_arena_alloc(&g_scratch_arena, (size_t)g_num_nodes * sizeof(int));
+    int *start = fem_arena_alloc(&g_scratch_arena, (size_t)(old_count + 1) * sizeof(int));
+    double (*coords)[3] = fem_arena_alloc(&g_scratch_arena, (size_t)g_num_nodes * sizeof(*coords));
+    double (*displ)[3] = fem_arena_alloc(&g_scratch_arena, (size_t)g_num_nodes * sizeof(*displ));
+    double (*force)[3] = fem_arena_alloc(&g_scratch_arena, (size_t)g_num_nodes * sizeof(*force));
+    int (*bc_flags)[3] = fem_arena_alloc(&g_scratch_arena, (size_t)g_num_nodes * sizeof(*bc_flags));
+    int *ids = fem_arena_alloc(&g_scratch_arena, (size_t)g_num_nodes * sizeof(int));
+    fem_error_t err;
+
+    if (!order || !start || !coords || !displ || !force || !bc_flags || !ids) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate node renumbering");
+    }
+
+    /* start[o]: new nodes anchored before old node o */
+    memset(start, 0, (size_t)(old_count + 1) * sizeof(int));
+    for (int i = 0; i < new_count; ++i) {
+        start[state->node_anchor[i] + 1]++;
+    }
+    for (int o = 0; o < old_count; ++o) {
+        start[o + 1] += start[o];
+    }
+    for (int o = 0; o < old_count; ++o) {
+        node_map[o] = o + start[o];
+        order[o] = node_map[o];
+        start[o] = node_map[o] + 1;
+    }
+    for (int i = 0; i < new_count; ++i) {
+        order[old_count + i] = start[state->node_anchor[i]]++;
+    }
+
+    memcpy(coords, g_node_coords, (size_t)g_num_nodes * sizeof(*coords));
+    memcpy(displ, g_node_displ, (size_t)g_num_nodes * sizeof(*displ));
+    memcpy(force, g_node_force, (size_t)g_num_nodes * sizeof(*force));
+    memcpy(bc_flags, g_node_bc_flags, (size_t)g_num_nodes * sizeof(*bc_flags));
+    memcpy(ids, g_node_ids, (size_t)g_num_nodes * sizeof(int));
+    for (int n = 0; n < g_num_nodes; ++n) {
+        int target = order[n];
+        memcpy(g_node_coords[target], coords[n], sizeof(coords[n]));
+        memcpy(g_node_displ[target], displ[n], sizeof(displ[n]));
+        memcpy(g_node_force[target], force[n], sizeof(force[n]));
+        memcpy(g_node_bc_flags[target], bc_flags[n], sizeof(bc_flags[n]));
+        g_node_ids[target] = ids[n];
+        err = id_map_insert(&g_node_id_map, ids[n], target, g_node_capacity);
+        CHECK_ERROR(err);
+    }
+
+    for (int e = 0; e < g_num_elements; ++e) {
+        for (int k = 0; k < state->element_nodes; ++k) {
+            g_element_nodes[e][k] = order[g_element_nodes[e][k]];
+        }
+    }
+    for (int i = 0; i < g_num_tractions; ++i) {
+        for (int k = 0; k < MAX_SURFACE_NODES; ++k) {
+            if (g_traction_surfaces[i][k] >= 0) {
+                g_traction_surfaces[i][k] = order[g_traction_surfaces[i][k]];
+            }
+        }
+    }
+    for (int i = 0; i < g_num_pressure_surfaces; ++i) {
+        for (int k = 0; k < MAX_SURFACE_NODES; ++k) {
+            if (g_pressure_surfaces[i][k] >= 0) {
+                g_pressure_surfaces[i][k] = order[g_pressure_surfaces[i][k]];
+            }
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+static int refine_max_id(const int *ids, int count)
+{
+    int max_id = 0;
+
+    for (int i = 0; i < count; ++i) {
+        if (ids[i] > max_id) {
+            max_id = ids[i];
+        }
+    }
+    return max_id;
+}
+
+fem_error_t mesh_refine_triangles(const unsigned char *flagged, mesh_refine_result_t *result)
+{
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    refine_state_t state;
+    int refined = 0;
+    int max_new_nodes;
+    fem_error_t err;
+
+    memset(result, 0, sizeof(*result));
+    memset(&state, 0, sizeof(state));
+    if (g_num_elements <= 0) {
+        return FEM_SUCCESS;
+    }
+    state.type = g_element_type[0];
+    state.element_nodes = state.type == ELEMENT_T6 ? T6_NODES_PER_ELEMENT : T3_NODES_PER_ELEMENT;
+    state.element_count = g_num_elements;
+    for (int e = 0; e < g_num_elements; ++e) {
+        if (g_element_type[e] != state.type ||
+            (state.type != ELEMENT_T3 && state.type != ELEMENT_T6)) {
+            return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                             "Mesh refinement needs a mesh of T3 or of T6 elements only "
+                             "(element %d)", e + 1);
+        }
+    }
+
+    err = refine_build_edges(&state);
+    CHECK_ERROR_CLEANUP(err, fem_arena_rewind(&g_scratch_arena, scratch));
+    err = refine_mark_edges(&state, flagged, &refined);
+    CHECK_ERROR_CLEANUP(err, fem_arena_rewind(&g_scratch_arena, scratch));
+    if (refined == 0) {
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        return FEM_SUCCESS;
+    }
+
+    /* Edge loads are checked before the mesh is touched */
+    err = refine_split_surfaces(&state, g_traction_surfaces, g_traction_values, &g_num_tractions,
+                                1, "traction");
+    CHECK_ERROR_CLEANUP(err, fem_arena_rewind(&g_scratch_arena, scratch));
+    err = refine_split_surfaces(&state, g_pressure_surfaces, NULL, &g_num_pressure_surfaces,
+                                1, "pressure");
+    CHECK_ERROR_CLEANUP(err, fem_arena_rewind(&g_scratch_arena, scratch));
+
+    max_new_nodes = state.type == ELEMENT_T6 ? refined * REFINE_T6_NODES_PER_PARENT
+                                             : refined * REFINE_CORNERS;
+    state.node_count = g_num_nodes;
+    state.node_anchor = fem_arena_alloc(&g_scratch_arena, (size_t)max_new_nodes * sizeof(int));
+    if (!state.node_anchor) {
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate refinement nodes");
+    }
+    err = refine_map_init(&state.midpoints, max_new_nodes);
+    CHECK_ERROR_CLEANUP(err, fem_arena_rewind(&g_scratch_arena, scratch));
+    err = globals_reserve_nodes(g_num_nodes + max_new_nodes);
+    CHECK_ERROR_CLEANUP(err, fem_arena_rewind(&g_scratch_arena, scratch));
+    err = globals_reserve_elements(g_num_elements + refined * (REFINE_MAX_CHILDREN - 1));
+    CHECK_ERROR_CLEANUP(err, fem_arena_rewind(&g_scratch_arena, scratch));
+    result->changed_elements = fem_malloc((size_t)refined * REFINE_MAX_CHILDREN * sizeof(int),
+                                          FEM_MEMORY_MESH);
+    result->node_map = fem_malloc((size_t)g_num_nodes * sizeof(int), FEM_MEMORY_MESH);
+    result->old_nodes = g_num_nodes;
+    if (!result->changed_elements || !result->node_map) {
+        mesh_refine_result_free(result);
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate refined element list");
+    }
+    state.next_node_id = refine_max_id(g_node_ids, g_num_nodes) + 1;
+    state.next_element_id = refine_max_id(g_element_ids, g_num_elements) + 1;
+
+    result->new_nodes = g_num_nodes;
+    result->new_elements = g_num_elements;
+    for (int e = 0; e < state.element_count; ++e) {
+        if (!state.edge_marked[state.element_edges[e][state.longest[e]]]) {
+            continue;
+        }
+        err = refine_split_element(&state, e, result->changed_elements, &result->changed_count);
+        CHECK_ERROR_CLEANUP(err, fem_arena_rewind(&g_scratch_arena, scratch));
+    }
+    result->refined_elements = refined;
+    result->new_nodes = g_num_nodes - result->new_nodes;
+    result->new_elements = g_num_elements - result->new_elements;
+
+    err = refine_split_surfaces(&state, g_traction_surfaces, g_traction_values, &g_num_tractions,
+                                0, "traction");
+    CHECK_ERROR_CLEANUP(err, fem_arena_rewind(&g_scratch_arena, scratch));
+    err = refine_split_surfaces(&state, g_pressure_surfaces, NULL, &g_num_pressure_surfaces,
+                                0, "pressure");
+    CHECK_ERROR_CLEANUP(err, fem_arena_rewind(&g_scratch_arena, scratch));
+    err = refine_renumber_nodes(&state, result->node_map);
+    CHECK_ERROR_CLEANUP(err, fem_arena_rewind(&g_scratch_arena, scratch));
+    fem_arena_rewind(&g_scratch_arena, scratch);
+
+    g_analysis.num_nodes = g_num_nodes;
+    g_analysis.num_elements = g_num_elements;
+    return mesh_quality_update(result->changed_elements, result->changed_count);
+}
+
+void mesh_refine_result_free(mesh_refine_result_t *result)
+{
+    fem_free(result->changed_elements);
+    fem_free(result->node_map);
+    memset(result, 0, sizeof(*result));
+}
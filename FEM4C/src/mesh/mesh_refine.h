@@ -0,0 +1,49 @@
+#ifndef MESH_REFINE_H
+#define MESH_REFINE_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Conforming refinement of triangle meshes
+ *
+ * Longest-edge bisection of flagged T3/T6 elements in the in-memory mesh.
+ * A flagged element marks its three edges; every element with a marked
+ * edge then marks its longest edge as well, until no element changes, so
+ * the refined mesh has no hanging nodes. An element is cut from the
+ * midpoint of its longest edge to the opposite corner and each half is cut
+ * again if its outer edge is marked: 2 (green), 3 or 4 (red-like)
+ * children. Every cut starts from a longest edge, which keeps the angles
+ * of repeated refinement bounded.
+ *
+ * New nodes are placed with the isoparametric map of their parent, so
+ * curved T6 edges keep their shape, and take the displacements
+ * interpolated from it: the previous solution carries over exactly as a
+ * start vector. A node on a boundary edge whose two corners share a
+ * constrained component gets that constraint, with the interpolated
+ * prescribed value. Edge loads (press/tract) of T6 meshes are split with
+ * their edges.
+ *
+ * The first child takes the slot of its parent; further children are
+ * appended. New nodes and elements get IDs above the existing ones. Each
+ * new node is placed right behind the lowest node of its parent, which
+ * keeps the skyline envelope as narrow as the input numbering allows; the
+ * old nodes keep their relative order (node_map). The element quality
+ * cache is updated for the changed elements.
+ */
+
+#include "../common/types.h"
+
+typedef struct {
+    int refined_elements;       /* parents split */
+    int new_elements;
+    int new_nodes;
+    int *changed_elements;      /* parent slots and appended children */
+    int changed_count;
+    int *node_map;              /* old node index -> new index, increasing */
+    int old_nodes;
+} mesh_refine_result_t;
+
+/* Refine the elements with flagged[e] != 0 (g_num_elements entries) */
+fem_error_t mesh_refine_triangles(const unsigned char *flagged, mesh_refine_result_t *result);
+
+void mesh_refine_result_free(mesh_refine_result_t *result);
+
+#endif /* MESH_REFINE_H */
@@ -6,10 +6,15 @@
 #include "../common/constants.h"
 #include "../common/globals.h"
 #include "../common/error.h"
+#include "../common/fem_log.h"
 #include "../elements/t6/t6_element.h"
 #include "../elements/t6/t6_stiffness.h"
 #include "../elements/t3/t3_element.h"
 #include "../elements/q4/q4_element.h"
+#include "../elements/solid3d/solid3d_element.h"
+#include "../elements/element_mass.h"
+#include "mpc.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -35,24 +40,35 @@ static fem_error_t assembly_apply_body_force(void);
 static fem_error_t assembly_apply_body_force_t6(int element_id);
 static fem_error_t assembly_apply_body_force_t3(int element_id);
 static fem_error_t assembly_apply_body_force_q4(int element_id);
+static fem_error_t assembly_apply_body_force_solid(int element_id);
 static fem_error_t assembly_apply_traction_loads(void);
 static fem_error_t assembly_apply_traction_surface(int surface_index);
 static fem_error_t assembly_apply_pressure_loads(void);
 static fem_error_t assembly_apply_pressure_surface(int surface_index);
 static fem_error_t assembly_prepare_global_system(void);
-static fem_error_t assembly_build_stiffness_profile(void);
+static fem_error_t assembly_build_stiffness_profile(int allocate_values);
+static fem_error_t assembly_finish_stiffness_profile(int allocate_values);
+static fem_error_t assembly_install_profile(int *profile, int allocate_values);
 static void assembly_zero_stiffness_matrix(void);
 static int assembly_matrix_contains_entry(int row, int col);
 static double assembly_matrix_get_value(int row, int col);
 static fem_error_t assembly_matrix_set_value(int row, int col, double value);
 static fem_error_t assembly_matrix_add_value(int row, int col, double value);
-static fem_error_t assembly_collect_element_dofs(int element_id, int *dof_map, int *dof_count);
+static fem_error_t assembly_matrix_add_constrained(int row, int col, double value);
 
 static fem_error_t assembly_prepare_global_system(void)
 {
     fem_error_t err;
     int expected_dof = g_total_dof > 0 ? g_total_dof : g_num_nodes * 2;
 
+    /* Re-assembly of an unchanged mesh (resident service) keeps the skyline
+     * profile and the system vectors; globals_reset() frees them for a new
+     * model */
+    if (g_global_stiffness_values && g_stiffness_profile && g_total_dof == expected_dof) {
+        assembly_zero_stiffness_matrix();
+        return FEM_SUCCESS;
+    }
+
     err = globals_allocate_system_arrays(expected_dof);
     CHECK_ERROR(err);
 
@@ -60,14 +76,38 @@ static fem_error_t assembly_prepare_global_system(void)
         return FEM_SUCCESS;
     }
 
-    err = assembly_build_stiffness_profile();
+    err = assembly_build_stiffness_profile(1);
     CHECK_ERROR(err);
 
     assembly_zero_stiffness_matrix();
     return FEM_SUCCESS;
 }
 
-static fem_error_t assembly_build_stiffness_profile(void)
+fem_error_t assembly_prepare_stiffness_profile(void)
+{
+    int expected_dof = g_total_dof > 0 ? g_total_dof : g_num_nodes * 2;
+    fem_error_t err;
+
+    /* Same reuse rule as the in-core assembly; the values are not kept */
+    if (g_stiffness_profile && g_stiffness_offsets && g_total_dof == expected_dof) {
+        fem_free(g_global_stiffness_values);
+        g_global_stiffness_values = NULL;
+        for (int i = 0; i < g_total_dof; i++) {
+            g_global_force[i] = ZERO;
+            g_global_displ[i] = ZERO;
+        }
+        return FEM_SUCCESS;
+    }
+
+    err = globals_allocate_system_arrays(expected_dof);
+    CHECK_ERROR(err);
+    if (g_total_dof <= 0) {
+        return FEM_SUCCESS;
+    }
+    return assembly_build_stiffness_profile(0);
+}
+
+static fem_error_t assembly_build_stiffness_profile(int allocate_values)
 {
     int dof = g_total_dof;
     fem_error_t err = FEM_SUCCESS;
@@ -76,8 +116,9 @@ static fem_error_t assembly_build_stiffness_profile(void)
         return FEM_SUCCESS;
     }
 
-    g_stiffness_profile = (int *)malloc((size_t)dof * sizeof(int));
-    g_stiffness_offsets = (int *)malloc((size_t)(dof + 1) * sizeof(int));
+    g_stiffness_profile = (int *)fem_malloc((size_t)dof * sizeof(int), FEM_MEMORY_MATRIX);
+    g_stiffness_offsets = (fem_index_t *)fem_malloc(((size_t)dof + 1) * sizeof(fem_index_t),
+                                                  FEM_MEMORY_MATRIX);
     if (!g_stiffness_profile || !g_stiffness_offsets) {
         globals_free_system_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION,
@@ -88,37 +129,18 @@ static fem_error_t assembly_build_stiffness_profile(void)
         g_stiffness_profile[i] = i;
     }
 
-    int dof_map[T6_TOTAL_DOF];
-    int dof_count = 0;
     for (int element_id = 0; element_id < g_num_elements; element_id++) {
-        err = assembly_collect_element_dofs(element_id, dof_map, &dof_count);
+        err = assembly_profile_add_element(g_stiffness_profile, dof, element_id);
         CHECK_ERROR(err);
+    }
 
-        for (int i = 0; i < dof_count; i++) {
-            int row_dof = dof_map[i];
-            if (row_dof < 0 || row_dof >= dof) {
-                continue;
-            }
-            for (int j = i; j < dof_count; j++) {
-                int col_dof = dof_map[j];
-                if (col_dof < 0 || col_dof >= dof) {
-                    continue;
-                }
-
-                int row = row_dof;
-                int col = col_dof;
-                if (row > col) {
-                    int tmp = row;
-                    row = col;
-                    col = tmp;
-                }
+    return assembly_finish_stiffness_profile(allocate_values);
+}
 
-                if (row < g_stiffness_profile[col]) {
-                    g_stiffness_profile[col] = row;
-                }
-            }
-        }
-    }
+/* Offsets and value storage over the column tops in g_stiffness_profile */
+static fem_error_t assembly_finish_stiffness_profile(int allocate_values)
+{
+    int dof = g_total_dof;
 
     g_stiffness_offsets[0] = 0;
     g_stiffness_bandwidth = 0;
@@ -130,7 +152,16 @@ static fem_error_t assembly_build_stiffness_profile(void)
         if (column_height > g_stiffness_bandwidth) {
             g_stiffness_bandwidth = column_height;
         }
-        g_stiffness_offsets[col + 1] = g_stiffness_offsets[col] + column_height + 1;
+        /* Summed in 64 bits so that a profile too large for fem_index_t is
+         * reported instead of wrapping around */
+        long long next_offset = (long long)g_stiffness_offsets[col] + column_height + 1;
+        if (next_offset > FEM_INDEX_MAX) {
+            globals_free_system_arrays();
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                             "Skyline profile exceeds %lld stored entries at DOF %d; "
+                             "rebuild with INDEX64=1", (long long)FEM_INDEX_MAX, col + 1);
+        }
+        g_stiffness_offsets[col + 1] = (fem_index_t)next_offset;
     }
 
     g_stiffness_value_count = g_stiffness_offsets[dof];
@@ -138,12 +169,24 @@ static fem_error_t assembly_build_stiffness_profile(void)
         g_stiffness_value_count = dof;
     }
 
-    g_global_stiffness_values = (double *)calloc((size_t)g_stiffness_value_count, sizeof(double));
+    if (!allocate_values) {
+        return FEM_SUCCESS;
+    }
+    if ((unsigned long long)g_stiffness_value_count > SIZE_MAX / sizeof(double)) {
+        fem_index_t count = g_stiffness_value_count;
+        globals_free_system_arrays();
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Skyline stiffness storage of %lld entries exceeds the address space",
+                         (long long)count);
+    }
+    g_global_stiffness_values = (double *)fem_calloc((size_t)g_stiffness_value_count, sizeof(double),
+                                                    FEM_MEMORY_MATRIX);
     if (!g_global_stiffness_values) {
+        fem_index_t count = g_stiffness_value_count;
         globals_free_system_arrays();
         return error_set(FEM_ERROR_MEMORY_ALLOCATION,
-                         "Failed to allocate skyline stiffness storage (%d entries)",
-                         g_stiffness_value_count);
+                         "Failed to allocate skyline stiffness storage (%lld entries)",
+                         (long long)count);
     }
 
     return FEM_SUCCESS;
@@ -187,7 +230,7 @@ static double assembly_matrix_get_value(int row, int col)
         return 0.0;
     }
 
-    int offset = g_stiffness_offsets[col] + (row - g_stiffness_profile[col]);
+    fem_index_t offset = g_stiffness_offsets[col] + (row - g_stiffness_profile[col]);
     if (offset < 0 || offset >= g_stiffness_value_count) {
         return 0.0;
     }
@@ -208,7 +251,7 @@ static fem_error_t assembly_matrix_set_value(int row, int col, double value)
                          row + 1, col + 1);
     }
 
-    int offset = g_stiffness_offsets[col] + (row - g_stiffness_profile[col]);
+    fem_index_t offset = g_stiffness_offsets[col] + (row - g_stiffness_profile[col]);
     if (offset < 0 || offset >= g_stiffness_value_count) {
         return error_set(FEM_ERROR_INVALID_INPUT,
                          "Skyline index out of range for (%d,%d)", row + 1, col + 1);
@@ -220,6 +263,10 @@ static fem_error_t assembly_matrix_set_value(int row, int col, double value)
 
 static fem_error_t assembly_matrix_add_value(int row, int col, double value)
 {
+    if (g_mpc_dof_row && (g_mpc_dof_row[row] >= 0 || g_mpc_dof_row[col] >= 0)) {
+        return assembly_matrix_add_constrained(row, col, value);
+    }
+
     if (row > col) {
         int tmp = row;
         row = col;
@@ -232,7 +279,7 @@ static fem_error_t assembly_matrix_add_value(int row, int col, double value)
                          row + 1, col + 1);
     }
 
-    int offset = g_stiffness_offsets[col] + (row - g_stiffness_profile[col]);
+    fem_index_t offset = g_stiffness_offsets[col] + (row - g_stiffness_profile[col]);
     if (offset < 0 || offset >= g_stiffness_value_count) {
         return error_set(FEM_ERROR_INVALID_INPUT,
                          "Skyline index out of range for (%d,%d)", row + 1, col + 1);
@@ -242,7 +289,55 @@ static fem_error_t assembly_matrix_add_value(int row, int col, double value)
     return FEM_SUCCESS;
 }
 
-static fem_error_t assembly_collect_element_dofs(int element_id, int *dof_map, int *dof_count)
+/* Masters and coefficients of a DOF under u = T u_r (mpc.h); an
+ * independent DOF is its own master. Returns the number of terms. */
+static int assembly_mpc_terms(int dof, int *self, const int **masters, const double **coefficients)
+{
+    static const double unit = 1.0;
+    int row = g_mpc_dof_row[dof];
+
+    if (row < 0) {
+        *self = dof;
+        *masters = self;
+        *coefficients = &unit;
+        return 1;
+    }
+    *masters = g_mpc_masters + g_mpc_row_offsets[row];
+    *coefficients = g_mpc_coefficients + g_mpc_row_offsets[row];
+    return g_mpc_row_offsets[row + 1] - g_mpc_row_offsets[row];
+}
+
+/* Element matrix entry (row, col) with a dependent DOF, spread over the
+ * masters of both DOFs (T^T K T). An off-diagonal entry stands for both
+ * (row, col) and (col, row), so a master pair that meets on the diagonal
+ * receives it twice; a diagonal entry adds once per unordered pair. */
+static fem_error_t assembly_matrix_add_constrained(int row, int col, double value)
+{
+    const int *row_masters;
+    const int *col_masters;
+    const double *row_coefficients;
+    const double *col_coefficients;
+    int row_self;
+    int col_self;
+    fem_error_t err;
+
+    int row_terms = assembly_mpc_terms(row, &row_self, &row_masters, &row_coefficients);
+    int col_terms = assembly_mpc_terms(col, &col_self, &col_masters, &col_coefficients);
+
+    for (int a = 0; a < row_terms; a++) {
+        for (int b = (row == col) ? a : 0; b < col_terms; b++) {
+            double v = row_coefficients[a] * col_coefficients[b] * value;
+            if (row != col && row_masters[a] == col_masters[b]) {
+                v *= 2.0;
+            }
+            err = assembly_matrix_add_value(row_masters[a], col_masters[b], v);
+            CHECK_ERROR(err);
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t assembly_collect_element_dofs(int element_id, int *dof_map, int *dof_count)
 {
     switch (g_element_type[element_id]) {
         case ELEMENT_T6:
@@ -273,6 +368,274 @@ static fem_error_t assembly_collect_element_dofs(int element_id, int *dof_map, i
     }
 }
 
+/* Lower the column tops of profile (dof entries, initialised to the column
+ * index) to cover the DOF pairs of one element; with multipoint
+ * constraints, the pairs of the masters its matrix is spread over */
+fem_error_t assembly_profile_add_element(int *profile, int dof, int element_id)
+{
+    int element_dofs[T6_TOTAL_DOF];
+    int *dof_map = element_dofs;
+    int dof_count = 0;
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    fem_error_t err;
+
+    err = assembly_collect_element_dofs(element_id, element_dofs, &dof_count);
+    CHECK_ERROR(err);
+
+    if (mpc_active()) {
+        int capacity = dof_count * (g_mpc_max_terms > 1 ? g_mpc_max_terms : 1);
+        dof_map = fem_arena_alloc(&g_scratch_arena, (size_t)capacity * sizeof(int));
+        if (!dof_map) {
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                             "Failed to allocate constrained DOFs of element %d", element_id + 1);
+        }
+        dof_count = mpc_expand_dofs(element_dofs, dof_count, dof_map, capacity);
+    }
+
+    for (int i = 0; i < dof_count; i++) {
+        int row_dof = dof_map[i];
+        if (row_dof < 0 || row_dof >= dof) {
+            continue;
+        }
+        for (int j = i; j < dof_count; j++) {
+            int col_dof = dof_map[j];
+            if (col_dof < 0 || col_dof >= dof) {
+                continue;
+            }
+
+            int row = row_dof;
+            int col = col_dof;
+            if (row > col) {
+                int tmp = row;
+                row = col;
+                col = tmp;
+            }
+
+            if (row < profile[col]) {
+                profile[col] = row;
+            }
+        }
+    }
+
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    return FEM_SUCCESS;
+}
+
+/* Allocate the system over column tops computed elsewhere (pipelined
+ * preprocessing). Takes ownership of profile, a fem_malloc'd array of
+ * g_total_dof entries. */
+fem_error_t assembly_prepare_global_system_with_profile(int *profile)
+{
+    return assembly_install_profile(profile, 1);
+}
+
+static fem_error_t assembly_install_profile(int *profile, int allocate_values)
+{
+    int dof = g_total_dof;
+    fem_error_t err;
+
+    err = globals_allocate_system_arrays(dof);
+    if (err != FEM_SUCCESS || dof <= 0) {
+        fem_free(profile);
+        return err;
+    }
+
+    g_stiffness_profile = profile;
+    g_stiffness_offsets = (fem_index_t *)fem_malloc(((size_t)dof + 1) * sizeof(fem_index_t),
+                                                  FEM_MEMORY_MATRIX);
+    if (!g_stiffness_offsets) {
+        globals_free_system_arrays();
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Failed to allocate skyline index arrays for %d DOF", dof);
+    }
+
+    err = assembly_finish_stiffness_profile(allocate_values);
+    CHECK_ERROR(err);
+
+    if (allocate_values) {
+        assembly_zero_stiffness_matrix();
+    }
+    return FEM_SUCCESS;
+}
+
+/* Refinement only couples old DOFs that shared a parent element, and the
+ * node map keeps their order, so the mapped old column tops still cover
+ * them; the new columns start at their index */
+fem_error_t assembly_grow_stiffness_profile(int total_dof, const int *node_map, int old_nodes,
+                                            const int *elements, int count)
+{
+    int old_dof = g_total_dof;
+    int allocate_values = g_global_stiffness_values != NULL;
+    int *profile;
+    fem_error_t err;
+
+    if (!g_stiffness_profile || old_dof <= 0 || total_dof < old_dof ||
+        old_dof != old_nodes * g_dof_per_node) {
+        globals_free_system_arrays();
+        g_total_dof = total_dof;
+        return FEM_SUCCESS;
+    }
+
+    profile = (int *)fem_malloc((size_t)total_dof * sizeof(int), FEM_MEMORY_MATRIX);
+    if (!profile) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Failed to allocate skyline index arrays for %d DOF", total_dof);
+    }
+    for (int i = 0; i < total_dof; i++) {
+        profile[i] = i;
+    }
+    for (int n = 0; n < old_nodes; n++) {
+        for (int k = 0; k < g_dof_per_node; k++) {
+            int top = g_stiffness_profile[n * g_dof_per_node + k];
+            profile[node_map[n] * g_dof_per_node + k] =
+                node_map[top / g_dof_per_node] * g_dof_per_node +
+                top % g_dof_per_node;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        err = assembly_profile_add_element(profile, total_dof, elements[i]);
+        CHECK_ERROR_CLEANUP(err, fem_free(profile));
+    }
+
+    /* An out-of-core solve (skyline_ooc.h) keeps no values in memory */
+    g_total_dof = total_dof;
+    return assembly_install_profile(profile, allocate_values);
+}
+
+int assembly_element_stiffness_packed_size(int element_type)
+{
+    switch (element_type) {
+        case ELEMENT_T3:
+            return T3_TOTAL_DOF * (T3_TOTAL_DOF + 1) / 2;
+        case ELEMENT_Q4:
+            return Q4_TOTAL_DOF * (Q4_TOTAL_DOF + 1) / 2;
+        case ELEMENT_T6:
+            return T6_TOTAL_DOF * (T6_TOTAL_DOF + 1) / 2;
+        default:
+            return 0;
+    }
+}
+
+/* Copy the upper triangle of an n x n row-major matrix row by row */
+static void assembly_pack_upper(int n, const double *ke, double *ke_upper)
+{
+    for (int i = 0; i < n; i++) {
+        for (int j = i; j < n; j++) {
+            *ke_upper++ = ke[i * n + j];
+        }
+    }
+}
+
+fem_error_t assembly_element_stiffness_packed(int element_id, double *ke_upper)
+{
+    fem_error_t err;
+
+    switch (g_element_type[element_id]) {
+        case ELEMENT_T6: {
+            double ke[T6_TOTAL_DOF][T6_TOTAL_DOF];
+            err = t6_element_stiffness_matrix(element_id, ke);
+            CHECK_ERROR(err);
+            assembly_pack_upper(T6_TOTAL_DOF, &ke[0][0], ke_upper);
+            return FEM_SUCCESS;
+        }
+        case ELEMENT_T3: {
+            double ke[T3_TOTAL_DOF][T3_TOTAL_DOF];
+            err = t3_element_stiffness(element_id, ke);
+            CHECK_ERROR(err);
+            assembly_pack_upper(T3_TOTAL_DOF, &ke[0][0], ke_upper);
+            return FEM_SUCCESS;
+        }
+        case ELEMENT_Q4: {
+            double ke[Q4_TOTAL_DOF][Q4_TOTAL_DOF];
+            err = q4_element_stiffness(element_id, ke);
+            CHECK_ERROR(err);
+            assembly_pack_upper(Q4_TOTAL_DOF, &ke[0][0], ke_upper);
+            return FEM_SUCCESS;
+        }
+        default:
+            return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                             "Unsupported element type %d in element %d",
+                             g_element_type[element_id], element_id + 1);
+    }
+}
+
+/* Same entries and summation order as the per-type add functions */
+fem_error_t assembly_add_element_stiffness_packed(int element_id, const double *ke_upper)
+{
+    int dof_map[T6_TOTAL_DOF];
+    int dof_count = 0;
+    fem_error_t err;
+
+    err = assembly_collect_element_dofs(element_id, dof_map, &dof_count);
+    CHECK_ERROR(err);
+
+    for (int i = 0; i < dof_count; i++) {
+        int global_i = dof_map[i];
+        if (global_i < 0 || global_i >= g_total_dof) {
+            ke_upper += dof_count - i;
+            continue;
+        }
+        for (int j = i; j < dof_count; j++) {
+            int global_j = dof_map[j];
+            double value = *ke_upper++;
+            if (global_j < 0 || global_j >= g_total_dof) {
+                continue;
+            }
+            err = assembly_matrix_add_value(global_i, global_j, value);
+            CHECK_ERROR(err);
+        }
+    }
+
+    return FEM_SUCCESS;
+}
+
+/* The same scatter into another matrix on the stiffness profile */
+fem_error_t assembly_add_element_matrix_packed(int element_id, const double *me_upper, double *values)
+{
+    int dof_map[T6_TOTAL_DOF];
+    int dof_count = 0;
+    fem_error_t err;
+
+    err = assembly_collect_element_dofs(element_id, dof_map, &dof_count);
+    CHECK_ERROR(err);
+
+    for (int i = 0; i < dof_count; i++) {
+        for (int j = i; j < dof_count; j++) {
+            int row = dof_map[i];
+            int col = dof_map[j];
+            double value = *me_upper++;
+            if (row > col) {
+                int tmp = row;
+                row = col;
+                col = tmp;
+            }
+            if (!assembly_matrix_contains_entry(row, col)) {
+                return error_set(FEM_ERROR_INVALID_INPUT,
+                                 "Stiffness profile missing entry for DOF pair (%d,%d)",
+                                 row + 1, col + 1);
+            }
+            values[g_stiffness_offsets[col] + (row - g_stiffness_profile[col])] += value;
+        }
+    }
+
+    return FEM_SUCCESS;
+}
+
+/* Consistent mass of every element, added into values */
+fem_error_t assembly_global_mass_matrix(double *values)
+{
+    double me[ELEMENT_MASS_MAX_DOF * (ELEMENT_MASS_MAX_DOF + 1) / 2];
+    fem_error_t err;
+
+    for (int e = 0; e < g_num_elements; e++) {
+        err = element_mass_packed(e, me);
+        CHECK_ERROR(err);
+        err = assembly_add_element_matrix_packed(e, me, values);
+        CHECK_ERROR(err);
+    }
+    return FEM_SUCCESS;
+}
+
 /* Clear global arrays */
 fem_error_t assembly_clear_global_arrays(void)
 {
@@ -306,9 +669,9 @@ fem_error_t assembly_global_stiffness_matrix(void)
     err = assembly_clear_global_arrays();
     CHECK_ERROR(err);
 
-    printf("Assembling global stiffness matrix...\n");
-    printf("  Number of elements: %d\n", g_num_elements);
-    printf("  Global DOF: %d\n", g_total_dof);
+    FEM_LOG_INFO("Assembling global stiffness matrix...\n");
+    FEM_LOG_INFO("  Number of elements: %d\n", g_num_elements);
+    FEM_LOG_INFO("  Global DOF: %d\n", g_total_dof);
 
     /* Loop over all elements */
     for (element_id = 0; element_id < g_num_elements; element_id++) {
@@ -339,7 +702,25 @@ fem_error_t assembly_global_stiffness_matrix(void)
         }
     }
 
-    printf("  Global stiffness matrix assembled successfully\n");
+    FEM_LOG_INFO("  Global stiffness matrix assembled successfully\n");
+    return FEM_SUCCESS;
+}
+
+/* Loads of dependent DOFs move to their masters, then the total is reported */
+static fem_error_t assembly_finish_force_vector(void)
+{
+    double total_force = 0.0;
+
+    if (mpc_active()) {
+        mpc_condense_vector(g_global_force);
+    }
+
+    for (int i = 0; i < g_total_dof; i++) {
+        total_force += fabs(g_global_force[i]);
+    }
+
+    FEM_LOG_INFO("  Total applied force magnitude: %.6e\n", total_force);
+    FEM_LOG_INFO("  Global force vector assembled successfully\n");
     return FEM_SUCCESS;
 }
 
@@ -347,9 +728,8 @@ fem_error_t assembly_global_stiffness_matrix(void)
 fem_error_t assembly_global_force_vector(void)
 {
     int node_id, dof;
-    double total_force = 0.0;
 
-    printf("Assembling global force vector...\n");
+    FEM_LOG_INFO("Assembling global force vector...\n");
 
     if (!g_global_force) {
         return error_set(FEM_ERROR_INVALID_INPUT, "Global force vector not initialized");
@@ -362,8 +742,8 @@ fem_error_t assembly_global_force_vector(void)
 
     /* Add nodal forces */
     for (node_id = 0; node_id < g_num_nodes; node_id++) {
-        for (dof = 0; dof < 2; dof++) { /* 2D problem */
-            int global_dof = node_id * 2 + dof;
+        for (dof = 0; dof < g_dof_per_node; dof++) {
+            int global_dof = node_id * g_dof_per_node + dof;
             if (global_dof < g_total_dof && fabs(g_node_force[node_id][dof]) > 0.0) {
                 g_global_force[global_dof] += g_node_force[node_id][dof];
             }
@@ -376,6 +756,12 @@ fem_error_t assembly_global_force_vector(void)
         CHECK_ERROR(err);
     }
 
+    /* Edge tractions and pressures are defined for plane models only */
+    if (g_analysis.spatial_dimension == 3 && (g_num_tractions > 0 || g_has_pressure)) {
+        FEM_LOG_WARN("  Warning: traction and pressure loads are ignored for solid elements.\n");
+        return assembly_finish_force_vector();
+    }
+
     /* Surface tractions */
     if (g_num_tractions > 0) {
         fem_error_t err = assembly_apply_traction_loads();
@@ -387,17 +773,11 @@ fem_error_t assembly_global_force_vector(void)
             fem_error_t err = assembly_apply_pressure_loads();
             CHECK_ERROR(err);
         } else {
-            printf("  Warning: pressure value specified but no pressure surfaces defined.\n");
+            FEM_LOG_WARN("  Warning: pressure value specified but no pressure surfaces defined.\n");
         }
     }
 
-    for (int i = 0; i < g_total_dof; i++) {
-        total_force += fabs(g_global_force[i]);
-    }
-
-    printf("  Total applied force magnitude: %.6e\n", total_force);
-    printf("  Global force vector assembled successfully\n");
-    return FEM_SUCCESS;
+    return assembly_finish_force_vector();
 }
 
 /* Add element stiffness matrix to global matrix */
@@ -410,8 +790,7 @@ fem_error_t assembly_add_element_stiffness(int element_id,
     err = assembly_get_element_dof_map(element_id, dof_map);
     CHECK_ERROR(err);
 
-    static int assembly_debug = 0;
-    if (!assembly_debug) {
+    if (FEM_LOG_ENABLED(FEM_LOG_LEVEL_TRACE)) {
         printf("  DOF mapping for element %d: ", element_id);
         for (int i = 0; i < T6_TOTAL_DOF; i++) {
             printf("%d ", dof_map[i]);
@@ -424,7 +803,6 @@ fem_error_t assembly_add_element_stiffness(int element_id,
             }
             printf("\n");
         }
-        assembly_debug = 1;
     }
 
     for (int i = 0; i < T6_TOTAL_DOF; i++) {
@@ -473,18 +851,190 @@ fem_error_t assembly_get_global_dof_index(int node_id, int local_dof)
     return node_id * 2 + local_dof; /* 2D problem */
 }
 
+/* Below this many constrained DOFs reactions are summed on one thread */
+#define ASSEMBLY_REACTION_PARALLEL_MIN 1024
+
+/* Before the boundary conditions overwrite them, copy the constrained rows
+ * of K (every stored entry of the symmetric skyline in the row or column
+ * of a constrained DOF) into a compact row structure, with the loads at
+ * those DOFs */
+static fem_error_t assembly_store_reaction_rows(void)
+{
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    int *row_of_dof;
+    fem_index_t *cursor;
+    int count = 0;
+    fem_index_t entries;
+
+    globals_free_reaction_data();
+
+    row_of_dof = fem_arena_alloc(&g_scratch_arena, (size_t)g_total_dof * sizeof(int));
+    if (!row_of_dof) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate reaction row map");
+    }
+    for (int i = 0; i < g_total_dof; i++) {
+        row_of_dof[i] = -1;
+    }
+    for (int node = 0; node < g_num_nodes; node++) {
+        for (int dof = 0; dof < 2; dof++) {
+            int global_dof = node * 2 + dof;
+            if (g_node_bc_flags[node][dof] == 1 && global_dof < g_total_dof) {
+                row_of_dof[global_dof] = count++;
+            }
+        }
+    }
+
+    g_reaction_dofs = fem_malloc((size_t)(count > 0 ? count : 1) * sizeof(int), FEM_MEMORY_VECTOR);
+    g_reaction_loads = fem_malloc((size_t)(count > 0 ? count : 1) * sizeof(double), FEM_MEMORY_VECTOR);
+    g_reaction_row_offsets = fem_calloc((size_t)count + 1, sizeof(fem_index_t), FEM_MEMORY_MATRIX);
+    cursor = fem_arena_alloc(&g_scratch_arena, (size_t)(count > 0 ? count : 1) * sizeof(fem_index_t));
+    if (!g_reaction_dofs || !g_reaction_loads || !g_reaction_row_offsets || !cursor) {
+        globals_free_reaction_data();
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate reaction rows");
+    }
+    for (int i = 0; i < g_total_dof; i++) {
+        if (row_of_dof[i] >= 0) {
+            g_reaction_dofs[row_of_dof[i]] = i;
+            g_reaction_loads[row_of_dof[i]] = g_global_force[i];
+        }
+    }
+
+    /* Count, then fill; column j stores rows profile[j]..j */
+    for (int j = 0; j < g_total_dof; j++) {
+        const double *column = g_global_stiffness_values + g_stiffness_offsets[j];
+        int top = g_stiffness_profile[j];
+        for (int i = top; i <= j; i++) {
+            if (column[i - top] == 0.0) {
+                continue;
+            }
+            if (row_of_dof[i] >= 0) {
+                g_reaction_row_offsets[row_of_dof[i] + 1]++;
+            }
+            if (i != j && row_of_dof[j] >= 0) {
+                g_reaction_row_offsets[row_of_dof[j] + 1]++;
+            }
+        }
+    }
+    for (int r = 0; r < count; r++) {
+        g_reaction_row_offsets[r + 1] += g_reaction_row_offsets[r];
+        cursor[r] = g_reaction_row_offsets[r];
+    }
+    entries = g_reaction_row_offsets[count];
+
+    g_reaction_columns = fem_malloc((size_t)(entries > 0 ? entries : 1) * sizeof(int), FEM_MEMORY_MATRIX);
+    g_reaction_values = fem_malloc((size_t)(entries > 0 ? entries : 1) * sizeof(double), FEM_MEMORY_MATRIX);
+    if (!g_reaction_columns || !g_reaction_values) {
+        globals_free_reaction_data();
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Failed to allocate reaction rows (%lld entries)", (long long)entries);
+    }
+    for (int j = 0; j < g_total_dof; j++) {
+        const double *column = g_global_stiffness_values + g_stiffness_offsets[j];
+        int top = g_stiffness_profile[j];
+        for (int i = top; i <= j; i++) {
+            double value = column[i - top];
+            if (value == 0.0) {
+                continue;
+            }
+            if (row_of_dof[i] >= 0) {
+                fem_index_t at = cursor[row_of_dof[i]]++;
+                g_reaction_columns[at] = j;
+                g_reaction_values[at] = value;
+            }
+            if (i != j && row_of_dof[j] >= 0) {
+                fem_index_t at = cursor[row_of_dof[j]]++;
+                g_reaction_columns[at] = i;
+                g_reaction_values[at] = value;
+            }
+        }
+    }
+
+    g_reaction_dof_count = count;
+    g_reactions_current = 0;
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    FEM_LOG_DEBUG("  Stored %d constrained rows (%lld entries) for reactions\n",
+                  count, (long long)entries);
+    return FEM_SUCCESS;
+}
+
+/* Refresh the loads at the constrained DOFs from g_global_force, which
+ * must not have had the boundary conditions applied yet */
+void assembly_store_reaction_loads(void)
+{
+    for (int r = 0; r < g_reaction_dof_count; r++) {
+        g_reaction_loads[r] = g_global_force[g_reaction_dofs[r]];
+    }
+    g_reactions_current = 0;
+}
+
+/* R = K_c u - f_c over the stored rows, one sparse pass */
+fem_error_t assembly_compute_reactions(void)
+{
+    const fem_index_t *offsets = g_reaction_row_offsets;
+    const int *columns = g_reaction_columns;
+    const double *values = g_reaction_values;
+    const double *loads = g_reaction_loads;
+    const int *dof_index = g_reaction_dofs;
+    const double *u = g_global_displ;
+    double (*reaction)[3];
+    int count = g_reaction_dof_count;
+    int dofs = g_dof_per_node;
+
+    if (!offsets || !u) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Constrained rows not stored; boundary conditions were not applied");
+    }
+    if (!g_node_reaction) {
+        g_node_reaction = fem_calloc((size_t)(g_num_nodes > 0 ? g_num_nodes : 1),
+                                     sizeof(*g_node_reaction), FEM_MEMORY_VECTOR);
+        if (!g_node_reaction) {
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate reactions");
+        }
+    } else {
+        memset(g_node_reaction, 0, (size_t)g_num_nodes * sizeof(*g_node_reaction));
+    }
+    reaction = g_node_reaction;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) if (count >= ASSEMBLY_REACTION_PARALLEL_MIN)
+#endif
+    for (int r = 0; r < count; r++) {
+        double sum = 0.0;
+        for (fem_index_t k = offsets[r]; k < offsets[r + 1]; k++) {
+            sum += values[k] * u[columns[k]];
+        }
+        reaction[dof_index[r] / dofs][dof_index[r] % dofs] = sum - loads[r];
+    }
+
+    g_reactions_current = 1;
+    return FEM_SUCCESS;
+}
+
 /* Apply boundary conditions */
 fem_error_t assembly_apply_boundary_conditions(void)
 {
     int node_id, dof, global_dof, i;
+    fem_error_t err;
 
-    printf("Applying boundary conditions...\n");
+    FEM_LOG_INFO("Applying boundary conditions...\n");
     int bc_count = 0;
 
     if (!g_global_force || !g_global_displ || !g_global_stiffness_values) {
         return error_set(FEM_ERROR_INVALID_INPUT, "Global system arrays not initialized");
     }
 
+    /* Dependent DOFs of multipoint constraints are decoupled identity rows */
+    for (i = 0; i < g_mpc_row_count; i++) {
+        err = assembly_matrix_set_value(g_mpc_dependent_dofs[i], g_mpc_dependent_dofs[i], 1.0);
+        CHECK_ERROR(err);
+    }
+
+    /* The loop below overwrites the constrained rows and columns */
+    err = assembly_store_reaction_rows();
+    CHECK_ERROR(err);
+
     for (node_id = 0; node_id < g_num_nodes; node_id++) {
         for (dof = 0; dof < 2; dof++) { /* 2D problem */
             if (g_node_bc_flags[node_id][dof] == 1) {
@@ -503,16 +1053,16 @@ fem_error_t assembly_apply_boundary_conditions(void)
                         }
                         double kij = assembly_matrix_get_value(i, global_dof);
                         g_global_force[i] -= kij * prescribed_value;
-                        fem_error_t err = assembly_matrix_set_value(i, global_dof, 0.0);
+                        err = assembly_matrix_set_value(i, global_dof, 0.0);
                         CHECK_ERROR(err);
                     }
 
-                    fem_error_t err = assembly_matrix_set_value(global_dof, global_dof, 1.0);
+                    err = assembly_matrix_set_value(global_dof, global_dof, 1.0);
                     CHECK_ERROR(err);
 
                     g_global_force[global_dof] = prescribed_value;
 
-                    printf("  BC: Node %d DOF %d (global %d): diag %.3e -> 1.000, prescribed=%.3f\n",
+                    FEM_LOG_DEBUG("  BC: Node %d DOF %d (global %d): diag %.3e -> 1.000, prescribed=%.3f\n",
                            node_id + 1, dof, global_dof, original_diag, prescribed_value);
                     bc_count++;
                 }
@@ -520,19 +1070,20 @@ fem_error_t assembly_apply_boundary_conditions(void)
         }
     }
 
-    printf("  Applied %d boundary conditions\n", bc_count);
+    FEM_LOG_INFO("  Applied %d boundary conditions\n", bc_count);
 
-    /* Debug: Print relevant part of global stiffness matrix */
-    printf("  Global stiffness matrix sample (rows 0-5, cols 0-5):\n");
-    for (int i = 0; i < 6 && i < g_total_dof; i++) {
-        printf("    ");
-        for (int j = 0; j < 6 && j < g_total_dof; j++) {
-            printf("%8.1e ", assembly_matrix_get_value(i, j));
+    if (FEM_LOG_ENABLED(FEM_LOG_LEVEL_DEBUG)) {
+        printf("  Global stiffness matrix sample (rows 0-5, cols 0-5):\n");
+        for (int i = 0; i < 6 && i < g_total_dof; i++) {
+            printf("    ");
+            for (int j = 0; j < 6 && j < g_total_dof; j++) {
+                printf("%8.1e ", assembly_matrix_get_value(i, j));
+            }
+            printf("\n");
         }
-        printf("\n");
     }
 
-    printf("  Boundary conditions applied successfully\n");
+    FEM_LOG_INFO("  Boundary conditions applied successfully\n");
     return FEM_SUCCESS;
 }
 
@@ -543,7 +1094,7 @@ fem_error_t assembly_check_matrix_properties(void)
     double max_diagonal = -1.0e30;
     int zero_diagonal_count = 0;
 
-    printf("Checking global stiffness matrix properties...\n");
+    FEM_LOG_INFO("Checking global stiffness matrix properties...\n");
 
     if (!g_global_stiffness_values) {
         return error_set(FEM_ERROR_INVALID_INPUT, "Global stiffness matrix not initialized");
@@ -560,8 +1111,14 @@ fem_error_t assembly_check_matrix_properties(void)
         if (diag_val > max_diagonal) max_diagonal = diag_val;
     }
 
-    printf("  Diagonal terms: min = %e, max = %e\n", min_diagonal, max_diagonal);
-    printf("  Zero diagonal terms: %d\n", zero_diagonal_count);
+    return assembly_check_diagonal(min_diagonal, max_diagonal, zero_diagonal_count);
+}
+
+fem_error_t assembly_check_diagonal(double min_diagonal, double max_diagonal,
+                                    int zero_diagonal_count)
+{
+    FEM_LOG_INFO("  Diagonal terms: min = %e, max = %e\n", min_diagonal, max_diagonal);
+    FEM_LOG_INFO("  Zero diagonal terms: %d\n", zero_diagonal_count);
 
     if (zero_diagonal_count > 0) {
         return error_set(FEM_ERROR_SINGULAR_MATRIX, 
@@ -574,7 +1131,7 @@ fem_error_t assembly_check_matrix_properties(void)
                         "Global stiffness matrix has non-positive diagonal terms");
     }
 
-    printf("  Matrix properties check passed\n");
+    FEM_LOG_INFO("  Matrix properties check passed\n");
     return FEM_SUCCESS;
 }
 
@@ -590,22 +1147,20 @@ fem_error_t assembly_parallel_stiffness_matrix(void)
     CHECK_ERROR(err);
 
 #ifdef _OPENMP
-    printf("Assembling global stiffness matrix (serial fallback, OpenMP build pending)...\n");
+    FEM_LOG_INFO("Assembling global stiffness matrix (serial fallback, OpenMP build pending)...\n");
 #else
-    printf("Assembling global stiffness matrix...\n");
+    FEM_LOG_INFO("Assembling global stiffness matrix...\n");
 #endif
-    printf("  Elements: %d\n", g_num_elements);
+    FEM_LOG_INFO("  Elements: %d\n", g_num_elements);
 
     for (int debug_idx = 0; debug_idx < g_num_elements && debug_idx < 5; ++debug_idx) {
-        printf("    element %d type %d\n", debug_idx, g_element_type[debug_idx]);
+        FEM_LOG_DEBUG("    element %d type %d\n", debug_idx, g_element_type[debug_idx]);
     }
-    fflush(stdout);
 
     for (int element_id = 0; element_id < g_num_elements; element_id++) {
         fem_error_t local_err = FEM_SUCCESS;
 
-        fprintf(stderr, "    [debug] element %d raw type %d\n", element_id, g_element_type[element_id]);
-        fflush(stderr);
+        FEM_LOG_TRACE("    element %d raw type %d\n", element_id, g_element_type[element_id]);
 
         switch (g_element_type[element_id]) {
             case ELEMENT_T6: {
@@ -638,12 +1193,12 @@ fem_error_t assembly_parallel_stiffness_matrix(void)
         }
 
         if (local_err != FEM_SUCCESS) {
-            printf("  Error assembling element %d into global matrix: %d\n", element_id, local_err);
+            FEM_LOG_ERROR("  Error assembling element %d into global matrix: %d\n", element_id, local_err);
             return local_err;
         }
     }
 
-    printf("  Assembly completed\n");
+    FEM_LOG_INFO("  Assembly completed\n");
     return FEM_SUCCESS;
 }
 
@@ -740,6 +1295,11 @@ static fem_error_t assembly_apply_body_force(void)
             case ELEMENT_Q4:
                 err = assembly_apply_body_force_q4(element_id);
                 break;
+            case ELEMENT_T4:
+            case ELEMENT_T10:
+            case ELEMENT_H8:
+                err = assembly_apply_body_force_solid(element_id);
+                break;
             default:
                 /* Skip unsupported elements for body force */
                 err = FEM_SUCCESS;
@@ -751,6 +1311,27 @@ static fem_error_t assembly_apply_body_force(void)
     return FEM_SUCCESS;
 }
 
+static fem_error_t assembly_apply_body_force_solid(int element_id)
+{
+    double fe[SOLID3D_MAX_NODES * SOLID3D_DOF_PER_NODE];
+    int dof_map[SOLID3D_MAX_NODES * SOLID3D_DOF_PER_NODE];
+    int nodes = solid3d_node_count(g_element_type[element_id]);
+    fem_error_t err;
+
+    err = solid3d_body_force(element_id, g_body_force, fe);
+    CHECK_ERROR(err);
+
+    for (int i = 0; i < nodes; i++) {
+        int node_index = g_element_nodes[element_id][i];
+        for (int k = 0; k < SOLID3D_DOF_PER_NODE; k++) {
+            dof_map[3 * i + k] = node_index * 3 + k;
+        }
+    }
+
+    assembly_accumulate_force(nodes * SOLID3D_DOF_PER_NODE, dof_map, fe);
+    return FEM_SUCCESS;
+}
+
 static double assembly_get_element_thickness(int element_id)
 {
     int material_index = g_element_material[element_id];
@@ -32,8 +32,50 @@ fem_error_t assembly_get_global_dof_index(int node_id, int local_dof);
 /* Utility functions */
 fem_error_t assembly_apply_boundary_conditions(void);
 fem_error_t assembly_check_matrix_properties(void);
+/* Report the diagonal range found by a check and fail on zero or
+ * negative terms */
+fem_error_t assembly_check_diagonal(double min_diagonal, double max_diagonal,
+                                    int zero_diagonal_count);
+
+/* Reaction recovery: the boundary condition routine keeps the constrained
+ * rows of K and their loads; after the solve the reactions follow from
+ * one pass over them into g_node_reaction. Load-only updates refresh the
+ * stored loads from the unconstrained force vector. */
+void assembly_store_reaction_loads(void);
+fem_error_t assembly_compute_reactions(void);
 
 /* OpenMP parallel assembly */
 fem_error_t assembly_parallel_stiffness_matrix(void);
 
+/* Building blocks of pipelined preprocessing (pipeline.c): skyline column
+ * tops grown element by element, element matrices kept as packed upper
+ * triangles (row by row) until the profile is known */
+fem_error_t assembly_profile_add_element(int *profile, int dof, int element_id);
+fem_error_t assembly_prepare_global_system_with_profile(int *profile);
+int assembly_element_stiffness_packed_size(int element_type);
+fem_error_t assembly_collect_element_dofs(int element_id, int *dof_map, int *dof_count);
+fem_error_t assembly_element_stiffness_packed(int element_id, double *ke_upper);
+fem_error_t assembly_add_element_stiffness_packed(int element_id, const double *ke_upper);
+
+/* Resize the system to total_dof after the mesh has grown by inserting
+ * nodes (mesh_refine.h): the column tops of the old_nodes existing nodes
+ * are carried over through node_map (old index -> new index, increasing)
+ * and only the listed elements, those that changed, are scanned again.
+ * Without a previous profile the next assembly builds it from scratch. */
+fem_error_t assembly_grow_stiffness_profile(int total_dof, const int *node_map, int old_nodes,
+                                            const int *elements, int count);
+
+/* Skyline profile (g_stiffness_profile, g_stiffness_offsets) and zeroed
+ * system vectors without the value array, for solvers that keep the
+ * matrix elsewhere (skyline_ooc.h) */
+fem_error_t assembly_prepare_stiffness_profile(void);
+
+/* Scatter a packed element matrix into values, an array laid out like
+ * g_global_stiffness_values (mass and other matrices on the same profile) */
+fem_error_t assembly_add_element_matrix_packed(int element_id, const double *me_upper, double *values);
+
+/* Consistent mass matrix of the plane elements (element_mass.h) added
+ * into values, laid out like g_global_stiffness_values */
+fem_error_t assembly_global_mass_matrix(double *values);
+
 #endif /* ASSEMBLY_H */
\ No newline at end of file
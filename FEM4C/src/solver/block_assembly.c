@@ -0,0 +1,767 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Block sparse assembly for solid models
+ */
+
+#include "block_assembly.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_log.h"
+#include "../common/fem_memory.h"
+#include "../elements/solid3d/solid3d_element.h"
+#include "mpc.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Below this many node rows (elements) a pass runs on the calling thread */
+#define BLOCK_ASSEMBLY_PARALLEL_MIN 256
+
+/* Elements around each node, CSR over the nodes */
+typedef struct {
+    int *offsets;
+    int *elements;
+    int max_elements;
+} block_node_elements_t;
+
+/* Node rows each element writes, CSR over the elements. Only built with
+ * multipoint constraints: the nodes of the element with the dependent
+ * components replaced by the nodes of their masters (mpc.h). Without, the
+ * element nodes are used directly. */
+typedef struct {
+    int *offsets;
+    int *nodes;
+    int max_nodes;
+} block_element_rows_t;
+
+static int block_int_compare(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static int block_element_row_nodes(const block_element_rows_t *rows, int element_id,
+                                   const int **nodes)
+{
+    if (rows->offsets) {
+        *nodes = rows->nodes + rows->offsets[element_id];
+        return rows->offsets[element_id + 1] - rows->offsets[element_id];
+    }
+    *nodes = g_element_nodes[element_id];
+    return solid3d_node_count(g_element_type[element_id]);
+}
+
+static fem_error_t block_build_element_rows(block_element_rows_t *rows)
+{
+    int dofs[SOLID3D_MAX_NODES * SOLID3D_DOF_PER_NODE];
+    int capacity = SOLID3D_MAX_NODES * SOLID3D_DOF_PER_NODE * (g_mpc_max_terms > 1 ? g_mpc_max_terms : 1);
+    int *masters;
+    int max_nodes = 0;
+
+    rows->max_nodes = SOLID3D_MAX_NODES;
+    if (!mpc_active()) {
+        return FEM_SUCCESS;
+    }
+
+    rows->offsets = fem_arena_alloc(&g_scratch_arena, (size_t)(g_num_elements + 1) * sizeof(int));
+    masters = fem_arena_alloc(&g_scratch_arena, (size_t)capacity * sizeof(int));
+    if (!rows->offsets || !masters) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate constrained element rows");
+    }
+
+    /* Count, then fill */
+    for (int pass = 0; pass < 2; pass++) {
+        rows->offsets[0] = 0;
+        for (int e = 0; e < g_num_elements; e++) {
+            int nodes = solid3d_node_count(g_element_type[e]);
+            int count;
+            int unique = 0;
+
+            for (int a = 0; a < nodes; a++) {
+                for (int k = 0; k < SOLID3D_DOF_PER_NODE; k++) {
+                    dofs[a * SOLID3D_DOF_PER_NODE + k] = g_element_nodes[e][a] * SOLID3D_DOF_PER_NODE + k;
+                }
+            }
+            /* Master DOFs, then compacted in place to their nodes */
+            count = mpc_expand_dofs(dofs, nodes * SOLID3D_DOF_PER_NODE, masters, capacity);
+            for (int i = 0; i < count; i++) {
+                int node = masters[i] / SOLID3D_DOF_PER_NODE;
+                int seen = 0;
+                for (int j = 0; j < unique && !seen; j++) {
+                    seen = masters[j] == node;
+                }
+                if (!seen) {
+                    masters[unique++] = node;
+                }
+            }
+            if (pass == 1) {
+                memcpy(rows->nodes + rows->offsets[e], masters, (size_t)unique * sizeof(int));
+            } else if (unique > max_nodes) {
+                max_nodes = unique;
+            }
+            rows->offsets[e + 1] = rows->offsets[e] + unique;
+        }
+        if (pass == 0) {
+            rows->nodes = fem_arena_alloc(&g_scratch_arena,
+                                          (size_t)(rows->offsets[g_num_elements] + 1) * sizeof(int));
+            if (!rows->nodes) {
+                return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                                 "Failed to allocate constrained element rows");
+            }
+        }
+    }
+    rows->max_nodes = max_nodes;
+    return FEM_SUCCESS;
+}
+
+static fem_error_t block_build_node_elements(const block_element_rows_t *rows,
+                                             block_node_elements_t *adjacency)
+{
+    int *cursor;
+
+    adjacency->offsets = fem_arena_alloc(&g_scratch_arena, (size_t)(g_num_nodes + 1) * sizeof(int));
+    cursor = fem_arena_alloc(&g_scratch_arena, (size_t)(g_num_nodes + 1) * sizeof(int));
+    if (!adjacency->offsets || !cursor) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate node adjacency");
+    }
+    memset(adjacency->offsets, 0, (size_t)(g_num_nodes + 1) * sizeof(int));
+
+    for (int e = 0; e < g_num_elements; e++) {
+        const int *element_nodes;
+        int nodes = block_element_row_nodes(rows, e, &element_nodes);
+        if (solid3d_node_count(g_element_type[e]) == 0) {
+            return error_set(FEM_ERROR_INVALID_ELEMENT_TYPE,
+                             "Element %d (type %d) is not a solid element",
+                             e + 1, g_element_type[e]);
+        }
+        for (int a = 0; a < nodes; a++) {
+            int node = element_nodes[a];
+            if (node < 0 || node >= g_num_nodes) {
+                return error_set(FEM_ERROR_INVALID_NODE,
+                                 "Element %d references invalid node %d", e + 1, node);
+            }
+            adjacency->offsets[node + 1]++;
+        }
+    }
+
+    adjacency->max_elements = 0;
+    for (int n = 0; n < g_num_nodes; n++) {
+        if (adjacency->offsets[n + 1] > adjacency->max_elements) {
+            adjacency->max_elements = adjacency->offsets[n + 1];
+        }
+        adjacency->offsets[n + 1] += adjacency->offsets[n];
+        cursor[n] = adjacency->offsets[n];
+    }
+
+    adjacency->elements = fem_arena_alloc(&g_scratch_arena,
+                                          (size_t)(adjacency->offsets[g_num_nodes] + 1) * sizeof(int));
+    if (!adjacency->elements) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate node adjacency");
+    }
+    for (int e = 0; e < g_num_elements; e++) {
+        const int *element_nodes;
+        int nodes = block_element_row_nodes(rows, e, &element_nodes);
+        for (int a = 0; a < nodes; a++) {
+            adjacency->elements[cursor[element_nodes[a]]++] = e;
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+/* Node columns of every row: the sorted, unique nodes of the elements
+ * around the row node. Counted in one parallel pass and filled in a
+ * second one, each thread gathering into its own buffer. */
+static fem_error_t block_build_pattern(const block_element_rows_t *rows,
+                                       const block_node_elements_t *adjacency)
+{
+    fem_context_t *model = g_fem_context;
+    int threads = 1;
+    int buffer_size = adjacency->max_elements * rows->max_nodes + 1;
+    int *buffers;
+
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+
+    buffers = fem_arena_alloc(&g_scratch_arena, (size_t)threads * buffer_size * sizeof(int));
+    g_block_row_offsets = fem_calloc((size_t)g_num_nodes + 1, sizeof(fem_index_t), FEM_MEMORY_MATRIX);
+    g_block_diagonal = fem_malloc((size_t)g_num_nodes * sizeof(fem_index_t), FEM_MEMORY_MATRIX);
+    if (!buffers || !g_block_row_offsets || !g_block_diagonal) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate block pattern");
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+#ifdef _OPENMP
+        #pragma omp parallel if (g_num_nodes >= BLOCK_ASSEMBLY_PARALLEL_MIN)
+#endif
+        {
+            fem_context_bind(model);
+            int thread = 0;
+#ifdef _OPENMP
+            thread = omp_get_thread_num();
+#endif
+            int *columns = buffers + (size_t)thread * buffer_size;
+
+#ifdef _OPENMP
+            #pragma omp for schedule(dynamic, 64)
+#endif
+            for (int n = 0; n < g_num_nodes; n++) {
+                int count = 0;
+                int unique = 0;
+
+                for (int k = adjacency->offsets[n]; k < adjacency->offsets[n + 1]; k++) {
+                    const int *element_nodes;
+                    int nodes = block_element_row_nodes(rows, adjacency->elements[k], &element_nodes);
+                    for (int a = 0; a < nodes; a++) {
+                        columns[count++] = element_nodes[a];
+                    }
+                }
+                if (count == 0) {
+                    /* Free node: keep the diagonal block so the row is solvable */
+                    columns[count++] = n;
+                }
+                qsort(columns, (size_t)count, sizeof(int), block_int_compare);
+                for (int k = 0; k < count; k++) {
+                    if (unique == 0 || columns[k] != columns[unique - 1]) {
+                        columns[unique++] = columns[k];
+                    }
+                }
+
+                if (pass == 0) {
+                    g_block_row_offsets[n + 1] = unique;
+                } else {
+                    fem_index_t first = g_block_row_offsets[n];
+                    memcpy(g_block_columns + first, columns, (size_t)unique * sizeof(int));
+                    for (int k = 0; k < unique; k++) {
+                        if (columns[k] == n) {
+                            g_block_diagonal[n] = first + k;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (int n = 0; n < g_num_nodes; n++) {
+                g_block_row_offsets[n + 1] += g_block_row_offsets[n];
+            }
+            g_block_count = g_block_row_offsets[g_num_nodes];
+            g_block_columns = fem_malloc((size_t)g_block_count * sizeof(int), FEM_MEMORY_MATRIX);
+            g_block_values = fem_malloc((size_t)g_block_count * sizeof(*g_block_values),
+                                        FEM_MEMORY_MATRIX);
+            if (!g_block_columns || !g_block_values) {
+                return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                                 "Failed to allocate block matrix (%lld blocks)",
+                                 (long long)g_block_count);
+            }
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+/* Greedy colouring: each element takes the smallest colour not used by an
+ * element sharing one of its nodes. Within a colour the elements are
+ * grouped by type so that batches hold one type. */
+static fem_error_t block_color_elements(const block_element_rows_t *rows,
+                                        const block_node_elements_t *adjacency)
+{
+    static const int solid_types[3] = {ELEMENT_T4, ELEMENT_T10, ELEMENT_H8};
+    int *color;
+    int *forbidden;
+    int *cursor;
+    int max_colors = adjacency->max_elements * rows->max_nodes + 1;
+    int colors = 0;
+
+    color = fem_arena_alloc(&g_scratch_arena, (size_t)g_num_elements * sizeof(int));
+    forbidden = fem_arena_alloc(&g_scratch_arena, (size_t)max_colors * sizeof(int));
+    if (!color || !forbidden) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate element colouring");
+    }
+    for (int c = 0; c < max_colors; c++) {
+        forbidden[c] = -1;
+    }
+
+    for (int e = 0; e < g_num_elements; e++) {
+        const int *element_nodes;
+        int nodes = block_element_row_nodes(rows, e, &element_nodes);
+        int c = 0;
+
+        for (int a = 0; a < nodes; a++) {
+            int node = element_nodes[a];
+            for (int k = adjacency->offsets[node]; k < adjacency->offsets[node + 1]; k++) {
+                int other = adjacency->elements[k];
+                if (other < e) {
+                    forbidden[color[other]] = e;
+                }
+            }
+        }
+        while (forbidden[c] == e) {
+            c++;
+        }
+        color[e] = c;
+        if (c + 1 > colors) {
+            colors = c + 1;
+        }
+    }
+
+    g_color_offsets = fem_calloc((size_t)colors + 1, sizeof(int), FEM_MEMORY_MATRIX);
+    g_color_elements = fem_malloc((size_t)g_num_elements * sizeof(int), FEM_MEMORY_MATRIX);
+    cursor = fem_arena_alloc(&g_scratch_arena, (size_t)(colors + 1) * sizeof(int));
+    if (!g_color_offsets || !g_color_elements || !cursor) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate element colouring");
+    }
+    for (int e = 0; e < g_num_elements; e++) {
+        g_color_offsets[color[e] + 1]++;
+    }
+    for (int c = 0; c < colors; c++) {
+        g_color_offsets[c + 1] += g_color_offsets[c];
+        cursor[c] = g_color_offsets[c];
+    }
+    for (int t = 0; t < 3; t++) {
+        for (int e = 0; e < g_num_elements; e++) {
+            if (g_element_type[e] == solid_types[t]) {
+                g_color_elements[cursor[color[e]]++] = e;
+            }
+        }
+    }
+    g_color_count = colors;
+    return FEM_SUCCESS;
+}
+
+fem_index_t block_assembly_find(int row, int column)
+{
+    const int *columns = g_block_columns;
+    fem_index_t low = g_block_row_offsets[row];
+    fem_index_t high = g_block_row_offsets[row + 1] - 1;
+
+    while (low <= high) {
+        fem_index_t mid = low + (high - low) / 2;
+        if (columns[mid] == column) {
+            return mid;
+        }
+        if (columns[mid] < column) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return -1;
+}
+
+/* Masters and coefficients of a DOF under u = T u_r (mpc.h); an
+ * independent DOF is its own master */
+static int block_mpc_terms(int dof, int *self, const int **masters, const double **coefficients)
+{
+    static const double unit = 1.0;
+    int row = g_mpc_dof_row[dof];
+
+    if (row < 0) {
+        *self = dof;
+        *masters = self;
+        *coefficients = &unit;
+        return 1;
+    }
+    *masters = g_mpc_masters + g_mpc_row_offsets[row];
+    *coefficients = g_mpc_coefficients + g_mpc_row_offsets[row];
+    return g_mpc_row_offsets[row + 1] - g_mpc_row_offsets[row];
+}
+
+/* Element with dependent DOFs: every entry is spread over the masters of
+ * its row and column DOFs (T^T K T; both triangles are stored) */
+static void block_scatter_constrained(int element_id, int nodes, const double *ke)
+{
+    for (int a = 0; a < nodes; a++) {
+        for (int b = 0; b < nodes; b++) {
+            const double *block = ke + ((size_t)a * nodes + b) * 9;
+            for (int k = 0; k < 3; k++) {
+                const int *row_masters;
+                const double *row_coefficients;
+                int row_self;
+                int row_terms = block_mpc_terms(g_element_nodes[element_id][a] * 3 + k, &row_self,
+                                                &row_masters, &row_coefficients);
+                for (int l = 0; l < 3; l++) {
+                    const int *col_masters;
+                    const double *col_coefficients;
+                    int col_self;
+                    int col_terms = block_mpc_terms(g_element_nodes[element_id][b] * 3 + l, &col_self,
+                                                    &col_masters, &col_coefficients);
+                    double value = block[k * 3 + l];
+                    if (value == 0.0) {
+                        continue;
+                    }
+                    for (int p = 0; p < row_terms; p++) {
+                        for (int q = 0; q < col_terms; q++) {
+                            int m = row_masters[p];
+                            int n = col_masters[q];
+                            fem_index_t at = block_assembly_find(m / 3, n / 3);
+                            g_block_values[at][(m % 3) * 3 + n % 3] +=
+                                row_coefficients[p] * col_coefficients[q] * value;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+static int block_element_constrained(int element_id, int nodes)
+{
+    if (!g_mpc_dof_row) {
+        return 0;
+    }
+    for (int a = 0; a < nodes; a++) {
+        for (int k = 0; k < 3; k++) {
+            if (g_mpc_dof_row[g_element_nodes[element_id][a] * 3 + k] >= 0) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Add the blocks of one element; its rows belong to no other element of
+ * the colour being assembled */
+static void block_scatter_element(int element_id, int nodes, const double *ke)
+{
+    if (block_element_constrained(element_id, nodes)) {
+        block_scatter_constrained(element_id, nodes, ke);
+        return;
+    }
+    for (int a = 0; a < nodes; a++) {
+        int row = g_element_nodes[element_id][a];
+        for (int b = 0; b < nodes; b++) {
+            fem_index_t at = block_assembly_find(row, g_element_nodes[element_id][b]);
+            const double *block = ke + ((size_t)a * nodes + b) * 9;
+            for (int k = 0; k < 9; k++) {
+                g_block_values[at][k] += block[k];
+            }
+        }
+    }
+}
+
+/* Pattern, colouring and system vectors; kept for a re-assembly of the
+ * same mesh */
+static fem_error_t block_prepare_global_system(void)
+{
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    block_element_rows_t rows = {0};
+    block_node_elements_t adjacency = {0};
+    int expected_dof = g_num_nodes * SOLID3D_DOF_PER_NODE;
+    fem_error_t err;
+
+    if (g_block_values && g_color_offsets && g_total_dof == expected_dof) {
+        return FEM_SUCCESS;
+    }
+
+    err = globals_allocate_system_arrays(expected_dof);
+    CHECK_ERROR(err);
+
+    err = block_build_element_rows(&rows);
+    if (err == FEM_SUCCESS) {
+        err = block_build_node_elements(&rows, &adjacency);
+    }
+    if (err == FEM_SUCCESS) {
+        err = block_build_pattern(&rows, &adjacency);
+    }
+    if (err == FEM_SUCCESS) {
+        err = block_color_elements(&rows, &adjacency);
+    }
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    CHECK_ERROR(err);
+
+    FEM_LOG_INFO("  Block pattern: %lld 3x3 blocks, %d element colours\n",
+                 (long long)g_block_count, g_color_count);
+    return FEM_SUCCESS;
+}
+
+fem_error_t block_assembly_stiffness_matrix(void)
+{
+    fem_context_t *model = g_fem_context;
+    fem_arena_mark_t scratch;
+    size_t batch_size = (size_t)SOLID3D_BATCH_SIZE * SOLID3D_MAX_BLOCKS * 9;
+    fem_error_t status = FEM_SUCCESS;
+    char message[ERROR_MSG_LEN] = "";
+    int threads = 1;
+    double *buffers;
+    fem_error_t err;
+
+    FEM_LOG_INFO("Assembling global stiffness matrix...\n");
+    FEM_LOG_INFO("  Number of elements: %d\n", g_num_elements);
+
+    err = solid3d_initialize();
+    CHECK_ERROR(err);
+    err = block_prepare_global_system();
+    CHECK_ERROR(err);
+
+    FEM_LOG_INFO("  Global DOF: %d\n", g_total_dof);
+
+    memset(g_block_values, 0, (size_t)g_block_count * sizeof(*g_block_values));
+    memset(g_global_force, 0, (size_t)g_total_dof * sizeof(double));
+    memset(g_global_displ, 0, (size_t)g_total_dof * sizeof(double));
+
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    scratch = fem_arena_mark(&g_scratch_arena);
+    buffers = fem_arena_alloc(&g_scratch_arena, (size_t)threads * batch_size * sizeof(double));
+    if (!buffers) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate element batch buffers");
+    }
+
+    for (int c = 0; c < g_color_count && status == FEM_SUCCESS; c++) {
+        int first = g_color_offsets[c];
+        int count = g_color_offsets[c + 1] - first;
+        int batches = (count + SOLID3D_BATCH_SIZE - 1) / SOLID3D_BATCH_SIZE;
+
+#ifdef _OPENMP
+        #pragma omp parallel if (count >= BLOCK_ASSEMBLY_PARALLEL_MIN)
+#endif
+        {
+            fem_context_bind(model);
+            int thread = 0;
+#ifdef _OPENMP
+            thread = omp_get_thread_num();
+#endif
+            double *ke = buffers + (size_t)thread * batch_size;
+
+#ifdef _OPENMP
+            #pragma omp for schedule(dynamic)
+#endif
+            for (int batch = 0; batch < batches; batch++) {
+                const int *elements = g_color_elements + first + batch * SOLID3D_BATCH_SIZE;
+                int remaining = count - batch * SOLID3D_BATCH_SIZE;
+                int size = remaining < SOLID3D_BATCH_SIZE ? remaining : SOLID3D_BATCH_SIZE;
+
+                /* Runs of one element type within the batch */
+                for (int start = 0; start < size;) {
+                    int type = g_element_type[elements[start]];
+                    int nodes = solid3d_node_count(type);
+                    int end = start + 1;
+                    while (end < size && g_element_type[elements[end]] == type) {
+                        end++;
+                    }
+
+                    fem_error_t batch_err = solid3d_stiffness_batch(type, elements + start,
+                                                                    end - start, ke);
+                    if (batch_err != FEM_SUCCESS) {
+#ifdef _OPENMP
+                        #pragma omp critical(block_assembly_error)
+#endif
+                        {
+                            if (status == FEM_SUCCESS) {
+                                status = batch_err;
+                                strncpy(message, error_get_message(), sizeof(message) - 1);
+                            }
+                        }
+                        break;
+                    }
+                    for (int e = start; e < end; e++) {
+                        block_scatter_element(elements[e], nodes,
+                                              ke + (size_t)(e - start) * nodes * nodes * 9);
+                    }
+                    start = end;
+                }
+            }
+        }
+    }
+
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    if (status != FEM_SUCCESS) {
+        return error_set(status, "%s", message);
+    }
+
+    FEM_LOG_INFO("  Global stiffness matrix assembled successfully\n");
+    return FEM_SUCCESS;
+}
+
+static int block_dof_constrained(int node, int component)
+{
+    return g_node_bc_flags[node][component] == 1;
+}
+
+/* Copy the constrained rows (block row of the node, one component) into
+ * the reaction row structure with the loads at those DOFs */
+static fem_error_t block_store_reaction_rows(void)
+{
+    int count = 0;
+    fem_index_t entries = 0;
+
+    globals_free_reaction_data();
+
+    for (int n = 0; n < g_num_nodes; n++) {
+        for (int k = 0; k < SOLID3D_DOF_PER_NODE; k++) {
+            if (block_dof_constrained(n, k)) {
+                count++;
+            }
+        }
+    }
+
+    g_reaction_dofs = fem_malloc((size_t)(count > 0 ? count : 1) * sizeof(int), FEM_MEMORY_VECTOR);
+    g_reaction_loads = fem_malloc((size_t)(count > 0 ? count : 1) * sizeof(double), FEM_MEMORY_VECTOR);
+    g_reaction_row_offsets = fem_calloc((size_t)count + 1, sizeof(fem_index_t), FEM_MEMORY_MATRIX);
+    if (!g_reaction_dofs || !g_reaction_loads || !g_reaction_row_offsets) {
+        globals_free_reaction_data();
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate reaction rows");
+    }
+
+    count = 0;
+    for (int n = 0; n < g_num_nodes; n++) {
+        for (int k = 0; k < SOLID3D_DOF_PER_NODE; k++) {
+            if (!block_dof_constrained(n, k)) {
+                continue;
+            }
+            g_reaction_dofs[count] = n * SOLID3D_DOF_PER_NODE + k;
+            g_reaction_loads[count] = g_global_force[n * SOLID3D_DOF_PER_NODE + k];
+            entries += (g_block_row_offsets[n + 1] - g_block_row_offsets[n]) * SOLID3D_DOF_PER_NODE;
+            g_reaction_row_offsets[++count] = entries;
+        }
+    }
+
+    g_reaction_columns = fem_malloc((size_t)(entries > 0 ? entries : 1) * sizeof(int), FEM_MEMORY_MATRIX);
+    g_reaction_values = fem_malloc((size_t)(entries > 0 ? entries : 1) * sizeof(double), FEM_MEMORY_MATRIX);
+    if (!g_reaction_columns || !g_reaction_values) {
+        globals_free_reaction_data();
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Failed to allocate reaction rows (%lld entries)", (long long)entries);
+    }
+
+    for (int r = 0; r < count; r++) {
+        int node = g_reaction_dofs[r] / SOLID3D_DOF_PER_NODE;
+        int k = g_reaction_dofs[r] % SOLID3D_DOF_PER_NODE;
+        fem_index_t at = g_reaction_row_offsets[r];
+        for (fem_index_t b = g_block_row_offsets[node]; b < g_block_row_offsets[node + 1]; b++) {
+            for (int m = 0; m < SOLID3D_DOF_PER_NODE; m++) {
+                g_reaction_columns[at] = g_block_columns[b] * SOLID3D_DOF_PER_NODE + m;
+                g_reaction_values[at] = g_block_values[b][k * 3 + m];
+                at++;
+            }
+        }
+    }
+
+    g_reaction_dof_count = count;
+    g_reactions_current = 0;
+    FEM_LOG_DEBUG("  Stored %d constrained rows (%lld entries) for reactions\n",
+                  count, (long long)entries);
+    return FEM_SUCCESS;
+}
+
+fem_error_t block_assembly_apply_boundary_conditions(void)
+{
+    fem_context_t *model = g_fem_context;
+    int bc_count = 0;
+    fem_error_t err;
+
+    FEM_LOG_INFO("Applying boundary conditions...\n");
+
+    if (!g_global_force || !g_global_displ || !g_block_values) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Global system arrays not initialized");
+    }
+
+    /* Dependent DOFs of multipoint constraints are decoupled identity rows */
+    for (int r = 0; r < g_mpc_row_count; r++) {
+        int dof = g_mpc_dependent_dofs[r];
+        int k = dof % SOLID3D_DOF_PER_NODE;
+        g_block_values[g_block_diagonal[dof / SOLID3D_DOF_PER_NODE]][k * 3 + k] = 1.0;
+    }
+
+    /* The pass below overwrites the constrained rows and columns */
+    err = block_store_reaction_rows();
+    CHECK_ERROR(err);
+
+    /* Row i only touches its own blocks and loads, so the rows are
+     * independent: move the constrained columns to the right-hand side,
+     * then replace the constrained rows by the prescribed values */
+#ifdef _OPENMP
+    #pragma omp parallel if (g_num_nodes >= BLOCK_ASSEMBLY_PARALLEL_MIN) reduction(+:bc_count)
+#endif
+    {
+        fem_context_bind(model);
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int i = 0; i < g_num_nodes; i++) {
+            double *f = g_global_force + (size_t)i * SOLID3D_DOF_PER_NODE;
+
+            for (fem_index_t b = g_block_row_offsets[i]; b < g_block_row_offsets[i + 1]; b++) {
+                int j = g_block_columns[b];
+                double *block = g_block_values[b];
+                for (int m = 0; m < SOLID3D_DOF_PER_NODE; m++) {
+                    if (!block_dof_constrained(j, m)) {
+                        continue;
+                    }
+                    double prescribed = g_node_displ[j][m];
+                    for (int k = 0; k < SOLID3D_DOF_PER_NODE; k++) {
+                        if (!block_dof_constrained(i, k)) {
+                            f[k] -= block[k * 3 + m] * prescribed;
+                        }
+                        block[k * 3 + m] = 0.0;
+                    }
+                }
+            }
+
+            for (int k = 0; k < SOLID3D_DOF_PER_NODE; k++) {
+                if (!block_dof_constrained(i, k)) {
+                    continue;
+                }
+                for (fem_index_t b = g_block_row_offsets[i]; b < g_block_row_offsets[i + 1]; b++) {
+                    for (int m = 0; m < SOLID3D_DOF_PER_NODE; m++) {
+                        g_block_values[b][k * 3 + m] = 0.0;
+                    }
+                }
+                g_block_values[g_block_diagonal[i]][k * 3 + k] = 1.0;
+                f[k] = g_node_displ[i][k];
+                bc_count++;
+            }
+        }
+    }
+
+    FEM_LOG_INFO("  Applied %d boundary conditions\n", bc_count);
+    FEM_LOG_INFO("  Boundary conditions applied successfully\n");
+    return FEM_SUCCESS;
+}
+
+fem_error_t block_assembly_check_matrix_properties(void)
+{
+    double min_diagonal = 1.0e30;
+    double max_diagonal = -1.0e30;
+    int zero_diagonal_count = 0;
+
+    FEM_LOG_INFO("Checking global stiffness matrix properties...\n");
+
+    if (!g_block_values) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Global stiffness matrix not initialized");
+    }
+
+    for (int i = 0; i < g_num_nodes; i++) {
+        const double *block = g_block_values[g_block_diagonal[i]];
+        for (int k = 0; k < SOLID3D_DOF_PER_NODE; k++) {
+            double diag_val = block[k * 3 + k];
+            if (fabs(diag_val) < TOLERANCE) {
+                zero_diagonal_count++;
+            }
+            if (diag_val < min_diagonal) min_diagonal = diag_val;
+            if (diag_val > max_diagonal) max_diagonal = diag_val;
+        }
+    }
+
+    FEM_LOG_INFO("  Diagonal terms: min = %e, max = %e\n", min_diagonal, max_diagonal);
+    FEM_LOG_INFO("  Zero diagonal terms: %d\n", zero_diagonal_count);
+
+    if (zero_diagonal_count > 0) {
+        return error_set(FEM_ERROR_SINGULAR_MATRIX,
+                         "Global stiffness matrix has %d zero diagonal terms",
+                         zero_diagonal_count);
+    }
+    if (min_diagonal <= 0.0) {
+        return error_set(FEM_ERROR_SINGULAR_MATRIX,
+                         "Global stiffness matrix has non-positive diagonal terms");
+    }
+
+    FEM_LOG_INFO("  Matrix properties check passed\n");
+    return FEM_SUCCESS;
+}
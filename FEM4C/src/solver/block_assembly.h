@@ -0,0 +1,40 @@
+#ifndef BLOCK_ASSEMBLY_H
+#define BLOCK_ASSEMBLY_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Block sparse assembly for solid models
+ *
+ * Solid models (three DOF per node) store K as 3x3 node blocks in a block
+ * compressed row structure holding both triangles: node row i owns the
+ * blocks g_block_values[g_block_row_offsets[i] .. g_block_row_offsets[i + 1]),
+ * with the sorted node columns in g_block_columns. The pattern follows from
+ * the node adjacency of the mesh; global DOF 3 * node + k is component k
+ * of the node.
+ *
+ * The elements are coloured so that no two elements of one colour share a
+ * node. Each colour is assembled in parallel without atomics, in batches of
+ * one element type for the solid stiffness kernel.
+ *
+ * With multipoint constraints (mpc.h) an element writes the rows of the
+ * masters of its dependent DOFs instead of their own; the pattern and the
+ * colouring are built over those rows.
+ */
+
+#include "../common/types.h"
+
+/* Build the block pattern and the element colouring, allocate the system
+ * vectors, and assemble the element stiffness matrices */
+fem_error_t block_assembly_stiffness_matrix(void);
+
+/* Boundary conditions by symmetric elimination, node rows in parallel.
+ * The constrained rows and their loads are kept for the reactions
+ * first (assembly_compute_reactions). */
+fem_error_t block_assembly_apply_boundary_conditions(void);
+
+/* Diagonal checks of the assembled matrix */
+fem_error_t block_assembly_check_matrix_properties(void);
+
+/* Position of block (row, column) in g_block_values, -1 if not stored */
+fem_index_t block_assembly_find(int row, int column);
+
+#endif /* BLOCK_ASSEMBLY_H */
@@ -0,0 +1,331 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Block Jacobi preconditioned conjugate gradients
+ */
+
+#include "block_pcg.h"
+#include "krylov_recycle.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_log.h"
+#include "../common/fem_memory.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Below this many node rows the loops run on the calling thread */
+#define BLOCK_PCG_PARALLEL_MIN 512
+
+fem_error_t block_pcg_multiply(const double *x, double *y)
+{
+    const fem_index_t *offsets = g_block_row_offsets;
+    const int *columns = g_block_columns;
+    const double (*values)[9] = (const double (*)[9])g_block_values;
+    int nodes = g_num_nodes;
+
+    if (!offsets || !columns || !values) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Global stiffness matrix not initialized");
+    }
+
+    /* Both triangles are stored, so every row is summed by one thread */
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) if (nodes >= BLOCK_PCG_PARALLEL_MIN)
+#endif
+    for (int i = 0; i < nodes; i++) {
+        double y0 = 0.0, y1 = 0.0, y2 = 0.0;
+        for (fem_index_t b = offsets[i]; b < offsets[i + 1]; b++) {
+            const double *block = values[b];
+            const double *xj = x + (size_t)columns[b] * 3;
+            y0 += block[0] * xj[0] + block[1] * xj[1] + block[2] * xj[2];
+            y1 += block[3] * xj[0] + block[4] * xj[1] + block[5] * xj[2];
+            y2 += block[6] * xj[0] + block[7] * xj[1] + block[8] * xj[2];
+        }
+        y[3 * i] = y0;
+        y[3 * i + 1] = y1;
+        y[3 * i + 2] = y2;
+    }
+    return FEM_SUCCESS;
+}
+
+/* Inverse of every diagonal block; fails on a singular block */
+static fem_error_t block_pcg_invert_diagonal(double (*inverse)[9])
+{
+    const double (*values)[9] = (const double (*)[9])g_block_values;
+    const fem_index_t *diagonal = g_block_diagonal;
+    int singular = -1;
+    int nodes = g_num_nodes;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) if (nodes >= BLOCK_PCG_PARALLEL_MIN)
+#endif
+    for (int i = 0; i < nodes; i++) {
+        const double *a = values[diagonal[i]];
+        double *inv = inverse[i];
+        inv[0] = a[4] * a[8] - a[5] * a[7];
+        inv[1] = a[2] * a[7] - a[1] * a[8];
+        inv[2] = a[1] * a[5] - a[2] * a[4];
+        inv[3] = a[5] * a[6] - a[3] * a[8];
+        inv[4] = a[0] * a[8] - a[2] * a[6];
+        inv[5] = a[2] * a[3] - a[0] * a[5];
+        inv[6] = a[3] * a[7] - a[4] * a[6];
+        inv[7] = a[1] * a[6] - a[0] * a[7];
+        inv[8] = a[0] * a[4] - a[1] * a[3];
+        double det = a[0] * inv[0] + a[1] * inv[3] + a[2] * inv[6];
+        if (fabs(det) < TOLERANCE) {
+#ifdef _OPENMP
+            #pragma omp critical(block_pcg_singular)
+#endif
+            singular = i;
+            continue;
+        }
+        for (int k = 0; k < 9; k++) {
+            inv[k] /= det;
+        }
+    }
+
+    if (singular >= 0) {
+        return error_set(FEM_ERROR_SINGULAR_MATRIX,
+                         "Singular diagonal block at node %d", singular + 1);
+    }
+    return FEM_SUCCESS;
+}
+
+static void block_pcg_precondition(const double (*inverse)[9], const double *r, double *z, int nodes)
+{
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) if (nodes >= BLOCK_PCG_PARALLEL_MIN)
+#endif
+    for (int i = 0; i < nodes; i++) {
+        const double *inv = inverse[i];
+        const double *ri = r + (size_t)i * 3;
+        double *zi = z + (size_t)i * 3;
+        zi[0] = inv[0] * ri[0] + inv[1] * ri[1] + inv[2] * ri[2];
+        zi[1] = inv[3] * ri[0] + inv[4] * ri[1] + inv[5] * ri[2];
+        zi[2] = inv[6] * ri[0] + inv[7] * ri[1] + inv[8] * ri[2];
+    }
+}
+
+static double block_pcg_dot(const double *a, const double *b, int n)
+{
+    double sum = 0.0;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) reduction(+:sum) if (n >= 3 * BLOCK_PCG_PARALLEL_MIN)
+#endif
+    for (int i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+fem_error_t block_pcg_solve(const double *b, double *x, double tolerance, int max_iterations,
+                            int *actual_iterations, double *final_residual)
+{
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    int nodes = g_num_nodes;
+    int n = nodes * 3;
+    double (*inverse)[9];
+    double *r, *z, *p, *q;
+    double b_norm, rz, residual;
+    fem_error_t err;
+
+    inverse = fem_arena_alloc(&g_scratch_arena, (size_t)nodes * sizeof(*inverse));
+    r = fem_arena_alloc(&g_scratch_arena, (size_t)n * sizeof(double));
+    z = fem_arena_alloc(&g_scratch_arena, (size_t)n * sizeof(double));
+    p = fem_arena_alloc(&g_scratch_arena, (size_t)n * sizeof(double));
+    q = fem_arena_alloc(&g_scratch_arena, (size_t)n * sizeof(double));
+    if (!inverse || !r || !z || !p || !q) {
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "PCG work vector allocation failed");
+    }
+
+    FEM_LOG_INFO("Starting block Jacobi preconditioned conjugate gradient solver...\n");
+    FEM_LOG_INFO("  Problem size: %d\n", n);
+    FEM_LOG_INFO("  Tolerance: %e (relative)\n", tolerance);
+    FEM_LOG_INFO("  Max iterations: %d\n", max_iterations);
+
+    err = block_pcg_invert_diagonal(inverse);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+
+    err = block_pcg_multiply(x, q);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+    for (int i = 0; i < n; i++) {
+        r[i] = b[i] - q[i];
+    }
+
+    b_norm = sqrt(block_pcg_dot(b, b, n));
+    if (b_norm == 0.0) {
+        b_norm = 1.0;
+    }
+    residual = sqrt(block_pcg_dot(r, r, n)) / b_norm;
+    *actual_iterations = 0;
+    *final_residual = residual;
+    if (residual < tolerance) {
+        FEM_LOG_INFO("  Initial guess already converged\n");
+        goto cleanup;
+    }
+
+    block_pcg_precondition((const double (*)[9])inverse, r, z, nodes);
+    memcpy(p, z, (size_t)n * sizeof(double));
+    rz = block_pcg_dot(r, z, n);
+
+    for (int iter = 0; iter < max_iterations; iter++) {
+        err = block_pcg_multiply(p, q);
+        CHECK_ERROR_CLEANUP(err, goto cleanup);
+
+        double pq = block_pcg_dot(p, q, n);
+        if (!(pq > 0.0)) {
+            err = error_set(FEM_ERROR_SINGULAR_MATRIX,
+                            "Non-positive curvature in PCG iteration %d", iter);
+            goto cleanup;
+        }
+        double alpha = rz / pq;
+
+#ifdef _OPENMP
+        #pragma omp parallel for schedule(static) if (n >= 3 * BLOCK_PCG_PARALLEL_MIN)
+#endif
+        for (int i = 0; i < n; i++) {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * q[i];
+        }
+
+        residual = sqrt(block_pcg_dot(r, r, n)) / b_norm;
+        if (FEM_LOG_ENABLED(FEM_LOG_LEVEL_DEBUG) && (iter % 10 == 0 || iter < 5)) {
+            printf("    PCG iteration %d: relative residual %e\n", iter + 1, residual);
+        }
+        if (residual < tolerance) {
+            *actual_iterations = iter + 1;
+            *final_residual = residual;
+            FEM_LOG_INFO("  Converged in %d iterations\n", iter + 1);
+            FEM_LOG_INFO("  Final residual: %e\n", residual);
+            goto cleanup;
+        }
+
+        block_pcg_precondition((const double (*)[9])inverse, r, z, nodes);
+        double rz_new = block_pcg_dot(r, z, n);
+        double beta = rz_new / rz;
+        rz = rz_new;
+
+#ifdef _OPENMP
+        #pragma omp parallel for schedule(static) if (n >= 3 * BLOCK_PCG_PARALLEL_MIN)
+#endif
+        for (int i = 0; i < n; i++) {
+            p[i] = z[i] + beta * p[i];
+        }
+    }
+
+    *actual_iterations = max_iterations;
+    *final_residual = residual;
+    err = error_set(FEM_ERROR_MAX_ITERATIONS,
+                    "PCG solver failed to converge in %d iterations (residual = %e)",
+                    max_iterations, residual);
+
+cleanup:
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    return err;
+}
+
+static fem_error_t block_pcg_recycle_multiply(const double *x, double *y, void *data)
+{
+    (void)data;
+    return block_pcg_multiply(x, y);
+}
+
+static void block_pcg_recycle_precondition(const double *r, double *z, void *data)
+{
+    block_pcg_precondition((const double (*)[9])data, r, z, g_num_nodes);
+}
+
+/* y = M x over the diagonal blocks */
+static void block_pcg_recycle_weight(const double *x, double *y, void *data)
+{
+    const double (*values)[9] = (const double (*)[9])g_block_values;
+    const fem_index_t *diagonal = g_block_diagonal;
+    int nodes = g_num_nodes;
+
+    (void)data;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) if (nodes >= BLOCK_PCG_PARALLEL_MIN)
+#endif
+    for (int i = 0; i < nodes; i++) {
+        const double *a = values[diagonal[i]];
+        const double *xi = x + (size_t)i * 3;
+        double *yi = y + (size_t)i * 3;
+        yi[0] = a[0] * xi[0] + a[1] * xi[1] + a[2] * xi[2];
+        yi[1] = a[3] * xi[0] + a[4] * xi[1] + a[5] * xi[2];
+        yi[2] = a[6] * xi[0] + a[7] * xi[1] + a[8] * xi[2];
+    }
+}
+
+/* block_pcg_solve deflated by the recycle space of the bound context */
+static fem_error_t block_pcg_solve_recycled(const double *b, double *x, double tolerance,
+                                            int max_iterations, int *actual_iterations,
+                                            double *final_residual)
+{
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    double (*inverse)[9];
+    krylov_operator_t op;
+    fem_error_t err;
+
+    inverse = fem_arena_alloc(&g_scratch_arena, (size_t)g_num_nodes * sizeof(*inverse));
+    if (!inverse) {
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "PCG work vector allocation failed");
+    }
+
+    err = block_pcg_invert_diagonal(inverse);
+    if (err == FEM_SUCCESS) {
+        op.multiply = block_pcg_recycle_multiply;
+        op.precondition = block_pcg_recycle_precondition;
+        op.weight = block_pcg_recycle_weight;
+        op.data = inverse;
+        err = krylov_recycle_solve(&op, g_num_nodes * 3, b, x, tolerance, 1, max_iterations,
+                                   actual_iterations, final_residual);
+    }
+
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    return err;
+}
+
+fem_error_t block_pcg_solve_system(void)
+{
+    int iterations = 0;
+    double final_residual = 0.0;
+    fem_error_t err;
+
+    if (g_total_dof <= 0) {
+        g_solver_info.iterations = 0;
+        g_solver_info.residual = 0.0;
+        g_solver_info.status = FEM_SUCCESS;
+        return FEM_SUCCESS;
+    }
+    if (!g_global_force || !g_global_displ || !g_block_values) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Global system arrays not initialized");
+    }
+
+    if (krylov_recycle_active()) {
+        err = block_pcg_solve_recycled(g_global_force, g_global_displ, g_analysis.tolerance,
+                                       g_analysis.max_iterations, &iterations, &final_residual);
+    } else {
+        err = block_pcg_solve(g_global_force, g_global_displ, g_analysis.tolerance,
+                              g_analysis.max_iterations, &iterations, &final_residual);
+    }
+
+    g_solver_info.iterations = iterations;
+    g_solver_info.residual = final_residual;
+    g_solver_info.status = err;
+
+    if (err == FEM_SUCCESS) {
+        for (int node = 0; node < g_num_nodes; node++) {
+            g_node_displ[node][0] = g_global_displ[node * 3];
+            g_node_displ[node][1] = g_global_displ[node * 3 + 1];
+            g_node_displ[node][2] = g_global_displ[node * 3 + 2];
+        }
+        FEM_LOG_INFO("Solution completed successfully\n");
+        FEM_LOG_INFO("  Nodal displacements updated\n");
+    }
+    return err;
+}
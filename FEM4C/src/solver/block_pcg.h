@@ -0,0 +1,27 @@
+#ifndef BLOCK_PCG_H
+#define BLOCK_PCG_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Preconditioned conjugate gradients on the block sparse matrix
+ *
+ * The solid system (block_assembly.h) is solved by CG preconditioned with
+ * the inverted 3x3 diagonal blocks (block Jacobi), which keeps the coupling
+ * of the three displacement components of a node. Products and vector
+ * updates run over node rows in parallel. Convergence is measured on the
+ * relative residual |r| / |b|.
+ */
+
+#include "../common/types.h"
+
+/* y = K x over the block matrix */
+fem_error_t block_pcg_multiply(const double *x, double *y);
+
+/* Solve K x = b; x holds the initial guess */
+fem_error_t block_pcg_solve(const double *b, double *x, double tolerance, int max_iterations,
+                            int *actual_iterations, double *final_residual);
+
+/* Solve the assembled solid system into g_global_displ and g_node_displ,
+ * deflated when the bound context holds a recycle space (krylov_recycle.h) */
+fem_error_t block_pcg_solve_system(void);
+
+#endif /* BLOCK_PCG_H */
@@ -3,9 +3,11 @@
  */
 
 #include "cg_solver.h"
+#include "krylov_recycle.h"
 #include "../common/constants.h"
 #include "../common/globals.h"
 #include "../common/error.h"
+#include "../common/fem_log.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,22 +26,24 @@ fem_error_t cg_solve(double *A, double *b, double *x, int n,
     double residual_norm;
     int iter;
     fem_error_t err = FEM_SUCCESS;
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
 
     (void)A;
     
-    /* Allocate working vectors */
-    r = malloc(n * sizeof(double));
-    p = malloc(n * sizeof(double));
-    Ap = malloc(n * sizeof(double));
+    /* Allocate working vectors from the phase scratch arena */
+    r = fem_arena_alloc(&g_scratch_arena, (size_t)n * sizeof(double));
+    p = fem_arena_alloc(&g_scratch_arena, (size_t)n * sizeof(double));
+    Ap = fem_arena_alloc(&g_scratch_arena, (size_t)n * sizeof(double));
     
-    CHECK_NULL(r, "CG residual vector allocation failed");
-    CHECK_NULL(p, "CG search direction vector allocation failed");
-    CHECK_NULL(Ap, "CG matrix-vector product allocation failed");
+    if (!r || !p || !Ap) {
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "CG work vector allocation failed");
+    }
     
-    printf("Starting conjugate gradient solver...\n");
-    printf("  Problem size: %d\n", n);
-    printf("  Tolerance: %e\n", tolerance);
-    printf("  Max iterations: %d\n", max_iterations);
+    FEM_LOG_INFO("Starting conjugate gradient solver...\n");
+    FEM_LOG_INFO("  Problem size: %d\n", n);
+    FEM_LOG_INFO("  Tolerance: %e\n", tolerance);
+    FEM_LOG_INFO("  Max iterations: %d\n", max_iterations);
     
     /* Initialize: r = b - A*x */
     err = cg_matrix_vector_multiply(A, x, Ap, n);
@@ -58,7 +62,7 @@ fem_error_t cg_solve(double *A, double *b, double *x, int n,
     if (residual_norm < tolerance) {
         *actual_iterations = 0;
         *final_residual = residual_norm;
-        printf("  Initial guess already converged\n");
+        FEM_LOG_INFO("  Initial guess already converged\n");
         goto cleanup;
     }
     
@@ -74,16 +78,18 @@ fem_error_t cg_solve(double *A, double *b, double *x, int n,
         CHECK_ERROR_CLEANUP(err, goto cleanup);
         
         if (fabs(pAp) < TOLERANCE) {
-            printf("  CG Debug: iteration %d, pAp = %.6e, tolerance = %.6e\n", iter, pAp, TOLERANCE);
-            printf("  Search direction p[0:5]: ");
-            for (int i = 0; i < (n < 6 ? n : 6); i++) {
-                printf("%.3e ", p[i]);
-            }
-            printf("\n  A*p[0:5]: ");
-            for (int i = 0; i < (n < 6 ? n : 6); i++) {
-                printf("%.3e ", Ap[i]);
+            if (FEM_LOG_ENABLED(FEM_LOG_LEVEL_DEBUG)) {
+                printf("  CG Debug: iteration %d, pAp = %.6e, tolerance = %.6e\n", iter, pAp, TOLERANCE);
+                printf("  Search direction p[0:5]: ");
+                for (int i = 0; i < (n < 6 ? n : 6); i++) {
+                    printf("%.3e ", p[i]);
+                }
+                printf("\n  A*p[0:5]: ");
+                for (int i = 0; i < (n < 6 ? n : 6); i++) {
+                    printf("%.3e ", Ap[i]);
+                }
+                printf("\n");
             }
-            printf("\n");
             err = error_set(FEM_ERROR_SINGULAR_MATRIX, "Zero curvature in CG iteration %d", iter);
             goto cleanup;
         }
@@ -105,7 +111,7 @@ fem_error_t cg_solve(double *A, double *b, double *x, int n,
         residual_norm = sqrt(rsnew);
         
         /* Print iteration info */
-        if (iter % 10 == 0 || iter < 5) {
+        if (FEM_LOG_ENABLED(FEM_LOG_LEVEL_DEBUG) && (iter % 10 == 0 || iter < 5)) {
             cg_print_iteration_info(iter + 1, residual_norm, tolerance);
         }
         
@@ -113,8 +119,8 @@ fem_error_t cg_solve(double *A, double *b, double *x, int n,
         if (residual_norm < tolerance) {
             *actual_iterations = iter + 1;
             *final_residual = residual_norm;
-            printf("  Converged in %d iterations\n", iter + 1);
-            printf("  Final residual: %e\n", residual_norm);
+            FEM_LOG_INFO("  Converged in %d iterations\n", iter + 1);
+            FEM_LOG_INFO("  Final residual: %e\n", residual_norm);
             goto cleanup;
         }
         
@@ -137,9 +143,87 @@ fem_error_t cg_solve(double *A, double *b, double *x, int n,
                    max_iterations, residual_norm);
 
 cleanup:
-    if (r) free(r);
-    if (p) free(p);
-    if (Ap) free(Ap);
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    
+    return err;
+}
+
+/* Operator of pcg_solve: the skyline matrix and its inverted diagonal */
+typedef struct {
+    int n;
+    double *inverse;
+} pcg_operator_data_t;
+
+static fem_error_t pcg_multiply(const double *x, double *y, void *data)
+{
+    pcg_operator_data_t *operator_data = (pcg_operator_data_t *)data;
+    return cg_matrix_vector_multiply(NULL, (double *)x, y, operator_data->n);
+}
+
+static void pcg_precondition(const double *r, double *z, void *data)
+{
+    pcg_operator_data_t *operator_data = (pcg_operator_data_t *)data;
+    cg_apply_preconditioner(operator_data->inverse, (double *)r, z, operator_data->n);
+}
+
+static void pcg_weight(const double *x, double *y, void *data)
+{
+    pcg_operator_data_t *operator_data = (pcg_operator_data_t *)data;
+    for (int i = 0; i < operator_data->n; i++) {
+        y[i] = x[i] / operator_data->inverse[i];
+    }
+}
+
+/* Preconditioned conjugate gradient solver implementation */
+fem_error_t pcg_solve(double *A, double *b, double *x, int n,
+                     double tolerance, int max_iterations,
+                     int *actual_iterations, double *final_residual)
+{
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    pcg_operator_data_t operator_data;
+    krylov_operator_t op;
+    fem_error_t err;
+
+    operator_data.n = n;
+    operator_data.inverse = fem_arena_alloc(&g_scratch_arena, (size_t)n * sizeof(double));
+    if (!operator_data.inverse) {
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "PCG work vector allocation failed");
+    }
+
+    err = cg_diagonal_preconditioner(A, operator_data.inverse, n);
+    if (err == FEM_SUCCESS) {
+        op.multiply = pcg_multiply;
+        op.precondition = pcg_precondition;
+        op.weight = pcg_weight;
+        op.data = &operator_data;
+        err = krylov_recycle_solve(&op, n, b, x, tolerance, 0, max_iterations,
+                                   actual_iterations, final_residual);
+    }
+
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    return err;
+}
+
+/* Solver info and nodal displacements after a plane system solve */
+static fem_error_t cg_finish_system(fem_error_t err, int iterations, double final_residual)
+{
+    /* Update solver info */
+    g_solver_info.iterations = iterations;
+    g_solver_info.residual = final_residual;
+    g_solver_info.status = err;
+    
+    /* Copy solution back to nodal displacements */
+    if (err == FEM_SUCCESS) {
+        for (int node = 0; node < g_num_nodes; node++) {
+            g_node_displ[node][0] = g_global_displ[node * 2];     /* u */
+            g_node_displ[node][1] = g_global_displ[node * 2 + 1]; /* v */
+            g_node_displ[node][2] = 0.0; /* w = 0 for 2D */
+        }
+        
+        FEM_LOG_INFO("Solution completed successfully\n");
+        FEM_LOG_INFO("  Nodal displacements updated\n");
+    }
     
     return err;
 }
@@ -171,24 +255,31 @@ fem_error_t cg_solve_system(void)
                   g_analysis.tolerance, g_analysis.max_iterations,
                   &iterations, &final_residual);
     
-    /* Update solver info */
-    g_solver_info.iterations = iterations;
-    g_solver_info.residual = final_residual;
-    g_solver_info.status = err;
+    return cg_finish_system(err, iterations, final_residual);
+}
+
+/* Solve the global FEM system using Jacobi PCG, deflated when recycling */
+fem_error_t pcg_solve_system(void)
+{
+    int iterations = 0;
+    double final_residual = 0.0;
+    fem_error_t err;
     
-    /* Copy solution back to nodal displacements */
-    if (err == FEM_SUCCESS) {
-        for (int node = 0; node < g_num_nodes; node++) {
-            g_node_displ[node][0] = g_global_displ[node * 2];     /* u */
-            g_node_displ[node][1] = g_global_displ[node * 2 + 1]; /* v */
-            g_node_displ[node][2] = 0.0; /* w = 0 for 2D */
-        }
-        
-        printf("Solution completed successfully\n");
-        printf("  Nodal displacements updated\n");
+    if (g_total_dof <= 0) {
+        g_solver_info.iterations = 0;
+        g_solver_info.residual = 0.0;
+        g_solver_info.status = FEM_SUCCESS;
+        return FEM_SUCCESS;
+    }
+    if (!g_global_force || !g_global_displ || !g_global_stiffness_values) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Global system arrays not initialized");
     }
     
-    return err;
+    err = pcg_solve(NULL, g_global_force, g_global_displ, g_total_dof,
+                    g_analysis.tolerance, g_analysis.max_iterations,
+                    &iterations, &final_residual);
+    
+    return cg_finish_system(err, iterations, final_residual);
 }
 
 /* Matrix-vector multiplication: result = A * x */
@@ -206,7 +297,7 @@ fem_error_t cg_matrix_vector_multiply(double *A, double *x, double *result, int
 
     for (int col = 0; col < n; col++) {
         int first_row = g_stiffness_profile[col];
-        int offset = g_stiffness_offsets[col];
+        fem_index_t offset = g_stiffness_offsets[col];
         int last_row = col;
 
         if (first_row < 0) {
@@ -217,16 +308,17 @@ fem_error_t cg_matrix_vector_multiply(double *A, double *x, double *result, int
         }
         if (offset < 0 || offset >= g_stiffness_value_count) {
             return error_set(FEM_ERROR_INVALID_INPUT,
-                             "Skyline offset out of range for column %d (offset=%d, count=%d)",
-                             col, offset, g_stiffness_value_count);
+                             "Skyline offset out of range for column %d (offset=%lld, count=%lld)",
+                             col, (long long)offset, (long long)g_stiffness_value_count);
         }
 
         for (int row = first_row; row <= last_row; row++) {
-            int value_index = offset + (row - first_row);
+            fem_index_t value_index = offset + (row - first_row);
             if (value_index < 0 || value_index >= g_stiffness_value_count) {
                 return error_set(FEM_ERROR_INVALID_INPUT,
-                                 "Skyline index out of range (col=%d row=%d index=%d count=%d)",
-                                 col, row, value_index, g_stiffness_value_count);
+                                 "Skyline index out of range (col=%d row=%d index=%lld count=%lld)",
+                                 col, row, (long long)value_index,
+                                 (long long)g_stiffness_value_count);
             }
             double value = g_global_stiffness_values[value_index];
             result[row] += value * x[col];
@@ -293,6 +385,43 @@ fem_error_t cg_vector_axpy(double a, double *x, double *y, int n)
     return FEM_SUCCESS;
 }
 
+/* Inverted diagonal of the skyline matrix */
+fem_error_t cg_diagonal_preconditioner(double *A, double *M_inv, int n)
+{
+    (void)A;
+
+    if (!g_global_stiffness_values || !g_stiffness_profile || !g_stiffness_offsets) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Global stiffness matrix not initialized");
+    }
+
+    for (int col = 0; col < n; col++) {
+        int first_row = g_stiffness_profile[col] < 0 ? 0 : g_stiffness_profile[col];
+        double diagonal = g_global_stiffness_values[g_stiffness_offsets[col] + (col - first_row)];
+        if (!(diagonal > ZERO)) {
+            return error_set(FEM_ERROR_SINGULAR_MATRIX,
+                             "Non-positive diagonal %e at DOF %d", diagonal, col);
+        }
+        M_inv[col] = 1.0 / diagonal;
+    }
+
+    return FEM_SUCCESS;
+}
+
+/* Apply the Jacobi preconditioner: z = M^-1 * r */
+fem_error_t cg_apply_preconditioner(double *M_inv, double *r, double *z, int n)
+{
+    int i;
+    
+#ifdef _OPENMP
+    #pragma omp parallel for private(i)
+#endif
+    for (i = 0; i < n; i++) {
+        z[i] = M_inv[i] * r[i];
+    }
+    
+    return FEM_SUCCESS;
+}
+
 /* Check convergence */
 fem_error_t cg_check_convergence(double *r, int n, double tolerance, double *residual_norm)
 {
@@ -310,6 +439,6 @@ fem_error_t cg_check_convergence(double *r, int n, double tolerance, double *res
 /* Print iteration information */
 void cg_print_iteration_info(int iter, double residual_norm, double tolerance)
 {
-    printf("  Iteration %4d: residual = %12.5e (target = %e)\n", 
+    FEM_LOG_DEBUG("  Iteration %4d: residual = %12.5e (target = %e)\n",
            iter, residual_norm, tolerance);
 }
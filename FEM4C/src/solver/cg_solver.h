@@ -12,7 +12,8 @@ fem_error_t cg_solve(double *A, double *b, double *x, int n,
                     double tolerance, int max_iterations, 
                     int *actual_iterations, double *final_residual);
 
-/* Preconditioned conjugate gradient solver */
+/* Jacobi preconditioned conjugate gradient solver; deflated by the
+ * recycle space of the bound context when it holds one (krylov_recycle.h) */
 fem_error_t pcg_solve(double *A, double *b, double *x, int n,
                      double tolerance, int max_iterations,
                      int *actual_iterations, double *final_residual);
@@ -20,6 +21,9 @@ fem_error_t pcg_solve(double *A, double *b, double *x, int n,
 /* Solver for FEM4C global system */
 fem_error_t cg_solve_system(void);
 
+/* The same with pcg_solve */
+fem_error_t pcg_solve_system(void);
+
 /* Utility functions */
 fem_error_t cg_matrix_vector_multiply(double *A, double *x, double *result, int n);
 fem_error_t cg_dot_product(double *a, double *b, int n, double *result);
@@ -0,0 +1,234 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Dense matrix kernels for the frontal matrices of the sparse Cholesky
+ */
+
+#include "dense_kernels.h"
+#include <math.h>
+#include <stddef.h>
+
+/* Inner indices per pass over a block of C, and rows of A kept in cache
+ * with them (128 x 256 doubles) */
+#define DENSE_KC 256
+#define DENSE_MC 128
+
+int dense_cholesky(double *a, int n, int lda, const double *reference, double tolerance)
+{
+    /* Left-looking: column j takes the updates of the columns before it,
+     * then is scaled by its pivot */
+    for (int j = 0; j < n; j++) {
+        double *column = a + (size_t)j * lda;
+        for (int q = 0; q < j; q++) {
+            const double *source = a + (size_t)q * lda;
+            double ljq = source[j];
+            for (int i = j; i < n; i++) {
+                column[i] -= source[i] * ljq;
+            }
+        }
+
+        double pivot = column[j];
+        double floor = reference ? tolerance * reference[j] : 0.0;
+        if (!(pivot > floor)) {
+            return j;
+        }
+        double diagonal = sqrt(pivot);
+        double inverse = 1.0 / diagonal;
+        column[j] = diagonal;
+        for (int i = j + 1; i < n; i++) {
+            column[i] *= inverse;
+        }
+    }
+    return -1;
+}
+
+void dense_trsm_right_lower_transpose(int m, int n, const double *l, int ldl, double *b,
+                                      int ldb)
+{
+    /* Column j of X = B L^-T is (B(:, j) - sum_q X(:, q) L(j, q)) / L(j, j);
+     * rows are taken in blocks that stay in cache across the columns */
+    for (int i0 = 0; i0 < m; i0 += DENSE_MC) {
+        int rows = m - i0 < DENSE_MC ? m - i0 : DENSE_MC;
+        for (int j = 0; j < n; j++) {
+            double *target = b + i0 + (size_t)j * ldb;
+            for (int q = 0; q < j; q++) {
+                const double *source = b + i0 + (size_t)q * ldb;
+                double ljq = l[j + (size_t)q * ldl];
+                for (int i = 0; i < rows; i++) {
+                    target[i] -= source[i] * ljq;
+                }
+            }
+            double inverse = 1.0 / l[j + (size_t)j * ldl];
+            for (int i = 0; i < rows; i++) {
+                target[i] *= inverse;
+            }
+        }
+    }
+}
+
+/* One entry, C(i, j) -= A(i, :) B(j, :) over kc inner indices, grouped in
+ * fours exactly as in dense_kernel_4x4 */
+static double dense_entry(double c, const double *a, int lda, const double *b, int ldb, int kc)
+{
+    int p = 0;
+    for (; p + 4 <= kc; p += 4) {
+        c -= a[(size_t)p * lda] * b[(size_t)p * ldb]
+           + a[(size_t)(p + 1) * lda] * b[(size_t)(p + 1) * ldb]
+           + a[(size_t)(p + 2) * lda] * b[(size_t)(p + 2) * ldb]
+           + a[(size_t)(p + 3) * lda] * b[(size_t)(p + 3) * ldb];
+    }
+    for (; p < kc; p++) {
+        c -= a[(size_t)p * lda] * b[(size_t)p * ldb];
+    }
+    return c;
+}
+
+/* rows x 4 block of C -= A B^T over kc inner indices. The 4 x 4 block of
+ * B is held in registers while four columns of A stream past. */
+static void dense_kernel_4x4(int rows, int kc, const double *a, int lda, const double *b,
+                             int ldb, double *c, int ldc)
+{
+    double *c0 = c;
+    double *c1 = c + ldc;
+    double *c2 = c + 2 * (size_t)ldc;
+    double *c3 = c + 3 * (size_t)ldc;
+    int p = 0;
+
+    for (; p + 4 <= kc; p += 4) {
+        const double *a0 = a + (size_t)p * lda;
+        const double *a1 = a0 + lda;
+        const double *a2 = a1 + lda;
+        const double *a3 = a2 + lda;
+        const double *b0 = b + (size_t)p * ldb;
+        const double *b1 = b0 + ldb;
+        const double *b2 = b1 + ldb;
+        const double *b3 = b2 + ldb;
+        double b00 = b0[0], b01 = b1[0], b02 = b2[0], b03 = b3[0];
+        double b10 = b0[1], b11 = b1[1], b12 = b2[1], b13 = b3[1];
+        double b20 = b0[2], b21 = b1[2], b22 = b2[2], b23 = b3[2];
+        double b30 = b0[3], b31 = b1[3], b32 = b2[3], b33 = b3[3];
+        for (int i = 0; i < rows; i++) {
+            double x0 = a0[i], x1 = a1[i], x2 = a2[i], x3 = a3[i];
+            c0[i] -= x0 * b00 + x1 * b01 + x2 * b02 + x3 * b03;
+            c1[i] -= x0 * b10 + x1 * b11 + x2 * b12 + x3 * b13;
+            c2[i] -= x0 * b20 + x1 * b21 + x2 * b22 + x3 * b23;
+            c3[i] -= x0 * b30 + x1 * b31 + x2 * b32 + x3 * b33;
+        }
+    }
+    for (; p < kc; p++) {
+        const double *ap = a + (size_t)p * lda;
+        const double *bp = b + (size_t)p * ldb;
+        double y0 = bp[0], y1 = bp[1], y2 = bp[2], y3 = bp[3];
+        for (int i = 0; i < rows; i++) {
+            double x = ap[i];
+            c0[i] -= x * y0;
+            c1[i] -= x * y1;
+            c2[i] -= x * y2;
+            c3[i] -= x * y3;
+        }
+    }
+}
+
+/* The same for a single column of C */
+static void dense_kernel_4x1(int rows, int kc, const double *a, int lda, const double *b,
+                             int ldb, double *c)
+{
+    int p = 0;
+
+    for (; p + 4 <= kc; p += 4) {
+        const double *a0 = a + (size_t)p * lda;
+        const double *a1 = a0 + lda;
+        const double *a2 = a1 + lda;
+        const double *a3 = a2 + lda;
+        double y0 = b[(size_t)p * ldb];
+        double y1 = b[(size_t)(p + 1) * ldb];
+        double y2 = b[(size_t)(p + 2) * ldb];
+        double y3 = b[(size_t)(p + 3) * ldb];
+        for (int i = 0; i < rows; i++) {
+            c[i] -= a0[i] * y0 + a1[i] * y1 + a2[i] * y2 + a3[i] * y3;
+        }
+    }
+    for (; p < kc; p++) {
+        const double *ap = a + (size_t)p * lda;
+        double y = b[(size_t)p * ldb];
+        for (int i = 0; i < rows; i++) {
+            c[i] -= ap[i] * y;
+        }
+    }
+}
+
+void dense_gemm_nt_subtract(int m, int n, int k, const double *a, int lda, const double *b,
+                            int ldb, double *c, int ldc)
+{
+    for (int p0 = 0; p0 < k; p0 += DENSE_KC) {
+        int kc = k - p0 < DENSE_KC ? k - p0 : DENSE_KC;
+        const double *ap = a + (size_t)p0 * lda;
+        const double *bp = b + (size_t)p0 * ldb;
+        for (int i0 = 0; i0 < m; i0 += DENSE_MC) {
+            int rows = m - i0 < DENSE_MC ? m - i0 : DENSE_MC;
+            int j = 0;
+            for (; j + 4 <= n; j += 4) {
+                dense_kernel_4x4(rows, kc, ap + i0, lda, bp + j, ldb, c + i0 + (size_t)j * ldc,
+                                 ldc);
+            }
+            for (; j < n; j++) {
+                dense_kernel_4x1(rows, kc, ap + i0, lda, bp + j, ldb, c + i0 + (size_t)j * ldc);
+            }
+        }
+    }
+}
+
+void dense_syrk_lower_subtract(int n, int k, const double *a, int lda, double *c, int ldc)
+{
+    for (int p0 = 0; p0 < k; p0 += DENSE_KC) {
+        int kc = k - p0 < DENSE_KC ? k - p0 : DENSE_KC;
+        const double *ap = a + (size_t)p0 * lda;
+        int j = 0;
+
+        /* Groups of four columns: the triangle on the diagonal entry by
+         * entry, the rows below it with the register kernel */
+        for (; j + 4 <= n; j += 4) {
+            for (int q = 0; q < 4; q++) {
+                double *column = c + (size_t)(j + q) * ldc;
+                for (int i = j + q; i < j + 4; i++) {
+                    column[i] = dense_entry(column[i], ap + i, lda, ap + j + q, lda, kc);
+                }
+            }
+            for (int i0 = j + 4; i0 < n; i0 += DENSE_MC) {
+                int rows = n - i0 < DENSE_MC ? n - i0 : DENSE_MC;
+                dense_kernel_4x4(rows, kc, ap + i0, lda, ap + j, lda, c + i0 + (size_t)j * ldc,
+                                 ldc);
+            }
+        }
+        for (; j < n; j++) {
+            double *column = c + (size_t)j * ldc;
+            column[j] = dense_entry(column[j], ap + j, lda, ap + j, lda, kc);
+            for (int i0 = j + 1; i0 < n; i0 += DENSE_MC) {
+                int rows = n - i0 < DENSE_MC ? n - i0 : DENSE_MC;
+                dense_kernel_4x1(rows, kc, ap + i0, lda, ap + j, lda, column + i0);
+            }
+        }
+    }
+}
+
+void dense_trsv_lower(int n, const double *l, int ldl, double *x)
+{
+    for (int j = 0; j < n; j++) {
+        const double *column = l + (size_t)j * ldl;
+        double xj = x[j] / column[j];
+        x[j] = xj;
+        for (int i = j + 1; i < n; i++) {
+            x[i] -= column[i] * xj;
+        }
+    }
+}
+
+void dense_trsv_lower_transpose(int n, const double *l, int ldl, double *x)
+{
+    for (int j = n - 1; j >= 0; j--) {
+        const double *column = l + (size_t)j * ldl;
+        double sum = x[j];
+        for (int i = j + 1; i < n; i++) {
+            sum -= column[i] * x[i];
+        }
+        x[j] = sum / column[j];
+    }
+}
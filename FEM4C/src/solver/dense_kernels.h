@@ -0,0 +1,35 @@
+#ifndef DENSE_KERNELS_H
+#define DENSE_KERNELS_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Dense matrix kernels for the frontal matrices of the sparse Cholesky
+ *
+ * Column-major blocks with a leading dimension, lower triangles only.
+ * The products are blocked for the cache and unrolled over four columns
+ * and four inner indices, so a block of C stays in registers while A is
+ * streamed. Every entry of C is accumulated in the same order however the
+ * caller splits the work, which keeps factorizations reproducible across
+ * thread counts.
+ */
+
+/* In-place Cholesky factor of the n x n lower triangle of a. A pivot that
+ * is not above tolerance * reference[j] (reference may be NULL for 0)
+ * stops the factorization; returns its index, or -1 on success. */
+int dense_cholesky(double *a, int n, int lda, const double *reference, double tolerance);
+
+/* B := B L^-T for the m x n block B and the n x n lower triangle L */
+void dense_trsm_right_lower_transpose(int m, int n, const double *l, int ldl, double *b,
+                                      int ldb);
+
+/* C -= A B^T for the m x n block C, A m x k and B n x k */
+void dense_gemm_nt_subtract(int m, int n, int k, const double *a, int lda, const double *b,
+                            int ldb, double *c, int ldc);
+
+/* Lower triangle of C -= A A^T for the n x n block C and A n x k */
+void dense_syrk_lower_subtract(int n, int k, const double *a, int lda, double *c, int ldc);
+
+/* x := L^-1 x and x := L^-T x for the n x n lower triangle L */
+void dense_trsv_lower(int n, const double *l, int ldl, double *x);
+void dense_trsv_lower_transpose(int n, const double *l, int ldl, double *x);
+
+#endif /* DENSE_KERNELS_H */
@@ -0,0 +1,361 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Subspace iteration for the lowest eigenpairs
+ */
+
+#include "eigen_solver.h"
+#include "skyline_solver.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_memory.h"
+#include <math.h>
+#include <string.h>
+
+/* Below this many DOF the subspace vectors are processed on one thread */
+#define EIGEN_PARALLEL_MIN_DOF 2000
+#define EIGEN_JACOBI_SWEEPS 60
+/* Subspace vectors solved together: one pass over the factor per panel */
+#define EIGEN_PANEL 8
+
+eigen_options_t eigen_default_options(int modes)
+{
+    eigen_options_t options;
+
+    options.modes = modes;
+    options.max_iterations = 60;
+    options.tolerance = 1.0e-8;
+    return options;
+}
+
+void eigen_jacobi(int q, double *a, double *v)
+{
+    for (int i = 0; i < q; i++) {
+        for (int j = 0; j < q; j++) {
+            v[i * q + j] = i == j ? 1.0 : 0.0;
+        }
+    }
+
+    for (int sweep = 0; sweep < EIGEN_JACOBI_SWEEPS; sweep++) {
+        double off = 0.0, diag = 0.0;
+        for (int i = 0; i < q; i++) {
+            diag += a[i * q + i] * a[i * q + i];
+            for (int j = i + 1; j < q; j++) {
+                off += a[i * q + j] * a[i * q + j];
+            }
+        }
+        if (off <= 1.0e-30 * diag) {
+            break;
+        }
+
+        for (int p = 0; p < q - 1; p++) {
+            for (int r = p + 1; r < q; r++) {
+                double apr = a[p * q + r];
+                if (fabs(apr) <= 1.0e-300) {
+                    continue;
+                }
+                double theta = (a[r * q + r] - a[p * q + p]) / (2.0 * apr);
+                double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c = 1.0 / sqrt(t * t + 1.0);
+                double s = t * c;
+
+                /* a = J^T a J, v = v J */
+                for (int k = 0; k < q; k++) {
+                    double akp = a[k * q + p], akr = a[k * q + r];
+                    a[k * q + p] = c * akp - s * akr;
+                    a[k * q + r] = s * akp + c * akr;
+                }
+                for (int k = 0; k < q; k++) {
+                    double apk = a[p * q + k], ark = a[r * q + k];
+                    a[p * q + k] = c * apk - s * ark;
+                    a[r * q + k] = s * apk + c * ark;
+                }
+                for (int k = 0; k < q; k++) {
+                    double vkp = v[k * q + p], vkr = v[k * q + r];
+                    v[k * q + p] = c * vkp - s * vkr;
+                    v[k * q + r] = s * vkp + c * vkr;
+                }
+            }
+        }
+    }
+}
+
+/* Projected problem a x = lambda b x (q x q, row-major, both destroyed):
+ * b = L L^T, Jacobi on L^-1 a L^-T, x = L^-T v. values ascending, x
+ * column by column in vectors (row-major q x q), b-orthonormal. */
+static fem_error_t eigen_projected(int q, double *a, double *b, double *values, double *vectors,
+                                   double *work)
+{
+    /* Cholesky, lower triangle of b */
+    for (int j = 0; j < q; j++) {
+        double d = b[j * q + j];
+        for (int k = 0; k < j; k++) {
+            d -= b[j * q + k] * b[j * q + k];
+        }
+        if (!(d > 0.0)) {
+            return error_set(FEM_ERROR_SINGULAR_MATRIX,
+                             "Subspace vectors became linearly dependent");
+        }
+        d = sqrt(d);
+        b[j * q + j] = d;
+        for (int i = j + 1; i < q; i++) {
+            double s = b[i * q + j];
+            for (int k = 0; k < j; k++) {
+                s -= b[i * q + k] * b[j * q + k];
+            }
+            b[i * q + j] = s / d;
+        }
+    }
+
+    /* work = L^-1 a, then a = L^-1 work^T */
+    for (int col = 0; col < q; col++) {
+        for (int i = 0; i < q; i++) {
+            double s = a[i * q + col];
+            for (int k = 0; k < i; k++) {
+                s -= b[i * q + k] * work[k * q + col];
+            }
+            work[i * q + col] = s / b[i * q + i];
+        }
+    }
+    for (int col = 0; col < q; col++) {
+        for (int i = 0; i < q; i++) {
+            double s = work[col * q + i];
+            for (int k = 0; k < i; k++) {
+                s -= b[i * q + k] * a[k * q + col];
+            }
+            a[i * q + col] = s / b[i * q + i];
+        }
+    }
+    for (int i = 0; i < q; i++) {
+        for (int j = i + 1; j < q; j++) {
+            double s = 0.5 * (a[i * q + j] + a[j * q + i]);
+            a[i * q + j] = a[j * q + i] = s;
+        }
+    }
+
+    eigen_jacobi(q, a, work);
+
+    /* vectors = L^-T work */
+    for (int col = 0; col < q; col++) {
+        for (int i = q - 1; i >= 0; i--) {
+            double s = work[i * q + col];
+            for (int k = i + 1; k < q; k++) {
+                s -= b[k * q + i] * vectors[k * q + col];
+            }
+            vectors[i * q + col] = s / b[i * q + i];
+        }
+        values[col] = a[col * q + col];
+    }
+
+    /* Ascending order */
+    for (int i = 0; i < q - 1; i++) {
+        int m = i;
+        for (int j = i + 1; j < q; j++) {
+            if (values[j] < values[m]) m = j;
+        }
+        if (m != i) {
+            double t = values[i];
+            values[i] = values[m];
+            values[m] = t;
+            for (int k = 0; k < q; k++) {
+                t = vectors[k * q + i];
+                vectors[k * q + i] = vectors[k * q + m];
+                vectors[k * q + m] = t;
+            }
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+/* y = M x for the n x q blocks, panel by panel in parallel, with the
+ * constrained rows cleared. With solve set, x is first replaced by K^-1 x. */
+static void eigen_panel_pass(const double *factor, const double *mass,
+                             const unsigned char *constrained, double *x, double *y,
+                             int n, int q, int solve, int parallel)
+{
+    fem_context_t *model = g_fem_context;
+    int panels = (q + EIGEN_PANEL - 1) / EIGEN_PANEL;
+
+    memset(y, 0, (size_t)n * q * sizeof(double));
+#ifdef _OPENMP
+    #pragma omp parallel if (parallel)
+#else
+    (void)parallel;
+#endif
+    {
+        fem_context_bind(model);
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic)
+#endif
+        for (int panel = 0; panel < panels; panel++) {
+            int first = panel * EIGEN_PANEL;
+            int count = q - first < EIGEN_PANEL ? q - first : EIGEN_PANEL;
+            if (solve) {
+                skyline_ldlt_solve_block(factor, x + first, q, count);
+            }
+            skyline_multiply_add_block(mass, x + first, y + first, q, count);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        if (constrained[i]) {
+            memset(y + (size_t)i * q, 0, (size_t)q * sizeof(double));
+        }
+    }
+}
+
+/* c (q x q) = a^T b for n x q row-major a, b */
+static void eigen_project(const double *a, const double *b, int n, int q, double *c, int parallel)
+{
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) if (parallel)
+#else
+    (void)parallel;
+#endif
+    for (int r = 0; r < q; r++) {
+        double *cr = c + (size_t)r * q;
+        memset(cr, 0, (size_t)q * sizeof(double));
+        for (int i = 0; i < n; i++) {
+            double ar = a[(size_t)i * q + r];
+            const double *bi = b + (size_t)i * q;
+            if (ar == 0.0) continue;
+            for (int k = 0; k < q; k++) {
+                cr[k] += ar * bi[k];
+            }
+        }
+    }
+}
+
+/* out (n x cols, row-major) = x (n x q) times the first cols columns of r (q x q) */
+static void eigen_combine(const double *x, const double *r, int n, int q, int cols, double *out,
+                          int parallel)
+{
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) if (parallel)
+#else
+    (void)parallel;
+#endif
+    for (int i = 0; i < n; i++) {
+        const double *xi = x + (size_t)i * q;
+        double *oi = out + (size_t)i * cols;
+        memset(oi, 0, (size_t)cols * sizeof(double));
+        for (int k = 0; k < q; k++) {
+            const double *rk = r + (size_t)k * q;
+            double f = xi[k];
+            if (f == 0.0) continue;
+            for (int j = 0; j < cols; j++) {
+                oi[j] += f * rk[j];
+            }
+        }
+    }
+}
+
+fem_error_t eigen_subspace(const double *stiffness_factor, const double *mass,
+                           const unsigned char *constrained, const eigen_options_t *options,
+                           double *eigenvalues, double *vectors, int *iterations)
+{
+    int n = g_total_dof;
+    int p = options ? options->modes : 0;
+    int free_dof = 0, q, parallel = g_total_dof >= EIGEN_PARALLEL_MIN_DOF;
+    double *xb = NULL, *y = NULL, *z = NULL;
+    double *kr = NULL, *mr = NULL, *r = NULL, *work = NULL, *lambda = NULL, *previous = NULL;
+    unsigned int seed = 12345u;
+    int it;
+    fem_error_t err = FEM_SUCCESS;
+
+    for (int i = 0; i < n; i++) {
+        if (!constrained[i]) free_dof++;
+    }
+    if (p < 1 || p > free_dof) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Cannot extract %d modes from %d free DOFs",
+                         p, free_dof);
+    }
+    q = 2 * p > p + 8 ? 2 * p : p + 8;
+    if (q > free_dof) q = free_dof;
+
+    xb = fem_malloc((size_t)n * q * sizeof(double), FEM_MEMORY_MATRIX);
+    y = fem_malloc((size_t)n * q * sizeof(double), FEM_MEMORY_MATRIX);
+    z = fem_malloc((size_t)n * q * sizeof(double), FEM_MEMORY_MATRIX);
+    kr = fem_malloc((size_t)q * q * sizeof(double), FEM_MEMORY_MATRIX);
+    mr = fem_malloc((size_t)q * q * sizeof(double), FEM_MEMORY_MATRIX);
+    r = fem_malloc((size_t)q * q * sizeof(double), FEM_MEMORY_MATRIX);
+    work = fem_malloc((size_t)q * q * sizeof(double), FEM_MEMORY_MATRIX);
+    lambda = fem_malloc((size_t)q * sizeof(double), FEM_MEMORY_VECTOR);
+    previous = fem_malloc((size_t)q * sizeof(double), FEM_MEMORY_VECTOR);
+    if (!xb || !y || !z || !kr || !mr || !r || !work || !lambda || !previous) {
+        err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Subspace iteration allocation failed");
+        goto cleanup;
+    }
+
+    /* Start: the mass diagonal, then reproducible pseudo-random vectors */
+    for (int i = 0; i < n; i++) {
+        double *x = xb + (size_t)i * q;
+        x[0] = mass[g_stiffness_offsets[i] + (i - g_stiffness_profile[i])];
+        for (int j = 1; j < q; j++) {
+            seed = seed * 1103515245u + 12345u;
+            x[j] = (double)((seed >> 8) & 0xffff) / 65536.0 - 0.5;
+        }
+        if (constrained[i]) {
+            memset(x, 0, (size_t)q * sizeof(double));
+        }
+    }
+    eigen_panel_pass(NULL, mass, constrained, xb, y, n, q, 0, parallel);
+
+    for (int i = 0; i < q; i++) previous[i] = 0.0;
+    for (it = 1; it <= options->max_iterations; it++) {
+        int converged = 1;
+
+        /* xb = K^-1 M x, z = M xb */
+        memcpy(xb, y, (size_t)n * q * sizeof(double));
+        eigen_panel_pass(stiffness_factor, mass, constrained, xb, z, n, q, 1, parallel);
+
+        /* K xb = M x, so xb^T K xb = xb^T y */
+        eigen_project(xb, y, n, q, kr, parallel);
+        eigen_project(xb, z, n, q, mr, parallel);
+        err = eigen_projected(q, kr, mr, lambda, r, work);
+        if (err != FEM_SUCCESS) goto cleanup;
+
+        /* M x for the next iteration, without another mass product */
+        eigen_combine(z, r, n, q, q, y, parallel);
+
+        for (int i = 0; i < p; i++) {
+            if (!(fabs(lambda[i] - previous[i]) <= options->tolerance * fabs(lambda[i]))) {
+                converged = 0;
+            }
+            previous[i] = lambda[i];
+        }
+        if (converged) {
+            break;
+        }
+    }
+    if (it > options->max_iterations) {
+        err = error_set(FEM_ERROR_CONVERGENCE_FAILED,
+                        "Subspace iteration did not converge in %d iterations",
+                        options->max_iterations);
+        goto cleanup;
+    }
+
+    eigen_combine(xb, r, n, q, p, vectors, parallel);
+    memcpy(eigenvalues, lambda, (size_t)p * sizeof(double));
+    if (iterations) *iterations = it;
+
+cleanup:
+    fem_free(xb);
+    fem_free(y);
+    fem_free(z);
+    fem_free(kr);
+    fem_free(mr);
+    fem_free(r);
+    fem_free(work);
+    fem_free(lambda);
+    fem_free(previous);
+    return err;
+}
+
+fem_error_t eigen_sturm_count(const double *stiffness, const double *mass,
+                              const unsigned char *constrained, double shift,
+                              double *work, int *count)
+{
+    for (fem_index_t k = 0; k < g_stiffness_value_count; k++) {
+        work[k] = stiffness[k] - shift * mass[k];
+    }
+    skyline_constrain(work, constrained);
+    return skyline_ldlt_factorize(work, count);
+}
@@ -0,0 +1,45 @@
+#ifndef EIGEN_SOLVER_H
+#define EIGEN_SOLVER_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Lowest eigenpairs of K phi = lambda M phi by subspace iteration
+ *
+ * K and M are laid out like g_global_stiffness_values. K is passed as its
+ * LDL^T factor (skyline_solver.h) with the constrained DOFs replaced by
+ * identity rows, so each iteration costs one forward/back substitution and
+ * one mass product per subspace vector. The vectors are stored side by
+ * side (row i holds entry i of every vector) and processed in panels, so
+ * the factor is streamed once per panel and the panels run in parallel.
+ * The projected problem is solved by Cholesky reduction and
+ * cyclic Jacobi. Constrained DOFs are zero in every mode.
+ */
+
+#include "../common/types.h"
+
+typedef struct {
+    int modes;                  /* eigenpairs wanted */
+    int max_iterations;
+    double tolerance;           /* relative change of the wanted eigenvalues */
+} eigen_options_t;
+
+eigen_options_t eigen_default_options(int modes);
+
+/* eigenvalues[modes] ascending; vectors row-major, n x modes
+ * (vectors[i * modes + r] is DOF i of mode r), normalised to
+ * phi^T M phi = 1. iterations may be NULL. */
+fem_error_t eigen_subspace(const double *stiffness_factor, const double *mass,
+                           const unsigned char *constrained, const eigen_options_t *options,
+                           double *eigenvalues, double *vectors, int *iterations);
+
+/* Sturm sequence check: number of eigenvalues below shift, from the
+ * negative pivots of K - shift M. work holds g_stiffness_value_count
+ * values. */
+fem_error_t eigen_sturm_count(const double *stiffness, const double *mass,
+                              const unsigned char *constrained, double shift,
+                              double *work, int *count);
+
+/* Cyclic Jacobi on the symmetric q x q matrix a (row-major): eigenvalues
+ * on the diagonal of a, eigenvectors in the columns of v */
+void eigen_jacobi(int q, double *a, double *v);
+
+#endif /* EIGEN_SOLVER_H */
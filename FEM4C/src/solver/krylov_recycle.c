@@ -0,0 +1,778 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Deflated PCG with a recycled Krylov subspace
+ */
+
+#include "krylov_recycle.h"
+#include "dense_kernels.h"
+#include "eigen_solver.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_context.h"
+#include "../common/fem_log.h"
+#include "../common/fem_memory.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Below this length the vector loops run on the calling thread */
+#define KRYLOV_RECYCLE_PARALLEL_MIN 1536
+/* Rows per task of a combination of vectors */
+#define KRYLOV_RECYCLE_ROWS 2048
+/* Ritz vectors taken from each solve, and its Lanczos window in multiples
+ * of them */
+#define KRYLOV_RECYCLE_RITZ 8
+#define KRYLOV_RECYCLE_WINDOW 5
+/* Directions of the projected M below this fraction of its largest
+ * eigenvalue are dependent and dropped */
+#define KRYLOV_RECYCLE_DEPENDENT 1.0e-10
+
+struct krylov_recycle_space {
+    int n;                          /* vector length, 0 until the first solve */
+    int capacity;                   /* vectors kept */
+    int ritz;                       /* Ritz vectors taken from a solve */
+    int count;                      /* vectors held */
+    int stale;                      /* K assembled again since image was formed */
+    double *basis;                  /* W, n x (capacity + ritz), column-major */
+    double *image;                  /* K W */
+    double *factor;                 /* Cholesky factor of W^T K W, count x count */
+    int baseline_iterations;        /* first solve, i.e. the last one without vectors */
+    int deflated_solves;            /* since then */
+    long saved_iterations;          /* relative to the first solve, negative if lost */
+};
+
+/* Lanczos vectors of one solve (eigCG of Stathopoulos and Orginos). PCG
+ * yields them as normalised preconditioned residuals, and the projection
+ * of K on them as a tridiagonal matrix from alpha and beta. A full window
+ * is restarted with the lowest Ritz vectors of its last two steps. */
+typedef struct {
+    int n;
+    int window;                     /* vectors held at most */
+    int wanted;                     /* Ritz vectors kept per restart */
+    int size;                       /* vectors held */
+    double *vectors;                /* n x window, column-major */
+    double *projection;             /* V^T K V, window x window, row-major */
+    double *matrix;                 /* window x window scratch */
+    double *eigenvectors;           /* window x window */
+    double *coefficients;           /* window x 2 wanted, row-major */
+    double *values;
+    int *order;
+    double *combined;               /* n x 2 wanted */
+} krylov_recycle_lanczos_t;
+
+static void krylov_recycle_free(struct krylov_recycle_space *s)
+{
+    if (s == NULL) {
+        return;
+    }
+    fem_free(s->basis);
+    fem_free(s->image);
+    fem_free(s->factor);
+    free(s);
+}
+
+int krylov_recycle_active(void)
+{
+    return g_fem_context->krylov_recycle != NULL;
+}
+
+void krylov_recycle_release(void)
+{
+    krylov_recycle_free(g_fem_context->krylov_recycle);
+    g_fem_context->krylov_recycle = NULL;
+}
+
+static int krylov_recycle_capacity(void)
+{
+    const char *setting = getenv("FEM4C_RECYCLE");
+    char *end;
+    long value;
+
+    if (setting == NULL || setting[0] == '\0') {
+        return KRYLOV_RECYCLE_DEFAULT_VECTORS;
+    }
+    value = strtol(setting, &end, 10);
+    if (end == setting || *end != '\0' || value < 0 || value > KRYLOV_RECYCLE_MAX_VECTORS) {
+        FEM_LOG_WARN("  Warning: invalid FEM4C_RECYCLE '%s' (0 to %d); using %d vectors\n",
+                     setting, KRYLOV_RECYCLE_MAX_VECTORS, KRYLOV_RECYCLE_DEFAULT_VECTORS);
+        return KRYLOV_RECYCLE_DEFAULT_VECTORS;
+    }
+    return (int)value;
+}
+
+fem_error_t krylov_recycle_prepare(void)
+{
+    struct krylov_recycle_space *s = g_fem_context->krylov_recycle;
+
+    if (s == NULL) {
+        s = (struct krylov_recycle_space *)calloc(1, sizeof(*s));
+        if (s == NULL) {
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate recycle space");
+        }
+        s->capacity = krylov_recycle_capacity();
+        s->ritz = s->capacity < KRYLOV_RECYCLE_RITZ ? s->capacity : KRYLOV_RECYCLE_RITZ;
+        g_fem_context->krylov_recycle = s;
+    }
+    s->stale = 1;
+    return FEM_SUCCESS;
+}
+
+/* Empty space for vectors of length n */
+static fem_error_t krylov_recycle_resize(struct krylov_recycle_space *s, int n)
+{
+    size_t size = (size_t)n * (size_t)(s->capacity + s->ritz) * sizeof(double);
+
+    fem_free(s->basis);
+    fem_free(s->image);
+    fem_free(s->factor);
+    s->basis = NULL;
+    s->image = NULL;
+    s->factor = NULL;
+    s->n = 0;
+    s->count = 0;
+    s->deflated_solves = 0;
+    s->saved_iterations = 0;
+    if (s->capacity == 0) {
+        s->n = n;
+        return FEM_SUCCESS;
+    }
+
+    s->basis = (double *)fem_malloc(size, FEM_MEMORY_VECTOR);
+    s->image = (double *)fem_malloc(size, FEM_MEMORY_VECTOR);
+    s->factor = (double *)fem_malloc((size_t)s->capacity * s->capacity * sizeof(double),
+                                     FEM_MEMORY_VECTOR);
+    if (!s->basis || !s->image || !s->factor) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate recycle space");
+    }
+    s->n = n;
+    return FEM_SUCCESS;
+}
+
+static double krylov_recycle_dot(const double *a, const double *b, int n)
+{
+    double sum = 0.0;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) reduction(+:sum) if (n >= KRYLOV_RECYCLE_PARALLEL_MIN)
+#endif
+    for (int i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+/* y += a x */
+static void krylov_recycle_axpy(double a, const double *x, double *y, int n)
+{
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) if (n >= KRYLOV_RECYCLE_PARALLEL_MIN)
+#endif
+    for (int i = 0; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+/* out = V Y for the count column-major vectors V and the row-major
+ * count x columns coefficients Y; transposed holds columns x count */
+static void krylov_recycle_combine(int n, const double *vectors, int count,
+                                   const double *coefficients, int columns, double *transposed,
+                                   double *out)
+{
+    /* dense_gemm_nt_subtract forms C -= A B^T, so B = -Y^T */
+    for (int j = 0; j < count; j++) {
+        for (int a = 0; a < columns; a++) {
+            transposed[a + (size_t)j * columns] = -coefficients[j * columns + a];
+        }
+    }
+    memset(out, 0, (size_t)n * columns * sizeof(double));
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) if (n >= 2 * KRYLOV_RECYCLE_ROWS)
+#endif
+    for (int i0 = 0; i0 < n; i0 += KRYLOV_RECYCLE_ROWS) {
+        int rows = n - i0 < KRYLOV_RECYCLE_ROWS ? n - i0 : KRYLOV_RECYCLE_ROWS;
+        dense_gemm_nt_subtract(rows, columns, count, vectors + i0, n, transposed, columns,
+                               out + i0, n);
+    }
+}
+
+/* Eigenpairs of the symmetric q x q matrix a (row-major, destroyed):
+ * values on its diagonal, vectors in the columns of v, order ascending */
+static void krylov_recycle_eigen(int q, double *a, double *v, int *order)
+{
+    eigen_jacobi(q, a, v);
+    for (int i = 0; i < q; i++) {
+        int current = i;
+        int j = i;
+        for (; j > 0 && a[order[j - 1] * (q + 1)] > a[current * (q + 1)]; j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = current;
+    }
+}
+
+/* Factor E = W^T K W; a space that is no longer positive definite in K
+ * is dropped */
+static void krylov_recycle_factor(struct krylov_recycle_space *s)
+{
+    int k = s->count;
+    size_t n = (size_t)s->n;
+
+    for (int j = 0; j < k; j++) {
+        for (int i = j; i < k; i++) {
+            s->factor[i + (size_t)j * k] = krylov_recycle_dot(s->basis + i * n, s->image + j * n,
+                                                              s->n);
+        }
+    }
+    if (dense_cholesky(s->factor, k, k, NULL, 0.0) >= 0) {
+        FEM_LOG_WARN("  Warning: recycled Krylov space is not positive definite; discarding it\n");
+        s->count = 0;
+    }
+}
+
+/* c = E^-1 left^T v for left = W or K W */
+static void krylov_recycle_coarse(const struct krylov_recycle_space *s, const double *left,
+                                  const double *v, double *c)
+{
+    for (int j = 0; j < s->count; j++) {
+        c[j] = krylov_recycle_dot(left + (size_t)j * s->n, v, s->n);
+    }
+    dense_trsv_lower(s->count, s->factor, s->count, c);
+    dense_trsv_lower_transpose(s->count, s->factor, s->count, c);
+}
+
+/* Preconditioner z = (I - W E^-1 (K W)^T) M^-1 r + W E^-1 W^T r (A-DEF2
+ * of Tang, Nabben, Vuik and Erlangga). Unlike deflated search directions
+ * it stays stable when the residual falls far below its initial value. */
+static void krylov_recycle_precondition(const krylov_operator_t *op,
+                                        const struct krylov_recycle_space *s, const double *r,
+                                        double *z, double *coarse)
+{
+    double *correction = coarse + KRYLOV_RECYCLE_MAX_VECTORS;
+
+    op->precondition(r, z, op->data);
+    if (s == NULL || s->count == 0) {
+        return;
+    }
+    krylov_recycle_coarse(s, s->basis, r, coarse);
+    krylov_recycle_coarse(s, s->image, z, correction);
+    for (int j = 0; j < s->count; j++) {
+        krylov_recycle_axpy(coarse[j] - correction[j], s->basis + (size_t)j * s->n, z, s->n);
+    }
+}
+
+static fem_error_t krylov_recycle_lanczos_init(krylov_recycle_lanczos_t *l, int n, int wanted)
+{
+    int w;
+
+    memset(l, 0, sizeof(*l));
+    if (wanted == 0) {
+        return FEM_SUCCESS;
+    }
+    l->n = n;
+    l->wanted = wanted;
+    l->window = w = KRYLOV_RECYCLE_WINDOW * wanted;
+    l->vectors = fem_arena_alloc(&g_scratch_arena, (size_t)n * w * sizeof(double));
+    l->projection = fem_arena_alloc(&g_scratch_arena, (size_t)w * w * sizeof(double));
+    l->matrix = fem_arena_alloc(&g_scratch_arena, (size_t)w * w * sizeof(double));
+    l->eigenvectors = fem_arena_alloc(&g_scratch_arena, (size_t)w * w * sizeof(double));
+    l->coefficients = fem_arena_alloc(&g_scratch_arena, (size_t)w * 2 * wanted * sizeof(double));
+    l->values = fem_arena_alloc(&g_scratch_arena, (size_t)w * 2 * wanted * sizeof(double));
+    l->order = fem_arena_alloc(&g_scratch_arena, (size_t)w * sizeof(int));
+    l->combined = fem_arena_alloc(&g_scratch_arena, (size_t)n * 2 * wanted * sizeof(double));
+    if (!l->vectors || !l->projection || !l->matrix || !l->eigenvectors || !l->coefficients ||
+        !l->values || !l->order || !l->combined) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Lanczos window allocation failed");
+    }
+    memset(l->projection, 0, (size_t)w * w * sizeof(double));
+    return FEM_SUCCESS;
+}
+
+/* Lowest Ritz vectors of the leading q x q projection into columns
+ * first .. first + count of the coefficients (2 wanted wide) */
+static void krylov_recycle_lanczos_lowest(krylov_recycle_lanczos_t *l, int q, int first, int count)
+{
+    int w = l->window;
+    int columns = 2 * l->wanted;
+
+    for (int i = 0; i < q; i++) {
+        memcpy(l->matrix + (size_t)i * q, l->projection + (size_t)i * w, (size_t)q * sizeof(double));
+    }
+    krylov_recycle_eigen(q, l->matrix, l->eigenvectors, l->order);
+    for (int i = 0; i < w; i++) {
+        for (int a = 0; a < count; a++) {
+            l->coefficients[i * columns + first + a] =
+                i < q ? l->eigenvectors[i * q + l->order[a]] : 0.0;
+        }
+    }
+}
+
+/* Restart a full window with the lowest Ritz vectors of the projection
+ * and of its leading part, one step older (locally optimal restart).
+ * tail receives the last row of the restart coefficients. */
+static void krylov_recycle_lanczos_restart(krylov_recycle_lanczos_t *l, double *tail)
+{
+    int w = l->window;
+    int columns = 2 * l->wanted;
+    int kept = 0;
+    double *h = l->values;
+
+    krylov_recycle_lanczos_lowest(l, w, 0, l->wanted);
+    krylov_recycle_lanczos_lowest(l, w - 1, l->wanted, l->wanted);
+
+    /* Orthonormal columns (modified Gram-Schmidt), dropping dependent ones */
+    for (int a = 0; a < columns; a++) {
+        for (int b = 0; b < kept; b++) {
+            double dot = 0.0;
+            for (int i = 0; i < w; i++) {
+                dot += l->coefficients[i * columns + a] * l->coefficients[i * columns + b];
+            }
+            for (int i = 0; i < w; i++) {
+                l->coefficients[i * columns + a] -= dot * l->coefficients[i * columns + b];
+            }
+        }
+        double norm = 0.0;
+        for (int i = 0; i < w; i++) {
+            norm += l->coefficients[i * columns + a] * l->coefficients[i * columns + a];
+        }
+        norm = sqrt(norm);
+        if (norm < 1.0e-8) {
+            continue;
+        }
+        for (int i = 0; i < w; i++) {
+            l->coefficients[i * columns + kept] = l->coefficients[i * columns + a] / norm;
+        }
+        kept++;
+    }
+
+    /* Q^T T Q, diagonalised, so that the restarted projection is diagonal */
+    for (int a = 0; a < kept; a++) {
+        for (int b = 0; b < kept; b++) {
+            double sum = 0.0;
+            for (int i = 0; i < w; i++) {
+                double row = 0.0;
+                for (int j = 0; j < w; j++) {
+                    row += l->projection[i * w + j] * l->coefficients[j * columns + b];
+                }
+                sum += l->coefficients[i * columns + a] * row;
+            }
+            h[a * kept + b] = sum;
+        }
+    }
+    for (int a = 0; a < kept; a++) {
+        for (int b = 0; b < a; b++) {
+            double average = 0.5 * (h[a * kept + b] + h[b * kept + a]);
+            h[a * kept + b] = h[b * kept + a] = average;
+        }
+    }
+    krylov_recycle_eigen(kept, h, l->eigenvectors, l->order);
+    for (int i = 0; i < w; i++) {
+        for (int a = 0; a < kept; a++) {
+            double sum = 0.0;
+            for (int b = 0; b < kept; b++) {
+                sum += l->coefficients[i * columns + b] * l->eigenvectors[b * kept + a];
+            }
+            l->matrix[i * kept + a] = sum;
+        }
+    }
+
+    krylov_recycle_combine(l->n, l->vectors, w, l->matrix, kept, l->coefficients, l->combined);
+    memcpy(l->vectors, l->combined, (size_t)l->n * kept * sizeof(double));
+    for (int a = 0; a < kept; a++) {
+        tail[a] = l->matrix[(w - 1) * kept + a];
+    }
+    memset(l->projection, 0, (size_t)w * w * sizeof(double));
+    for (int a = 0; a < kept; a++) {
+        l->projection[a * w + a] = h[a * kept + a];
+    }
+    l->size = kept;
+}
+
+/* Append z / sqrt(rz) with its diagonal entry of the projection and its
+ * coupling to the vector before it */
+static void krylov_recycle_lanczos_add(krylov_recycle_lanczos_t *l, const double *z, double rz,
+                                       double diagonal, double coupling)
+{
+    int w = l->window;
+    double tail[2 * KRYLOV_RECYCLE_RITZ];
+    double scale = 1.0 / sqrt(rz);
+    double *v;
+
+    if (l->wanted == 0) {
+        return;
+    }
+    if (l->size == w) {
+        /* The new vector couples to the restarted ones through the last */
+        krylov_recycle_lanczos_restart(l, tail);
+        for (int a = 0; a < l->size; a++) {
+            l->projection[a * w + l->size] = l->projection[l->size * w + a] = tail[a] * coupling;
+        }
+    } else if (l->size > 0) {
+        l->projection[(l->size - 1) * w + l->size] = coupling;
+        l->projection[l->size * w + l->size - 1] = coupling;
+    }
+    l->projection[l->size * w + l->size] = diagonal;
+    v = l->vectors + (size_t)l->size * l->n;
+    for (int i = 0; i < l->n; i++) {
+        v[i] = z[i] * scale;
+    }
+    l->size++;
+}
+
+/* Rayleigh-Ritz for K y = theta M y on the count + m columns of basis and
+ * image, the last m the Ritz vectors of the last solve. The capacity
+ * smallest Ritz vectors, M-orthonormal, become the new W. */
+static fem_error_t krylov_recycle_refine(const krylov_operator_t *op,
+                                         struct krylov_recycle_space *s, int m)
+{
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    int total = s->count + m;
+    size_t n = (size_t)s->n;
+    double *stiffness, *mass, *vectors, *values, *scale, *weighted, *ritz, *transposed, *combined;
+    int *order;
+    int rank = 0, kept;
+    fem_error_t err = FEM_SUCCESS;
+
+    if (total == 0) {
+        return FEM_SUCCESS;
+    }
+
+    stiffness = fem_arena_alloc(&g_scratch_arena, (size_t)total * total * sizeof(double));
+    mass = fem_arena_alloc(&g_scratch_arena, (size_t)total * total * sizeof(double));
+    vectors = fem_arena_alloc(&g_scratch_arena, (size_t)total * total * sizeof(double));
+    ritz = fem_arena_alloc(&g_scratch_arena, (size_t)total * total * sizeof(double));
+    transposed = fem_arena_alloc(&g_scratch_arena, (size_t)total * total * sizeof(double));
+    values = fem_arena_alloc(&g_scratch_arena, (size_t)total * sizeof(double));
+    scale = fem_arena_alloc(&g_scratch_arena, (size_t)total * sizeof(double));
+    order = fem_arena_alloc(&g_scratch_arena, (size_t)total * sizeof(int));
+    weighted = fem_arena_alloc(&g_scratch_arena, n * sizeof(double));
+    combined = fem_arena_alloc(&g_scratch_arena, n * (size_t)s->capacity * sizeof(double));
+    if (!stiffness || !mass || !vectors || !ritz || !transposed || !values || !scale || !order ||
+        !weighted || !combined) {
+        err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Recycle space refinement allocation failed");
+        goto cleanup;
+    }
+
+    /* Projected K and M, row-major */
+    for (int j = 0; j < total; j++) {
+        op->weight(s->basis + j * n, weighted, op->data);
+        for (int i = 0; i <= j; i++) {
+            double kij = krylov_recycle_dot(s->basis + i * n, s->image + j * n, s->n);
+            double mij = krylov_recycle_dot(s->basis + i * n, weighted, s->n);
+            stiffness[i * total + j] = stiffness[j * total + i] = kij;
+            mass[i * total + j] = mass[j * total + i] = mij;
+        }
+    }
+
+    /* Unit diagonal of the projected M */
+    for (int i = 0; i < total; i++) {
+        scale[i] = mass[i * total + i] > 0.0 ? 1.0 / sqrt(mass[i * total + i]) : 0.0;
+    }
+    for (int i = 0; i < total; i++) {
+        for (int j = 0; j < total; j++) {
+            mass[i * total + j] *= scale[i] * scale[j];
+            stiffness[i * total + j] *= scale[i] * scale[j];
+        }
+    }
+
+    /* M = U L U^T; C = U L^-1/2 over the independent directions */
+    eigen_jacobi(total, mass, vectors);
+    double largest = 0.0;
+    for (int i = 0; i < total; i++) {
+        if (mass[i * total + i] > largest) {
+            largest = mass[i * total + i];
+        }
+    }
+    for (int j = 0; j < total; j++) {
+        double lambda = mass[j * total + j];
+        if (!(lambda > KRYLOV_RECYCLE_DEPENDENT * largest)) {
+            continue;
+        }
+        for (int i = 0; i < total; i++) {
+            ritz[i * total + rank] = vectors[i * total + j] / sqrt(lambda);
+        }
+        rank++;
+    }
+    if (rank == 0) {
+        s->count = 0;
+        goto cleanup;
+    }
+
+    /* H = C^T K C (rank x rank) into mass, then H = V T V^T */
+    for (int a = 0; a < rank; a++) {
+        for (int b = 0; b < rank; b++) {
+            double sum = 0.0;
+            for (int i = 0; i < total; i++) {
+                double row = 0.0;
+                for (int j = 0; j < total; j++) {
+                    row += stiffness[i * total + j] * ritz[j * total + b];
+                }
+                sum += ritz[i * total + a] * row;
+            }
+            mass[a * rank + b] = sum;
+        }
+    }
+    for (int a = 0; a < rank; a++) {
+        for (int b = 0; b < a; b++) {
+            double average = 0.5 * (mass[a * rank + b] + mass[b * rank + a]);
+            mass[a * rank + b] = mass[b * rank + a] = average;
+        }
+    }
+    krylov_recycle_eigen(rank, mass, vectors, order);
+    kept = rank < s->capacity ? rank : s->capacity;
+    for (int a = 0; a < kept; a++) {
+        values[a] = mass[order[a] * (rank + 1)];
+    }
+
+    /* Coefficients of the kept Ritz vectors on the columns: D C V */
+    for (int i = 0; i < total; i++) {
+        for (int a = 0; a < kept; a++) {
+            double sum = 0.0;
+            for (int b = 0; b < rank; b++) {
+                sum += ritz[i * total + b] * vectors[b * rank + order[a]];
+            }
+            stiffness[i * kept + a] = scale[i] * sum;
+        }
+    }
+
+    krylov_recycle_combine(s->n, s->basis, total, stiffness, kept, transposed, combined);
+    memcpy(s->basis, combined, n * kept * sizeof(double));
+    krylov_recycle_combine(s->n, s->image, total, stiffness, kept, transposed, combined);
+    memcpy(s->image, combined, n * kept * sizeof(double));
+    s->count = kept;
+    krylov_recycle_factor(s);
+    if (s->count > 0) {
+        FEM_LOG_INFO("  Recycle space: %d vectors, Ritz values %.4e .. %.4e\n", s->count,
+                     values[0], values[kept - 1]);
+    }
+
+cleanup:
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    return err;
+}
+
+/* Append the lowest Ritz vectors of the Lanczos window to the space, with
+ * their products, and refine */
+static fem_error_t krylov_recycle_harvest(const krylov_operator_t *op,
+                                          struct krylov_recycle_space *s,
+                                          krylov_recycle_lanczos_t *l)
+{
+    int m = l->size < l->wanted ? l->size : l->wanted;
+    double *first = s->basis + (size_t)s->count * s->n;
+
+    if (m > 0) {
+        krylov_recycle_lanczos_lowest(l, l->size, 0, m);
+        for (int i = 0; i < l->size; i++) {
+            memcpy(l->matrix + (size_t)i * m, l->coefficients + (size_t)i * 2 * l->wanted,
+                   (size_t)m * sizeof(double));
+        }
+        krylov_recycle_combine(s->n, l->vectors, l->size, l->matrix, m, l->eigenvectors, first);
+        for (int a = 0; a < m; a++) {
+            fem_error_t err = op->multiply(first + (size_t)a * s->n,
+                                           s->image + (size_t)(s->count + a) * s->n, op->data);
+            CHECK_ERROR(err);
+        }
+    }
+    return krylov_recycle_refine(op, s, m);
+}
+
+/* K W and the factor for a matrix assembled since they were formed */
+static fem_error_t krylov_recycle_refresh(const krylov_operator_t *op,
+                                          struct krylov_recycle_space *s)
+{
+    for (int j = 0; j < s->count; j++) {
+        fem_error_t err = op->multiply(s->basis + (size_t)j * s->n, s->image + (size_t)j * s->n,
+                                       op->data);
+        CHECK_ERROR(err);
+    }
+    krylov_recycle_factor(s);
+    return FEM_SUCCESS;
+}
+
+static void krylov_recycle_report(struct krylov_recycle_space *s, int deflated, int iterations)
+{
+    if (deflated == 0) {
+        s->baseline_iterations = iterations;
+        s->deflated_solves = 0;
+        s->saved_iterations = 0;
+        printf("    Krylov recycling: %d iterations without deflation, %d vectors harvested\n",
+               iterations, s->count);
+        return;
+    }
+    /* The first solve had its own right-hand side, so this is a comparison
+     * with that solve and not with an undeflated solve of the current one */
+    s->deflated_solves++;
+    s->saved_iterations += s->baseline_iterations - iterations;
+    printf("    Krylov recycling: %d iterations with %d deflation vectors ", iterations, deflated);
+    if (iterations <= s->baseline_iterations) {
+        printf("(first solve %d, %.1fx fewer)", s->baseline_iterations,
+               (double)s->baseline_iterations / (iterations > 0 ? iterations : 1));
+    } else {
+        printf("(first solve %d, %d more)", s->baseline_iterations,
+               iterations - s->baseline_iterations);
+    }
+    printf("; %ld iterations %s than the first solve over %d solve%s\n",
+           s->saved_iterations >= 0 ? s->saved_iterations : -s->saved_iterations,
+           s->saved_iterations >= 0 ? "fewer" : "more", s->deflated_solves,
+           s->deflated_solves == 1 ? "" : "s");
+}
+
+fem_error_t krylov_recycle_solve(const krylov_operator_t *op, int n, const double *b, double *x,
+                                 double tolerance, int relative, int max_iterations,
+                                 int *actual_iterations, double *final_residual)
+{
+    struct krylov_recycle_space *s = g_fem_context->krylov_recycle;
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    krylov_recycle_lanczos_t lanczos;
+    double *r, *z, *p, *q, *coarse;
+    double b_norm = 1.0, rz, residual;
+    double alpha_previous = 0.0, beta_previous = 0.0;
+    int deflated = 0;
+    fem_error_t err = FEM_SUCCESS;
+
+    *actual_iterations = 0;
+    *final_residual = 0.0;
+
+    if (s != NULL) {
+        if (s->n != n) {
+            err = krylov_recycle_resize(s, n);
+            CHECK_ERROR(err);
+        }
+        if (s->stale && s->count > 0) {
+            err = krylov_recycle_refresh(op, s);
+            CHECK_ERROR(err);
+        }
+        s->stale = 0;
+        deflated = s->count;
+    }
+
+    r = fem_arena_alloc(&g_scratch_arena, (size_t)n * sizeof(double));
+    z = fem_arena_alloc(&g_scratch_arena, (size_t)n * sizeof(double));
+    p = fem_arena_alloc(&g_scratch_arena, (size_t)n * sizeof(double));
+    q = fem_arena_alloc(&g_scratch_arena, (size_t)n * sizeof(double));
+    coarse = fem_arena_alloc(&g_scratch_arena, 2 * KRYLOV_RECYCLE_MAX_VECTORS * sizeof(double));
+    if (!r || !z || !p || !q || !coarse) {
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "PCG work vector allocation failed");
+    }
+    err = krylov_recycle_lanczos_init(&lanczos, n, s != NULL ? s->ritz : 0);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+
+    FEM_LOG_INFO("Starting %spreconditioned conjugate gradient solver...\n",
+                 deflated > 0 ? "deflated " : "");
+    FEM_LOG_INFO("  Problem size: %d\n", n);
+    FEM_LOG_INFO("  Tolerance: %e%s\n", tolerance, relative ? " (relative)" : "");
+    FEM_LOG_INFO("  Max iterations: %d\n", max_iterations);
+    FEM_LOG_INFO("  Deflation vectors: %d\n", deflated);
+
+    err = op->multiply(x, q, op->data);
+    CHECK_ERROR_CLEANUP(err, goto cleanup);
+    for (int i = 0; i < n; i++) {
+        r[i] = b[i] - q[i];
+    }
+
+    /* Galerkin correction on W, after which W^T r = 0 */
+    if (deflated > 0) {
+        krylov_recycle_coarse(s, s->basis, r, coarse);
+        for (int j = 0; j < deflated; j++) {
+            krylov_recycle_axpy(coarse[j], s->basis + (size_t)j * n, x, n);
+            krylov_recycle_axpy(-coarse[j], s->image + (size_t)j * n, r, n);
+        }
+    }
+
+    if (relative) {
+        b_norm = sqrt(krylov_recycle_dot(b, b, n));
+        if (b_norm == 0.0) {
+            b_norm = 1.0;
+        }
+    }
+    residual = sqrt(krylov_recycle_dot(r, r, n)) / b_norm;
+    *final_residual = residual;
+    if (residual < tolerance) {
+        FEM_LOG_INFO("  Initial guess already converged\n");
+        goto cleanup;
+    }
+
+    krylov_recycle_precondition(op, s, r, z, coarse);
+    memcpy(p, z, (size_t)n * sizeof(double));
+    rz = krylov_recycle_dot(r, z, n);
+
+    for (int iter = 0; iter < max_iterations; iter++) {
+        err = op->multiply(p, q, op->data);
+        CHECK_ERROR_CLEANUP(err, goto cleanup);
+
+        double pq = krylov_recycle_dot(p, q, n);
+        if (!(pq > 0.0) || !(rz > 0.0)) {
+            err = error_set(FEM_ERROR_SINGULAR_MATRIX,
+                            "Non-positive curvature in PCG iteration %d", iter);
+            goto cleanup;
+        }
+        double alpha = rz / pq;
+
+        /* Lanczos vector z / sqrt(rz) of this step */
+        if (iter == 0) {
+            krylov_recycle_lanczos_add(&lanczos, z, rz, 1.0 / alpha, 0.0);
+        } else {
+            krylov_recycle_lanczos_add(&lanczos, z, rz,
+                                       1.0 / alpha + beta_previous / alpha_previous,
+                                       -sqrt(beta_previous) / alpha_previous);
+        }
+
+#ifdef _OPENMP
+        #pragma omp parallel for schedule(static) if (n >= KRYLOV_RECYCLE_PARALLEL_MIN)
+#endif
+        for (int i = 0; i < n; i++) {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * q[i];
+        }
+
+        residual = sqrt(krylov_recycle_dot(r, r, n)) / b_norm;
+        if (FEM_LOG_ENABLED(FEM_LOG_LEVEL_DEBUG) && (iter % 10 == 0 || iter < 5)) {
+            printf("    PCG iteration %d: residual %e\n", iter + 1, residual);
+        }
+        if (residual < tolerance) {
+            *actual_iterations = iter + 1;
+            *final_residual = residual;
+            FEM_LOG_INFO("  Converged in %d iterations\n", iter + 1);
+            FEM_LOG_INFO("  Final residual: %e\n", residual);
+            break;
+        }
+
+        krylov_recycle_precondition(op, s, r, z, coarse);
+        double rz_new = krylov_recycle_dot(r, z, n);
+        double beta = rz_new / rz;
+        rz = rz_new;
+        alpha_previous = alpha;
+        beta_previous = beta;
+
+#ifdef _OPENMP
+        #pragma omp parallel for schedule(static) if (n >= KRYLOV_RECYCLE_PARALLEL_MIN)
+#endif
+        for (int i = 0; i < n; i++) {
+            p[i] = z[i] + beta * p[i];
+        }
+    }
+
+    if (residual >= tolerance) {
+        *actual_iterations = max_iterations;
+        *final_residual = residual;
+        err = error_set(FEM_ERROR_MAX_ITERATIONS,
+                        "PCG solver failed to converge in %d iterations (residual = %e)",
+                        max_iterations, residual);
+        goto cleanup;
+    }
+
+    if (s != NULL && s->capacity > 0) {
+        err = krylov_recycle_harvest(op, s, &lanczos);
+        CHECK_ERROR_CLEANUP(err, goto cleanup);
+        krylov_recycle_report(s, deflated, *actual_iterations);
+    }
+
+cleanup:
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    return err;
+}
@@ -0,0 +1,58 @@
+#ifndef KRYLOV_RECYCLE_H
+#define KRYLOV_RECYCLE_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Deflated conjugate gradients with a recycled Krylov subspace
+ *
+ * Sequences of static solves with the same or a slowly changing stiffness
+ * spend most of their PCG iterations on the same few low eigenmodes of the
+ * preconditioned operator. The bound context keeps a deflation space W of
+ * approximate eigenvectors of M^-1 K from one solve to the next. The
+ * solver starts from the Galerkin correction on W and runs plain PCG with
+ * a deflating preconditioner (A-DEF2 of Tang, Nabben, Vuik and Erlangga),
+ * which unlike deflated search directions stays stable down to tight
+ * absolute tolerances. During the solve a short Lanczos window built from
+ * the PCG coefficients harvests Ritz vectors of the low modes (eigCG of
+ * Stathopoulos and Orginos); afterwards Rayleigh-Ritz on W and these
+ * vectors keeps the lowest ones as the next space.
+ *
+ * The space survives reassembly: only K W and W^T K W are recomputed
+ * (one product per vector) before the next solve, so perturbed stiffness
+ * matrices reuse the vectors of their predecessors. It is dropped when
+ * the number of DOF changes. FEM4C_SOLVER=recycle selects the solver for
+ * static analysis; FEM4C_RECYCLE sets the number of vectors kept.
+ */
+
+#include "../common/types.h"
+
+#define KRYLOV_RECYCLE_DEFAULT_VECTORS 16
+#define KRYLOV_RECYCLE_MAX_VECTORS 64
+
+/* The system solved: y = K x, z = M^-1 r and y = M x for the
+ * preconditioner M */
+typedef struct {
+    fem_error_t (*multiply)(const double *x, double *y, void *data);
+    void (*precondition)(const double *r, double *z, void *data);
+    void (*weight)(const double *x, double *y, void *data);
+    void *data;
+} krylov_operator_t;
+
+/* Create the space of the bound context if it has none and mark its
+ * products with K as stale, after an assembly */
+fem_error_t krylov_recycle_prepare(void);
+
+/* Whether the bound context holds a recycle space */
+int krylov_recycle_active(void);
+
+/* Free the space of the bound context */
+void krylov_recycle_release(void);
+
+/* Solve K x = b by PCG, x holding the initial guess. With a recycle
+ * space in the bound context the iterations are deflated by it and the
+ * space is refined afterwards; without one this is plain PCG.
+ * Convergence is measured on |r|, or on |r| / |b| when relative is set. */
+fem_error_t krylov_recycle_solve(const krylov_operator_t *op, int n, const double *b, double *x,
+                                 double tolerance, int relative, int max_iterations,
+                                 int *actual_iterations, double *final_residual);
+
+#endif /* KRYLOV_RECYCLE_H */
@@ -0,0 +1,401 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Multipoint constraints by master-slave elimination
+ */
+
+#include "mpc.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_log.h"
+#include "../common/fem_memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MPC_INITIAL_EQUATIONS 64
+#define MPC_INITIAL_TERMS 256
+
+/* Sparse accumulator for the master terms of one row */
+typedef struct {
+    double *values;             /* g_total_dof entries */
+    int *marker;                /* Row that last touched the entry */
+    int *touched;
+    int count;
+    int row;
+} mpc_accumulator_t;
+
+static int mpc_int_compare(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+void mpc_equations_init(mpc_equations_t *equations)
+{
+    memset(equations, 0, sizeof(*equations));
+}
+
+void mpc_equations_free(mpc_equations_t *equations)
+{
+    fem_free(equations->offsets);
+    fem_free(equations->node_ids);
+    fem_free(equations->components);
+    fem_free(equations->coefficients);
+    mpc_equations_init(equations);
+}
+
+fem_error_t mpc_equations_add_term(mpc_equations_t *equations, int node_id, int component,
+                                   double coefficient)
+{
+    if (equations->count == 0) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Constraint term outside an equation");
+    }
+    if (equations->term_count == equations->term_capacity) {
+        int capacity = equations->term_capacity > 0 ? 2 * equations->term_capacity
+                                                    : MPC_INITIAL_TERMS;
+        int *node_ids = fem_realloc(equations->node_ids, (size_t)capacity * sizeof(int),
+                                    FEM_MEMORY_MESH);
+        if (node_ids) {
+            equations->node_ids = node_ids;
+        }
+        int *components = fem_realloc(equations->components, (size_t)capacity * sizeof(int),
+                                      FEM_MEMORY_MESH);
+        if (components) {
+            equations->components = components;
+        }
+        double *coefficients = fem_realloc(equations->coefficients,
+                                           (size_t)capacity * sizeof(double), FEM_MEMORY_MESH);
+        if (coefficients) {
+            equations->coefficients = coefficients;
+        }
+        if (!node_ids || !components || !coefficients) {
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                             "Failed to grow constraint terms to %d", capacity);
+        }
+        equations->term_capacity = capacity;
+    }
+
+    equations->node_ids[equations->term_count] = node_id;
+    equations->components[equations->term_count] = component;
+    equations->coefficients[equations->term_count] = coefficient;
+    equations->term_count++;
+    equations->offsets[equations->count] = equations->term_count;
+    return FEM_SUCCESS;
+}
+
+fem_error_t mpc_equations_begin(mpc_equations_t *equations, int node_id, int component,
+                                double coefficient)
+{
+    if (equations->count + 1 >= equations->capacity) {
+        int capacity = equations->capacity > 0 ? 2 * equations->capacity : MPC_INITIAL_EQUATIONS;
+        int *offsets = fem_realloc(equations->offsets, (size_t)capacity * sizeof(int),
+                                   FEM_MEMORY_MESH);
+        if (!offsets) {
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                             "Failed to grow constraint equations to %d", capacity);
+        }
+        if (equations->capacity == 0) {
+            offsets[0] = 0;
+        }
+        equations->offsets = offsets;
+        equations->capacity = capacity;
+    }
+
+    equations->count++;
+    equations->offsets[equations->count] = equations->term_count;
+    return mpc_equations_add_term(equations, node_id, component, coefficient);
+}
+
+/* Global DOF of a term, -1 if the component does not exist in this model */
+static fem_error_t mpc_term_dof(const mpc_equations_t *equations, int term, int *dof)
+{
+    int node_id = equations->node_ids[term];
+    int component = equations->components[term];
+    int node = id_map_lookup(&g_node_id_map, node_id);
+
+    if (node < 0 || node >= g_num_nodes) {
+        return error_set(FEM_ERROR_INVALID_NODE,
+                         "Constraint equation references undefined node %d", node_id);
+    }
+    if (component < 0) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Invalid component %d of node %d in constraint equation",
+                         component + 1, node_id);
+    }
+    *dof = component < g_dof_per_node ? node * g_dof_per_node + component : -1;
+    return FEM_SUCCESS;
+}
+
+/* Add scale times row r of the equations to the accumulator, replacing
+ * dependent masters by their own rows */
+static fem_error_t mpc_accumulate_row(const mpc_equations_t *equations, const int *row_equation,
+                                      int row, double scale, int depth, mpc_accumulator_t *acc)
+{
+    int q = row_equation[row];
+    int first = equations->offsets[q];
+    double leading = equations->coefficients[first];
+    fem_error_t err;
+
+    for (int t = first + 1; t < equations->offsets[q + 1]; t++) {
+        double c = -scale * equations->coefficients[t] / leading;
+        int dof = -1;
+
+        err = mpc_term_dof(equations, t, &dof);
+        CHECK_ERROR(err);
+        if (dof < 0 || c == 0.0) {
+            continue;
+        }
+        if (g_mpc_dof_row[dof] >= 0) {
+            if (depth >= g_mpc_row_count) {
+                return error_set(FEM_ERROR_INVALID_INPUT,
+                                 "Circular multipoint constraints at node %d",
+                                 equations->node_ids[t]);
+            }
+            err = mpc_accumulate_row(equations, row_equation, g_mpc_dof_row[dof], c,
+                                     depth + 1, acc);
+            CHECK_ERROR(err);
+            continue;
+        }
+        if (acc->marker[dof] != acc->row) {
+            acc->marker[dof] = acc->row;
+            acc->values[dof] = 0.0;
+            acc->touched[acc->count++] = dof;
+        }
+        acc->values[dof] += c;
+    }
+    return FEM_SUCCESS;
+}
+
+static fem_error_t mpc_build_rows(const mpc_equations_t *equations, const int *row_equation)
+{
+    fem_arena_mark_t scratch = fem_arena_mark(&g_scratch_arena);
+    mpc_accumulator_t acc;
+    int capacity = equations->term_count > 0 ? equations->term_count : 1;
+    int terms = 0;
+    fem_error_t err = FEM_SUCCESS;
+
+    acc.values = fem_arena_alloc(&g_scratch_arena, (size_t)g_total_dof * sizeof(double));
+    acc.marker = fem_arena_alloc(&g_scratch_arena, (size_t)g_total_dof * sizeof(int));
+    acc.touched = fem_arena_alloc(&g_scratch_arena, (size_t)g_total_dof * sizeof(int));
+    g_mpc_row_offsets = fem_malloc(((size_t)g_mpc_row_count + 1) * sizeof(int), FEM_MEMORY_MESH);
+    g_mpc_masters = fem_malloc((size_t)capacity * sizeof(int), FEM_MEMORY_MESH);
+    g_mpc_coefficients = fem_malloc((size_t)capacity * sizeof(double), FEM_MEMORY_MESH);
+    if (!acc.values || !acc.marker || !acc.touched ||
+        !g_mpc_row_offsets || !g_mpc_masters || !g_mpc_coefficients) {
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate constraint map");
+    }
+    for (int i = 0; i < g_total_dof; i++) {
+        acc.marker[i] = -1;
+    }
+
+    g_mpc_row_offsets[0] = 0;
+    g_mpc_max_terms = 0;
+    for (int r = 0; r < g_mpc_row_count && err == FEM_SUCCESS; r++) {
+        acc.count = 0;
+        acc.row = r;
+        err = mpc_accumulate_row(equations, row_equation, r, 1.0, 0, &acc);
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        qsort(acc.touched, (size_t)acc.count, sizeof(int), mpc_int_compare);
+
+        if (terms + acc.count > capacity) {
+            int grown = capacity;
+            while (grown < terms + acc.count) {
+                grown *= 2;
+            }
+            int *masters = fem_realloc(g_mpc_masters, (size_t)grown * sizeof(int), FEM_MEMORY_MESH);
+            if (masters) {
+                g_mpc_masters = masters;
+            }
+            double *coefficients = fem_realloc(g_mpc_coefficients, (size_t)grown * sizeof(double),
+                                               FEM_MEMORY_MESH);
+            if (coefficients) {
+                g_mpc_coefficients = coefficients;
+            }
+            if (!masters || !coefficients) {
+                err = error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                                "Failed to grow constraint map to %d terms", grown);
+                break;
+            }
+            capacity = grown;
+        }
+        for (int k = 0; k < acc.count; k++) {
+            int dof = acc.touched[k];
+            if (acc.values[dof] != 0.0) {
+                g_mpc_masters[terms] = dof;
+                g_mpc_coefficients[terms] = acc.values[dof];
+                terms++;
+            }
+        }
+        g_mpc_row_offsets[r + 1] = terms;
+        if (terms - g_mpc_row_offsets[r] > g_mpc_max_terms) {
+            g_mpc_max_terms = terms - g_mpc_row_offsets[r];
+        }
+    }
+
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    return err;
+}
+
+fem_error_t mpc_build(const mpc_equations_t *equations)
+{
+    fem_arena_mark_t scratch;
+    int *row_equation;
+    int skipped = 0;
+    fem_error_t err = FEM_SUCCESS;
+
+    globals_free_mpc_data();
+    if (equations->ignored_components > 0) {
+        printf("  Warning: %d rotational or scalar constraint components ignored "
+               "(no such DOFs)\n", equations->ignored_components);
+    }
+    if (equations->count == 0 || g_total_dof <= 0) {
+        return FEM_SUCCESS;
+    }
+
+    g_mpc_dof_row = fem_malloc((size_t)g_total_dof * sizeof(int), FEM_MEMORY_MESH);
+    g_mpc_dependent_dofs = fem_malloc((size_t)equations->count * sizeof(int), FEM_MEMORY_MESH);
+    scratch = fem_arena_mark(&g_scratch_arena);
+    row_equation = fem_arena_alloc(&g_scratch_arena, (size_t)equations->count * sizeof(int));
+    if (!g_mpc_dof_row || !g_mpc_dependent_dofs || !row_equation) {
+        fem_arena_rewind(&g_scratch_arena, scratch);
+        globals_free_mpc_data();
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate constraint map");
+    }
+    for (int i = 0; i < g_total_dof; i++) {
+        g_mpc_dof_row[i] = -1;
+    }
+
+    /* Dependent DOF of each equation */
+    for (int q = 0; q < equations->count; q++) {
+        int first = equations->offsets[q];
+        int node_id = equations->node_ids[first];
+        int component = equations->components[first];
+        int dof;
+
+        err = mpc_term_dof(equations, first, &dof);
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        if (dof < 0) {
+            skipped++;
+            continue;
+        }
+        if (equations->coefficients[first] == 0.0) {
+            err = error_set(FEM_ERROR_INVALID_INPUT,
+                            "Dependent term of node %d component %d has a zero coefficient",
+                            node_id, component + 1);
+            break;
+        }
+        if (g_node_bc_flags[dof / g_dof_per_node][dof % g_dof_per_node] == 1) {
+            err = error_set(FEM_ERROR_INVALID_INPUT,
+                            "Node %d component %d is both constrained (SPC) and dependent",
+                            node_id, component + 1);
+            break;
+        }
+        if (g_mpc_dof_row[dof] >= 0) {
+            err = error_set(FEM_ERROR_INVALID_INPUT,
+                            "Node %d component %d is dependent in more than one constraint",
+                            node_id, component + 1);
+            break;
+        }
+        g_mpc_dof_row[dof] = g_mpc_row_count;
+        g_mpc_dependent_dofs[g_mpc_row_count] = dof;
+        row_equation[g_mpc_row_count] = q;
+        g_mpc_row_count++;
+    }
+
+    if (err == FEM_SUCCESS && g_mpc_row_count > 0) {
+        err = mpc_build_rows(equations, row_equation);
+    }
+    fem_arena_rewind(&g_scratch_arena, scratch);
+    if (err != FEM_SUCCESS) {
+        globals_free_mpc_data();
+        return err;
+    }
+    if (g_mpc_row_count == 0) {
+        globals_free_mpc_data();
+    }
+
+    printf("  Multipoint constraints: %d dependent DOFs, %d master terms",
+           g_mpc_row_count, g_mpc_row_count > 0 ? g_mpc_row_offsets[g_mpc_row_count] : 0);
+    if (skipped > 0) {
+        printf(" (%d equations on components the model lacks ignored)", skipped);
+    }
+    printf("\n");
+    return FEM_SUCCESS;
+}
+
+int mpc_active(void)
+{
+    return g_mpc_row_count > 0;
+}
+
+int mpc_expand_dofs(const int *dofs, int count, int *masters, int capacity)
+{
+    int written = 0;
+
+    for (int i = 0; i < count; i++) {
+        int dof = dofs[i];
+        int row = (dof >= 0 && dof < g_total_dof) ? g_mpc_dof_row[dof] : -1;
+        int first = row >= 0 ? g_mpc_row_offsets[row] : 0;
+        int last = row >= 0 ? g_mpc_row_offsets[row + 1] : 1;
+
+        for (int k = first; k < last; k++) {
+            int master = row >= 0 ? g_mpc_masters[k] : dof;
+            int seen = 0;
+            for (int j = 0; j < written && !seen; j++) {
+                seen = masters[j] == master;
+            }
+            if (seen) {
+                continue;
+            }
+            if (written == capacity) {
+                return -1;
+            }
+            masters[written++] = master;
+        }
+    }
+    return written;
+}
+
+void mpc_condense_vector(double *f)
+{
+    for (int r = 0; r < g_mpc_row_count; r++) {
+        int dof = g_mpc_dependent_dofs[r];
+        double value = f[dof];
+        if (value == 0.0) {
+            continue;
+        }
+        for (int k = g_mpc_row_offsets[r]; k < g_mpc_row_offsets[r + 1]; k++) {
+            f[g_mpc_masters[k]] += g_mpc_coefficients[k] * value;
+        }
+        f[dof] = 0.0;
+    }
+}
+
+void mpc_recover_displacements(double *u)
+{
+    for (int r = 0; r < g_mpc_row_count; r++) {
+        int dof = g_mpc_dependent_dofs[r];
+        double value = 0.0;
+        for (int k = g_mpc_row_offsets[r]; k < g_mpc_row_offsets[r + 1]; k++) {
+            value += g_mpc_coefficients[k] * u[g_mpc_masters[k]];
+        }
+        u[dof] = value;
+        g_node_displ[dof / g_dof_per_node][dof % g_dof_per_node] = value;
+    }
+}
+
+fem_error_t mpc_require_none(const char *analysis)
+{
+    if (!mpc_active()) {
+        return FEM_SUCCESS;
+    }
+    return error_set(FEM_ERROR_INVALID_INPUT,
+                     "%s analysis does not support multipoint constraints "
+                     "(%d dependent DOFs in the model)", analysis, g_mpc_row_count);
+}
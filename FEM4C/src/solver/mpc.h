@@ -0,0 +1,69 @@
+#ifndef MPC_H
+#define MPC_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Multipoint constraints by master-slave elimination
+ *
+ * The readers collect linear constraint equations sum_i a_i u_i = 0 over
+ * (node, component) terms; the first term of an equation is its dependent
+ * DOF. mpc_build() turns them into a map from every dependent DOF to
+ * independent master DOFs, u_d = sum_k c_k u_{m_k}, substituting
+ * dependent masters so that every row refers to independent DOFs only.
+ *
+ * The assembly applies the transformation u = T u_r element by element:
+ * each element matrix entry is spread over the masters of its DOFs, so the
+ * assembled matrix is T^T K T on the independent DOFs and stays symmetric
+ * positive definite. The numbering is kept: a dependent DOF becomes a
+ * decoupled identity row with zero load and is recovered from its masters
+ * after the solve.
+ */
+
+#include "../common/types.h"
+
+/* Constraint equations as read, by node ID */
+typedef struct {
+    int count;                  /* equations */
+    int capacity;
+    int *offsets;               /* Terms of equation q: [offsets[q], offsets[q + 1]) */
+    int term_count;
+    int term_capacity;
+    int *node_ids;
+    int *components;            /* 0-based */
+    double *coefficients;
+    int ignored_components;     /* rotational or scalar components skipped by the reader */
+} mpc_equations_t;
+
+void mpc_equations_init(mpc_equations_t *equations);
+void mpc_equations_free(mpc_equations_t *equations);
+
+/* Start an equation whose dependent DOF is (node_id, component) with
+ * coefficient a; the other terms follow with mpc_equations_add_term */
+fem_error_t mpc_equations_begin(mpc_equations_t *equations, int node_id, int component,
+                                double coefficient);
+fem_error_t mpc_equations_add_term(mpc_equations_t *equations, int node_id, int component,
+                                   double coefficient);
+
+/* Resolve the equations against the model read (node IDs, g_total_dof,
+ * g_dof_per_node) into the g_mpc_* map. Components beyond the DOFs of a
+ * node are dropped (z of plane models). A dependent DOF may not be
+ * constrained by an SPC or be dependent in two equations. */
+fem_error_t mpc_build(const mpc_equations_t *equations);
+
+/* The model has dependent DOFs */
+int mpc_active(void);
+
+/* Masters of global DOFs: each dependent DOF replaced by its row, the
+ * others kept, duplicates removed. Returns the number written to masters
+ * (at most capacity), -1 if capacity is too small. */
+int mpc_expand_dofs(const int *dofs, int count, int *masters, int capacity);
+
+/* f_r = T^T f: the load of each dependent DOF moves to its masters */
+void mpc_condense_vector(double *f);
+
+/* u_d = sum c_k u_{m_k} for every dependent DOF, also into g_node_displ */
+void mpc_recover_displacements(double *u);
+
+/* Error unless the model is free of multipoint constraints */
+fem_error_t mpc_require_none(const char *analysis);
+
+#endif /* MPC_H */
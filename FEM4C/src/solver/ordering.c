@@ -0,0 +1,270 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Nested dissection ordering
+ */
+
+#include "ordering.h"
+#include "../common/error.h"
+#include "../common/fem_memory.h"
+#include <string.h>
+
+/* Sweeps of the pseudo-peripheral node search */
+#define ORDERING_PERIPHERAL_SWEEPS 8
+
+typedef struct {
+    const fem_index_t *offsets;
+    const int *adjacency;
+    int *member;        /* stamp of the part a vertex is in */
+    int *level;         /* breadth-first level, -1 when not reached */
+    int *queue;
+    int *scratch;
+} ordering_work_t;
+
+/* Breadth-first search from root over the vertices stamped with part.
+ * Fills work->queue and work->level; returns the number reached and the
+ * number of levels in depth. */
+static int ordering_level_structure(ordering_work_t *work, int root, int part, int *depth)
+{
+    int head = 0;
+    int tail = 0;
+
+    work->queue[tail++] = root;
+    work->level[root] = 0;
+    while (head < tail) {
+        int v = work->queue[head++];
+        for (fem_index_t e = work->offsets[v]; e < work->offsets[v + 1]; e++) {
+            int w = work->adjacency[e];
+            if (work->member[w] == part && work->level[w] < 0) {
+                work->level[w] = work->level[v] + 1;
+                work->queue[tail++] = w;
+            }
+        }
+    }
+    *depth = work->level[work->queue[tail - 1]] + 1;
+    return tail;
+}
+
+static void ordering_clear_levels(ordering_work_t *work, const int *vertices, int count)
+{
+    for (int i = 0; i < count; i++) {
+        work->level[vertices[i]] = -1;
+    }
+}
+
+/* Split the connected components of part perm[lo .. hi) into consecutive
+ * ranges. Returns the number of components; bounds[c] .. bounds[c + 1]
+ * delimit component c (bounds holds up to hi - lo + 1 entries). */
+static int ordering_components(ordering_work_t *work, int *perm, int lo, int hi, int part,
+                               int *bounds)
+{
+    int size = hi - lo;
+    int filled = 0;
+    int count = 0;
+
+    for (int i = lo; i < hi; i++) {
+        int v = perm[i];
+        int depth;
+        if (work->level[v] >= 0) {
+            continue;
+        }
+        int reached = ordering_level_structure(work, v, part, &depth);
+        memcpy(work->scratch + filled, work->queue, (size_t)reached * sizeof(int));
+        bounds[count++] = lo + filled;
+        filled += reached;
+    }
+    bounds[count] = hi;
+    memcpy(perm + lo, work->scratch, (size_t)size * sizeof(int));
+    ordering_clear_levels(work, perm + lo, size);
+    return count;
+}
+
+/* Dissect the connected part perm[lo .. hi): halves at the front, the
+ * separator at the back. Returns the sizes of the halves, or 0 in
+ * first_size when the part cannot be split. */
+static void ordering_bisect(ordering_work_t *work, int *perm, int lo, int hi, int part,
+                            int *first_size, int *second_size)
+{
+    int size = hi - lo;
+    int root = perm[lo];
+    int depth;
+
+    *first_size = 0;
+    *second_size = 0;
+
+    /* Pseudo-peripheral root: restart from a least connected vertex of the
+     * last level while the structure gets deeper */
+    ordering_level_structure(work, root, part, &depth);
+    for (int sweep = 0; sweep < ORDERING_PERIPHERAL_SWEEPS; sweep++) {
+        int candidate = work->queue[size - 1];
+        fem_index_t best_degree = work->offsets[candidate + 1] - work->offsets[candidate];
+        for (int i = size - 1; i >= 0 && work->level[work->queue[i]] == depth - 1; i--) {
+            int v = work->queue[i];
+            fem_index_t degree = work->offsets[v + 1] - work->offsets[v];
+            if (degree < best_degree) {
+                best_degree = degree;
+                candidate = v;
+            }
+        }
+        int candidate_depth;
+        ordering_clear_levels(work, work->queue, size);
+        ordering_level_structure(work, candidate, part, &candidate_depth);
+        if (candidate_depth <= depth) {
+            ordering_clear_levels(work, work->queue, size);
+            ordering_level_structure(work, root, part, &depth);
+            break;
+        }
+        root = candidate;
+        depth = candidate_depth;
+    }
+
+    if (depth < 3) {
+        memcpy(perm + lo, work->queue, (size_t)size * sizeof(int));
+        ordering_clear_levels(work, perm + lo, size);
+        return;
+    }
+
+    /* Median level, keeping a level on either side */
+    int split = 0;
+    int below = 0;
+    for (int i = 0; i < size; i++) {
+        int l = work->level[work->queue[i]];
+        if (below + 1 > size / 2) {
+            split = l;
+            break;
+        }
+        below++;
+    }
+    if (split < 1) {
+        split = 1;
+    }
+    if (split > depth - 2) {
+        split = depth - 2;
+    }
+
+    /* Separator: the vertices of the split level that reach the next one */
+    int first = 0;
+    int second = 0;
+    int separator = 0;
+    int *halves = work->scratch;
+    int *separator_list = work->scratch + size;
+    for (int i = 0; i < size; i++) {
+        int v = work->queue[i];
+        int l = work->level[v];
+        if (l < split) {
+            halves[first++] = v;
+        } else if (l == split) {
+            int cut = 0;
+            for (fem_index_t e = work->offsets[v]; e < work->offsets[v + 1]; e++) {
+                int w = work->adjacency[e];
+                if (work->member[w] == part && work->level[w] == split + 1) {
+                    cut = 1;
+                    break;
+                }
+            }
+            if (cut) {
+                separator_list[separator++] = v;
+            } else {
+                halves[first++] = v;
+            }
+        }
+    }
+    for (int i = 0; i < size; i++) {
+        int v = work->queue[i];
+        if (work->level[v] > split) {
+            halves[first + second++] = v;
+        }
+    }
+    ordering_clear_levels(work, work->queue, size);
+
+    memcpy(perm + lo, halves, (size_t)(first + second) * sizeof(int));
+    memcpy(perm + lo + first + second, separator_list, (size_t)separator * sizeof(int));
+    *first_size = first;
+    *second_size = second;
+}
+
+fem_error_t ordering_nested_dissection(int n, const fem_index_t *offsets, const int *adjacency,
+                                       int *perm)
+{
+    ordering_work_t work;
+    int *stack;
+    int *bounds;
+    int top = 0;
+    int stamp = 0;
+
+    if (n <= 0) {
+        return FEM_SUCCESS;
+    }
+
+    work.offsets = offsets;
+    work.adjacency = adjacency;
+    work.member = (int *)fem_malloc((size_t)n * sizeof(int), FEM_MEMORY_MATRIX);
+    work.level = (int *)fem_malloc((size_t)n * sizeof(int), FEM_MEMORY_MATRIX);
+    work.queue = (int *)fem_malloc((size_t)n * sizeof(int), FEM_MEMORY_MATRIX);
+    work.scratch = (int *)fem_malloc(2 * (size_t)n * sizeof(int), FEM_MEMORY_MATRIX);
+    bounds = (int *)fem_malloc(((size_t)n + 1) * sizeof(int), FEM_MEMORY_MATRIX);
+    /* Pending parts as (lo, hi, connected) triples; at most one per vertex */
+    stack = (int *)fem_malloc(3 * ((size_t)n + 1) * sizeof(int), FEM_MEMORY_MATRIX);
+    if (!work.member || !work.level || !work.queue || !work.scratch || !bounds || !stack) {
+        fem_free(work.member);
+        fem_free(work.level);
+        fem_free(work.queue);
+        fem_free(work.scratch);
+        fem_free(bounds);
+        fem_free(stack);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate ordering workspace");
+    }
+
+    for (int v = 0; v < n; v++) {
+        perm[v] = v;
+        work.member[v] = 0;
+        work.level[v] = -1;
+    }
+
+    stack[top++] = 0;
+    stack[top++] = n;
+    stack[top++] = 0;
+    while (top > 0) {
+        int connected = stack[--top];
+        int hi = stack[--top];
+        int lo = stack[--top];
+
+        if (hi - lo <= ORDERING_LEAF_NODES) {
+            continue;
+        }
+        stamp++;
+        for (int i = lo; i < hi; i++) {
+            work.member[perm[i]] = stamp;
+        }
+
+        if (!connected) {
+            int count = ordering_components(&work, perm, lo, hi, stamp, bounds);
+            for (int c = 0; c < count; c++) {
+                stack[top++] = bounds[c];
+                stack[top++] = bounds[c + 1];
+                stack[top++] = 1;
+            }
+            continue;
+        }
+
+        int first;
+        int second;
+        ordering_bisect(&work, perm, lo, hi, stamp, &first, &second);
+        if (first == 0) {
+            continue;
+        }
+        /* Removing the separator may disconnect either half */
+        stack[top++] = lo;
+        stack[top++] = lo + first;
+        stack[top++] = 0;
+        stack[top++] = lo + first;
+        stack[top++] = lo + first + second;
+        stack[top++] = 0;
+    }
+
+    fem_free(work.member);
+    fem_free(work.level);
+    fem_free(work.queue);
+    fem_free(work.scratch);
+    fem_free(bounds);
+    fem_free(stack);
+    return FEM_SUCCESS;
+}
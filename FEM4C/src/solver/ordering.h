@@ -0,0 +1,27 @@
+#ifndef ORDERING_H
+#define ORDERING_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Fill-reducing ordering of the node graph
+ *
+ * Nested dissection: the graph is split by a vertex separator taken from
+ * the level structure of a pseudo-peripheral node, the two halves are
+ * ordered recursively and the separator is numbered after both. Each
+ * connected component is dissected on its own; parts of at most
+ * ORDERING_LEAF_NODES nodes keep the breadth-first order they were found
+ * in. On mesh graphs this bounds the fill of a Cholesky factor to about
+ * n log n in 2D and n^(4/3) in 3D, against n^(3/2) and n^(5/3) for a
+ * banded (skyline) ordering.
+ */
+
+#include "../common/types.h"
+
+#define ORDERING_LEAF_NODES 64
+
+/* Order the n vertices of the symmetric graph whose neighbours of vertex
+ * v are adjacency[offsets[v] .. offsets[v + 1]) (no self loops).
+ * perm[k] receives the vertex placed k-th. */
+fem_error_t ordering_nested_dissection(int n, const fem_index_t *offsets, const int *adjacency,
+                                       int *perm);
+
+#endif /* ORDERING_H */
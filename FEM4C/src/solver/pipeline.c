@@ -0,0 +1,493 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Pipelined preprocessing implementation
+ *
+ * The worker reads the model through its own copy of the context (view).
+ * The copy is taken when the first element block is published, after the
+ * nodes are complete; later publications only move view.num_elements
+ * forward and hand over the material arrays. The reader never resizes
+ * the arrays the worker reads while it runs (the parser reader cancels the
+ * pipeline before growing them), so the worker never observes a field the
+ * reader is writing.
+ */
+
+#include "pipeline.h"
+#include "assembly.h"
+#include "mpc.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_log.h"
+#include "../common/fem_thread.h"
+#include "../mesh/mesh_quality.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+typedef struct {
+    int first;
+    int count;
+    size_t *offset;             /* Start of each element's packed matrix */
+    double *ke;                 /* Packed upper triangles in element order */
+    unsigned char *computed;    /* 0: left to pipeline_assemble_stiffness */
+} pipeline_block_t;
+
+/* Pipeline of one analysis context (fem_context_t.pipeline) */
+struct pipeline_state {
+    fem_mutex_t mutex;
+    fem_cond_t cond;
+    fem_thread_t thread;
+    int started;
+    int joined;
+
+    /* Set by the reader under the mutex */
+    int published;
+    int materials_ready;
+    double (*material_props)[6];
+    int *material_type;
+    int num_materials;
+    int input_done;
+    int cancelled;
+
+    /* Owned by the worker until it is joined */
+    fem_context_t view;
+    int dof;
+    int *profile;               /* Skyline column tops, fem_malloc'd */
+    int symbolic_done;
+    int kernel_done;
+    pipeline_block_t *blocks;
+    int block_count;
+    int block_capacity;
+    int computed_count;
+    fem_error_t status;
+    char message[ERROR_MSG_LEN];
+};
+
+static struct pipeline_state *pipeline_state(void)
+{
+    return g_fem_context->pipeline;
+}
+
+static void pipeline_capture_materials(struct pipeline_state *state)
+{
+    state->material_props = g_material_props;
+    state->material_type = g_material_type;
+    state->num_materials = g_num_materials;
+}
+
+static int pipeline_has_work(const struct pipeline_state *state)
+{
+    return state->symbolic_done < state->published ||
+           (state->materials_ready && state->kernel_done < state->published);
+}
+
+/* Column tops of the newly published elements */
+static fem_error_t pipeline_symbolic(struct pipeline_state *state, int published)
+{
+    fem_error_t err;
+
+    for (int e = state->symbolic_done; e < published; ++e) {
+        err = assembly_profile_add_element(state->profile, state->dof, e);
+        CHECK_ERROR(err);
+    }
+    state->symbolic_done = published;
+    return FEM_SUCCESS;
+}
+
+static fem_error_t pipeline_add_block(struct pipeline_state *state, int first, int last)
+{
+    pipeline_block_t *block;
+    size_t total = 0;
+
+    if (state->block_count == state->block_capacity) {
+        int capacity = state->block_capacity > 0 ? 2 * state->block_capacity : 16;
+        pipeline_block_t *blocks = (pipeline_block_t *)realloc(state->blocks,
+                                                               (size_t)capacity * sizeof(*blocks));
+        if (blocks == NULL) {
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to grow pipeline block list");
+        }
+        state->blocks = blocks;
+        state->block_capacity = capacity;
+    }
+
+    block = &state->blocks[state->block_count];
+    memset(block, 0, sizeof(*block));
+    block->first = first;
+    block->count = last - first;
+    block->offset = (size_t *)fem_malloc(((size_t)block->count + 1) * sizeof(size_t),
+                                         FEM_MEMORY_MATRIX);
+    block->computed = (unsigned char *)fem_calloc((size_t)block->count, 1, FEM_MEMORY_MATRIX);
+    if (block->offset == NULL || block->computed == NULL) {
+        fem_free(block->offset);
+        fem_free(block->computed);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Failed to allocate pipeline block of %d elements", block->count);
+    }
+
+    for (int i = 0; i < block->count; ++i) {
+        block->offset[i] = total;
+        total += (size_t)assembly_element_stiffness_packed_size(g_element_type[first + i]);
+    }
+    block->offset[block->count] = total;
+
+    block->ke = (double *)fem_malloc((total > 0 ? total : 1) * sizeof(double), FEM_MEMORY_MATRIX);
+    if (block->ke == NULL) {
+        fem_free(block->offset);
+        fem_free(block->computed);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Failed to allocate element matrices of %d elements", block->count);
+    }
+
+    state->block_count++;
+    return FEM_SUCCESS;
+}
+
+/* Validate and integrate the next block of elements. Elements that fail
+ * either step are left to the sequential path, which reports them. */
+static fem_error_t pipeline_kernels(struct pipeline_state *state, int published)
+{
+    int first = state->kernel_done;
+    int last = published - first > PIPELINE_BLOCK_ELEMENTS ? first + PIPELINE_BLOCK_ELEMENTS
+                                                          : published;
+    fem_context_t *view = g_fem_context;
+    pipeline_block_t *block;
+    int computed = 0;
+    fem_error_t err;
+
+    err = mesh_validate_range(first, last);
+    CHECK_ERROR(err);
+    err = pipeline_add_block(state, first, last);
+    CHECK_ERROR(err);
+    block = &state->blocks[state->block_count - 1];
+
+#ifdef _OPENMP
+    #pragma omp parallel reduction(+:computed)
+#endif
+    {
+        fem_context_bind(view);
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic, 64)
+#endif
+        for (int i = 0; i < block->count; ++i) {
+            int e = first + i;
+            if (mesh_validated_element(e) &&
+                assembly_element_stiffness_packed(e, block->ke + block->offset[i]) == FEM_SUCCESS) {
+                block->computed[i] = 1;
+                computed++;
+            }
+        }
+    }
+
+    state->computed_count += computed;
+    state->kernel_done = last;
+    return FEM_SUCCESS;
+}
+
+static void *pipeline_run(void *arg)
+{
+    struct pipeline_state *state = (struct pipeline_state *)arg;
+    fem_error_t err = FEM_SUCCESS;
+
+    fem_context_bind(&state->view);
+    fem_mutex_lock(&state->mutex);
+    for (;;) {
+        int published;
+        int materials_ready;
+
+        while (!state->cancelled && !state->input_done && !pipeline_has_work(state)) {
+            fem_cond_wait(&state->cond, &state->mutex);
+        }
+        if (state->cancelled || !pipeline_has_work(state)) {
+            break;
+        }
+
+        published = state->published;
+        materials_ready = state->materials_ready;
+        state->view.num_elements = published;
+        if (materials_ready) {
+            state->view.material_props = state->material_props;
+            state->view.material_type = state->material_type;
+            state->view.num_materials = state->num_materials;
+        }
+        fem_mutex_unlock(&state->mutex);
+
+        err = pipeline_symbolic(state, published);
+        if (err == FEM_SUCCESS && materials_ready && state->kernel_done < published) {
+            err = pipeline_kernels(state, published);
+        }
+
+        fem_mutex_lock(&state->mutex);
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+    }
+    fem_mutex_unlock(&state->mutex);
+
+    if (err != FEM_SUCCESS) {
+        state->status = err;
+        strncpy(state->message, error_get_message(), ERROR_MSG_LEN - 1);
+        state->message[ERROR_MSG_LEN - 1] = '\0';
+    }
+    return NULL;
+}
+
+/* Snapshot the model and start the worker; the nodes are complete */
+static fem_error_t pipeline_start(struct pipeline_state *state)
+{
+    fem_error_t err;
+
+    /* Solids are assembled into block storage after the read */
+    if (g_analysis.spatial_dimension != 2) {
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "solid models are not pipelined");
+    }
+
+    state->view = *g_fem_context;
+    state->view.num_elements = 0;
+    state->view.element_quality = NULL;
+    state->view.element_quality_count = 0;
+    state->view.element_quality_capacity = 0;
+    fem_arena_init(&state->view.scratch_arena, 0, FEM_MEMORY_VECTOR);
+    state->view.async_output = NULL;
+    state->view.pipeline = NULL;
+
+    state->dof = g_num_nodes * 2;
+    state->profile = (int *)fem_malloc((size_t)(state->dof > 0 ? state->dof : 1) * sizeof(int),
+                                       FEM_MEMORY_MATRIX);
+    if (state->profile == NULL) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Failed to allocate pipelined skyline profile for %d DOF", state->dof);
+    }
+    for (int i = 0; i < state->dof; ++i) {
+        state->profile[i] = i;
+    }
+
+    err = fem_thread_create(&state->thread, pipeline_run, state);
+    CHECK_ERROR(err);
+    state->started = 1;
+    return FEM_SUCCESS;
+}
+
+fem_error_t pipeline_begin(void)
+{
+    const char *setting = getenv("FEM4C_PIPELINE");
+    struct pipeline_state *state;
+    fem_error_t err;
+
+    pipeline_cancel();
+    if (setting == NULL || strcmp(setting, "1") != 0) {
+        return FEM_SUCCESS;
+    }
+    if (!FEM_THREADS_AVAILABLE) {
+        FEM_LOG_WARN("  Warning: pipelined preprocessing needs thread support; reading sequentially\n");
+        return FEM_SUCCESS;
+    }
+
+    state = (struct pipeline_state *)calloc(1, sizeof(struct pipeline_state));
+    if (state == NULL) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate pipeline state");
+    }
+    err = fem_mutex_init(&state->mutex);
+    if (err == FEM_SUCCESS) {
+        err = fem_cond_init(&state->cond);
+        if (err != FEM_SUCCESS) {
+            fem_mutex_destroy(&state->mutex);
+        }
+    }
+    if (err != FEM_SUCCESS) {
+        free(state);
+        return err;
+    }
+
+    g_fem_context->pipeline = state;
+    FEM_LOG_INFO("  Pipelined preprocessing enabled\n");
+    return FEM_SUCCESS;
+}
+
+int pipeline_active(void)
+{
+    return pipeline_state() != NULL;
+}
+
+void pipeline_publish_elements(int count)
+{
+    struct pipeline_state *state = pipeline_state();
+
+    if (state == NULL || state->joined) {
+        return;
+    }
+    if (!state->started && pipeline_start(state) != FEM_SUCCESS) {
+        FEM_LOG_WARN("  Warning: pipelined preprocessing not started (%s); reading sequentially\n",
+                     error_get_message());
+        pipeline_cancel();
+        return;
+    }
+
+    fem_mutex_lock(&state->mutex);
+    state->published = count;
+    if (state->materials_ready) {
+        pipeline_capture_materials(state);
+    }
+    fem_cond_broadcast(&state->cond);
+    fem_mutex_unlock(&state->mutex);
+}
+
+void pipeline_publish_materials(void)
+{
+    struct pipeline_state *state = pipeline_state();
+
+    if (state == NULL || state->joined) {
+        return;
+    }
+    fem_mutex_lock(&state->mutex);
+    state->materials_ready = 1;
+    pipeline_capture_materials(state);
+    fem_cond_broadcast(&state->cond);
+    fem_mutex_unlock(&state->mutex);
+}
+
+fem_error_t pipeline_wait(void)
+{
+    struct pipeline_state *state = pipeline_state();
+    fem_error_t err;
+
+    if (state == NULL || state->joined) {
+        return FEM_SUCCESS;
+    }
+    if (!state->started) {
+        /* The reader never published elements (Nastran bulk input) */
+        pipeline_cancel();
+        return FEM_SUCCESS;
+    }
+
+    fem_mutex_lock(&state->mutex);
+    state->input_done = 1;
+    fem_cond_broadcast(&state->cond);
+    fem_mutex_unlock(&state->mutex);
+
+    err = fem_thread_join(&state->thread, NULL);
+    state->joined = 1;
+    if (err == FEM_SUCCESS && state->status != FEM_SUCCESS) {
+        FEM_LOG_WARN("  Warning: pipelined preprocessing stopped (%s); continuing sequentially\n",
+                     state->message);
+        pipeline_cancel();
+        return FEM_SUCCESS;
+    }
+    CHECK_ERROR_CLEANUP(err, pipeline_cancel());
+
+    /* Hand the validation cache of the covered elements to the model */
+    fem_free(g_element_quality);
+    g_element_quality = state->view.element_quality;
+    g_element_quality_count = state->view.element_quality_count;
+    g_element_quality_capacity = state->view.element_quality_capacity;
+    state->view.element_quality = NULL;
+    state->view.element_quality_count = 0;
+    state->view.element_quality_capacity = 0;
+    fem_arena_free(&state->view.scratch_arena);
+
+    FEM_LOG_INFO("  Pipelined preprocessing: %d of %d element matrices computed during input\n",
+                 state->computed_count, g_num_elements);
+    return FEM_SUCCESS;
+}
+
+fem_error_t pipeline_assemble_stiffness(void)
+{
+    struct pipeline_state *state = pipeline_state();
+    double ke[T6_TOTAL_DOF * (T6_TOTAL_DOF + 1) / 2];
+    int *profile;
+    int element_id = 0;
+    fem_error_t err = FEM_SUCCESS;
+
+    if (state == NULL || !state->joined) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "No finished pipeline to assemble from");
+    }
+    if (state->dof != g_total_dof) {
+        pipeline_cancel();
+        return error_set(FEM_ERROR_INVALID_INPUT,
+                         "Pipelined profile covers %d DOF, model has %d", state->dof, g_total_dof);
+    }
+
+    /* Elements the worker did not reach; all of them when multipoint
+     * constraints, read after the elements, couple further DOFs */
+    for (int e = mpc_active() ? 0 : state->symbolic_done; e < g_num_elements; ++e) {
+        err = assembly_profile_add_element(state->profile, state->dof, e);
+        CHECK_ERROR_CLEANUP(err, pipeline_cancel());
+    }
+    profile = state->profile;
+    state->profile = NULL;
+    err = assembly_prepare_global_system_with_profile(profile);
+    CHECK_ERROR_CLEANUP(err, pipeline_cancel());
+
+    err = assembly_clear_global_arrays();
+    CHECK_ERROR_CLEANUP(err, pipeline_cancel());
+
+    FEM_LOG_INFO("Assembling global stiffness matrix (pipelined)...\n");
+    FEM_LOG_INFO("  Elements: %d\n", g_num_elements);
+
+    for (int b = 0; b < state->block_count && err == FEM_SUCCESS; ++b) {
+        const pipeline_block_t *block = &state->blocks[b];
+        for (int i = 0; i < block->count && err == FEM_SUCCESS; ++i) {
+            element_id = block->first + i;
+            if (block->computed[i]) {
+                err = assembly_add_element_stiffness_packed(element_id, block->ke + block->offset[i]);
+            } else {
+                err = assembly_element_stiffness_packed(element_id, ke);
+                if (err == FEM_SUCCESS) {
+                    err = assembly_add_element_stiffness_packed(element_id, ke);
+                }
+            }
+        }
+    }
+    if (err == FEM_SUCCESS) {
+        for (element_id = state->kernel_done; element_id < g_num_elements; ++element_id) {
+            err = assembly_element_stiffness_packed(element_id, ke);
+            if (err == FEM_SUCCESS) {
+                err = assembly_add_element_stiffness_packed(element_id, ke);
+            }
+            if (err != FEM_SUCCESS) {
+                break;
+            }
+        }
+    }
+    pipeline_cancel();
+
+    if (err != FEM_SUCCESS) {
+        FEM_LOG_ERROR("  Error assembling element %d into global matrix: %d\n", element_id, err);
+        return err;
+    }
+    FEM_LOG_INFO("  Assembly completed\n");
+    return FEM_SUCCESS;
+}
+
+void pipeline_cancel(void)
+{
+    struct pipeline_state *state = pipeline_state();
+
+    if (state == NULL) {
+        return;
+    }
+    if (state->started && !state->joined) {
+        fem_mutex_lock(&state->mutex);
+        state->cancelled = 1;
+        fem_cond_broadcast(&state->cond);
+        fem_mutex_unlock(&state->mutex);
+        fem_thread_join(&state->thread, NULL);
+    }
+
+    for (int b = 0; b < state->block_count; ++b) {
+        fem_free(state->blocks[b].offset);
+        fem_free(state->blocks[b].ke);
+        fem_free(state->blocks[b].computed);
+    }
+    free(state->blocks);
+    fem_free(state->profile);
+    fem_free(state->view.element_quality);
+    fem_arena_free(&state->view.scratch_arena);
+    fem_cond_destroy(&state->cond);
+    fem_mutex_destroy(&state->mutex);
+    free(state);
+    g_fem_context->pipeline = NULL;
+}
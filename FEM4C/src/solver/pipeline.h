@@ -0,0 +1,48 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Pipelined preprocessing
+ *
+ * With FEM4C_PIPELINE=1 the input reader hands element blocks to a worker
+ * thread as soon as they are parsed. The worker grows the skyline column
+ * tops from the connectivity straight away and, once the material data is
+ * known, validates the elements (mesh quality cache) and computes their
+ * element matrices. Only the scatter into the skyline storage waits for
+ * the complete profile; it runs in element order, so the assembled matrix
+ * is identical to the sequential one.
+ *
+ * Native input overlaps the profile with element parsing and the element
+ * matrices with the boundary condition and load sections (materials follow
+ * the elements there). Parser packages read the material file first, so
+ * element matrices overlap the mesh parsing itself. Nastran bulk input is
+ * read sequentially. Builds without threads ignore the setting.
+ */
+
+#include "../common/types.h"
+
+/* Elements per block handed to the worker */
+#define PIPELINE_BLOCK_ELEMENTS 4096
+
+/* Attach a pipeline to the bound context if FEM4C_PIPELINE=1 */
+fem_error_t pipeline_begin(void);
+int pipeline_active(void);
+
+/* Reader side: elements [0, count) are complete; material data is final */
+void pipeline_publish_elements(int count);
+void pipeline_publish_materials(void);
+
+/* End of input: wait for the worker and take over its validation cache.
+ * A worker failure is reported as a warning and the analysis continues
+ * sequentially. */
+fem_error_t pipeline_wait(void);
+
+/* Assemble the global stiffness matrix from the pipelined results;
+ * elements the worker did not cover are computed here. Releases the
+ * pipeline. */
+fem_error_t pipeline_assemble_stiffness(void);
+
+/* Stop the worker and drop its results (error paths, mesh growth) */
+void pipeline_cancel(void);
+
+#endif /* PIPELINE_H */
@@ -0,0 +1,1199 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Out-of-core skyline LDL^T factorization and solve
+ */
+
+/* fseeko, mkstemp, fdopen, unlink */
+#define _POSIX_C_SOURCE 200809L
+
+#include "skyline_ooc.h"
+#include "assembly.h"
+#include "skyline_solver.h"
+#include "mpc.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_log.h"
+#include "../common/fem_memory.h"
+#include "../common/fem_thread.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+/* Panel buffers the budget is divided into: the panel being factored, the
+ * previous panel and the read slots */
+#define SKYLINE_OOC_BUFFERS 4
+#define SKYLINE_OOC_SLOTS   2
+
+/* Below this many columns a panel is updated on one thread */
+#define SKYLINE_OOC_PARALLEL_MIN 32
+
+struct skyline_ooc_store {
+    FILE *file;
+    fem_mutex_t io_mutex;
+    size_t budget;
+    int total_dof;
+    fem_index_t value_count;        /* K at [0, count), the factor at [count, 2 count) */
+    int panel_count;
+    int *panel_first;               /* panel p holds columns [first[p], first[p + 1]) */
+    int *panel_of_column;
+    fem_index_t panel_capacity;     /* entries of the largest panel */
+    double *diagonal;               /* D of the factor */
+    int factored;
+    double bytes_read;
+    double bytes_written;
+};
+
+/* A block of the file the reader thread fetches; it may only be read once
+ * the first `factored` panels of the factor are in the file */
+typedef struct {
+    long long position;
+    fem_index_t count;
+    int factored;
+} skyline_ooc_item_t;
+
+/* Reads the items in order into a ring of slots ahead of the consumer */
+typedef struct {
+    struct skyline_ooc_store *store;
+    const skyline_ooc_item_t *items;
+    int item_count;
+    double *slots[SKYLINE_OOC_SLOTS];
+    fem_mutex_t mutex;
+    fem_cond_t cond;
+    fem_thread_t thread;
+    int threaded;
+    int filled;                     /* items read */
+    int released;                   /* items the consumer is done with */
+    int factored;                   /* factor panels in the file */
+    int stop;
+    fem_error_t status;
+    double wait_time;               /* consumer time blocked on reads */
+} skyline_ooc_reader_t;
+
+static struct skyline_ooc_store *skyline_ooc_store(void)
+{
+    return g_fem_context->skyline_ooc;
+}
+
+int skyline_ooc_active(void)
+{
+    return skyline_ooc_store() != NULL;
+}
+
+/* Bytes, or a number with a K, M or G suffix */
+static size_t skyline_ooc_parse_size(const char *text, size_t fallback)
+{
+    char *end;
+    double value = strtod(text, &end);
+    double scale = 1.0;
+
+    switch (toupper((unsigned char)*end)) {
+        case 'K': scale = 1024.0; end++; break;
+        case 'M': scale = 1024.0 * 1024.0; end++; break;
+        case 'G': scale = 1024.0 * 1024.0 * 1024.0; end++; break;
+        default: break;
+    }
+    if (toupper((unsigned char)*end) == 'B') {
+        end++;
+    }
+    if (end == text || *end != '\0' || !(value > 0.0) || value * scale >= (double)SIZE_MAX) {
+        FEM_LOG_WARN("  Warning: invalid FEM4C_OOC_MEMORY '%s'; using %zu bytes\n", text, fallback);
+        return fallback;
+    }
+    return (size_t)(value * scale);
+}
+
+skyline_ooc_options_t skyline_ooc_default_options(void)
+{
+    skyline_ooc_options_t options;
+    const char *memory = getenv("FEM4C_OOC_MEMORY");
+    const char *directory = getenv("FEM4C_OOC_DIR");
+
+    options.memory_budget = SKYLINE_OOC_DEFAULT_MEMORY;
+    if (memory != NULL && memory[0] != '\0') {
+        options.memory_budget = skyline_ooc_parse_size(memory, SKYLINE_OOC_DEFAULT_MEMORY);
+    }
+    options.directory = directory != NULL && directory[0] != '\0' ? directory : NULL;
+    return options;
+}
+
+/* Anonymous scratch file: created in directory and unlinked at once, so
+ * nothing is left behind however the process ends */
+static FILE *skyline_ooc_open_scratch(const char *directory)
+{
+#ifndef _WIN32
+    if (directory != NULL) {
+        char path[MAX_FILENAME_LEN];
+        FILE *file;
+        int fd;
+
+        if (snprintf(path, sizeof(path), "%s/fem4c_ooc_XXXXXX", directory) >= (int)sizeof(path)) {
+            return NULL;
+        }
+        fd = mkstemp(path);
+        if (fd < 0) {
+            return NULL;
+        }
+        unlink(path);
+        file = fdopen(fd, "w+b");
+        if (file == NULL) {
+            close(fd);
+        }
+        return file;
+    }
+#else
+    (void)directory;
+#endif
+    return tmpfile();
+}
+
+static int skyline_ooc_seek(FILE *file, long long byte_offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, byte_offset, SEEK_SET);
+#else
+    return fseeko(file, (off_t)byte_offset, SEEK_SET);
+#endif
+}
+
+/* Read or write count doubles at position (in doubles). The reader thread
+ * and the factorization share the file, so each transfer holds the lock. */
+static fem_error_t skyline_ooc_transfer(struct skyline_ooc_store *store, long long position,
+                                        fem_index_t count, double *buffer, int writing)
+{
+    int failed;
+
+    fem_mutex_lock(&store->io_mutex);
+    failed = skyline_ooc_seek(store->file, position * (long long)sizeof(double)) != 0;
+    if (!failed) {
+        size_t done = writing ? fwrite(buffer, sizeof(double), (size_t)count, store->file)
+                              : fread(buffer, sizeof(double), (size_t)count, store->file);
+        failed = done != (size_t)count;
+    }
+    if (!failed) {
+        double bytes = (double)count * sizeof(double);
+        if (writing) {
+            store->bytes_written += bytes;
+        } else {
+            store->bytes_read += bytes;
+        }
+    }
+    fem_mutex_unlock(&store->io_mutex);
+
+    if (failed) {
+        return error_set(writing ? FEM_ERROR_FILE_WRITE : FEM_ERROR_FILE_READ,
+                         "Out-of-core store %s failed at entry %lld",
+                         writing ? "write" : "read", position);
+    }
+    return FEM_SUCCESS;
+}
+
+static long long skyline_ooc_stiffness_position(const struct skyline_ooc_store *store, int panel)
+{
+    return (long long)g_stiffness_offsets[store->panel_first[panel]];
+}
+
+static long long skyline_ooc_factor_position(const struct skyline_ooc_store *store, int panel)
+{
+    return (long long)store->value_count + (long long)g_stiffness_offsets[store->panel_first[panel]];
+}
+
+static fem_index_t skyline_ooc_panel_size(const struct skyline_ooc_store *store, int panel)
+{
+    return g_stiffness_offsets[store->panel_first[panel + 1]] -
+           g_stiffness_offsets[store->panel_first[panel]];
+}
+
+static void *skyline_ooc_reader_run(void *arg)
+{
+    skyline_ooc_reader_t *reader = (skyline_ooc_reader_t *)arg;
+
+    for (int k = 0; k < reader->item_count; k++) {
+        const skyline_ooc_item_t *item = &reader->items[k];
+        fem_error_t err;
+
+        fem_mutex_lock(&reader->mutex);
+        while (!reader->stop && (k - reader->released >= SKYLINE_OOC_SLOTS ||
+                                 reader->factored < item->factored)) {
+            fem_cond_wait(&reader->cond, &reader->mutex);
+        }
+        if (reader->stop) {
+            fem_mutex_unlock(&reader->mutex);
+            break;
+        }
+        fem_mutex_unlock(&reader->mutex);
+
+        err = skyline_ooc_transfer(reader->store, item->position, item->count,
+                                   reader->slots[k % SKYLINE_OOC_SLOTS], 0);
+
+        fem_mutex_lock(&reader->mutex);
+        if (err != FEM_SUCCESS) {
+            reader->status = err;
+        } else {
+            reader->filled = k + 1;
+        }
+        fem_cond_broadcast(&reader->cond);
+        fem_mutex_unlock(&reader->mutex);
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void skyline_ooc_reader_finish(skyline_ooc_reader_t *reader)
+{
+    if (reader->threaded) {
+        fem_mutex_lock(&reader->mutex);
+        reader->stop = 1;
+        fem_cond_broadcast(&reader->cond);
+        fem_mutex_unlock(&reader->mutex);
+        fem_thread_join(&reader->thread, NULL);
+        fem_cond_destroy(&reader->cond);
+        fem_mutex_destroy(&reader->mutex);
+    }
+    for (int s = 0; s < SKYLINE_OOC_SLOTS; s++) {
+        fem_free(reader->slots[s]);
+        reader->slots[s] = NULL;
+    }
+}
+
+/* Builds without threads read each item when it is taken */
+static fem_error_t skyline_ooc_reader_start(skyline_ooc_reader_t *reader,
+                                            struct skyline_ooc_store *store,
+                                            const skyline_ooc_item_t *items, int item_count)
+{
+    fem_error_t err;
+
+    memset(reader, 0, sizeof(*reader));
+    reader->store = store;
+    reader->items = items;
+    reader->item_count = item_count;
+    reader->status = FEM_SUCCESS;
+    for (int s = 0; s < SKYLINE_OOC_SLOTS; s++) {
+        reader->slots[s] = (double *)fem_malloc((size_t)store->panel_capacity * sizeof(double),
+                                                FEM_MEMORY_MATRIX);
+        if (reader->slots[s] == NULL) {
+            skyline_ooc_reader_finish(reader);
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate out-of-core read buffers");
+        }
+    }
+    if (!FEM_THREADS_AVAILABLE || item_count == 0) {
+        return FEM_SUCCESS;
+    }
+
+    err = fem_mutex_init(&reader->mutex);
+    if (err == FEM_SUCCESS) {
+        err = fem_cond_init(&reader->cond);
+        if (err != FEM_SUCCESS) {
+            fem_mutex_destroy(&reader->mutex);
+        }
+    }
+    if (err == FEM_SUCCESS) {
+        err = fem_thread_create(&reader->thread, skyline_ooc_reader_run, reader);
+        if (err != FEM_SUCCESS) {
+            fem_cond_destroy(&reader->cond);
+            fem_mutex_destroy(&reader->mutex);
+        }
+    }
+    if (err != FEM_SUCCESS) {
+        skyline_ooc_reader_finish(reader);
+        return err;
+    }
+    reader->threaded = 1;
+    return FEM_SUCCESS;
+}
+
+/* Item k, once it has been read */
+static fem_error_t skyline_ooc_reader_take(skyline_ooc_reader_t *reader, int k, const double **data)
+{
+    double *slot = reader->slots[k % SKYLINE_OOC_SLOTS];
+    double start = fem_wall_time();
+    fem_error_t status;
+
+    *data = slot;
+    if (!reader->threaded) {
+        const skyline_ooc_item_t *item = &reader->items[k];
+        status = skyline_ooc_transfer(reader->store, item->position, item->count, slot, 0);
+        reader->wait_time += fem_wall_time() - start;
+        return status;
+    }
+
+    fem_mutex_lock(&reader->mutex);
+    while (reader->filled <= k && reader->status == FEM_SUCCESS) {
+        fem_cond_wait(&reader->cond, &reader->mutex);
+    }
+    status = reader->filled > k ? FEM_SUCCESS : reader->status;
+    fem_mutex_unlock(&reader->mutex);
+    reader->wait_time += fem_wall_time() - start;
+
+    if (status != FEM_SUCCESS) {
+        return error_set(status, "Out-of-core store read failed");
+    }
+    return FEM_SUCCESS;
+}
+
+/* Item k is no longer needed; its slot may be refilled */
+static void skyline_ooc_reader_release(skyline_ooc_reader_t *reader, int k)
+{
+    if (!reader->threaded) {
+        return;
+    }
+    fem_mutex_lock(&reader->mutex);
+    reader->released = k + 1;
+    fem_cond_broadcast(&reader->cond);
+    fem_mutex_unlock(&reader->mutex);
+}
+
+static void skyline_ooc_reader_publish(skyline_ooc_reader_t *reader, int factored)
+{
+    if (!reader->threaded) {
+        return;
+    }
+    fem_mutex_lock(&reader->mutex);
+    reader->factored = factored;
+    fem_cond_broadcast(&reader->cond);
+    fem_mutex_unlock(&reader->mutex);
+}
+
+static void skyline_ooc_store_free(struct skyline_ooc_store *store)
+{
+    if (store == NULL) {
+        return;
+    }
+    if (store->file != NULL) {
+        fclose(store->file);
+    }
+    fem_mutex_destroy(&store->io_mutex);
+    fem_free(store->panel_first);
+    fem_free(store->panel_of_column);
+    fem_free(store->diagonal);
+    free(store);
+}
+
+void skyline_ooc_release(void)
+{
+    skyline_ooc_store_free(g_fem_context->skyline_ooc);
+    g_fem_context->skyline_ooc = NULL;
+}
+
+/* Cut the profile into panels of at most budget / SKYLINE_OOC_BUFFERS
+ * bytes and open the scratch file */
+static fem_error_t skyline_ooc_create(const skyline_ooc_options_t *options,
+                                      struct skyline_ooc_store **store_out)
+{
+    const fem_index_t *offsets = g_stiffness_offsets;
+    int n = g_total_dof;
+    fem_index_t capacity = (fem_index_t)(options->memory_budget /
+                                         (SKYLINE_OOC_BUFFERS * sizeof(double)));
+    struct skyline_ooc_store *store;
+    fem_error_t err;
+    int panels = 0;
+
+    store = (struct skyline_ooc_store *)calloc(1, sizeof(*store));
+    if (store == NULL) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate out-of-core store");
+    }
+    err = fem_mutex_init(&store->io_mutex);
+    if (err != FEM_SUCCESS) {
+        free(store);
+        return err;
+    }
+    store->budget = options->memory_budget;
+    store->total_dof = n;
+    store->value_count = g_stiffness_value_count;
+    store->panel_first = (int *)fem_malloc(((size_t)n + 1) * sizeof(int), FEM_MEMORY_MATRIX);
+    store->panel_of_column = (int *)fem_malloc((size_t)n * sizeof(int), FEM_MEMORY_MATRIX);
+    store->diagonal = (double *)fem_malloc((size_t)n * sizeof(double), FEM_MEMORY_VECTOR);
+    if (!store->panel_first || !store->panel_of_column || !store->diagonal) {
+        skyline_ooc_store_free(store);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate out-of-core panel map");
+    }
+
+    for (int j = 0; j < n; j++) {
+        fem_index_t height = offsets[j + 1] - offsets[j];
+        if (height > capacity) {
+            skyline_ooc_store_free(store);
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                             "Skyline column %d (%lld entries) does not fit the out-of-core "
+                             "budget of %zu bytes; raise FEM4C_OOC_MEMORY",
+                             j + 1, (long long)height, options->memory_budget);
+        }
+        if (panels == 0 || offsets[j + 1] - offsets[store->panel_first[panels - 1]] > capacity) {
+            store->panel_first[panels++] = j;
+        }
+        store->panel_of_column[j] = panels - 1;
+    }
+    store->panel_first[panels] = n;
+    store->panel_count = panels;
+    for (int p = 0; p < panels; p++) {
+        fem_index_t size = skyline_ooc_panel_size(store, p);
+        if (size > store->panel_capacity) {
+            store->panel_capacity = size;
+        }
+    }
+
+    store->file = skyline_ooc_open_scratch(options->directory);
+    if (store->file == NULL) {
+        skyline_ooc_store_free(store);
+        return error_set(FEM_ERROR_FILE_WRITE, "Cannot create out-of-core scratch file in %s",
+                         options->directory ? options->directory : "the temporary directory");
+    }
+
+    *store_out = store;
+    return FEM_SUCCESS;
+}
+
+/* Reaction entry recorded while the panels are assembled */
+typedef struct {
+    int *rows;
+    int *columns;
+    double *values;
+    fem_index_t count;
+    fem_index_t capacity;
+} skyline_ooc_triplets_t;
+
+static fem_error_t skyline_ooc_triplet_add(skyline_ooc_triplets_t *t, int row, int column, double value)
+{
+    if (t->count == t->capacity) {
+        fem_index_t capacity = t->capacity > 0 ? 2 * t->capacity : 1024;
+        int *rows, *columns;
+        double *values;
+
+        rows = (int *)fem_realloc(t->rows, (size_t)capacity * sizeof(int), FEM_MEMORY_MATRIX);
+        if (rows == NULL) {
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate reaction rows");
+        }
+        t->rows = rows;
+        columns = (int *)fem_realloc(t->columns, (size_t)capacity * sizeof(int), FEM_MEMORY_MATRIX);
+        if (columns == NULL) {
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate reaction rows");
+        }
+        t->columns = columns;
+        values = (double *)fem_realloc(t->values, (size_t)capacity * sizeof(double), FEM_MEMORY_MATRIX);
+        if (values == NULL) {
+            return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate reaction rows");
+        }
+        t->values = values;
+        t->capacity = capacity;
+    }
+    t->rows[t->count] = row;
+    t->columns[t->count] = column;
+    t->values[t->count] = value;
+    t->count++;
+    return FEM_SUCCESS;
+}
+
+/* Constrained rows in the layout of assembly_store_reaction_rows(): the
+ * triplets come in the same column order, and a stable sort by row keeps
+ * it within each row */
+static fem_error_t skyline_ooc_store_reactions(const skyline_ooc_triplets_t *t, int count)
+{
+    fem_index_t *cursor;
+
+    g_reaction_columns = fem_malloc((size_t)(t->count > 0 ? t->count : 1) * sizeof(int), FEM_MEMORY_MATRIX);
+    g_reaction_values = fem_malloc((size_t)(t->count > 0 ? t->count : 1) * sizeof(double), FEM_MEMORY_MATRIX);
+    cursor = fem_malloc((size_t)(count > 0 ? count : 1) * sizeof(fem_index_t), FEM_MEMORY_MATRIX);
+    if (!g_reaction_columns || !g_reaction_values || !cursor) {
+        fem_free(cursor);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION,
+                         "Failed to allocate reaction rows (%lld entries)", (long long)t->count);
+    }
+    for (fem_index_t k = 0; k < t->count; k++) {
+        g_reaction_row_offsets[t->rows[k] + 1]++;
+    }
+    for (int r = 0; r < count; r++) {
+        g_reaction_row_offsets[r + 1] += g_reaction_row_offsets[r];
+        cursor[r] = g_reaction_row_offsets[r];
+    }
+    for (fem_index_t k = 0; k < t->count; k++) {
+        fem_index_t at = cursor[t->rows[k]]++;
+        g_reaction_columns[at] = t->columns[k];
+        g_reaction_values[at] = t->values[k];
+    }
+    fem_free(cursor);
+    g_reaction_dof_count = count;
+    g_reactions_current = 0;
+    return FEM_SUCCESS;
+}
+
+/* Elements touching each panel, in element order: element_list[offsets[p]
+ * .. offsets[p + 1]) */
+static fem_error_t skyline_ooc_panel_elements(const struct skyline_ooc_store *store,
+                                              int **offsets_out, int **list_out)
+{
+    int panels = store->panel_count;
+    int *offsets = (int *)fem_calloc((size_t)panels + 1, sizeof(int), FEM_MEMORY_MESH);
+    int *list = NULL;
+    fem_error_t err = FEM_SUCCESS;
+
+    if (offsets == NULL) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate panel element lists");
+    }
+    for (int pass = 0; pass < 2 && err == FEM_SUCCESS; pass++) {
+        for (int e = 0; e < g_num_elements; e++) {
+            int dof_map[T6_TOTAL_DOF];
+            int seen[T6_TOTAL_DOF];
+            int dof_count = 0, seen_count = 0;
+
+            err = assembly_collect_element_dofs(e, dof_map, &dof_count);
+            if (err != FEM_SUCCESS) {
+                break;
+            }
+            for (int a = 0; a < dof_count; a++) {
+                int panel, known = 0;
+                if (dof_map[a] < 0 || dof_map[a] >= g_total_dof) {
+                    continue;
+                }
+                panel = store->panel_of_column[dof_map[a]];
+                for (int s = 0; s < seen_count && !known; s++) {
+                    known = seen[s] == panel;
+                }
+                if (known) {
+                    continue;
+                }
+                seen[seen_count++] = panel;
+                if (pass == 0) {
+                    offsets[panel + 1]++;
+                } else {
+                    list[offsets[panel]++] = e;
+                }
+            }
+        }
+        if (pass == 0 && err == FEM_SUCCESS) {
+            for (int p = 0; p < panels; p++) {
+                offsets[p + 1] += offsets[p];
+            }
+            list = (int *)fem_malloc((size_t)(offsets[panels] > 0 ? offsets[panels] : 1) * sizeof(int),
+                                     FEM_MEMORY_MESH);
+            if (list == NULL) {
+                err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate panel element lists");
+            }
+        }
+    }
+    if (err != FEM_SUCCESS) {
+        fem_free(offsets);
+        fem_free(list);
+        return err;
+    }
+    /* The fill advanced each start to the next panel's */
+    for (int p = panels; p > 0; p--) {
+        offsets[p] = offsets[p - 1];
+    }
+    offsets[0] = 0;
+    *offsets_out = offsets;
+    *list_out = list;
+    return FEM_SUCCESS;
+}
+
+/* Scatter the elements of panel p into the panel buffer. Elements are
+ * added in element order and each packed matrix row by row, as in the
+ * in-core assembly, so every entry gets the same sum. */
+static fem_error_t skyline_ooc_assemble_panel(const struct skyline_ooc_store *store, int p,
+                                              const int *elements, int element_count,
+                                              double *panel)
+{
+    const int *profile = g_stiffness_profile;
+    const fem_index_t *offsets = g_stiffness_offsets;
+    int first = store->panel_first[p];
+    int last = store->panel_first[p + 1];
+    fem_index_t base = offsets[first];
+    double ke[T6_TOTAL_DOF * (T6_TOTAL_DOF + 1) / 2];
+    fem_error_t err;
+
+    memset(panel, 0, (size_t)skyline_ooc_panel_size(store, p) * sizeof(double));
+    for (int k = 0; k < element_count; k++) {
+        int e = elements[k];
+        int dof_map[T6_TOTAL_DOF];
+        int dof_count = 0;
+        const double *entry = ke;
+
+        err = assembly_collect_element_dofs(e, dof_map, &dof_count);
+        CHECK_ERROR(err);
+        err = assembly_element_stiffness_packed(e, ke);
+        CHECK_ERROR(err);
+
+        for (int a = 0; a < dof_count; a++) {
+            for (int b = a; b < dof_count; b++) {
+                int row = dof_map[a];
+                int col = dof_map[b];
+                double value = *entry++;
+                if (row < 0 || row >= g_total_dof || col < 0 || col >= g_total_dof) {
+                    continue;
+                }
+                if (row > col) {
+                    int tmp = row;
+                    row = col;
+                    col = tmp;
+                }
+                if (col < first || col >= last) {
+                    continue;
+                }
+                panel[offsets[col] - base + (row - profile[col])] += value;
+            }
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+fem_error_t skyline_ooc_assemble(const skyline_ooc_options_t *options)
+{
+    skyline_ooc_options_t defaults;
+    struct skyline_ooc_store *store = NULL;
+    skyline_ooc_triplets_t triplets;
+    int *element_offsets = NULL, *element_list = NULL, *row_of_dof = NULL;
+    double *panel = NULL;
+    double min_diagonal = 1.0e30, max_diagonal = -1.0e30;
+    int zero_diagonal_count = 0, bc_count = 0;
+    fem_error_t err;
+
+    if (options == NULL) {
+        defaults = skyline_ooc_default_options();
+        options = &defaults;
+    }
+    if (g_analysis.spatial_dimension != 2) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "The out-of-core solver supports plane models only");
+    }
+    err = mpc_require_none("Out-of-core static");
+    CHECK_ERROR(err);
+
+    skyline_ooc_release();
+    err = assembly_prepare_stiffness_profile();
+    CHECK_ERROR(err);
+    err = assembly_global_force_vector();
+    CHECK_ERROR(err);
+    if (g_total_dof <= 0) {
+        return FEM_SUCCESS;
+    }
+
+    err = skyline_ooc_create(options, &store);
+    CHECK_ERROR(err);
+    g_fem_context->skyline_ooc = store;
+
+    FEM_LOG_INFO("Assembling global stiffness matrix out of core...\n");
+    memset(&triplets, 0, sizeof(triplets));
+    err = skyline_ooc_panel_elements(store, &element_offsets, &element_list);
+    if (err != FEM_SUCCESS) {
+        goto cleanup;
+    }
+
+    /* Constrained DOFs and their loads before the boundary conditions */
+    globals_free_reaction_data();
+    row_of_dof = (int *)fem_malloc((size_t)g_total_dof * sizeof(int), FEM_MEMORY_VECTOR);
+    panel = (double *)fem_malloc((size_t)store->panel_capacity * sizeof(double), FEM_MEMORY_MATRIX);
+    if (!row_of_dof || !panel) {
+        err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate out-of-core assembly buffers");
+        goto cleanup;
+    }
+    for (int i = 0; i < g_total_dof; i++) {
+        row_of_dof[i] = -1;
+    }
+    for (int node = 0; node < g_num_nodes; node++) {
+        for (int dof = 0; dof < 2; dof++) {
+            int global_dof = node * 2 + dof;
+            if (g_node_bc_flags[node][dof] == 1 && global_dof < g_total_dof) {
+                row_of_dof[global_dof] = bc_count++;
+            }
+        }
+    }
+    g_reaction_dofs = fem_malloc((size_t)(bc_count > 0 ? bc_count : 1) * sizeof(int), FEM_MEMORY_VECTOR);
+    g_reaction_loads = fem_malloc((size_t)(bc_count > 0 ? bc_count : 1) * sizeof(double), FEM_MEMORY_VECTOR);
+    g_reaction_row_offsets = fem_calloc((size_t)bc_count + 1, sizeof(fem_index_t), FEM_MEMORY_MATRIX);
+    if (!g_reaction_dofs || !g_reaction_loads || !g_reaction_row_offsets) {
+        err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate reaction rows");
+        goto cleanup;
+    }
+    for (int i = 0; i < g_total_dof; i++) {
+        if (row_of_dof[i] >= 0) {
+            g_reaction_dofs[row_of_dof[i]] = i;
+            g_reaction_loads[row_of_dof[i]] = g_global_force[i];
+        }
+    }
+
+    /* Assemble, record the constrained rows and apply the boundary
+     * conditions panel by panel. The right-hand side receives the lifting
+     * terms of each constrained DOF in the order of
+     * assembly_apply_boundary_conditions(). */
+    for (int p = 0; p < store->panel_count && err == FEM_SUCCESS; p++) {
+        int first = store->panel_first[p];
+        int last = store->panel_first[p + 1];
+        fem_index_t base = g_stiffness_offsets[first];
+
+        err = skyline_ooc_assemble_panel(store, p, element_list + element_offsets[p],
+                                         element_offsets[p + 1] - element_offsets[p], panel);
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        for (int j = first; j < last && err == FEM_SUCCESS; j++) {
+            double *column = panel + (g_stiffness_offsets[j] - base);
+            int top = g_stiffness_profile[j];
+            int row_j = row_of_dof[j];
+            double u_j = row_j >= 0 ? g_node_displ[j / 2][j % 2] : 0.0;
+
+            for (int i = top; i <= j && err == FEM_SUCCESS; i++) {
+                double value = column[i - top];
+                if (value == 0.0) {
+                    continue;
+                }
+                if (row_of_dof[i] >= 0) {
+                    err = skyline_ooc_triplet_add(&triplets, row_of_dof[i], j, value);
+                }
+                if (err == FEM_SUCCESS && i != j && row_j >= 0) {
+                    err = skyline_ooc_triplet_add(&triplets, row_j, i, value);
+                }
+            }
+            for (int i = top; i < j; i++) {
+                int row_i = row_of_dof[i];
+                if (row_i < 0 && row_j < 0) {
+                    continue;
+                }
+                if (row_i < 0) {
+                    g_global_force[i] -= column[i - top] * u_j;
+                } else if (row_j < 0) {
+                    g_global_force[j] -= column[i - top] * g_node_displ[i / 2][i % 2];
+                }
+                column[i - top] = 0.0;
+            }
+            if (row_j >= 0) {
+                column[j - top] = 1.0;
+            }
+
+            double diagonal = column[j - top];
+            if (fabs(diagonal) < TOLERANCE) {
+                zero_diagonal_count++;
+            }
+            if (diagonal < min_diagonal) min_diagonal = diagonal;
+            if (diagonal > max_diagonal) max_diagonal = diagonal;
+        }
+        if (err == FEM_SUCCESS) {
+            err = skyline_ooc_transfer(store, skyline_ooc_stiffness_position(store, p),
+                                       skyline_ooc_panel_size(store, p), panel, 1);
+        }
+    }
+    if (err != FEM_SUCCESS) {
+        goto cleanup;
+    }
+    for (int r = 0; r < bc_count; r++) {
+        int dof = g_reaction_dofs[r];
+        g_global_force[dof] = g_node_displ[dof / 2][dof % 2];
+    }
+    err = skyline_ooc_store_reactions(&triplets, bc_count);
+    if (err != FEM_SUCCESS) {
+        goto cleanup;
+    }
+    FEM_LOG_INFO("  Applied %d boundary conditions\n", bc_count);
+
+    printf("    Out-of-core store: %d panels of up to %.2f MB (budget %.2f MB), "
+           "%.2f MB on disk\n", store->panel_count,
+           (double)store->panel_capacity * sizeof(double) / 1048576.0,
+           (double)store->budget / 1048576.0,
+           2.0 * (double)store->value_count * sizeof(double) / 1048576.0);
+
+    FEM_LOG_INFO("Checking global stiffness matrix properties...\n");
+    err = assembly_check_diagonal(min_diagonal, max_diagonal, zero_diagonal_count);
+
+cleanup:
+    fem_free(triplets.rows);
+    fem_free(triplets.columns);
+    fem_free(triplets.values);
+    fem_free(element_offsets);
+    fem_free(element_list);
+    fem_free(row_of_dof);
+    fem_free(panel);
+    if (err != FEM_SUCCESS) {
+        globals_free_reaction_data();
+        skyline_ooc_release();
+    }
+    return err;
+}
+
+/* Rows [source_first, source_last) of the factor, held in source, update
+ * the columns [first, last) held in target: g(i, j) -= sum L(k, i) g(k, j).
+ * Rows are taken in increasing order as in skyline_ldlt_factorize(). */
+static void skyline_ooc_update_panel(const double *source, int source_first, int source_last,
+                                     double *target, int first, int last)
+{
+    const int *profile = g_stiffness_profile;
+    const fem_index_t *offsets = g_stiffness_offsets;
+    fem_index_t source_base = offsets[source_first];
+    fem_index_t base = offsets[first];
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 4) if (last - first >= SKYLINE_OOC_PARALLEL_MIN)
+#endif
+    for (int j = first; j < last; j++) {
+        int top_j = profile[j];
+        double *column_j = target + (offsets[j] - base);
+        int begin = top_j + 1 > source_first ? top_j + 1 : source_first;
+
+        for (int i = begin; i < source_last; i++) {
+            int top_i = profile[i];
+            const double *column_i = source + (offsets[i] - source_base);
+            int k0 = top_i > top_j ? top_i : top_j;
+            double sum = 0.0;
+            for (int k = k0; k < i; k++) {
+                sum += column_i[k - top_i] * column_j[k - top_j];
+            }
+            column_j[i - top_j] -= sum;
+        }
+    }
+}
+
+/* The rows of the panel itself, then the division by D column by column */
+static fem_error_t skyline_ooc_factor_panel(struct skyline_ooc_store *store, int p, double *target,
+                                            int *negative)
+{
+    const int *profile = g_stiffness_profile;
+    const fem_index_t *offsets = g_stiffness_offsets;
+    int first = store->panel_first[p];
+    int last = store->panel_first[p + 1];
+    fem_index_t base = offsets[first];
+
+    for (int j = first; j < last; j++) {
+        int top_j = profile[j];
+        double *column_j = target + (offsets[j] - base);
+        double original = column_j[j - top_j];
+        int begin = top_j + 1 > first ? top_j + 1 : first;
+
+        for (int i = begin; i < j; i++) {
+            int top_i = profile[i];
+            const double *column_i = target + (offsets[i] - base);
+            int k0 = top_i > top_j ? top_i : top_j;
+            double sum = 0.0;
+            for (int k = k0; k < i; k++) {
+                sum += column_i[k - top_i] * column_j[k - top_j];
+            }
+            column_j[i - top_j] -= sum;
+        }
+
+        double pivot = original;
+        for (int i = top_j; i < j; i++) {
+            double g = column_j[i - top_j];
+            double l = g / store->diagonal[i];
+            pivot -= l * g;
+            column_j[i - top_j] = l;
+        }
+
+        if (pivot == 0.0 || fabs(pivot) <= SKYLINE_PIVOT_TOLERANCE * fabs(original)) {
+            return error_set(FEM_ERROR_SINGULAR_MATRIX,
+                             "Zero pivot at DOF %d in skyline factorization", j + 1);
+        }
+        if (pivot < 0.0) {
+            (*negative)++;
+        }
+        column_j[j - top_j] = pivot;
+        store->diagonal[j] = pivot;
+    }
+    return FEM_SUCCESS;
+}
+
+/* First panel the column tops of panel p reach into */
+static int skyline_ooc_reach(const struct skyline_ooc_store *store, int p)
+{
+    int reach = store->panel_first[p];
+
+    for (int j = store->panel_first[p]; j < store->panel_first[p + 1]; j++) {
+        int row = g_stiffness_profile[j] + 1 < j ? g_stiffness_profile[j] + 1 : j;
+        if (row < reach) {
+            reach = row;
+        }
+    }
+    return store->panel_of_column[reach];
+}
+
+/* Left-looking over panels: panel p is read from K, updated by the factor
+ * panels its columns reach (streamed from the file, the previous one
+ * still in memory), factored and written to the factor region */
+static fem_error_t skyline_ooc_factorize(struct skyline_ooc_store *store)
+{
+    int panels = store->panel_count;
+    skyline_ooc_item_t *items;
+    skyline_ooc_reader_t reader;
+    double *target, *previous;
+    double start = fem_wall_time();
+    double read_before = store->bytes_read, written_before = store->bytes_written;
+    int item_count = 0, k = 0, negative = 0;
+    fem_error_t err = FEM_SUCCESS;
+
+    for (int p = 0; p < panels; p++) {
+        int reach = skyline_ooc_reach(store, p);
+        item_count += 1 + (p - 1 > reach ? p - 1 - reach : 0);
+    }
+    items = (skyline_ooc_item_t *)fem_malloc((size_t)item_count * sizeof(*items), FEM_MEMORY_MATRIX);
+    target = (double *)fem_malloc((size_t)store->panel_capacity * sizeof(double), FEM_MEMORY_MATRIX);
+    previous = (double *)fem_malloc((size_t)store->panel_capacity * sizeof(double), FEM_MEMORY_MATRIX);
+    if (!items || !target || !previous) {
+        fem_free(items);
+        fem_free(target);
+        fem_free(previous);
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate out-of-core factor buffers");
+    }
+    for (int p = 0; p < panels; p++) {
+        items[k].position = skyline_ooc_stiffness_position(store, p);
+        items[k].count = skyline_ooc_panel_size(store, p);
+        items[k].factored = 0;
+        k++;
+        for (int q = skyline_ooc_reach(store, p); q < p - 1; q++) {
+            items[k].position = skyline_ooc_factor_position(store, q);
+            items[k].count = skyline_ooc_panel_size(store, q);
+            items[k].factored = q + 1;
+            k++;
+        }
+    }
+
+    err = skyline_ooc_reader_start(&reader, store, items, item_count);
+    if (err != FEM_SUCCESS) {
+        fem_free(items);
+        fem_free(target);
+        fem_free(previous);
+        return err;
+    }
+
+    k = 0;
+    for (int p = 0; p < panels && err == FEM_SUCCESS; p++) {
+        int first = store->panel_first[p];
+        int last = store->panel_first[p + 1];
+        int reach = skyline_ooc_reach(store, p);
+        const double *block;
+
+        err = skyline_ooc_reader_take(&reader, k, &block);
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        memcpy(target, block, (size_t)skyline_ooc_panel_size(store, p) * sizeof(double));
+        skyline_ooc_reader_release(&reader, k++);
+
+        for (int q = reach; q < p - 1 && err == FEM_SUCCESS; q++) {
+            err = skyline_ooc_reader_take(&reader, k, &block);
+            if (err == FEM_SUCCESS) {
+                skyline_ooc_update_panel(block, store->panel_first[q], store->panel_first[q + 1],
+                                         target, first, last);
+            }
+            skyline_ooc_reader_release(&reader, k++);
+        }
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        if (p > 0 && p - 1 >= reach) {
+            skyline_ooc_update_panel(previous, store->panel_first[p - 1], first,
+                                     target, first, last);
+        }
+
+        err = skyline_ooc_factor_panel(store, p, target, &negative);
+        if (err == FEM_SUCCESS) {
+            err = skyline_ooc_transfer(store, skyline_ooc_factor_position(store, p),
+                                       skyline_ooc_panel_size(store, p), target, 1);
+        }
+        if (err == FEM_SUCCESS) {
+            double *swap = previous;
+            previous = target;
+            target = swap;
+            skyline_ooc_reader_publish(&reader, p + 1);
+        }
+    }
+
+    skyline_ooc_reader_finish(&reader);
+    fem_free(items);
+    fem_free(target);
+    fem_free(previous);
+    CHECK_ERROR(err);
+
+    store->factored = 1;
+    if (negative > 0) {
+        FEM_LOG_WARN("  Warning: %d negative pivots in the out-of-core factorization\n", negative);
+    }
+    double elapsed = fem_wall_time() - start;
+    printf("    Out-of-core LDL^T: %.2f MB read, %.2f MB written, %.3f s waiting for reads, "
+           "%.3f s computing\n", (store->bytes_read - read_before) / 1048576.0,
+           (store->bytes_written - written_before) / 1048576.0, reader.wait_time,
+           elapsed - reader.wait_time);
+    return FEM_SUCCESS;
+}
+
+/* Forward, diagonal and back substitution with the factor panels read in
+ * ascending, then descending order */
+static fem_error_t skyline_ooc_substitute(struct skyline_ooc_store *store, double *x)
+{
+    const int *profile = g_stiffness_profile;
+    const fem_index_t *offsets = g_stiffness_offsets;
+    int panels = store->panel_count;
+    skyline_ooc_item_t *items;
+    skyline_ooc_reader_t reader;
+    double read_before = store->bytes_read;
+    fem_error_t err = FEM_SUCCESS;
+
+    items = (skyline_ooc_item_t *)fem_malloc((size_t)(2 * panels) * sizeof(*items), FEM_MEMORY_MATRIX);
+    if (items == NULL) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate out-of-core read list");
+    }
+    for (int p = 0; p < panels; p++) {
+        int back = panels - 1 - p;
+        items[p].position = skyline_ooc_factor_position(store, p);
+        items[p].count = skyline_ooc_panel_size(store, p);
+        items[p].factored = 0;
+        items[panels + p].position = skyline_ooc_factor_position(store, back);
+        items[panels + p].count = skyline_ooc_panel_size(store, back);
+        items[panels + p].factored = 0;
+    }
+    err = skyline_ooc_reader_start(&reader, store, items, 2 * panels);
+    if (err != FEM_SUCCESS) {
+        fem_free(items);
+        return err;
+    }
+
+    /* L y = b */
+    for (int p = 0; p < panels && err == FEM_SUCCESS; p++) {
+        fem_index_t base = offsets[store->panel_first[p]];
+        const double *block;
+
+        err = skyline_ooc_reader_take(&reader, p, &block);
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        for (int j = store->panel_first[p]; j < store->panel_first[p + 1]; j++) {
+            const double *column = block + (offsets[j] - base);
+            int top = profile[j];
+            double sum = 0.0;
+            for (int i = top; i < j; i++) {
+                sum += column[i - top] * x[i];
+            }
+            x[j] -= sum;
+        }
+        skyline_ooc_reader_release(&reader, p);
+    }
+
+    /* D z = y */
+    if (err == FEM_SUCCESS) {
+        for (int j = 0; j < store->total_dof; j++) {
+            x[j] /= store->diagonal[j];
+        }
+    }
+
+    /* L^T x = z */
+    for (int k = panels; k < 2 * panels && err == FEM_SUCCESS; k++) {
+        int p = 2 * panels - 1 - k;
+        fem_index_t base = offsets[store->panel_first[p]];
+        const double *block;
+
+        err = skyline_ooc_reader_take(&reader, k, &block);
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        for (int j = store->panel_first[p + 1] - 1; j >= store->panel_first[p] && j > 0; j--) {
+            const double *column = block + (offsets[j] - base);
+            int top = profile[j];
+            double xj = x[j];
+            for (int i = top; i < j; i++) {
+                x[i] -= column[i - top] * xj;
+            }
+        }
+        skyline_ooc_reader_release(&reader, k);
+    }
+
+    skyline_ooc_reader_finish(&reader);
+    fem_free(items);
+    CHECK_ERROR(err);
+
+    printf("    Out-of-core substitution: %.2f MB read, %.3f s waiting for reads\n",
+           (store->bytes_read - read_before) / 1048576.0, reader.wait_time);
+    return FEM_SUCCESS;
+}
+
+fem_error_t skyline_ooc_solve_system(void)
+{
+    struct skyline_ooc_store *store = skyline_ooc_store();
+    fem_error_t err = FEM_SUCCESS;
+
+    if (g_total_dof <= 0) {
+        g_solver_info.iterations = 0;
+        g_solver_info.residual = 0.0;
+        g_solver_info.status = FEM_SUCCESS;
+        return FEM_SUCCESS;
+    }
+    if (!store || store->total_dof != g_total_dof || !g_global_force || !g_global_displ) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Out-of-core system not assembled");
+    }
+
+    if (!store->factored) {
+        err = skyline_ooc_factorize(store);
+    }
+    if (err == FEM_SUCCESS) {
+        memcpy(g_global_displ, g_global_force, (size_t)g_total_dof * sizeof(double));
+        err = skyline_ooc_substitute(store, g_global_displ);
+    }
+
+    g_solver_info.iterations = 0;
+    g_solver_info.residual = 0.0;
+    g_solver_info.status = err;
+    CHECK_ERROR(err);
+
+    for (int node = 0; node < g_num_nodes; node++) {
+        g_node_displ[node][0] = g_global_displ[node * 2];
+        g_node_displ[node][1] = g_global_displ[node * 2 + 1];
+        g_node_displ[node][2] = 0.0;
+    }
+    FEM_LOG_INFO("Solution completed successfully\n");
+    FEM_LOG_INFO("  Nodal displacements updated\n");
+    return FEM_SUCCESS;
+}
+
+fem_error_t skyline_ooc_multiply(const double *x, double *y)
+{
+    struct skyline_ooc_store *store = skyline_ooc_store();
+    const int *profile = g_stiffness_profile;
+    const fem_index_t *offsets = g_stiffness_offsets;
+    skyline_ooc_item_t *items;
+    skyline_ooc_reader_t reader;
+    fem_error_t err;
+
+    if (!store || store->total_dof != g_total_dof) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Out-of-core system not assembled");
+    }
+    items = (skyline_ooc_item_t *)fem_malloc((size_t)store->panel_count * sizeof(*items),
+                                             FEM_MEMORY_MATRIX);
+    if (items == NULL) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate out-of-core read list");
+    }
+    for (int p = 0; p < store->panel_count; p++) {
+        items[p].position = skyline_ooc_stiffness_position(store, p);
+        items[p].count = skyline_ooc_panel_size(store, p);
+        items[p].factored = 0;
+    }
+    err = skyline_ooc_reader_start(&reader, store, items, store->panel_count);
+    if (err != FEM_SUCCESS) {
+        fem_free(items);
+        return err;
+    }
+
+    memset(y, 0, (size_t)g_total_dof * sizeof(double));
+    for (int p = 0; p < store->panel_count && err == FEM_SUCCESS; p++) {
+        fem_index_t base = offsets[store->panel_first[p]];
+        const double *block;
+
+        err = skyline_ooc_reader_take(&reader, p, &block);
+        if (err != FEM_SUCCESS) {
+            break;
+        }
+        for (int j = store->panel_first[p]; j < store->panel_first[p + 1]; j++) {
+            const double *column = block + (offsets[j] - base);
+            int top = profile[j];
+            double xj = x[j];
+            double sum = column[j - top] * xj;
+            for (int i = top; i < j; i++) {
+                sum += column[i - top] * x[i];
+                y[i] += column[i - top] * xj;
+            }
+            y[j] += sum;
+        }
+        skyline_ooc_reader_release(&reader, p);
+    }
+
+    skyline_ooc_reader_finish(&reader);
+    fem_free(items);
+    return err;
+}
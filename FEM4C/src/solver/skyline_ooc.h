@@ -0,0 +1,63 @@
+#ifndef SKYLINE_OOC_H
+#define SKYLINE_OOC_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Out-of-core skyline LDL^T solver
+ *
+ * For plane models whose skyline does not fit in memory. The profile is
+ * cut into panels of consecutive columns. Each panel of K is assembled
+ * from the elements that touch it, gets its boundary conditions and is
+ * written to a scratch file, so the full matrix never exists in memory.
+ *
+ * The factorization is the column scheme of skyline_solver.c applied one
+ * panel at a time. A panel is updated by the factored panels its column
+ * tops reach into, then factored within itself and written back to the
+ * factor region of the file. Forward and back substitution stream the
+ * factor panels in order.
+ *
+ * Panels are sized so that four of them fit the memory budget: the panel
+ * being factored, the previous one (kept resident), and two read buffers.
+ * A reader thread fills the read buffers ahead of the computation.
+ *
+ * The result is bitwise identical to skyline_ldlt_factorize() on the
+ * in-core matrix. The store is kept until the next assembly, so a load
+ * change only repeats the substitutions.
+ *
+ * FEM4C_SOLVER=ooc selects this solver for static analysis.
+ * FEM4C_OOC_MEMORY sets the budget: bytes, or a number with a K, M or G
+ * suffix; the default is 256M. FEM4C_OOC_DIR is the directory of the
+ * scratch file; it is unlinked at once and goes away with the process.
+ */
+
+#include "../common/types.h"
+#include <stddef.h>
+
+#define SKYLINE_OOC_DEFAULT_MEMORY ((size_t)256 << 20)
+
+typedef struct {
+    size_t memory_budget;       /* bytes for the panel buffers */
+    const char *directory;      /* scratch file location, NULL = system default */
+} skyline_ooc_options_t;
+
+/* Defaults, overridden by FEM4C_OOC_MEMORY and FEM4C_OOC_DIR */
+skyline_ooc_options_t skyline_ooc_default_options(void);
+
+/* Assemble K and f of a plane model into a new store, applying the
+ * boundary conditions and keeping the constrained rows for the reactions
+ * like assembly_apply_boundary_conditions(). Checks the diagonal. */
+fem_error_t skyline_ooc_assemble(const skyline_ooc_options_t *options);
+
+/* Solve K u = f into g_global_displ and g_node_displ. The first call
+ * after an assembly factorizes; later calls reuse the factor. */
+fem_error_t skyline_ooc_solve_system(void);
+
+/* y = K x with the stored (constrained) stiffness */
+fem_error_t skyline_ooc_multiply(const double *x, double *y);
+
+/* Whether the bound context holds a store */
+int skyline_ooc_active(void);
+
+/* Close and free the store of the bound context */
+void skyline_ooc_release(void);
+
+#endif /* SKYLINE_OOC_H */
@@ -0,0 +1,212 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Skyline LDL^T factorization and solve
+ */
+
+#include "skyline_solver.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include <math.h>
+
+fem_error_t skyline_ldlt_factorize(double *values, int *negative_pivots)
+{
+    const int *profile = g_stiffness_profile;
+    const fem_index_t *offsets = g_stiffness_offsets;
+    int n = g_total_dof;
+    int negative = 0;
+
+    if (!values || !profile || !offsets) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Skyline matrix not initialized");
+    }
+
+    /* Column by column (active column scheme). Entries above the diagonal
+     * first become g(i, j) = a(i, j) - sum L(k, i) g(k, j), then
+     * L(i, j) = g(i, j) / D(i) while D(j) is reduced. Column j stores
+     * row i at offsets[j] + (i - profile[j]). */
+    for (int j = 0; j < n; j++) {
+        int top_j = profile[j];
+        double *column_j = values + offsets[j];
+        double original = column_j[j - top_j];
+
+        for (int i = top_j + 1; i < j; i++) {
+            int top_i = profile[i];
+            const double *column_i = values + offsets[i];
+            int first = top_i > top_j ? top_i : top_j;
+            double sum = 0.0;
+            for (int k = first; k < i; k++) {
+                sum += column_i[k - top_i] * column_j[k - top_j];
+            }
+            column_j[i - top_j] -= sum;
+        }
+
+        double pivot = original;
+        for (int i = top_j; i < j; i++) {
+            double g = column_j[i - top_j];
+            double l = g / values[offsets[i + 1] - 1];
+            pivot -= l * g;
+            column_j[i - top_j] = l;
+        }
+
+        if (pivot == 0.0 || fabs(pivot) <= SKYLINE_PIVOT_TOLERANCE * fabs(original)) {
+            return error_set(FEM_ERROR_SINGULAR_MATRIX,
+                             "Zero pivot at DOF %d in skyline factorization", j + 1);
+        }
+        if (pivot < 0.0) {
+            negative++;
+        }
+        column_j[j - top_j] = pivot;
+    }
+
+    if (negative_pivots) {
+        *negative_pivots = negative;
+    }
+    return FEM_SUCCESS;
+}
+
+void skyline_ldlt_solve(const double *factor, double *x)
+{
+    const int *profile = g_stiffness_profile;
+    const fem_index_t *offsets = g_stiffness_offsets;
+    int n = g_total_dof;
+
+    /* L y = b */
+    for (int j = 0; j < n; j++) {
+        const double *column = factor + offsets[j];
+        int top = profile[j];
+        double sum = 0.0;
+        for (int i = top; i < j; i++) {
+            sum += column[i - top] * x[i];
+        }
+        x[j] -= sum;
+    }
+
+    /* D z = y */
+    for (int j = 0; j < n; j++) {
+        x[j] /= factor[offsets[j + 1] - 1];
+    }
+
+    /* L^T x = z */
+    for (int j = n - 1; j > 0; j--) {
+        const double *column = factor + offsets[j];
+        int top = profile[j];
+        double xj = x[j];
+        for (int i = top; i < j; i++) {
+            x[i] -= column[i - top] * xj;
+        }
+    }
+}
+
+void skyline_ldlt_solve_block(const double *factor, double *x, int ld, int count)
+{
+    const int *profile = g_stiffness_profile;
+    const fem_index_t *offsets = g_stiffness_offsets;
+    int n = g_total_dof;
+
+    /* As skyline_ldlt_solve, with the right-hand sides side by side in
+     * each row so the factor is streamed once for all of them */
+    for (int j = 0; j < n; j++) {
+        const double *column = factor + offsets[j];
+        int top = profile[j];
+        double *xj = x + (size_t)j * ld;
+        for (int i = top; i < j; i++) {
+            double l = column[i - top];
+            const double *xi = x + (size_t)i * ld;
+            for (int k = 0; k < count; k++) {
+                xj[k] -= l * xi[k];
+            }
+        }
+    }
+
+    for (int j = 0; j < n; j++) {
+        double d = factor[offsets[j + 1] - 1];
+        double *xj = x + (size_t)j * ld;
+        for (int k = 0; k < count; k++) {
+            xj[k] /= d;
+        }
+    }
+
+    for (int j = n - 1; j > 0; j--) {
+        const double *column = factor + offsets[j];
+        int top = profile[j];
+        const double *xj = x + (size_t)j * ld;
+        for (int i = top; i < j; i++) {
+            double l = column[i - top];
+            double *xi = x + (size_t)i * ld;
+            for (int k = 0; k < count; k++) {
+                xi[k] -= l * xj[k];
+            }
+        }
+    }
+}
+
+void skyline_constrain(double *values, const unsigned char *constrained)
+{
+    const int *profile = g_stiffness_profile;
+    const fem_index_t *offsets = g_stiffness_offsets;
+    int n = g_total_dof;
+
+    for (int j = 0; j < n; j++) {
+        double *column = values + offsets[j];
+        int top = profile[j];
+        if (constrained[j]) {
+            for (int i = top; i < j; i++) {
+                column[i - top] = 0.0;
+            }
+            column[j - top] = 1.0;
+            continue;
+        }
+        for (int i = top; i < j; i++) {
+            if (constrained[i]) {
+                column[i - top] = 0.0;
+            }
+        }
+    }
+}
+
+void skyline_multiply_add(const double *values, const double *x, double *y)
+{
+    const int *profile = g_stiffness_profile;
+    const fem_index_t *offsets = g_stiffness_offsets;
+    int n = g_total_dof;
+
+    /* Column j contributes its dot product with x to y[j] and, through
+     * symmetry, x[j] times the column to the rows above the diagonal */
+    for (int j = 0; j < n; j++) {
+        const double *column = values + offsets[j];
+        int top = profile[j];
+        double xj = x[j];
+        double sum = column[j - top] * xj;
+        for (int i = top; i < j; i++) {
+            sum += column[i - top] * x[i];
+            y[i] += column[i - top] * xj;
+        }
+        y[j] += sum;
+    }
+}
+
+void skyline_multiply_add_block(const double *values, const double *x, double *y, int ld,
+                                int count)
+{
+    const int *profile = g_stiffness_profile;
+    const fem_index_t *offsets = g_stiffness_offsets;
+    int n = g_total_dof;
+
+    for (int j = 0; j < n; j++) {
+        const double *column = values + offsets[j];
+        int top = profile[j];
+        const double *xj = x + (size_t)j * ld;
+        double *yj = y + (size_t)j * ld;
+        double d = column[j - top];
+        for (int k = 0; k < count; k++) {
+            yj[k] += d * xj[k];
+        }
+        for (int i = top; i < j; i++) {
+            double a = column[i - top];
+            const double *xi = x + (size_t)i * ld;
+            double *yi = y + (size_t)i * ld;
+            for (int k = 0; k < count; k++) {
+                yj[k] += a * xi[k];
+                yi[k] += a * xj[k];
+            }
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef SKYLINE_SOLVER_H
+#define SKYLINE_SOLVER_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Direct solver on the skyline stiffness storage
+ *
+ * LDL^T factorization over the column profile of the global stiffness
+ * (g_stiffness_profile / g_stiffness_offsets). The factor has the same
+ * layout as g_global_stiffness_values: column j holds L(i, j) for rows
+ * profile[j] .. j - 1 and D(j) on the diagonal. Fill-in stays inside the
+ * profile, so a factor can be kept next to the matrix and reused for any
+ * number of right-hand sides.
+ */
+
+#include "../common/types.h"
+
+/* A pivot this small relative to the original diagonal is taken as zero */
+#define SKYLINE_PIVOT_TOLERANCE 1.0e-13
+
+/* Factorize values in place (g_stiffness_value_count entries laid out
+ * like g_global_stiffness_values). Indefinite matrices are accepted; the
+ * number of negative pivots is returned in negative_pivots (may be NULL).
+ * Fails on a zero pivot. */
+fem_error_t skyline_ldlt_factorize(double *values, int *negative_pivots);
+
+/* Solve with a factor from skyline_ldlt_factorize; x holds the right-hand
+ * side on entry and the solution on return */
+void skyline_ldlt_solve(const double *factor, double *x);
+
+/* Solve for count right-hand sides at once. Row i of the block holds
+ * x[i * ld + 0 .. count - 1]; the factor is read once for all of them. */
+void skyline_ldlt_solve_block(const double *factor, double *x, int ld, int count);
+
+/* Replace the rows and columns of the DOFs flagged in constrained by
+ * identity rows, so that a factor returns the right-hand side there */
+void skyline_constrain(double *values, const unsigned char *constrained);
+
+/* y += A x for a symmetric matrix laid out like g_global_stiffness_values */
+void skyline_multiply_add(const double *values, const double *x, double *y);
+
+/* The same for count vectors stored like the blocks of skyline_ldlt_solve_block */
+void skyline_multiply_add_block(const double *values, const double *x, double *y, int ld,
+                                int count);
+
+#endif /* SKYLINE_SOLVER_H */
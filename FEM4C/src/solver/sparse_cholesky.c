@@ -0,0 +1,1103 @@
+/* FEM4C - High Performance Finite Element Method in C
+ * Supernodal sparse Cholesky factorization and solve
+ */
+
+#include "sparse_cholesky.h"
+#include "assembly.h"
+#include "dense_kernels.h"
+#include "ordering.h"
+#include "skyline_solver.h"
+#include "mpc.h"
+#include "../common/constants.h"
+#include "../common/globals.h"
+#include "../common/error.h"
+#include "../common/fem_log.h"
+#include "../common/fem_memory.h"
+#include "../common/fem_thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* OpenMP 3.0 tasks for the elimination tree, 4.5 taskloops in large fronts */
+#if defined(_OPENMP) && _OPENMP >= 200805
+#define SPARSE_CHOLESKY_TASKS 1
+#endif
+#if defined(_OPENMP) && _OPENMP >= 201511
+#define SPARSE_CHOLESKY_TASKLOOP 1
+#endif
+
+/* Columns of a front factored per blocked step */
+#define SPARSE_CHOLESKY_BLOCK 64
+/* Rows or columns per task of a split front update */
+#define SPARSE_CHOLESKY_CHUNK 128
+/* Subtrees below this many flops are factored by a single task */
+#define SPARSE_CHOLESKY_TASK_FLOPS 2.0e6
+/* Front updates above this many flops are split into tasks */
+#define SPARSE_CHOLESKY_SPLIT_FLOPS 4.0e6
+
+struct sparse_cholesky_factor {
+    int total_dof;
+    int dof_per_node;
+    int node_count;
+    int *perm;                      /* node placed k-th */
+    int *inverse;                   /* place of each node */
+    /* Node graph of K: neighbours of node v without v itself */
+    fem_index_t *graph_offsets;
+    int *graph_adjacency;
+    fem_index_t *graph_blocks;      /* solids: block (v, neighbour) in g_block_values */
+    int supernode_count;
+    int *first;                     /* supernode s: places [first[s], first[s + 1]) */
+    int *parent;                    /* -1 at the roots */
+    int *child_offsets;
+    int *children;                  /* ascending */
+    int *descendant;                /* subtree of s: supernodes [descendant[s], s] */
+    fem_index_t *row_offsets;
+    int *rows;                      /* places of the rows of s: its own first, ascending */
+    size_t *factor_offsets;         /* rows x columns of L per supernode, column-major */
+    double *subtree_flops;
+    double flops;
+    double *factor;
+    double *work;                   /* permuted right-hand side */
+    int factored;
+};
+
+/* State shared by the tasks of one numeric factorization */
+typedef struct {
+    struct sparse_cholesky_factor *factor;
+    /* K of the bound context. The tasks run on OpenMP threads that are not
+     * bound to it, so they read the matrix through these, never through
+     * g_fem_context. */
+    const double (*block_values)[9];
+    const fem_index_t *block_diagonal;
+    const int *profile;
+    const fem_index_t *offsets;
+    const double *values;
+    double **updates;               /* Schur complement of a supernode until its parent takes it */
+    int stopped;
+    int failed_dof;                 /* lowest DOF with a bad pivot, -1 if none */
+    int out_of_memory;
+} sparse_cholesky_numeric_t;
+
+static void sparse_cholesky_free(struct sparse_cholesky_factor *f)
+{
+    if (f == NULL) {
+        return;
+    }
+    fem_free(f->perm);
+    fem_free(f->inverse);
+    fem_free(f->graph_offsets);
+    fem_free(f->graph_adjacency);
+    fem_free(f->graph_blocks);
+    fem_free(f->first);
+    fem_free(f->parent);
+    fem_free(f->child_offsets);
+    fem_free(f->children);
+    fem_free(f->descendant);
+    fem_free(f->row_offsets);
+    fem_free(f->rows);
+    fem_free(f->factor_offsets);
+    fem_free(f->subtree_flops);
+    fem_free(f->factor);
+    fem_free(f->work);
+    free(f);
+}
+
+int sparse_cholesky_active(void)
+{
+    return g_fem_context->sparse_cholesky != NULL;
+}
+
+void sparse_cholesky_release(void)
+{
+    sparse_cholesky_free(g_fem_context->sparse_cholesky);
+    g_fem_context->sparse_cholesky = NULL;
+}
+
+static int sparse_cholesky_compare_int(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/* Solids: the node pattern of the block matrix */
+static fem_error_t sparse_cholesky_block_graph(struct sparse_cholesky_factor *f)
+{
+    int n = f->node_count;
+    fem_index_t count = 0;
+
+    f->graph_offsets = (fem_index_t *)fem_malloc(((size_t)n + 1) * sizeof(fem_index_t),
+                                                 FEM_MEMORY_MATRIX);
+    CHECK_NULL(f->graph_offsets, "Failed to allocate node graph");
+    for (int v = 0; v < n; v++) {
+        f->graph_offsets[v] = count;
+        for (fem_index_t b = g_block_row_offsets[v]; b < g_block_row_offsets[v + 1]; b++) {
+            if (g_block_columns[b] != v) {
+                count++;
+            }
+        }
+    }
+    f->graph_offsets[n] = count;
+
+    f->graph_adjacency = (int *)fem_malloc((size_t)count * sizeof(int) + 1, FEM_MEMORY_MATRIX);
+    f->graph_blocks = (fem_index_t *)fem_malloc((size_t)count * sizeof(fem_index_t) + 1,
+                                                FEM_MEMORY_MATRIX);
+    CHECK_NULL(f->graph_adjacency, "Failed to allocate node graph");
+    CHECK_NULL(f->graph_blocks, "Failed to allocate node graph");
+    count = 0;
+    for (int v = 0; v < n; v++) {
+        for (fem_index_t b = g_block_row_offsets[v]; b < g_block_row_offsets[v + 1]; b++) {
+            if (g_block_columns[b] != v) {
+                f->graph_adjacency[count] = g_block_columns[b];
+                f->graph_blocks[count] = b;
+                count++;
+            }
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+/* Distinct nodes of an element after the multipoint constraints */
+static fem_error_t sparse_cholesky_element_nodes(int element, int *dofs, int capacity,
+                                                 int *nodes, int *node_count)
+{
+    int element_dofs[T6_TOTAL_DOF];
+    int dof_count = 0;
+    const int *list = element_dofs;
+    fem_error_t err;
+
+    err = assembly_collect_element_dofs(element, element_dofs, &dof_count);
+    CHECK_ERROR(err);
+    if (mpc_active()) {
+        dof_count = mpc_expand_dofs(element_dofs, dof_count, dofs, capacity);
+        list = dofs;
+    }
+
+    *node_count = 0;
+    for (int i = 0; i < dof_count; i++) {
+        if (list[i] < 0 || list[i] >= g_total_dof) {
+            continue;
+        }
+        int node = list[i] / g_dof_per_node;
+        int seen = 0;
+        for (int k = 0; k < *node_count; k++) {
+            if (nodes[k] == node) {
+                seen = 1;
+                break;
+            }
+        }
+        if (!seen) {
+            nodes[(*node_count)++] = node;
+        }
+    }
+    return FEM_SUCCESS;
+}
+
+/* Plane models: the node graph of the elements, as the skyline profile */
+static fem_error_t sparse_cholesky_element_graph(struct sparse_cholesky_factor *f)
+{
+    int n = f->node_count;
+    int capacity = T6_TOTAL_DOF * (g_mpc_max_terms > 1 ? g_mpc_max_terms : 1);
+    int *dofs = (int *)fem_malloc(2 * (size_t)capacity * sizeof(int), FEM_MEMORY_MATRIX);
+    int *nodes = dofs + capacity;
+    fem_index_t *cursor = (fem_index_t *)fem_calloc((size_t)n + 1, sizeof(fem_index_t),
+                                                    FEM_MEMORY_MATRIX);
+    fem_index_t *offsets = (fem_index_t *)fem_calloc((size_t)n + 1, sizeof(fem_index_t),
+                                                     FEM_MEMORY_MATRIX);
+    fem_error_t err = FEM_SUCCESS;
+
+    f->graph_offsets = offsets;
+    if (!dofs || !cursor || !offsets) {
+        err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate node graph");
+        goto cleanup;
+    }
+
+    /* Pairs counted first, then filled; duplicates removed per node */
+    for (int pass = 0; pass < 2; pass++) {
+        for (int e = 0; e < g_num_elements; e++) {
+            int count;
+            err = sparse_cholesky_element_nodes(e, dofs, capacity, nodes, &count);
+            if (err != FEM_SUCCESS) {
+                goto cleanup;
+            }
+            for (int a = 0; a < count; a++) {
+                for (int b = 0; b < count; b++) {
+                    if (a == b) {
+                        continue;
+                    }
+                    if (pass == 0) {
+                        offsets[nodes[a] + 1]++;
+                    } else {
+                        f->graph_adjacency[cursor[nodes[a]]++] = nodes[b];
+                    }
+                }
+            }
+        }
+        if (pass == 0) {
+            for (int v = 0; v < n; v++) {
+                offsets[v + 1] += offsets[v];
+            }
+            memcpy(cursor, offsets, (size_t)n * sizeof(fem_index_t));
+            f->graph_adjacency = (int *)fem_malloc((size_t)offsets[n] * sizeof(int) + 1,
+                                                   FEM_MEMORY_MATRIX);
+            if (!f->graph_adjacency) {
+                err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate node graph");
+                goto cleanup;
+            }
+        }
+    }
+
+    fem_index_t start = 0;
+    fem_index_t write = 0;
+    for (int v = 0; v < n; v++) {
+        fem_index_t end = offsets[v + 1];
+        qsort(f->graph_adjacency + start, (size_t)(end - start), sizeof(int),
+              sparse_cholesky_compare_int);
+        offsets[v] = write;
+        for (fem_index_t e = start; e < end; e++) {
+            if (e == start || f->graph_adjacency[e] != f->graph_adjacency[e - 1]) {
+                f->graph_adjacency[write++] = f->graph_adjacency[e];
+            }
+        }
+        start = end;
+    }
+    offsets[n] = write;
+
+cleanup:
+    fem_free(dofs);
+    fem_free(cursor);
+    return err;
+}
+
+/* Explicit zeros a merged supernode of this many columns may carry, as a
+ * fraction of its entries */
+static double sparse_cholesky_relax_limit(int columns)
+{
+    if (columns <= 16) {
+        return 0.5;
+    }
+    if (columns <= 48) {
+        return 0.1;
+    }
+    return 0.05;
+}
+
+/* Entries of a supernode of width columns and rows rows, node level */
+static double sparse_cholesky_entries(double width, double rows)
+{
+    return width * (width + 1.0) / 2.0 + width * (rows - width);
+}
+
+/* Ordering, elimination tree, supernodes and their row structures */
+static fem_error_t sparse_cholesky_symbolic(struct sparse_cholesky_factor *f)
+{
+    int n = f->node_count;
+    int dpn = f->dof_per_node;
+    const fem_index_t *offsets = f->graph_offsets;
+    const int *adjacency = f->graph_adjacency;
+    int *block = (int *)fem_malloc(9 * (size_t)n * sizeof(int), FEM_MEMORY_MATRIX);
+    double *zeros = (double *)fem_malloc((size_t)n * sizeof(double), FEM_MEMORY_MATRIX);
+    fem_error_t err = FEM_SUCCESS;
+    int ns = 0;
+
+    f->perm = (int *)fem_malloc((size_t)n * sizeof(int), FEM_MEMORY_MATRIX);
+    f->inverse = (int *)fem_malloc((size_t)n * sizeof(int), FEM_MEMORY_MATRIX);
+    if (!block || !zeros || !f->perm || !f->inverse) {
+        err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate sparse Cholesky analysis");
+        goto cleanup;
+    }
+    int *order = block;
+    int *place = block + (size_t)n;
+    int *parent = block + 2 * (size_t)n;
+    int *ancestor = block + 3 * (size_t)n;
+    int *head = block + 4 * (size_t)n;
+    int *next = block + 5 * (size_t)n;
+    int *stack = block + 6 * (size_t)n;
+    int *counts = block + 7 * (size_t)n;
+    int *mark = block + 8 * (size_t)n;
+
+    err = ordering_nested_dissection(n, offsets, adjacency, order);
+    if (err != FEM_SUCCESS) {
+        goto cleanup;
+    }
+    for (int k = 0; k < n; k++) {
+        place[order[k]] = k;
+    }
+
+    /* Elimination tree (Liu), with path compression through ancestor */
+    for (int j = 0; j < n; j++) {
+        int v = order[j];
+        parent[j] = -1;
+        ancestor[j] = -1;
+        for (fem_index_t e = offsets[v]; e < offsets[v + 1]; e++) {
+            int r = place[adjacency[e]];
+            if (r >= j) {
+                continue;
+            }
+            while (ancestor[r] != -1 && ancestor[r] != j) {
+                int up = ancestor[r];
+                ancestor[r] = j;
+                r = up;
+            }
+            if (ancestor[r] == -1) {
+                ancestor[r] = j;
+                parent[r] = j;
+            }
+        }
+    }
+
+    /* Postorder, children in ascending order, so that every subtree is a
+     * contiguous range ending at its root */
+    for (int j = 0; j < n; j++) {
+        head[j] = -1;
+    }
+    for (int j = n - 1; j >= 0; j--) {
+        if (parent[j] >= 0) {
+            next[j] = head[parent[j]];
+            head[parent[j]] = j;
+        }
+    }
+    int placed = 0;
+    for (int root = 0; root < n; root++) {
+        int top = 0;
+        if (parent[root] >= 0) {
+            continue;
+        }
+        stack[top++] = root;
+        while (top > 0) {
+            int v = stack[top - 1];
+            if (head[v] >= 0) {
+                int child = head[v];
+                head[v] = next[child];
+                stack[top++] = child;
+            } else {
+                top--;
+                f->perm[placed] = order[v];
+                ancestor[v] = placed;       /* new place of v */
+                placed++;
+            }
+        }
+    }
+    for (int k = 0; k < n; k++) {
+        f->inverse[f->perm[k]] = k;
+    }
+    int *tree = next;                        /* parents in the final places */
+    for (int j = 0; j < n; j++) {
+        tree[ancestor[j]] = parent[j] >= 0 ? ancestor[parent[j]] : -1;
+    }
+
+    /* Column counts: row i of L reaches from each neighbour k < i up the
+     * tree to i */
+    for (int i = 0; i < n; i++) {
+        counts[i] = 0;
+        head[i] = 0;                         /* children */
+    }
+    for (int i = 0; i < n; i++) {
+        int v = f->perm[i];
+        mark[i] = i;
+        counts[i]++;
+        for (fem_index_t e = offsets[v]; e < offsets[v + 1]; e++) {
+            int x = f->inverse[adjacency[e]];
+            if (x >= i) {
+                continue;
+            }
+            while (mark[x] != i) {
+                counts[x]++;
+                mark[x] = i;
+                x = tree[x];
+            }
+        }
+        if (tree[i] >= 0) {
+            head[tree[i]]++;
+        }
+    }
+
+    /* Fundamental supernodes: j continues the supernode of j - 1 when j - 1
+     * is its only child and their columns nest. Amalgamated with the
+     * previous supernode when that is a child and few zeros are added. */
+    int *start = order;                      /* reused: first place of supernode s */
+    int *width = place;
+    int *rows = parent;
+    for (int j = 0; j < n; j++) {
+        if (j > 0 && tree[j - 1] == j && head[j] == 1 && counts[j - 1] == counts[j] + 1) {
+            width[ns - 1]++;
+            continue;
+        }
+        start[ns] = j;
+        width[ns] = 1;
+        rows[ns] = counts[j];
+        zeros[ns] = 0.0;
+        ns++;
+    }
+    int merged = 0;
+    for (int t = 0; t < ns; t++) {
+        if (merged > 0) {
+            int s = merged - 1;
+            int last = start[t] - 1;
+            if (tree[last] >= start[t] && tree[last] < start[t] + width[t]) {
+                double combined_width = width[s] + width[t];
+                double combined_rows = width[s] + rows[t];
+                double entries = sparse_cholesky_entries(combined_width, combined_rows);
+                double added = entries - sparse_cholesky_entries(width[s], rows[s]) + zeros[s]
+                             - sparse_cholesky_entries(width[t], rows[t]);
+                if (added <= sparse_cholesky_relax_limit((int)combined_width * dpn) * entries) {
+                    width[s] += width[t];
+                    rows[s] = width[s] - width[t] + rows[t];
+                    zeros[s] = added;
+                    continue;
+                }
+            }
+        }
+        start[merged] = start[t];
+        width[merged] = width[t];
+        rows[merged] = rows[t];
+        zeros[merged] = zeros[t];
+        merged++;
+    }
+    ns = merged;
+    f->supernode_count = ns;
+
+    f->first = (int *)fem_malloc(((size_t)ns + 1) * sizeof(int), FEM_MEMORY_MATRIX);
+    f->parent = (int *)fem_malloc((size_t)ns * sizeof(int), FEM_MEMORY_MATRIX);
+    f->child_offsets = (int *)fem_calloc((size_t)ns + 1, sizeof(int), FEM_MEMORY_MATRIX);
+    f->children = (int *)fem_malloc((size_t)ns * sizeof(int), FEM_MEMORY_MATRIX);
+    f->descendant = (int *)fem_malloc((size_t)ns * sizeof(int), FEM_MEMORY_MATRIX);
+    f->row_offsets = (fem_index_t *)fem_malloc(((size_t)ns + 1) * sizeof(fem_index_t),
+                                               FEM_MEMORY_MATRIX);
+    f->factor_offsets = (size_t *)fem_malloc(((size_t)ns + 1) * sizeof(size_t), FEM_MEMORY_MATRIX);
+    f->subtree_flops = (double *)fem_calloc((size_t)ns, sizeof(double), FEM_MEMORY_MATRIX);
+    if (!f->first || !f->parent || !f->child_offsets || !f->children || !f->descendant ||
+        !f->row_offsets || !f->factor_offsets || !f->subtree_flops) {
+        err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate supernodes");
+        goto cleanup;
+    }
+
+    int *supernode_of = counts;              /* reused */
+    for (int s = 0; s < ns; s++) {
+        f->first[s] = start[s];
+        for (int j = start[s]; j < start[s] + width[s]; j++) {
+            supernode_of[j] = s;
+        }
+    }
+    f->first[ns] = n;
+    for (int s = 0; s < ns; s++) {
+        int up = tree[f->first[s + 1] - 1];
+        f->parent[s] = up >= 0 ? supernode_of[up] : -1;
+        f->descendant[s] = s;
+        if (f->parent[s] >= 0) {
+            f->child_offsets[f->parent[s] + 1]++;
+        }
+    }
+    for (int s = 0; s < ns; s++) {
+        f->child_offsets[s + 1] += f->child_offsets[s];
+    }
+    memcpy(head, f->child_offsets, (size_t)ns * sizeof(int));
+    for (int s = 0; s < ns; s++) {
+        int p = f->parent[s];
+        if (p >= 0) {
+            f->children[head[p]++] = s;
+            if (f->descendant[s] < f->descendant[p]) {
+                f->descendant[p] = f->descendant[s];
+            }
+        }
+    }
+
+    /* Row structure: the own places, the neighbours beyond them, and the
+     * rows the children pass on */
+    fem_index_t capacity = (fem_index_t)n + 1;
+    fem_index_t filled = 0;
+    f->rows = (int *)fem_malloc((size_t)capacity * sizeof(int), FEM_MEMORY_MATRIX);
+    if (!f->rows) {
+        err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate supernode rows");
+        goto cleanup;
+    }
+    for (int i = 0; i < n; i++) {
+        mark[i] = -1;
+    }
+    for (int s = 0; s < ns; s++) {
+        int first = f->first[s];
+        int last = f->first[s + 1] - 1;
+        fem_index_t need = filled + (fem_index_t)(n - first);
+        if (need > capacity) {
+            fem_index_t grown = capacity * 2 > need ? capacity * 2 : need;
+            int *larger = (int *)fem_realloc(f->rows, (size_t)grown * sizeof(int),
+                                             FEM_MEMORY_MATRIX);
+            if (!larger) {
+                err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate supernode rows");
+                goto cleanup;
+            }
+            f->rows = larger;
+            capacity = grown;
+        }
+        f->row_offsets[s] = filled;
+        for (int j = first; j <= last; j++) {
+            f->rows[filled++] = j;
+        }
+        fem_index_t beyond = filled;
+        for (int j = first; j <= last; j++) {
+            int v = f->perm[j];
+            for (fem_index_t e = offsets[v]; e < offsets[v + 1]; e++) {
+                int i = f->inverse[adjacency[e]];
+                if (i > last && mark[i] != s) {
+                    mark[i] = s;
+                    f->rows[filled++] = i;
+                }
+            }
+        }
+        for (int c = f->child_offsets[s]; c < f->child_offsets[s + 1]; c++) {
+            int child = f->children[c];
+            fem_index_t from = f->row_offsets[child] + (f->first[child + 1] - f->first[child]);
+            for (fem_index_t r = from; r < f->row_offsets[child + 1]; r++) {
+                int i = f->rows[r];
+                if (i > last && mark[i] != s) {
+                    mark[i] = s;
+                    f->rows[filled++] = i;
+                }
+            }
+        }
+        qsort(f->rows + beyond, (size_t)(filled - beyond), sizeof(int),
+              sparse_cholesky_compare_int);
+        /* row_offsets[s + 1] is set by the next supernode */
+        f->row_offsets[s + 1] = filled;
+    }
+    if (filled < capacity) {
+        int *fitted = (int *)fem_realloc(f->rows, (size_t)filled * sizeof(int) + 1,
+                                         FEM_MEMORY_MATRIX);
+        if (fitted) {
+            f->rows = fitted;
+        }
+    }
+
+    /* Factor layout and operation counts: a column with c entries costs
+     * about c^2 flops */
+    f->factor_offsets[0] = 0;
+    f->flops = 0.0;
+    for (int s = 0; s < ns; s++) {
+        double m = (double)(f->row_offsets[s + 1] - f->row_offsets[s]) * dpn;
+        double k = (double)(f->first[s + 1] - f->first[s]) * dpn;
+        double low = m - k;
+        double flops = (m * (m + 1.0) * (2.0 * m + 1.0) - low * (low + 1.0) * (2.0 * low + 1.0))
+                     / 6.0;
+        f->factor_offsets[s + 1] = f->factor_offsets[s] + (size_t)m * (size_t)k;
+        f->flops += flops;
+        f->subtree_flops[s] += flops;
+        if (f->parent[s] >= 0) {
+            f->subtree_flops[f->parent[s]] += f->subtree_flops[s];
+        }
+    }
+
+cleanup:
+    fem_free(block);
+    fem_free(zeros);
+    return err;
+}
+
+/* Entries and flops of the skyline LDL^T in the input numbering, for the report */
+static void sparse_cholesky_skyline_cost(const struct sparse_cholesky_factor *f, double *entries,
+                                         double *flops)
+{
+    int dpn = f->dof_per_node;
+
+    *entries = 0.0;
+    *flops = 0.0;
+    for (int v = 0; v < f->node_count; v++) {
+        int top = v;
+        for (fem_index_t e = f->graph_offsets[v]; e < f->graph_offsets[v + 1]; e++) {
+            if (f->graph_adjacency[e] < top) {
+                top = f->graph_adjacency[e];
+            }
+        }
+        for (int a = 0; a < dpn; a++) {
+            double height = (double)(v * dpn + a - top * dpn + 1);
+            *entries += height;
+            *flops += height * height;
+        }
+    }
+}
+
+fem_error_t sparse_cholesky_analyze(void)
+{
+    struct sparse_cholesky_factor *f;
+    double start = fem_wall_time();
+    fem_error_t err;
+
+    sparse_cholesky_release();
+    if (g_total_dof <= 0) {
+        return FEM_SUCCESS;
+    }
+    if (g_total_dof != g_num_nodes * g_dof_per_node) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Sparse Cholesky needs %d DOF per node",
+                         g_dof_per_node);
+    }
+
+    f = (struct sparse_cholesky_factor *)calloc(1, sizeof(*f));
+    if (f == NULL) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate sparse Cholesky factor");
+    }
+    f->total_dof = g_total_dof;
+    f->dof_per_node = g_dof_per_node;
+    f->node_count = g_num_nodes;
+
+    FEM_LOG_INFO("Ordering and analysing the sparse Cholesky factor...\n");
+    err = f->dof_per_node == 3 ? sparse_cholesky_block_graph(f) : sparse_cholesky_element_graph(f);
+    if (err == FEM_SUCCESS) {
+        err = sparse_cholesky_symbolic(f);
+    }
+    if (err == FEM_SUCCESS) {
+        f->work = (double *)fem_malloc((size_t)f->total_dof * sizeof(double), FEM_MEMORY_VECTOR);
+        if (f->work == NULL) {
+            err = error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate sparse Cholesky vector");
+        }
+    }
+    if (err != FEM_SUCCESS) {
+        sparse_cholesky_free(f);
+        return err;
+    }
+    g_fem_context->sparse_cholesky = f;
+
+    int largest = 0;
+    double entries = 0.0;
+    for (int s = 0; s < f->supernode_count; s++) {
+        int m = (int)(f->row_offsets[s + 1] - f->row_offsets[s]) * f->dof_per_node;
+        double k = (double)(f->first[s + 1] - f->first[s]) * f->dof_per_node;
+        entries += k * (k + 1.0) / 2.0 + k * (m - k);
+        if (m > largest) {
+            largest = m;
+        }
+    }
+    double skyline_entries;
+    double skyline_flops;
+    sparse_cholesky_skyline_cost(f, &skyline_entries, &skyline_flops);
+    printf("    Sparse Cholesky: %d supernodes, largest front %d, analysis %.3f s\n",
+           f->supernode_count, largest, fem_wall_time() - start);
+    printf("    Factor: %.0f entries, %.3f GFlop (skyline profile: %.0f entries, %.3f GFlop)\n",
+           entries, f->flops * 1.0e-9, skyline_entries, skyline_flops * 1.0e-9);
+    return FEM_SUCCESS;
+}
+
+static int sparse_cholesky_stopped(sparse_cholesky_numeric_t *numeric)
+{
+    int stopped;
+#ifdef _OPENMP
+    #pragma omp critical(sparse_cholesky_stop)
+#endif
+    stopped = numeric->stopped;
+    return stopped;
+}
+
+/* Stop on a bad pivot (dof >= 0) or a failed allocation (dof < 0) */
+static void sparse_cholesky_stop(sparse_cholesky_numeric_t *numeric, int dof)
+{
+#ifdef _OPENMP
+    #pragma omp critical(sparse_cholesky_stop)
+#endif
+    {
+        if (dof < 0) {
+            numeric->out_of_memory = 1;
+        } else if (numeric->failed_dof < 0 || dof < numeric->failed_dof) {
+            numeric->failed_dof = dof;
+        }
+        numeric->stopped = 1;
+    }
+}
+
+/* K(dpn * row + a, dpn * column + b) into block[b * dpn + a]. Solids read
+ * block `position`, which holds (column, row) or the diagonal; plane
+ * models read the skyline. */
+static void sparse_cholesky_fetch(const sparse_cholesky_numeric_t *numeric, int dpn, int row,
+                                  int column, fem_index_t position, double *block)
+{
+    if (dpn == 3) {
+        memcpy(block, numeric->block_values[position], 9 * sizeof(double));
+        return;
+    }
+    for (int b = 0; b < dpn; b++) {
+        for (int a = 0; a < dpn; a++) {
+            int i = row * dpn + a;
+            int j = column * dpn + b;
+            if (i > j) {
+                int swap = i;
+                i = j;
+                j = swap;
+            }
+            int top = numeric->profile[j];
+            block[b * dpn + a] = i < top ? 0.0 : numeric->values[numeric->offsets[j] + (i - top)];
+        }
+    }
+}
+
+/* Index of place in the ascending list, -1 if absent */
+static int sparse_cholesky_find(const int *list, int count, int place)
+{
+    int lo = 0;
+    int hi = count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (list[mid] < place) {
+            lo = mid + 1;
+        } else if (list[mid] > place) {
+            hi = mid - 1;
+        } else {
+            return mid;
+        }
+    }
+    return -1;
+}
+
+/* Columns [b0, b0 + nb) of the front are factored: the rows below them
+ * and the trailing lower triangle are updated. Large updates are split
+ * into tasks over row and column chunks. */
+static void sparse_cholesky_panel(double *front, int m, int b0, int nb)
+{
+    int start = b0 + nb;
+    int below = m - start;
+    const double *diagonal = front + b0 + (size_t)b0 * m;
+    double *panel = front + start + (size_t)b0 * m;
+
+    if (below <= 0) {
+        return;
+    }
+    int chunks = (below + SPARSE_CHOLESKY_CHUNK - 1) / SPARSE_CHOLESKY_CHUNK;
+#ifdef SPARSE_CHOLESKY_TASKLOOP
+    int split = (double)below * below * nb >= SPARSE_CHOLESKY_SPLIT_FLOPS;
+    #pragma omp taskloop grainsize(1) if (split)
+#endif
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        int r0 = chunk * SPARSE_CHOLESKY_CHUNK;
+        int count = below - r0 < SPARSE_CHOLESKY_CHUNK ? below - r0 : SPARSE_CHOLESKY_CHUNK;
+        dense_trsm_right_lower_transpose(count, nb, diagonal, m, panel + r0, m);
+    }
+
+#ifdef SPARSE_CHOLESKY_TASKLOOP
+    #pragma omp taskloop grainsize(1) if (split)
+#endif
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        int c0 = start + chunk * SPARSE_CHOLESKY_CHUNK;
+        int count = m - c0 < SPARSE_CHOLESKY_CHUNK ? m - c0 : SPARSE_CHOLESKY_CHUNK;
+        int rest = m - c0 - count;
+        const double *source = front + c0 + (size_t)b0 * m;
+        double *target = front + c0 + (size_t)c0 * m;
+        dense_syrk_lower_subtract(count, nb, source, m, target, m);
+        if (rest > 0) {
+            dense_gemm_nt_subtract(rest, count, nb, source + count, m, source, m, target + count,
+                                   m);
+        }
+    }
+}
+
+/* Assemble, factor and pass on the front of supernode s */
+static void sparse_cholesky_front(sparse_cholesky_numeric_t *numeric, int s)
+{
+    struct sparse_cholesky_factor *f = numeric->factor;
+    int dpn = f->dof_per_node;
+    int first = f->first[s];
+    int width = f->first[s + 1] - first;
+    const int *rows = f->rows + f->row_offsets[s];
+    int row_count = (int)(f->row_offsets[s + 1] - f->row_offsets[s]);
+    int m = row_count * dpn;
+    int k = width * dpn;
+    double *front = NULL;
+    double *reference = NULL;
+    int *map = NULL;
+    double block[MAX_DOF_PER_NODE * MAX_DOF_PER_NODE];
+
+    if (sparse_cholesky_stopped(numeric)) {
+        return;
+    }
+    front = (double *)fem_calloc((size_t)m * m, sizeof(double), FEM_MEMORY_MATRIX);
+    reference = (double *)fem_malloc((size_t)k * sizeof(double), FEM_MEMORY_MATRIX);
+    map = (int *)fem_malloc((size_t)m * sizeof(int), FEM_MEMORY_MATRIX);
+    if (!front || !reference || !map) {
+        sparse_cholesky_stop(numeric, -1);
+        goto cleanup;
+    }
+
+    /* Lower triangle of K in the columns of the supernode */
+    for (int j = first; j < first + width; j++) {
+        int v = f->perm[j];
+        int column = (j - first) * dpn;
+        sparse_cholesky_fetch(numeric, dpn, v, v, dpn == 3 ? numeric->block_diagonal[v] : 0, block);
+        for (int b = 0; b < dpn; b++) {
+            for (int a = b; a < dpn; a++) {
+                front[column + a + (size_t)(column + b) * m] = block[b * dpn + a];
+            }
+        }
+        for (fem_index_t e = f->graph_offsets[v]; e < f->graph_offsets[v + 1]; e++) {
+            int i = f->inverse[f->graph_adjacency[e]];
+            if (i < j) {
+                continue;
+            }
+            int position = i < first + width
+                         ? i - first
+                         : width + sparse_cholesky_find(rows + width, row_count - width, i);
+            int row = position * dpn;
+            sparse_cholesky_fetch(numeric, dpn, f->graph_adjacency[e], v,
+                                  f->graph_blocks ? f->graph_blocks[e] : 0, block);
+            for (int b = 0; b < dpn; b++) {
+                for (int a = 0; a < dpn; a++) {
+                    front[row + a + (size_t)(column + b) * m] = block[b * dpn + a];
+                }
+            }
+        }
+    }
+    for (int c = 0; c < k; c++) {
+        reference[c] = front[c + (size_t)c * m];
+    }
+
+    /* Update matrices of the children, always in the same order */
+    for (int c = f->child_offsets[s]; c < f->child_offsets[s + 1]; c++) {
+        int child = f->children[c];
+        double *update = numeric->updates[child];
+        int child_width = f->first[child + 1] - f->first[child];
+        const int *child_rows = f->rows + f->row_offsets[child] + child_width;
+        int count = (int)(f->row_offsets[child + 1] - f->row_offsets[child]) - child_width;
+        int size = count * dpn;
+        int p = 0;
+
+        if (update == NULL) {
+            continue;
+        }
+        for (int r = 0; r < count; r++) {
+            while (rows[p] != child_rows[r]) {
+                p++;
+            }
+            for (int a = 0; a < dpn; a++) {
+                map[r * dpn + a] = p * dpn + a;
+            }
+        }
+        for (int q = 0; q < size; q++) {
+            const double *source = update + (size_t)q * size;
+            double *target = front + (size_t)map[q] * m;
+            for (int r = q; r < size; r++) {
+                target[map[r]] += source[r];
+            }
+        }
+        fem_free(update);
+        numeric->updates[child] = NULL;
+    }
+
+    /* Blocked right-looking factorization of the own columns; what is
+     * left in the trailing block is the update matrix */
+    for (int b0 = 0; b0 < k; b0 += SPARSE_CHOLESKY_BLOCK) {
+        int nb = k - b0 < SPARSE_CHOLESKY_BLOCK ? k - b0 : SPARSE_CHOLESKY_BLOCK;
+        int bad = dense_cholesky(front + b0 + (size_t)b0 * m, nb, m, reference + b0,
+                                 SKYLINE_PIVOT_TOLERANCE);
+        if (bad >= 0) {
+            int local = b0 + bad;
+            sparse_cholesky_stop(numeric, f->perm[first + local / dpn] * dpn + local % dpn);
+            goto cleanup;
+        }
+        sparse_cholesky_panel(front, m, b0, nb);
+    }
+
+    memcpy(f->factor + f->factor_offsets[s], front, (size_t)m * k * sizeof(double));
+    if (f->parent[s] >= 0 && m > k) {
+        int size = m - k;
+        double *update = (double *)fem_malloc((size_t)size * size * sizeof(double),
+                                              FEM_MEMORY_MATRIX);
+        if (update == NULL) {
+            sparse_cholesky_stop(numeric, -1);
+            goto cleanup;
+        }
+        for (int q = 0; q < size; q++) {
+            memcpy(update + (size_t)q * size + q, front + k + q + (size_t)(k + q) * m,
+                   (size_t)(size - q) * sizeof(double));
+        }
+        numeric->updates[s] = update;
+    }
+
+cleanup:
+    fem_free(front);
+    fem_free(reference);
+    fem_free(map);
+}
+
+#ifdef SPARSE_CHOLESKY_TASKS
+/* Factor the subtree of s: children as tasks when it is worth it,
+ * otherwise the contiguous range of the subtree in order */
+static void sparse_cholesky_subtree(sparse_cholesky_numeric_t *numeric, int s)
+{
+    const struct sparse_cholesky_factor *f = numeric->factor;
+
+    if (f->subtree_flops[s] >= SPARSE_CHOLESKY_TASK_FLOPS &&
+        f->child_offsets[s + 1] > f->child_offsets[s]) {
+        for (int c = f->child_offsets[s]; c < f->child_offsets[s + 1]; c++) {
+            int child = f->children[c];
+            #pragma omp task firstprivate(child)
+            sparse_cholesky_subtree(numeric, child);
+        }
+        #pragma omp taskwait
+        sparse_cholesky_front(numeric, s);
+        return;
+    }
+    for (int t = f->descendant[s]; t <= s; t++) {
+        sparse_cholesky_front(numeric, t);
+    }
+}
+#endif
+
+static fem_error_t sparse_cholesky_factorize(struct sparse_cholesky_factor *f)
+{
+    sparse_cholesky_numeric_t numeric;
+    int ns = f->supernode_count;
+    int threads = 1;
+    double start = fem_wall_time();
+
+    if (f->factor == NULL) {
+        f->factor = (double *)fem_malloc(f->factor_offsets[ns] * sizeof(double) + 1,
+                                         FEM_MEMORY_MATRIX);
+        CHECK_NULL(f->factor, "Failed to allocate sparse Cholesky factor");
+    }
+    numeric.factor = f;
+    numeric.block_values = (const double (*)[9])g_block_values;
+    numeric.block_diagonal = g_block_diagonal;
+    numeric.profile = g_stiffness_profile;
+    numeric.offsets = g_stiffness_offsets;
+    numeric.values = g_global_stiffness_values;
+    numeric.updates = (double **)fem_calloc((size_t)ns + 1, sizeof(double *), FEM_MEMORY_MATRIX);
+    numeric.stopped = 0;
+    numeric.failed_dof = -1;
+    numeric.out_of_memory = 0;
+    CHECK_NULL(numeric.updates, "Failed to allocate sparse Cholesky updates");
+
+#ifdef SPARSE_CHOLESKY_TASKS
+    threads = omp_get_max_threads();
+    #pragma omp parallel
+    #pragma omp single
+    {
+        for (int s = 0; s < ns; s++) {
+            if (f->parent[s] < 0) {
+                #pragma omp task firstprivate(s)
+                sparse_cholesky_subtree(&numeric, s);
+            }
+        }
+        #pragma omp taskwait
+    }
+#else
+    for (int s = 0; s < ns; s++) {
+        sparse_cholesky_front(&numeric, s);
+    }
+#endif
+
+    for (int s = 0; s < ns; s++) {
+        fem_free(numeric.updates[s]);
+    }
+    fem_free(numeric.updates);
+
+    if (numeric.out_of_memory) {
+        return error_set(FEM_ERROR_MEMORY_ALLOCATION, "Failed to allocate a frontal matrix");
+    }
+    if (numeric.failed_dof >= 0) {
+        return error_set(FEM_ERROR_SINGULAR_MATRIX,
+                         "Non-positive pivot at DOF %d in sparse Cholesky factorization",
+                         numeric.failed_dof + 1);
+    }
+    f->factored = 1;
+
+    double elapsed = fem_wall_time() - start;
+    printf("    Sparse Cholesky factorization: %.3f s, %.2f GFlop/s on %d thread%s\n", elapsed,
+           elapsed > 0.0 ? f->flops * 1.0e-9 / elapsed : 0.0, threads, threads == 1 ? "" : "s");
+    return FEM_SUCCESS;
+}
+
+/* L L^T x = b on the permuted vector: forward over the supernodes in
+ * order, backward in reverse */
+static void sparse_cholesky_substitute(const struct sparse_cholesky_factor *f, double *x)
+{
+    int dpn = f->dof_per_node;
+
+    for (int s = 0; s < f->supernode_count; s++) {
+        const double *l = f->factor + f->factor_offsets[s];
+        const int *rows = f->rows + f->row_offsets[s];
+        int width = f->first[s + 1] - f->first[s];
+        int row_count = (int)(f->row_offsets[s + 1] - f->row_offsets[s]);
+        int m = row_count * dpn;
+        int k = width * dpn;
+        double *own = x + (size_t)f->first[s] * dpn;
+
+        dense_trsv_lower(k, l, m, own);
+        for (int q = 0; q < k; q++) {
+            const double *column = l + (size_t)q * m;
+            double xq = own[q];
+            for (int r = width; r < row_count; r++) {
+                for (int a = 0; a < dpn; a++) {
+                    x[rows[r] * dpn + a] -= column[r * dpn + a] * xq;
+                }
+            }
+        }
+    }
+
+    for (int s = f->supernode_count - 1; s >= 0; s--) {
+        const double *l = f->factor + f->factor_offsets[s];
+        const int *rows = f->rows + f->row_offsets[s];
+        int width = f->first[s + 1] - f->first[s];
+        int row_count = (int)(f->row_offsets[s + 1] - f->row_offsets[s]);
+        int m = row_count * dpn;
+        int k = width * dpn;
+        double *own = x + (size_t)f->first[s] * dpn;
+
+        for (int q = 0; q < k; q++) {
+            const double *column = l + (size_t)q * m;
+            double sum = 0.0;
+            for (int r = width; r < row_count; r++) {
+                for (int a = 0; a < dpn; a++) {
+                    sum += column[r * dpn + a] * x[rows[r] * dpn + a];
+                }
+            }
+            own[q] -= sum;
+        }
+        dense_trsv_lower_transpose(k, l, m, own);
+    }
+}
+
+fem_error_t sparse_cholesky_solve_system(void)
+{
+    struct sparse_cholesky_factor *f = g_fem_context->sparse_cholesky;
+    fem_error_t err = FEM_SUCCESS;
+
+    if (g_total_dof <= 0) {
+        g_solver_info.iterations = 0;
+        g_solver_info.residual = 0.0;
+        g_solver_info.status = FEM_SUCCESS;
+        return FEM_SUCCESS;
+    }
+    if (!f || f->total_dof != g_total_dof || !g_global_force || !g_global_displ) {
+        return error_set(FEM_ERROR_INVALID_INPUT, "Sparse Cholesky system not analysed");
+    }
+
+    if (!f->factored) {
+        err = sparse_cholesky_factorize(f);
+    }
+    if (err == FEM_SUCCESS) {
+        int dpn = f->dof_per_node;
+        for (int k = 0; k < f->node_count; k++) {
+            for (int a = 0; a < dpn; a++) {
+                f->work[k * dpn + a] = g_global_force[f->perm[k] * dpn + a];
+            }
+        }
+        sparse_cholesky_substitute(f, f->work);
+        for (int k = 0; k < f->node_count; k++) {
+            for (int a = 0; a < dpn; a++) {
+                g_global_displ[f->perm[k] * dpn + a] = f->work[k * dpn + a];
+            }
+        }
+    }
+
+    g_solver_info.iterations = 0;
+    g_solver_info.residual = 0.0;
+    g_solver_info.status = err;
+    CHECK_ERROR(err);
+
+    for (int node = 0; node < g_num_nodes; node++) {
+        g_node_displ[node][0] = g_global_displ[node * f->dof_per_node];
+        g_node_displ[node][1] = g_global_displ[node * f->dof_per_node + 1];
+        g_node_displ[node][2] = f->dof_per_node == 3 ? g_global_displ[node * 3 + 2] : 0.0;
+    }
+    FEM_LOG_INFO("Solution completed successfully\n");
+    FEM_LOG_INFO("  Nodal displacements updated\n");
+    return FEM_SUCCESS;
+}
@@ -0,0 +1,45 @@
+#ifndef SPARSE_CHOLESKY_H
+#define SPARSE_CHOLESKY_H
+
+/* FEM4C - High Performance Finite Element Method in C
+ * Supernodal sparse Cholesky solver
+ *
+ * A direct solver for the assembled static system, plane (skyline
+ * storage) or solid (block storage). The analysis works on the node
+ * graph of the matrix: nested dissection ordering (ordering.h), the
+ * elimination tree and its postorder, column counts, and supernodes of
+ * consecutive nodes with nested column structure. Supernodes whose
+ * merging adds few explicit zeros are amalgamated so that the dense
+ * blocks do not get too narrow.
+ *
+ * The numeric factorization is multifrontal. Each supernode assembles its
+ * entries of K and the update matrices of its children into a dense
+ * frontal matrix, factors its columns with the blocked kernels of
+ * dense_kernels.h and passes the Schur complement on to its parent.
+ * Independent subtrees of the elimination tree are factored as OpenMP
+ * tasks; large fronts also split their trailing updates into tasks. The
+ * children are added in a fixed order, so the factor does not depend on
+ * the number of threads.
+ *
+ * The factor is kept until the next assembly; later solves only repeat
+ * the substitutions. FEM4C_SOLVER=cholesky selects this solver for static
+ * analysis.
+ */
+
+#include "../common/types.h"
+
+/* Order and analyse the assembled system into a new factor of the bound
+ * context. The values are read from the matrix at the first solve. */
+fem_error_t sparse_cholesky_analyze(void);
+
+/* Solve K u = f into g_global_displ and g_node_displ. The first call
+ * after an analysis factorizes; later calls reuse the factor. */
+fem_error_t sparse_cholesky_solve_system(void);
+
+/* Whether the bound context holds an analysed system */
+int sparse_cholesky_active(void);
+
+/* Free the factor of the bound context */
+void sparse_cholesky_release(void);
+
+#endif /* SPARSE_CHOLESKY_H */
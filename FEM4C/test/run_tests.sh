@@ -0,0 +1,675 @@
+#!/usr/bin/env bash
+# FEM4C - Regression tests, run by `make test`
+#
+# The thread-count checks run when bin/fem4c is an OpenMP build
+# (`make openmp && make test`); a serial build skips them.
+set -euo pipefail
+
+test_dir="$(cd "$(dirname "$0")" && pwd)"
+root_dir="$(cd "${test_dir}/.." && pwd)"
+tmp_dir="$(mktemp -d)"
+trap 'rm -rf "${tmp_dir}"' EXIT
+
+fem4c="${FEM4C_BIN:-${root_dir}/bin/fem4c}"
+failures=0
+
+pass() {
+  echo "PASS: $*"
+}
+
+fail() {
+  echo "FAIL: $*" >&2
+  failures=$((failures + 1))
+}
+
+# run_deck <name> <deck> [VAR=value ...]: results in ${tmp_dir}/<name>.*
+run_deck() {
+  local name="$1" deck="$2"
+  shift 2
+  if ! env "$@" "${fem4c}" "${deck}" "${tmp_dir}/${name}.out" >"${tmp_dir}/${name}.log" 2>&1; then
+    tail -5 "${tmp_dir}/${name}.log" >&2
+    fail "${name}: fem4c exited with an error"
+    return 1
+  fi
+}
+
+# run_mode <name> <--mode> <deck> [args ...]: fem4c <--mode> <deck> <out> [args ...],
+# results in ${tmp_dir}/<name>.*
+run_mode() {
+  local name="$1" mode="$2" deck="$3"
+  shift 3
+  if ! "${fem4c}" "${mode}" "${deck}" "${tmp_dir}/${name}.out" "$@" >"${tmp_dir}/${name}.log" 2>&1; then
+    tail -5 "${tmp_dir}/${name}.log" >&2
+    fail "${name}: fem4c ${mode} exited with an error"
+    return 1
+  fi
+}
+
+# Mean UY of the nodes at x = <x> in a result CSV
+tip_uy() {
+  awk -F, -v x="$2" '$1 == "NODE" && ($3 - x) ^ 2 < 1e-12 { s += $7; n++ }
+    END { if (n) printf "%.9e\n", s / n; else print "nan" }' "$1"
+}
+
+# check_value <label> <value> <reference> <relative tolerance>
+check_value() {
+  if awk -v v="$2" -v r="$3" -v t="$4" 'BEGIN { d = v - r; exit !(d * d <= t * t * r * r) }'; then
+    pass "$1 = $2"
+  else
+    fail "$1 = $2, expected $3 (relative tolerance $4)"
+  fi
+}
+
+# check_reactions <label> <log> <load>: the constrained DOFs carry the
+# applied load <load> in y and nothing in x or z
+check_reactions() {
+  local line
+  line="$(grep -m1 "Reaction sum:" "$2" || true)"
+  if awk -v line="${line}" -v p="$3" 'BEGIN {
+      n = split(line, f, /[=,(]/)
+      if (n < 4) exit 1
+      rx = f[2] + 0; ry = f[4] + 0; rz = (n > 6 && line ~ /RZ/) ? f[6] + 0 : 0
+      e = 1e-6 * p
+      exit !((ry - p) ^ 2 <= e * e && rx * rx <= e * e && rz * rz <= e * e)
+    }'; then
+    pass "$1 reaction balance"
+  else
+    fail "$1 reaction balance: ${line:-no reaction line}"
+  fi
+}
+
+# compare_csv <label> <a.csv> <b.csv> <tolerance>: largest nodal
+# displacement difference relative to the largest displacement of a
+compare_csv() {
+  local result
+  result="$(awk -F, 'FNR == NR && $1 == "NODE" {
+        u[$2] = $6; v[$2] = $7; w[$2] = $8
+        for (k = 6; k <= 8; k++) if ($k * $k > m) m = $k * $k
+        next
+      }
+      $1 == "NODE" {
+        n++
+        d = ($6 - u[$2]) ^ 2; if (d > e) e = d
+        d = ($7 - v[$2]) ^ 2; if (d > e) e = d
+        d = ($8 - w[$2]) ^ 2; if (d > e) e = d
+      }
+      END { printf "%.3e %d\n", (m > 0 ? sqrt(e / m) : sqrt(e)), n }' "$2" "$3")"
+  if [[ "${result#* }" -gt 0 ]] && awk -v r="${result% *}" -v t="$4" 'BEGIN { exit !(r <= t) }'; then
+    pass "$1 (relative difference ${result% *})"
+  else
+    fail "$1 (relative difference ${result% *} over ${result#* } nodes, tolerance $4)"
+  fi
+}
+
+# compare_positions <label> <reference.csv> <b.csv> <tolerance>: like
+# compare_csv, but nodes are matched by coordinates, so that every
+# duplicate node of b is checked against the reference node at its place
+compare_positions() {
+  local result
+  result="$(awk -F, 'FNR == NR && $1 == "NODE" {
+        key = $3 "," $4 "," $5
+        u[key] = $6; v[key] = $7; w[key] = $8
+        for (k = 6; k <= 8; k++) if ($k * $k > m) m = $k * $k
+        next
+      }
+      $1 == "NODE" {
+        key = $3 "," $4 "," $5
+        if (!(key in u)) { missing++; next }
+        n++
+        d = ($6 - u[key]) ^ 2; if (d > e) e = d
+        d = ($7 - v[key]) ^ 2; if (d > e) e = d
+        d = ($8 - w[key]) ^ 2; if (d > e) e = d
+      }
+      END { printf "%.3e %d\n", (m > 0 ? sqrt(e / m) : sqrt(e)), (missing ? 0 : n) }' "$2" "$3")"
+  if [[ "${result#* }" -gt 0 ]] && awk -v r="${result% *}" -v t="$4" 'BEGIN { exit !(r <= t) }'; then
+    pass "$1 (relative difference ${result% *})"
+  else
+    fail "$1 (relative difference ${result% *} over ${result#* } nodes, tolerance $4)"
+  fi
+}
+
+# Build flavour, from the banner of a one-element run
+openmp=0
+if run_deck banner "${test_dir}/data/q4_simple.dat" &&
+   grep -q "OpenMP support: Enabled" "${tmp_dir}/banner.log"; then
+  openmp=1
+fi
+
+# ---- unit tests ----
+if make -s -C "${test_dir}/unit" run >"${tmp_dir}/unit.log" 2>&1; then
+  pass "unit tests ($(grep "Tests passed" "${tmp_dir}/unit.log" | paste -sd ";" -))"
+else
+  cat "${tmp_dir}/unit.log" >&2
+  fail "unit tests"
+fi
+
+# ---- solid elements and block PCG ----
+# Tip deflections are regression values of these meshes; the locking-free
+# beam value (Timoshenko, 1.9196e-05) bounds them all from above.
+solid_decks=(
+  "h8_cantilever -1.323788e-05"
+  "t4_cantilever -6.743966e-06"
+  "h8_cantilever_625 -1.760496e-05"
+  "t10_cantilever_525 -1.886334e-05"
+)
+for entry in "${solid_decks[@]}"; do
+  name="${entry% *}"
+  reference="${entry#* }"
+  run_deck "${name}" "${test_dir}/data/${name}.dat" OMP_NUM_THREADS=1 || continue
+  check_value "${name} tip deflection" "$(tip_uy "${tmp_dir}/${name}.csv" 10)" "${reference}" 1e-5
+  check_reactions "${name}" "${tmp_dir}/${name}.log" 1000
+done
+
+# Both large decks exceed BLOCK_PCG_PARALLEL_MIN nodes, so the block PCG
+# loops run on the OpenMP team
+if [[ "${openmp}" -eq 1 ]]; then
+  for name in h8_cantilever_625 t10_cantilever_525; do
+    run_deck "${name}_omp" "${test_dir}/data/${name}.dat" OMP_NUM_THREADS=4 || continue
+    compare_csv "${name} 4 threads vs 1" "${tmp_dir}/${name}.csv" "${tmp_dir}/${name}_omp.csv" 1e-6
+  done
+else
+  echo "SKIP: OpenMP thread-count checks (serial build)"
+fi
+
+# Two solid models in one service: the load-only re-solve of A after B was
+# assembled, and again after B was unloaded, must not see B's matrices.
+# The recycle solver runs the same sequence, since its re-solves of A
+# apply the block diagonal of A's matrix as the deflation weight.
+# service_sequence <solver> <threads>
+service_sequence() {
+  local solver="$1" threads="$2" tag="service_$1_$2"
+  local socket="${tmp_dir}/${tag}.sock"
+  local a="${test_dir}/data/h8_cantilever_625.dat" b="${test_dir}/data/t10_cantilever_525.dat"
+  FEM4C_SOLVER="${solver}" OMP_NUM_THREADS="${threads}" "${fem4c}" --serve "${socket}" \
+    >"${tmp_dir}/${tag}.log" 2>&1 &
+  local server=$!
+  printf '%s\n' "load ${a}" "solve ${a}" "load ${b}" "solve ${b}" \
+    "force ${a} 625 0 -500 0" "solve ${a}" "unload ${b}" \
+    "force ${a} 600 0 -500 0" "solve ${a}" "displacement ${a} 625" "shutdown" |
+    python3 "${test_dir}/service_client.py" "${socket}" >"${tmp_dir}/${tag}.out"
+  local status=$?
+  wait "${server}" || status=$?
+  return "${status}"
+}
+
+# v of node 625 after the last solve of the sequence
+# service_tip_v <solver> <threads>
+service_tip_v() {
+  sed -n 's/.*"node":625,"u":[^,]*,"v":\([^,]*\),.*/\1/p' "${tmp_dir}/service_$1_$2.out"
+}
+
+service_threads=(1)
+if [[ "${openmp}" -eq 1 ]]; then
+  service_threads+=(4)
+fi
+for solver in cg recycle; do
+  for threads in "${service_threads[@]}"; do
+    if service_sequence "${solver}" "${threads}" && [[ -n "$(service_tip_v "${solver}" "${threads}")" ]]; then
+      pass "${solver} service with two solid models on ${threads} thread(s)"
+    else
+      cat "${tmp_dir}/service_${solver}_${threads}.out" >&2 || true
+      tail -5 "${tmp_dir}/service_${solver}_${threads}.log" >&2 || true
+      fail "${solver} service with two solid models on ${threads} thread(s)"
+    fi
+  done
+  if [[ "${openmp}" -eq 1 && -n "$(service_tip_v "${solver}" 1)" && -n "$(service_tip_v "${solver}" 4)" ]]; then
+    check_value "${solver} service re-solve tip v, 4 threads" \
+      "$(service_tip_v "${solver}" 4)" "$(service_tip_v "${solver}" 1)" 1e-6
+  fi
+done
+if [[ -n "$(service_tip_v cg 1)" && -n "$(service_tip_v recycle 1)" ]]; then
+  check_value "recycle service re-solve tip v vs CG" "$(service_tip_v recycle 1)" "$(service_tip_v cg 1)" 1e-5
+fi
+
+# --serve must not delete a regular file or take a socket from a running
+# service, but replaces a socket left behind by one that died
+serve_file="${tmp_dir}/results.dat"
+echo "keep me" >"${serve_file}"
+if ! "${fem4c}" --serve "${serve_file}" >"${tmp_dir}/serve_file.log" 2>&1 &&
+   grep -q "is not a socket" "${tmp_dir}/serve_file.log" && grep -q "keep me" "${serve_file}"; then
+  pass "service refuses to replace a regular file"
+else
+  fail "service refuses to replace a regular file"
+fi
+serve_socket="${tmp_dir}/serve_busy.sock"
+"${fem4c}" --serve "${serve_socket}" >"${tmp_dir}/serve_busy_1.log" 2>&1 &
+server=$!
+if echo status | python3 "${test_dir}/service_client.py" "${serve_socket}" >/dev/null &&
+   ! "${fem4c}" --serve "${serve_socket}" >"${tmp_dir}/serve_busy_2.log" 2>&1 &&
+   grep -q "already in use" "${tmp_dir}/serve_busy_2.log" &&
+   echo status | python3 "${test_dir}/service_client.py" "${serve_socket}" >/dev/null; then
+  pass "second service on a live socket fails with already in use"
+else
+  fail "second service on a live socket fails with already in use"
+fi
+echo shutdown | python3 "${test_dir}/service_client.py" "${serve_socket}" >/dev/null || true
+wait "${server}" || true
+python3 -c 'import socket, sys; socket.socket(socket.AF_UNIX).bind(sys.argv[1])' "${serve_socket}"
+"${fem4c}" --serve "${serve_socket}" >"${tmp_dir}/serve_stale.log" 2>&1 &
+server=$!
+if echo shutdown | python3 "${test_dir}/service_client.py" "${serve_socket}" >/dev/null &&
+   wait "${server}"; then
+  pass "service replaces a stale socket"
+else
+  tail -3 "${tmp_dir}/serve_stale.log" >&2 || true
+  fail "service replaces a stale socket"
+fi
+
+# ---- stress recovery ----
+# Patch test: a plate under uniform tension sigma_x = 1e6 with distorted
+# interior elements. The averaged (VTK Nodal_Stress) and patch-recovered
+# (CSV, VTK Nodal_Stress_SPR) nodal stresses must equal the exact constant
+# stress at every node, interior and boundary alike.
+# check_patch_stress <name>
+check_patch_stress() {
+  local name="$1" worst
+  worst="$({
+      awk -F, '$1 == "NODE" { print "csv", $2, $16, $17, $18 }' "${tmp_dir}/${name}.csv"
+      awk '/^SCALARS Nodal_Stress(_SPR)? float 3/ { field = $2; getline; n = 0; next }
+           field != "" && NF == 3 { print field, ++n, $1, $2, $3; next }
+           { field = "" }' "${tmp_dir}/${name}.vtk"
+    } | awk 'BEGIN { worst = 0; rows = 0 }
+      { rows++; d = $3 - 1e6; if (d < 0) d = -d; if (d > worst) { worst = d; at = $1 " node " $2 }
+        for (k = 4; k <= 5; k++) { d = $k < 0 ? -$k : $k; if (d > worst) { worst = d; at = $1 " node " $2 } } }
+      END { printf "%.3e %d %s\n", worst, rows, at }')"
+  local error rows at
+  read -r error rows at <<<"${worst}"
+  if [[ "${rows}" -gt 0 ]] && awk -v e="${error}" 'BEGIN { exit !(e <= 1.0) }'; then
+    pass "${name} nodal stresses exact (${rows} values, largest error ${error} Pa)"
+  else
+    fail "${name} nodal stresses: error ${error} Pa at ${at:-no rows} (${rows} values)"
+  fi
+}
+
+for name in patch_q4 patch_t3 patch_t6; do
+  run_deck "${name}" "${test_dir}/data/${name}.dat" || continue
+  check_patch_stress "${name}"
+done
+
+# ---- multipoint constraints ----
+# The tied decks put the right half of the strip on duplicate nodes joined
+# to the left half by RBE2 or MPC; elimination must reproduce the merged
+# mesh node for node, reactions included
+mpc_decks=(
+  "mpc_q4_merged.dat 3000 mpc_q4_rbe2.bdf mpc_q4_mpc.bdf"
+  "mpc_t3_merged.dat 3000 mpc_t3_rbe2.bdf"
+  "mpc_h8_merged.dat 9000 mpc_h8_rbe2.bdf"
+)
+for entry in "${mpc_decks[@]}"; do
+  read -r merged load tied_decks <<<"${entry}"
+  run_deck "${merged%.*}" "${test_dir}/data/${merged}" || continue
+  check_reactions "${merged%.*}" "${tmp_dir}/${merged%.*}.log" "${load}"
+  for tied in ${tied_decks}; do
+    run_deck "${tied%.*}" "${test_dir}/data/${tied}" || continue
+    check_reactions "${tied%.*}" "${tmp_dir}/${tied%.*}.log" "${load}"
+    compare_positions "${tied%.*} vs merged mesh" "${tmp_dir}/${merged%.*}.csv" \
+      "${tmp_dir}/${tied%.*}.csv" 1e-6
+  done
+done
+
+# ---- plane examples: CG reference solutions for the direct solvers ----
+# The CSV carries six significant digits, so the direct solvers are
+# compared with CG at 1e-5 of the largest displacement
+examples=(t3 q4 t6)
+for example in "${examples[@]}"; do
+  run_deck "cg_${example}" "${root_dir}/examples/${example}_cantilever_beam.dat" || true
+done
+
+# ---- pipelined preprocessing ----
+# The worker's element matrices must give exactly the sequential result
+for example in "${examples[@]}"; do
+  name="pipeline_${example}"
+  run_deck "${name}" "${root_dir}/examples/${example}_cantilever_beam.dat" FEM4C_PIPELINE=1 || continue
+  if grep -q "Assembling global stiffness matrix (pipelined)" "${tmp_dir}/${name}.log" &&
+     cmp -s "${tmp_dir}/cg_${example}.csv" "${tmp_dir}/${name}.csv"; then
+    pass "${name} identical to the sequential run"
+  else
+    fail "${name} not pipelined or differs from the sequential run"
+  fi
+done
+# A parser package whose mesh holds more elements than its header declares:
+# the arrays grow after the first block was handed over, so the pipeline is
+# cancelled and the model read and assembled sequentially
+package="${test_dir}/data/parser_t3_undeclared"
+if run_deck parser_sequential "${package}" && run_deck parser_pipeline "${package}" FEM4C_PIPELINE=1; then
+  if grep -q "Pipelined preprocessing enabled" "${tmp_dir}/parser_pipeline.log" &&
+     ! grep -q "(pipelined)" "${tmp_dir}/parser_pipeline.log" &&
+     grep -q "Elements: 4224" "${tmp_dir}/parser_pipeline.log" &&
+     cmp -s "${tmp_dir}/parser_sequential.csv" "${tmp_dir}/parser_pipeline.csv"; then
+    pass "parser package beyond its declared element count falls back to sequential"
+  else
+    fail "parser package beyond its declared element count"
+  fi
+  check_reactions parser_t3_undeclared "${tmp_dir}/parser_pipeline.log" 1000
+fi
+
+# ---- out-of-core skyline ----
+# Budgets small enough for many panels; 32K cannot hold the tallest T6
+# column and must fail with a clear message
+ooc_scratch="${tmp_dir}/ooc_scratch"
+mkdir -p "${ooc_scratch}"
+ooc_runs=(
+  "t6 4M"
+  "t6 256K"
+  "q4 16K"
+  "t3 16K"
+)
+for entry in "${ooc_runs[@]}"; do
+  read -r example budget <<<"${entry}"
+  name="ooc_${example}_${budget}"
+  run_deck "${name}" "${root_dir}/examples/${example}_cantilever_beam.dat" \
+    FEM4C_SOLVER=ooc FEM4C_OOC_MEMORY="${budget}" FEM4C_OOC_DIR="${ooc_scratch}" || continue
+  compare_csv "${name} vs CG" "${tmp_dir}/cg_${example}.csv" "${tmp_dir}/${name}.csv" 1e-5
+done
+# The panel size must not change the factor
+compare_csv "ooc_t6 256K vs 4M panels" "${tmp_dir}/ooc_t6_4M.csv" "${tmp_dir}/ooc_t6_256K.csv" 0
+if FEM4C_SOLVER=ooc FEM4C_OOC_MEMORY=32K FEM4C_OOC_DIR="${ooc_scratch}" "${fem4c}" \
+     "${root_dir}/examples/t6_cantilever_beam.dat" "${tmp_dir}/ooc_t6_32K.out" \
+     >"${tmp_dir}/ooc_t6_32K.log" 2>&1; then
+  fail "ooc_t6_32K should fail: the budget cannot hold a column"
+elif grep -q "does not fit the out-of-core budget" "${tmp_dir}/ooc_t6_32K.log"; then
+  pass "ooc_t6_32K rejects a budget smaller than one column"
+else
+  tail -5 "${tmp_dir}/ooc_t6_32K.log" >&2
+  fail "ooc_t6_32K failed without the budget diagnostic"
+fi
+if ls "${tmp_dir}" | grep -qi "ooc.*\.tmp\|fem4c_ooc"; then
+  fail "out-of-core scratch files left in FEM4C_OOC_DIR"
+fi
+
+# ---- supernodal sparse Cholesky ----
+# Against CG on the plane examples and block PCG on a solid; on an OpenMP
+# build the factor must not depend on the number of threads
+cholesky_threads=(1)
+if [[ "${openmp}" -eq 1 ]]; then
+  cholesky_threads+=(4)
+fi
+for threads in "${cholesky_threads[@]}"; do
+  for example in "${examples[@]}"; do
+    run_deck "cholesky_${example}_${threads}" "${root_dir}/examples/${example}_cantilever_beam.dat" \
+      FEM4C_SOLVER=cholesky OMP_NUM_THREADS="${threads}" || continue
+  done
+  run_deck "cholesky_h8_${threads}" "${test_dir}/data/h8_cantilever_625.dat" \
+    FEM4C_SOLVER=cholesky OMP_NUM_THREADS="${threads}" || true
+done
+for example in "${examples[@]}"; do
+  compare_csv "cholesky_${example} vs CG" "${tmp_dir}/cg_${example}.csv" \
+    "${tmp_dir}/cholesky_${example}_1.csv" 1e-5
+done
+compare_csv "cholesky_h8 vs block PCG" "${tmp_dir}/h8_cantilever_625.csv" \
+  "${tmp_dir}/cholesky_h8_1.csv" 1e-5
+if [[ "${openmp}" -eq 1 ]]; then
+  for example in "${examples[@]}" h8; do
+    compare_csv "cholesky_${example} 4 threads vs 1" "${tmp_dir}/cholesky_${example}_1.csv" \
+      "${tmp_dir}/cholesky_${example}_4.csv" 0
+  done
+fi
+
+# Plane and solid factors in one service: the plane model is factored
+# again after the solid one was assembled. The responses print the
+# solution to 17 digits, so 1 and 4 threads must agree exactly.
+cholesky_service() {
+  local threads="$1" socket="${tmp_dir}/cholesky_$1.sock"
+  local plane="${root_dir}/examples/t3_cantilever_beam.dat" solid="${test_dir}/data/h8_cantilever_625.dat"
+  FEM4C_SOLVER=cholesky OMP_NUM_THREADS="${threads}" "${fem4c}" --serve "${socket}" \
+    >"${tmp_dir}/cholesky_service_${threads}.log" 2>&1 &
+  local server=$!
+  printf '%s\n' "load ${plane}" "solve ${plane}" "load ${solid}" "solve ${solid}" \
+    "material ${plane} 1 2.0e11 0.3" "solve ${plane}" "displacement ${plane} 3" \
+    "displacement ${solid} 625" "shutdown" |
+    python3 "${test_dir}/service_client.py" "${socket}" >"${tmp_dir}/cholesky_service_${threads}.out"
+  local status=$?
+  wait "${server}" || status=$?
+  return "${status}"
+}
+
+for threads in "${cholesky_threads[@]}"; do
+  if cholesky_service "${threads}"; then
+    pass "cholesky service with plane and solid models on ${threads} thread(s)"
+  else
+    cat "${tmp_dir}/cholesky_service_${threads}.out" >&2 || true
+    tail -5 "${tmp_dir}/cholesky_service_${threads}.log" >&2 || true
+    fail "cholesky service with plane and solid models on ${threads} thread(s)"
+  fi
+done
+if [[ "${openmp}" -eq 1 ]]; then
+  if cmp -s <(sed 's/,"time_ms":[^,}]*//' "${tmp_dir}/cholesky_service_1.out") \
+            <(sed 's/,"time_ms":[^,}]*//' "${tmp_dir}/cholesky_service_4.out"); then
+    pass "cholesky service solutions identical on 1 and 4 threads"
+  else
+    fail "cholesky service solutions differ between 1 and 4 threads"
+  fi
+fi
+
+# ---- geometrically nonlinear statics ----
+# scale_loads <deck> <factor>: the native deck with its point loads scaled
+scale_loads() {
+  awk -v f="$2" '/^point loads/ { loads = 1; print; next }
+    /^end/ { loads = 0 }
+    loads && NF == 4 { printf "%s %.9e %.9e %.9e\n", $1, $2 * f, $3 * f, $4 * f; next }
+    { print }' "$1"
+}
+
+# factor_count <log>: factorizations of the tangent over the run
+factor_count() {
+  awk '/Factorizations:/ { print $2 }' "$1"
+}
+
+# At the example's load the response is linear: one factorization serves
+# all ten load steps and the result matches the linear solution
+if run_mode nonlinear_q4 --nonlinear "${root_dir}/examples/q4_cantilever_beam.dat"; then
+  compare_csv "nonlinear_q4 small load vs linear" "${tmp_dir}/cg_q4.csv" "${tmp_dir}/nonlinear_q4.csv" 1e-4
+  check_reactions nonlinear_q4 "${tmp_dir}/nonlinear_q4.log" 1000
+  if [[ "$(factor_count "${tmp_dir}/nonlinear_q4.log")" == "1" ]]; then
+    pass "nonlinear_q4 reuses one factorization for every step"
+  else
+    fail "nonlinear_q4 refactorized at a linear load ($(factor_count "${tmp_dir}/nonlinear_q4.log") factorizations)"
+  fi
+fi
+
+# 1e4 times the load bends the tip by 18% of the length: the old factor
+# stalls and is refreshed, and one step must reach the ten-step solution
+scale_loads "${root_dir}/examples/q4_cantilever_beam.dat" 1e4 >"${tmp_dir}/nonlinear_1e7.dat"
+scale_loads "${root_dir}/examples/q4_cantilever_beam.dat" 1e4 >"${tmp_dir}/nonlinear_1e7.dat"
+if run_mode nonlinear_1e7_10 --nonlinear "${tmp_dir}/nonlinear_1e7.dat" 10 &&
+   run_mode nonlinear_1e7_1 --nonlinear "${tmp_dir}/nonlinear_1e7.dat" 1; then
+  if [[ "$(factor_count "${tmp_dir}/nonlinear_1e7_1.log")" -gt 1 ]]; then
+    pass "nonlinear_1e7 refactorizes a stalled tangent ($(factor_count "${tmp_dir}/nonlinear_1e7_1.log") factorizations)"
+  else
+    fail "nonlinear_1e7 never refactorized"
+  fi
+  compare_csv "nonlinear_1e7 one step vs ten steps" "${tmp_dir}/nonlinear_1e7_10.csv" \
+    "${tmp_dir}/nonlinear_1e7_1.csv" 1e-4
+  check_reactions nonlinear_1e7 "${tmp_dir}/nonlinear_1e7_1.log" 1e7
+  # 3% below the linear -0.1841: the bent beam carries part of the load
+  # axially
+  check_value "nonlinear_1e7 tip deflection" "$(tip_uy "${tmp_dir}/nonlinear_1e7_10.csv" 1.0)" \
+    -1.782384e-01 1e-3
+fi
+
+# 1e6 times the load in one step: the full increment fails and must be cut
+# back, and the halved steps still end in equilibrium with the load
+scale_loads "${root_dir}/examples/q4_cantilever_beam.dat" 1e6 >"${tmp_dir}/nonlinear_1e9.dat"
+if run_mode nonlinear_1e9 --nonlinear "${tmp_dir}/nonlinear_1e9.dat" 1; then
+  if grep -q "cut back" "${tmp_dir}/nonlinear_1e9.log" && grep -q "^  Converged" "${tmp_dir}/nonlinear_1e9.log"; then
+    pass "nonlinear_1e9 cuts back the load step and converges"
+  else
+    fail "nonlinear_1e9 did not cut back and converge"
+  fi
+  check_reactions nonlinear_1e9 "${tmp_dir}/nonlinear_1e9.log" 1e9
+fi
+
+# ---- implicit dynamics ----
+# The Q4 example's only load is -1000 in y at node 165 (DOF index 329)
+load_dof=329
+static_max_u="$(awk -F, '$1 == "NODE" && $9 > m { m = $9 } END { printf "%.9e\n", m }' "${tmp_dir}/cg_q4.csv")"
+
+# energy_balance <name>: kinetic + strain - f.u at each report step of the
+# log, with f.u taken from the history frame of the same step; prints the
+# extreme balance relative to the largest f.u, then the last one
+energy_balance() {
+  python3 "${test_dir}/time_history.py" "${tmp_dir}/$1.hist" "${load_dof}" |
+    awk 'NR == FNR { if (FNR > 1) w[$1] = -1000 * $4; next }
+      /^ +[0-9]+  [0-9.e+-]+  / && ($1 in w) {
+        b = $4 + $5 - w[$1]; if (w[$1] > m) m = w[$1]
+        if (b * b > e * e) e = b; last = b
+      }
+      END { if (m > 0) printf "%.3e %.3e\n", e / m, last / m; else print "nan nan" }' - "${tmp_dir}/$1.log"
+}
+
+# Trapezoidal Newmark under a suddenly applied load: no dissipation, so
+# kinetic + strain - f.u stays 0 and the peak displacement is twice the
+# static one. The first mode is about 7.5 kHz (period 1.33e-4 s), so 200
+# steps of 2e-5 s cover 30 periods at about 6.7 steps per period.
+if run_mode transient_step --transient "${root_dir}/examples/q4_cantilever_beam.dat" 2e-5 200; then
+  peak="$(python3 "${test_dir}/time_history.py" "${tmp_dir}/transient_step.hist" |
+    awk 'NR > 1 && $3 > m { m = $3 } END { printf "%.9e\n", m }')"
+  ratio="$(awk -v p="${peak}" -v s="${static_max_u}" 'BEGIN { printf "%.4f\n", p / s }')"
+  if awk -v r="${ratio}" 'BEGIN { exit !(r >= 1.9 && r <= 2.1) }'; then
+    pass "transient_step peak |u| is ${ratio} times the static deflection"
+  else
+    fail "transient_step peak |u| is ${ratio} times the static deflection, expected about 2"
+  fi
+  read -r worst last <<<"$(energy_balance transient_step)"
+  if awk -v e="${worst}" 'BEGIN { exit !(e * e <= 1e-10) }'; then
+    pass "transient_step energy balance (largest ${worst} of f.u)"
+  else
+    fail "transient_step energy balance: kinetic + strain - f.u reaches ${worst} of f.u"
+  fi
+fi
+
+# HHT-alpha over 150 first-mode periods: the default history interval
+# gives 200 intervals plus the initial frame, and the numerical damping
+# dissipates energy and leaves the model near its static deflection
+if run_mode transient_hht --transient "${root_dir}/examples/q4_cantilever_beam.dat" 2e-5 1000 -0.1; then
+  python3 "${test_dir}/time_history.py" "${tmp_dir}/transient_hht.hist" >"${tmp_dir}/transient_hht.txt"
+  header="$(sed -n 1p "${tmp_dir}/transient_hht.txt")"
+  if [[ "${header}" == "nodes 297 dofs 2 dt 2.0000000000000002e-05 interval 5 frames 201" ]] &&
+     grep -q "every 5 steps" "${tmp_dir}/transient_hht.log"; then
+    pass "transient_hht history header and 1000/5 + 1 frames"
+  else
+    fail "transient_hht history: ${header:-unreadable}"
+  fi
+  read -r worst last <<<"$(energy_balance transient_hht)"
+  if awk -v e="${worst}" -v l="${last}" 'BEGIN { exit !(l < -0.1 && e == l) }'; then
+    pass "transient_hht dissipates energy (${last} of f.u at the end)"
+  else
+    fail "transient_hht energy: largest ${worst}, last ${last} of f.u"
+  fi
+  final="$(awk 'END { print $3 }' "${tmp_dir}/transient_hht.txt")"
+  check_value "transient_hht final max |u| vs static" "${final}" "${static_max_u}" 0.02
+fi
+
+# ---- explicit dynamics ----
+# Central differences from the critical time step, against Newmark with a
+# small step, both with the load ramped over 5e-4 s and read at t = 1e-3 s.
+# The Q4 kernels use one-point integration with hourglass control and the
+# lumped mass differs from the consistent one, hence the looser Q4 bound.
+explicit_runs=(
+  "q4 3e-2"
+  "t3 2e-3"
+)
+for entry in "${explicit_runs[@]}"; do
+  read -r example tolerance <<<"${entry}"
+  deck="${root_dir}/examples/${example}_cantilever_beam.dat"
+  run_mode "explicit_${example}" --explicit "${deck}" 1e-3 0 0.05 5e-4 || continue
+  run_mode "explicit_${example}_newmark" --transient "${deck}" 1e-6 1000 0 5e-4 || continue
+  line="$(grep -m1 "Central difference: dt" "${tmp_dir}/explicit_${example}.log" || true)"
+  if awk -v line="${line}" 'BEGIN {
+      if (split(line, f, /dt = |\(critical estimate |\)/) < 3) exit 1
+      exit !(f[2] + 0 > 0 && f[2] + 0 <= f[3] + 0)
+    }'; then
+    pass "explicit_${example} dt within the critical estimate"
+  else
+    fail "explicit_${example} dt: ${line:-not reported}"
+  fi
+  compare_csv "explicit_${example} vs Newmark at t = 1e-3" "${tmp_dir}/explicit_${example}_newmark.csv" \
+    "${tmp_dir}/explicit_${example}.csv" "${tolerance}"
+done
+if ! "${fem4c}" --explicit "${root_dir}/examples/t6_cantilever_beam.dat" "${tmp_dir}/explicit_t6.out" 1e-3 \
+     >"${tmp_dir}/explicit_t6.log" 2>&1 &&
+   grep -q "Explicit dynamics supports T3 and Q4 elements" "${tmp_dir}/explicit_t6.log"; then
+  pass "explicit rejects T6 elements"
+else
+  fail "explicit did not reject T6 elements"
+fi
+
+# ---- frequency response ----
+# 10 Hz is far below the first mode (7.5 kHz), so the response at node 297
+# is the static deflection up to the truncation to ten modes
+if run_mode harmonic_q4 --harmonic "${root_dir}/examples/q4_cantilever_beam.dat" 10 10,100,1000 0.02 165,297; then
+  frf="${tmp_dir}/harmonic_q4_frf.csv"
+  expected="frequency_hz,max_amplitude,max_node"
+  for node in 165 297; do
+    expected+=",n${node}_ux_amp,n${node}_ux_phase_deg,n${node}_uy_amp,n${node}_uy_phase_deg"
+  done
+  if [[ "$(sed -n 1p "${frf}")" == "${expected}" && "$(awk 'END { print NR }' "${frf}")" -eq 4 ]]; then
+    pass "harmonic_q4 FRF has columns for nodes 165 and 297 and three frequencies"
+  else
+    fail "harmonic_q4 FRF header or rows: $(sed -n 1p "${frf}")"
+  fi
+  check_value "harmonic_q4 |u| of node 297 at 10 Hz vs static" \
+    "$(awk -F, '$1 + 0 == 10 { printf "%.9e\n", sqrt($8 * $8 + $10 * $10) }' "${frf}")" \
+    "$(awk -F, '$1 == "NODE" && $2 == 297 { print $9 }' "${tmp_dir}/cg_q4.csv")" 1e-3
+fi
+
+# ---- adaptive refinement ----
+# T3 example to 6% with the sparse Cholesky solver: every cycle lowers the
+# estimated error, the log names the direct solver instead of a CG count
+# and the refined mesh still carries the load
+if FEM4C_SOLVER=cholesky run_mode adaptive_t3 --adaptive "${root_dir}/examples/t3_cantilever_beam.dat" 6 6; then
+  log="${tmp_dir}/adaptive_t3.log"
+  errors="$(sed -n 's/.*Cycle [0-9]*:.*estimated error \([0-9.]*\)%.*/\1/p' "${log}" | paste -sd " " -)"
+  if awk -v e="${errors}" 'BEGIN { n = split(e, v, " "); if (n < 3) exit 1
+      for (i = 2; i <= n; i++) if (v[i] + 0 >= v[i - 1] + 0) exit 1 }' &&
+     grep -q "Target error reached" "${log}"; then
+    pass "adaptive_t3 estimated error decreases every cycle: ${errors}"
+  else
+    fail "adaptive_t3 estimated errors: ${errors}"
+  fi
+  if [[ "$(grep -c "Cycle [0-9]*:.*sparse Cholesky" "${log}")" -ge 3 ]] &&
+     ! grep -q "CG iterations" "${log}"; then
+    pass "adaptive_t3 reports the direct solver without CG iterations"
+  else
+    fail "adaptive_t3 solver report: $(grep -m1 "Cycle" "${log}")"
+  fi
+  grep "Reaction sum:" "${log}" | tail -1 >"${tmp_dir}/adaptive_t3_final.log"
+  check_reactions "adaptive_t3 refined mesh" "${tmp_dir}/adaptive_t3_final.log" 1000
+fi
+
+# ---- Krylov recycling ----
+# One batch worker solves the same model four times, so the deflated
+# solves repeat the first solve's system and must all take fewer
+# iterations than it. Each result must still match the plain solve.
+recycle_runs=(
+  "t6 ${root_dir}/examples/t6_cantilever_beam.dat cg_t6"
+  "t10 ${test_dir}/data/t10_cantilever_525.dat t10_cantilever_525"
+)
+for entry in "${recycle_runs[@]}"; do
+  read -r name deck reference <<<"${entry}"
+  jobs="${tmp_dir}/recycle_${name}.jobs"
+  : >"${jobs}"
+  for i in 1 2 3 4; do
+    echo "${deck} ${tmp_dir}/recycle_${name}_${i}.out" >>"${jobs}"
+  done
+  if ! FEM4C_SOLVER=recycle "${fem4c}" --batch "${jobs}" 1 >"${tmp_dir}/recycle_${name}.log" 2>&1; then
+    tail -5 "${tmp_dir}/recycle_${name}.log" >&2
+    fail "recycle_${name}: fem4c --batch exited with an error"
+    continue
+  fi
+  deflated="$(grep -c "with [0-9]* deflation vectors (first solve [0-9]*, [0-9.]*x fewer)" "${jobs}.log" || true)"
+  if [[ "${deflated}" -eq 3 ]]; then
+    pass "recycle_${name}: 3 deflated solves take fewer iterations than the first"
+  else
+    grep "Krylov recycling" "${jobs}.log" >&2 || true
+    fail "recycle_${name}: expected 3 deflated solves with fewer iterations, got ${deflated}"
+  fi
+  compare_csv "recycle_${name} last solve vs CG" "${tmp_dir}/${reference}.csv" \
+    "${tmp_dir}/recycle_${name}_4.csv" 1e-5
+done
+
+if [[ "${failures}" -ne 0 ]]; then
+  echo "FAIL: ${failures} check(s) failed" >&2
+  exit 1
+fi
+echo "PASS: all FEM4C tests completed"
@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+"""Send requests from stdin to a fem4c --serve socket, one per line.
+
+Prints each response line. Exits 1 if a response has "ok": false and 2 if
+the server closes the connection (e.g. crashes) before answering.
+"""
+
+import json
+import socket
+import sys
+import time
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("Usage: service_client.py <socket>", file=sys.stderr)
+        return 2
+
+    sock = socket.socket(socket.AF_UNIX)
+    for _ in range(100):
+        try:
+            sock.connect(sys.argv[1])
+            break
+        except OSError:
+            time.sleep(0.1)
+    else:
+        print("Cannot connect to %s" % sys.argv[1], file=sys.stderr)
+        return 2
+
+    stream = sock.makefile("rw")
+    status = 0
+    for request in sys.stdin:
+        request = request.strip()
+        if not request:
+            continue
+        stream.write(request + "\n")
+        stream.flush()
+        response = stream.readline()
+        if not response:
+            print("%s -> connection closed" % request, file=sys.stderr)
+            return 2
+        print(response.strip())
+        if not json.loads(response).get("ok", False):
+            status = 1
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())
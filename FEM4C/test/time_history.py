@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+"""Print a fem4c time history file (.hist) as text.
+
+The first line is the header:
+    nodes <n> dofs <per node> dt <dt> interval <steps> frames <count>
+followed by one line per frame:
+    <step> <time> <largest nodal |u|> [u of each requested DOF index]
+Exits 1 if the file is truncated or its header is not FEM4CTH1.
+"""
+
+import math
+import struct
+import sys
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("Usage: time_history.py <file.hist> [dof index ...]", file=sys.stderr)
+        return 2
+    dofs = [int(arg) for arg in sys.argv[2:]]
+
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+    header = struct.calcsize("=8siidi")
+    if len(data) < header or data[:8] != b"FEM4CTH1":
+        print("Not a FEM4C time history: %s" % sys.argv[1], file=sys.stderr)
+        return 1
+    _, nodes, per_node, dt, interval = struct.unpack_from("=8siidi", data, 0)
+    values = nodes * per_node
+    frame = struct.calcsize("=id") + 8 * values
+    if (len(data) - header) % frame != 0:
+        print("Truncated time history: %s" % sys.argv[1], file=sys.stderr)
+        return 1
+    count = (len(data) - header) // frame
+
+    print("nodes %d dofs %d dt %.17g interval %d frames %d" % (nodes, per_node, dt, interval, count))
+    for k in range(count):
+        offset = header + k * frame
+        step, time = struct.unpack_from("=id", data, offset)
+        u = struct.unpack_from("=%dd" % values, data, offset + struct.calcsize("=id"))
+        largest = max(math.sqrt(sum(u[i * per_node + c] ** 2 for c in range(per_node)))
+                      for i in range(nodes))
+        fields = ["%d" % step, "%.17g" % time, "%.17g" % largest]
+        fields += ["%.17g" % u[d] for d in dofs]
+        print(" ".join(fields))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
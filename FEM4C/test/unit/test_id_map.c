@@ -0,0 +1,181 @@
+/* FEM4C - ID Map Unit Tests
+ * Dense and hashed storage, switching between them, growth and lookups
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../src/common/id_map.h"
+
+/* Nastran part offset used by multi-part decks */
+#define PART_OFFSET 10000000
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_total = 0;
+
+static void check(int condition, const char *what)
+{
+    tests_total++;
+    if (condition) {
+        tests_passed++;
+    } else {
+        printf("  FAIL: %s\n", what);
+    }
+}
+
+/* Every id in [first, last] must map to index_base + (id - first) */
+static int all_present(const id_map_t *map, int first, int last, int index_base)
+{
+    for (int id = first; id <= last; id++) {
+        if (id_map_lookup(map, id) != index_base + (id - first)) {
+            printf("  id %d -> %d, expected %d\n", id, id_map_lookup(map, id),
+                   index_base + (id - first));
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Compact IDs stay dense; growth keeps earlier entries and overwrites do
+ * not count twice */
+static void test_dense_growth(void)
+{
+    id_map_t map;
+
+    printf("Testing dense growth...\n");
+    id_map_init(&map, 64);
+    for (int id = 1; id <= 1000; id++) {
+        if (id_map_insert(&map, id, id - 1, 0) != FEM_SUCCESS) {
+            break;
+        }
+    }
+    check(map.mode == ID_MAP_DENSE, "compact IDs stay dense");
+    check(map.count == 1000, "dense count after 1000 inserts");
+    check(map.dense_capacity >= 1001 && map.dense_capacity <= 1001 + 64,
+          "dense capacity grows in blocks");
+    check(all_present(&map, 1, 1000, 0), "dense lookups of present IDs");
+    check(id_map_lookup(&map, 1001) == -1, "dense lookup past the last ID");
+    check(id_map_lookup(&map, 1000000) == -1, "dense lookup past the capacity");
+
+    check(id_map_insert(&map, 500, 7, 0) == FEM_SUCCESS && id_map_lookup(&map, 500) == 7,
+          "dense overwrite");
+    check(map.count == 1000, "dense overwrite does not change the count");
+    id_map_free(&map);
+}
+
+/* Parts offset by 10,000,000 must switch to hashing and stay proportional
+ * to the number of entries */
+static void test_offset_parts(int expected_count)
+{
+    const int parts = 4, per_part = 2500;
+    id_map_t map;
+    int index = 0, ok = 1;
+
+    printf("Testing offset part IDs (expected count %d)...\n", expected_count);
+    id_map_init(&map, 1024);
+    for (int part = 0; part < parts && ok; part++) {
+        for (int k = 1; k <= per_part && ok; k++) {
+            ok = id_map_insert(&map, part * PART_OFFSET + k, index++, expected_count) == FEM_SUCCESS;
+        }
+    }
+    check(ok, "offset inserts succeed");
+    check(map.mode == ID_MAP_HASH, "offset IDs switch to hash mode");
+    check(map.count == parts * per_part, "hash count");
+    check(map.dense == NULL && map.dense_capacity == 0, "dense array released");
+    check(id_map_memory_bytes(&map) <= (size_t)parts * per_part * 4 * 2 * sizeof(int),
+          "hash memory stays within 4 slots per entry");
+
+    for (int part = 0; part < parts; part++) {
+        check(all_present(&map, part * PART_OFFSET + 1, part * PART_OFFSET + per_part,
+                          part * per_part),
+              "hash lookups of present IDs");
+        check(id_map_lookup(&map, part * PART_OFFSET + per_part + 1) == -1,
+              "hash lookup after a part's last ID");
+    }
+    check(id_map_lookup(&map, PART_OFFSET) == -1, "hash lookup of an absent part base");
+    check(id_map_lookup(&map, parts * PART_OFFSET + 1) == -1, "hash lookup of an absent part");
+    check(id_map_lookup(&map, 2147483647) == -1, "hash lookup of INT_MAX");
+    check(id_map_lookup(&map, 0) == -1, "hash lookup of ID 0");
+    check(id_map_lookup(&map, -PART_OFFSET - 1) == -1, "hash lookup of a negative ID");
+    id_map_free(&map);
+}
+
+/* A dense map converted by a later reserve keeps its entries */
+static void test_reserve_conversion(void)
+{
+    id_map_t map;
+    int ok = 1;
+
+    printf("Testing dense to hash conversion...\n");
+    id_map_init(&map, 16);
+    for (int id = 1; id <= 100 && ok; id++) {
+        ok = id_map_insert(&map, id, 1000 + id, 0) == FEM_SUCCESS;
+    }
+    check(ok && map.mode == ID_MAP_DENSE, "first part is dense");
+    check(id_map_reserve(&map, 3 * PART_OFFSET + 1, 300) == FEM_SUCCESS, "reserve a wide span");
+    check(map.mode == ID_MAP_HASH, "wide reserve converts to hash mode");
+    check(map.count == 100, "conversion keeps the count");
+    check(all_present(&map, 1, 100, 1001), "conversion keeps the entries");
+    check(id_map_insert(&map, 3 * PART_OFFSET, 5, 0) == FEM_SUCCESS &&
+          id_map_lookup(&map, 3 * PART_OFFSET) == 5, "insert at the reserved end");
+
+    /* Many more entries than reserved: the table grows and keeps them */
+    for (int k = 1; k <= 50000 && ok; k++) {
+        ok = id_map_insert(&map, PART_OFFSET + 7 * k, k, 0) == FEM_SUCCESS;
+    }
+    check(ok, "hash growth inserts succeed");
+    check(map.count == 100 + 1 + 50000, "count after hash growth");
+    ok = 1;
+    for (int k = 1; k <= 50000 && ok; k++) {
+        ok = id_map_lookup(&map, PART_OFFSET + 7 * k) == k &&
+             id_map_lookup(&map, PART_OFFSET + 7 * k + 1) == -1;
+    }
+    check(ok, "lookups after hash growth");
+    check(all_present(&map, 1, 100, 1001), "first entries survive hash growth");
+
+    /* Clearing drops back to dense mode for the next model */
+    id_map_clear(&map);
+    check(map.mode == ID_MAP_DENSE && map.count == 0, "clear returns to dense mode");
+    check(id_map_lookup(&map, 1) == -1 && id_map_lookup(&map, PART_OFFSET + 7) == -1,
+          "clear removes the entries");
+    check(id_map_insert(&map, 3, 0, 0) == FEM_SUCCESS && map.mode == ID_MAP_DENSE &&
+          id_map_lookup(&map, 3) == 0, "compact insert after clear is dense");
+    id_map_free(&map);
+}
+
+/* IDs <= 0 are never stored and never found */
+static void test_nonpositive_ids(void)
+{
+    id_map_t map;
+
+    printf("Testing IDs <= 0...\n");
+    id_map_init(&map, 16);
+    check(id_map_insert(&map, 0, 1, 0) == FEM_ERROR_INVALID_INPUT, "insert of ID 0 is rejected");
+    check(id_map_insert(&map, -5, 1, 0) == FEM_ERROR_INVALID_INPUT,
+          "insert of a negative ID is rejected");
+    check(map.count == 0, "rejected inserts are not counted");
+    check(id_map_lookup(&map, 0) == -1 && id_map_lookup(&map, -1) == -1,
+          "lookups of IDs <= 0 in an empty map");
+    check(id_map_insert(&map, 1, 0, 0) == FEM_SUCCESS && id_map_lookup(&map, 0) == -1 &&
+          id_map_lookup(&map, -1) == -1, "lookups of IDs <= 0 in a dense map");
+    id_map_free(&map);
+}
+
+int main(void)
+{
+    printf("FEM4C ID Map Unit Tests\n");
+    printf("=======================\n\n");
+
+    test_dense_growth();
+    test_offset_parts(0);
+    test_offset_parts(10000);
+    test_reserve_conversion();
+    test_nonpositive_ids();
+
+    printf("\nTest Results:\n");
+    printf("=============\n");
+    printf("Tests passed: %d / %d\n", tests_passed, tests_total);
+
+    return (tests_passed == tests_total) ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/* FEM4C - Output Buffer Unit Tests
+ * The number formatters must produce exactly the text of snprintf
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+#include "../../src/io/output_buffer.h"
+
+/* Random values per formatter in the sweep */
+#define SWEEP_COUNT 200000
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_total = 0;
+static int failures_shown = 0;
+
+/* Deterministic 64-bit generator, so that a failure can be reproduced */
+static unsigned long long rng_state = 0x9E3779B97F4A7C15ULL;
+
+static unsigned long long rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void report(const char *expected, const char *actual, const char *what, double value)
+{
+    tests_total++;
+    if (strcmp(expected, actual) == 0) {
+        tests_passed++;
+        return;
+    }
+    if (failures_shown < 20) {
+        printf("  FAIL: %s(%.17g) - Expected \"%s\", got \"%s\"\n", what, value, expected, actual);
+        failures_shown++;
+    }
+}
+
+static void check_exp(double value, int width, int precision, int upper)
+{
+    char expected[512];
+    output_buffer_t buf;
+
+    snprintf(expected, sizeof(expected), upper ? "%*.*E" : "%*.*e", width, precision, value);
+    output_buffer_init(&buf);
+    output_buffer_exp(&buf, value, width, precision, upper);
+    output_buffer_char(&buf, '\0');
+    report(expected, buf.failed ? "<allocation failed>" : buf.data, "output_buffer_exp", value);
+    output_buffer_free(&buf);
+}
+
+static void check_fixed(double value, int precision)
+{
+    char expected[512];
+    output_buffer_t buf;
+
+    snprintf(expected, sizeof(expected), "%.*f", precision, value);
+    output_buffer_init(&buf);
+    output_buffer_fixed(&buf, value, precision);
+    output_buffer_char(&buf, '\0');
+    report(expected, buf.failed ? "<allocation failed>" : buf.data, "output_buffer_fixed", value);
+    output_buffer_free(&buf);
+}
+
+static void check_both(double value)
+{
+    for (int precision = 0; precision <= 17; precision++) {
+        check_exp(value, 0, precision, 0);
+        check_exp(value, 15, precision, 1);
+        check_fixed(value, precision);
+    }
+}
+
+/* Ties and other values where the rounding decision is the whole test */
+static void test_rounding_ties(void)
+{
+    static const double values[] = {
+        0.5, 1.5, 2.5, 3.5, -0.5, -2.5, 0.125, 0.375, -0.625, 1.25, 2.675, 1.005,
+        9.5, 99.5, 999.5, 9.995, 0.0005, 1.0e15 + 0.5, 4503599627370495.5,
+        9007199254740993.0, 0.15, 0.25, 0.35, 1e-5, 5e-5, 1.0 - DBL_EPSILON / 2.0,
+        9.9999999999999995, 0.049999999999999996, 123456.5, 1.45e-7
+    };
+
+    printf("Testing rounding ties...\n");
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        check_both(values[i]);
+    }
+}
+
+/* Zeros, subnormals, the extremes of the range, infinities and NaN */
+static void test_special_values(void)
+{
+    double values[] = {
+        0.0, -0.0, DBL_MIN, -DBL_MIN, DBL_MIN / 2.0, 4.9406564584124654e-324,
+        -4.9406564584124654e-324, 2.2250738585072009e-308, DBL_MAX, -DBL_MAX,
+        1e300, -1e300, 1e22, 1e23, 1.8446744073709552e19, 123456789012345678.0,
+        -1e-300, HUGE_VAL, -HUGE_VAL, NAN, -NAN
+    };
+
+    printf("Testing zeros, denormals, huge values, inf and nan...\n");
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        check_both(values[i]);
+    }
+}
+
+/* Random bit patterns and random decimal-looking values */
+static void test_random_sweep(void)
+{
+    printf("Testing %d random values...\n", SWEEP_COUNT);
+    for (int i = 0; i < SWEEP_COUNT; i++) {
+        unsigned long long bits = rng_next();
+        double value;
+
+        if (i % 2 == 0) {
+            memcpy(&value, &bits, sizeof(value));
+        } else {
+            /* k / 10^d with a small exponent, where ties and near-ties are common */
+            long long mantissa = (long long)(bits >> 20) % 200000001LL - 100000000LL;
+            int scale = (int)(rng_next() % 25ULL) - 12;
+            value = (double)mantissa * pow(10.0, (double)scale);
+        }
+
+        int precision = (int)(rng_next() % 18ULL);
+        int width = (int)(rng_next() % 26ULL);
+        check_exp(value, width, precision, (int)(bits & 1ULL));
+        check_fixed(value, precision);
+    }
+}
+
+int main(void)
+{
+    printf("FEM4C Output Buffer Unit Tests\n");
+    printf("==============================\n\n");
+
+    test_rounding_ties();
+    test_special_values();
+    test_random_sweep();
+
+    printf("\nTest Results:\n");
+    printf("=============\n");
+    printf("Tests passed: %d / %d\n", tests_passed, tests_total);
+
+    return (tests_passed == tests_total) ? 0 : 1;
+}